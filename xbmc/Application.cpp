@@ -311,6 +311,7 @@
 #include "utils/JobManager.h"
 #include "utils/SaveFileStateJob.h"
 #include "utils/AlarmClock.h"
+#include "utils/ChangeJournal.h"
 
 #ifdef _LINUX
 #include "XHandle.h"
@@ -1652,6 +1653,8 @@ void CApplication::StopServices()
 #endif
 
   g_peripherals.Clear();
+
+  CChangeJournal::GetInstance().Stop();
 }
 
 void CApplication::ReloadSkin()
@@ -3484,6 +3487,9 @@ void CApplication::Stop(int exitCode)
     CLog::Log(LOGERROR, "Exception in CApplication::Stop()");
   }
 
+  // write out whatever the asynchronous log writer still holds
+  CLog::SetAsync(false);
+
   // we may not get to finish the run cycle but exit immediately after a call to g_application.Stop()
   // so we may never get to Destroy() in CXBApplicationEx::Run(), we call it here.
   Destroy();
@@ -39,6 +39,7 @@
 #include "video/VideoDatabase.h"
 #include "music/MusicDatabase.h"
 #include "SortFileItem.h"
+#include "utils/SortKeys.h"
 #include "utils/TuxBoxUtil.h"
 #include "epg/Epg.h"
 #include "pvr/channels/PVRChannel.h"
@@ -1682,7 +1683,7 @@ void CFileItemList::Assign(const CFileItemList& itemlist, bool append)
   m_cacheToDisc = itemlist.m_cacheToDisc;
 }
 
-bool CFileItemList::Copy(const CFileItemList& items)
+bool CFileItemList::Copy(const CFileItemList& items, bool copyItems /* = true */)
 {
   // assign all CFileItem parts
   *(CFileItem*)this = *(CFileItem*)&items;
@@ -1697,6 +1698,9 @@ bool CFileItemList::Copy(const CFileItemList& items)
   m_sortOrder      = items.m_sortOrder;
   m_sortIgnoreFolders = items.m_sortIgnoreFolders;
 
+  if (!copyItems)
+    return true;
+
   // make a copy of each item
   for (int i = 0; i < items.Size(); i++)
   {
@@ -1807,6 +1811,45 @@ void CFileItemList::FillSortFields(FILEITEMFILLFUNC func)
   std::for_each(m_items.begin(), m_items.end(), func);
 }
 
+bool CFileItemList::SortByKeys(bool ascending, bool ignoreFolders)
+{
+  CSingleLock lock(m_lock);
+  std::vector<const wchar_t *> labels;
+  labels.reserve(m_items.size());
+  for (VECFILEITEMS::const_iterator i = m_items.begin(); i != m_items.end(); ++i)
+  {
+    if (!*i)
+      return false;
+    labels.push_back((*i)->GetSortLabel().c_str());
+  }
+
+  std::vector<std::string> keys;
+  if (!CSortKeys::Build(labels, keys))
+    return false;
+
+  std::vector<SSortFileItemKey> items(m_items.size());
+  std::vector<SSortFileItemKey *> sorted(m_items.size());
+  for (unsigned int i = 0; i < m_items.size(); i++)
+  {
+    SSortFileItemKey &item = items[i];
+    item.item = m_items[i];
+    item.key.swap(keys[i]);
+    item.onTop = item.item->SortsOnTop();
+    item.onBottom = item.item->SortsOnBottom();
+    item.folder = item.item->m_bIsFolder;
+    sorted[i] = &item;
+  }
+
+  if (ignoreFolders)
+    std::stable_sort(sorted.begin(), sorted.end(), ascending ? SSortFileItem::KeyIgnoreFoldersAscending : SSortFileItem::KeyIgnoreFoldersDescending);
+  else
+    std::stable_sort(sorted.begin(), sorted.end(), ascending ? SSortFileItem::KeyAscending : SSortFileItem::KeyDescending);
+
+  for (unsigned int i = 0; i < sorted.size(); i++)
+    m_items[i] = sorted[i]->item;
+  return true;
+}
+
 void CFileItemList::Sort(SORT_METHOD sortMethod, SORT_ORDER sortOrder)
 {
   //  Already sorted?
@@ -1929,14 +1972,22 @@ void CFileItemList::Sort(SORT_METHOD sortMethod, SORT_ORDER sortOrder)
   default:
     break;
   }
-  if (sortMethod == SORT_METHOD_FILE        ||
-      sortMethod == SORT_METHOD_VIDEO_SORT_TITLE ||
-      sortMethod == SORT_METHOD_VIDEO_SORT_TITLE_IGNORE_THE ||
-      sortMethod == SORT_METHOD_LABEL_IGNORE_FOLDERS ||
-      m_sortIgnoreFolders)
-    Sort(sortOrder==SORT_ORDER_ASC ? SSortFileItem::IgnoreFoldersAscending : SSortFileItem::IgnoreFoldersDescending);
-  else if (sortMethod != SORT_METHOD_NONE && sortMethod != SORT_METHOD_UNSORTED)
-    Sort(sortOrder==SORT_ORDER_ASC ? SSortFileItem::Ascending : SSortFileItem::Descending);
+  bool ignoreFolders = (sortMethod == SORT_METHOD_FILE        ||
+                        sortMethod == SORT_METHOD_VIDEO_SORT_TITLE ||
+                        sortMethod == SORT_METHOD_VIDEO_SORT_TITLE_IGNORE_THE ||
+                        sortMethod == SORT_METHOD_LABEL_IGNORE_FOLDERS ||
+                        m_sortIgnoreFolders);
+  if (ignoreFolders || (sortMethod != SORT_METHOD_NONE && sortMethod != SORT_METHOD_UNSORTED))
+  {
+    // sort by keys built from the sort labels, unless they can't represent the collation
+    if (!SortByKeys(sortOrder == SORT_ORDER_ASC, ignoreFolders))
+    {
+      if (ignoreFolders)
+        Sort(sortOrder==SORT_ORDER_ASC ? SSortFileItem::IgnoreFoldersAscending : SSortFileItem::IgnoreFoldersDescending);
+      else
+        Sort(sortOrder==SORT_ORDER_ASC ? SSortFileItem::Ascending : SSortFileItem::Descending);
+    }
+  }
 
   m_sortMethod=sortMethod;
   m_sortOrder=sortOrder;
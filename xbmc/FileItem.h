@@ -462,7 +462,7 @@ public:
   bool IsEmpty() const;
   void Append(const CFileItemList& itemlist);
   void Assign(const CFileItemList& itemlist, bool append = false);
-  bool Copy  (const CFileItemList& item);
+  bool Copy  (const CFileItemList& item, bool copyItems = true);
   void Reserve(int iCount);
   void Sort(SORT_METHOD sortMethod, SORT_ORDER sortOrder);
   void Randomize();
@@ -556,6 +556,14 @@ public:
 private:
   void Sort(FILEITEMLISTCOMPARISONFUNC func);
   void FillSortFields(FILEITEMFILLFUNC func);
+
+  /*! \brief Sort by the sort labels, comparing keys built from them once
+   \param ascending whether to sort in ascending order
+   \param ignoreFolders whether to sort folders along with files rather than first
+   \return false if the labels couldn't be converted to keys, the list is then unchanged
+   \sa CSortKeys
+   */
+  bool SortByKeys(bool ascending, bool ignoreFolders);
   CStdString GetDiscCacheFile(int windowID) const;
 
   /*!
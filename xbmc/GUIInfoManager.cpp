@@ -82,6 +82,7 @@
 
 #include "addons/AddonManager.h"
 #include "interfaces/info/InfoBool.h"
+#include "threads/Atomics.h"
 
 #define SYSHEATUPDATEINTERVAL 60000
 
@@ -110,7 +111,11 @@ CGUIInfoManager::CGUIInfoManager(void) :
   m_currentSlide = new CFileItem;
   m_frameCounter = 0;
   m_lastFPSTime = 0;
+  m_boolEvaluations = 0;
+  m_boolEvaluationsPerFrame = 0.0f;
   m_updateTime = 1;
+  for (unsigned int i = 0; i < INFOBOOL_DEPENDS_MAX; i++)
+    m_changeTime[i] = 1;
   ResetLibraryBools();
 }
 
@@ -1955,10 +1960,65 @@ bool CGUIInfoManager::EvaluateBool(const CStdString &expression, int contextWind
 bool CGUIInfoManager::GetBoolValue(unsigned int expression, const CGUIListItem *item)
 {
   if (expression && --expression < m_bools.size())
-    return m_bools[expression]->Get(m_updateTime, item);
+  {
+    InfoBool *info = m_bools[expression];
+    unsigned int lastChange = GetLastChange(info->GetDependencies());
+    if (item || info->IsDirty(lastChange))
+      m_boolEvaluations++;
+    return info->Get(lastChange, item);
+  }
   return false;
 }
 
+unsigned int CGUIInfoManager::GetBoolDependencies(unsigned int expression) const
+{
+  if (expression && --expression < m_bools.size())
+    return m_bools[expression]->GetDependencies();
+  return 1 << INFOBOOL_DEPENDS_FRAME;
+}
+
+unsigned int CGUIInfoManager::GetLastChange(unsigned int dependencies) const
+{
+  // 1 is the stamp everything starts out with, so a bool with no dependencies is
+  // evaluated once and then never again
+  unsigned int lastChange = 1;
+  for (unsigned int i = 0; i < INFOBOOL_DEPENDS_MAX; i++)
+  {
+    if ((dependencies & (1 << i)) && (unsigned int)m_changeTime[i] > lastChange)
+      lastChange = (unsigned int)m_changeTime[i];
+  }
+  return lastChange;
+}
+
+void CGUIInfoManager::Invalidate(int dependency)
+{
+  if (dependency >= 0 && dependency < INFOBOOL_DEPENDS_MAX)
+    m_changeTime[dependency] = AtomicIncrement(&m_updateTime);
+}
+
+unsigned int CGUIInfoManager::GetDependencies(int condition) const
+{
+  condition = abs(condition);
+
+  if (condition == 0 || condition == SYSTEM_ALWAYS_TRUE || condition == SYSTEM_ALWAYS_FALSE ||
+      condition == SYSTEM_ETHERNET_LINK_ACTIVE ||
+      condition == SYSTEM_PLATFORM_LINUX || condition == SYSTEM_PLATFORM_WINDOWS ||
+      condition == SYSTEM_PLATFORM_OSX || condition == SYSTEM_PLATFORM_DARWIN_OSX ||
+      condition == SYSTEM_PLATFORM_DARWIN_IOS || condition == SYSTEM_PLATFORM_DARWIN_ATV2)
+    return 0; // constant for the lifetime of the process
+  if (condition >= LIBRARY_HAS_MUSIC && condition <= LIBRARY_HAS_MUSICVIDEOS)
+    return 1 << INFOBOOL_DEPENDS_LIBRARY;
+  if (condition == PLAYER_SHOWINFO || condition == PLAYER_SHOWCODEC)
+    return 1 << INFOBOOL_DEPENDS_PLAYER_OSD;
+  if (condition >= MULTI_INFO_START && condition <= MULTI_INFO_END)
+  {
+    const GUIInfo &info = m_multiInfo[condition - MULTI_INFO_START];
+    if (info.m_info == SKIN_BOOL || info.m_info == SKIN_STRING)
+      return 1 << INFOBOOL_DEPENDS_SKIN_SETTINGS;
+  }
+  return 1 << INFOBOOL_DEPENDS_FRAME;
+}
+
 // checks the condition and returns it as necessary.  Currently used
 // for toggle button controls and visibility of images.
 bool CGUIInfoManager::GetBool(int condition1, int contextWindow, const CGUIListItem *item)
@@ -3992,8 +4052,10 @@ void CGUIInfoManager::UpdateFPS()
   {
     fTimeSpan /= 1000.0f;
     m_fps = m_frameCounter / fTimeSpan;
+    m_boolEvaluationsPerFrame = (float)m_boolEvaluations / m_frameCounter;
     m_lastFPSTime = curTime;
     m_frameCounter = 0;
+    m_boolEvaluations = 0;
   }
 }
 
@@ -4850,7 +4912,7 @@ void CGUIInfoManager::ResetCache()
 {
   // reset any animation triggers as well
   m_containerMoves.clear();
-  m_updateTime++;
+  Invalidate(INFOBOOL_DEPENDS_FRAME);
 }
 
 // Called from tuxbox service thread to update current status
@@ -5047,8 +5109,9 @@ void CGUIInfoManager::SetLibraryBool(int condition, bool value)
       m_libraryHasMusicVideos = value ? 1 : 0;
       break;
     default:
-      break;
+      return;
   }
+  Invalidate(INFOBOOL_DEPENDS_LIBRARY);
 }
 
 void CGUIInfoManager::ResetLibraryBools()
@@ -5057,6 +5120,7 @@ void CGUIInfoManager::ResetLibraryBools()
   m_libraryHasMovies = -1;
   m_libraryHasTVShows = -1;
   m_libraryHasMusicVideos = -1;
+  Invalidate(INFOBOOL_DEPENDS_LIBRARY);
 }
 
 bool CGUIInfoManager::GetLibraryBool(int condition)
@@ -50,6 +50,7 @@ namespace INFO
 {
   class InfoBool;
   class InfoSingle;
+  class InfoExpression;
 }
 
 // conditions for window retrieval
@@ -597,6 +598,15 @@ namespace INFO
 #define MULTI_INFO_END                99999
 #define COMBINED_VALUES_START        100000
 
+// sources of change a registered boolean can depend on.  Conditions on state that
+// reports its changes through CGUIInfoManager::Invalidate are only re-evaluated after
+// such a change, anything untracked is re-evaluated every frame.
+#define INFOBOOL_DEPENDS_FRAME          0 // untracked state, bumped by ResetCache()
+#define INFOBOOL_DEPENDS_LIBRARY        1 // Library.HasContent()
+#define INFOBOOL_DEPENDS_PLAYER_OSD     2 // Player.ShowInfo, Player.ShowCodec
+#define INFOBOOL_DEPENDS_SKIN_SETTINGS  3 // Skin.HasSetting(), Skin.String()
+#define INFOBOOL_DEPENDS_MAX            4
+
 // forward
 class CInfoLabel;
 class CGUIWindow;
@@ -667,6 +677,17 @@ public:
    */
   bool GetBoolValue(unsigned int expression, const CGUIListItem *item = NULL);
 
+  /*! \brief Notify registered booleans that some state they may depend on has changed
+   Booleans depending on the given source are re-evaluated on their next request.
+   \param dependency the source that changed, one of INFOBOOL_DEPENDS_*
+   \sa ResetCache
+   */
+  void Invalidate(int dependency);
+
+  /*! \brief Average number of registered booleans evaluated per frame over the last second
+   */
+  inline float GetBoolEvaluationsPerFrame() const { return m_boolEvaluationsPerFrame; };
+
   /*! \brief Evaluate a boolean expression
    \param expression the expression to evaluate
    \param context the context in which to evaluate the expression (currently windows)
@@ -731,10 +752,10 @@ public:
   void SetDisplayAfterSeek(unsigned int timeOut = 2500, int seekOffset = 0);
   void SetSeeking(bool seeking) { m_playerSeeking = seeking; };
   void SetShowTime(bool showtime) { m_playerShowTime = showtime; };
-  void SetShowCodec(bool showcodec) { m_playerShowCodec = showcodec; };
-  void SetShowInfo(bool showinfo) { m_playerShowInfo = showinfo; };
-  void ToggleShowCodec() { m_playerShowCodec = !m_playerShowCodec; };
-  bool ToggleShowInfo() { m_playerShowInfo = !m_playerShowInfo; return m_playerShowInfo; };
+  void SetShowCodec(bool showcodec) { m_playerShowCodec = showcodec; Invalidate(INFOBOOL_DEPENDS_PLAYER_OSD); };
+  void SetShowInfo(bool showinfo) { m_playerShowInfo = showinfo; Invalidate(INFOBOOL_DEPENDS_PLAYER_OSD); };
+  void ToggleShowCodec() { m_playerShowCodec = !m_playerShowCodec; Invalidate(INFOBOOL_DEPENDS_PLAYER_OSD); };
+  bool ToggleShowInfo() { m_playerShowInfo = !m_playerShowInfo; Invalidate(INFOBOOL_DEPENDS_PLAYER_OSD); return m_playerShowInfo; };
   bool m_performingSeek;
 
   std::string GetSystemHeatInfo(int info);
@@ -746,6 +767,11 @@ public:
   void SetNextWindow(int windowID) { m_nextWindowID = windowID; };
   void SetPreviousWindow(int windowID) { m_prevWindowID = windowID; };
 
+  /*! \brief Start a new frame
+   Clears the container movement triggers and marks every boolean that depends on
+   untracked state for re-evaluation.
+   \sa Invalidate
+   */
   void ResetCache();
   bool GetItemInt(int &value, const CGUIListItem *item, int info) const;
   CStdString GetItemLabel(const CFileItem *item, int info);
@@ -777,8 +803,17 @@ public:
   CStdString GetSkinVariableString(int info, bool preferImage = false, const CGUIListItem *item=NULL);
 protected:
   friend class INFO::InfoSingle;
+  friend class INFO::InfoExpression;
   bool GetBool(int condition, int contextWindow = 0, const CGUIListItem *item=NULL);
 
+  /*! \brief Sources of change a single condition depends on
+   \param condition the condition, as returned from TranslateSingleString
+   \return a mask of (1 << INFOBOOL_DEPENDS_*) bits
+   */
+  unsigned int GetDependencies(int condition) const;
+  unsigned int GetBoolDependencies(unsigned int expression) const;
+  unsigned int GetLastChange(unsigned int dependencies) const;
+
   // routines for window retrieval
   bool CheckWindowCondition(CGUIWindow *window, int condition) const;
   CGUIWindow *GetWindowWithCondition(int contextWindow, int condition) const;
@@ -860,6 +895,8 @@ protected:
   float m_fps;
   unsigned int m_frameCounter;
   unsigned int m_lastFPSTime;
+  unsigned int m_boolEvaluations;
+  float m_boolEvaluationsPerFrame;
 
   std::map<int, int> m_containerMoves;  // direction of list moving
   int m_nextWindowID;
@@ -867,7 +904,8 @@ protected:
 
   std::vector<INFO::InfoBool*> m_bools;
   std::vector<INFO::CSkinVariableString> m_skinVariableStrings;
-  unsigned int m_updateTime;
+  volatile long m_updateTime;                                // stamp of the most recent change
+  volatile long m_changeTime[INFOBOOL_DEPENDS_MAX];          // stamp of the last change per dependency
 
   int m_libraryHasMusic;
   int m_libraryHasMovies;
@@ -26,6 +26,7 @@
 #include "pvr/timers/PVRTimerInfoTag.h"
 #include "settings/AdvancedSettings.h"
 #include "utils/StringUtils.h"
+#include "utils/SortKeys.h"
 #include "music/tags/MusicInfoTag.h"
 #include "FileItem.h"
 #include "URL.h"
@@ -111,6 +112,54 @@ bool SSortFileItem::IgnoreFoldersDescending(const CFileItemPtr &left, const CFil
   return StringUtils::AlphaNumericCompare(left->GetSortLabel().c_str(),right->GetSortLabel().c_str()) > 0;
 }
 
+// the part of the item comparison that doesn't depend on the sort field.
+// returns -1 if left goes first, 1 if right goes first, 0 to compare the keys
+// and 2 if the items are equal
+static inline int CompareKeyItems(const SSortFileItemKey *left, const SSortFileItemKey *right, bool ignoreFolders)
+{
+  if (left->onTop != right->onTop)
+    return left->onTop ? -1 : 1;
+  if (left->onBottom != right->onBottom)
+    return left->onBottom ? 1 : -1;
+  if (left->onTop || left->onBottom)
+    return 2; // both have either sort on top or sort on bottom -> leave as-is
+  if (!ignoreFolders && left->folder != right->folder)
+    return left->folder ? -1 : 1;
+  return 0;
+}
+
+bool SSortFileItem::KeyAscending(const SSortFileItemKey *left, const SSortFileItemKey *right)
+{
+  int result = CompareKeyItems(left, right, false);
+  if (result)
+    return result < 0;
+  return CSortKeys::Compare(left->key, right->key) < 0;
+}
+
+bool SSortFileItem::KeyDescending(const SSortFileItemKey *left, const SSortFileItemKey *right)
+{
+  int result = CompareKeyItems(left, right, false);
+  if (result)
+    return result < 0;
+  return CSortKeys::Compare(left->key, right->key) > 0;
+}
+
+bool SSortFileItem::KeyIgnoreFoldersAscending(const SSortFileItemKey *left, const SSortFileItemKey *right)
+{
+  int result = CompareKeyItems(left, right, true);
+  if (result)
+    return result < 0;
+  return CSortKeys::Compare(left->key, right->key) < 0;
+}
+
+bool SSortFileItem::KeyIgnoreFoldersDescending(const SSortFileItemKey *left, const SSortFileItemKey *right)
+{
+  int result = CompareKeyItems(left, right, true);
+  if (result)
+    return result < 0;
+  return CSortKeys::Compare(left->key, right->key) > 0;
+}
+
 void SSortFileItem::ByLabel(CFileItemPtr &item)
 {
   if (!item) return;
@@ -22,9 +22,22 @@
 
 #include "utils/LabelFormatter.h"
 #include <boost/shared_ptr.hpp>
+#include <string>
 
 class CFileItem; typedef boost::shared_ptr<CFileItem> CFileItemPtr;
 
+/*! \brief An item along with the precomputed key it sorts by
+ \sa CSortKeys
+ */
+struct SSortFileItemKey
+{
+  CFileItemPtr item;
+  std::string key;
+  bool onTop;
+  bool onBottom;
+  bool folder;
+};
+
 struct SSortFileItem
 {
   /*! \brief Remove any articles (eg "the", "a") from the start of a label
@@ -39,6 +52,12 @@ struct SSortFileItem
   static bool IgnoreFoldersAscending(const CFileItemPtr &left, const CFileItemPtr &right);
   static bool IgnoreFoldersDescending(const CFileItemPtr &left, const CFileItemPtr &right);
 
+  // Sort by precomputed key, in the same order as the above
+  static bool KeyAscending(const SSortFileItemKey *left, const SSortFileItemKey *right);
+  static bool KeyDescending(const SSortFileItemKey *left, const SSortFileItemKey *right);
+  static bool KeyIgnoreFoldersAscending(const SSortFileItemKey *left, const SSortFileItemKey *right);
+  static bool KeyIgnoreFoldersDescending(const SSortFileItemKey *left, const SSortFileItemKey *right);
+
   // Fill in sort field
   static void ByLabel(CFileItemPtr &item);
   static void ByLabelNoThe(CFileItemPtr &item);
@@ -32,6 +32,7 @@
 #include "pictures/Picture.h"
 #include "guilib/TextureManager.h"
 #include "utils/URIUtils.h"
+#include "utils/CPUInfo.h"
 
 using namespace XFILE;
 
@@ -126,7 +127,12 @@ CTextureCache &CTextureCache::Get()
 }
 
 CTextureCache::CTextureCache()
+  : CJobQueue(false, std::max(1, g_cpuInfo.getCPUCount()), CJob::PRIORITY_LOW),
+    CThread("TextureDBWriter")
 {
+  m_jobsDone = 0;
+  m_jobsTotal = 0;
+  m_initialized = false;
 }
 
 CTextureCache::~CTextureCache()
@@ -138,15 +144,99 @@ void CTextureCache::Initialize()
   CSingleLock lock(m_databaseSection);
   if (!m_database.IsOpen())
     m_database.Open();
+  {
+    CSingleLock pendingLock(m_pendingSection);
+    m_initialized = true;
+  }
+  if (!IsRunning())
+    Create();
 }
 
 void CTextureCache::Deinitialize()
 {
+  { // jobs that are already running still complete, but their results are dropped
+    CSingleLock lock(m_pendingSection);
+    m_initialized = false;
+  }
   CancelJobs();
+  { // cancelled jobs don't complete, so forget about them
+    CSingleLock lock(m_pendingSection);
+    m_outstanding.clear();
+    m_jobsDone = m_jobsTotal = 0;
+  }
+  m_jobDone.notifyAll();
+  StopThread(); // writes out anything still pending
   CSingleLock lock(m_databaseSection);
   m_database.Close();
 }
 
+void CTextureCache::Process()
+{
+  while (!m_bStop)
+  {
+    AbortableWait(m_pendingEvent, TEXTURE_DB_FLUSH_INTERVAL);
+    FlushPending();
+  }
+  FlushPending();
+}
+
+void CTextureCache::CacheImages(const std::vector<CStdString> &urls, const CJob *job)
+{
+  for (std::vector<CStdString>::const_iterator i = urls.begin(); i != urls.end(); ++i)
+  {
+    if (job && job->ShouldCancel(i - urls.begin(), urls.size()))
+      return;
+    if (IsCachedImage(*i))
+      continue;
+    CStdString cacheFile;
+    if (GetCachedTexture(*i, cacheFile))
+      continue; // GetCachedTexture takes care of checking for updates
+    {
+      CSingleLock lock(m_pendingSection);
+      while (m_initialized && m_outstanding.size() >= TEXTURE_CACHE_MAX_OUTSTANDING)
+        m_jobDone.wait(lock, 1000);
+      if (!m_initialized)
+        return;
+    }
+    AddCacheJob(new CCacheJob(*i, ""));
+  }
+}
+
+bool CTextureCache::GetProgress(unsigned int &done, unsigned int &total)
+{
+  CSingleLock lock(m_pendingSection);
+  done = m_jobsDone;
+  total = m_jobsTotal;
+  return !m_outstanding.empty();
+}
+
+void CTextureCache::AddCacheJob(CCacheJob *job)
+{
+  {
+    CSingleLock lock(m_pendingSection);
+    if (!m_outstanding.insert(job->m_original).second)
+    { // already being cached
+      delete job;
+      return;
+    }
+    if (m_outstanding.size() == 1)
+      m_jobsDone = m_jobsTotal = 0;
+    m_jobsTotal++;
+  }
+  AddJob(job);
+}
+
+bool CTextureCache::WaitForCacheJob(const CStdString &url)
+{
+  CStdString cacheFile = GetCacheFile(url);
+  CSingleLock lock(m_pendingSection);
+  if (m_outstanding.find(cacheFile) == m_outstanding.end())
+    return false;
+  while (m_initialized && m_outstanding.find(cacheFile) != m_outstanding.end())
+    m_jobDone.wait(lock, 1000);
+  return true;
+}
+
 bool CTextureCache::IsCachedImage(const CStdString &url) const
 {
   if (url != "-" && !CURL::IsFullPath(url))
@@ -208,6 +298,13 @@ CStdString CTextureCache::CheckAndCacheImage(const CStdString &url, bool returnD
   {
     return path;
   }
+  // don't cache it twice if a background job is at it already
+  if (WaitForCacheJob(url))
+  {
+    path = CheckCachedImage(url, returnDDS);
+    if (!path.IsEmpty())
+      return path;
+  }
   return CacheImageFile(url);
 }
 
@@ -282,26 +379,72 @@ void CTextureCache::ClearCachedImage(const CStdString &url, bool deleteSource /*
 
 bool CTextureCache::GetCachedTexture(const CStdString &url, CStdString &cachedURL)
 {
-  CSingleLock lock(m_databaseSection);
   CStdString imageHash;
-  if (m_database.GetCachedTexture(url, cachedURL, imageHash))
   {
-    if (!imageHash.IsEmpty()) // check for an updated image
-      AddJob(new CCacheJob(url, imageHash));
-    return true;
+    CSingleLock lock(m_databaseSection);
+    { // cached but not yet written
+      CSingleLock pendingLock(m_pendingSection);
+      std::map<CStdString, CTextureDetails>::const_iterator i = m_pending.find(url);
+      if (i != m_pending.end())
+      {
+        cachedURL = i->second.file;
+        return true;
+      }
+    }
+    if (!m_database.GetCachedTexture(url, cachedURL, imageHash))
+      return false;
   }
-  return false;
+  if (!imageHash.IsEmpty()) // check for an updated image
+    AddCacheJob(new CCacheJob(url, imageHash));
+  return true;
+}
+
+void CTextureCache::AddCachedTexture(const CStdString &url, const CStdString &cachedURL, const CStdString &hash)
+{
+  CSingleLock lock(m_pendingSection);
+  CTextureDetails &details = m_pending[url];
+  details.url = url;
+  details.file = cachedURL;
+  details.hash = hash;
+  if (m_pending.size() >= TEXTURE_DB_BATCH_SIZE)
+    m_pendingEvent.Set();
 }
 
-bool CTextureCache::AddCachedTexture(const CStdString &url, const CStdString &cachedURL, const CStdString &hash)
+void CTextureCache::FlushPending()
 {
   CSingleLock lock(m_databaseSection);
-  return m_database.AddCachedTexture(url, cachedURL, hash);
+  std::vector<CTextureDetails> textures;
+  {
+    CSingleLock pendingLock(m_pendingSection);
+    textures.reserve(m_pending.size());
+    for (std::map<CStdString, CTextureDetails>::const_iterator i = m_pending.begin(); i != m_pending.end(); ++i)
+      textures.push_back(i->second);
+    m_pending.clear();
+  }
+  if (textures.empty())
+    return;
+  // lookups wait on the database lock until the batch is written
+  if (!m_database.IsOpen() || !m_database.AddCachedTextures(textures))
+    CLog::Log(LOGERROR, "%s - failed to write %u cached images to the database", __FUNCTION__, (unsigned int)textures.size());
+  else
+    CLog::Log(LOGDEBUG, "%s - wrote %u cached images to the database", __FUNCTION__, (unsigned int)textures.size());
 }
 
 bool CTextureCache::ClearCachedTexture(const CStdString &url, CStdString &cachedURL)
 {
   CSingleLock lock(m_databaseSection);
+  {
+    CSingleLock pendingLock(m_pendingSection);
+    std::map<CStdString, CTextureDetails>::iterator i = m_pending.find(url);
+    if (i != m_pending.end())
+    {
+      cachedURL = i->second.file;
+      m_pending.erase(i);
+      CStdString oldFile;
+      m_database.ClearCachedTexture(url, oldFile); // may have an older entry
+      return true;
+    }
+  }
   return m_database.ClearCachedTexture(url, cachedURL);
 }
 
@@ -342,12 +485,24 @@ CStdString CTextureCache::GetCachedPath(const CStdString &file)
 
 void CTextureCache::OnJobComplete(unsigned int jobID, bool success, CJob *job)
 {
-  if (strcmp(job->GetType(), "cacheimage") == 0 && success)
+  if (strcmp(job->GetType(), "cacheimage") == 0)
   {
     CCacheJob *cacheJob = (CCacheJob *)job;
-    AddCachedTexture(cacheJob->m_url, cacheJob->m_original, cacheJob->m_hash);
+    bool cached = false;
+    {
+      CSingleLock lock(m_pendingSection);
+      if (m_outstanding.erase(cacheJob->m_original))
+        m_jobsDone++;
+      // once deinitialized nothing writes the pending batch out any more
+      if (success && m_initialized)
+      {
+        AddCachedTexture(cacheJob->m_url, cacheJob->m_original, cacheJob->m_hash);
+        cached = true;
+      }
+    }
+    m_jobDone.notifyAll();
     // TODO: call back to the UI indicating that it can update it's image...
-    if (g_advancedSettings.m_useDDSFanart)
+    if (cached && g_advancedSettings.m_useDDSFanart)
       AddJob(new CDDSJob(GetCachedPath(cacheJob->m_original)));
   }
   return CJobQueue::OnJobComplete(jobID, success, job);
@@ -23,8 +23,19 @@
 
 #include "utils/StdString.h"
 #include "utils/JobManager.h"
+#include "threads/Thread.h"
+#include "threads/Event.h"
+#include "threads/Condition.h"
 #include "TextureDatabase.h"
 
+#include <map>
+#include <set>
+#include <vector>
+
+#define TEXTURE_CACHE_MAX_OUTSTANDING 64   // images queued by CacheImages before it blocks
+#define TEXTURE_DB_BATCH_SIZE         100  // cached images that wake the database writer
+#define TEXTURE_DB_FLUSH_INTERVAL     2000 // ms between database writes otherwise
+
 /*!
  \ingroup textures
  \brief Texture cache class for handling the caching of images.
@@ -34,8 +45,13 @@
  may be periodically checked for updates and may be purged from the cache if
  unused for a set period of time.
 
+ Background caching runs as many jobs at once as there are cores, each decoding,
+ scaling and writing one image. The resulting database updates are collected and
+ written in batched transactions by a single writer thread; until then lookups are
+ answered from the pending batch.
+
  */
-class CTextureCache : public CJobQueue
+class CTextureCache : public CJobQueue, public CThread
 {
 public:
   /*!
@@ -68,6 +84,7 @@ public:
   /*! \brief This function is a wrapper around CheckCacheImage and CacheImageFile.
   
    Checks firstly whether an image is already cached, and return URL if so [see CheckCacheImage]
+   If the image is being cached in the background, waits for that to finish.
    If the image is not yet in the database it is cached and added to the database [see CacheImageFile]
 
    \param image url of the image to check and cache
@@ -86,7 +103,26 @@ public:
    \sa CCacheJob::CacheImage
    */  
   CStdString CacheImageFile(const CStdString &url);
-  
+
+  /*! \brief Cache a batch of images in the background
+
+   Images that aren't cached yet are queued for caching. Blocks while
+   TEXTURE_CACHE_MAX_OUTSTANDING images are being cached, so should not be called
+   from the GUI thread.
+
+   \param urls urls of the images to cache
+   \param job the job queueing them, if any. Queueing stops once it is cancelled.
+   \sa GetProgress
+   */
+  void CacheImages(const std::vector<CStdString> &urls, const CJob *job = NULL);
+
+  /*! \brief Progress of background caching
+   \param done [out] number of images processed since the queue was last empty
+   \param total [out] number of images queued since the queue was last empty
+   \return true if images are being cached, false if the queue is empty
+   */
+  bool GetProgress(unsigned int &done, unsigned int &total);
+
   /*! \brief retrieve the cached version of the given image (if it exists)
    \param image url of the image
    \return cached url of this image, empty if none exists
@@ -177,14 +213,29 @@ private:
    */
   bool IsCachedImage(const CStdString &image) const;
 
-  /*! \brief Add this image to the database
-   Thread-safe wrapper of CTextureDatabase::AddCachedTexture
+  /*! \brief Queue this image for adding to the database
+   The image is written by the next batch of the database writer, and is returned by
+   GetCachedTexture in the meantime.
    \param image url of the original image
    \param cacheFile url of the cached image
    \param hash hash of the original image
-   \return true if we successfully added to the database, false otherwise.
+   \sa FlushPending
+   */
+  void AddCachedTexture(const CStdString &image, const CStdString &cacheFile, const CStdString &hash);
+
+  /*! \brief Write all queued images to the database in a single transaction
+   */
+  void FlushPending();
+
+  /*! \brief Queue a caching job unless the same image is already being cached
    */
-  bool AddCachedTexture(const CStdString &image, const CStdString &cacheFile, const CStdString &hash);
+  void AddCacheJob(CCacheJob *job);
+
+  /*! \brief Wait for a caching job of the given image to finish
+   \param url url of the image
+   \return true if the image was being cached, false otherwise
+   */
+  bool WaitForCacheJob(const CStdString &url);
 
   /*! \brief Get an image from the database
    Thread-safe wrapper of CTextureDatabase::GetCachedTexture
@@ -211,7 +262,20 @@ private:
 
   virtual void OnJobComplete(unsigned int jobID, bool success, CJob *job);
 
-  CCriticalSection m_databaseSection;
+  /*! \brief The database writer
+   */
+  virtual void Process();
+
+  CCriticalSection m_databaseSection;  ///< taken before m_pendingSection
   CTextureDatabase m_database;
+
+  CCriticalSection m_pendingSection;
+  std::map<CStdString, CTextureDetails> m_pending;  ///< images not yet written, by url
+  CEvent m_pendingEvent;                            ///< wakes the writer
+  std::set<CStdString> m_outstanding;               ///< cache files of images being cached
+  XbmcThreads::ConditionVariable m_jobDone;         ///< signalled as caching jobs finish
+  unsigned int m_jobsDone;
+  unsigned int m_jobsTotal;
+  bool m_initialized;                               ///< false once nothing writes the pending batch
 };
 
@@ -141,6 +141,22 @@ bool CTextureDatabase::AddCachedTexture(const CStdString &url, const CStdString
   return true;
 }
 
+bool CTextureDatabase::AddCachedTextures(const std::vector<CTextureDetails> &textures)
+{
+  if (NULL == m_pDB.get()) return false;
+  if (NULL == m_pDS.get()) return false;
+
+  BeginTransaction();
+  for (std::vector<CTextureDetails>::const_iterator it = textures.begin(); it != textures.end(); ++it)
+    AddCachedTexture(it->url, it->file, it->hash);
+  if (CommitTransaction())
+    return true;
+
+  CLog::Log(LOGERROR, "%s failed to commit %u textures", __FUNCTION__, (unsigned int)textures.size());
+  RollbackTransaction();
+  return false;
+}
+
 bool CTextureDatabase::ClearCachedTexture(const CStdString &url, CStdString &cacheFile)
 {
   try
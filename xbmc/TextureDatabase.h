@@ -23,6 +23,17 @@
 
 #include "dbwrappers/Database.h"
 
+#include <vector>
+
+/*! \brief A cached texture, as stored in the database
+ */
+struct CTextureDetails
+{
+  CStdString url;   ///< url of the original image
+  CStdString file;  ///< cached file, relative to the thumbnails folder
+  CStdString hash;  ///< hash of the original image at the time it was cached
+};
+
 class CTextureDatabase : public CDatabase
 {
 public:
@@ -34,6 +45,13 @@ public:
   bool AddCachedTexture(const CStdString &originalURL, const CStdString &cachedFile, const CStdString &imageHash = "");
   bool ClearCachedTexture(const CStdString &originalURL, CStdString &cacheFile);
 
+  /*! \brief Add or update a batch of cached textures in a single transaction
+   \param textures the textures to store
+   \return true if the transaction was committed
+   \sa AddCachedTexture
+   */
+  bool AddCachedTextures(const std::vector<CTextureDetails> &textures);
+
   /*! \brief Get a texture associated with the given path
    Used for retrieval of previously discovered (and cached) images to save
    stat() on the filesystem all the time
@@ -724,7 +724,7 @@ DemuxPacket* CDVDDemuxFFmpeg::Read()
         {
           if(pkt.stream_index == (int)m_pFormatContext->programs[m_program]->stream_index[i])
           {
-            pPacket = CDVDDemuxUtils::AllocateDemuxPacket(pkt.size);
+            pPacket = CDVDDemuxUtils::AllocateDemuxPacket(&pkt);
             break;
           }
         }
@@ -733,7 +733,7 @@ DemuxPacket* CDVDDemuxFFmpeg::Read()
           bReturnEmpty = true;
       }
       else
-        pPacket = CDVDDemuxUtils::AllocateDemuxPacket(pkt.size);
+        pPacket = CDVDDemuxUtils::AllocateDemuxPacket(&pkt);
 
       if (pPacket)
       {
@@ -769,13 +769,6 @@ DemuxPacket* CDVDDemuxFFmpeg::Read()
           pkt.pts = AV_NOPTS_VALUE;
         }
 
-        // copy contents into our own packet
-        pPacket->iSize = pkt.size;
-
-        // maybe we can avoid a memcpy here by detecting where pkt.destruct is pointing too?
-        if (pkt.data)
-          memcpy(pPacket->pData, pkt.data, pPacket->iSize);
-
         pPacket->pts = ConvertTimestamp(pkt.pts, stream->time_base.den, stream->time_base.num);
         pPacket->dts = ConvertTimestamp(pkt.dts, stream->time_base.den, stream->time_base.num);
         pPacket->duration =  DVD_SEC_TO_TIME((double)pkt.duration * stream->time_base.num / stream->time_base.den);
@@ -24,6 +24,10 @@
 #endif
 #include "DVDDemuxUtils.h"
 #include "DVDClock.h"
+#include "DVDPerformanceCounter.h"
+#include "DllAvCodec.h"
+#include "threads/CriticalSection.h"
+#include "threads/SingleLock.h"
 #include "utils/log.h"
 extern "C" {
 #if (defined USE_EXTERNAL_FFMPEG)
@@ -37,13 +41,193 @@ extern "C" {
 #endif
 }
 
+// payloads are pooled in power of two size classes from 256 bytes up to 4 MB,
+// anything larger is allocated and freed as before
+#define POOL_MIN_SHIFT     8
+#define POOL_MAX_SHIFT     22
+#define POOL_CLASSES       (POOL_MAX_SHIFT - POOL_MIN_SHIFT + 1)
+#define POOL_CLASS_HEADER  POOL_CLASSES   // packets without an own payload buffer
+#define POOL_CLASS_NONE    -1             // packets that are never returned to the pool
+
+#define POOL_MAX_FREE      64                 // free packets kept per size class
+#define POOL_MAX_BYTES     (32 * 1024 * 1024) // payload bytes kept over all size classes
+
+// the public DemuxPacket is the first member so the pointers can be used interchangeably,
+// this keeps the layout seen by pvr addons unchanged
+typedef struct DemuxPacketEntry
+{
+  DemuxPacket       packet;
+  unsigned char*    pBuffer;  // payload buffer owned by the entry, pData may be changed by users
+  int               iClass;   // size class of pBuffer
+  bool              bAdopted; // payload belongs to avpkt
+  AVPacket          avpkt;
+  DemuxPacketEntry* pNext;
+} DemuxPacketEntry;
+
+class CDVDDemuxPacketPool
+{
+public:
+  CDVDDemuxPacketPool()
+  {
+    for (int i = 0; i <= POOL_CLASS_HEADER; i++)
+    {
+      m_free[i]  = NULL;
+      m_count[i] = 0;
+    }
+    m_bytes = 0;
+  }
+
+  ~CDVDDemuxPacketPool()
+  {
+    Flush();
+    if (m_dllAvCodec.IsLoaded())
+      m_dllAvCodec.Unload();
+  }
+
+  static int GetClass(int iDataSize)
+  {
+    int size = iDataSize + FF_INPUT_BUFFER_PADDING_SIZE;
+    for (int i = 0; i < POOL_CLASSES; i++)
+    {
+      if (size <= (1 << (i + POOL_MIN_SHIFT)))
+        return i;
+    }
+    return POOL_CLASS_NONE;
+  }
+
+  DemuxPacketEntry* Get(int iClass)
+  {
+    {
+      CSingleLock lock(m_critSection);
+      if (iClass != POOL_CLASS_NONE && m_free[iClass])
+      {
+        DemuxPacketEntry* entry = m_free[iClass];
+        m_free[iClass] = entry->pNext;
+        m_count[iClass]--;
+        if (iClass != POOL_CLASS_HEADER)
+          m_bytes -= 1 << (iClass + POOL_MIN_SHIFT);
+        g_dvdPerformanceCounter.m_packetPool.hits++;
+        g_dvdPerformanceCounter.m_packetPool.cached = m_bytes;
+        return entry;
+      }
+      g_dvdPerformanceCounter.m_packetPool.misses++;
+    }
+
+    DemuxPacketEntry* entry = new DemuxPacketEntry;
+    entry->pBuffer  = NULL;
+    entry->iClass   = iClass;
+    entry->bAdopted = false;
+    entry->pNext    = NULL;
+    return entry;
+  }
+
+  void Put(DemuxPacketEntry* entry)
+  {
+    if (entry->bAdopted)
+    {
+      m_dllAvCodec.av_free_packet(&entry->avpkt);
+      entry->bAdopted = false;
+    }
+
+    int size = 0;
+    if (entry->iClass != POOL_CLASS_HEADER && entry->iClass != POOL_CLASS_NONE)
+      size = 1 << (entry->iClass + POOL_MIN_SHIFT);
+
+    if (entry->iClass != POOL_CLASS_NONE)
+    {
+      CSingleLock lock(m_critSection);
+      if (m_count[entry->iClass] < POOL_MAX_FREE && m_bytes + size <= POOL_MAX_BYTES)
+      {
+        entry->pNext = m_free[entry->iClass];
+        m_free[entry->iClass] = entry;
+        m_count[entry->iClass]++;
+        m_bytes += size;
+        g_dvdPerformanceCounter.m_packetPool.cached = m_bytes;
+        return;
+      }
+    }
+
+    Destroy(entry);
+  }
+
+  bool Adopt(DemuxPacketEntry* entry, AVPacket* pkt)
+  {
+    {
+      CSingleLock lock(m_critSection);
+      if (!m_dllAvCodec.IsLoaded() && !m_dllAvCodec.Load())
+        return false;
+    }
+
+    // make sure the payload is owned by the packet and not by a parser context
+    if (m_dllAvCodec.av_dup_packet(pkt) < 0)
+      return false;
+
+    // the decoders rely on the alignment we used to guarantee
+    if (((uintptr_t)pkt->data & 15) != 0)
+      return false;
+
+    entry->avpkt    = *pkt;
+    entry->bAdopted = true;
+
+    pkt->data     = NULL;
+    pkt->size     = 0;
+    pkt->destruct = NULL;
+
+    CSingleLock lock(m_critSection);
+    g_dvdPerformanceCounter.m_packetPool.adopted++;
+    return true;
+  }
+
+  void Flush()
+  {
+    CSingleLock lock(m_critSection);
+    for (int i = 0; i <= POOL_CLASS_HEADER; i++)
+    {
+      while (m_free[i])
+      {
+        DemuxPacketEntry* entry = m_free[i];
+        m_free[i] = entry->pNext;
+        Destroy(entry);
+      }
+      m_count[i] = 0;
+    }
+    m_bytes = 0;
+    g_dvdPerformanceCounter.m_packetPool.cached = 0;
+  }
+
+private:
+  static void Destroy(DemuxPacketEntry* entry)
+  {
+    if (entry->pBuffer)
+      _aligned_free(entry->pBuffer);
+    delete entry;
+  }
+
+  CCriticalSection  m_critSection;
+  DemuxPacketEntry* m_free[POOL_CLASS_HEADER + 1];
+  int               m_count[POOL_CLASS_HEADER + 1];
+  int               m_bytes;
+  DllAvCodec        m_dllAvCodec;
+};
+
+static CDVDDemuxPacketPool g_packetPool;
+
+static void ResetDemuxPacket(DemuxPacket* pPacket)
+{
+  memset(pPacket, 0, sizeof(DemuxPacket));
+
+  // setup defaults
+  pPacket->dts       = DVD_NOPTS_VALUE;
+  pPacket->pts       = DVD_NOPTS_VALUE;
+  pPacket->iStreamId = -1;
+}
+
 void CDVDDemuxUtils::FreeDemuxPacket(DemuxPacket* pPacket)
 {
   if (pPacket)
   {
     try {
-      if (pPacket->pData) _aligned_free(pPacket->pData);
-      delete pPacket;
+      g_packetPool.Put((DemuxPacketEntry*)pPacket);
     }
     catch(...) {
       CLog::Log(LOGERROR, "%s - Exception thrown while freeing packet", __FUNCTION__);
@@ -53,45 +237,95 @@ void CDVDDemuxUtils::FreeDemuxPacket(DemuxPacket* pPacket)
 
 DemuxPacket* CDVDDemuxUtils::AllocateDemuxPacket(int iDataSize)
 {
-  DemuxPacket* pPacket = new DemuxPacket;
-  if (!pPacket) return NULL;
-
+  DemuxPacketEntry* entry = NULL;
   try
   {
-    memset(pPacket, 0, sizeof(DemuxPacket));
-
     if (iDataSize > 0)
     {
-      // need to allocate a few bytes more.
-      // From avcodec.h (ffmpeg)
-      /**
-        * Required number of additionally allocated bytes at the end of the input bitstream for decoding.
-        * this is mainly needed because some optimized bitstream readers read
-        * 32 or 64 bit at once and could read over the end<br>
-        * Note, if the first 23 bits of the additional bytes are not 0 then damaged
-        * MPEG bitstreams could cause overread and segfault
-        */
-      pPacket->pData =(BYTE*)_aligned_malloc(iDataSize + FF_INPUT_BUFFER_PADDING_SIZE, 16);
-      if (!pPacket->pData)
+      entry = g_packetPool.Get(CDVDDemuxPacketPool::GetClass(iDataSize));
+      if (!entry->pBuffer)
       {
-        FreeDemuxPacket(pPacket);
-        return NULL;
+        // need to allocate a few bytes more.
+        // From avcodec.h (ffmpeg)
+        /**
+          * Required number of additionally allocated bytes at the end of the input bitstream for decoding.
+          * this is mainly needed because some optimized bitstream readers read
+          * 32 or 64 bit at once and could read over the end<br>
+          * Note, if the first 23 bits of the additional bytes are not 0 then damaged
+          * MPEG bitstreams could cause overread and segfault
+          */
+        int size = iDataSize + FF_INPUT_BUFFER_PADDING_SIZE;
+        if (entry->iClass != POOL_CLASS_NONE)
+          size = 1 << (entry->iClass + POOL_MIN_SHIFT);
+
+        entry->pBuffer = (BYTE*)_aligned_malloc(size, 16);
+        if (!entry->pBuffer)
+        {
+          g_packetPool.Put(entry);
+          return NULL;
+        }
       }
+    }
+    else
+      entry = g_packetPool.Get(POOL_CLASS_HEADER);
+
+    ResetDemuxPacket(&entry->packet);
+
+    if (iDataSize > 0)
+    {
+      entry->packet.pData = entry->pBuffer;
 
       // reset the last 8 bytes to 0;
-      memset(pPacket->pData + iDataSize, 0, FF_INPUT_BUFFER_PADDING_SIZE);
+      memset(entry->packet.pData + iDataSize, 0, FF_INPUT_BUFFER_PADDING_SIZE);
     }
+  }
+  catch(...)
+  {
+    CLog::Log(LOGERROR, "%s - Exception thrown", __FUNCTION__);
+    if (entry)
+      FreeDemuxPacket(&entry->packet);
+    return NULL;
+  }
+  return &entry->packet;
+}
+
+DemuxPacket* CDVDDemuxUtils::AllocateDemuxPacket(AVPacket* pkt)
+{
+  if (!pkt->data || pkt->size <= 0)
+    return AllocateDemuxPacket(0);
 
-    // setup defaults
-    pPacket->dts       = DVD_NOPTS_VALUE;
-    pPacket->pts       = DVD_NOPTS_VALUE;
-    pPacket->iStreamId = -1;
+  DemuxPacketEntry* entry = NULL;
+  try
+  {
+    entry = g_packetPool.Get(POOL_CLASS_HEADER);
+    if (g_packetPool.Adopt(entry, pkt))
+    {
+      ResetDemuxPacket(&entry->packet);
+      entry->packet.pData = entry->avpkt.data;
+      entry->packet.iSize = entry->avpkt.size;
+      return &entry->packet;
+    }
+    g_packetPool.Put(entry);
   }
   catch(...)
   {
     CLog::Log(LOGERROR, "%s - Exception thrown", __FUNCTION__);
-    FreeDemuxPacket(pPacket);
-    pPacket = NULL;
+    if (entry)
+      FreeDemuxPacket(&entry->packet);
+    return NULL;
+  }
+
+  // payload could not be taken over, fall back to a copy
+  DemuxPacket* pPacket = AllocateDemuxPacket(pkt->size);
+  if (pPacket)
+  {
+    pPacket->iSize = pkt->size;
+    memcpy(pPacket->pData, pkt->data, pkt->size);
   }
   return pPacket;
 }
+
+void CDVDDemuxUtils::FlushPacketPool()
+{
+  g_packetPool.Flush();
+}
@@ -23,10 +23,27 @@
 
 #include "DVDDemuxPacket.h"
 
+struct AVPacket;
+
 class CDVDDemuxUtils
 {
 public:
   static void FreeDemuxPacket(DemuxPacket* pPacket);
   static DemuxPacket* AllocateDemuxPacket(int iDataSize = 0);
+
+  /*!
+   \brief Allocate a packet that takes over the payload of an ffmpeg packet
+   When possible the payload buffer of pkt is handed to the returned packet without
+   copying, in which case pkt is left empty and freeing it is a no-op. Otherwise the
+   payload is copied into a pooled buffer and pkt is left untouched.
+   \param pkt the packet returned by av_read_frame
+   \return a packet holding the payload of pkt, NULL on failure
+   */
+  static DemuxPacket* AllocateDemuxPacket(AVPacket* pkt);
+
+  /*!
+   \brief Release all packet buffers currently kept for reuse
+   */
+  static void FlushPacketPool();
 };
 
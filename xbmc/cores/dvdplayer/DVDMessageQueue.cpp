@@ -26,9 +26,26 @@
 #include "DVDClock.h"
 #include "utils/MathUtils.h"
 #include "utils/TimeUtils.h"
+#include "threads/Atomics.h"
 
 using namespace std;
 
+// number of packets the lock free ring can hold before the producer falls
+// back to the locked list
+#define MSGQ_RING_SIZE 4096
+
+// true if sequence a was handed out before sequence b, survives wrap around
+static inline bool SequenceBefore(long a, long b)
+{
+  return (long)((unsigned long)a - (unsigned long)b) < 0;
+}
+
+// distance between two of the ring counters, survives wrap around
+static inline unsigned long RingDistance(unsigned long from, unsigned long to)
+{
+  return to - from;
+}
+
 CDVDMessageQueue::CDVDMessageQueue(const string &owner) : m_hEvent(true)
 {
   m_owner = owner;
@@ -41,15 +58,27 @@ CDVDMessageQueue::CDVDMessageQueue(const string &owner) : m_hEvent(true)
   m_TimeBack      = DVD_NOPTS_VALUE;
   m_TimeFront     = DVD_NOPTS_VALUE;
   m_TimeSize      = 1.0 / 4.0; /* 4 seconds */
+
+  m_ring          = NULL;
+  m_bProducer     = false;
+  m_sequence      = 0;
+  m_listCount     = 0;
+  m_waiting       = 0;
+
+  m_ringPutCount  = m_ringGetCount = m_ringFlushCount = 0;
+  m_ringPutBytes  = m_ringGetBytes = m_ringFlushBytes = 0;
+  m_ringFlushSequence = 0;
 }
 
 CDVDMessageQueue::~CDVDMessageQueue()
 {
   // remove all remaining messages
   Flush();
+  DrainRing();
+  delete m_ring;
 }
 
-void CDVDMessageQueue::Init()
+void CDVDMessageQueue::Init(bool bLockFree)
 {
   m_iDataSize     = 0;
   m_bAbortRequest = false;
@@ -57,6 +86,33 @@ void CDVDMessageQueue::Init()
   m_bInitialized  = true;
   m_TimeBack      = DVD_NOPTS_VALUE;
   m_TimeFront     = DVD_NOPTS_VALUE;
+
+  // neither producer nor consumer are running yet
+  DrainRing();
+  if (bLockFree && !m_ring)
+    m_ring = new XbmcThreads::SPSCRing<DVDMessageRingItem>(MSGQ_RING_SIZE);
+  else if (!bLockFree && m_ring)
+  {
+    delete m_ring;
+    m_ring = NULL;
+  }
+  m_bProducer = false;
+}
+
+void CDVDMessageQueue::DrainRing()
+{
+  if (!m_ring)
+    return;
+
+  DVDMessageRingItem* item;
+  while ((item = m_ring->Front()))
+  {
+    item->message->Release();
+    m_ring->Pop();
+  }
+  m_ringPutCount  = m_ringGetCount = m_ringFlushCount = 0;
+  m_ringPutBytes  = m_ringGetBytes = m_ringFlushBytes = 0;
+  m_ringFlushSequence = m_sequence;
 }
 
 void CDVDMessageQueue::Flush(CDVDMsg::Message type)
@@ -70,9 +126,18 @@ void CDVDMessageQueue::Flush(CDVDMsg::Message type)
     else
       it++;
   }
+  m_listCount = m_list.size();
 
   if (type == CDVDMsg::DEMUXER_PACKET ||  type == CDVDMsg::NONE)
   {
+    if (m_ring)
+    {
+      // the ring only carries demuxer packets, the consumer drops
+      // everything queued before this point when it gets to it
+      m_ringFlushSequence = m_sequence;
+      m_ringFlushCount    = m_ringPutCount;
+      m_ringFlushBytes    = m_ringPutBytes;
+    }
     m_iDataSize = 0;
     m_TimeBack  = DVD_NOPTS_VALUE;
     m_TimeFront = DVD_NOPTS_VALUE;
@@ -94,6 +159,8 @@ void CDVDMessageQueue::End()
   CSingleLock lock(m_section);
 
   Flush();
+  // the consumer thread is stopped at this point
+  DrainRing();
 
   m_bInitialized  = false;
   m_iDataSize     = 0;
@@ -103,6 +170,23 @@ void CDVDMessageQueue::End()
 
 MsgQueueReturnCode CDVDMessageQueue::Put(CDVDMsg* pMsg, int priority)
 {
+  if (m_ring && m_bInitialized && pMsg && priority == 0 && pMsg->IsType(CDVDMsg::DEMUXER_PACKET))
+  {
+    // the first thread that sends packets owns the producer side of the ring,
+    // anything else goes through the list and is ordered by sequence
+    if (!m_bProducer)
+    {
+      CSingleLock lock(m_section);
+      if (!m_bProducer)
+      {
+        m_producer  = CThread::GetCurrentThreadId();
+        m_bProducer = true;
+      }
+    }
+    if (CThread::IsCurrentThread(m_producer) && !m_ring->IsFull())
+      return PutLockFree(pMsg);
+  }
+
   CSingleLock lock(m_section);
 
   if (!m_bInitialized)
@@ -124,7 +208,9 @@ MsgQueueReturnCode CDVDMessageQueue::Put(CDVDMsg* pMsg, int priority)
       break;
     it++;
   }
-  m_list.insert(it, DVDMessageListItem(pMsg, priority));
+  long sequence = AtomicIncrement(&m_sequence);
+  m_list.insert(it, DVDMessageListItem(pMsg, priority, sequence));
+  m_listCount = m_list.size();
 
   if (pMsg->IsType(CDVDMsg::DEMUXER_PACKET) && priority == 0)
   {
@@ -132,12 +218,21 @@ MsgQueueReturnCode CDVDMessageQueue::Put(CDVDMsg* pMsg, int priority)
     if(packet)
     {
       m_iDataSize += packet->iSize;
-      if     (packet->dts != DVD_NOPTS_VALUE)
-        m_TimeFront = packet->dts;
-      else if(packet->pts != DVD_NOPTS_VALUE)
-        m_TimeFront = packet->pts;
-      if(m_TimeBack == DVD_NOPTS_VALUE)
-        m_TimeBack = m_TimeFront;
+      if (m_ring)
+      {
+        // the lock free times have a single writer, packets of other threads don't count
+        if (m_bProducer && CThread::IsCurrentThread(m_producer))
+          SetFrontLockFree(packet, sequence);
+      }
+      else
+      {
+        if     (packet->dts != DVD_NOPTS_VALUE)
+          m_TimeFront = packet->dts;
+        else if(packet->pts != DVD_NOPTS_VALUE)
+          m_TimeFront = packet->pts;
+        if(m_TimeBack == DVD_NOPTS_VALUE)
+          m_TimeBack = m_TimeFront;
+      }
     }
   }
 
@@ -148,13 +243,198 @@ MsgQueueReturnCode CDVDMessageQueue::Put(CDVDMsg* pMsg, int priority)
   return MSGQ_OK;
 }
 
-MsgQueueReturnCode CDVDMessageQueue::Get(CDVDMsg** pMsg, unsigned int iTimeoutInMilliSeconds, int &priority)
+MsgQueueReturnCode CDVDMessageQueue::PutLockFree(CDVDMsg* pMsg)
 {
-  CSingleLock lock(m_section);
+  DVDMessageRingItem item;
+  item.message  = pMsg; // the reference passed in is owned by the ring
+  item.sequence = AtomicIncrement(&m_sequence);
+  item.size     = 0;
 
-  *pMsg = NULL;
+  DemuxPacket* packet = ((CDVDMsgDemuxerPacket*)pMsg)->GetPacket();
+  if(packet)
+  {
+    item.size = packet->iSize;
+    SetFrontLockFree(packet, item.sequence);
+  }
 
-  int ret = 0;
+  // account before publishing so the consumer never gets ahead of us
+  m_ringPutBytes += item.size;
+  m_ringPutCount++;
+
+  m_ring->Push(item); // can't fail, we checked IsFull and only we fill the ring
+
+  if (m_waiting)
+    m_hEvent.Set(); // inform waiter for new packet
+
+  return MSGQ_OK;
+}
+
+DVDMessageRingItem* CDVDMessageQueue::FrontLockFree()
+{
+  DVDMessageRingItem* item;
+  while ((item = m_ring->Front()))
+  {
+    if (SequenceBefore(m_ringFlushSequence, item->sequence))
+      return item;
+
+    // flushed after it was queued
+    m_ringGetBytes += item->size;
+    m_ringGetCount++;
+    item->message->Release();
+    m_ring->Pop();
+  }
+  return NULL;
+}
+
+bool CDVDMessageQueue::PopLockFree(CDVDMsg** pMsg, int &priority)
+{
+  DVDMessageRingItem* item = FrontLockFree();
+
+  if (m_listCount > 0)
+  {
+    CSingleLock lock(m_section);
+    if(!m_list.empty() && m_list.back().priority >= priority && !m_bCaching)
+    {
+      DVDMessageListItem& back(m_list.back());
+      if (back.priority > 0 || !item || SequenceBefore(back.sequence, item->sequence))
+      {
+        priority = back.priority;
+
+        if (back.message->IsType(CDVDMsg::DEMUXER_PACKET) && back.priority == 0)
+        {
+          DemuxPacket* packet = ((CDVDMsgDemuxerPacket*)back.message)->GetPacket();
+          if(packet)
+          {
+            m_iDataSize -= packet->iSize;
+            SetBackLockFree(packet, back.sequence);
+          }
+
+          if(m_bEmptied && GetDataSize() > 0)
+            m_bEmptied = false;
+        }
+
+        *pMsg = back.message->Acquire();
+        m_list.pop_back();
+        m_listCount = m_list.size();
+        return true;
+      }
+    }
+  }
+
+  if (!item || priority > 0 || m_bCaching)
+    return false;
+
+  DemuxPacket* packet = ((CDVDMsgDemuxerPacket*)item->message)->GetPacket();
+  if(packet)
+    SetBackLockFree(packet, item->sequence);
+
+  priority = 0;
+  *pMsg = item->message; // hand over the reference held by the ring
+  m_ringGetBytes += item->size;
+  m_ringGetCount++;
+  m_ring->Pop();
+
+  if(m_bEmptied && GetDataSize() > 0)
+    m_bEmptied = false;
+
+  return true;
+}
+
+void CDVDMessageQueue::WriteTime(DVDMessageTime& slot, double time, long sequence)
+{
+  AtomicIncrement(&slot.lock);
+  slot.time     = time;
+  slot.sequence = sequence;
+  AtomicIncrement(&slot.lock);
+}
+
+void CDVDMessageQueue::ReadTime(const DVDMessageTime& slot, double& time, long& sequence)
+{
+  // the atomics are full barriers, so the copy stays between the two reads of the lock
+  volatile long* lock = const_cast<volatile long*>(&slot.lock);
+  long before;
+  do
+  {
+    before   = cas(lock, 0, 0);
+    time     = slot.time;
+    sequence = slot.sequence;
+  } while ((before & 1) || cas(lock, 0, 0) != before);
+}
+
+// producer thread only
+void CDVDMessageQueue::SetFrontLockFree(DemuxPacket* packet, long sequence)
+{
+  double time;
+  if     (packet->dts != DVD_NOPTS_VALUE)
+    time = packet->dts;
+  else if(packet->pts != DVD_NOPTS_VALUE)
+    time = packet->pts;
+  else
+    return;
+
+  // the first time after a flush is the back until the consumer takes a packet
+  if (!SequenceBefore(m_ringFlushSequence, m_ringFront.sequence))
+    WriteTime(m_ringFirst, time, sequence);
+  WriteTime(m_ringFront, time, sequence);
+}
+
+// consumer thread only
+void CDVDMessageQueue::SetBackLockFree(DemuxPacket* packet, long sequence)
+{
+  if     (packet->dts != DVD_NOPTS_VALUE)
+    WriteTime(m_ringBack, packet->dts, sequence);
+  else if(packet->pts != DVD_NOPTS_VALUE)
+    WriteTime(m_ringBack, packet->pts, sequence);
+}
+
+MsgQueueReturnCode CDVDMessageQueue::GetLockFree(CDVDMsg** pMsg, unsigned int iTimeoutInMilliSeconds, int &priority)
+{
+  if(m_listCount == 0 && !FrontLockFree() && m_bEmptied == false && priority == 0 && m_owner != "teletext")
+  {
+    CLog::Log(LOGWARNING, "CDVDMessageQueue(%s)::Get - asked for new data packet, with nothing available", m_owner.c_str());
+    m_bEmptied = true;
+  }
+
+  int ret = MSGQ_TIMEOUT;
+  int64_t start = CurrentHostCounter();
+  while (!m_bAbortRequest)
+  {
+    if (PopLockFree(pMsg, priority))
+    {
+      ret = MSGQ_OK;
+      break;
+    }
+    //if we keep getting events for lower priority we may never timeout
+    else if (!iTimeoutInMilliSeconds || CurrentHostCounter() - start > CurrentHostFrequency() / 1000 * iTimeoutInMilliSeconds)
+    {
+      ret = MSGQ_TIMEOUT;
+      break;
+    }
+    else
+    {
+      // announce that we are waiting before checking once more, the producer
+      // checks m_waiting after publishing so one of us sees the other
+      m_hEvent.Reset();
+      AtomicIncrement(&m_waiting);
+
+      bool ready = m_listCount > 0 || (priority <= 0 && FrontLockFree()) || m_bAbortRequest;
+      if (!ready && !m_hEvent.WaitMSec(iTimeoutInMilliSeconds))
+      {
+        AtomicDecrement(&m_waiting);
+        return MSGQ_TIMEOUT;
+      }
+      AtomicDecrement(&m_waiting);
+    }
+  }
+
+  if (m_bAbortRequest) return MSGQ_ABORT;
+
+  return (MsgQueueReturnCode)ret;
+}
+
+MsgQueueReturnCode CDVDMessageQueue::Get(CDVDMsg** pMsg, unsigned int iTimeoutInMilliSeconds, int &priority)
+{
+  *pMsg = NULL;
 
   if (!m_bInitialized)
   {
@@ -162,6 +442,13 @@ MsgQueueReturnCode CDVDMessageQueue::Get(CDVDMsg** pMsg, unsigned int iTimeoutIn
     return MSGQ_NOT_INITIALIZED;
   }
 
+  if (m_ring)
+    return GetLockFree(pMsg, iTimeoutInMilliSeconds, priority);
+
+  CSingleLock lock(m_section);
+
+  int ret = 0;
+
   if(m_list.empty() && m_bEmptied == false && priority == 0 && m_owner != "teletext")
   {
     CLog::Log(LOGWARNING, "CDVDMessageQueue(%s)::Get - asked for new data packet, with nothing available", m_owner.c_str());
@@ -194,6 +481,7 @@ MsgQueueReturnCode CDVDMessageQueue::Get(CDVDMsg** pMsg, unsigned int iTimeoutIn
 
       *pMsg = item.message->Acquire();
       m_list.pop_back();
+      m_listCount = m_list.size();
 
       ret = MSGQ_OK;
       break;
@@ -237,9 +525,24 @@ unsigned CDVDMessageQueue::GetPacketCount(CDVDMsg::Message type)
       count++;
   }
 
+  if (m_ring && type == CDVDMsg::DEMUXER_PACKET)
+  {
+    unsigned long put = m_ringPutCount;
+    count += min(RingDistance(m_ringGetCount, put), RingDistance(m_ringFlushCount, put));
+  }
+
   return count;
 }
 
+int CDVDMessageQueue::GetDataSize() const
+{
+  if (!m_ring)
+    return m_iDataSize;
+
+  unsigned long put = m_ringPutBytes;
+  return m_iDataSize + (int)min(RingDistance(m_ringGetBytes, put), RingDistance(m_ringFlushBytes, put));
+}
+
 void CDVDMessageQueue::WaitUntilEmpty()
 {
     CLog::Log(LOGNOTICE, "CDVDMessageQueue(%s)::WaitUntilEmpty", m_owner.c_str());
@@ -251,15 +554,39 @@ void CDVDMessageQueue::WaitUntilEmpty()
 
 int CDVDMessageQueue::GetLevel() const
 {
-  if(m_iDataSize > m_iMaxDataSize)
+  int iDataSize = GetDataSize();
+  if(iDataSize > m_iMaxDataSize)
     return 100;
-  if(m_iDataSize == 0)
+  if(iDataSize == 0)
     return 0;
 
-  if(m_TimeBack  == DVD_NOPTS_VALUE
-  || m_TimeFront == DVD_NOPTS_VALUE
-  || m_TimeFront <= m_TimeBack)
-    return min(100, 100 * m_iDataSize / m_iMaxDataSize);
+  double timeFront, timeBack;
+  if (m_ring)
+  {
+    // times of packets queued before the last flush are gone with them
+    long flushed = m_ringFlushSequence;
+    long frontSequence, firstSequence, backSequence;
+    double timeFirst;
+    ReadTime(m_ringFront, timeFront, frontSequence);
+    ReadTime(m_ringFirst, timeFirst, firstSequence);
+    ReadTime(m_ringBack,  timeBack,  backSequence);
+
+    if (!SequenceBefore(flushed, frontSequence))
+      timeFront = DVD_NOPTS_VALUE;
+    if (!SequenceBefore(flushed, backSequence))
+      timeBack = SequenceBefore(flushed, firstSequence) ? timeFirst : DVD_NOPTS_VALUE;
+  }
+  else
+  {
+    CSingleLock lock(m_section);
+    timeFront = m_TimeFront;
+    timeBack  = m_TimeBack;
+  }
+
+  if(timeBack  == DVD_NOPTS_VALUE
+  || timeFront == DVD_NOPTS_VALUE
+  || timeFront <= timeBack)
+    return min(100, 100 * iDataSize / m_iMaxDataSize);
 
-  return min(100, MathUtils::round_int(100.0 * m_TimeSize * (m_TimeFront - m_TimeBack) / DVD_TIME_BASE ));
+  return min(100, MathUtils::round_int(100.0 * m_TimeSize * (timeFront - timeBack) / DVD_TIME_BASE ));
 }
@@ -26,18 +26,22 @@
 #include <list>
 #include "threads/CriticalSection.h"
 #include "threads/Event.h"
+#include "threads/LockFreeRing.h"
+#include "threads/Thread.h"
 
 struct DVDMessageListItem
 {
-  DVDMessageListItem(CDVDMsg* msg, int prio)
+  DVDMessageListItem(CDVDMsg* msg, int prio, long seq = 0)
   {
     message  = msg->Acquire();
     priority = prio;
+    sequence = seq;
   }
   DVDMessageListItem()
   {
     message  = NULL;
     priority = 0;
+    sequence = 0;
   }
   DVDMessageListItem(const DVDMessageListItem& item)
   {
@@ -46,6 +50,7 @@ struct DVDMessageListItem
     else
       message = NULL;
     priority = item.priority;
+    sequence = item.sequence;
   }
  ~DVDMessageListItem()
   {
@@ -62,11 +67,31 @@ struct DVDMessageListItem
     else
       message = NULL;
     priority = item.priority;
+    sequence = item.sequence;
     return *this;
   }
 
   CDVDMsg* message;
   int      priority;
+  long     sequence;
+};
+
+// demuxer packets passed through the lock free ring, the ring owns one reference
+struct DVDMessageRingItem
+{
+  CDVDMsg* message;
+  long     sequence;
+  int      size;
+};
+
+// a queue time written by one thread and read by any, through a sequence lock
+struct DVDMessageTime
+{
+  DVDMessageTime() : lock(0), time(0.0), sequence(0) {}
+
+  volatile long lock;     // odd while the time is being written
+  double        time;
+  long          sequence; // of the message the time was taken from
 };
 
 enum MsgQueueReturnCode
@@ -87,7 +112,11 @@ public:
   CDVDMessageQueue(const std::string &owner);
   virtual ~CDVDMessageQueue();
 
-  void  Init();
+  /**
+   * bLockFree, pass priority 0 demuxer packets from a single producer
+   *            thread to the single consumer thread through a lock free ring
+   */
+  void  Init(bool bLockFree = false);
   void  Flush(CDVDMsg::Message message = CDVDMsg::DEMUXER_PACKET);
   void  Abort();
   void  End();
@@ -106,7 +135,7 @@ public:
     return Get(pMsg, iTimeoutInMilliSeconds, priority);
   }
 
-  int GetDataSize() const               { return m_iDataSize; }
+  int GetDataSize() const;
   unsigned GetPacketCount(CDVDMsg::Message type);
   bool ReceivedAbortRequest()           { return m_bAbortRequest; }
   void WaitUntilEmpty();
@@ -119,9 +148,20 @@ public:
   void SetMaxTimeSize(double sec)       { m_TimeSize  = 1.0 / std::max(1.0, sec); }
   int GetMaxDataSize() const            { return m_iMaxDataSize; }
   bool IsInited() const                 { return m_bInitialized; }
+  bool IsLockFree() const               { return m_ring != NULL; }
 
 private:
 
+  MsgQueueReturnCode PutLockFree(CDVDMsg* pMsg);
+  MsgQueueReturnCode GetLockFree(CDVDMsg** pMsg, unsigned int iTimeoutInMilliSeconds, int &priority);
+  bool PopLockFree(CDVDMsg** pMsg, int &priority);
+  DVDMessageRingItem* FrontLockFree();
+  void DrainRing();
+  void SetFrontLockFree(DemuxPacket* packet, long sequence);
+  void SetBackLockFree(DemuxPacket* packet, long sequence);
+  static void WriteTime(DVDMessageTime& slot, double time, long sequence);
+  static void ReadTime(const DVDMessageTime& slot, double& time, long& sequence);
+
   CEvent m_hEvent;
   mutable CCriticalSection m_section;
 
@@ -130,7 +170,7 @@ private:
   bool m_bCaching;
 
   int m_iDataSize;
-  double m_TimeFront;
+  double m_TimeFront;             // written under m_section, not used in lock free mode
   double m_TimeBack;
   double m_TimeSize;
 
@@ -140,5 +180,27 @@ private:
 
   typedef std::list<DVDMessageListItem> SList;
   SList m_list;
+
+  // lock free mode, NULL if not enabled
+  XbmcThreads::SPSCRing<DVDMessageRingItem>* m_ring;
+  ThreadIdentifier m_producer;
+  bool m_bProducer;
+
+  volatile long m_sequence;       // orders messages across the ring and the list
+  volatile long m_listCount;      // size of m_list, readable without the lock
+  volatile long m_waiting;        // consumer is about to wait for m_hEvent
+
+  // lock free mode times, front and first are written by the producer, back by
+  // the consumer. Flush doesn't touch them, times of messages queued before the
+  // last flush are ignored instead
+  DVDMessageTime m_ringFront;     // the last packet put
+  DVDMessageTime m_ringFirst;     // the first packet put after a flush
+  DVDMessageTime m_ringBack;      // the last packet taken
+
+  // ring accounting, put counters are written by the producer, get counters
+  // by the consumer and flush counters under m_section
+  volatile unsigned long m_ringPutCount,   m_ringGetCount,   m_ringFlushCount;
+  volatile unsigned long m_ringPutBytes,   m_ringGetBytes,   m_ringFlushBytes;
+  volatile long m_ringFlushSequence;
 };
 
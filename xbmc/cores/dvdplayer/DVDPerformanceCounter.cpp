@@ -115,6 +115,22 @@ HRESULT __stdcall DVDPerformanceCounterMainPerformance(PLARGE_INTEGER numerator,
   return S_OK;
 }
 
+HRESULT __stdcall DVDPerformanceCounterPacketPoolHitRate(PLARGE_INTEGER numerator, PLARGE_INTEGER demoninator)
+{
+  numerator->QuadPart = 0LL;
+  long hits   = g_dvdPerformanceCounter.m_packetPool.hits;
+  long misses = g_dvdPerformanceCounter.m_packetPool.misses;
+  if (hits + misses > 0)
+    numerator->QuadPart = ((__int64)hits * 100) / (hits + misses);
+  return S_OK;
+}
+
+HRESULT __stdcall DVDPerformanceCounterPacketPoolAdopted(PLARGE_INTEGER numerator, PLARGE_INTEGER demoninator)
+{
+  numerator->QuadPart = g_dvdPerformanceCounter.m_packetPool.adopted;
+  return S_OK;
+}
+
 CDVDPerformanceCounter g_dvdPerformanceCounter;
 
 CDVDPerformanceCounter::CDVDPerformanceCounter()
@@ -125,6 +141,7 @@ CDVDPerformanceCounter::CDVDPerformanceCounter()
   memset(&m_videoDecodePerformance, 0, sizeof(m_videoDecodePerformance)); // video decoding
   memset(&m_audioDecodePerformance, 0, sizeof(m_audioDecodePerformance)); // audio decoding + output to audio device
   memset(&m_mainPerformance,        0, sizeof(m_mainPerformance));        // reading files, demuxing, decoding of subtitles + menu overlays
+  memset(&m_packetPool,             0, sizeof(m_packetPool));             // demux packet allocations
 
   Initialize();
 }
@@ -145,6 +162,8 @@ bool CDVDPerformanceCounter::Initialize()
   DmRegisterPerformanceCounter("DVDVideoDecodePerformance",   DMCOUNT_SYNC, DVDPerformanceCounterVideoDecodePerformance);
   DmRegisterPerformanceCounter("DVDAudioDecodePerformance",   DMCOUNT_SYNC, DVDPerformanceCounterAudioDecodePerformance);
   DmRegisterPerformanceCounter("DVDMainPerformance",          DMCOUNT_SYNC, DVDPerformanceCounterMainPerformance);
+  DmRegisterPerformanceCounter("DVDPacketPoolHitRate",        DMCOUNT_SYNC, DVDPerformanceCounterPacketPoolHitRate);
+  DmRegisterPerformanceCounter("DVDPacketPoolAdopted",        DMCOUNT_SYNC, DVDPerformanceCounterPacketPoolAdopted);
 
 #endif
 
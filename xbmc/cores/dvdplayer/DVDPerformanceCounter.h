@@ -36,6 +36,14 @@ typedef struct stProcessPerformance
   CThread*        hThread;
 } ProcessPerformance;
 
+typedef struct stPacketPoolPerformance
+{
+  long            hits;      // packets served from the pool
+  long            misses;    // packets that needed a fresh heap allocation
+  long            adopted;   // packets that took over the demuxer buffer without a copy
+  long            cached;    // bytes of payload currently kept for reuse
+} PacketPoolPerformance;
+
 class CDVDPerformanceCounter
 {
 public:
@@ -67,6 +75,8 @@ public:
   ProcessPerformance        m_audioDecodePerformance;
   ProcessPerformance        m_mainPerformance;
 
+  PacketPoolPerformance     m_packetPool;
+
 private:
   CCriticalSection m_critSection;
 };
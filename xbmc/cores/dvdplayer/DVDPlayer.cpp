@@ -2043,6 +2043,9 @@ void CDVDPlayer::OnExit()
 
     m_messenger.End();
 
+    // don't keep packet buffers around while nothing is playing
+    CDVDDemuxUtils::FlushPacketPool();
+
   }
   catch (...)
   {
@@ -26,6 +26,7 @@
 #include "DVDCodecs/DVDCodecs.h"
 #include "DVDCodecs/DVDFactoryCodec.h"
 #include "DVDPerformanceCounter.h"
+#include "settings/AdvancedSettings.h"
 #include "settings/GUISettings.h"
 #include "video/VideoReferenceClock.h"
 #include "utils/log.h"
@@ -194,7 +195,7 @@ bool CDVDPlayerAudio::OpenStream( CDVDStreamInfo &hints )
   else
   {
     OpenStream(hints, codec);
-    m_messageQueue.Init();
+    m_messageQueue.Init(g_advancedSettings.m_videoLockFreeQueues);
     CLog::Log(LOGNOTICE, "Creating audio thread");
     Create();
   }
@@ -20,6 +20,7 @@
  */
 
 #include "DVDPlayerTeletext.h"
+#include "settings/AdvancedSettings.h"
 #include "settings/Settings.h"
 #include "DVDPlayer.h"
 #include "DVDStreamInfo.h"
@@ -126,7 +127,7 @@ bool CDVDTeletextData::CheckStream(CDVDStreamInfo &hints)
 
 bool CDVDTeletextData::OpenStream(CDVDStreamInfo &hints)
 {
-  m_messageQueue.Init();
+  m_messageQueue.Init(g_advancedSettings.m_videoLockFreeQueues);
 
 #if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(52,38,1)
   if (hints.codec == CODEC_ID_DVB_TELETEXT)
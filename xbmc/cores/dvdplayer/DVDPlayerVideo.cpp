@@ -218,7 +218,7 @@ bool CDVDPlayerVideo::OpenStream( CDVDStreamInfo &hint )
   {
     OpenStream(hint, codec);
     CLog::Log(LOGNOTICE, "Creating video thread");
-    m_messageQueue.Init();
+    m_messageQueue.Init(g_advancedSettings.m_videoLockFreeQueues);
     Create();
   }
   return true;
@@ -0,0 +1,253 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "cores/dvdplayer/DVDMessageQueue.h"
+#include "cores/dvdplayer/DVDDemuxers/DVDDemuxUtils.h"
+#include "cores/dvdplayer/DVDClock.h"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread/thread.hpp>
+#include <stdio.h>
+
+#define NUMPACKETS 200000l
+#define PACKETSIZE 16
+
+//=============================================================================
+// Helpers
+//=============================================================================
+
+// a packet of PACKETSIZE bytes stamped with time seconds
+static CDVDMsgDemuxerPacket* NewPacket(double seconds)
+{
+  DemuxPacket* packet = CDVDDemuxUtils::AllocateDemuxPacket(PACKETSIZE);
+  packet->iSize = PACKETSIZE;
+  packet->dts   = seconds * DVD_TIME_BASE;
+  return new CDVDMsgDemuxerPacket(packet);
+}
+
+// dts in seconds of a message taken from the queue, -1 for anything else
+static double TakeTime(CDVDMessageQueue& queue)
+{
+  CDVDMsg* msg;
+  if (queue.Get(&msg, 0) != MSGQ_OK)
+    return -1;
+  double seconds = -1;
+  if (msg->IsType(CDVDMsg::DEMUXER_PACKET))
+    seconds = ((CDVDMsgDemuxerPacket*)msg)->GetPacket()->dts / DVD_TIME_BASE;
+  msg->Release();
+  return seconds;
+}
+
+// feeds packets one millisecond apart the way the demux thread does, waiting while full
+class producer
+{
+  CDVDMessageQueue& queue;
+public:
+  producer(CDVDMessageQueue& o) : queue(o) {}
+
+  void operator()()
+  {
+    for (long i = 0; i < NUMPACKETS; i++)
+    {
+      while (queue.IsFull())
+        boost::thread::yield();
+      queue.Put(NewPacket(i / 1000.0));
+    }
+  }
+};
+
+class consumer
+{
+  CDVDMessageQueue& queue;
+public:
+  long received;
+  bool inorder;
+
+  consumer(CDVDMessageQueue& o) : queue(o), received(0), inorder(true) {}
+
+  void operator()()
+  {
+    CDVDMsg* msg;
+    while (received < NUMPACKETS && queue.Get(&msg, 5000) == MSGQ_OK)
+    {
+      DemuxPacket* packet = ((CDVDMsgDemuxerPacket*)msg)->GetPacket();
+      if (packet->dts != received / 1000.0 * DVD_TIME_BASE)
+        inorder = false;
+      msg->Release();
+      received++;
+    }
+  }
+};
+
+static double ElapsedMicroseconds(const boost::posix_time::ptime& start)
+{
+  return (double)(boost::posix_time::microsec_clock::universal_time() - start).total_microseconds();
+}
+
+// uncontended cost of one Put followed by one Get on the same thread
+static double MeasureLatency(bool bLockFree)
+{
+  CDVDMessageQueue queue("test");
+  queue.Init(bLockFree);
+  queue.SetMaxDataSize(NUMPACKETS * PACKETSIZE);
+
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+  for (long i = 0; i < NUMPACKETS; i++)
+  {
+    queue.Put(NewPacket(i / 1000.0));
+    queue.GetLevel();
+    TakeTime(queue);
+  }
+  return ElapsedMicroseconds(start) * 1000.0 / NUMPACKETS;
+}
+
+// packets per second from a demux thread to a decoder thread
+static double MeasureThroughput(bool bLockFree, bool& ok)
+{
+  CDVDMessageQueue queue("test");
+  queue.Init(bLockFree);
+  queue.SetMaxDataSize(NUMPACKETS * PACKETSIZE);
+  queue.SetMaxTimeSize(1.0);
+
+  producer p(queue);
+  consumer c(queue);
+
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+  boost::thread ct(boost::ref(c));
+  boost::thread pt(boost::ref(p));
+  pt.join();
+  ct.join();
+  double elapsed = ElapsedMicroseconds(start);
+
+  ok = c.received == NUMPACKETS && c.inorder;
+  return elapsed > 0 ? NUMPACKETS * 1000000.0 / elapsed : 0;
+}
+
+//=============================================================================
+
+BOOST_AUTO_TEST_CASE(TestQueueOrder)
+{
+  for (int lockfree = 0; lockfree < 2; lockfree++)
+  {
+    CDVDMessageQueue queue("test");
+    queue.Init(lockfree != 0);
+    BOOST_CHECK_EQUAL(lockfree != 0, queue.IsLockFree());
+
+    for (int i = 0; i < 10; i++)
+      queue.Put(NewPacket(i));
+    BOOST_CHECK_EQUAL(10 * PACKETSIZE, queue.GetDataSize());
+
+    // priority messages pass the packets, packets keep their order
+    queue.Put(new CDVDMsg(CDVDMsg::GENERAL_RESET), 1);
+    BOOST_CHECK_EQUAL(-1, TakeTime(queue));
+    for (int i = 0; i < 10; i++)
+      BOOST_CHECK_EQUAL(i, TakeTime(queue));
+    BOOST_CHECK_EQUAL(0, queue.GetDataSize());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(TestQueueFlush)
+{
+  for (int lockfree = 0; lockfree < 2; lockfree++)
+  {
+    CDVDMessageQueue queue("test");
+    queue.Init(lockfree != 0);
+
+    queue.SetMaxDataSize(100 * PACKETSIZE);
+
+    for (int i = 0; i < 10; i++)
+      queue.Put(NewPacket(i));
+    queue.Flush();
+    BOOST_CHECK_EQUAL(0, queue.GetDataSize());
+    BOOST_CHECK_EQUAL(0, queue.GetLevel());
+
+    CDVDMsg* msg;
+    BOOST_CHECK_EQUAL(MSGQ_TIMEOUT, queue.Get(&msg, 0));
+
+    queue.Put(NewPacket(20));
+    BOOST_CHECK_EQUAL(PACKETSIZE, queue.GetDataSize());
+    BOOST_CHECK_EQUAL(20, TakeTime(queue));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(TestQueueLevel)
+{
+  for (int lockfree = 0; lockfree < 2; lockfree++)
+  {
+    CDVDMessageQueue queue("test");
+    queue.Init(lockfree != 0);
+    queue.SetMaxDataSize(100 * PACKETSIZE);
+    queue.SetMaxTimeSize(8.0);
+
+    // with nothing taken the level spans from the first packet put to the last
+    for (int i = 0; i <= 4; i++)
+      queue.Put(NewPacket(i));
+    BOOST_CHECK_EQUAL(50, queue.GetLevel());
+
+    // then from the last packet taken
+    for (int i = 0; i <= 2; i++)
+      TakeTime(queue);
+    BOOST_CHECK_EQUAL(25, queue.GetLevel());
+
+    // the times of flushed packets are forgotten, the first packet after the
+    // flush starts the span again
+    queue.Flush();
+    BOOST_CHECK_EQUAL(0, queue.GetLevel());
+    queue.Put(NewPacket(10));
+    queue.Put(NewPacket(12));
+    BOOST_CHECK_EQUAL(25, queue.GetLevel());
+
+    // without times the level falls back to the data size
+    queue.Flush();
+    DemuxPacket* packet = CDVDDemuxUtils::AllocateDemuxPacket(PACKETSIZE);
+    packet->iSize = PACKETSIZE;
+    queue.Put(new CDVDMsgDemuxerPacket(packet));
+    BOOST_CHECK_EQUAL(1, queue.GetLevel());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(TestQueueProducerConsumer)
+{
+  for (int lockfree = 0; lockfree < 2; lockfree++)
+  {
+    bool ok = false;
+    MeasureThroughput(lockfree != 0, ok);
+    BOOST_CHECK(ok);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(BenchmarkQueueLockedVersusLockFree)
+{
+  bool lockedOk = false, ringOk = false;
+
+  double lockedLatency    = MeasureLatency(false);
+  double ringLatency      = MeasureLatency(true);
+  double lockedThroughput = MeasureThroughput(false, lockedOk);
+  double ringThroughput   = MeasureThroughput(true, ringOk);
+
+  BOOST_CHECK(lockedOk);
+  BOOST_CHECK(ringOk);
+
+  printf("Put/GetLevel/Get latency:  locked %8.1f ns   lock free %8.1f ns\n", lockedLatency, ringLatency);
+  printf("SPSC throughput:           locked %8.0f /s   lock free %8.0f /s\n", lockedThroughput, ringThroughput);
+}
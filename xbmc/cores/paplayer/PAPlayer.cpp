@@ -34,6 +34,7 @@
 #include "utils/TimeUtils.h"
 #include "utils/log.h"
 #include "utils/MathUtils.h"
+#include "utils/CPUInfo.h"
 
 #ifdef _LINUX
 #define XBMC_SAMPLE_RATE 44100
@@ -78,6 +79,11 @@ PAPlayer::PAPlayer(IPlayerCallback& callback) : CThread("PAPlayer"), IPlayer(cal
     m_pcmBuffer[i] = NULL;
     m_bufferPos[i] = 0;
     m_Chunklen[i]  = PACKET_SIZE;
+
+    // filter the channels on their own core
+    m_resampler[i].SetQuality((Cssrc::Quality)g_advancedSettings.m_musicResampleQuality);
+    m_resampler[i].SetVectorized(true, g_cpuInfo.GetCPUFeatures());
+    m_resampler[i].SetThreads(g_cpuInfo.getCPUCount());
   }
 
   m_currentStream = 0;
@@ -47,6 +47,7 @@ class Dataset;		// forward declaration of class Dataset
 #define S_NO_CONNECTION "No active connection";
 
 #define DB_BUFF_MAX           8*1024    // Maximum buffer's capacity
+#define DB_STREAM_BATCH       256       // Rows fetched at once by a streaming query
 
 #define DB_CONNECTION_NONE	0
 #define DB_CONNECTION_OK	1
@@ -291,6 +292,11 @@ public:
   virtual const void* getExecRes()=0;
 /* as open, but with our query exept Sql */
   virtual bool query(const char *sql) = 0;
+/* as query, but forward only: rows are fetched DB_STREAM_BATCH at a time while moving
+   through the dataset with next() instead of all at once. num_rows() only counts the
+   rows of the current batch, use eof() to check for an empty result. prev(), last()
+   and seek() are not available */
+  virtual bool query_streaming(const char *sql) { return query(sql); }
 /* Close SQL Query*/
   virtual void close();
 /* This function looks for field Field_name with value equal Field_value
@@ -374,6 +380,11 @@ public:
 /* Alias to get_field_value */
   const field_value fv(const char *f) { return get_field_value(f); }
   const field_value fv(int index) { return get_field_value(index); }
+/* Zero copy access to a field of the current record in Select state, strings
+   point into the result set and stay valid until the dataset is closed. After
+   query_streaming() only the current batch is held, so they are only valid until
+   next() fetches the next batch, copy them (e.g. with get_field_value) to keep them */
+  virtual field_view get_field_view(int index) = 0;
 
 /* ------------ for transaction ------------------- */
   void set_autocommit(bool v) { autocommit = v; }
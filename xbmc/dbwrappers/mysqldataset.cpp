@@ -22,6 +22,7 @@
 #include <iostream>
 #include <string>
 #include <set>
+#include <limits.h>
 
 #include "mysqldataset.h"
 #include "utils/log.h"
@@ -1160,6 +1161,8 @@ char *MysqlDatabase::mysql_vmprintf(const char *zFormat, va_list ap) {
 
 MysqlDataset::MysqlDataset():Dataset() {
   haveError = false;
+  stream = NULL;
+  streaming = false;
   db = NULL;
   errmsg = NULL;
   autorefresh = false;
@@ -1168,12 +1171,15 @@ MysqlDataset::MysqlDataset():Dataset() {
 
 MysqlDataset::MysqlDataset(MysqlDatabase *newDb):Dataset(newDb) {
   haveError = false;
+  stream = NULL;
+  streaming = false;
   db = newDb;
   errmsg = NULL;
   autorefresh = false;
 }
 
 MysqlDataset::~MysqlDataset() {
+   if (stream) mysql_free_result(stream);
    if (errmsg) free(errmsg);
  }
 
@@ -1243,31 +1249,24 @@ void MysqlDataset::make_deletion() {
 }
 
 void MysqlDataset::fill_fields() {
-  if ((db == NULL) || (result.record_header.size() == 0) || (result.records.size() < (unsigned int)frecno)) return;
+  if ((db == NULL) || (result.record_header.size() == 0) || (result.num_rows() < (unsigned int)frecno)) return;
 
+  const unsigned int ncols = result.record_header.size();
   if (fields_object->size() == 0) // Filling columns name
   {
-    const unsigned int ncols = result.record_header.size();
     fields_object->resize(ncols);
     for (unsigned int i = 0; i < ncols; i++)
       (*fields_object)[i].props = result.record_header[i];
   }
 
   //Filling result
-  if (result.records.size() != 0)
+  fields_object->resize(ncols);
+  if (frecno >= 0 && (unsigned int)frecno < result.num_rows())
   {
-    const sql_record *row = result.records[frecno];
-    if (row)
-    {
-      const unsigned int ncols = row->size();
-      fields_object->resize(ncols);
-      for (unsigned int i = 0; i < ncols; i++)
-        (*fields_object)[i].val = row->at(i);
-      return;
-    }
+    for (unsigned int i = 0; i < ncols; i++)
+      result.get_value(frecno, i, (*fields_object)[i].val);
+    return;
   }
-  const unsigned int ncols = result.record_header.size();
-  fields_object->resize(ncols);
   for (unsigned int i = 0; i < ncols; i++)
     (*fields_object)[i].val = "";
 }
@@ -1353,6 +1352,14 @@ const void* MysqlDataset::getExecRes() {
 
 
 bool MysqlDataset::query(const char *query) {
+  return run_query(query, false);
+}
+
+bool MysqlDataset::query_streaming(const char *query) {
+  return run_query(query, true);
+}
+
+bool MysqlDataset::run_query(const char *query, bool batched) {
   if(!handle()) throw DbErrors("No Database Connection");
   std::string qry = query;
   int fs = qry.find("select");
@@ -1367,25 +1374,50 @@ bool MysqlDataset::query(const char *query) {
   if ( static_cast<MysqlDatabase*>(db)->setErr(static_cast<MysqlDatabase*>(db)->query_with_reconnect(query), query) != MYSQL_OK )
     throw DbErrors(db->getErrorMsg());
 
+  // a streaming query leaves the rows on the server until they are fetched,
+  // the connection can't run other queries until the result is freed
   MYSQL* conn = handle();
-  stmt = mysql_store_result(conn);
+  stmt = batched ? mysql_use_result(conn) : mysql_store_result(conn);
 
   // column headers
   const unsigned int numColumns = mysql_num_fields(stmt);
   MYSQL_FIELD *fields = mysql_fetch_fields(stmt);
-  MYSQL_ROW row;
-  result.record_header.resize(numColumns);
+  result.set_columns(numColumns);
   for (unsigned int i = 0; i < numColumns; i++)
     result.record_header[i].name = fields[i].name;
 
-  // returned rows
-  while ((row = mysql_fetch_row(stmt)))
-  { // have a row of data
-    sql_record *res = new sql_record;
-    res->resize(numColumns);
+  // returned rows, the result is kept when there may be more
+  if (batched)
+  {
+    streaming = true;
+    if (fetch_rows(stmt, DB_STREAM_BATCH))
+      stream = stmt;
+  }
+  else
+    fetch_rows(stmt, UINT_MAX);
+
+  if (!stream)
+    mysql_free_result(stmt);
+  active = true;
+  ds_state = dsSelect;
+  this->first();
+  return true;
+}
+
+bool MysqlDataset::fetch_rows(MYSQL_RES *stmt, unsigned int max) {
+  const unsigned int numColumns = result.num_columns();
+  MYSQL_FIELD *fields = mysql_fetch_fields(stmt);
+  MYSQL_ROW row;
+  for (unsigned int n = 0; n < max; n++)
+  {
+    if (!(row = mysql_fetch_row(stmt)))
+      return false;
+
+    // have a row of data
+    unsigned long *lengths = mysql_fetch_lengths(stmt);
+    result.add_row();
     for (unsigned int i = 0; i < numColumns; i++)
     {
-      field_value &v = res->at(i);
       switch (fields[i].type)
       {
         case MYSQL_TYPE_LONGLONG:
@@ -1397,52 +1429,61 @@ bool MysqlDataset::query(const char *query) {
         case MYSQL_TYPE_LONG:
           if (row[i] != NULL)
           {
-            v.set_asInt(atoi(row[i]));
+            result.set_int(i, atoi(row[i]));
           }
           else
           {
-            v.set_asInt(0);
+            result.set_int(i, 0);
           }
           break;
         case MYSQL_TYPE_FLOAT:
         case MYSQL_TYPE_DOUBLE:
           if (row[i] != NULL)
           {
-            v.set_asDouble(atof(row[i]));
+            result.set_double(i, atof(row[i]));
           }
           else
           {
-            v.set_asDouble(0);
+            result.set_double(i, 0);
           }
           break;
         case MYSQL_TYPE_STRING:
         case MYSQL_TYPE_VAR_STRING:
         case MYSQL_TYPE_VARCHAR:
-          if (row[i] != NULL) v.set_asString((const char *)row[i] );
-          break;
         case MYSQL_TYPE_TINY_BLOB:
         case MYSQL_TYPE_MEDIUM_BLOB:
         case MYSQL_TYPE_LONG_BLOB:
         case MYSQL_TYPE_BLOB:
-          if (row[i] != NULL) v.set_asString((const char *)row[i]);
+          if (row[i] != NULL)
+            result.set_string(i, (const char *)row[i], lengths[i]);
+          else
+            result.set_string(i, "", 0);
           break;
         case MYSQL_TYPE_NULL:
         default:
           CLog::Log(LOGDEBUG,"MYSQL: Unknown field type: %u", fields[i].type);
-          v.set_asString("");
-          v.set_isNull();
-          break;
+          break; // fields are NULL unless set
       }
     }
-    result.records.push_back(res);
   }
-  mysql_free_result(stmt);
-  active = true;
-  ds_state = dsSelect;
-  this->first();
   return true;
 }
 
+bool MysqlDataset::fetch_batch() {
+  if (!stream)
+    return false;
+
+  result.clear_rows();
+  frecno = 0;
+  if (fetch_rows(stream, DB_STREAM_BATCH))
+    return true;
+
+  // no more rows, the result is freed once all rows were read
+  mysql_free_result(stream);
+  stream = NULL;
+  return result.num_rows() > 0;
+}
+
 bool MysqlDataset::query(const string &q) {
   return query(q.c_str());
 }
@@ -1465,6 +1506,12 @@ void MysqlDataset::open() {
 
 void MysqlDataset::close() {
   Dataset::close();
+  if (stream)
+  {
+    mysql_free_result(stream); // discards the rows that were not fetched
+    stream = NULL;
+  }
+  streaming = false;
   result.clear();
   edit_object->clear();
   fields_object->clear();
@@ -1485,7 +1532,16 @@ void MysqlDataset::cancel() {
 
 
 int MysqlDataset::num_rows() {
-  return result.records.size();
+  return result.num_rows();
+}
+
+field_view MysqlDataset::get_field_view(int index) {
+  if (ds_state != dsSelect)
+    throw DbErrors("Dataset is not in Select state");
+  if (index < 0 || (unsigned int)index >= result.num_columns() ||
+      frecno < 0 || (unsigned int)frecno >= result.num_rows())
+    throw DbErrors("Field index not found: %d",index);
+  return result.get_view(frecno, index);
 }
 
 
@@ -1505,35 +1561,31 @@ void MysqlDataset::first() {
 }
 
 void MysqlDataset::last() {
+  if (streaming) throw DbErrors("last() is not available for a streaming query");
   Dataset::last();
   fill_fields();
 }
 
 void MysqlDataset::prev(void) {
+  if (streaming) throw DbErrors("prev() is not available for a streaming query");
   Dataset::prev();
   fill_fields();
 }
 
 void MysqlDataset::next(void) {
+  if (streaming && ds_state == dsSelect && frecno >= num_rows() - 1 && fetch_batch())
+  { // continue with the first row of the next batch
+    fbof = feof = false;
+    fill_fields();
+    return;
+  }
   Dataset::next();
   if (!eof())
       fill_fields();
 }
 
-void MysqlDataset::free_row(void)
-{
-  if (frecno < 0 || (unsigned int)frecno >= result.records.size())
-    return;
-
-  sql_record *row = result.records[frecno];
-  if (row)
-  {
-    delete row;
-    result.records[frecno] = NULL;
-  }
-}
-
 bool MysqlDataset::seek(int pos) {
+  if (streaming) throw DbErrors("seek() is not available for a streaming query");
   if (ds_state == dsSelect)
   {
     Dataset::seek(pos);
@@ -743,4 +743,166 @@ string field_value::gft() {
   return tmp;
   }
 
+
+//************* string_heap implementation ***************
+
+const char *string_heap::add(const char *s, unsigned int len) {
+  // each string is prefixed by its length, aligned for reading it back
+  unsigned int need = sizeof(uint32_t) + len + 1;
+  unsigned int start = (used + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+  if (start + need > block_size || blocks.empty()) {
+    unsigned int alloc = need > block_size ? need : block_size;
+    blocks.push_back(new char[alloc]);
+    allocated += alloc;
+    start = 0;
+    // an oversized string gets a block of its own, the next string starts a new one
+    used = need > block_size ? block_size : 0;
+  }
+  char *block = blocks.back();
+  *(uint32_t*)(block + start) = len;
+  char *str = block + start + sizeof(uint32_t);
+  memcpy(str, s, len);
+  str[len] = 0;
+  if (used != block_size)
+    used = start + need;
+  return str;
+}
+
+void string_heap::clear() {
+  for (unsigned int i = 0; i < blocks.size(); i++)
+    delete[] blocks[i];
+  blocks.clear();
+  used = block_size;
+  allocated = 0;
+}
+
+//************* result_set implementation ***************
+
+void result_set::clear() {
+  columns.clear();
+  record_header.clear();
+  heap.clear();
+  rows = 0;
+}
+
+void result_set::clear_rows() {
+  for (unsigned int i = 0; i < columns.size(); i++) {
+    columns[i].values.clear();
+    columns[i].types.clear();
+  }
+  heap.clear();
+  rows = 0;
+}
+
+void result_set::set_columns(unsigned int ncols) {
+  record_header.resize(ncols);
+  columns.resize(ncols);
+}
+
+void result_set::add_row() {
+  cell empty;
+  empty.int64_value = 0;
+  for (unsigned int i = 0; i < columns.size(); i++) {
+    columns[i].values.push_back(empty);
+    columns[i].types.push_back(ft_String | null_flag);
+  }
+  rows++;
+}
+
+void result_set::set_null(unsigned int col) {
+  columns[col].types.back() = ft_String | null_flag;
+}
+
+void result_set::set_string(unsigned int col, const char *s, unsigned int len) {
+  columns[col].values.back().str = heap.add(s, len);
+  columns[col].types.back() = ft_String;
+}
+
+void result_set::set_int(unsigned int col, int i) {
+  columns[col].values.back().int64_value = i;
+  columns[col].types.back() = ft_Int;
+}
+
+void result_set::set_int64(unsigned int col, int64_t i) {
+  columns[col].values.back().int64_value = i;
+  columns[col].types.back() = ft_Int64;
+}
+
+void result_set::set_double(unsigned int col, double d) {
+  columns[col].values.back().double_value = d;
+  columns[col].types.back() = ft_Double;
+}
+
+field_view result_set::get_view(unsigned int row, unsigned int col) const {
+  const column &c = columns[col];
+  const cell &v = c.values[row];
+  field_view view;
+  view.type = (fType)(c.types[row] & ~null_flag);
+  view.is_null = (c.types[row] & null_flag) != 0;
+  view.str = "";
+  view.len = 0;
+  view.int64_value = 0;
+  if (view.is_null)
+    return view;
+  switch (view.type) {
+    case ft_String:
+      view.str = v.str;
+      view.len = string_heap::length(v.str);
+      break;
+    case ft_Int:
+      view.int_value = (int)v.int64_value;
+      break;
+    case ft_Int64:
+      view.int64_value = v.int64_value;
+      break;
+    case ft_Double:
+      view.double_value = v.double_value;
+      break;
+    default:
+      break;
+  }
+  return view;
+}
+
+void result_set::get_value(unsigned int row, unsigned int col, field_value &value) const {
+  const column &c = columns[col];
+  const cell &v = c.values[row];
+  unsigned char type = c.types[row];
+  if (type & null_flag) {
+    value.set_asString("");
+    value.set_isNull();
+    return;
+  }
+  switch (type) {
+    case ft_String:
+      value.set_asString(v.str);
+      break;
+    case ft_Int:
+      value.set_asInt((int)v.int64_value);
+      break;
+    case ft_Int64:
+      value.set_asInt64(v.int64_value);
+      break;
+    case ft_Double:
+      value.set_asDouble(v.double_value);
+      break;
+    default:
+      break;
+  }
+  value.set_isNull(false);
+}
+
+field_value result_set::get_value(unsigned int row, unsigned int col) const {
+  field_value value;
+  get_value(row, col, value);
+  return value;
+}
+
+size_t result_set::memory_usage() const {
+  size_t bytes = heap.size();
+  for (unsigned int i = 0; i < columns.size(); i++)
+    bytes += columns[i].values.capacity() * sizeof(cell) + columns[i].types.capacity();
+  return bytes;
+}
+
 } //namespace 
@@ -34,6 +34,7 @@
 #include <iostream>
 #include <string>
 #include <stdint.h>
+#include <string.h>
 
 namespace dbiplus {
 
@@ -175,7 +176,7 @@ public:
   }
   }
 
-  void set_isNull(){is_null=true;}
+  void set_isNull(bool null = true){is_null=null;}
   void set_asString(const char *s);
   void set_asString(const std::string & s);
   void set_asBool(const bool b);
@@ -219,27 +220,105 @@ typedef sql_record::iterator rec_itor;
 typedef record_prop::iterator recprop_itor;
 typedef query_data::iterator qry_itor;
 
+/* A field of a result set referenced in place. Strings point into the string
+   heap of the result set and stay valid until the result set is cleared. */
+struct field_view {
+  fType type;
+  bool is_null;
+  const char *str;     // ft_String only, never NULL
+  unsigned int len;
+  union {
+    int   int_value;   // ft_Int
+    int64_t int64_value; // ft_Int64
+    double double_value; // ft_Double
+  };
+};
+
+/* Append only storage for the strings of a result set. Strings are stored
+   NUL terminated in large blocks and never move once added. */
+class string_heap
+{
+public:
+  string_heap() : used(block_size), allocated(0) {};
+  ~string_heap() { clear(); };
+
+  const char *add(const char *s, unsigned int len);
+  static unsigned int length(const char *s) { return ((const uint32_t*)s)[-1]; };
+  void clear();
+  size_t size() const { return allocated; };
+
+private:
+  string_heap(const string_heap&);
+  string_heap& operator=(const string_heap&);
+
+  static const unsigned int block_size = 64 * 1024;
+  std::vector<char*> blocks;
+  unsigned int used;   // bytes used of the last block
+  size_t allocated;
+};
+
+/* Rows of a query stored by column. Every column is a vector of fixed width
+   values plus a vector of their types, strings live in one shared heap. */
 class result_set
 {
 public:
-  result_set()
+  result_set() : rows(0)
   {
   };
   ~result_set()
   {
     clear();
   };
-  void clear()
-  {
-    for (unsigned int i = 0; i < records.size(); i++)
-      if (records[i])
-        delete records[i];
-    records.clear();
-    record_header.clear();
-  };
+  void clear();
+/* drop the rows but keep the columns, for fetching the next batch of a streaming query */
+  void clear_rows();
+
+/* set up the columns, must be called before the first row is added */
+  void set_columns(unsigned int ncols);
+  unsigned int num_columns() const { return columns.size(); };
+  unsigned int num_rows() const { return rows; };
+
+/* append a row, its fields are NULL until set */
+  void add_row();
+/* set a field of the last row */
+  void set_null(unsigned int col);
+  void set_string(unsigned int col, const char *s, unsigned int len);
+  void set_string(unsigned int col, const char *s) { set_string(col, s, strlen(s)); };
+  void set_int(unsigned int col, int i);
+  void set_int64(unsigned int col, int64_t i);
+  void set_double(unsigned int col, double d);
+
+/* zero copy access to a field */
+  field_view get_view(unsigned int row, unsigned int col) const;
+/* copy a field into a field_value, reusing its string buffer */
+  void get_value(unsigned int row, unsigned int col, field_value &value) const;
+  field_value get_value(unsigned int row, unsigned int col) const;
+
+/* bytes allocated for the rows */
+  size_t memory_usage() const;
 
   record_prop record_header;
-  query_data records;
+
+private:
+  result_set(const result_set&);
+  result_set& operator=(const result_set&);
+
+  static const unsigned char null_flag = 0x80;
+
+  union cell {
+    int64_t int64_value; // ft_Int and ft_Int64
+    double double_value;
+    const char *str;
+  };
+
+  struct column {
+    std::vector<cell> values;
+    std::vector<unsigned char> types; // fType, or'ed with null_flag
+  };
+
+  std::vector<column> columns;
+  string_heap heap;
+  unsigned int rows;
 };
 
 } // namespace
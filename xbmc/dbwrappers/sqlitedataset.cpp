@@ -28,6 +28,7 @@
 
 #include <iostream>
 #include <string>
+#include <limits.h>
 
 #include "sqlitedataset.h"
 #include "utils/log.h"
@@ -49,32 +50,19 @@ int callback(void* res_ptr,int ncol, char** reslt,char** cols)
 
   if (!r->record_header.size())
   {
-    r->record_header.reserve(ncol);
-    for (int i=0; i < ncol; i++) {
-      field_prop header;
-      header.name = cols[i];
-      r->record_header.push_back(header);
-    }
+    r->set_columns(ncol);
+    for (int i=0; i < ncol; i++)
+      r->record_header[i].name = cols[i];
   }
 
   if (reslt != NULL)
   {
-    sql_record *rec = new sql_record;
-    rec->resize(ncol);
+    r->add_row();
     for (int i=0; i<ncol; i++)
-    { 
-      field_value &v = rec->at(i);
-      if (reslt[i] == NULL)
-      {
-        v.set_asString("");
-        v.set_isNull();
-      }
-      else
-      {
-        v.set_asString(reslt[i]);
-      }
+    { // fields are NULL unless set
+      if (reslt[i] != NULL)
+        r->set_string(i, reslt[i]);
     }
-    r->records.push_back(rec);
   }
   return 0;  
 }
@@ -252,7 +240,7 @@ bool SqliteDatabase::exists(void)
   sprintf(sqlcmd,"SELECT * FROM sqlite_master");
   if ((last_err = sqlite3_exec(getHandle(),sqlcmd, &callback, &res,NULL)) == SQLITE_OK)
   {
-    bRet = (res.records.size() > 0);
+    bRet = (res.num_rows() > 0);
   }
 
   return bRet;
@@ -333,14 +321,14 @@ long SqliteDatabase::nextid(const char* sname) {
   if ((last_err = sqlite3_exec(getHandle(),sqlcmd,&callback,&res,NULL)) != SQLITE_OK) {
     return DB_UNEXPECTED_RESULT;
     }
-  if (res.records.size() == 0) {
+  if (res.num_rows() == 0) {
     id = 1;
     sprintf(sqlcmd,"insert into %s (nextid,seq_name) values (%d,'%s')",sequence_table.c_str(),id,sname);
     if ((last_err = sqlite3_exec(conn,sqlcmd,NULL,NULL,NULL)) != SQLITE_OK) return DB_UNEXPECTED_RESULT;
     return id;
   }
   else {
-    id = res.records[0]->at(0).get_asInt()+1;
+    id = res.get_value(0, 0).get_asInt()+1;
     sprintf(sqlcmd,"update %s set nextid=%d where seq_name = '%s'",sequence_table.c_str(),id,sname);
     if ((last_err = sqlite3_exec(conn,sqlcmd,NULL,NULL,NULL) != SQLITE_OK)) return DB_UNEXPECTED_RESULT;
     return id;
@@ -409,6 +397,8 @@ string SqliteDatabase::vprepare(const char *format, va_list args)
 
 SqliteDataset::SqliteDataset():Dataset() {
   haveError = false;
+  stream = NULL;
+  streaming = false;
   db = NULL;
   errmsg = NULL;
   autorefresh = false;
@@ -417,12 +407,15 @@ SqliteDataset::SqliteDataset():Dataset() {
 
 SqliteDataset::SqliteDataset(SqliteDatabase *newDb):Dataset(newDb) {
   haveError = false;
+  stream = NULL;
+  streaming = false;
   db = newDb;
   errmsg = NULL;
   autorefresh = false;
 }
 
  SqliteDataset::~SqliteDataset(){
+   if (stream) sqlite3_finalize(stream);
    if (errmsg) sqlite3_free(errmsg);
  }
 
@@ -494,32 +487,24 @@ void SqliteDataset::make_deletion() {
 
 
 void SqliteDataset::fill_fields() {
-  //cout <<"rr "<<result.records.size()<<"|" << frecno <<"\n";
-  if ((db == NULL) || (result.record_header.size() == 0) || (result.records.size() < (unsigned int)frecno)) return;
+  if ((db == NULL) || (result.record_header.size() == 0) || (result.num_rows() < (unsigned int)frecno)) return;
 
+  const unsigned int ncols = result.record_header.size();
   if (fields_object->size() == 0) // Filling columns name
   {
-    const unsigned int ncols = result.record_header.size();
     fields_object->resize(ncols);
     for (unsigned int i = 0; i < ncols; i++)
       (*fields_object)[i].props = result.record_header[i];
   }
 
   //Filling result
-  if (result.records.size() != 0)
+  fields_object->resize(ncols);
+  if (frecno >= 0 && (unsigned int)frecno < result.num_rows())
   {
-    const sql_record *row = result.records[frecno];
-    if (row)
-    {
-      const unsigned int ncols = row->size();
-      fields_object->resize(ncols);
-      for (unsigned int i = 0; i < ncols; i++)
-        (*fields_object)[i].val = row->at(i);
-      return;
-    }
+    for (unsigned int i = 0; i < ncols; i++)
+      result.get_value(frecno, i, (*fields_object)[i].val);
+    return;
   }
-  const unsigned int ncols = result.record_header.size();
-  fields_object->resize(ncols);
   for (unsigned int i = 0; i < ncols; i++)
     (*fields_object)[i].val = "";
 }
@@ -598,6 +583,14 @@ const void* SqliteDataset::getExecRes() {
 
 
 bool SqliteDataset::query(const char *query) {
+  return run_query(query, false);
+}
+
+bool SqliteDataset::query_streaming(const char *query) {
+  return run_query(query, true);
+}
+
+bool SqliteDataset::run_query(const char *query, bool batched) {
     if(!handle()) throw DbErrors("No Database Connection");
     std::string qry = query;
     int fs = qry.find("select");
@@ -617,52 +610,84 @@ bool SqliteDataset::query(const char *query) {
 
   // column headers
   const unsigned int numColumns = sqlite3_column_count(stmt);
-  result.record_header.resize(numColumns);
+  result.set_columns(numColumns);
   for (unsigned int i = 0; i < numColumns; i++)
     result.record_header[i].name = sqlite3_column_name(stmt, i);
 
-  // returned rows
-  while (sqlite3_step(stmt) == SQLITE_ROW)
-  { // have a row of data
-    sql_record *res = new sql_record;
-    res->resize(numColumns);
+  // returned rows, the statement is kept when there may be more
+  if (batched)
+  {
+    streaming = true;
+    if (fetch_rows(stmt, DB_STREAM_BATCH))
+      stream = stmt;
+  }
+  else
+    fetch_rows(stmt, UINT_MAX);
+
+  if (stream || db->setErr(sqlite3_finalize(stmt),query) == SQLITE_OK)
+  {
+    active = true;
+    ds_state = dsSelect;
+    this->first();
+    return true;
+  }
+  else
+  {
+    throw DbErrors(db->getErrorMsg());
+  }  
+}
+
+bool SqliteDataset::fetch_rows(sqlite3_stmt *stmt, unsigned int max) {
+  const unsigned int numColumns = result.num_columns();
+  for (unsigned int row = 0; row < max; row++)
+  {
+    if (sqlite3_step(stmt) != SQLITE_ROW)
+      return false;
+
+    // have a row of data
+    result.add_row();
     for (unsigned int i = 0; i < numColumns; i++)
     {
-      field_value &v = res->at(i);
       switch (sqlite3_column_type(stmt, i))
       {
       case SQLITE_INTEGER:
-        v.set_asInt64(sqlite3_column_int64(stmt, i));
+        result.set_int64(i, sqlite3_column_int64(stmt, i));
         break;
       case SQLITE_FLOAT:
-        v.set_asDouble(sqlite3_column_double(stmt, i));
+        result.set_double(i, sqlite3_column_double(stmt, i));
         break;
       case SQLITE_TEXT:
-        v.set_asString((const char *)sqlite3_column_text(stmt, i));
-        break;
       case SQLITE_BLOB:
-        v.set_asString((const char *)sqlite3_column_text(stmt, i));
+      {
+        const char *text = (const char *)sqlite3_column_text(stmt, i);
+        result.set_string(i, text, sqlite3_column_bytes(stmt, i));
         break;
+      }
       case SQLITE_NULL:
       default:
-        v.set_asString("");
-        v.set_isNull();
-        break;
+        break; // fields are NULL unless set
       }
     }
-    result.records.push_back(res);
   }
-  if (db->setErr(sqlite3_finalize(stmt),query) == SQLITE_OK)
-  {
-    active = true;
-    ds_state = dsSelect;
-    this->first();
+  return true;
+}
+
+bool SqliteDataset::fetch_batch() {
+  if (!stream)
+    return false;
+
+  result.clear_rows();
+  frecno = 0;
+  if (fetch_rows(stream, DB_STREAM_BATCH))
     return true;
-  }
-  else
-  {
+
+  // no more rows, report what ended the statement
+  const char *query = sqlite3_sql(stream);
+  int err = db->setErr(sqlite3_finalize(stream), query ? query : "");
+  stream = NULL;
+  if (err != SQLITE_OK)
     throw DbErrors(db->getErrorMsg());
-  }  
+  return result.num_rows() > 0;
 }
 
 bool SqliteDataset::query(const string &q){
@@ -686,6 +711,12 @@ void SqliteDataset::open() {
 
 void SqliteDataset::close() {
   Dataset::close();
+  if (stream)
+  {
+    sqlite3_finalize(stream);
+    stream = NULL;
+  }
+  streaming = false;
   result.clear();
   edit_object->clear();
   fields_object->clear();
@@ -705,7 +736,16 @@ void SqliteDataset::cancel() {
 
 
 int SqliteDataset::num_rows() {
-  return result.records.size();
+  return result.num_rows();
+}
+
+field_view SqliteDataset::get_field_view(int index) {
+  if (ds_state != dsSelect)
+    throw DbErrors("Dataset is not in Select state");
+  if (index < 0 || (unsigned int)index >= result.num_columns() ||
+      frecno < 0 || (unsigned int)frecno >= result.num_rows())
+    throw DbErrors("Field index not found: %d",index);
+  return result.get_view(frecno, index);
 }
 
 
@@ -725,35 +765,31 @@ void SqliteDataset::first() {
 }
 
 void SqliteDataset::last() {
+  if (streaming) throw DbErrors("last() is not available for a streaming query");
   Dataset::last();
   fill_fields();
 }
 
 void SqliteDataset::prev(void) {
+  if (streaming) throw DbErrors("prev() is not available for a streaming query");
   Dataset::prev();
   fill_fields();
 }
 
 void SqliteDataset::next(void) {
+  if (streaming && ds_state == dsSelect && frecno >= num_rows() - 1 && fetch_batch())
+  { // continue with the first row of the next batch
+    fbof = feof = false;
+    fill_fields();
+    return;
+  }
   Dataset::next();
   if (!eof()) 
       fill_fields();
 }
 
-void SqliteDataset::free_row(void)
-{
-  if (frecno < 0 || (unsigned int)frecno >= result.records.size())
-    return;
-
-  sql_record *row = result.records[frecno];
-  if (row)
-  {
-    delete row;
-    result.records[frecno] = NULL;
-  }
-}
-
 bool SqliteDataset::seek(int pos) {
+  if (streaming) throw DbErrors("seek() is not available for a streaming query");
   if (ds_state == dsSelect) {
     Dataset::seek(pos);
     fill_fields();
@@ -111,6 +111,8 @@ protected:
   result_set exec_res;
   bool autorefresh;
   char* errmsg;
+  sqlite3_stmt *stream; // statement of a streaming query with rows left to fetch
+  bool streaming;     // the current result is fetched in batches
 
   sqlite3* handle();
 
@@ -128,8 +130,12 @@ protected:
 /* This function works only with MySQL database
   Filling the fields information from select statement */
   virtual void fill_fields();
-/* Changing field values during dataset navigation */
-  virtual void free_row();  // free the memory allocated for the current row
+/* runs a select, fetching all rows or only the first batch when streaming */
+  bool run_query(const char *query, bool batched);
+/* appends up to max rows to the result, returns false once there are no more */
+  bool fetch_rows(sqlite3_stmt *stmt, unsigned int max);
+/* fetches the next batch of a streaming query, returns false once there are no more */
+  bool fetch_batch();
 
 public:
 /* constructor */
@@ -153,6 +159,7 @@ or insert() operations default = false) */
 /* as open, but with our query exept Sql */
   virtual bool query(const char *query);
   virtual bool query(const std::string &query);
+  virtual bool query_streaming(const char *query);
 /* func. closes a query */
   virtual void close(void);
 /* Cancel changes, made in insert or edit states of dataset */
@@ -163,6 +170,8 @@ or insert() operations default = false) */
   virtual long nextid(const char *seq_name);
 /* sequence numbers */
   virtual int num_rows();
+/* zero copy access to a field of the current record */
+  virtual field_view get_field_view(int index);
 /* interupt any pending database operation  */
   virtual void interrupt();
 
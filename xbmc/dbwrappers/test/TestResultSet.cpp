@@ -0,0 +1,400 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+#include <boost/test/unit_test.hpp>
+
+#include "dbwrappers/dataset.h"
+#include "utils/test/TestUtils.h"
+
+#include <sqlite3.h>
+#include <stdio.h>
+
+using namespace dbiplus;
+
+#define NUMROWS 100000
+
+//=============================================================================
+// Helpers
+//=============================================================================
+
+namespace
+{
+// the row storage result_set used before it went columnar
+class legacy_result_set
+{
+public:
+  ~legacy_result_set()
+  {
+    for (unsigned int i = 0; i < records.size(); i++)
+      delete records[i];
+  }
+
+  size_t memory_usage() const
+  {
+    size_t bytes = records.capacity() * sizeof(sql_record*);
+    for (unsigned int i = 0; i < records.size(); i++)
+    {
+      bytes += sizeof(sql_record) + records[i]->capacity() * sizeof(field_value);
+      for (unsigned int j = 0; j < records[i]->size(); j++)
+      {
+        const field_value &v = records[i]->at(j);
+        if (v.get_fType() == ft_String)
+          bytes += v.get_asString().capacity() + 1;
+      }
+    }
+    return bytes;
+  }
+
+  query_data records;
+};
+}
+
+static void LoadLegacy(sqlite3_stmt *stmt, legacy_result_set &result)
+{
+  const unsigned int numColumns = sqlite3_column_count(stmt);
+  while (sqlite3_step(stmt) == SQLITE_ROW)
+  {
+    sql_record *res = new sql_record;
+    res->resize(numColumns);
+    for (unsigned int i = 0; i < numColumns; i++)
+    {
+      field_value &v = res->at(i);
+      switch (sqlite3_column_type(stmt, i))
+      {
+      case SQLITE_INTEGER:
+        v.set_asInt64(sqlite3_column_int64(stmt, i));
+        break;
+      case SQLITE_FLOAT:
+        v.set_asDouble(sqlite3_column_double(stmt, i));
+        break;
+      case SQLITE_TEXT:
+        v.set_asString((const char *)sqlite3_column_text(stmt, i));
+        break;
+      default:
+        v.set_asString("");
+        v.set_isNull();
+        break;
+      }
+    }
+    result.records.push_back(res);
+  }
+}
+
+// the way SqliteDataset::query fills its result set
+static void LoadColumnar(sqlite3_stmt *stmt, result_set &result)
+{
+  const unsigned int numColumns = sqlite3_column_count(stmt);
+  result.set_columns(numColumns);
+  while (sqlite3_step(stmt) == SQLITE_ROW)
+  {
+    result.add_row();
+    for (unsigned int i = 0; i < numColumns; i++)
+    {
+      switch (sqlite3_column_type(stmt, i))
+      {
+      case SQLITE_INTEGER:
+        result.set_int64(i, sqlite3_column_int64(stmt, i));
+        break;
+      case SQLITE_FLOAT:
+        result.set_double(i, sqlite3_column_double(stmt, i));
+        break;
+      case SQLITE_TEXT:
+      {
+        const char *text = (const char *)sqlite3_column_text(stmt, i);
+        result.set_string(i, text, sqlite3_column_bytes(stmt, i));
+        break;
+      }
+      default:
+        break;
+      }
+    }
+  }
+}
+
+namespace
+{
+// a synthetic library, shaped like songview and movieview
+class Library
+{
+public:
+  sqlite3 *db;
+
+  Library() : db(NULL)
+  {
+    sqlite3_open(":memory:", &db);
+    Exec("CREATE TABLE songview (idSong integer, strTitle text, iTrack integer, iDuration integer, iYear integer, "
+         "dwFileNameCRC text, strFileName text, strMusicBrainzTrackID text, iTimesPlayed integer, iStartOffset integer, "
+         "iEndOffset integer, lastplayed text, rating text, comment text, idAlbum integer, strAlbum text, strPath text, "
+         "iKaraNumber integer, strArtist text, strGenre text, strThumb text)");
+    Exec("CREATE TABLE movieview (idMovie integer, idFile integer, c00 text, c01 text, c02 text, c03 text, c04 text, "
+         "c05 text, c06 text, c07 text, c08 text, c09 text, c10 text, c11 text, c12 text, c14 text, c15 text, c16 text, "
+         "c18 text, c19 text, c20 text, strFileName text, strPath text, playCount integer, lastPlayed text)");
+
+    Exec("BEGIN");
+    char sql[2048];
+    for (int i = 0; i < NUMROWS; i++)
+    {
+      sprintf(sql, "INSERT INTO songview VALUES (%d, 'Song title number %d', %d, %d, %d, '%08x', 'song %05d.flac', "
+                   "NULL, %d, 0, 0, NULL, '0', '', %d, 'Album title %d', '/media/music/Artist %d/Album %d/', 0, "
+                   "'Artist name %d', 'Genre %d', 'special://masterprofile/Thumbnails/Music/%08x.tbn')",
+              i, i, i % 20 + 1, 180 + i % 240, 1960 + i % 50, i * 2654435761u, i, i % 7, i / 12, i / 12, i / 120, i / 12,
+              i / 120, i % 40, i * 2654435761u);
+      Exec(sql);
+      sprintf(sql, "INSERT INTO movieview VALUES (%d, %d, 'Movie title %d', 'A plot outline of movie %d which takes "
+                   "up a few more bytes than a title would', 'A somewhat longer plot of movie %d, long enough to be "
+                   "representative of what scrapers store for a typical film in the library', '', '7.%d', 'Writer %d', "
+                   "'%d', '<thumb>http://example.com/poster/%d.jpg</thumb>', 'tt%07d', '', '%d', 'PG-13', 'Director %d', "
+                   "'Original title %d', 'Drama / Comedy', 'Studio %d', '', '<fanart><thumb>http://example.com/fanart/%d.jpg"
+                   "</thumb></fanart>', '', 'movie %05d.mkv', '/media/movies/', %d, NULL)",
+              i, i, i, i, i, i % 10, i % 500, 1960 + i % 50, i, i, 90 + i % 60, i % 300, i, i % 90, i, i, i % 3);
+      Exec(sql);
+    }
+    Exec("COMMIT");
+  }
+
+  ~Library()
+  {
+    sqlite3_close(db);
+  }
+
+  void Exec(const char *sql)
+  {
+    sqlite3_exec(db, sql, NULL, NULL, NULL);
+  }
+
+  sqlite3_stmt *Prepare(const char *sql)
+  {
+    sqlite3_stmt *stmt = NULL;
+    sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    return stmt;
+  }
+};
+}
+
+// what a listing does with every row: read all fields as the database classes do
+static size_t ReadLegacy(const legacy_result_set &result)
+{
+  size_t total = 0;
+  for (unsigned int row = 0; row < result.records.size(); row++)
+  {
+    const sql_record &record = *result.records[row];
+    for (unsigned int i = 0; i < record.size(); i++)
+      total += record[i].get_asString().size();
+  }
+  return total;
+}
+
+static size_t ReadCompat(const result_set &result)
+{
+  size_t total = 0;
+  std::vector<field_value> fields(result.num_columns());
+  for (unsigned int row = 0; row < result.num_rows(); row++)
+  {
+    for (unsigned int i = 0; i < result.num_columns(); i++)
+    {
+      result.get_value(row, i, fields[i]);
+      total += fields[i].get_asString().size();
+    }
+  }
+  return total;
+}
+
+static size_t ReadViews(const result_set &result)
+{
+  size_t total = 0;
+  char buffer[32];
+  for (unsigned int row = 0; row < result.num_rows(); row++)
+  {
+    for (unsigned int i = 0; i < result.num_columns(); i++)
+    {
+      field_view view = result.get_view(row, i);
+      if (view.type == ft_String)
+        total += view.len;
+      else if (view.type == ft_Double)
+        total += sprintf(buffer, "%f", view.double_value);
+      else
+        total += sprintf(buffer, "%lld", (long long)view.int64_value);
+    }
+  }
+  return total;
+}
+
+static void BenchmarkListing(Library &library, const char *name, const char *sql)
+{
+  boost::posix_time::ptime start = BenchmarkStart();
+  legacy_result_set legacy;
+  sqlite3_stmt *stmt = library.Prepare(sql);
+  LoadLegacy(stmt, legacy);
+  sqlite3_finalize(stmt);
+  double legacyLoad = ElapsedMilliseconds(start);
+  start = BenchmarkStart();
+  size_t legacyBytes = ReadLegacy(legacy);
+  double legacyRead = ElapsedMilliseconds(start);
+
+  start = BenchmarkStart();
+  result_set columnar;
+  stmt = library.Prepare(sql);
+  LoadColumnar(stmt, columnar);
+  sqlite3_finalize(stmt);
+  double columnarLoad = ElapsedMilliseconds(start);
+  start = BenchmarkStart();
+  size_t compatBytes = ReadCompat(columnar);
+  double compatRead = ElapsedMilliseconds(start);
+  start = BenchmarkStart();
+  ReadViews(columnar);
+  double viewRead = ElapsedMilliseconds(start);
+
+  BOOST_CHECK_EQUAL(legacy.records.size(), (size_t)NUMROWS);
+  BOOST_CHECK_EQUAL(columnar.num_rows(), (unsigned int)NUMROWS);
+  BOOST_CHECK_EQUAL(legacyBytes, compatBytes);
+
+  printf("%-10s legacy:   load %7.1f ms  read %7.1f ms  %6.1f MB\n", name, legacyLoad, legacyRead,
+         legacy.memory_usage() / 1048576.0);
+  printf("%-10s columnar: load %7.1f ms  read %7.1f ms (fv) %7.1f ms (view)  %6.1f MB\n", name, columnarLoad, compatRead,
+         viewRead, columnar.memory_usage() / 1048576.0);
+}
+
+//=============================================================================
+
+BOOST_AUTO_TEST_CASE(TestResultSetFields)
+{
+  result_set result;
+  result.set_columns(5);
+  result.add_row();
+  result.set_string(0, "title");
+  result.set_int(1, 42);
+  result.set_int64(2, 1234567890123ll);
+  result.set_double(3, 2.5);
+  result.add_row();
+  result.set_string(0, "", 0);
+
+  BOOST_CHECK_EQUAL(2u, result.num_rows());
+  BOOST_CHECK_EQUAL(5u, result.num_columns());
+
+  BOOST_CHECK_EQUAL("title", result.get_value(0, 0).get_asString());
+  BOOST_CHECK_EQUAL(42, result.get_value(0, 1).get_asInt());
+  BOOST_CHECK(result.get_value(0, 1).get_fType() == ft_Int);
+  BOOST_CHECK_EQUAL(1234567890123ll, result.get_value(0, 2).get_asInt64());
+  BOOST_CHECK_EQUAL(2.5, result.get_value(0, 3).get_asDouble());
+
+  // fields that were not set are NULL, an empty string is not
+  BOOST_CHECK(result.get_value(0, 4).get_isNull());
+  BOOST_CHECK_EQUAL("", result.get_value(0, 4).get_asString());
+  BOOST_CHECK(!result.get_value(1, 0).get_isNull());
+  BOOST_CHECK(result.get_value(1, 1).get_isNull());
+
+  // get_value resets the NULL state of a reused field_value
+  field_value value;
+  result.get_value(0, 4, value);
+  BOOST_CHECK(value.get_isNull());
+  result.get_value(0, 0, value);
+  BOOST_CHECK(!value.get_isNull());
+  BOOST_CHECK_EQUAL("title", value.get_asString());
+
+  field_view view = result.get_view(0, 0);
+  BOOST_CHECK(view.type == ft_String);
+  BOOST_CHECK_EQUAL(5u, view.len);
+  BOOST_CHECK_EQUAL(std::string("title"), view.str);
+  view = result.get_view(0, 2);
+  BOOST_CHECK_EQUAL(1234567890123ll, view.int64_value);
+  view = result.get_view(0, 4);
+  BOOST_CHECK(view.is_null);
+  BOOST_CHECK_EQUAL(std::string(""), view.str);
+
+  result.clear();
+  BOOST_CHECK_EQUAL(0u, result.num_rows());
+  BOOST_CHECK_EQUAL(0u, result.num_columns());
+}
+
+BOOST_AUTO_TEST_CASE(TestResultSetStringHeap)
+{
+  // strings stay in place while the heap grows, also ones larger than a block
+  result_set result;
+  result.set_columns(1);
+  std::string large(200000, 'x');
+  std::vector<const char*> strings;
+  for (int i = 0; i < 10000; i++)
+  {
+    char buffer[32];
+    sprintf(buffer, "string %d", i);
+    result.add_row();
+    if (i % 1000 == 500)
+      result.set_string(0, large.c_str(), large.size());
+    else
+      result.set_string(0, buffer);
+    strings.push_back(result.get_view(i, 0).str);
+  }
+
+  bool ok = true;
+  for (int i = 0; i < 10000; i++)
+  {
+    char buffer[32];
+    sprintf(buffer, "string %d", i);
+    field_view view = result.get_view(i, 0);
+    if (view.str != strings[i])
+      ok = false;
+    if (i % 1000 == 500)
+      ok &= view.len == large.size() && large == view.str;
+    else
+      ok &= view.len == strlen(buffer) && strcmp(buffer, view.str) == 0;
+  }
+  BOOST_CHECK(ok);
+}
+
+BOOST_AUTO_TEST_CASE(TestResultSetStreamingBatch)
+{
+  // a streaming query keeps the columns and drops the rows of a batch when it
+  // fetches the next one, the strings of the views go with them
+  result_set result;
+  result.set_columns(1);
+  for (int i = 0; i < DB_STREAM_BATCH; i++)
+  {
+    result.add_row();
+    result.set_string(0, "first batch");
+  }
+  field_view view = result.get_view(DB_STREAM_BATCH - 1, 0);
+  std::string copy(view.str, view.len);
+  field_value value = result.get_value(DB_STREAM_BATCH - 1, 0);
+  size_t batchMemory = result.memory_usage();
+
+  // the string heap (a 64k block here) is freed, the columns keep their capacity for the next batch
+  result.clear_rows();
+  BOOST_CHECK_EQUAL(0u, result.num_rows());
+  BOOST_CHECK_EQUAL(1u, result.num_columns());
+  BOOST_CHECK(result.memory_usage() + 64 * 1024 <= batchMemory);
+
+  result.add_row();
+  result.set_string(0, "second batch");
+  BOOST_CHECK_EQUAL(1u, result.num_rows());
+  BOOST_CHECK_EQUAL(std::string("second batch"), result.get_view(0, 0).str);
+
+  // only copies made before the fetch outlive the batch
+  BOOST_CHECK_EQUAL("first batch", copy);
+  BOOST_CHECK_EQUAL("first batch", value.get_asString());
+}
+
+BOOST_AUTO_TEST_CASE(BenchmarkLibraryListings)
+{
+  Library library;
+  BenchmarkListing(library, "all songs", "SELECT * FROM songview");
+  BenchmarkListing(library, "all movies", "SELECT * FROM movieview");
+}
@@ -35,25 +35,35 @@
 
 #include "../addons/include/xbmc_pvr_types.h" // TODO extract the epg specific stuff
 
+#include <algorithm>
+
 using namespace PVR;
 using namespace EPG;
 
+typedef std::pair<int64_t, CEpgInfoTag *> EpgSortEntry;
+
 struct sortEPGbyDate
 {
-  bool operator()(CEpgInfoTag* strItem1, CEpgInfoTag* strItem2)
+  bool operator()(const EpgSortEntry &entry1, const EpgSortEntry &entry2) const
   {
-    if (!strItem1 || !strItem2)
-      return false;
-
-    return strItem1->StartAsUTC() < strItem2->StartAsUTC();
+    return entry1.first < entry2.first;
   }
 };
 
+/* the time index works in seconds since the epoch, in UTC */
+static inline int64_t GetIndexTime(const CDateTime &time)
+{
+  time_t iTime;
+  time.GetAsTime(iTime);
+  return (int64_t) iTime;
+}
+
 CEpg::CEpg(int iEpgID, const CStdString &strName /* = "" */, const CStdString &strScraperName /* = "" */, bool bLoadedFromDb /* = false */) :
     m_bChanged(!bLoadedFromDb),
     m_bTagsChanged(false),
     m_bInhibitSorting(false),
     m_bLoaded(false),
+    m_iRevision(0),
     m_iEpgID(iEpgID),
     m_strName(strName),
     m_strScraperName(strScraperName),
@@ -70,6 +80,7 @@ CEpg::CEpg(CPVRChannel *channel, bool bLoadedFromDb /* = false */) :
     m_bTagsChanged(false),
     m_bInhibitSorting(false),
     m_bLoaded(false),
+    m_iRevision(0),
     m_iEpgID(channel->EpgID()),
     m_strName(channel->ChannelName()),
     m_strScraperName(channel->EPGScraper()),
@@ -86,6 +97,7 @@ CEpg::CEpg(void) :
     m_bTagsChanged(false),
     m_bInhibitSorting(false),
     m_bLoaded(false),
+    m_iRevision(0),
     m_iEpgID(0),
     m_strName(StringUtils::EmptyString),
     m_strScraperName(StringUtils::EmptyString),
@@ -122,6 +134,7 @@ CEpg &CEpg::operator =(const CEpg &right)
     CEpgInfoTag *tag = new CEpgInfoTag(*right.at(iPtr));
     push_back(tag);
   }
+  RebuildIndex();
 
   return *this;
 }
@@ -167,40 +180,132 @@ void CEpg::Sort(void)
   if (m_bInhibitSorting)
     return;
 
-  /* sort the EPG */
-  sort(begin(), end(), sortEPGbyDate());
+  /* sort the EPG on the start times as integers, so the dates don't have to be copied for every comparison */
+  std::vector<EpgSortEntry> entries;
+  entries.reserve(size());
+  for (unsigned int iTagPtr = 0; iTagPtr < size(); iTagPtr++)
+    entries.push_back(EpgSortEntry(GetIndexTime(at(iTagPtr)->StartAsUTC()), at(iTagPtr)));
+
+  stable_sort(entries.begin(), entries.end(), sortEPGbyDate());
+
+  for (unsigned int iTagPtr = 0; iTagPtr < size(); iTagPtr++)
+    at(iTagPtr) = entries.at(iTagPtr).second;
+
+  /* rebuild the indexes and reset the previous and next pointers on each tag */
+  RebuildIndex();
+}
+
+void CEpg::RebuildIndex(void)
+{
+  m_iRevision++;
+  m_timeIndex.Clear();
+  m_uniqueIds.clear();
+
+  for (unsigned int iTagPtr = 0; iTagPtr < size(); iTagPtr++)
+  {
+    CEpgInfoTag *tag = at(iTagPtr);
+    m_timeIndex.Insert(iTagPtr, GetIndexTime(tag->StartAsUTC()), GetIndexTime(tag->EndAsUTC()));
+
+    /* keep the first tag with an ID, like a search from the start of the table would find */
+    if (tag->UniqueBroadcastID() > 0)
+      m_uniqueIds.insert(std::make_pair(tag->UniqueBroadcastID(), tag));
+  }
 
-  /* reset the previous and next pointers on each tag */
   UpdatePreviousAndNextPointers();
 }
 
-void CEpg::UpdatePreviousAndNextPointers(void)
+void CEpg::InsertTag(CEpgInfoTag *tag)
+{
+  int64_t iStart = GetIndexTime(tag->StartAsUTC());
+  unsigned int iPtr = m_timeIndex.InsertPosition(iStart);
+
+  m_iRevision++;
+  insert(begin() + iPtr, tag);
+  m_timeIndex.Insert(iPtr, iStart, GetIndexTime(tag->EndAsUTC()));
+
+  if (tag->UniqueBroadcastID() > 0)
+    m_uniqueIds.insert(std::make_pair(tag->UniqueBroadcastID(), tag));
+
+  UpdatePreviousAndNextPointers(iPtr, iPtr + 1);
+}
+
+void CEpg::RemoveTag(unsigned int iPtr)
 {
-  int iTagAmount = size();
-  for (int ptr = 0; ptr < iTagAmount; ptr++)
+  CEpgInfoTag *tag = at(iPtr);
+
+  std::map<int, CEpgInfoTag *>::iterator it = m_uniqueIds.find(tag->UniqueBroadcastID());
+  if (it != m_uniqueIds.end() && it->second == tag)
+    m_uniqueIds.erase(it);
+
+  if (m_nowActive == tag)
+    m_nowActive = NULL;
+
+  m_iRevision++;
+  erase(begin() + iPtr);
+  m_timeIndex.Erase(iPtr, iPtr + 1);
+
+  tag->SetPreviousEvent(NULL);
+  tag->SetNextEvent(NULL);
+  UpdatePreviousAndNextPointers(iPtr, iPtr);
+}
+
+void CEpg::DeleteTags(unsigned int iFrom, unsigned int iTo)
+{
+  if (iFrom >= iTo)
+    return;
+
+  for (unsigned int iPtr = iFrom; iPtr < iTo; iPtr++)
   {
-    CEpgInfoTag *tag = at(ptr);
+    CEpgInfoTag *tag = at(iPtr);
 
-    if (ptr == 0)
-    {
-      /* first tag has no previous event */
-      tag->SetPreviousEvent(NULL);
-    }
-    else
-    {
-      /* set the next event in the previous tag */
-      CEpgInfoTag *previousTag = at(ptr-1);
-      previousTag->SetNextEvent(tag);
+    std::map<int, CEpgInfoTag *>::iterator it = m_uniqueIds.find(tag->UniqueBroadcastID());
+    if (it != m_uniqueIds.end() && it->second == tag)
+      m_uniqueIds.erase(it);
 
-      /* set the previous event in this tag */
-      tag->SetPreviousEvent(previousTag);
-    }
+    if (m_nowActive == tag)
+      m_nowActive = NULL;
 
-    if (ptr == iTagAmount - 1)
-    {
-      /* ensure that the next event for the last tag is set to NULL */
-      tag->SetNextEvent(NULL);
-    }
+    delete tag;
+  }
+
+  m_iRevision++;
+  erase(begin() + iFrom, begin() + iTo);
+  m_timeIndex.Erase(iFrom, iTo);
+  UpdatePreviousAndNextPointers(iFrom, iFrom);
+}
+
+int CEpg::GetTagPosition(const CEpgInfoTag *tag) const
+{
+  int64_t iStart = GetIndexTime(tag->StartAsUTC());
+  for (unsigned int iPtr = m_timeIndex.FirstStartingFrom(iStart); iPtr < size() && m_timeIndex.Start(iPtr) == iStart; iPtr++)
+  {
+    if (at(iPtr) == tag)
+      return (int) iPtr;
+  }
+
+  return -1;
+}
+
+void CEpg::UpdatePreviousAndNextPointers(void)
+{
+  UpdatePreviousAndNextPointers(0, size());
+}
+
+void CEpg::UpdatePreviousAndNextPointers(unsigned int iFrom, unsigned int iTo)
+{
+  /* the tags around the range point into it too */
+  if (iFrom > 0)
+    iFrom--;
+  if (iTo < size())
+    iTo++;
+
+  for (unsigned int iPtr = iFrom; iPtr < iTo; iPtr++)
+  {
+    CEpgInfoTag *tag = at(iPtr);
+
+    /* the first tag has no previous event and the last tag no next event */
+    tag->SetPreviousEvent(iPtr > 0 ? at(iPtr - 1) : NULL);
+    tag->SetNextEvent(iPtr + 1 < size() ? at(iPtr + 1) : NULL);
   }
 }
 
@@ -212,6 +317,10 @@ void CEpg::Clear(void)
   for (unsigned int iTagPtr = 0; iTagPtr < size(); iTagPtr++)
     delete at(iTagPtr);
   erase(begin(), end());
+
+  m_iRevision++;
+  m_timeIndex.Clear();
+  m_uniqueIds.clear();
 }
 
 void CEpg::Cleanup(void)
@@ -223,24 +332,31 @@ void CEpg::Cleanup(void)
 
 void CEpg::Cleanup(const CDateTime &Time)
 {
-  bool bTagsChanged(false);
   CSingleLock lock(m_critSection);
-  for (int iPtr = size() - 1; iPtr >= 0; iPtr--)
+  int64_t iTime = GetIndexTime(Time);
+
+  /* move the tags we keep to the front in a single pass */
+  unsigned int iKept = 0;
+  for (unsigned int iPtr = 0; iPtr < size(); iPtr++)
   {
-    if (at(iPtr)->EndAsUTC() < Time)
+    CEpgInfoTag *tag = at(iPtr);
+    if (m_timeIndex.End(iPtr) < iTime)
     {
-      if (m_nowActive && *m_nowActive == *at(iPtr))
+      if (m_nowActive == tag)
         m_nowActive = NULL;
 
-      delete at(iPtr);
-      erase(begin() + iPtr);
-      bTagsChanged = true;
+      delete tag;
+    }
+    else
+    {
+      at(iKept++) = tag;
     }
   }
 
-  if (bTagsChanged)
+  if (iKept < size())
   {
-    UpdatePreviousAndNextPointers();
+    erase(begin() + iKept, end());
+    RebuildIndex();
     UpdateFirstAndLastDates();
   }
 }
@@ -250,17 +366,9 @@ bool CEpg::InfoTagNow(CEpgInfoTag &tag) const
   CSingleLock lock(m_critSection);
   if (!m_nowActive || !m_nowActive->IsActive())
   {
-    CDateTime now = CDateTime::GetCurrentDateTime().GetAsUTCDateTime();
-    /* one of the first items will always match if the list is sorted */
-    for (unsigned int iTagPtr = 0; iTagPtr < size(); iTagPtr++)
-    {
-      CEpgInfoTag *tag = at(iTagPtr);
-      if (tag->StartAsUTC() <= now && tag->EndAsUTC() > now)
-      {
-        m_nowActive = tag;
-        break;
-      }
-    }
+    int iPtr = m_timeIndex.FindAround(GetIndexTime(CDateTime::GetCurrentDateTime().GetAsUTCDateTime()), false);
+    if (iPtr >= 0)
+      m_nowActive = at(iPtr);
   }
 
   if (m_nowActive)
@@ -280,17 +388,11 @@ bool CEpg::InfoTagNext(CEpgInfoTag &tag) const
   }
 
   CSingleLock lock(m_critSection);
-  if (size() >  0)
+  unsigned int iPtr = m_timeIndex.FirstStartingAfter(GetIndexTime(CDateTime::GetCurrentDateTime().GetAsUTCDateTime()));
+  if (iPtr < size())
   {
-    CDateTime now = CDateTime::GetCurrentDateTime().GetAsUTCDateTime();
-    for (unsigned int iTagPtr = 0; iTagPtr < size(); iTagPtr++)
-    {
-      if (at(iTagPtr)->StartAsUTC() > now)
-      {
-        tag = *at(iTagPtr);
-        return true;
-      }
-    }
+    tag = *at(iPtr);
+    return true;
   }
 
   return false;
@@ -312,76 +414,42 @@ bool CEpg::CheckPlayingEvent(void)
 
 CEpgInfoTag *CEpg::GetTag(int uniqueID, const CDateTime &StartTime) const
 {
-  CEpgInfoTag *returnTag = NULL;
   CSingleLock lock(m_critSection);
 
   /* try to find the tag by UID */
   if (uniqueID > 0)
   {
-    for (unsigned int iEpgPtr = 0; iEpgPtr < size(); iEpgPtr++)
-    {
-      CEpgInfoTag *tag = at(iEpgPtr);
-      if (tag->UniqueBroadcastID() == uniqueID)
-      {
-        returnTag = tag;
-        break;
-      }
-    }
+    std::map<int, CEpgInfoTag *>::const_iterator it = m_uniqueIds.find(uniqueID);
+    if (it != m_uniqueIds.end())
+      return it->second;
   }
 
   /* if we haven't found it, search by start time */
-  if (!returnTag)
+  int64_t iStart = GetIndexTime(StartTime);
+  for (unsigned int iEpgPtr = m_timeIndex.FirstStartingFrom(iStart); iEpgPtr < size() && m_timeIndex.Start(iEpgPtr) == iStart; iEpgPtr++)
   {
-    for (unsigned int iEpgPtr = 0; iEpgPtr < size(); iEpgPtr++)
-    {
-      CEpgInfoTag *tag = at(iEpgPtr);
-      if (tag->StartAsUTC() == StartTime)
-      {
-        returnTag = tag;
-        break;
-      }
-    }
+    CEpgInfoTag *tag = at(iEpgPtr);
+    if (tag->StartAsUTC() == StartTime)
+      return tag;
   }
 
-  return returnTag;
+  return NULL;
 }
 
 const CEpgInfoTag *CEpg::GetTagBetween(const CDateTime &beginTime, const CDateTime &endTime) const
 {
-  CEpgInfoTag *returnTag = NULL;
-
   CSingleLock lock(m_critSection);
 
-  for (unsigned int iTagPtr = 0; iTagPtr < size(); iTagPtr++)
-  {
-    CEpgInfoTag *tag = at(iTagPtr);
-    if (tag->StartAsUTC() >= beginTime && tag->EndAsUTC() <= endTime)
-    {
-      returnTag = tag;
-      break;
-    }
-  }
-
-  return returnTag;
+  int iPtr = m_timeIndex.FindBetween(GetIndexTime(beginTime), GetIndexTime(endTime));
+  return iPtr >= 0 ? at(iPtr) : NULL;
 }
 
 const CEpgInfoTag *CEpg::GetTagAround(const CDateTime &time) const
 {
-  CEpgInfoTag *returnTag = NULL;
-
   CSingleLock lock(m_critSection);
 
-  for (unsigned int iTagPtr = 0; iTagPtr < size(); iTagPtr++)
-  {
-    CEpgInfoTag *tag = at(iTagPtr);
-    if ((tag->StartAsUTC() <= time) && (tag->EndAsUTC() >= time))
-    {
-      returnTag = tag;
-      break;
-    }
-  }
-
-  return returnTag;
+  int iPtr = m_timeIndex.FindAround(GetIndexTime(time), true);
+  return iPtr >= 0 ? at(iPtr) : NULL;
 }
 
 void CEpg::AddEntry(const CEpgInfoTag &tag)
@@ -408,13 +476,30 @@ bool CEpg::UpdateEntry(const CEpgInfoTag &tag, bool bUpdateDatabase /* = false *
   {
     infoTag = new CEpgInfoTag();
     infoTag->SetUniqueBroadcastID(tag.UniqueBroadcastID());
-    push_back(infoTag);
+    infoTag->m_Epg = this;
+    infoTag->Update(tag);
+    InsertTag(infoTag);
   }
+  else
+  {
+    /* take the tag out of the indexes while its times or ID change */
+    int iPtr = -1;
+    if (infoTag->StartAsUTC() != tag.StartAsUTC() ||
+        infoTag->EndAsUTC() != tag.EndAsUTC() ||
+        infoTag->UniqueBroadcastID() != tag.UniqueBroadcastID())
+    {
+      iPtr = GetTagPosition(infoTag);
+      if (iPtr >= 0)
+        RemoveTag(iPtr);
+    }
 
-  infoTag->m_Epg = this;
-  infoTag->Update(tag);
+    infoTag->m_Epg = this;
+    infoTag->Update(tag);
+    m_iRevision++;
 
-  Sort();
+    if (iPtr >= 0)
+      InsertTag(infoTag);
+  }
 
   if (bUpdateDatabase)
     bReturn = infoTag->Persist();
@@ -479,6 +564,11 @@ bool CEpg::UpdateEntries(const CEpg &epg, bool bStoreInDb /* = true */)
   bool bReturn(false);
   CSingleLock lock(m_critSection);
 
+  /* the new tags replace all tags that start at or after the first of them,
+     drop those in one go instead of one by one in FixOverlappingEvents() */
+  if (epg.size() > 0)
+    DeleteTags(m_timeIndex.FirstStartingFrom(GetIndexTime(epg.at(0)->StartAsUTC())), size());
+
   /* copy over tags */
   for (unsigned int iTagPtr = 0; iTagPtr < epg.size(); iTagPtr++)
   {
@@ -487,7 +577,7 @@ bool CEpg::UpdateEntries(const CEpg &epg, bool bStoreInDb /* = true */)
     {
       newTag->Update(*epg.at(iTagPtr));
       newTag->m_Epg = this;
-      push_back(newTag);
+      InsertTag(newTag);
     }
   }
 
@@ -614,6 +704,54 @@ int CEpg::Get(CFileItemList &results, const EpgSearchFilter &filter) const
   return results.Size() - iInitialSize;
 }
 
+int CEpg::Get(CFileItemList &results, const EpgSearchFilter &filter, unsigned int iRevision, const std::vector<unsigned int> &positions) const
+{
+  int iInitialSize = results.Size();
+
+  if (!HasValidEntries())
+    return -1;
+
+  CSingleLock lock(m_critSection);
+
+  /* the positions are from an older revision, check all tags */
+  if (iRevision != m_iRevision)
+    return Get(results, filter);
+
+  for (unsigned int iPtr = 0; iPtr < positions.size(); iPtr++)
+  {
+    const CEpgInfoTag *tag = at(positions[iPtr]);
+    if (filter.FilterEntry(*tag))
+    {
+      CFileItemPtr entry(new CFileItem(*tag));
+      entry->SetLabel2(tag->StartAsLocalTime().GetAsLocalizedDateTime(false, false));
+      results.Add(entry);
+    }
+  }
+
+  return results.Size() - iInitialSize;
+}
+
+unsigned int CEpg::UpdateSearchIndex(CEpgSearchIndex &index) const
+{
+  CSingleLock lock(m_critSection);
+
+  index.RemoveTable(m_iEpgID);
+  for (unsigned int iTagPtr = 0; iTagPtr < size(); iTagPtr++)
+  {
+    const CEpgInfoTag *tag = at(iTagPtr);
+    index.AddEvent(m_iEpgID, iTagPtr, tag->Title(), tag->PlotOutline(), tag->GenreType(),
+        m_timeIndex.Start(iTagPtr), m_timeIndex.End(iTagPtr));
+  }
+
+  return m_iRevision;
+}
+
+unsigned int CEpg::Revision(void) const
+{
+  CSingleLock lock(m_critSection);
+  return m_iRevision;
+}
+
 bool CEpg::Persist(bool bUpdateLastScanTime /* = false */)
 {
   if (g_guiSettings.GetBool("epg.ignoredbforclient"))
@@ -710,35 +848,35 @@ bool CEpg::UpdateMetadata(const CEpg &epg, bool bUpdateDb /* = false */)
 bool CEpg::FixOverlappingEvents(void)
 {
   bool bReturn(false);
-  CEpgInfoTag *previousTag(NULL), *currentTag(NULL);
+  int iPrevious(-1);
 
+  /* compare the times in the index, the tags only have to be touched when they change */
   for (int iPtr = size() - 1; iPtr >= 0; iPtr--)
   {
-    if (!previousTag)
+    if (iPrevious < 0)
     {
-      previousTag = at(iPtr);
+      iPrevious = iPtr;
       continue;
     }
-    currentTag = at(iPtr);
 
-    if (previousTag->StartAsUTC() <= currentTag->StartAsUTC())
+    if (m_timeIndex.Start(iPrevious) <= m_timeIndex.Start(iPtr))
     {
-      if (m_nowActive && *m_nowActive == *currentTag)
-        m_nowActive = NULL;
-
-      delete currentTag;
-      erase(begin() + iPtr);
+      DeleteTags(iPtr, iPtr + 1);
+      iPrevious--;
       bReturn = true;
     }
-    else if (previousTag->StartAsUTC() < currentTag->EndAsUTC())
+    else if (m_timeIndex.Start(iPrevious) < m_timeIndex.End(iPtr))
     {
-      currentTag->SetEndFromUTC(previousTag->StartAsUTC());
-      previousTag = at(iPtr);
+      CEpgInfoTag *currentTag = at(iPtr);
+      currentTag->SetEndFromUTC(at(iPrevious)->StartAsUTC());
+      m_timeIndex.Set(iPtr, m_timeIndex.Start(iPtr), m_timeIndex.Start(iPrevious));
+      m_iRevision++;
+      iPrevious = iPtr;
       bReturn = true;
     }
     else
     {
-      previousTag = at(iPtr);
+      iPrevious = iPtr;
     }
   }
 
@@ -27,8 +27,11 @@
 
 #include "EpgInfoTag.h"
 #include "EpgSearchFilter.h"
+#include "EpgTimeIndex.h"
 #include "utils/Observer.h"
 
+#include <map>
+
 namespace PVR
 {
   class CPVRChannel;
@@ -221,6 +224,31 @@ namespace EPG
      */
     virtual int Get(CFileItemList &results, const EpgSearchFilter &filter) const;
 
+    /*!
+     * @brief Get the EPG entries at the given positions that match a filter.
+     *
+     * If the table changed since the positions were looked up, all entries are checked against the filter.
+     *
+     * @param results The file list to store the results in.
+     * @param filter The filter to apply.
+     * @param iRevision The revision of this table the positions were looked up in.
+     * @param positions The positions of the entries to check.
+     * @return The amount of entries that were added.
+     */
+    virtual int Get(CFileItemList &results, const EpgSearchFilter &filter, unsigned int iRevision, const std::vector<unsigned int> &positions) const;
+
+    /*!
+     * @brief Replace the entries of this table in a search index with the current ones.
+     * @param index The search index.
+     * @return The revision of this table that was indexed.
+     */
+    virtual unsigned int UpdateSearchIndex(CEpgSearchIndex &index) const;
+
+    /*!
+     * @return The revision of the entries in this table, which changes every time they change.
+     */
+    virtual unsigned int Revision(void) const;
+
     /*!
      * @brief Persist this table in the database.
      * @param bUpdateLastScanTime True to update the last scan time in the db, false otherwise.
@@ -296,16 +324,47 @@ namespace EPG
     virtual bool FixOverlappingEvents(void);
 
     /*!
-     * @brief Sort all entries in this EPG by date.
+     * @brief Sort all entries in this EPG by date and rebuild the indexes.
      */
     virtual void Sort(void);
 
     /*!
-     * @brief Add an infotag to this container.
+     * @brief Add an infotag to the end of this container. Sort() has to be called after adding all tags.
      * @param tag The tag to add.
      */
     virtual void AddEntry(const CEpgInfoTag &tag);
 
+    /*!
+     * @brief Insert a tag at its place in this table and the indexes.
+     * @param tag The tag to insert.
+     */
+    virtual void InsertTag(CEpgInfoTag *tag);
+
+    /*!
+     * @brief Take the tag at the given position out of this table and the indexes, without deleting it.
+     * @param iPtr The position of the tag.
+     */
+    virtual void RemoveTag(unsigned int iPtr);
+
+    /*!
+     * @brief Delete the tags in [iFrom, iTo) from this table.
+     * @param iFrom The position of the first tag to delete.
+     * @param iTo The position after the last tag to delete.
+     */
+    virtual void DeleteTags(unsigned int iFrom, unsigned int iTo);
+
+    /*!
+     * @brief Get the position of a tag in this table.
+     * @param tag The tag.
+     * @return The position or -1 if the tag isn't in this table.
+     */
+    virtual int GetTagPosition(const CEpgInfoTag *tag) const;
+
+    /*!
+     * @brief Rebuild the time and unique broadcast ID indexes and the previous and next pointers from scratch.
+     */
+    virtual void RebuildIndex(void);
+
     /*!
      * @brief Load all EPG entries from clients into a temporary table and update this table with the contents of that temporary table.
      * @param start Only get entries after this start time. Use 0 to get all entries before "end".
@@ -324,6 +383,13 @@ namespace EPG
 
     virtual void UpdatePreviousAndNextPointers(void);
 
+    /*!
+     * @brief Update the previous and next pointers of the tags in [iFrom, iTo) and their neighbours.
+     * @param iFrom The position of the first tag to update.
+     * @param iTo The position after the last tag to update.
+     */
+    virtual void UpdatePreviousAndNextPointers(unsigned int iFrom, unsigned int iTo);
+
     /*!
      * @brief Update the cached first and last date.
      */
@@ -335,6 +401,7 @@ namespace EPG
     bool                       m_bTagsChanged;    /*!< true when any tags are changed and not persisted, false otherwise */
     bool                       m_bInhibitSorting; /*!< don't sort the table if this is true */
     bool                       m_bLoaded;         /*!< true when the initial entries have been loaded */
+    unsigned int               m_iRevision;       /*!< changes every time the entries change */
     int                        m_iEpgID;          /*!< the database ID of this table */
     CStdString                 m_strName;         /*!< the name of this table */
     CStdString                 m_strScraperName;  /*!< the name of the scraper to use */
@@ -346,6 +413,9 @@ namespace EPG
 
     PVR::CPVRChannel *         m_Channel;         /*!< the channel this EPG belongs to */
 
+    CEpgTimeIndex              m_timeIndex;       /*!< start and end times of the tags, in the order of this table */
+    std::map<int, CEpgInfoTag *> m_uniqueIds;     /*!< the tags by unique broadcast ID */
+
     mutable CCriticalSection   m_critSection;     /*!< critical section for changes in this table */
   };
 }
@@ -37,6 +37,8 @@
 #include "EpgInfoTag.h"
 #include "EpgSearchFilter.h"
 
+#include <algorithm>
+
 using namespace std;
 using namespace EPG;
 using namespace PVR;
@@ -103,6 +105,8 @@ void CEpgContainer::Clear(bool bClearDb /* = false */)
     for (unsigned int iEpgPtr = 0; iEpgPtr < m_epgs.size(); iEpgPtr++)
       delete m_epgs[iEpgPtr];
     m_epgs.clear();
+    m_searchIndex.Clear();
+    m_searchIndexRevisions.clear();
     m_iNextEpgUpdate  = 0;
     m_bIsInitialising = true;
   }
@@ -159,6 +163,20 @@ void CEpgContainer::LoadFromDB(void)
     m_database.Get(*this);
     m_database.Close();
   }
+
+  UpdateSearchIndex();
+}
+
+void CEpgContainer::UpdateSearchIndex(void)
+{
+  CSingleLock lock(m_critSection);
+  for (unsigned int iEpgPtr = 0; iEpgPtr < m_epgs.size(); iEpgPtr++)
+  {
+    CEpg *epg = m_epgs[iEpgPtr];
+    std::map<int, unsigned int>::const_iterator it = m_searchIndexRevisions.find(epg->EpgID());
+    if (it == m_searchIndexRevisions.end() || it->second != epg->Revision())
+      m_searchIndexRevisions[epg->EpgID()] = epg->UpdateSearchIndex(m_searchIndex);
+  }
 }
 
 void CEpgContainer::Process(void)
@@ -289,6 +307,7 @@ bool CEpgContainer::RemoveOldEntries(void)
   /* call Cleanup() on all known EPG tables */
   for (unsigned int iEpgPtr = 0; iEpgPtr < m_epgs.size(); iEpgPtr++)
     m_epgs[iEpgPtr]->Cleanup(now);
+  UpdateSearchIndex();
 
   /* remove the old entries from the database */
   if (!m_bIgnoreDbForClient)
@@ -338,6 +357,9 @@ bool CEpgContainer::DeleteEpg(const CEpg &epg, bool bDeleteFromDatabase /* = fal
         m_database.Close();
       }
 
+      m_searchIndex.RemoveTable(epg.EpgID());
+      m_searchIndexRevisions.erase(epg.EpgID());
+
       delete m_epgs[iEpgPtr];
       m_epgs.erase(m_epgs.begin() + iEpgPtr);
       bReturn = true;
@@ -482,6 +504,9 @@ bool CEpgContainer::UpdateEPG(bool bShowProgress /* = false */)
   if (bShowProgress)
     CloseProgressDialog();
 
+  /* index the tables that were updated */
+  UpdateSearchIndex();
+
   /* notify observers */
   if (iUpdatedTables > 0)
   {
@@ -541,10 +566,29 @@ int CEpgContainer::GetEPGSearch(CFileItemList &results, const EpgSearchFilter &f
 {
   int iInitialSize = results.Size();
 
-  /* get filtered results from all tables */
+  CEpgSearchIndex::Query query;
+  filter.GetIndexQuery(query);
+
+  /* look up the tags that may match in the index */
   CSingleLock lock(m_critSection);
+  UpdateSearchIndex();
+
+  vector<CEpgSearchIndex::Hit> hits;
+  m_searchIndex.Search(query, hits);
+
+  /* and let the tables check them against the filter */
+  vector<unsigned int> positions;
   for (unsigned int iEpgPtr = 0; iEpgPtr < m_epgs.size(); iEpgPtr++)
-    m_epgs[iEpgPtr]->Get(results, filter);
+  {
+    const CEpg *epg = m_epgs[iEpgPtr];
+    CEpgSearchIndex::Hit first = { epg->EpgID(), 0 };
+    positions.clear();
+    for (vector<CEpgSearchIndex::Hit>::const_iterator it = lower_bound(hits.begin(), hits.end(), first);
+        it != hits.end() && it->iTable == epg->EpgID(); it++)
+      positions.push_back(it->iPosition);
+
+    epg->Get(results, filter, m_searchIndexRevisions[epg->EpgID()], positions);
+  }
   lock.Leave();
 
   /* remove duplicate entries */
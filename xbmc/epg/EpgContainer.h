@@ -28,6 +28,7 @@
 
 #include "Epg.h"
 #include "EpgDatabase.h"
+#include "EpgSearchIndex.h"
 
 class CFileItemList;
 class CGUIDialogExtendedProgressBar;
@@ -255,6 +256,11 @@ namespace EPG
      */
     void LoadFromDB(void);
 
+    /*!
+     * @brief Index the tables that changed since they were indexed last.
+     */
+    void UpdateSearchIndex(void);
+
     CEpgDatabase m_database;           /*!< the EPG database */
 
     /** @name Configuration */
@@ -276,6 +282,12 @@ namespace EPG
     std::vector<CEpg*> m_epgs;         /*!< the EPGs in this container */
     //@}
 
+    /** @name Search index */
+    //@{
+    CEpgSearchIndex              m_searchIndex;          /*!< the words, genres and times of the tags in all tables */
+    std::map<int, unsigned int>  m_searchIndexRevisions; /*!< the revision each table was indexed at, by table ID */
+    //@}
+
     CGUIDialogExtendedProgressBar *m_progressDialog; /*!< the progress dialog that is visible when updating the first time */
     CCriticalSection               m_critSection;    /*!< a critical section for changes to this container */
     CEvent                         m_updateEvent;    /*!< trigger when an update finishes */
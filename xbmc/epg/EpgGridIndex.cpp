@@ -0,0 +1,111 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "EpgGridIndex.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace EPG;
+
+void CEpgGridIndex::Reset(int iChannels, int iBlocks, int iMinutesPerBlock, int iGridEnd)
+{
+  m_channels.clear();
+  m_channels.resize(max(iChannels, 0));
+  m_iBlocks          = max(iBlocks, 0);
+  m_iMinutesPerBlock = max(iMinutesPerBlock, 1);
+  m_iGridEnd         = iGridEnd;
+}
+
+bool CEpgGridIndex::IsBuilt(int iChannel) const
+{
+  return iChannel >= 0 && iChannel < Channels() && m_channels[iChannel].bBuilt;
+}
+
+size_t CEpgGridIndex::TakeChannelsToBuild(int iFirst, int iLast, vector<int> &channels)
+{
+  size_t iAdded = 0;
+  for (int iChannel = max(iFirst, 0); iChannel <= iLast && iChannel < Channels(); iChannel++)
+  {
+    Channel &channel = m_channels[iChannel];
+    if (channel.bBuilt || channel.bPending)
+      continue;
+
+    channel.bPending = true;
+    channels.push_back(iChannel);
+    iAdded++;
+  }
+
+  return iAdded;
+}
+
+void CEpgGridIndex::SetRuns(int iChannel, vector<Run> &runs)
+{
+  if (iChannel < 0 || iChannel >= Channels())
+    return;
+
+  Channel &channel = m_channels[iChannel];
+  channel.runs.swap(runs);
+  channel.bBuilt   = true;
+  channel.bPending = false;
+}
+
+int CEpgGridIndex::FindRun(int iChannel, int iBlock) const
+{
+  if (!IsBuilt(iChannel) || iBlock < 0 || iBlock >= m_iBlocks)
+    return -1;
+
+  /* the runs cover all blocks, so the last run that starts at or before the block has it */
+  const vector<Run> &runs = m_channels[iChannel].runs;
+  vector<Run>::const_iterator it = upper_bound(runs.begin(), runs.end(), iBlock, StartBlockLess());
+  if (it == runs.begin())
+    return -1;
+
+  return (int) (it - runs.begin()) - 1;
+}
+
+void CEpgGridIndex::GetRuns(const vector<Programme> &programmes, int iBlocks, int iMinutesPerBlock, int iGridEnd, vector<Run> &runs)
+{
+  runs.clear();
+
+  int iBlock = 0;
+  for (size_t iPtr = 0; iPtr < programmes.size() && iBlock < iBlocks; iPtr++)
+  {
+    const Programme &programme = programmes[iPtr];
+    if (programme.iStart >= iGridEnd)
+      break;
+
+    /* the programme has the blocks that start before it ends, that the previous ones didn't take */
+    int iEndBlock = programme.iEnd <= 0 ? 0 : min(iBlocks, (programme.iEnd + iMinutesPerBlock - 1) / iMinutesPerBlock);
+    if (iEndBlock <= iBlock)
+      continue;
+
+    Run run = { iBlock, iEndBlock, (int) iPtr };
+    runs.push_back(run);
+    iBlock = iEndBlock;
+  }
+
+  if (iBlock < iBlocks)
+  {
+    Run gap = { iBlock, iBlocks, EPG_GRID_INDEX_GAP };
+    runs.push_back(gap);
+  }
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stddef.h>
+#include <vector>
+
+/** Block index of the EPG grid */
+namespace EPG
+{
+  #define EPG_GRID_INDEX_GAP (-1)
+
+  /*!
+   * @brief The blocks each programme of each channel covers in the EPG grid.
+   *
+   * Every channel is stored as a list of runs of blocks that show the same
+   * programme, so a lookup is a binary search over the few hundred programmes
+   * of a channel instead of a cell in a channels x blocks array.
+   *
+   * Channels are built one by one, when they're needed. The runs of a channel
+   * can be calculated without the index, so that can be done on another thread.
+   */
+  class CEpgGridIndex
+  {
+  public:
+    /*!
+     * @brief The times of a programme in minutes after the start of the grid.
+     */
+    struct Programme
+    {
+      int iStart; /*!< the start time, rounded down */
+      int iEnd;   /*!< the end time, rounded up */
+    };
+
+    /*!
+     * @brief Blocks that show the same programme.
+     */
+    struct Run
+    {
+      int iStartBlock; /*!< the first block */
+      int iEndBlock;   /*!< the block after the last block */
+      int iProgramme;  /*!< the position of the programme in the channel or EPG_GRID_INDEX_GAP */
+    };
+
+    CEpgGridIndex(void) : m_iBlocks(0), m_iMinutesPerBlock(1), m_iGridEnd(0) {}
+
+    /*!
+     * @brief Drop all runs and set up the index for a new grid.
+     * @param iChannels The amount of channels.
+     * @param iBlocks The amount of blocks of each channel.
+     * @param iMinutesPerBlock The length of a block in minutes.
+     * @param iGridEnd The end of the grid in minutes after its start.
+     */
+    void Reset(int iChannels, int iBlocks, int iMinutesPerBlock, int iGridEnd);
+
+    int Channels(void) const { return (int) m_channels.size(); }
+    int Blocks(void) const { return m_iBlocks; }
+    int MinutesPerBlock(void) const { return m_iMinutesPerBlock; }
+    int GridEnd(void) const { return m_iGridEnd; }
+
+    /*!
+     * @return True if the runs of the channel have been set, false otherwise.
+     */
+    bool IsBuilt(int iChannel) const;
+
+    /*!
+     * @brief Get the channels in [iFirst, iLast] that are neither built nor being built, and mark them as being built.
+     * @param iFirst The first channel, clamped to the index.
+     * @param iLast The last channel, clamped to the index.
+     * @param channels The channels that have to be built.
+     * @return The amount of channels that were added.
+     */
+    size_t TakeChannelsToBuild(int iFirst, int iLast, std::vector<int> &channels);
+
+    /*!
+     * @brief Set the runs of a channel and mark it as built.
+     * @param iChannel The channel.
+     * @param runs The runs, as returned by GetRuns(). Swapped into the index.
+     */
+    void SetRuns(int iChannel, std::vector<Run> &runs);
+
+    /*!
+     * @return The runs of a channel, empty if it's not built yet.
+     */
+    const std::vector<Run> &GetRuns(int iChannel) const { return m_channels[iChannel].runs; }
+
+    /*!
+     * @brief Find the run a block is in.
+     * @param iChannel The channel.
+     * @param iBlock The block.
+     * @return The position of the run or -1 if the channel isn't built or the block is out of range.
+     */
+    int FindRun(int iChannel, int iBlock) const;
+
+    /*!
+     * @brief Calculate the runs of a channel.
+     *
+     * A block shows the first programme that hasn't ended when the block starts,
+     * so the blocks before a programme starts belong to it too. A programme that
+     * starts at or after the end of the grid and everything after it is left out,
+     * the blocks that are left over are one gap.
+     *
+     * @param programmes The programmes of the channel, in order.
+     * @param iBlocks The amount of blocks.
+     * @param iMinutesPerBlock The length of a block in minutes.
+     * @param iGridEnd The end of the grid in minutes after its start.
+     * @param runs The runs, covering all blocks.
+     */
+    static void GetRuns(const std::vector<Programme> &programmes, int iBlocks, int iMinutesPerBlock, int iGridEnd, std::vector<Run> &runs);
+
+  private:
+    struct Channel
+    {
+      Channel(void) : bBuilt(false), bPending(false) {}
+
+      bool             bBuilt;   /*!< true when the runs have been set */
+      bool             bPending; /*!< true while the runs are being built */
+      std::vector<Run> runs;     /*!< the runs, in order */
+    };
+
+    struct StartBlockLess
+    {
+      bool operator()(int iBlock, const Run &run) const { return iBlock < run.iStartBlock; }
+    };
+
+    std::vector<Channel> m_channels;         /*!< all channels of the grid */
+    int                  m_iBlocks;          /*!< the amount of blocks of each channel */
+    int                  m_iMinutesPerBlock; /*!< the length of a block in minutes */
+    int                  m_iGridEnd;         /*!< the end of the grid in minutes after its start */
+  };
+}
@@ -20,6 +20,7 @@
  */
 
 #include "guilib/LocalizeStrings.h"
+#include "utils/Crc32.h"
 #include "utils/TextSearch.h"
 #include "utils/log.h"
 #include "FileItem.h"
@@ -119,32 +120,84 @@ bool EpgSearchFilter::FilterEntry(const CEpgInfoTag &tag) const
        (!m_bFTAOnly || !tag.ChannelTag()->IsEncrypted())));
 }
 
+void EpgSearchFilter::GetIndexQuery(CEpgSearchIndex::Query &query) const
+{
+  if (!m_strSearchTerm.IsEmpty())
+  {
+    CTextSearch search(m_strSearchTerm, m_bIsCaseSensitive, SEARCH_DEFAULT_OR);
+    query.andTerms.assign(search.GetAndTerms().begin(), search.GetAndTerms().end());
+    query.orTerms.assign(search.GetOrTerms().begin(), search.GetOrTerms().end());
+  }
+
+  if (m_iGenreType != EPG_SEARCH_UNSET && !m_bIncludeUnknownGenres)
+    query.iGenreType = m_iGenreType;
+
+  /* the index has the times in UTC and these are local times. leave a day of
+     room for the time zone, FilterEntry() checks the exact times */
+  time_t iTime;
+  if (m_startDateTime.IsValid())
+  {
+    m_startDateTime.GetAsTime(iTime);
+    query.iMinStart = (int64_t) iTime - 24 * 60 * 60;
+  }
+  if (m_endDateTime.IsValid())
+  {
+    m_endDateTime.GetAsTime(iTime);
+    query.iMaxEnd = (int64_t) iTime + 24 * 60 * 60;
+  }
+}
+
 int EpgSearchFilter::RemoveDuplicates(CFileItemList &results)
 {
-  unsigned int iSize = results.Size();
+  /* hash the title, plot and plot outline of each tag and only compare the tags with the same hash */
+  multimap<uint32_t, const CEpgInfoTag *> tags;
+  vector<CFileItemPtr> items;
+  items.reserve(results.Size());
 
-  for (unsigned int iResultPtr = 0; iResultPtr < iSize; iResultPtr++)
+  for (int iResultPtr = 0; iResultPtr < results.Size(); iResultPtr++)
   {
-    const CEpgInfoTag *epgentry_1 = results.Get(iResultPtr)->GetEPGInfoTag();
-    for (unsigned int iTagPtr = 0; iTagPtr < iSize; iTagPtr++)
+    const CFileItemPtr &item = results.Get(iResultPtr);
+    const CEpgInfoTag *tag = item->GetEPGInfoTag();
+    if (!tag)
     {
-      const CEpgInfoTag *epgentry_2 = results.Get(iTagPtr)->GetEPGInfoTag();
-      if (iResultPtr == iTagPtr)
-        continue;
+      items.push_back(item);
+      continue;
+    }
 
-      if (epgentry_1->Title()       != epgentry_2->Title() ||
-          epgentry_1->Plot()        != epgentry_2->Plot() ||
-          epgentry_1->PlotOutline() != epgentry_2->PlotOutline())
-        continue;
+    CStdString strTitle(tag->Title());
+    CStdString strPlot(tag->Plot());
+    CStdString strPlotOutline(tag->PlotOutline());
 
-      results.Remove(iTagPtr);
-      iResultPtr--;
-      iTagPtr--;
-      iSize--;
+    Crc32 crc;
+    crc.Compute(strTitle);
+    crc.Compute(strPlot);
+    crc.Compute(strPlotOutline);
+
+    bool bDuplicate(false);
+    pair<multimap<uint32_t, const CEpgInfoTag *>::iterator, multimap<uint32_t, const CEpgInfoTag *>::iterator> range = tags.equal_range(crc);
+    for (multimap<uint32_t, const CEpgInfoTag *>::iterator it = range.first; !bDuplicate && it != range.second; it++)
+    {
+      bDuplicate = it->second->Title()       == strTitle &&
+                   it->second->Plot()        == strPlot &&
+                   it->second->PlotOutline() == strPlotOutline;
     }
+
+    if (!bDuplicate)
+    {
+      tags.insert(make_pair((uint32_t) crc, tag));
+      items.push_back(item);
+    }
+  }
+
+  /* put the ones to keep back in one go, removing them one by one moves all following items every time */
+  if ((int) items.size() < results.Size())
+  {
+    results.ClearItems();
+    for (unsigned int iItemPtr = 0; iItemPtr < items.size(); iItemPtr++)
+      results.Add(items[iItemPtr]);
   }
 
-  return iSize;
+  return results.Size();
 }
 
 
@@ -22,6 +22,7 @@
  */
 
 #include "XBDateTime.h"
+#include "EpgSearchIndex.h"
 
 class CFileItemList;
 
@@ -57,6 +58,17 @@ namespace EPG
     virtual bool MatchChannelNumber(const CEpgInfoTag &tag) const;
     virtual bool MatchChannelGroup(const CEpgInfoTag &tag) const;
 
+    /*!
+     * @brief Get the query to look up the tags that may match this filter in the search index.
+     * @param query The query to fill in.
+     */
+    virtual void GetIndexQuery(CEpgSearchIndex::Query &query) const;
+
+    /*!
+     * @brief Remove all but the first of the results with the same title, plot and plot outline.
+     * @param results The results.
+     * @return The amount of results that is left.
+     */
     static int RemoveDuplicates(CFileItemList &results);
 
     CStdString    m_strSearchTerm;            /*!< The term to search for */
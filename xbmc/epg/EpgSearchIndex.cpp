@@ -0,0 +1,300 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "EpgSearchIndex.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace EPG;
+
+/* the most terms a query can be narrowed down on, one mark value each */
+#define MAX_QUERY_GROUPS 254
+
+/* the new ID of an event that is dropped when compacting */
+#define DELETED_EVENT ((unsigned int) -1)
+
+/* an empty bucket in the hash table of the dictionary */
+#define NO_WORD ((unsigned int) -1)
+
+/* bytes of multibyte characters are kept as they are, they're part of a word too */
+static inline bool IsWordCharacter(unsigned char c)
+{
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c >= 0x80;
+}
+
+static inline char ToLower(unsigned char c)
+{
+  return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+/* find the next word in strText from iPtr on and move iPtr past it */
+static bool GetNextWord(const string &strText, size_t &iPtr, string &strWord)
+{
+  strWord.clear();
+  for (; iPtr < strText.size(); iPtr++)
+  {
+    if (IsWordCharacter(strText[iPtr]))
+      strWord += ToLower(strText[iPtr]);
+    else if (!strWord.empty())
+      break;
+  }
+
+  return !strWord.empty();
+}
+
+void CEpgSearchIndex::GetWords(const string &strText, vector<string> &words)
+{
+  string strWord;
+  size_t iPtr = 0;
+  while (GetNextWord(strText, iPtr, strWord))
+    words.push_back(strWord);
+}
+
+void CEpgSearchIndex::Clear(void)
+{
+  m_events.clear();
+  m_words.clear();
+  m_wordTable.clear();
+  m_postings.clear();
+  m_tables.clear();
+  m_iDeleted = 0;
+}
+
+/* FNV-1a */
+static inline uint32_t HashWord(const string &strWord)
+{
+  uint32_t iHash = 2166136261u;
+  for (size_t iPtr = 0; iPtr < strWord.size(); iPtr++)
+    iHash = (iHash ^ (unsigned char) strWord[iPtr]) * 16777619u;
+  return iHash;
+}
+
+unsigned int CEpgSearchIndex::GetWordId(const string &strWord)
+{
+  /* keep the table at most half full */
+  if (m_words.size() * 2 >= m_wordTable.size())
+    RehashWords(max((size_t) 1024, m_wordTable.size() * 2));
+
+  size_t iMask = m_wordTable.size() - 1;
+  size_t iBucket = HashWord(strWord) & iMask;
+  while (m_wordTable[iBucket] != NO_WORD)
+  {
+    if (m_words[m_wordTable[iBucket]] == strWord)
+      return m_wordTable[iBucket];
+    iBucket = (iBucket + 1) & iMask;
+  }
+
+  unsigned int iWordId = m_words.size();
+  m_wordTable[iBucket] = iWordId;
+  m_words.push_back(strWord);
+  m_postings.push_back(vector<unsigned int>());
+
+  return iWordId;
+}
+
+void CEpgSearchIndex::RehashWords(size_t iBuckets)
+{
+  m_wordTable.assign(iBuckets, NO_WORD);
+
+  size_t iMask = iBuckets - 1;
+  for (unsigned int iWordId = 0; iWordId < m_words.size(); iWordId++)
+  {
+    size_t iBucket = HashWord(m_words[iWordId]) & iMask;
+    while (m_wordTable[iBucket] != NO_WORD)
+      iBucket = (iBucket + 1) & iMask;
+    m_wordTable[iBucket] = iWordId;
+  }
+}
+
+void CEpgSearchIndex::AddEvent(int iTable, unsigned int iPosition, const string &strTitle, const string &strPlotOutline,
+    int iGenreType, int64_t iStart, int64_t iEnd)
+{
+  unsigned int iEventId = m_events.size();
+  Event event = { iTable, iPosition, iGenreType, false, iStart, iEnd };
+  m_events.push_back(event);
+  m_tables[iTable].push_back(iEventId);
+
+  AddWords(iEventId, strTitle);
+  AddWords(iEventId, strPlotOutline);
+}
+
+void CEpgSearchIndex::AddWords(unsigned int iEventId, const string &strText)
+{
+  string strWord;
+  size_t iPtr = 0;
+  while (GetNextWord(strText, iPtr, strWord))
+  {
+    /* event IDs only grow, so the postings stay sorted and a word that's used twice is at the end already */
+    vector<unsigned int> &postings = m_postings[GetWordId(strWord)];
+    if (postings.empty() || postings.back() != iEventId)
+      postings.push_back(iEventId);
+  }
+}
+
+void CEpgSearchIndex::RemoveTable(int iTable)
+{
+  map<int, vector<unsigned int> >::iterator it = m_tables.find(iTable);
+  if (it == m_tables.end())
+    return;
+
+  for (size_t iPtr = 0; iPtr < it->second.size(); iPtr++)
+    m_events[it->second[iPtr]].bDeleted = true;
+  m_iDeleted += it->second.size();
+  m_tables.erase(it);
+
+  if (m_iDeleted > Size())
+    Compact();
+}
+
+void CEpgSearchIndex::Compact(void)
+{
+  /* give the events that are left new IDs, in the same order */
+  vector<unsigned int> newIds(m_events.size(), DELETED_EVENT);
+  unsigned int iNewId = 0;
+  for (size_t iEventId = 0; iEventId < m_events.size(); iEventId++)
+  {
+    if (m_events[iEventId].bDeleted)
+      continue;
+
+    newIds[iEventId] = iNewId;
+    m_events[iNewId++] = m_events[iEventId];
+  }
+  m_events.resize(iNewId);
+  m_iDeleted = 0;
+
+  for (map<int, vector<unsigned int> >::iterator it = m_tables.begin(); it != m_tables.end(); it++)
+  {
+    for (size_t iPtr = 0; iPtr < it->second.size(); iPtr++)
+      it->second[iPtr] = newIds[it->second[iPtr]];
+  }
+
+  /* and drop the words that only deleted events used */
+  vector<string> words;
+  vector<vector<unsigned int> > postings;
+  for (size_t iWordId = 0; iWordId < m_words.size(); iWordId++)
+  {
+    vector<unsigned int> eventIds;
+    const vector<unsigned int> &oldEventIds = m_postings[iWordId];
+    for (size_t iPtr = 0; iPtr < oldEventIds.size(); iPtr++)
+    {
+      if (newIds[oldEventIds[iPtr]] != DELETED_EVENT)
+        eventIds.push_back(newIds[oldEventIds[iPtr]]);
+    }
+
+    if (!eventIds.empty())
+    {
+      words.push_back(string());
+      words.back().swap(m_words[iWordId]);
+      postings.push_back(vector<unsigned int>());
+      postings.back().swap(eventIds);
+    }
+  }
+  m_words.swap(words);
+  m_postings.swap(postings);
+  RehashWords(m_wordTable.size());
+}
+
+void CEpgSearchIndex::MarkEvents(const vector<string> &words, vector<unsigned char> &marks, unsigned char iMark) const
+{
+  for (size_t iWordId = 0; iWordId < m_words.size(); iWordId++)
+  {
+    for (size_t iWordPtr = 0; iWordPtr < words.size(); iWordPtr++)
+    {
+      if (m_words[iWordId].find(words[iWordPtr]) == string::npos)
+        continue;
+
+      const vector<unsigned int> &postings = m_postings[iWordId];
+      for (size_t iPtr = 0; iPtr < postings.size(); iPtr++)
+      {
+        if (marks[postings[iPtr]] == iMark)
+          marks[postings[iPtr]] = iMark + 1;
+      }
+      break;
+    }
+  }
+}
+
+size_t CEpgSearchIndex::Search(const Query &query, vector<Hit> &hits) const
+{
+  hits.clear();
+
+  /* every word of every AND term has to be found */
+  vector<vector<string> > groups;
+  for (size_t iTermPtr = 0; iTermPtr < query.andTerms.size(); iTermPtr++)
+  {
+    vector<string> words;
+    GetWords(query.andTerms[iTermPtr], words);
+    for (size_t iWordPtr = 0; iWordPtr < words.size(); iWordPtr++)
+      groups.push_back(vector<string>(1, words[iWordPtr]));
+  }
+
+  /* and one of the OR terms. the longest word of each of them is enough to narrow it down */
+  vector<string> orWords;
+  for (size_t iTermPtr = 0; iTermPtr < query.orTerms.size(); iTermPtr++)
+  {
+    vector<string> words;
+    GetWords(query.orTerms[iTermPtr], words);
+
+    /* a term without words could be part of anything */
+    if (words.empty())
+    {
+      orWords.clear();
+      break;
+    }
+
+    string strLongest;
+    for (size_t iWordPtr = 0; iWordPtr < words.size(); iWordPtr++)
+    {
+      if (words[iWordPtr].size() > strLongest.size())
+        strLongest = words[iWordPtr];
+    }
+    orWords.push_back(strLongest);
+  }
+  if (!orWords.empty())
+    groups.push_back(orWords);
+
+  if (groups.size() > MAX_QUERY_GROUPS)
+    groups.resize(MAX_QUERY_GROUPS);
+
+  vector<unsigned char> marks(m_events.size(), 0);
+  for (size_t iGroupPtr = 0; iGroupPtr < groups.size(); iGroupPtr++)
+    MarkEvents(groups[iGroupPtr], marks, (unsigned char) iGroupPtr);
+
+  for (size_t iEventId = 0; iEventId < m_events.size(); iEventId++)
+  {
+    const Event &event = m_events[iEventId];
+    if (marks[iEventId] != groups.size() ||
+        event.bDeleted ||
+        (query.iGenreType != EPG_SEARCH_INDEX_UNSET && event.iGenreType != query.iGenreType) ||
+        (query.iMinStart != 0 && event.iStart < query.iMinStart) ||
+        (query.iMaxEnd != 0 && event.iEnd > query.iMaxEnd))
+      continue;
+
+    Hit hit = { event.iTable, event.iPosition };
+    hits.push_back(hit);
+  }
+
+  /* tables that were indexed again are at the end */
+  sort(hits.begin(), hits.end());
+
+  return hits.size();
+}
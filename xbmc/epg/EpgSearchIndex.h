@@ -0,0 +1,180 @@
+#pragma once
+
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+/** Full-text index for the events of all EPG tables */
+namespace EPG
+{
+  #define EPG_SEARCH_INDEX_UNSET (-1)
+
+  /*!
+   * @brief Inverted index of the words in the title and plot outline of EPG events.
+   *
+   * Every word maps to the sorted list of events it appears in. Each event also
+   * keeps its table, its position in that table, its genre and its times, so a
+   * search can narrow down on those without looking at the tags.
+   *
+   * A search term matches every word it is a part of, the way CTextSearch matches
+   * substrings, so the results are a superset of what CTextSearch would find.
+   * The caller still has to check the events it gets back against the filter.
+   *
+   * Events are indexed per table. Removing a table only marks its events as
+   * deleted, the postings are compacted once there are more deleted than
+   * live events.
+   */
+  class CEpgSearchIndex
+  {
+  public:
+    /*!
+     * @brief What to search for.
+     */
+    struct Query
+    {
+      Query(void) :
+        iGenreType(EPG_SEARCH_INDEX_UNSET),
+        iMinStart(0),
+        iMaxEnd(0) {}
+
+      std::vector<std::string> andTerms;   /*!< all of these have to be found */
+      std::vector<std::string> orTerms;    /*!< one of these has to be found, if any are set */
+      int                      iGenreType; /*!< the genre type of the event or EPG_SEARCH_INDEX_UNSET for any */
+      int64_t                  iMinStart;  /*!< the minimum start time of the event or 0 for any */
+      int64_t                  iMaxEnd;    /*!< the maximum end time of the event or 0 for any */
+    };
+
+    /*!
+     * @brief An event that was found.
+     */
+    struct Hit
+    {
+      int          iTable;    /*!< the ID of the table the event is in */
+      unsigned int iPosition; /*!< the position of the event in that table when it was indexed */
+
+      bool operator <(const Hit &right) const
+      {
+        return iTable < right.iTable || (iTable == right.iTable && iPosition < right.iPosition);
+      }
+    };
+
+    CEpgSearchIndex(void) : m_iDeleted(0) {}
+
+    /*!
+     * @brief Remove all events from the index.
+     */
+    void Clear(void);
+
+    /*!
+     * @return The amount of events in the index that haven't been removed.
+     */
+    size_t Size(void) const { return m_events.size() - m_iDeleted; }
+
+    /*!
+     * @brief Add an event. The events of a table have to be added in the order of that table.
+     * @param iTable The ID of the table the event is in.
+     * @param iPosition The position of the event in that table.
+     * @param strTitle The title of the event.
+     * @param strPlotOutline The plot outline of the event.
+     * @param iGenreType The genre type of the event.
+     * @param iStart The start time of the event.
+     * @param iEnd The end time of the event.
+     */
+    void AddEvent(int iTable, unsigned int iPosition, const std::string &strTitle, const std::string &strPlotOutline,
+        int iGenreType, int64_t iStart, int64_t iEnd);
+
+    /*!
+     * @brief Remove all events of a table.
+     * @param iTable The ID of the table.
+     */
+    void RemoveTable(int iTable);
+
+    /*!
+     * @brief Find the events that may match a query.
+     * @param query The query.
+     * @param hits The events that were found, sorted by table and position.
+     * @return The amount of events that were found.
+     */
+    size_t Search(const Query &query, std::vector<Hit> &hits) const;
+
+    /*!
+     * @brief Split a text into lower case words, the way it's indexed.
+     * @param strText The text to split.
+     * @param words The words that were found.
+     */
+    static void GetWords(const std::string &strText, std::vector<std::string> &words);
+
+  private:
+    struct Event
+    {
+      int          iTable;
+      unsigned int iPosition;
+      int          iGenreType;
+      bool         bDeleted;
+      int64_t      iStart;
+      int64_t      iEnd;
+    };
+
+    /*!
+     * @brief Add the words of a text to the postings of an event.
+     * @param iEventId The ID of the event.
+     * @param strText The text.
+     */
+    void AddWords(unsigned int iEventId, const std::string &strText);
+
+    /*!
+     * @brief Add a word to the dictionary if it's not in there yet.
+     * @return The ID of the word.
+     */
+    unsigned int GetWordId(const std::string &strWord);
+
+    /*!
+     * @brief Rebuild the hash table of the dictionary with the given amount of buckets.
+     * @param iBuckets The amount of buckets, a power of two.
+     */
+    void RehashWords(size_t iBuckets);
+
+    /*!
+     * @brief Mark the events that contain a word that one of the given words is a part of.
+     * @param words The words to look for.
+     * @param marks The marks of all events. Events that are marked iMark are marked iMark + 1.
+     * @param iMark The mark an event needs to have to be marked again.
+     */
+    void MarkEvents(const std::vector<std::string> &words, std::vector<unsigned char> &marks, unsigned char iMark) const;
+
+    /*!
+     * @brief Drop the deleted events and the words that aren't used any more.
+     */
+    void Compact(void);
+
+    std::vector<Event>                        m_events;    /*!< all indexed events, by ID */
+    std::vector<std::string>                  m_words;     /*!< the dictionary, by word ID */
+    std::vector<unsigned int>                 m_wordTable; /*!< open addressing hash table of the word IDs */
+    std::vector<std::vector<unsigned int> >   m_postings;  /*!< the IDs of the events each word appears in, by word ID */
+    std::map<int, std::vector<unsigned int> > m_tables;    /*!< the IDs of the events of each table */
+    size_t                                    m_iDeleted;  /*!< the amount of events marked as deleted */
+  };
+}
@@ -0,0 +1,114 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "EpgTimeIndex.h"
+
+#include <algorithm>
+
+using namespace EPG;
+
+void CEpgTimeIndex::Clear(void)
+{
+  m_times.clear();
+}
+
+size_t CEpgTimeIndex::InsertPosition(int64_t iStart) const
+{
+  return FirstStartingAfter(iStart);
+}
+
+void CEpgTimeIndex::Insert(size_t iPtr, int64_t iStart, int64_t iEnd)
+{
+  Times times = { iStart, iEnd, iEnd };
+  m_times.insert(m_times.begin() + iPtr, times);
+  UpdateMaxEnd(iPtr);
+}
+
+void CEpgTimeIndex::Set(size_t iPtr, int64_t iStart, int64_t iEnd)
+{
+  m_times[iPtr].iStart = iStart;
+  m_times[iPtr].iEnd   = iEnd;
+  UpdateMaxEnd(iPtr);
+}
+
+void CEpgTimeIndex::Erase(size_t iFrom, size_t iTo)
+{
+  if (iFrom >= iTo)
+    return;
+
+  m_times.erase(m_times.begin() + iFrom, m_times.begin() + iTo);
+  UpdateMaxEnd(iFrom);
+}
+
+void CEpgTimeIndex::UpdateMaxEnd(size_t iPtr)
+{
+  for (size_t iCurrent = iPtr; iCurrent < m_times.size(); iCurrent++)
+  {
+    int64_t iMaxEnd = m_times[iCurrent].iEnd;
+    if (iCurrent > 0 && m_times[iCurrent - 1].iMaxEnd > iMaxEnd)
+      iMaxEnd = m_times[iCurrent - 1].iMaxEnd;
+
+    /* the following entries only depend on this one, so stop as soon as it didn't change */
+    if (iCurrent > iPtr && m_times[iCurrent].iMaxEnd == iMaxEnd)
+      break;
+
+    m_times[iCurrent].iMaxEnd = iMaxEnd;
+  }
+}
+
+int CEpgTimeIndex::FindAround(int64_t iTime, bool bEndInclusive) const
+{
+  /* events starting after iTime can't be running yet */
+  std::vector<Times>::const_iterator last = std::upper_bound(m_times.begin(), m_times.end(), iTime, StartLess());
+
+  /* and all events before the first one with a maximum end time past iTime have ended already */
+  std::vector<Times>::const_iterator it = std::lower_bound(m_times.begin(), last, bEndInclusive ? iTime : iTime + 1, MaxEndLess());
+
+  for (; it != last; it++)
+  {
+    if (it->iEnd > iTime || (bEndInclusive && it->iEnd == iTime))
+      return (int) (it - m_times.begin());
+  }
+
+  return -1;
+}
+
+int CEpgTimeIndex::FindBetween(int64_t iBegin, int64_t iEnd) const
+{
+  /* an event starting after iEnd can't end before it */
+  for (size_t iPtr = FirstStartingFrom(iBegin); iPtr < m_times.size() && m_times[iPtr].iStart <= iEnd; iPtr++)
+  {
+    if (m_times[iPtr].iEnd <= iEnd)
+      return (int) iPtr;
+  }
+
+  return -1;
+}
+
+size_t CEpgTimeIndex::FirstStartingFrom(int64_t iTime) const
+{
+  return std::lower_bound(m_times.begin(), m_times.end(), iTime, StartLess()) - m_times.begin();
+}
+
+size_t CEpgTimeIndex::FirstStartingAfter(int64_t iTime) const
+{
+  return std::upper_bound(m_times.begin(), m_times.end(), iTime, StartLess()) - m_times.begin();
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/** Time index for the events of an EPG table */
+namespace EPG
+{
+  /*!
+   * @brief Start and end times of a list of events that is sorted by start time.
+   *
+   * Times are stored as seconds since the epoch in UTC, next to the latest
+   * end time of all events up to each position. That running maximum only
+   * ever grows, so the events running at a given time can be found with two
+   * binary searches, also when events overlap.
+   */
+  class CEpgTimeIndex
+  {
+  public:
+    CEpgTimeIndex(void) {}
+
+    /*!
+     * @brief Remove all events from the index.
+     */
+    void Clear(void);
+
+    /*!
+     * @return The amount of events in the index.
+     */
+    size_t Size(void) const { return m_times.size(); }
+
+    /*!
+     * @brief Get the position a new event with the given start time has to be inserted at.
+     * @param iStart The start time of the event.
+     * @return The position after all events starting at or before iStart.
+     */
+    size_t InsertPosition(int64_t iStart) const;
+
+    /*!
+     * @brief Insert an event.
+     * @param iPtr The position to insert the event at. Must keep the index sorted by start time.
+     * @param iStart The start time of the event.
+     * @param iEnd The end time of the event.
+     */
+    void Insert(size_t iPtr, int64_t iStart, int64_t iEnd);
+
+    /*!
+     * @brief Change the times of an event.
+     * @param iPtr The position of the event.
+     * @param iStart The new start time. Must keep the index sorted by start time.
+     * @param iEnd The new end time.
+     */
+    void Set(size_t iPtr, int64_t iStart, int64_t iEnd);
+
+    /*!
+     * @brief Remove the events in [iFrom, iTo).
+     * @param iFrom The position of the first event to remove.
+     * @param iTo The position after the last event to remove.
+     */
+    void Erase(size_t iFrom, size_t iTo);
+
+    /*!
+     * @brief Find the first event that is running at the given time.
+     * @param iTime The time.
+     * @param bEndInclusive True to include events ending at iTime, false otherwise.
+     * @return The position of the event or -1 if there is none.
+     */
+    int FindAround(int64_t iTime, bool bEndInclusive) const;
+
+    /*!
+     * @brief Find the first event that starts at or after iBegin and ends at or before iEnd.
+     * @param iBegin The minimum start time.
+     * @param iEnd The maximum end time.
+     * @return The position of the event or -1 if there is none.
+     */
+    int FindBetween(int64_t iBegin, int64_t iEnd) const;
+
+    /*!
+     * @return The position of the first event starting at or after iTime, Size() if there is none.
+     */
+    size_t FirstStartingFrom(int64_t iTime) const;
+
+    /*!
+     * @return The position of the first event starting after iTime, Size() if there is none.
+     */
+    size_t FirstStartingAfter(int64_t iTime) const;
+
+    int64_t Start(size_t iPtr) const { return m_times[iPtr].iStart; }
+    int64_t End(size_t iPtr) const { return m_times[iPtr].iEnd; }
+
+  private:
+    struct Times
+    {
+      int64_t iStart;   /*!< start time of the event */
+      int64_t iEnd;     /*!< end time of the event */
+      int64_t iMaxEnd;  /*!< latest end time of this and all previous events */
+    };
+
+    struct StartLess
+    {
+      bool operator()(const Times &times, int64_t iTime) const { return times.iStart < iTime; }
+      bool operator()(int64_t iTime, const Times &times) const { return iTime < times.iStart; }
+    };
+
+    struct MaxEndLess
+    {
+      bool operator()(const Times &times, int64_t iTime) const { return times.iMaxEnd < iTime; }
+    };
+
+    /*!
+     * @brief Recalculate the running maximum of the end times from iPtr on.
+     */
+    void UpdateMaxEnd(size_t iPtr);
+
+    std::vector<Times> m_times; /*!< the times of the events, in order */
+  };
+}
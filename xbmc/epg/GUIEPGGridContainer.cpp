@@ -28,6 +28,8 @@
 #include "lib/tinyXML/tinyxml.h"
 #include "utils/log.h"
 #include "utils/Variant.h"
+#include "utils/JobManager.h"
+#include "threads/SingleLock.h"
 #include "threads/SystemClock.h"
 #include "GUIInfoManager.h"
 
@@ -43,6 +45,88 @@ using namespace EPG;
 #define MINSPERBLOCK 5 /// would be nice to offer zooming of busy schedules /// performance cost to increase resolution 5 fold?
 #define BLOCKJUMP    4 // how many blocks are jumped with each analogue scroll action
 
+namespace EPG
+{
+  /* the runs of channels built by CGUIEPGGridIndexJob, until the container installs them */
+  class CGUIEPGGridIndexResults
+  {
+  public:
+    CGUIEPGGridIndexResults(void) : m_bCancelled(false) {}
+
+    CCriticalSection m_critSection;
+    bool             m_bCancelled; // set when the container drops its items, the tags must not be read any more
+    std::vector< std::pair<int, std::vector<CEpgGridIndex::Run> > > m_channels;
+  };
+}
+
+/* the times of the tags of a channel in minutes after the start of the grid. tags that are missing take no blocks */
+static void GetGridProgrammes(const std::vector<const CEpgInfoTag *> &tags, const CDateTime &gridStart, std::vector<CEpgGridIndex::Programme> &programmes)
+{
+  time_t gridStartTime;
+  gridStart.GetAsTime(gridStartTime);
+
+  programmes.resize(tags.size());
+  for (unsigned int i = 0; i < tags.size(); i++)
+  {
+    CEpgGridIndex::Programme &programme = programmes[i];
+    programme.iStart = programme.iEnd = 0;
+    if (!tags[i])
+      continue;
+
+    time_t start, end;
+    tags[i]->StartAsLocalTime().GetAsTime(start);
+    tags[i]->EndAsLocalTime().GetAsTime(end);
+
+    /* round the start down and the end up, so they compare with whole minutes like the times themselves */
+    long startOffset = (long)(start - gridStartTime);
+    long endOffset   = (long)(end - gridStartTime);
+    programme.iStart = (int)(startOffset >= 0 ? startOffset / 60 : -((59 - startOffset) / 60));
+    programme.iEnd   = (int)(endOffset >= 0 ? (endOffset + 59) / 60 : -((-endOffset) / 60));
+  }
+}
+
+class CGUIEPGGridIndexJob : public CJob
+{
+public:
+  CGUIEPGGridIndexJob(const boost::shared_ptr<CGUIEPGGridIndexResults> &results, const CDateTime &gridStart,
+                      int blocks, int gridEnd)
+    : m_results(results), m_gridStart(gridStart), m_blocks(blocks), m_gridEnd(gridEnd) {}
+
+  void AddChannel(int channel, const std::vector<const CEpgInfoTag *> &tags)
+  {
+    m_channels.push_back(channel);
+    m_tags.push_back(tags);
+  }
+
+  virtual const char *GetType() const { return "epggridindex"; }
+
+  virtual bool DoWork()
+  {
+    std::vector<CEpgGridIndex::Programme> programmes;
+    for (unsigned int i = 0; i < m_channels.size(); i++)
+    {
+      /* the lock keeps the container from dropping the items while their tags are read */
+      CSingleLock lock(m_results->m_critSection);
+      if (m_results->m_bCancelled)
+        return false;
+
+      GetGridProgrammes(m_tags[i], m_gridStart, programmes);
+      m_results->m_channels.push_back(std::make_pair(m_channels[i], std::vector<CEpgGridIndex::Run>()));
+      CEpgGridIndex::GetRuns(programmes, m_blocks, MINSPERBLOCK, m_gridEnd, m_results->m_channels.back().second);
+    }
+
+    return true;
+  }
+
+private:
+  boost::shared_ptr<CGUIEPGGridIndexResults> m_results;
+  CDateTime m_gridStart;
+  int m_blocks;
+  int m_gridEnd;
+  std::vector<int> m_channels;
+  std::vector< std::vector<const CEpgInfoTag *> > m_tags;
+};
+
 CGUIEPGGridContainer::CGUIEPGGridContainer(int parentID, int controlID, float posX, float posY, float width,
                                            float height, ORIENTATION orientation, int scrollTime,
                                            int preloadItems, int timeBlocks, int rulerUnit)
@@ -90,7 +174,6 @@ CGUIEPGGridContainer::CGUIEPGGridContainer(int parentID, int controlID, float po
   m_cacheChannelItems     = preloadItems;
   m_cacheRulerItems       = preloadItems;
   m_cacheProgrammeItems   = preloadItems;
-  m_gridIndex             = NULL;
 }
 
 CGUIEPGGridContainer::~CGUIEPGGridContainer(void)
@@ -103,6 +186,8 @@ void CGUIEPGGridContainer::Process(unsigned int currentTime, CDirtyRegionList &d
   bool changed = false;
   m_renderTime = currentTime;
 
+  UpdateGridIndex();
+
   changed = true;
 
   if (changed)
@@ -309,70 +394,60 @@ void CGUIEPGGridContainer::Render()
   float focusedPosY = 0;
   float focusedwidth = 0;
   float focusedheight = 0;
+  const GridItemsPtr *focusedGridItem = FindGridItem(m_channelOffset + m_channelCursor, m_blockOffset + m_blockCursor);
   while (posB < endB && m_channelItems.size())
   {
     if (channel >= (int)m_channelItems.size())
       break;
 
-    int block = blockOffset;
-    float posA2 = posA;
-
-    CGUIListItemPtr item = m_gridIndex[channel][block].item;
-    if (blockOffset > 0 && item == m_gridIndex[channel][blockOffset-1].item)
+    /* channels that are still being built are left empty for now */
+    int run = m_gridIndex.FindRun(channel, blockOffset);
+    if (run >= 0)
     {
-      /* first program starts before current view */
-      int startBlock = blockOffset - 1;
-      while (m_gridIndex[channel][startBlock].item == item)
-        startBlock--;
-
-      block = startBlock + 1;
-      int missingSection = blockOffset - block;
-      posA2 -= missingSection * m_blockSize;
-    }
+      /* first program may start before current view */
+      const std::vector<CEpgGridIndex::Run> &runs = m_gridIndex.GetRuns(channel);
+      float posA2 = posA - (blockOffset - runs[run].iStartBlock) * m_blockSize;
 
-    while (posA2 < endA && m_programmeItems.size())   // FOR EACH ITEM ///////////////
-    {
-      item = m_gridIndex[channel][block].item;
-      if (!item || !item.get()->IsFileItem())
-        break;
+      while (posA2 < endA && m_programmeItems.size() && run < (int)runs.size())   // FOR EACH ITEM ///////////////
+      {
+        const GridItemsPtr &gridItem = m_gridItems[channel][run];
+        CGUIListItemPtr item = gridItem.item;
+        if (!item || !item.get()->IsFileItem())
+          break;
 
-      bool focused = (channel == m_channelOffset + m_channelCursor) && (item == m_gridIndex[m_channelOffset + m_channelCursor][m_blockOffset + m_blockCursor].item);
+        bool focused = (channel == m_channelOffset + m_channelCursor) && focusedGridItem && (item == focusedGridItem->item);
 
-      // render our item
-      if (focused)
-      {
-        if (m_orientation == VERTICAL)
+        // render our item
+        if (focused)
         {
-          focusedPosX = posA2;
-          focusedPosY = posB;
+          if (m_orientation == VERTICAL)
+          {
+            focusedPosX = posA2;
+            focusedPosY = posB;
+          }
+          else
+          {
+            focusedPosX = posB;
+            focusedPosY = posA2;
+          }
+          focusedItem = item;
+          focusedwidth = gridItem.width;
+          focusedheight = gridItem.height;
         }
         else
         {
-          focusedPosX = posB;
-          focusedPosY = posA2;
+          if (m_orientation == VERTICAL)
+            RenderProgrammeItem(posA2, posB, gridItem.width, gridItem.height, item.get(), focused);
+          else
+            RenderProgrammeItem(posB, posA2, gridItem.width, gridItem.height, item.get(), focused);
         }
-        focusedItem = item;
-        focusedwidth = m_gridIndex[channel][block].width;
-        focusedheight = m_gridIndex[channel][block].height;
-      }
-      else
-      {
+
+        // increment our X position
         if (m_orientation == VERTICAL)
-          RenderProgrammeItem(posA2, posB, m_gridIndex[channel][block].width, m_gridIndex[channel][block].height, item.get(), focused);
+          posA2 += gridItem.width; // assumes focused & unfocused layouts have equal length
         else
-          RenderProgrammeItem(posB, posA2, m_gridIndex[channel][block].width, m_gridIndex[channel][block].height, item.get(), focused);
-      }
-
-      // increment our X position
-      if (m_orientation == VERTICAL)
-      {
-        posA2 += m_gridIndex[channel][block].width; // assumes focused & unfocused layouts have equal length
-        block += (int)(m_gridIndex[channel][block].width / m_blockSize);
-      }
-      else
-      {
-        posA2 += m_gridIndex[channel][block].height; // assumes focused & unfocused layouts have equal length
-        block += (int)(m_gridIndex[channel][block].height / m_blockSize);
+          posA2 += gridItem.height; // assumes focused & unfocused layouts have equal length
+        run++;
       }
     }
 
@@ -711,16 +786,6 @@ bool CGUIEPGGridContainer::OnMessage(CGUIMessage& message)
       for (int i = 0; i < items->Size(); i++)
         m_programmeItems.push_back(items->Get(i));
 
-      ClearGridIndex();
-      m_gridIndex = (struct GridItemsPtr **) calloc(1,m_channelItems.size()*sizeof(struct GridItemsPtr));
-      if (m_gridIndex != NULL)
-      {
-        for (unsigned int i = 0; i < m_channelItems.size(); i++)
-        {
-          m_gridIndex[i] = (struct GridItemsPtr*) calloc(1,MAXBLOCKS*sizeof(struct GridItemsPtr));
-        }
-      }
-
       UpdateLayout(true); // true to refresh all items
 
       /* Create Ruler items */
@@ -757,7 +822,7 @@ bool CGUIEPGGridContainer::OnMessage(CGUIMessage& message)
 
 void CGUIEPGGridContainer::UpdateItems()
 {
-  CDateTimeSpan blockDuration, gridDuration;
+  CDateTimeSpan gridDuration;
 
   /* check for invalid start and end time */
   if (m_gridStart >= m_gridEnd)
@@ -769,8 +834,9 @@ void CGUIEPGGridContainer::UpdateItems()
   }
 
   gridDuration = m_gridEnd - m_gridStart;
+  int gridEnd = gridDuration.GetDays()*24*60 + gridDuration.GetHours()*60 + gridDuration.GetMinutes();
 
-  m_blocks = (gridDuration.GetDays()*24*60 + gridDuration.GetHours()*60 + gridDuration.GetMinutes()) / MINSPERBLOCK;
+  m_blocks = gridEnd / MINSPERBLOCK;
   if (m_blocks >= MAXBLOCKS)
     m_blocks = MAXBLOCKS;
 
@@ -783,99 +849,10 @@ void CGUIEPGGridContainer::UpdateItems()
     return;
   }
 
-  blockDuration.SetDateTimeSpan(0, 0, MINSPERBLOCK, 0);
-
-  long tick(XbmcThreads::SystemClockMillis());
-
-  for (unsigned int row = 0; row < m_channelItems.size(); ++row)
-  {
-    CDateTime gridCursor  = m_gridStart; //reset cursor for new channel
-    unsigned long progIdx = m_epgItemsPtr[row].start;
-    unsigned long lastIdx = m_epgItemsPtr[row].stop;
-    int channelnum        = ((CFileItem *)m_programmeItems[progIdx].get())->GetEPGInfoTag()->ChannelTag()->ChannelNumber();
-
-    /** FOR EACH BLOCK **********************************************************************/
-
-    for (int block = 0; block < m_blocks; block++)
-    {
-      while (progIdx <= lastIdx)
-      {
-        CGUIListItemPtr item = m_programmeItems[progIdx];
-        if (((CFileItem *)item.get())->GetEPGInfoTag()->ChannelTag()->ChannelNumber() != channelnum)
-          break;
-
-        const CEpgInfoTag* tag = ((CFileItem *)item.get())->GetEPGInfoTag();
-        if (tag == NULL)
-          progIdx++;
-
-        if (m_gridEnd <= tag->StartAsLocalTime())
-        {
-          break;
-        }
-        else if (gridCursor >= tag->EndAsLocalTime())
-        {
-          progIdx++;
-        }
-        else if (gridCursor < tag->EndAsLocalTime())
-        {
-          m_gridIndex[row][block].item = item;
-          break;
-        }
-        else
-        {
-          progIdx++;
-        }
-      }
-
-      gridCursor += blockDuration;
-    }
-
-    /** FOR EACH BLOCK **********************************************************************/
-    int itemSize = 1; // size of the programme in blocks
-    int savedBlock = 0;
-
-    for (int block = 0; block < m_blocks; block++)
-    {
-      if (m_gridIndex[row][block].item != m_gridIndex[row][block+1].item)
-      {
-        if (!m_gridIndex[row][block].item)
-        {
-          CEpgInfoTag broadcast;
-          CFileItemPtr unknown(new CFileItem(broadcast));
-          for (int i = block ; i > block - itemSize; i--)
-          {
-            m_gridIndex[row][i].item = unknown;
-          }
-        }
-
-        CGUIListItemPtr item = m_gridIndex[row][block].item;
-        CFileItem *fileItem = (CFileItem *)item.get();
-
-        m_gridIndex[row][savedBlock].item->SetProperty("GenreType", fileItem->GetEPGInfoTag()->GenreType());
-        if (m_orientation == VERTICAL)
-        {
-          m_gridIndex[row][savedBlock].width   = itemSize*m_blockSize;
-          m_gridIndex[row][savedBlock].height  = m_channelHeight;
-        }
-        else
-        {
-          m_gridIndex[row][savedBlock].width   = m_channelWidth;
-          m_gridIndex[row][savedBlock].height  = itemSize*m_blockSize;
-        }
-
-        itemSize = 1;
-        savedBlock = block+1;
-      }
-      else
-      {
-        itemSize++;
-      }
-    }
-  }
-
-  /******************************************* END ******************************************/
-
-  CLog::Log(LOGDEBUG, "%s completed successfully in %u ms", __FUNCTION__, (unsigned int)(XbmcThreads::SystemClockMillis()-tick));
+  /* only the channels around the visible ones are built, see UpdateGridIndex() */
+  m_gridIndex.Reset((int)m_epgItemsPtr.size(), m_blocks, MINSPERBLOCK, gridEnd);
+  m_gridItems.resize(m_epgItemsPtr.size());
+  m_gridResults.reset(new CGUIEPGGridIndexResults);
 
   m_channels = (int)m_epgItemsPtr.size();
   m_item = GetItem(m_channelCursor);
@@ -968,7 +945,7 @@ bool CGUIEPGGridContainer::MoveChannel(bool direction)
 
 bool CGUIEPGGridContainer::MoveProgrammes(bool direction)
 {
-  if (!m_gridIndex || !m_item)
+  if (!m_gridIndex.Channels() || !m_item)
     return false;
 
   if (direction)
@@ -976,7 +953,8 @@ bool CGUIEPGGridContainer::MoveProgrammes(bool direction)
     if (m_channelCursor + m_channelOffset < 0 || m_blockOffset < 0)
       return false;
 
-    if (m_item->item != m_gridIndex[m_channelCursor + m_channelOffset][m_blockOffset].item)
+    GridItemsPtr *first = GetGridItem(m_channelCursor + m_channelOffset, m_blockOffset);
+    if (first && m_item->item != first->item)
     {
       // this is not first item on page
       m_item = GetPrevItem(m_channelCursor);
@@ -1025,7 +1003,8 @@ bool CGUIEPGGridContainer::MoveProgrammes(bool direction)
   }
   else
   {
-    if (m_item->item != m_gridIndex[m_channelCursor + m_channelOffset][m_blocksPerPage + m_blockOffset - 1].item)
+    GridItemsPtr *last = GetGridItem(m_channelCursor + m_channelOffset, m_blocksPerPage + m_blockOffset - 1);
+    if (last && m_item->item != last->item)
     {
       // this is not last item on page
       m_item = GetNextItem(m_channelCursor);
@@ -1248,13 +1227,15 @@ bool CGUIEPGGridContainer::OnMouseWheel(char wheel, const CPoint &point)
 
 int CGUIEPGGridContainer::GetSelectedItem() const
 {
-  if (!m_gridIndex || !m_epgItemsPtr.size())
+  if (!m_epgItemsPtr.size())
     return 0;
 
-  CGUIListItemPtr currentItem = m_gridIndex[m_channelCursor + m_channelOffset][m_blockCursor + m_blockOffset].item;
-  if (!currentItem)
+  const GridItemsPtr *current = FindGridItem(m_channelCursor + m_channelOffset, m_blockCursor + m_blockOffset);
+  if (!current || !current->item)
     return 0;
 
+  CGUIListItemPtr currentItem = current->item;
+
   for (int i = 0; i < (int)m_programmeItems.size(); i++)
   {
     if (currentItem == m_programmeItems[i])
@@ -1265,7 +1246,7 @@ int CGUIEPGGridContainer::GetSelectedItem() const
 
 CGUIListItemPtr CGUIEPGGridContainer::GetListItem(int offset) const
 {
-  if (!m_epgItemsPtr.size())
+  if (!m_epgItemsPtr.size() || !m_item)
     return CGUIListItemPtr();
 
   return m_item->item;
@@ -1300,9 +1281,9 @@ GridItemsPtr *CGUIEPGGridContainer::GetClosestItem(const int &channel)
   }
 
   if (right <= SHORTGAP && right <= left && m_blockCursor + right < m_blocksPerPage)
-    return &m_gridIndex[channel + m_channelOffset][m_blockCursor + right + m_blockOffset];
+    return GetGridItem(channel + m_channelOffset, m_blockCursor + right + m_blockOffset);
 
-  return &m_gridIndex[channel + m_channelOffset][m_blockCursor - left  + m_blockOffset];
+  return GetGridItem(channel + m_channelOffset, m_blockCursor - left  + m_blockOffset);
 }
 
 int CGUIEPGGridContainer::GetItemSize(GridItemsPtr *item)
@@ -1323,44 +1304,202 @@ int CGUIEPGGridContainer::GetBlock(const CGUIListItemPtr &item, const int &chann
 
 int CGUIEPGGridContainer::GetRealBlock(const CGUIListItemPtr &item, const int &channel)
 {
-  int block = 0;
+  int row = channel + m_channelOffset;
+  if (!BuildGridChannel(row))
+    return m_blocks;
 
-  while (m_gridIndex[channel + m_channelOffset][block].item != item && block < m_blocks)
-    block++;
+  const std::vector<CEpgGridIndex::Run> &runs = m_gridIndex.GetRuns(row);
+  for (unsigned int run = 0; run < runs.size(); run++)
+  {
+    if (m_gridItems[row][run].item == item)
+      return runs[run].iStartBlock;
+  }
 
-  return block;
+  return m_blocks;
 }
 
 GridItemsPtr *CGUIEPGGridContainer::GetNextItem(const int &channel)
 {
-  int i = m_blockCursor;
+  int row = channel + m_channelOffset;
+  if (!BuildGridChannel(row))
+    return NULL;
 
-  while (m_gridIndex[channel + m_channelOffset][i + m_blockOffset].item == m_gridIndex[channel + m_channelOffset][m_blockCursor + m_blockOffset].item && i < m_blocksPerPage)
-    i++;
+  int run = m_gridIndex.FindRun(row, m_blockCursor + m_blockOffset);
+  if (run < 0)
+    return NULL;
+
+  /* the first block of the next run, as long as it's on this page */
+  int i = m_gridIndex.GetRuns(row)[run].iEndBlock - m_blockOffset;
+  if (i > m_blocksPerPage)
+    i = m_blocksPerPage;
+  if (i + m_blockOffset >= m_blocks)
+    i = m_blockCursor;
 
-  return &m_gridIndex[channel + m_channelOffset][i + m_blockOffset];
+  return GetGridItem(row, i + m_blockOffset);
 }
 
 GridItemsPtr *CGUIEPGGridContainer::GetPrevItem(const int &channel)
 {
-  int i = m_blockCursor;
+  int row = channel + m_channelOffset;
+  if (!BuildGridChannel(row))
+    return NULL;
 
-  while (m_gridIndex[channel + m_channelOffset][i + m_blockOffset].item == m_gridIndex[channel + m_channelOffset][m_blockCursor + m_blockOffset].item && i > 0)
-    i--;
+  int run = m_gridIndex.FindRun(row, m_blockCursor + m_blockOffset);
+  if (run < 0)
+    return NULL;
 
-  return &m_gridIndex[channel + m_channelOffset][i + m_blockOffset];
+  /* the last block of the previous run, as long as it's on this page */
+  int i = m_gridIndex.GetRuns(row)[run].iStartBlock - 1 - m_blockOffset;
+  if (i < 0)
+    i = 0;
 
-//  return &m_gridIndex[channel + m_channelOffset][m_blockCursor + m_blockOffset - 1];
+  return GetGridItem(row, i + m_blockOffset);
 }
 
 GridItemsPtr *CGUIEPGGridContainer::GetItem(const int &channel)
 {
   if ( (channel >= 0) && (channel < m_channels) )
-    return &m_gridIndex[channel + m_channelOffset][m_blockCursor + m_blockOffset];
+    return GetGridItem(channel + m_channelOffset, m_blockCursor + m_blockOffset);
   else
     return NULL;
 }
 
+GridItemsPtr *CGUIEPGGridContainer::GetGridItem(int channel, int block)
+{
+  if (!BuildGridChannel(channel))
+    return NULL;
+
+  int run = m_gridIndex.FindRun(channel, block);
+  if (run < 0)
+    return NULL;
+
+  return &m_gridItems[channel][run];
+}
+
+const GridItemsPtr *CGUIEPGGridContainer::FindGridItem(int channel, int block) const
+{
+  int run = m_gridIndex.FindRun(channel, block);
+  if (run < 0)
+    return NULL;
+
+  return &m_gridItems[channel][run];
+}
+
+bool CGUIEPGGridContainer::BuildGridChannel(int channel)
+{
+  if (m_gridIndex.IsBuilt(channel))
+    return true;
+
+  if (channel < 0 || channel >= m_gridIndex.Channels())
+    return false;
+
+  /* needed right away, so don't wait for a job that may be building it already */
+  std::vector<const CEpgInfoTag *> tags;
+  for (long i = m_epgItemsPtr[channel].start; i <= m_epgItemsPtr[channel].stop; i++)
+    tags.push_back(((CFileItem *)m_programmeItems[i].get())->GetEPGInfoTag());
+
+  std::vector<CEpgGridIndex::Programme> programmes;
+  std::vector<CEpgGridIndex::Run> runs;
+  GetGridProgrammes(tags, m_gridStart, programmes);
+  CEpgGridIndex::GetRuns(programmes, m_gridIndex.Blocks(), MINSPERBLOCK, m_gridIndex.GridEnd(), runs);
+  SetGridChannel(channel, runs);
+
+  return true;
+}
+
+void CGUIEPGGridContainer::SetGridChannel(int channel, std::vector<CEpgGridIndex::Run> &runs)
+{
+  m_gridIndex.SetRuns(channel, runs);
+
+  const std::vector<CEpgGridIndex::Run> &channelRuns = m_gridIndex.GetRuns(channel);
+  std::vector<GridItemsPtr> &gridItems = m_gridItems[channel];
+  gridItems.resize(channelRuns.size());
+  for (unsigned int run = 0; run < channelRuns.size(); run++)
+  {
+    GridItemsPtr &gridItem = gridItems[run];
+    float size = (channelRuns[run].iEndBlock - channelRuns[run].iStartBlock) * m_blockSize;
+
+    /* every gap gets an empty programme of its own, so it's rendered and can be focused */
+    if (channelRuns[run].iProgramme != EPG_GRID_INDEX_GAP)
+      gridItem.item = m_programmeItems[m_epgItemsPtr[channel].start + channelRuns[run].iProgramme];
+    else
+    {
+      CEpgInfoTag broadcast;
+      gridItem.item.reset(new CFileItem(broadcast));
+    }
+
+    const CEpgInfoTag *tag = ((CFileItem *)gridItem.item.get())->GetEPGInfoTag();
+    if (tag)
+      gridItem.item->SetProperty("GenreType", tag->GenreType());
+
+    if (m_orientation == VERTICAL)
+    {
+      gridItem.width  = size;
+      gridItem.height = m_channelHeight;
+    }
+    else
+    {
+      gridItem.width  = m_channelWidth;
+      gridItem.height = size;
+    }
+  }
+}
+
+void CGUIEPGGridContainer::UpdateGridIndex(void)
+{
+  if (!m_gridResults)
+    return;
+
+  /* install the channels that were built since the last frame */
+  std::vector< std::pair<int, std::vector<CEpgGridIndex::Run> > > channels;
+  {
+    CSingleLock lock(m_gridResults->m_critSection);
+    channels.swap(m_gridResults->m_channels);
+  }
+  for (unsigned int i = 0; i < channels.size(); i++)
+  {
+    if (!m_gridIndex.IsBuilt(channels[i].first))
+      SetGridChannel(channels[i].first, channels[i].second);
+  }
+
+  /* the visible channels first, then a page above and below them. the others are built when scrolled to */
+  QueueGridChannels(m_channelOffset, m_channelOffset + m_channelsPerPage - 1, CJob::PRIORITY_HIGH);
+  QueueGridChannels(m_channelOffset - m_channelsPerPage, m_channelOffset + 2 * m_channelsPerPage - 1, CJob::PRIORITY_LOW);
+}
+
+void CGUIEPGGridContainer::QueueGridChannels(int first, int last, CJob::PRIORITY priority)
+{
+  std::vector<int> channels;
+  if (!m_gridIndex.TakeChannelsToBuild(first, last, channels))
+    return;
+
+  CGUIEPGGridIndexJob *job = new CGUIEPGGridIndexJob(m_gridResults, m_gridStart, m_gridIndex.Blocks(), m_gridIndex.GridEnd());
+  for (unsigned int i = 0; i < channels.size(); i++)
+  {
+    std::vector<const CEpgInfoTag *> tags;
+    for (long j = m_epgItemsPtr[channels[i]].start; j <= m_epgItemsPtr[channels[i]].stop; j++)
+      tags.push_back(((CFileItem *)m_programmeItems[j].get())->GetEPGInfoTag());
+    job->AddChannel(channels[i], tags);
+  }
+
+  m_gridJobs.push_back(CJobManager::GetInstance().AddJob(job, NULL, priority));
+}
+
+void CGUIEPGGridContainer::CancelGridJobs(void)
+{
+  if (m_gridResults)
+  {
+    CSingleLock lock(m_gridResults->m_critSection);
+    m_gridResults->m_bCancelled = true;
+  }
+
+  for (unsigned int i = 0; i < m_gridJobs.size(); i++)
+    CJobManager::GetInstance().CancelJob(m_gridJobs[i]);
+
+  m_gridJobs.clear();
+  m_gridResults.reset();
+}
+
 void CGUIEPGGridContainer::SetFocus(bool bOnOff)
 {
   if (bOnOff != HasFocus())
@@ -1534,23 +1673,23 @@ CStdString CGUIEPGGridContainer::GetDescription() const
 
 void CGUIEPGGridContainer::ClearGridIndex(void)
 {
-  if (m_gridIndex)
+  for (unsigned int i = 0; i < m_gridItems.size(); i++)
   {
-    for (unsigned int i = 0; i < m_channelItems.size(); i++)
+    for (unsigned int run = 0; run < m_gridItems[i].size(); run++)
     {
-      for (int block = 0; block < m_blocks; block++)
-      {
-        if (m_gridIndex[i][block].item)
-          m_gridIndex[i][block].item.get()->ClearProperties();
-      }
-      free(m_gridIndex[i]);
+      if (m_gridItems[i][run].item)
+        m_gridItems[i][run].item.get()->ClearProperties();
     }
-    free(m_gridIndex);
   }
+
+  m_gridItems.clear();
+  m_gridIndex.Reset(0, 0, MINSPERBLOCK, 0);
 }
 
 void CGUIEPGGridContainer::Reset()
 {
+  /* the jobs read the tags of the programme items, so they have to stop first */
+  CancelGridJobs();
   ClearGridIndex();
 
   m_wasReset = true;
@@ -1561,7 +1700,7 @@ void CGUIEPGGridContainer::Reset()
 
   m_lastItem    = NULL;
   m_lastChannel = NULL;
-  m_gridIndex   = NULL;
+  m_item        = NULL;
 }
 
 void CGUIEPGGridContainer::GoToBegin()
@@ -25,6 +25,10 @@
 #include "FileItem.h"
 #include "guilib/GUIControl.h"
 #include "guilib/GUIListItemLayout.h"
+#include "utils/Job.h"
+#include "EpgGridIndex.h"
+
+#include <boost/shared_ptr.hpp>
 
 namespace EPG
 {
@@ -38,6 +42,8 @@ namespace EPG
     float height;
   };
 
+  class CGUIEPGGridIndexResults;
+
   class CGUIEPGGridContainer : public CGUIControl
   {
   public:
@@ -102,6 +108,35 @@ namespace EPG
     void Reset();
     void ClearGridIndex(void);
 
+    /*! \brief Install the runs that were built in the background and queue the channels around the visible ones that aren't built yet
+     */
+    void UpdateGridIndex(void);
+
+    /*! \brief Queue a job that builds the channels in [first, last] that are neither built nor being built
+     */
+    void QueueGridChannels(int first, int last, CJob::PRIORITY priority);
+
+    /*! \brief Build the runs of a channel on this thread, if they're not there yet
+     \return true if the channel is built, false if it's out of range
+     */
+    bool BuildGridChannel(int channel);
+
+    /*! \brief Set the runs of a channel and create the grid items for them
+     */
+    void SetGridChannel(int channel, std::vector<CEpgGridIndex::Run> &runs);
+
+    /*! \brief Cancel the jobs that are building channels and drop their results
+     */
+    void CancelGridJobs(void);
+
+    /*! \brief Get the grid item of the run a block is in, building the channel first if needed
+     \param channel the channel, not relative to the channel offset
+     \param block the block, not relative to the block offset
+     \return the grid item or NULL if the block is out of range
+     */
+    GridItemsPtr *GetGridItem(int channel, int block);
+    const GridItemsPtr *FindGridItem(int channel, int block) const;
+
     GridItemsPtr *GetItem(const int &channel);
     GridItemsPtr *GetNextItem(const int &channel);
     GridItemsPtr *GetPrevItem(const int &channel);
@@ -196,7 +231,10 @@ namespace EPG
     CDateTime m_gridStart;
     CDateTime m_gridEnd;
 
-    struct GridItemsPtr **m_gridIndex;
+    CEpgGridIndex m_gridIndex;                                //! the runs of blocks of each channel, built when needed
+    std::vector< std::vector<GridItemsPtr> > m_gridItems;     //! the item and size of each run of each channel
+    boost::shared_ptr<CGUIEPGGridIndexResults> m_gridResults; //! the channels that were built in the background
+    std::vector<unsigned int> m_gridJobs;                     //! the jobs that build channels
     GridItemsPtr *m_item;
     CGUIListItem *m_lastItem;
     CGUIListItem *m_lastChannel;
@@ -0,0 +1,266 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "epg/EpgGridIndex.h"
+#include "utils/test/TestUtils.h"
+
+#include <stdio.h>
+#include <vector>
+
+using namespace EPG;
+
+#define MINUTES_PER_BLOCK  5
+#define GRID_BLOCKS        2304 /* eight days */
+#define BENCHMARK_CHANNELS 600
+#define BENCHMARK_WINDOW   40   /* a page of channels and the prefetch margin */
+
+//=============================================================================
+// Helper functions
+//=============================================================================
+
+static CTestRandom Random;
+
+/* a guide from iStart on, with gaps and overlaps every now and then */
+static void CreateChannel(std::vector<CEpgGridIndex::Programme> &programmes, int iStart, int iEnd)
+{
+  programmes.clear();
+  int iTime = iStart;
+  while (iTime < iEnd)
+  {
+    CEpgGridIndex::Programme programme;
+    programme.iStart = iTime;
+    programme.iEnd   = iTime + 1 + Random(120);
+    programmes.push_back(programme);
+
+    switch (Random(10))
+    {
+    case 0:  iTime = programme.iEnd + Random(60); break;
+    case 1:  iTime = programme.iEnd - Random(10); break;
+    default: iTime = programme.iEnd; break;
+    }
+  }
+}
+
+/* what UpdateItems did before the index: walk over all blocks, one programme after another */
+static void GetDenseBlocks(const std::vector<CEpgGridIndex::Programme> &programmes, int iBlocks, int iGridEnd, std::vector<int> &blocks)
+{
+  blocks.assign(iBlocks, EPG_GRID_INDEX_GAP);
+
+  size_t iPtr = 0;
+  for (int iBlock = 0; iBlock < iBlocks; iBlock++)
+  {
+    int iCursor = iBlock * MINUTES_PER_BLOCK;
+    while (iPtr < programmes.size())
+    {
+      if (iGridEnd <= programmes[iPtr].iStart)
+        break;
+      else if (iCursor >= programmes[iPtr].iEnd)
+        iPtr++;
+      else
+      {
+        blocks[iBlock] = (int) iPtr;
+        break;
+      }
+    }
+  }
+}
+
+static void CheckChannel(const CEpgGridIndex &index, int iChannel, const std::vector<int> &blocks)
+{
+  const std::vector<CEpgGridIndex::Run> &runs = index.GetRuns(iChannel);
+  BOOST_REQUIRE(!runs.empty());
+  BOOST_CHECK_EQUAL(runs.front().iStartBlock, 0);
+  BOOST_CHECK_EQUAL(runs.back().iEndBlock, index.Blocks());
+
+  for (int iBlock = 0; iBlock < index.Blocks(); iBlock++)
+  {
+    int iRun = index.FindRun(iChannel, iBlock);
+    BOOST_REQUIRE(iRun >= 0);
+    BOOST_REQUIRE(runs[iRun].iStartBlock <= iBlock && iBlock < runs[iRun].iEndBlock);
+    BOOST_REQUIRE_EQUAL(runs[iRun].iProgramme, blocks[iBlock]);
+  }
+}
+
+//=============================================================================
+// Tests
+//=============================================================================
+
+BOOST_AUTO_TEST_CASE(TestEpgGridIndexRuns)
+{
+  const int iGridEnd = GRID_BLOCKS * MINUTES_PER_BLOCK;
+  CEpgGridIndex index;
+  index.Reset(50, GRID_BLOCKS, MINUTES_PER_BLOCK, iGridEnd);
+
+  std::vector<CEpgGridIndex::Programme> programmes;
+  std::vector<CEpgGridIndex::Run> runs;
+  std::vector<int> blocks;
+  for (int iChannel = 0; iChannel < index.Channels(); iChannel++)
+  {
+    /* guides that start before the grid and end before, in or after it */
+    CreateChannel(programmes, -(int) Random(600), iGridEnd - 2000 + (int) Random(4000));
+    CEpgGridIndex::GetRuns(programmes, index.Blocks(), MINUTES_PER_BLOCK, iGridEnd, runs);
+    index.SetRuns(iChannel, runs);
+
+    GetDenseBlocks(programmes, index.Blocks(), iGridEnd, blocks);
+    CheckChannel(index, iChannel, blocks);
+  }
+
+  BOOST_CHECK_EQUAL(index.FindRun(0, -1), -1);
+  BOOST_CHECK_EQUAL(index.FindRun(0, GRID_BLOCKS), -1);
+  BOOST_CHECK_EQUAL(index.FindRun(index.Channels(), 0), -1);
+}
+
+BOOST_AUTO_TEST_CASE(TestEpgGridIndexEdges)
+{
+  /* a channel without programmes is one gap, and so is one that starts after the grid */
+  std::vector<CEpgGridIndex::Programme> programmes;
+  std::vector<CEpgGridIndex::Run> runs;
+  CEpgGridIndex::GetRuns(programmes, 10, MINUTES_PER_BLOCK, 50, runs);
+  BOOST_REQUIRE_EQUAL(runs.size(), 1u);
+  BOOST_CHECK_EQUAL(runs[0].iStartBlock, 0);
+  BOOST_CHECK_EQUAL(runs[0].iEndBlock, 10);
+  BOOST_CHECK_EQUAL(runs[0].iProgramme, EPG_GRID_INDEX_GAP);
+
+  CEpgGridIndex::Programme late = { 50, 80 };
+  programmes.push_back(late);
+  CEpgGridIndex::GetRuns(programmes, 10, MINUTES_PER_BLOCK, 50, runs);
+  BOOST_REQUIRE_EQUAL(runs.size(), 1u);
+  BOOST_CHECK_EQUAL(runs[0].iProgramme, EPG_GRID_INDEX_GAP);
+
+  /* a programme that ends in the middle of a block keeps that block, the gap before one is part of it */
+  programmes.clear();
+  CEpgGridIndex::Programme first = { -30, 12 }, second = { 20, 36 };
+  programmes.push_back(first);
+  programmes.push_back(second);
+  CEpgGridIndex::GetRuns(programmes, 10, MINUTES_PER_BLOCK, 50, runs);
+  BOOST_REQUIRE_EQUAL(runs.size(), 3u);
+  BOOST_CHECK_EQUAL(runs[0].iEndBlock, 3);
+  BOOST_CHECK_EQUAL(runs[1].iStartBlock, 3);
+  BOOST_CHECK_EQUAL(runs[1].iEndBlock, 8);
+  BOOST_CHECK_EQUAL(runs[1].iProgramme, 1);
+  BOOST_CHECK_EQUAL(runs[2].iProgramme, EPG_GRID_INDEX_GAP);
+}
+
+BOOST_AUTO_TEST_CASE(TestEpgGridIndexWindow)
+{
+  CEpgGridIndex index;
+  index.Reset(100, GRID_BLOCKS, MINUTES_PER_BLOCK, GRID_BLOCKS * MINUTES_PER_BLOCK);
+
+  std::vector<int> channels;
+  BOOST_CHECK_EQUAL(index.TakeChannelsToBuild(-10, 19, channels), 20u);
+  BOOST_CHECK_EQUAL(channels.front(), 0);
+  BOOST_CHECK_EQUAL(channels.back(), 19);
+
+  /* channels that are being built aren't handed out again */
+  channels.clear();
+  BOOST_CHECK_EQUAL(index.TakeChannelsToBuild(10, 29, channels), 10u);
+  BOOST_CHECK_EQUAL(channels.front(), 20);
+
+  std::vector<CEpgGridIndex::Run> runs;
+  CEpgGridIndex::GetRuns(std::vector<CEpgGridIndex::Programme>(), index.Blocks(), MINUTES_PER_BLOCK, index.GridEnd(), runs);
+  index.SetRuns(5, runs);
+  BOOST_CHECK(index.IsBuilt(5));
+  BOOST_CHECK(!index.IsBuilt(6));
+  BOOST_CHECK_EQUAL(index.FindRun(6, 0), -1);
+
+  channels.clear();
+  BOOST_CHECK_EQUAL(index.TakeChannelsToBuild(90, 200, channels), 10u);
+  BOOST_CHECK_EQUAL(channels.back(), 99);
+
+  index.Reset(10, 100, MINUTES_PER_BLOCK, 500);
+  BOOST_CHECK(!index.IsBuilt(5));
+  channels.clear();
+  BOOST_CHECK_EQUAL(index.TakeChannelsToBuild(0, 9, channels), 10u);
+}
+
+BOOST_AUTO_TEST_CASE(BenchmarkEpgGridIndex)
+{
+  const int iGridEnd = GRID_BLOCKS * MINUTES_PER_BLOCK;
+  std::vector<std::vector<CEpgGridIndex::Programme> > guide(BENCHMARK_CHANNELS);
+  size_t iProgrammes = 0;
+  for (unsigned int iChannel = 0; iChannel < BENCHMARK_CHANNELS; iChannel++)
+  {
+    CreateChannel(guide[iChannel], -60, iGridEnd + 60);
+    iProgrammes += guide[iChannel].size();
+  }
+
+  /* the dense array of all channels, the way the grid was set up when it was opened */
+  boost::posix_time::ptime start = BenchmarkStart();
+  std::vector<std::vector<int> > dense(BENCHMARK_CHANNELS);
+  for (unsigned int iChannel = 0; iChannel < BENCHMARK_CHANNELS; iChannel++)
+    GetDenseBlocks(guide[iChannel], GRID_BLOCKS, iGridEnd, dense[iChannel]);
+  double denseTime = ElapsedMilliseconds(start);
+
+  /* the runs of all channels */
+  CEpgGridIndex index;
+  std::vector<CEpgGridIndex::Run> runs;
+  start = BenchmarkStart();
+  index.Reset(BENCHMARK_CHANNELS, GRID_BLOCKS, MINUTES_PER_BLOCK, iGridEnd);
+  for (unsigned int iChannel = 0; iChannel < BENCHMARK_CHANNELS; iChannel++)
+  {
+    CEpgGridIndex::GetRuns(guide[iChannel], GRID_BLOCKS, MINUTES_PER_BLOCK, iGridEnd, runs);
+    index.SetRuns(iChannel, runs);
+  }
+  double indexTime = ElapsedMilliseconds(start);
+
+  /* and only the ones around the channels on screen, which is what's built when the grid is opened */
+  CEpgGridIndex window;
+  std::vector<int> channels;
+  start = BenchmarkStart();
+  window.Reset(BENCHMARK_CHANNELS, GRID_BLOCKS, MINUTES_PER_BLOCK, iGridEnd);
+  window.TakeChannelsToBuild(0, BENCHMARK_WINDOW - 1, channels);
+  for (size_t iPtr = 0; iPtr < channels.size(); iPtr++)
+  {
+    CEpgGridIndex::GetRuns(guide[channels[iPtr]], GRID_BLOCKS, MINUTES_PER_BLOCK, iGridEnd, runs);
+    window.SetRuns(channels[iPtr], runs);
+  }
+  double windowTime = ElapsedMilliseconds(start);
+
+  /* look up every block of every channel, like rendering the whole guide would */
+  unsigned int iLookups = 0;
+  long iDenseSum = 0, iIndexSum = 0;
+  start = BenchmarkStart();
+  for (unsigned int iChannel = 0; iChannel < BENCHMARK_CHANNELS; iChannel++)
+  {
+    const std::vector<CEpgGridIndex::Run> &channelRuns = index.GetRuns(iChannel);
+    for (int iBlock = 0; iBlock < GRID_BLOCKS; iBlock++)
+      iIndexSum += channelRuns[index.FindRun(iChannel, iBlock)].iProgramme;
+  }
+  double lookupTime = ElapsedMilliseconds(start);
+
+  for (unsigned int iChannel = 0; iChannel < BENCHMARK_CHANNELS; iChannel++)
+  {
+    for (int iBlock = 0; iBlock < GRID_BLOCKS; iBlock++, iLookups++)
+      iDenseSum += dense[iChannel][iBlock];
+  }
+  BOOST_CHECK_EQUAL(iDenseSum, iIndexSum);
+
+  size_t iRuns = 0;
+  for (unsigned int iChannel = 0; iChannel < BENCHMARK_CHANNELS; iChannel++)
+    iRuns += index.GetRuns(iChannel).size();
+
+  printf("%u channels, %u programmes   dense (ms)  runs (ms)  window (ms)\n", BENCHMARK_CHANNELS, (unsigned int) iProgrammes);
+  printf("built %40.1f %10.1f %12.2f\n", denseTime, indexTime, windowTime);
+  printf("cells %40u %10u\n", BENCHMARK_CHANNELS * GRID_BLOCKS, (unsigned int) iRuns);
+  printf("%u block lookups: %.1f ms\n", iLookups, lookupTime);
+}
@@ -0,0 +1,398 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "epg/EpgSearchIndex.h"
+#include "utils/test/TestUtils.h"
+
+#include <algorithm>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+using namespace EPG;
+
+#define BENCHMARK_CHANNELS 800
+#define BENCHMARK_EVENTS   1250   /* 1M events in total */
+#define BENCHMARK_LINEAR   100000 /* events the linear search is timed on */
+#define BENCHMARK_QUERIES  20
+
+//=============================================================================
+// Helper functions
+//=============================================================================
+
+static CTestRandom Random;
+
+static const char *s_syllables[] =
+{
+  "foot", "ball", "news", "day", "night", "man", "ter", "ra", "lo", "ve",
+  "in", "ka", "sto", "ry", "wor", "ld", "cup", "fi", "nal", "mo",
+  "vie", "star", "trek", "doc", "tor", "wild", "life", "sea", "son", "ton"
+};
+
+#define SYLLABLES (sizeof(s_syllables) / sizeof(s_syllables[0]))
+
+/* words of 1 to 3 syllables, the first ones are used a lot more often than the others */
+static std::string RandomWord(void)
+{
+  std::string strWord;
+  unsigned int iSyllables = 1 + Random(3);
+  for (unsigned int iPtr = 0; iPtr < iSyllables; iPtr++)
+    strWord += s_syllables[Random(Random(SYLLABLES) + 1)];
+
+  /* some upper case and some punctuation */
+  if (Random(4) == 0)
+    strWord[0] = strWord[0] - 'a' + 'A';
+  if (Random(10) == 0)
+    strWord += Random(2) ? ":" : "-";
+
+  return strWord;
+}
+
+static std::string RandomText(unsigned int iMinWords, unsigned int iMaxWords)
+{
+  std::string strText;
+  unsigned int iWords = iMinWords + Random(iMaxWords - iMinWords + 1);
+  for (unsigned int iPtr = 0; iPtr < iWords; iPtr++)
+  {
+    if (iPtr > 0)
+      strText += " ";
+    strText += RandomWord();
+  }
+  return strText;
+}
+
+/* a lower case word as it is found in the index, without punctuation */
+static std::string RandomSearchWord(void)
+{
+  std::vector<std::string> words;
+  CEpgSearchIndex::GetWords(RandomWord(), words);
+  return words.at(0);
+}
+
+namespace
+{
+struct SearchEvent
+{
+  int         iTable;
+  unsigned int iPosition;
+  std::string strTitle;
+  std::string strPlotOutline;
+  int         iGenreType;
+  int64_t     iStart;
+  int64_t     iEnd;
+};
+}
+
+static void CreateTable(std::vector<SearchEvent> &events, int iTable, unsigned int iEvents)
+{
+  int64_t iTime = 1320000000;
+  for (unsigned int iPtr = 0; iPtr < iEvents; iPtr++)
+  {
+    SearchEvent event;
+    event.iTable         = iTable;
+    event.iPosition      = iPtr;
+    event.strTitle       = RandomText(1, 4);
+    event.strPlotOutline = RandomText(4, 12);
+    event.iGenreType     = 0x10 * Random(11);
+    event.iStart         = iTime;
+    event.iEnd           = iTime + 300 + Random(7200);
+    iTime = event.iEnd;
+    events.push_back(event);
+  }
+}
+
+static void IndexEvents(CEpgSearchIndex &index, const std::vector<SearchEvent> &events, size_t iFrom)
+{
+  for (size_t iPtr = iFrom; iPtr < events.size(); iPtr++)
+  {
+    const SearchEvent &event = events[iPtr];
+    index.AddEvent(event.iTable, event.iPosition, event.strTitle, event.strPlotOutline, event.iGenreType, event.iStart, event.iEnd);
+  }
+}
+
+static void AddTable(CEpgSearchIndex &index, std::vector<SearchEvent> &events, int iTable, unsigned int iEvents)
+{
+  size_t iFrom = events.size();
+  CreateTable(events, iTable, iEvents);
+  IndexEvents(index, events, iFrom);
+}
+
+static std::string ToLower(const std::string &strText)
+{
+  std::string strLower(strText);
+  for (size_t iPtr = 0; iPtr < strLower.size(); iPtr++)
+    strLower[iPtr] = tolower(strLower[iPtr]);
+  return strLower;
+}
+
+/* what CTextSearch does for each field of every tag, and EpgSearchFilter for the genre and times */
+static bool LinearMatchText(const std::string &strText, const CEpgSearchIndex::Query &query)
+{
+  if (strText.empty())
+    return false;
+
+  std::string strSearch = ToLower(strText);
+  bool bFound(query.orTerms.empty());
+  for (size_t iPtr = 0; !bFound && iPtr < query.orTerms.size(); iPtr++)
+    bFound = strSearch.find(query.orTerms[iPtr]) != std::string::npos;
+
+  for (size_t iPtr = 0; bFound && iPtr < query.andTerms.size(); iPtr++)
+    bFound = strSearch.find(query.andTerms[iPtr]) != std::string::npos;
+
+  return bFound;
+}
+
+static bool LinearMatch(const SearchEvent &event, const CEpgSearchIndex::Query &query)
+{
+  return (query.iGenreType == EPG_SEARCH_INDEX_UNSET || event.iGenreType == query.iGenreType) &&
+      (query.iMinStart == 0 || event.iStart >= query.iMinStart) &&
+      (query.iMaxEnd == 0 || event.iEnd <= query.iMaxEnd) &&
+      ((query.andTerms.empty() && query.orTerms.empty()) ||
+       LinearMatchText(event.strTitle, query) || LinearMatchText(event.strPlotOutline, query));
+}
+
+static bool Contains(const std::vector<CEpgSearchIndex::Hit> &hits, const SearchEvent &event)
+{
+  CEpgSearchIndex::Hit hit = { event.iTable, event.iPosition };
+  return std::binary_search(hits.begin(), hits.end(), hit);
+}
+
+/* every event the linear search finds has to be found by the index */
+static void CheckQuery(const CEpgSearchIndex &index, const std::vector<SearchEvent> &events, const CEpgSearchIndex::Query &query, bool bExact)
+{
+  std::vector<CEpgSearchIndex::Hit> hits;
+  index.Search(query, hits);
+  BOOST_REQUIRE(hits.size() <= index.Size());
+
+  size_t iMatches = 0;
+  for (size_t iPtr = 0; iPtr < events.size(); iPtr++)
+  {
+    if (LinearMatch(events[iPtr], query))
+    {
+      BOOST_REQUIRE(Contains(hits, events[iPtr]));
+      iMatches++;
+    }
+  }
+
+  if (bExact)
+    BOOST_CHECK_EQUAL(hits.size(), iMatches);
+}
+
+static void CheckQueries(const CEpgSearchIndex &index, const std::vector<SearchEvent> &events)
+{
+  BOOST_REQUIRE_EQUAL(index.Size(), events.size());
+
+  for (int iQuery = 0; iQuery < 100; iQuery++)
+  {
+    /* a single word or part of a word finds exactly what a substring search finds */
+    CEpgSearchIndex::Query query;
+    query.orTerms.push_back(RandomSearchWord().substr(Random(2)));
+    CheckQuery(index, events, query, true);
+
+    query.iGenreType = 0x10 * Random(11);
+    query.iMinStart = 1320000000 + Random(100000);
+    query.iMaxEnd = query.iMinStart + Random(100000);
+    CheckQuery(index, events, query, true);
+
+    /* phrases and words in different fields can only be narrowed down */
+    query = CEpgSearchIndex::Query();
+    query.orTerms.push_back(ToLower(RandomWord() + " " + RandomWord()));
+    query.orTerms.push_back(RandomSearchWord());
+    CheckQuery(index, events, query, false);
+
+    query = CEpgSearchIndex::Query();
+    query.andTerms.push_back(RandomSearchWord());
+    query.andTerms.push_back(ToLower(RandomWord()));
+    CheckQuery(index, events, query, false);
+  }
+}
+
+//=============================================================================
+// Tests
+//=============================================================================
+
+BOOST_AUTO_TEST_CASE(TestEpgSearchIndexWords)
+{
+  std::vector<std::string> words;
+  CEpgSearchIndex::GetWords("The Big-Match: \xc3\x84rger im 2. Spiel!", words);
+
+  BOOST_REQUIRE_EQUAL(words.size(), 7u);
+  BOOST_CHECK_EQUAL(words[0], "the");
+  BOOST_CHECK_EQUAL(words[1], "big");
+  BOOST_CHECK_EQUAL(words[2], "match");
+  BOOST_CHECK_EQUAL(words[3], "\xc3\x84rger");
+  BOOST_CHECK_EQUAL(words[4], "im");
+  BOOST_CHECK_EQUAL(words[5], "2");
+  BOOST_CHECK_EQUAL(words[6], "spiel");
+
+  words.clear();
+  CEpgSearchIndex::GetWords(" -- ", words);
+  BOOST_CHECK(words.empty());
+}
+
+BOOST_AUTO_TEST_CASE(TestEpgSearchIndexQueries)
+{
+  CEpgSearchIndex index;
+  std::vector<SearchEvent> events;
+  for (int iTable = 1; iTable <= 20; iTable++)
+    AddTable(index, events, iTable, 100);
+
+  CheckQueries(index, events);
+
+  /* a term without words matches everything */
+  std::vector<CEpgSearchIndex::Hit> hits;
+  CEpgSearchIndex::Query query;
+  query.orTerms.push_back("football");
+  query.orTerms.push_back("!");
+  BOOST_CHECK_EQUAL(index.Search(query, hits), events.size());
+
+  query.orTerms.clear();
+  query.andTerms.push_back("xyzzy");
+  BOOST_CHECK_EQUAL(index.Search(query, hits), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(TestEpgSearchIndexUpdates)
+{
+  CEpgSearchIndex index;
+  std::vector<SearchEvent> events;
+  for (int iTable = 1; iTable <= 20; iTable++)
+    AddTable(index, events, iTable, 100);
+
+  /* index tables again with new events, the way CEpgContainer does after an update */
+  for (int iUpdate = 0; iUpdate < 60; iUpdate++)
+  {
+    int iTable = 1 + Random(20);
+    index.RemoveTable(iTable);
+
+    std::vector<SearchEvent> kept;
+    for (size_t iPtr = 0; iPtr < events.size(); iPtr++)
+    {
+      if (events[iPtr].iTable != iTable)
+        kept.push_back(events[iPtr]);
+    }
+    events.swap(kept);
+
+    AddTable(index, events, iTable, 50 + Random(100));
+
+    if (iUpdate % 20 == 0)
+      CheckQueries(index, events);
+  }
+  CheckQueries(index, events);
+
+  /* remove most tables, which compacts the index */
+  for (int iTable = 1; iTable <= 18; iTable++)
+    index.RemoveTable(iTable);
+  index.RemoveTable(100);
+
+  std::vector<SearchEvent> kept;
+  for (size_t iPtr = 0; iPtr < events.size(); iPtr++)
+  {
+    if (events[iPtr].iTable > 18)
+      kept.push_back(events[iPtr]);
+  }
+  events.swap(kept);
+  CheckQueries(index, events);
+
+  index.Clear();
+  BOOST_CHECK_EQUAL(index.Size(), 0u);
+  std::vector<CEpgSearchIndex::Hit> hits;
+  BOOST_CHECK_EQUAL(index.Search(CEpgSearchIndex::Query(), hits), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(BenchmarkEpgSearchIndex)
+{
+  CEpgSearchIndex index;
+  std::vector<SearchEvent> events;
+  std::vector<SearchEvent> table;
+  double buildTime = 0;
+  for (int iTable = 1; iTable <= BENCHMARK_CHANNELS; iTable++)
+  {
+    /* only keep the events the linear search is timed on */
+    table.clear();
+    CreateTable(table, iTable, BENCHMARK_EVENTS);
+
+    boost::posix_time::ptime start = BenchmarkStart();
+    IndexEvents(index, table, 0);
+    buildTime += ElapsedMilliseconds(start);
+
+    if (events.size() < BENCHMARK_LINEAR)
+      events.insert(events.end(), table.begin(), table.end());
+  }
+
+  /* two and three word queries, like "football cup" or "+star +trek" */
+  std::vector<CEpgSearchIndex::Query> queries;
+  for (unsigned int iQuery = 0; iQuery < BENCHMARK_QUERIES; iQuery++)
+  {
+    CEpgSearchIndex::Query query;
+    std::vector<std::string> &terms = iQuery % 2 ? query.andTerms : query.orTerms;
+    for (unsigned int iTerm = 0; iTerm < 2 + iQuery % 3; iTerm++)
+      terms.push_back(std::string(s_syllables[Random(SYLLABLES)]) + s_syllables[Random(SYLLABLES)]);
+    queries.push_back(query);
+  }
+
+  size_t iLinearHits = 0;
+  boost::posix_time::ptime start = BenchmarkStart();
+  for (unsigned int iQuery = 0; iQuery < BENCHMARK_QUERIES; iQuery++)
+  {
+    for (size_t iPtr = 0; iPtr < BENCHMARK_LINEAR; iPtr++)
+    {
+      if (LinearMatch(events[iPtr], queries[iQuery]))
+        iLinearHits++;
+    }
+  }
+  double linearTime = ElapsedMilliseconds(start) / BENCHMARK_QUERIES;
+
+  size_t iIndexHits = 0;
+  double maxTime = 0;
+  std::vector<CEpgSearchIndex::Hit> hits;
+  start = BenchmarkStart();
+  for (unsigned int iQuery = 0; iQuery < BENCHMARK_QUERIES; iQuery++)
+  {
+    boost::posix_time::ptime queryStart = BenchmarkStart();
+    iIndexHits += index.Search(queries[iQuery], hits);
+    maxTime = std::max(maxTime, ElapsedMilliseconds(queryStart));
+  }
+  double indexTime = ElapsedMilliseconds(start) / BENCHMARK_QUERIES;
+  BOOST_CHECK(iIndexHits >= iLinearHits);
+
+  /* index a table again, like after an EPG update */
+  table.clear();
+  CreateTable(table, 1, BENCHMARK_EVENTS);
+  start = BenchmarkStart();
+  for (int iTable = 1; iTable <= 10; iTable++)
+  {
+    index.RemoveTable(iTable);
+    for (size_t iPtr = 0; iPtr < table.size(); iPtr++)
+      table[iPtr].iTable = iTable;
+    IndexEvents(index, table, 0);
+  }
+  double updateTime = ElapsedMilliseconds(start) / 10;
+
+  printf("%u events: index built in %.1f ms, a table updated in %.2f ms\n",
+      (unsigned int) index.Size(), buildTime, updateTime);
+  printf("query               linear (ms)  index (ms)  index max (ms)\n");
+  printf("%u events %21.1f\n", BENCHMARK_LINEAR, linearTime);
+  printf("%u events %32.1f %15.1f\n", BENCHMARK_CHANNELS * BENCHMARK_EVENTS, indexTime, maxTime);
+}
@@ -0,0 +1,245 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "epg/EpgTimeIndex.h"
+#include "utils/test/TestUtils.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+
+using namespace EPG;
+
+#define BENCHMARK_CHANNELS 800
+#define BENCHMARK_EVENTS   1250   /* 14 days of events of 16 minutes on average */
+#define BENCHMARK_QUERIES  10000
+
+//=============================================================================
+// Helper functions
+//=============================================================================
+
+static CTestRandom Random;
+
+namespace
+{
+struct Event
+{
+  int64_t iStart;
+  int64_t iEnd;
+};
+}
+
+/* what CEpg did before it had an index: a scan through all events in order,
+   though it compared copies of the tags' CDateTimes, which is a lot slower still */
+static int LinearAround(const std::vector<Event> &events, int64_t iTime, bool bEndInclusive)
+{
+  for (size_t iPtr = 0; iPtr < events.size(); iPtr++)
+  {
+    if (events[iPtr].iStart <= iTime && (events[iPtr].iEnd > iTime || (bEndInclusive && events[iPtr].iEnd == iTime)))
+      return (int) iPtr;
+  }
+  return -1;
+}
+
+static int LinearBetween(const std::vector<Event> &events, int64_t iBegin, int64_t iEnd)
+{
+  for (size_t iPtr = 0; iPtr < events.size(); iPtr++)
+  {
+    if (events[iPtr].iStart >= iBegin && events[iPtr].iEnd <= iEnd)
+      return (int) iPtr;
+  }
+  return -1;
+}
+
+static size_t LinearStartingAfter(const std::vector<Event> &events, int64_t iTime)
+{
+  size_t iPtr = 0;
+  while (iPtr < events.size() && events[iPtr].iStart <= iTime)
+    iPtr++;
+  return iPtr;
+}
+
+static void Insert(CEpgTimeIndex &index, std::vector<Event> &events, int64_t iStart, int64_t iEnd)
+{
+  size_t iPtr = index.InsertPosition(iStart);
+  BOOST_REQUIRE_EQUAL(iPtr, LinearStartingAfter(events, iStart));
+
+  Event event = { iStart, iEnd };
+  events.insert(events.begin() + iPtr, event);
+  index.Insert(iPtr, iStart, iEnd);
+}
+
+static void CheckQueries(const CEpgTimeIndex &index, const std::vector<Event> &events, int64_t iRange)
+{
+  BOOST_REQUIRE_EQUAL(index.Size(), events.size());
+  for (int iQuery = 0; iQuery < 200; iQuery++)
+  {
+    int64_t iTime = Random(iRange);
+    BOOST_CHECK_EQUAL(index.FindAround(iTime, true), LinearAround(events, iTime, true));
+    BOOST_CHECK_EQUAL(index.FindAround(iTime, false), LinearAround(events, iTime, false));
+    BOOST_CHECK_EQUAL(index.FirstStartingAfter(iTime), LinearStartingAfter(events, iTime));
+
+    int64_t iEnd = iTime + Random(iRange / 10);
+    BOOST_CHECK_EQUAL(index.FindBetween(iTime, iEnd), LinearBetween(events, iTime, iEnd));
+  }
+}
+
+//=============================================================================
+// Tests
+//=============================================================================
+
+BOOST_AUTO_TEST_CASE(TestEpgTimeIndexGuide)
+{
+  /* a regular guide without gaps or overlaps */
+  CEpgTimeIndex index;
+  std::vector<Event> events;
+  int64_t iTime = 1000;
+  for (int iEvent = 0; iEvent < 100; iEvent++)
+  {
+    int64_t iLength = 60 + Random(3600);
+    Insert(index, events, iTime, iTime + iLength);
+    iTime += iLength;
+  }
+
+  BOOST_CHECK_EQUAL(index.FindAround(999, true), -1);
+  BOOST_CHECK_EQUAL(index.FindAround(1000, false), 0);
+  BOOST_CHECK_EQUAL(index.FindAround(iTime, true), 99);
+  BOOST_CHECK_EQUAL(index.FindAround(iTime, false), -1);
+  BOOST_CHECK_EQUAL(index.FindAround(events[10].iEnd, true), 10);
+  BOOST_CHECK_EQUAL(index.FindAround(events[10].iEnd, false), 11);
+  BOOST_CHECK_EQUAL(index.FindBetween(events[10].iStart, events[10].iEnd), 10);
+  BOOST_CHECK_EQUAL(index.FindBetween(events[10].iStart + 1, events[11].iEnd), 11);
+  BOOST_CHECK_EQUAL(index.FindBetween(events[10].iStart + 1, events[11].iEnd - 1), -1);
+  BOOST_CHECK_EQUAL(index.FirstStartingFrom(events[20].iStart), 20u);
+  BOOST_CHECK_EQUAL(index.FirstStartingAfter(events[20].iStart), 21u);
+
+  CheckQueries(index, events, iTime + 1000);
+}
+
+BOOST_AUTO_TEST_CASE(TestEpgTimeIndexOverlapping)
+{
+  /* events of any length in any order, as they could come in from a client */
+  CEpgTimeIndex index;
+  std::vector<Event> events;
+  for (int iEvent = 0; iEvent < 500; iEvent++)
+  {
+    int64_t iStart = Random(100000);
+    Insert(index, events, iStart, iStart + Random(iEvent % 10 == 0 ? 20000 : 2000));
+  }
+  CheckQueries(index, events, 110000);
+
+  /* change the end times, which moves the maximum end times both ways */
+  for (int iChange = 0; iChange < 100; iChange++)
+  {
+    size_t iPtr = Random(events.size());
+    events[iPtr].iEnd = events[iPtr].iStart + Random(iChange % 2 ? 30000 : 10);
+    index.Set(iPtr, events[iPtr].iStart, events[iPtr].iEnd);
+  }
+  CheckQueries(index, events, 110000);
+
+  /* and remove ranges of events */
+  for (int iChange = 0; iChange < 50; iChange++)
+  {
+    size_t iFrom = Random(events.size());
+    size_t iTo = iFrom + Random(std::min<size_t>(5, events.size() - iFrom) + 1);
+    events.erase(events.begin() + iFrom, events.begin() + iTo);
+    index.Erase(iFrom, iTo);
+  }
+  CheckQueries(index, events, 110000);
+
+  index.Clear();
+  BOOST_CHECK_EQUAL(index.Size(), 0u);
+  BOOST_CHECK_EQUAL(index.FindAround(10, true), -1);
+  BOOST_CHECK_EQUAL(index.FindBetween(0, 100000), -1);
+}
+
+BOOST_AUTO_TEST_CASE(BenchmarkEpgTimeIndex)
+{
+  /* a guide of 1M events, spread over the channels */
+  std::vector<std::vector<Event> > guide(BENCHMARK_CHANNELS);
+  std::vector<CEpgTimeIndex> indexes(BENCHMARK_CHANNELS);
+  const int64_t iGuideStart = 1320000000;
+  int64_t iGuideEnd = iGuideStart;
+
+  boost::posix_time::ptime start = BenchmarkStart();
+  for (unsigned int iChannel = 0; iChannel < BENCHMARK_CHANNELS; iChannel++)
+  {
+    int64_t iTime = iGuideStart;
+    for (unsigned int iEvent = 0; iEvent < BENCHMARK_EVENTS; iEvent++)
+    {
+      int64_t iLength = 300 + Random(1334);
+      Event event = { iTime, iTime + iLength };
+      guide[iChannel].push_back(event);
+      indexes[iChannel].Insert(indexes[iChannel].InsertPosition(iTime), iTime, iTime + iLength);
+      iTime += iLength;
+    }
+    iGuideEnd = std::max(iGuideEnd, iTime);
+  }
+  double buildTime = ElapsedMilliseconds(start);
+
+  /* "now" and "next" for every channel, like the PVR info labels do, at random times */
+  std::vector<int64_t> times;
+  for (unsigned int iQuery = 0; iQuery < BENCHMARK_QUERIES; iQuery++)
+    times.push_back(iGuideStart + Random((unsigned int) (iGuideEnd - iGuideStart)));
+
+  unsigned int iQueries = 0;
+  int iLinearSum = 0, iIndexSum = 0;
+  start = BenchmarkStart();
+  for (unsigned int iQuery = 0; iQuery < BENCHMARK_QUERIES / 100; iQuery++)
+  {
+    for (unsigned int iChannel = 0; iChannel < BENCHMARK_CHANNELS; iChannel++)
+    {
+      iLinearSum += LinearAround(guide[iChannel], times[iQuery], false);
+      iLinearSum += (int) LinearStartingAfter(guide[iChannel], times[iQuery]);
+      iQueries++;
+    }
+  }
+  double linearTime = ElapsedMilliseconds(start);
+
+  start = BenchmarkStart();
+  for (unsigned int iQuery = 0; iQuery < BENCHMARK_QUERIES / 100; iQuery++)
+  {
+    for (unsigned int iChannel = 0; iChannel < BENCHMARK_CHANNELS; iChannel++)
+    {
+      iIndexSum += indexes[iChannel].FindAround(times[iQuery], false);
+      iIndexSum += (int) indexes[iChannel].FirstStartingAfter(times[iQuery]);
+    }
+  }
+  double indexTime = ElapsedMilliseconds(start);
+  BOOST_CHECK_EQUAL(iLinearSum, iIndexSum);
+
+  /* the full query set only with the index, the linear scan would take too long */
+  start = BenchmarkStart();
+  for (unsigned int iQuery = 0; iQuery < BENCHMARK_QUERIES; iQuery++)
+  {
+    for (unsigned int iChannel = 0; iChannel < BENCHMARK_CHANNELS; iChannel++)
+      iIndexSum += indexes[iChannel].FindBetween(times[iQuery] - 120, times[iQuery] + 3600);
+  }
+  double betweenTime = ElapsedMilliseconds(start);
+
+  printf("%u events: index built in %.1f ms\n", BENCHMARK_CHANNELS * BENCHMARK_EVENTS, buildTime);
+  printf("%u now/next lookups      linear (ms)  index (ms)\n", iQueries);
+  printf("%36.1f %11.1f\n", linearTime, indexTime);
+  printf("%u between lookups: %.1f ms\n", BENCHMARK_QUERIES * BENCHMARK_CHANNELS, betweenTime);
+}
@@ -0,0 +1,479 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "threads/SystemClock.h"
+#include "system.h"
+#ifdef _LINUX
+#include "PlatformInclude.h"
+#endif
+#include "Util.h"
+#include "utils/log.h"
+#include "threads/SingleLock.h"
+#include "SpecialProtocol.h"
+#include "CacheSparse.h"
+
+using namespace XFILE;
+
+#define CACHE_BLOCK_SIZE  (256 * 1024)
+
+// data behind the read position is this much less likely to be
+// read again than data ahead of it, which leaves roughly a quarter
+// of the budget for the back buffer once the cache is full
+#define CACHE_BACK_WEIGHT 3
+
+CCacheSparse::CCacheSparse(size_t size, bool onDisk)
+ : CCacheStrategy()
+ , m_slots(std::max<unsigned>(size / CACHE_BLOCK_SIZE, 4))
+ , m_cur(0)
+ , m_write(0)
+ , m_eof(-1)
+ , m_onDisk(onDisk)
+ , m_buf(NULL)
+ , m_handle(INVALID_HANDLE_VALUE)
+{
+}
+
+CCacheSparse::~CCacheSparse()
+{
+  Close();
+}
+
+int CCacheSparse::Open()
+{
+  Close();
+
+  if (m_onDisk)
+  {
+    CStdString fileName = CSpecialProtocol::TranslatePath(CUtil::GetNextFilename("special://temp/filecache%03d.cache", 999));
+    if (fileName.empty())
+    {
+      CLog::Log(LOGERROR, "%s - Unable to generate a new filename", __FUNCTION__);
+      return CACHE_RC_ERROR;
+    }
+
+    m_handle = CreateFile(fileName.c_str()
+              , GENERIC_READ | GENERIC_WRITE, 0
+              , NULL
+              , CREATE_ALWAYS
+              , FILE_ATTRIBUTE_NORMAL | FILE_FLAG_DELETE_ON_CLOSE
+              , NULL);
+
+    if (m_handle == INVALID_HANDLE_VALUE)
+    {
+      CLog::Log(LOGERROR, "%s - failed to create file %s with error code %d", __FUNCTION__, fileName.c_str(), GetLastError());
+      return CACHE_RC_ERROR;
+    }
+  }
+  else
+  {
+    m_buf = new uint8_t[(size_t)m_slots * CACHE_BLOCK_SIZE];
+    if (m_buf == NULL)
+      return CACHE_RC_ERROR;
+  }
+
+  m_free.clear();
+  m_free.reserve(m_slots);
+  for (unsigned slot = m_slots; slot > 0; slot--)
+    m_free.push_back(slot - 1);
+
+  m_cur   = 0;
+  m_write = 0;
+  m_eof   = -1;
+  return CACHE_RC_OK;
+}
+
+void CCacheSparse::Close()
+{
+  CSingleLock lock(m_sync);
+  delete[] m_buf;
+  m_buf = NULL;
+
+  if (m_handle != INVALID_HANDLE_VALUE)
+    CloseHandle(m_handle);
+  m_handle = INVALID_HANDLE_VALUE;
+
+  m_blocks.clear();
+  m_ranges.clear();
+  m_free.clear();
+}
+
+/**
+ * Returns the end of the cached range holding pos, or
+ * pos itself if that byte isn't cached.
+ */
+uint64_t CCacheSparse::RangeEnd(uint64_t pos) const
+{
+  RangeMap::const_iterator it = m_ranges.upper_bound(pos);
+  if (it == m_ranges.begin())
+    return pos;
+  --it;
+  return it->second > pos ? it->second : pos;
+}
+
+void CCacheSparse::AddRange(uint64_t beg, uint64_t end)
+{
+  // join a range ending at (or past) the start of the new one
+  RangeMap::iterator it = m_ranges.upper_bound(beg);
+  if (it != m_ranges.begin())
+  {
+    RangeMap::iterator prev = it;
+    --prev;
+    if (prev->second >= beg)
+    {
+      beg = prev->first;
+      end = std::max(end, prev->second);
+      m_ranges.erase(prev);
+    }
+  }
+
+  // and swallow all ranges starting before its end
+  while (it != m_ranges.end() && it->first <= end)
+  {
+    end = std::max(end, it->second);
+    m_ranges.erase(it++);
+  }
+
+  m_ranges[beg] = end;
+}
+
+/**
+ * Removes [beg, end) from the index. The span must
+ * lie within a single range, as a block's data does.
+ */
+void CCacheSparse::RemoveRange(uint64_t beg, uint64_t end)
+{
+  if (beg == end)
+    return;
+
+  RangeMap::iterator it = m_ranges.upper_bound(beg);
+  if (it == m_ranges.begin())
+    return;
+  --it;
+  if (it->second <= beg)
+    return;
+
+  uint64_t tail = it->second;
+  if (it->first == beg)
+    m_ranges.erase(it);
+  else
+    it->second = beg;
+
+  if (tail > end)
+    m_ranges[end] = tail;
+}
+
+/**
+ * How far a block is from the reader, weighing data
+ * behind the read position as farther away.
+ */
+uint64_t CCacheSparse::Distance(uint64_t block) const
+{
+  uint64_t current = m_cur / CACHE_BLOCK_SIZE;
+  if (block >= current)
+    return block - current;
+  return (current - block) * CACHE_BACK_WEIGHT;
+}
+
+/**
+ * Finds storage for a new block, recycling the block farthest
+ * from the reader if need be. Fails if all cached blocks are
+ * at least as close to the reader as the new one.
+ */
+bool CCacheSparse::AllocateSlot(uint64_t block, unsigned &slot)
+{
+  if (!m_free.empty())
+  {
+    slot = m_free.back();
+    m_free.pop_back();
+    return true;
+  }
+
+  BlockMap::iterator victim = m_blocks.end();
+  uint64_t distance = Distance(block);
+  for (BlockMap::iterator it = m_blocks.begin(); it != m_blocks.end(); ++it)
+  {
+    uint64_t d = Distance(it->first);
+    if (d > distance)
+    {
+      victim = it;
+      distance = d;
+    }
+  }
+
+  if (victim == m_blocks.end())
+    return false;
+
+  slot = victim->second.slot;
+  RemoveRange(victim->first * CACHE_BLOCK_SIZE + victim->second.beg
+            , victim->first * CACHE_BLOCK_SIZE + victim->second.end);
+  m_blocks.erase(victim);
+  return true;
+}
+
+void CCacheSparse::DropBlock(BlockMap::iterator it)
+{
+  RemoveRange(it->first * CACHE_BLOCK_SIZE + it->second.beg
+            , it->first * CACHE_BLOCK_SIZE + it->second.end);
+  m_free.push_back(it->second.slot);
+  m_blocks.erase(it);
+}
+
+bool CCacheSparse::Store(unsigned slot, unsigned offset, const char *buf, size_t len)
+{
+  if (!m_onDisk)
+  {
+    memcpy(m_buf + (size_t)slot * CACHE_BLOCK_SIZE + offset, buf, len);
+    return true;
+  }
+
+  LARGE_INTEGER pos;
+  pos.QuadPart = (int64_t)slot * CACHE_BLOCK_SIZE + offset;
+  DWORD written = 0;
+  if (!SetFilePointerEx(m_handle, pos, NULL, FILE_BEGIN)
+  ||  !WriteFile(m_handle, buf, len, &written, NULL)
+  ||  written != len)
+  {
+    CLog::Log(LOGERROR, "%s - failed to write to file. err: %u", __FUNCTION__, GetLastError());
+    return false;
+  }
+  return true;
+}
+
+bool CCacheSparse::Load(unsigned slot, unsigned offset, char *buf, size_t len)
+{
+  if (!m_onDisk)
+  {
+    memcpy(buf, m_buf + (size_t)slot * CACHE_BLOCK_SIZE + offset, len);
+    return true;
+  }
+
+  LARGE_INTEGER pos;
+  pos.QuadPart = (int64_t)slot * CACHE_BLOCK_SIZE + offset;
+  DWORD read = 0;
+  if (!SetFilePointerEx(m_handle, pos, NULL, FILE_BEGIN)
+  ||  !ReadFile(m_handle, buf, len, &read, NULL)
+  ||  read != len)
+  {
+    CLog::Log(LOGERROR, "%s - failed to read from file. err: %u", __FUNCTION__, GetLastError());
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Writes at m_write, at most up to the end of the block it falls in,
+ * so multiple calls may be needed to store a buffer completely.
+ *
+ * Data that is cached already is skipped over rather than copied, the
+ * caller should move the write position on using CachedDataEndPos.
+ * Returns 0 if the budget is used up by data closer to the reader.
+ */
+int CCacheSparse::WriteToCache(const char *buf, size_t len)
+{
+  CSingleLock lock(m_sync);
+
+  uint64_t block  = m_write / CACHE_BLOCK_SIZE;
+  unsigned offset = (unsigned)(m_write % CACHE_BLOCK_SIZE);
+  if (len > CACHE_BLOCK_SIZE - offset)
+    len = CACHE_BLOCK_SIZE - offset;
+
+  if (len == 0)
+    return 0;
+
+  BlockMap::iterator it = m_blocks.find(block);
+  if (it != m_blocks.end())
+  {
+    SBlock &b = it->second;
+    if (offset >= b.beg && offset < b.end)
+    {
+      len = std::min<size_t>(len, b.end - offset);
+      m_write += len;
+      return len;
+    }
+
+    // a block holds a single run of data, drop what isn't adjacent
+    if (offset != b.end)
+    {
+      RemoveRange(block * CACHE_BLOCK_SIZE + b.beg, block * CACHE_BLOCK_SIZE + b.end);
+      b.beg = offset;
+      b.end = offset;
+    }
+  }
+  else
+  {
+    SBlock b;
+    if (!AllocateSlot(block, b.slot))
+      return 0;
+    b.beg = offset;
+    b.end = offset;
+    it = m_blocks.insert(std::make_pair(block, b)).first;
+  }
+
+  if (!Store(it->second.slot, offset, buf, len))
+  {
+    DropBlock(it);
+    return CACHE_RC_ERROR;
+  }
+
+  it->second.end += len;
+  AddRange(m_write, m_write + len);
+  m_write += len;
+
+  // the input didn't end where it did before
+  if (m_eof >= 0 && m_write > (uint64_t)m_eof)
+    m_eof = -1;
+
+  m_written.Set();
+
+  return len;
+}
+
+/**
+ * Reads data from cache. Will only read up till the end
+ * of the block, so multiple calls may be needed.
+ */
+int CCacheSparse::ReadFromCache(char *buf, size_t len)
+{
+  CSingleLock lock(m_sync);
+
+  uint64_t block  = m_cur / CACHE_BLOCK_SIZE;
+  unsigned offset = (unsigned)(m_cur % CACHE_BLOCK_SIZE);
+
+  BlockMap::iterator it = m_blocks.find(block);
+  if (it == m_blocks.end() || offset < it->second.beg || offset >= it->second.end)
+  {
+    if (IsEndOfInput())
+      return 0;
+    else
+      return CACHE_RC_WOULD_BLOCK;
+  }
+
+  if (len > it->second.end - offset)
+    len = it->second.end - offset;
+
+  if (len == 0)
+    return 0;
+
+  if (!Load(it->second.slot, offset, buf, len))
+    return CACHE_RC_ERROR;
+
+  m_cur += len;
+
+  m_space.Set();
+
+  return len;
+}
+
+int64_t CCacheSparse::WaitForData(unsigned int minimum, unsigned int millis)
+{
+  CSingleLock lock(m_sync);
+  uint64_t avail = RangeEnd(m_cur) - m_cur;
+
+  if (millis == 0 || IsEndOfInput())
+    return avail;
+
+  if (minimum > m_slots * (CACHE_BLOCK_SIZE / 2))
+    minimum = m_slots * (CACHE_BLOCK_SIZE / 2);
+
+  XbmcThreads::EndTime endtime(millis);
+  while (!IsEndOfInput() && avail < minimum && !endtime.IsTimePast())
+  {
+    lock.Leave();
+    m_written.WaitMSec(50); // may miss the deadline. shouldn't be a problem.
+    lock.Enter();
+    avail = RangeEnd(m_cur) - m_cur;
+  }
+
+  return avail;
+}
+
+int64_t CCacheSparse::Seek(int64_t pos)
+{
+  CSingleLock lock(m_sync);
+
+  // if seek is a bit over what is being written, try to wait a few seconds for the data to be available.
+  // we try to avoid a (heavy) seek on the source
+  if ((uint64_t)pos >= m_write && (uint64_t)pos < m_write + 100000 && !CCacheStrategy::IsEndOfInput())
+  {
+    XbmcThreads::EndTime endtime(5000);
+    while (RangeEnd(pos) == (uint64_t)pos && !CCacheStrategy::IsEndOfInput() && !endtime.IsTimePast())
+    {
+      lock.Leave();
+      m_written.WaitMSec(50);
+      lock.Enter();
+    }
+  }
+
+  if (RangeEnd(pos) != (uint64_t)pos || (uint64_t)pos == m_write || pos == m_eof)
+  {
+    m_cur = pos;
+    return pos;
+  }
+
+  return CACHE_RC_ERROR;
+}
+
+void CCacheSparse::Reset(int64_t pos)
+{
+  CSingleLock lock(m_sync);
+  m_cur   = pos;
+  m_write = pos;
+  m_eof   = -1;
+}
+
+void CCacheSparse::EndOfInput()
+{
+  CSingleLock lock(m_sync);
+  CCacheStrategy::EndOfInput();
+  m_eof = m_write;
+  m_written.Set();
+}
+
+void CCacheSparse::ClearEndOfInput()
+{
+  CSingleLock lock(m_sync);
+  CCacheStrategy::ClearEndOfInput();
+  m_eof = -1;
+}
+
+/**
+ * The input only ended for the reader once it got to where the input
+ * ended, until then the gaps may still be filled. Where that is is
+ * forgotten once the source is read from elsewhere or written past it.
+ */
+bool CCacheSparse::IsEndOfInput()
+{
+  CSingleLock lock(m_sync);
+  return m_eof >= 0 && m_cur >= (uint64_t)m_eof;
+}
+
+int64_t CCacheSparse::CachedDataEndPos()
+{
+  CSingleLock lock(m_sync);
+  return RangeEnd(m_cur);
+}
+
+void CCacheSparse::SetWritePosition(int64_t pos)
+{
+  CSingleLock lock(m_sync);
+  m_write = pos;
+  m_eof   = -1;
+}
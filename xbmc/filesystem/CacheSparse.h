@@ -0,0 +1,98 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef CACHESPARSE_H
+#define CACHESPARSE_H
+
+#include <map>
+#include <vector>
+#include "CacheStrategy.h"
+#include "threads/CriticalSection.h"
+#include "threads/Event.h"
+
+namespace XFILE {
+
+/**
+ * Cache strategy keeping any number of byte ranges of the source.
+ *
+ * Data is stored in fixed size blocks, in memory or in a temporary
+ * file, up to a fixed budget. Seeking to a position that has been
+ * cached before does not drop anything, and once the budget is used
+ * up the blocks farthest away from the read position are recycled.
+ */
+class CCacheSparse : public CCacheStrategy
+{
+public:
+    CCacheSparse(size_t size, bool onDisk);
+    virtual ~CCacheSparse();
+
+    virtual int Open() ;
+    virtual void Close();
+
+    virtual int WriteToCache(const char *buf, size_t len) ;
+    virtual int ReadFromCache(char *buf, size_t len) ;
+    virtual int64_t WaitForData(unsigned int minimum, unsigned int millis) ;
+
+    virtual int64_t Seek(int64_t pos) ;
+    virtual void Reset(int64_t pos) ;
+
+    virtual void EndOfInput();
+    virtual bool IsEndOfInput();
+    virtual void ClearEndOfInput();
+
+    virtual int64_t CachedDataEndPos();
+    virtual void SetWritePosition(int64_t pos);
+
+protected:
+    struct SBlock
+    {
+      unsigned slot;  /**< index of the storage slot holding the block */
+      unsigned beg;   /**< start of valid data, relative to the block */
+      unsigned end;   /**< end of valid data, relative to the block */
+    };
+    typedef std::map<uint64_t, SBlock>   BlockMap;
+    typedef std::map<uint64_t, uint64_t> RangeMap;
+
+    uint64_t RangeEnd(uint64_t pos) const;
+    void     AddRange(uint64_t beg, uint64_t end);
+    void     RemoveRange(uint64_t beg, uint64_t end);
+    uint64_t Distance(uint64_t block) const;
+    bool     AllocateSlot(uint64_t block, unsigned &slot);
+    void     DropBlock(BlockMap::iterator it);
+    bool     Store(unsigned slot, unsigned offset, const char *buf, size_t len);
+    bool     Load(unsigned slot, unsigned offset, char *buf, size_t len);
+
+    BlockMap          m_blocks;    /**< cached blocks by index in file */
+    RangeMap          m_ranges;    /**< interval index of contiguous cached data, start -> end */
+    std::vector<unsigned> m_free;  /**< storage slots not holding a block */
+    unsigned          m_slots;     /**< number of blocks that fit the budget */
+    uint64_t          m_cur;       /**< current reading index in file */
+    uint64_t          m_write;     /**< index in file the next write goes to */
+    int64_t           m_eof;       /**< index in file the input ended at, -1 if unknown */
+    bool              m_onDisk;    /**< blocks are kept in a temporary file instead of memory */
+    uint8_t          *m_buf;       /**< memory holding the blocks */
+    HANDLE            m_handle;    /**< temporary file holding the blocks */
+    CCriticalSection  m_sync;
+    CEvent            m_written;
+};
+
+} // namespace XFILE
+#endif
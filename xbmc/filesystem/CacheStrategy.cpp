@@ -58,6 +58,16 @@ void CCacheStrategy::ClearEndOfInput()
   m_bEndOfInput = false;
 }
 
+int64_t CCacheStrategy::CachedDataEndPos()
+{
+  return CACHE_RC_ERROR;
+}
+
+void CCacheStrategy::SetWritePosition(int64_t iSourcePosition)
+{
+  Reset(iSourcePosition);
+}
+
 CSimpleFileCache::CSimpleFileCache()
   : m_hCacheFileRead(NULL)
   , m_hCacheFileWrite(NULL)
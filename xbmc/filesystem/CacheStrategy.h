@@ -58,6 +58,9 @@ public:
   virtual bool IsEndOfInput();
   virtual void ClearEndOfInput();
 
+  virtual int64_t CachedDataEndPos(); // end of the cached data following the read position, CACHE_RC_ERROR if the source is always read on from the end of the cache
+  virtual void SetWritePosition(int64_t iSourcePosition); // continue writing at another position without dropping what has been cached
+
   CEvent m_space;
 protected:
   bool  m_bEndOfInput;
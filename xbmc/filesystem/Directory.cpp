@@ -128,8 +128,21 @@ bool CDirectory::GetDirectory(const CStdString& strPath, CFileItemList &items, C
       return false;
 
     // check our cache for this path
-    if (g_directoryCache.GetDirectory(strPath, items, cacheDirectory == DIR_CACHE_ALWAYS))
+    boost::shared_ptr<const CFileItemList> cachedItems;
+    if (g_directoryCache.GetDirectory(strPath, cachedItems, cacheDirectory == DIR_CACHE_ALWAYS))
+    {
+      // the cached items are shared with the cache, only those we keep are copied
+      pDirectory->SetMask(strMask);
+      items.Copy(*cachedItems, false);
       items.SetPath(strPath);
+      items.Reserve(cachedItems->Size());
+      for (int i = 0; i < cachedItems->Size(); ++i)
+      {
+        const CFileItemPtr item = cachedItems->Get(i);
+        if (IsAllowed(*pDirectory, *item, getHidden))
+          items.Add(CFileItemPtr(new CFileItem(*item)));
+      }
+    }
     else
     {
       // need to clear the cache (in case the directory fetch fails)
@@ -189,20 +202,16 @@ bool CDirectory::GetDirectory(const CStdString& strPath, CFileItemList &items, C
       // cache the directory, if necessary
       if (cacheDirectory != DIR_CACHE_NEVER)
         g_directoryCache.SetDirectory(strPath, items, pDirectory->GetCacheType(strPath));
-    }
 
-    // now filter for allowed files
-    pDirectory->SetMask(strMask);
-    for (int i = 0; i < items.Size(); ++i)
-    {
-      CFileItemPtr item = items[i];
-      // TODO: we shouldn't be checking the gui setting here;
-      // callers should use getHidden instead
-      if ((!item->m_bIsFolder && !pDirectory->IsAllowed(item->GetPath())) ||
-          (item->GetProperty("file:hidden").asBoolean() && !getHidden && !g_guiSettings.GetBool("filelists.showhidden")))
+      // now filter for allowed files
+      pDirectory->SetMask(strMask);
+      for (int i = 0; i < items.Size(); ++i)
       {
-        items.Remove(i);
-        i--; // don't confuse loop
+        if (!IsAllowed(*pDirectory, *items[i], getHidden))
+        {
+          items.Remove(i);
+          i--; // don't confuse loop
+        }
       }
     }
 
@@ -298,6 +307,15 @@ bool CDirectory::Remove(const CStdString& strPath)
   return false;
 }
 
+bool CDirectory::IsAllowed(const IDirectory &directory, const CFileItem &item, bool getHidden)
+{
+  // TODO: we shouldn't be checking the gui setting here;
+  // callers should use getHidden instead
+  if (!item.m_bIsFolder && !directory.IsAllowed(item.GetPath()))
+    return false;
+  return !item.GetProperty("file:hidden").asBoolean() || getHidden || g_guiSettings.GetBool("filelists.showhidden");
+}
+
 void CDirectory::FilterFileDirectories(CFileItemList &items, const CStdString &mask)
 {
   for (int i=0; i< items.Size(); ++i)
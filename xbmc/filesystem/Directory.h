@@ -22,6 +22,8 @@
 
 #include "IDirectory.h"
 
+class CFileItem;
+
 namespace XFILE
 {
 /*!
@@ -52,5 +54,9 @@ public:
    \param items The item list to filter
    \param mask  The mask to apply when filtering files */
   static void FilterFileDirectories(CFileItemList &items, const CStdString &mask);
+
+private:
+  /*! \brief Whether an item of a listing passes the directory's mask and the hidden file setting */
+  static bool IsAllowed(const IDirectory &directory, const CFileItem &item, bool getHidden);
 };
 }
@@ -21,71 +21,125 @@
 
 #include "DirectoryCache.h"
 #include "settings/Settings.h"
+#include "settings/AdvancedSettings.h"
 #include "FileItem.h"
+#include "music/tags/MusicInfoTag.h"
+#include "video/VideoInfoTag.h"
 #include "threads/SingleLock.h"
 #include "utils/log.h"
 #include "utils/URIUtils.h"
-#include "climits"
+
+#include <string.h>
 
 using namespace std;
 using namespace XFILE;
 
-CDirectoryCache::CDir::CDir(DIR_CACHE_TYPE cacheType)
+CDirectoryCache::CDir::CDir(DIR_CACHE_TYPE cacheType, const CSnapshot &items, bool pinned)
+  : m_Items(items)
 {
   m_cacheType = cacheType;
-  m_lastAccess = 0;
-  m_Items = new CFileItemList;
-  m_Items->SetFastLookup(true);
+  m_pinned = pinned;
+  m_size = 0;
+  m_prev = m_next = NULL;
 }
 
-CDirectoryCache::CDir::~CDir()
+CDirectoryCache::CShard::CShard()
 {
-  delete m_Items;
+  m_head = m_tail = NULL;
+  m_size = 0;
+  m_hits = 0;
+  m_misses = 0;
+  m_evictions = 0;
 }
 
-void CDirectoryCache::CDir::SetLastAccess(unsigned int &accessCounter)
+void CDirectoryCache::CShard::Link(CDir *dir)
 {
-  m_lastAccess = accessCounter++;
+  dir->m_prev = NULL;
+  dir->m_next = m_head;
+  if (m_head)
+    m_head->m_prev = dir;
+  else
+    m_tail = dir;
+  m_head = dir;
+}
+
+void CDirectoryCache::CShard::Unlink(CDir *dir)
+{
+  if (dir->m_prev)
+    dir->m_prev->m_next = dir->m_next;
+  else
+    m_head = dir->m_next;
+  if (dir->m_next)
+    dir->m_next->m_prev = dir->m_prev;
+  else
+    m_tail = dir->m_prev;
+  dir->m_prev = dir->m_next = NULL;
+}
+
+void CDirectoryCache::CShard::Touch(CDir *dir)
+{
+  if (dir->m_pinned || m_head == dir)
+    return;
+  Unlink(dir);
+  Link(dir);
 }
 
 CDirectoryCache::CDirectoryCache(void)
 {
   m_iThumbCacheRefCount = 0;
   m_iMusicThumbCacheRefCount = 0;
-  m_accessCounter = 0;
-#ifdef _DEBUG
-  m_cacheHits = 0;
-  m_cacheMisses = 0;
-#endif
 }
 
 CDirectoryCache::~CDirectoryCache(void)
 {
+  for (unsigned int s = 0; s < DIRECTORY_CACHE_SHARDS; s++)
+  {
+    CShard &shard = m_shards[s];
+    for (iCache i = shard.m_dirs.begin(); i != shard.m_dirs.end(); ++i)
+      delete i->second;
+  }
 }
 
-bool CDirectoryCache::GetDirectory(const CStdString& strPath, CFileItemList &items, bool retrieveAll)
+CDirectoryCache::CShard &CDirectoryCache::GetShard(const CStdString &strPath)
 {
-  CSingleLock lock (m_cs);
+  // FNV-1a
+  unsigned int hash = 2166136261u;
+  for (const char *c = strPath.c_str(); *c; c++)
+    hash = (hash ^ (unsigned char)*c) * 16777619u;
+  return m_shards[hash % DIRECTORY_CACHE_SHARDS];
+}
 
+bool CDirectoryCache::GetDirectory(const CStdString& strPath, boost::shared_ptr<const CFileItemList> &items, bool retrieveAll)
+{
   CStdString storedPath = URIUtils::SubstitutePath(strPath);
   URIUtils::RemoveSlashAtEnd(storedPath);
 
-  ciCache i = m_cache.find(storedPath);
-  if (i != m_cache.end())
+  CShard &shard = GetShard(storedPath);
+  CSnapshot snapshot;
   {
-    CDir* dir = i->second;
-    if (dir->m_cacheType == XFILE::DIR_CACHE_ALWAYS ||
-       (dir->m_cacheType == XFILE::DIR_CACHE_ONCE && retrieveAll))
+    CSingleLock lock (shard.m_cs);
+    ciCache i = shard.m_dirs.find(storedPath);
+    if (i != shard.m_dirs.end())
     {
-      items.Copy(*dir->m_Items);
-      dir->SetLastAccess(m_accessCounter);
-#ifdef _DEBUG
-      m_cacheHits+=items.Size();
-#endif
-      return true;
+      CDir* dir = i->second;
+      if (dir->m_cacheType == XFILE::DIR_CACHE_ALWAYS ||
+         (dir->m_cacheType == XFILE::DIR_CACHE_ONCE && retrieveAll))
+      {
+        snapshot = dir->m_Items;
+        shard.Touch(dir);
+      }
     }
+    if (snapshot)
+      shard.m_hits++;
+    else
+      shard.m_misses++;
   }
-  return false;
+  if (!snapshot)
+    return false;
+
+  // cached listings are replaced rather than altered, so the caller can share it
+  items = snapshot;
+  return true;
 }
 
 void CDirectoryCache::SetDirectory(const CStdString& strPath, const CFileItemList &items, DIR_CACHE_TYPE cacheType)
@@ -104,19 +158,39 @@ void CDirectoryCache::SetDirectory(const CStdString& strPath, const CFileItemLis
   // IDEALLY, any further processing on the item would actually create a new item
   // instead of altering it, but we can't really enforce that in an easy way, so
   // this is the best solution for now.
-  CSingleLock lock (m_cs);
-
   CStdString storedPath = URIUtils::SubstitutePath(strPath);
   URIUtils::RemoveSlashAtEnd(storedPath);
 
-  ClearDirectory(storedPath);
+  CSnapshot snapshot(new CFileItemList);
+  snapshot->SetFastLookup(true);
+  snapshot->Copy(items);
+
+  bool pinned = cacheType == DIR_CACHE_ALWAYS;
+  if (!pinned)
+  {
+    CSingleLock lock (m_cs);
+    pinned = IsCacheDir(storedPath);
+  }
+
+  CDir* dir = new CDir(cacheType, snapshot, pinned);
+  dir->m_path = storedPath;
+  if (!pinned)
+    dir->m_size = GetSize(*snapshot);
+
+  CShard &shard = GetShard(storedPath);
+  CSingleLock lock (shard.m_cs);
 
-  CheckIfFull();
+  iCache i = shard.m_dirs.find(storedPath);
+  if (i != shard.m_dirs.end())
+    Delete(shard, i);
 
-  CDir* dir = new CDir(cacheType);
-  dir->m_Items->Copy(items);
-  dir->SetLastAccess(m_accessCounter);
-  m_cache.insert(pair<CStdString, CDir*>(storedPath, dir));
+  shard.m_dirs.insert(pair<CStdString, CDir*>(storedPath, dir));
+  if (!pinned)
+  {
+    shard.Link(dir);
+    shard.m_size += dir->m_size;
+    CheckIfFull(shard, g_advancedSettings.m_directoryCacheSize / DIRECTORY_CACHE_SHARDS);
+  }
 }
 
 void CDirectoryCache::ClearFile(const CStdString& strFile)
@@ -128,76 +202,97 @@ void CDirectoryCache::ClearFile(const CStdString& strFile)
 
 void CDirectoryCache::ClearDirectory(const CStdString& strPath)
 {
-  CSingleLock lock (m_cs);
-
   CStdString storedPath = URIUtils::SubstitutePath(strPath);
   URIUtils::RemoveSlashAtEnd(storedPath);
 
-  iCache i = m_cache.find(storedPath);
-  if (i != m_cache.end())
-    Delete(i);
+  CShard &shard = GetShard(storedPath);
+  CSingleLock lock (shard.m_cs);
+
+  iCache i = shard.m_dirs.find(storedPath);
+  if (i != shard.m_dirs.end())
+    Delete(shard, i);
 }
 
 void CDirectoryCache::ClearSubPaths(const CStdString& strPath)
 {
-  CSingleLock lock (m_cs);
-
   CStdString storedPath = URIUtils::SubstitutePath(strPath);
   URIUtils::RemoveSlashAtEnd(storedPath);
 
-  iCache i = m_cache.begin();
-  while (i != m_cache.end())
+  for (unsigned int s = 0; s < DIRECTORY_CACHE_SHARDS; s++)
   {
-    CStdString path = i->first;
-    if (strncmp(path.c_str(), storedPath.c_str(), storedPath.GetLength()) == 0)
-      Delete(i++);
-    else
-      i++;
+    CShard &shard = m_shards[s];
+    CSingleLock lock (shard.m_cs);
+
+    iCache i = shard.m_dirs.begin();
+    while (i != shard.m_dirs.end())
+    {
+      if (strncmp(i->first.c_str(), storedPath.c_str(), storedPath.GetLength()) == 0)
+        Delete(shard, i++);
+      else
+        i++;
+    }
   }
 }
 
 void CDirectoryCache::AddFile(const CStdString& strFile)
 {
-  CSingleLock lock (m_cs);
-
   CStdString strPath;
   URIUtils::GetDirectory(strFile, strPath);
   URIUtils::RemoveSlashAtEnd(strPath);
 
-  ciCache i = m_cache.find(strPath);
-  if (i != m_cache.end())
+  CShard &shard = GetShard(strPath);
+  CSingleLock lock (shard.m_cs);
+
+  ciCache i = shard.m_dirs.find(strPath);
+  if (i != shard.m_dirs.end())
   {
+    // readers may still hold the current listing, so replace it.  Cached items
+    // are never altered, so the new listing can share them with the old one.
     CDir *dir = i->second;
+    CSnapshot items(new CFileItemList);
+    items->SetFastLookup(true);
+    items->Assign(*dir->m_Items);
     CFileItemPtr item(new CFileItem(strFile, false));
-    dir->m_Items->Add(item);
-    dir->SetLastAccess(m_accessCounter);
+    items->Add(item);
+    dir->m_Items = items;
+    if (!dir->m_pinned)
+    {
+      unsigned int size = GetSize(*items);
+      shard.m_size += size - dir->m_size;
+      dir->m_size = size;
+    }
+    shard.Touch(dir);
+
+    // the listing grew, it's the most recent one now so it stays
+    if (!dir->m_pinned)
+      CheckIfFull(shard, g_advancedSettings.m_directoryCacheSize / DIRECTORY_CACHE_SHARDS);
   }
 }
 
 bool CDirectoryCache::FileExists(const CStdString& strFile, bool& bInCache)
 {
-  CSingleLock lock (m_cs);
   bInCache = false;
 
   CStdString strPath;
   URIUtils::GetDirectory(strFile, strPath);
   URIUtils::RemoveSlashAtEnd(strPath);
 
-  ciCache i = m_cache.find(strPath);
-  if (i != m_cache.end())
+  CShard &shard = GetShard(strPath);
+  CSnapshot snapshot;
   {
-    bInCache = true;
-    CDir *dir = i->second;
-    dir->SetLastAccess(m_accessCounter);
-#ifdef _DEBUG
-    m_cacheHits++;
-#endif
-    return dir->m_Items->Contains(strFile);
+    CSingleLock lock (shard.m_cs);
+    ciCache i = shard.m_dirs.find(strPath);
+    if (i == shard.m_dirs.end())
+    {
+      shard.m_misses++;
+      return false;
+    }
+    snapshot = i->second->m_Items;
+    shard.Touch(i->second);
+    shard.m_hits++;
   }
-#ifdef _DEBUG
-  m_cacheMisses++;
-#endif
-  return false;
+  bInCache = true;
+  return snapshot->Contains(strFile);
 }
 
 void CDirectoryCache::Clear()
@@ -205,13 +300,19 @@ void CDirectoryCache::Clear()
   // this routine clears everything except things we always cache
   CSingleLock lock (m_cs);
 
-  iCache i = m_cache.begin();
-  while (i != m_cache.end() )
+  for (unsigned int s = 0; s < DIRECTORY_CACHE_SHARDS; s++)
   {
-    if (!IsCacheDir(i->first))
-      Delete(i++);
-    else
-      i++;
+    CShard &shard = m_shards[s];
+    CSingleLock shardLock (shard.m_cs);
+
+    iCache i = shard.m_dirs.begin();
+    while (i != shard.m_dirs.end())
+    {
+      if (!IsCacheDir(i->first))
+        Delete(shard, i++);
+      else
+        i++;
+    }
   }
 }
 
@@ -229,13 +330,13 @@ void CDirectoryCache::InitCache(set<CStdString>& dirs)
 
 void CDirectoryCache::ClearCache(set<CStdString>& dirs)
 {
-  iCache i = m_cache.begin();
-  while (i != m_cache.end())
+  for (set<CStdString>::iterator it = dirs.begin(); it != dirs.end(); ++it)
   {
-    if (dirs.find(i->first) != dirs.end())
-      Delete(i++);
-    else
-      i++;
+    CShard &shard = GetShard(*it);
+    CSingleLock lock (shard.m_cs);
+    iCache i = shard.m_dirs.find(*it);
+    if (i != shard.m_dirs.end())
+      Delete(shard, i);
   }
 }
 
@@ -331,54 +432,73 @@ void CDirectoryCache::ClearMusicThumbCache()
   ClearCache(m_musicThumbDirs);
 }
 
-void CDirectoryCache::CheckIfFull()
+void CDirectoryCache::CheckIfFull(CShard &shard, unsigned int budget)
 {
-  CSingleLock lock (m_cs);
-  static const unsigned int max_cached_dirs = 10;
-
-  // find the last accessed folder, and remove if the number of cached folders is too many
-  iCache lastAccessed = m_cache.end();
-  unsigned int numCached = 0;
-  for (iCache i = m_cache.begin(); i != m_cache.end(); i++)
+  // drop the least recently used listings until we're within budget, but always
+  // keep the most recent one, however large it is
+  while (shard.m_size > budget && shard.m_tail && shard.m_tail != shard.m_head)
   {
-    // ensure dirs that are always cached aren't cleared
-    if (!IsCacheDir(i->first) && i->second->m_cacheType != DIR_CACHE_ALWAYS)
-    {
-      if (lastAccessed == m_cache.end() || i->second->GetLastAccess() < lastAccessed->second->GetLastAccess())
-        lastAccessed = i;
-      numCached++;
-    }
+    iCache i = shard.m_dirs.find(shard.m_tail->m_path);
+    if (i == shard.m_dirs.end())
+      break;
+    Delete(shard, i);
+    shard.m_evictions++;
   }
-  if (lastAccessed != m_cache.end() && numCached >= max_cached_dirs)
-    Delete(lastAccessed);
 }
 
-void CDirectoryCache::Delete(iCache it)
+void CDirectoryCache::Delete(CShard &shard, iCache it)
 {
   CDir* dir = it->second;
+  if (!dir->m_pinned)
+  {
+    shard.Unlink(dir);
+    shard.m_size -= dir->m_size;
+  }
   delete dir;
-  m_cache.erase(it);
+  shard.m_dirs.erase(it);
 }
 
-#ifdef _DEBUG
-void CDirectoryCache::PrintStats() const
+unsigned int CDirectoryCache::GetSize(const CFileItemList &items)
 {
-  CSingleLock lock (m_cs);
-  CLog::Log(LOGDEBUG, "%s - total of %u cache hits, and %u cache misses", __FUNCTION__, m_cacheHits, m_cacheMisses);
-  // run through and find the oldest and the number of items cached
-  unsigned int oldest = UINT_MAX;
-  unsigned int numItems = 0;
-  unsigned int numDirs = 0;
-  for (ciCache i = m_cache.begin(); i != m_cache.end(); i++)
+  // an estimate: the items themselves, their strings and any tags they carry
+  unsigned int size = sizeof(CFileItemList);
+  for (int i = 0; i < items.Size(); i++)
   {
-    if (!IsCacheDir(i->first))
-    {
-      CDir *dir = i->second;
-      oldest = min(oldest, dir->GetLastAccess());
-      numItems += dir->m_Items->Size();
-      numDirs++;
-    }
+    const CFileItemPtr item = items[i];
+    size += sizeof(CFileItem) + item->GetPath().size() + item->GetLabel().size() + item->GetLabel2().size();
+    if (item->HasMusicInfoTag())
+      size += sizeof(MUSIC_INFO::CMusicInfoTag);
+    if (item->HasVideoInfoTag())
+      size += sizeof(CVideoInfoTag);
   }
-  CLog::Log(LOGDEBUG, "%s - %u folders cached, with %u items total.  Oldest is %u, current is %u", __FUNCTION__, numDirs, numItems, oldest, m_accessCounter);
+  return size;
+}
+
+void CDirectoryCache::GetStats(CacheStats &stats)
+{
+  memset(&stats, 0, sizeof(stats));
+  stats.budget = g_advancedSettings.m_directoryCacheSize;
+  for (unsigned int s = 0; s < DIRECTORY_CACHE_SHARDS; s++)
+  {
+    CShard &shard = m_shards[s];
+    CSingleLock lock (shard.m_cs);
+    stats.hits += shard.m_hits;
+    stats.misses += shard.m_misses;
+    stats.evictions += shard.m_evictions;
+    stats.size += shard.m_size;
+    stats.dirs += shard.m_dirs.size();
+    for (ciCache i = shard.m_dirs.begin(); i != shard.m_dirs.end(); ++i)
+      stats.items += i->second->m_Items->Size();
+  }
+}
+
+void CDirectoryCache::PrintStats()
+{
+  CacheStats stats;
+  GetStats(stats);
+  unsigned int lookups = stats.hits + stats.misses;
+  CLog::Log(LOGDEBUG, "%s - %u cache hits, %u cache misses (%.1f%% hit rate), %u evictions", __FUNCTION__,
+            stats.hits, stats.misses, lookups ? 100.0f * stats.hits / lookups : 0.0f, stats.evictions);
+  CLog::Log(LOGDEBUG, "%s - %u folders cached, with %u items total, using %u of %u KB", __FUNCTION__,
+            stats.dirs, stats.items, stats.size / 1024, stats.budget / 1024);
 }
-#endif
@@ -26,31 +26,76 @@
 
 #include <map>
 #include <set>
+#include <boost/shared_ptr.hpp>
 
 class CFileItem;
 
+#define DIRECTORY_CACHE_SHARDS 8
+
 namespace XFILE
 {
   class CDirectoryCache
   {
+    /* cached listings are never altered once they are in the cache, writers replace
+       them instead, so readers can keep using a listing after the lock is released */
+    typedef boost::shared_ptr<CFileItemList> CSnapshot;
+
     class CDir
     {
     public:
-      CDir(DIR_CACHE_TYPE cacheType);
-      virtual ~CDir();
-
-      void SetLastAccess(unsigned int &accessCounter);
-      unsigned int GetLastAccess() const { return m_lastAccess; };
+      CDir(DIR_CACHE_TYPE cacheType, const CSnapshot &items, bool pinned);
 
-      CFileItemList* m_Items;
+      CSnapshot m_Items;
       DIR_CACHE_TYPE m_cacheType;
-    private:
-      unsigned int m_lastAccess;
+      bool m_pinned;          // never evicted, not counted against the budget
+      unsigned int m_size;    // estimated bytes held by m_Items
+      CStdString m_path;
+      CDir *m_prev;           // more recently used, in the shard's LRU list
+      CDir *m_next;           // less recently used
+    };
+
+    /* the cache is split by path hash so unrelated directories don't contend for one lock */
+    class CShard
+    {
+    public:
+      CShard();
+
+      void Touch(CDir *dir);
+      void Link(CDir *dir);
+      void Unlink(CDir *dir);
+
+      CCriticalSection m_cs;
+      std::map<CStdString, CDir*> m_dirs;
+      CDir *m_head;           // most recently used, evicted from the tail
+      CDir *m_tail;
+      unsigned int m_size;
+      unsigned int m_hits;
+      unsigned int m_misses;
+      unsigned int m_evictions;
     };
+    typedef std::map<CStdString, CDir*>::iterator iCache;
+    typedef std::map<CStdString, CDir*>::const_iterator ciCache;
+
   public:
+    struct CacheStats
+    {
+      unsigned int hits;      // GetDirectory and FileExists lookups served from the cache
+      unsigned int misses;    // lookups of paths that were not cached
+      unsigned int evictions; // listings dropped to stay within the budget
+      unsigned int dirs;      // cached listings
+      unsigned int items;     // items in all cached listings
+      unsigned int size;      // estimated bytes held by evictable listings
+      unsigned int budget;    // byte budget of the whole cache
+    };
+
     CDirectoryCache(void);
     virtual ~CDirectoryCache(void);
-    bool GetDirectory(const CStdString& strPath, CFileItemList &items, bool retrieveAll = false);
+    /*! \brief Hands out the cached listing of a directory, which is shared with the cache and must not be altered
+     \param strPath the directory
+     \param items the listing, copy it (or the items of it) to change it
+     \param retrieveAll whether listings that are only cached once may be returned
+     */
+    bool GetDirectory(const CStdString& strPath, boost::shared_ptr<const CFileItemList> &items, bool retrieveAll = false);
     void SetDirectory(const CStdString& strPath, const CFileItemList &items, DIR_CACHE_TYPE cacheType);
     void ClearDirectory(const CStdString& strPath);
     void ClearFile(const CStdString& strFile);
@@ -62,32 +107,24 @@ namespace XFILE
     void ClearThumbCache();
     void InitMusicThumbCache();
     void ClearMusicThumbCache();
-#ifdef _DEBUG
-    void PrintStats() const;
-#endif
+    void GetStats(CacheStats &stats);
+    void PrintStats();
   protected:
     void InitCache(std::set<CStdString>& dirs);
     void ClearCache(std::set<CStdString>& dirs);
     bool IsCacheDir(const CStdString &strPath) const;
-    void CheckIfFull();
+    CShard &GetShard(const CStdString &strPath);
+    void CheckIfFull(CShard &shard, unsigned int budget);
+    void Delete(CShard &shard, iCache i);
+    static unsigned int GetSize(const CFileItemList &items);
 
-    std::map<CStdString, CDir*> m_cache;
-    typedef std::map<CStdString, CDir*>::iterator iCache;
-    typedef std::map<CStdString, CDir*>::const_iterator ciCache;
-    void Delete(iCache i);
+    CShard m_shards[DIRECTORY_CACHE_SHARDS];
 
-    CCriticalSection m_cs;
+    CCriticalSection m_cs;  // guards the thumb directories, taken before any shard
     std::set<CStdString> m_thumbDirs;
     std::set<CStdString> m_musicThumbDirs;
     int m_iThumbCacheRefCount;
     int m_iMusicThumbCacheRefCount;
-
-    unsigned int m_accessCounter;
-
-#ifdef _DEBUG
-    unsigned int m_cacheHits;
-    unsigned int m_cacheMisses;
-#endif
   };
 }
 extern XFILE::CDirectoryCache g_directoryCache;
@@ -27,6 +27,7 @@
 #include "URL.h"
 
 #include "CacheCircular.h"
+#include "CacheSparse.h"
 #include "threads/SingleLock.h"
 #include "utils/log.h"
 #include "utils/TimeUtils.h"
@@ -88,6 +89,9 @@ CFileCache::CFileCache() : CThread("CFileCache")
    m_writePos = 0;
    if (g_advancedSettings.m_cacheMemBufferSize == 0)
      m_pCache = new CSimpleFileCache();
+   else if (g_advancedSettings.m_cacheSparse)
+     m_pCache = new CCacheSparse(g_advancedSettings.m_cacheMemBufferSize
+                               + std::max<unsigned int>( g_advancedSettings.m_cacheMemBufferSize / 4, 1024 * 1024), false);
    else
      m_pCache = new CCacheCircular(g_advancedSettings.m_cacheMemBufferSize
                                  , std::max<unsigned int>( g_advancedSettings.m_cacheMemBufferSize / 4, 1024 * 1024));
@@ -225,6 +229,40 @@ void CFileCache::Process()
       m_seekEnded.Set();
     }
 
+    // a sparse cache may hold data after the read position already,
+    // so continue with the gap following it rather than fetch it twice
+    int64_t fillPos = m_pCache->CachedDataEndPos();
+    if (fillPos >= 0 && fillPos != m_writePos && m_seekPossible != 0)
+    {
+      int64_t length = m_source.GetLength();
+      if (length > 0 && fillPos >= length)
+      {
+        // cached up to the end of the file, nothing to do until the reader moves.
+        // the source isn't read again, so the cache learns where the input ends here
+        m_pCache->SetWritePosition(length);
+        m_pCache->EndOfInput();
+        m_cacheFull = true;
+        if (m_seekEvent.WaitMSec(100))
+          m_seekEvent.Set();
+        continue;
+      }
+
+      CLog::Log(LOGDEBUG,"%s, continue caching at %"PRId64" instead of %"PRId64, __FUNCTION__, fillPos, m_writePos);
+      if (m_source.Seek(fillPos, SEEK_SET) == fillPos)
+      {
+        m_pCache->SetWritePosition(fillPos);
+        average.Reset(fillPos);
+        limiter.Reset(fillPos);
+        m_writePos = fillPos;
+        m_cacheFull = false;
+      }
+      else
+      {
+        CLog::Log(LOGERROR,"%s, error %d seeking to %"PRId64, __FUNCTION__, (int)GetLastError(), fillPos);
+        m_seekPossible = m_source.IoControl(IOCTRL_SEEK_POSSIBLE, NULL);
+      }
+    }
+
     while (m_writeRate)
     {
       if (m_writePos - m_readPos < m_writeRate)
@@ -250,11 +288,26 @@ void CFileCache::Process()
       m_pCache->EndOfInput();
 
       // The thread event will now also cause the wait of an event to return a false.
-      if (AbortableWait(m_seekEvent) == WAIT_SIGNALED)
+      // A sparse cache may still have gaps to fill before the end, check for those regularly.
+      WaitResponse response;
+      if (m_pCache->CachedDataEndPos() < 0)
+        response = AbortableWait(m_seekEvent);
+      else
+      {
+        while ((response = AbortableWait(m_seekEvent, 100)) == WAIT_TIMEDOUT)
+        {
+          if (m_pCache->CachedDataEndPos() != m_writePos && m_seekPossible != 0)
+            break;
+        }
+      }
+
+      if (response == WAIT_SIGNALED)
       {
         m_pCache->ClearEndOfInput();
         m_seekEvent.Set(); // hack so that later we realize seek is needed
       }
+      else if (response == WAIT_TIMEDOUT)
+        m_pCache->ClearEndOfInput();
       else
         break;
     }
@@ -293,6 +346,14 @@ void CFileCache::Process()
         m_seekEvent.Set(); // make sure we get the seek event later.
         break;
       }
+
+      // same if the reader moved on to other data of a sparse cache
+      if (iWrite == 0)
+      {
+        int64_t fillPos = m_pCache->CachedDataEndPos();
+        if (fillPos >= 0 && fillPos != m_writePos + iTotalWrite && m_seekPossible != 0)
+          break;
+      }
     }
 
     m_writePos += iTotalWrite;
@@ -450,6 +511,7 @@ int CFileCache::IoControl(EIoControl request, void* param)
   if (request == IOCTRL_CACHE_STATUS)
   {
     SCacheStatus* status = (SCacheStatus*)param;
+    // with a sparse cache this covers all data that follows the read position, whichever range it is in
     status->forward = m_pCache->WaitForData(0, 0);
     status->maxrate = m_writeRate;
     status->currate = m_writeRateActual;
@@ -19,6 +19,7 @@
  *
  */
 
+#include "threads/SystemClock.h"
 #include "FileCurl.h"
 #include "utils/URIUtils.h"
 #include "Util.h"
@@ -30,6 +31,8 @@
 
 #include <vector>
 #include <climits>
+#include <algorithm>
+#include <ctype.h>
 
 #ifdef _LINUX
 #include <errno.h>
@@ -53,6 +56,11 @@ using namespace XCURL;
 
 #define dllselect select
 
+/* size of each of the ranges fetched in multi connection mode */
+#define RANGE_CHUNK_SIZE (1024*1024)
+/* time all connections need to be busy for before their number is adapted */
+#define RANGE_ADAPT_TIME 1000
+
 // curl calls this routine to debug
 extern "C" int debug_callback(CURL_HANDLE *handle, curl_infotype info, char *output, size_t size, void *data)
 {
@@ -88,6 +96,28 @@ extern "C" size_t write_callback(char *buffer,
   return state->WriteCallback(buffer, size, nitems);
 }
 
+extern "C" size_t range_write_callback(char *buffer,
+               size_t size,
+               size_t nitems,
+               void *userp)
+{
+  if(userp == NULL) return 0;
+
+  CFileCurl::CRangeRequest *range = (CFileCurl::CRangeRequest *)userp;
+  return range->WriteCallback(buffer, size, nitems);
+}
+
+extern "C" size_t range_header_callback(char *buffer,
+               size_t size,
+               size_t nitems,
+               void *userp)
+{
+  if(userp == NULL) return 0;
+
+  CFileCurl::CRangeRequest *range = (CFileCurl::CRangeRequest *)userp;
+  return range->HeaderCallback(buffer, size, nitems);
+}
+
 extern "C" size_t header_callback(void *ptr, size_t size, size_t nmemb, void *stream)
 {
   CFileCurl::CReadState *state = (CFileCurl::CReadState *)stream;
@@ -187,6 +217,116 @@ size_t CFileCurl::CReadState::WriteCallback(char *buffer, size_t size, size_t ni
   return size * nitems;
 }
 
+CFileCurl::CRangeRequest::CRangeRequest(CReadState* state)
+{
+  m_state = state;
+  m_easyHandle = NULL;
+  m_data = new char[RANGE_CHUNK_SIZE];
+  m_start = 0;
+  m_length = 0;
+  m_received = 0;
+  m_consumed = 0;
+  m_active = false;
+  m_checked = false;
+  m_contentStart = -1;
+  m_retries = 0;
+  m_range[0] = 0;
+}
+
+CFileCurl::CRangeRequest::~CRangeRequest()
+{
+  if(m_easyHandle)
+    g_curlInterface.easy_release(&m_easyHandle, NULL);
+  delete[] m_data;
+}
+
+size_t CFileCurl::CRangeRequest::HeaderCallback(char *buffer, size_t size, size_t nitems)
+{
+  size_t amount = size * nitems;
+
+  // every response starts over, be it after a redirect or an interim one
+  if (amount >= 5 && strncmp(buffer, "HTTP/", 5) == 0)
+    m_contentStart = -1;
+  else if (amount > 14 && strncasecmp(buffer, "Content-Range:", 14) == 0)
+  {
+    // the line isn't terminated, parse a copy of it
+    char value[64];
+    size_t len = std::min(amount - 14, sizeof(value) - 1);
+    memcpy(value, buffer + 14, len);
+    value[len] = 0;
+
+    char *pos = value + strspn(value, " \t");
+    if (strncasecmp(pos, "bytes", 5) == 0)
+    {
+      pos += 5;
+      pos += strspn(pos, " \t");
+      if (isdigit((unsigned char)*pos))
+        m_contentStart = strtoll(pos, NULL, 10);
+    }
+  }
+
+  return amount;
+}
+
+size_t CFileCurl::CRangeRequest::WriteCallback(char *buffer, size_t size, size_t nitems)
+{
+  unsigned int amount = size * nitems;
+
+  // a server ignoring the range would send the file from the start,
+  // one getting it wrong would send it from elsewhere
+  if (!m_checked)
+  {
+    long response = 0;
+    g_curlInterface.easy_getinfo(m_easyHandle, CURLINFO_RESPONSE_CODE, &response);
+    if (response != 206)
+    {
+      CLog::Log(LOGWARNING, "%s - got response %ld to range request %s", __FUNCTION__, response, m_range);
+      m_state->m_rangeUnsupported = true;
+      return 0;
+    }
+    if (m_contentStart != m_start + m_received)
+    {
+      CLog::Log(LOGWARNING, "%s - got data from %"PRId64" for range request %s", __FUNCTION__, m_contentStart, m_range);
+      m_state->m_rangeUnsupported = true;
+      return 0;
+    }
+    m_checked = true;
+  }
+
+  if (amount > m_length - m_received)
+  {
+    CLog::Log(LOGWARNING, "%s - got more data than asked for with range %s", __FUNCTION__, m_range);
+    m_state->m_rangeUnsupported = true;
+    return 0;
+  }
+
+  memcpy(m_data + m_received, buffer, amount);
+  m_received += amount;
+
+  if (m_state->m_rangesBusy)
+    m_state->m_busyBytes += amount;
+
+  return amount;
+}
+
+/* (re)start transfer of what hasn't been received of the range yet */
+void CFileCurl::CRangeRequest::Start(CURLM* multiHandle)
+{
+  sprintf(m_range, "%"PRId64"-%"PRId64, m_start + m_received, m_start + m_length - 1);
+
+  g_curlInterface.easy_setopt(m_easyHandle, CURLOPT_RESUME_FROM_LARGE, (int64_t)0);
+  g_curlInterface.easy_setopt(m_easyHandle, CURLOPT_RANGE, m_range);
+  g_curlInterface.easy_setopt(m_easyHandle, CURLOPT_WRITEDATA, this);
+  g_curlInterface.easy_setopt(m_easyHandle, CURLOPT_WRITEFUNCTION, range_write_callback);
+  g_curlInterface.easy_setopt(m_easyHandle, CURLOPT_WRITEHEADER, this);
+  g_curlInterface.easy_setopt(m_easyHandle, CURLOPT_HEADERFUNCTION, range_header_callback);
+
+  m_checked = false;
+  m_contentStart = -1;
+  m_active = true;
+  g_curlInterface.multi_add_handle(multiHandle, m_easyHandle);
+}
+
 CFileCurl::CReadState::CReadState()
 {
   m_easyHandle = NULL;
@@ -199,6 +339,17 @@ CFileCurl::CReadState::CReadState()
   m_cancelled = false;
   m_bFirstLoop = true;
   m_headerdone = false;
+  m_ranged = false;
+  m_rangeUnsupported = false;
+  m_rangePos = 0;
+  m_connections = 0;
+  m_maxConnections = 0;
+  m_rangesBusy = false;
+  m_busyStamp = 0;
+  m_busyTime = 0;
+  m_busyBytes = 0;
+  m_lastRate = 0;
+  m_direction = 1;
 }
 
 CFileCurl::CReadState::~CReadState()
@@ -285,6 +436,8 @@ long CFileCurl::CReadState::Connect(unsigned int size)
 
 void CFileCurl::CReadState::Disconnect()
 {
+  StopRanges();
+
   if(m_multiHandle && m_easyHandle)
     g_curlInterface.multi_remove_handle(m_multiHandle, m_easyHandle);
 
@@ -892,9 +1045,32 @@ bool CFileCurl::Open(const CURL& url)
   if (CURLE_OK == g_curlInterface.easy_getinfo(m_state->m_easyHandle, CURLINFO_EFFECTIVE_URL,&efurl) && efurl)
     m_url = efurl;
 
+  if (CanFetchRanges())
+  {
+    CLog::Log(LOGDEBUG, "FileCurl - fetching <%s> over up to %d connections", m_url.c_str(), g_advancedSettings.m_curlconnections);
+    m_state->StartRanges(g_advancedSettings.m_curlconnections);
+  }
+
   return true;
 }
 
+/* whether to fetch the file over several connections at once, this
+ * only pays off on large files where a single connection can't keep up */
+bool CFileCurl::CanFetchRanges()
+{
+  if (g_advancedSettings.m_curlconnections < 2)
+    return false;
+
+  // m_multisession is only set for http servers we can open more connections to
+  if (!m_seekable || !m_multisession)
+    return false;
+
+  if (!m_contentencoding.IsEmpty() || !m_postdata.IsEmpty() || !m_customrequest.IsEmpty())
+    return false;
+
+  return m_state->m_fileSize > 2 * RANGE_CHUNK_SIZE;
+}
+
 bool CFileCurl::CReadState::ReadString(char *szLine, int iLineLength)
 {
   unsigned int want = (unsigned int)iLineLength;
@@ -994,6 +1170,12 @@ int64_t CFileCurl::Seek(int64_t iFilePosition, int iWhence)
   if(!m_seekable)
     return -1;
 
+  if(m_state->m_ranged)
+  {
+    m_state->SeekRanges(nextPos);
+    return nextPos;
+  }
+
   CReadState* oldstate = NULL;
   if(m_multisession)
   {
@@ -1186,9 +1368,9 @@ unsigned int CFileCurl::CReadState::Read(void* lpBuf, int64_t uiBufSize)
 bool CFileCurl::CReadState::FillBuffer(unsigned int want)
 {
   int retry=0;
-  fd_set fdread;
-  fd_set fdwrite;
-  fd_set fdexcep;
+
+  if (m_ranged)
+    return FillRanges(want);
 
   // only attempt to fill buffer if transactions still running and buffer
   // doesnt exceed required size already
@@ -1290,28 +1472,8 @@ bool CFileCurl::CReadState::FillBuffer(unsigned int want)
     {
       case CURLM_OK:
       {
-        int maxfd = -1;
-        FD_ZERO(&fdread);
-        FD_ZERO(&fdwrite);
-        FD_ZERO(&fdexcep);
-
-        // get file descriptors from the transfers
-        g_curlInterface.multi_fdset(m_multiHandle, &fdread, &fdwrite, &fdexcep, &maxfd);
-
-        long timeout = 0;
-        if (CURLM_OK != g_curlInterface.multi_timeout(m_multiHandle, &timeout) || timeout == -1)
-          timeout = 200;
-
-        struct timeval t = { timeout / 1000, (timeout % 1000) * 1000 };
-
-        /* Wait until data is available or a timeout occurs.
-           We call dllselect(maxfd + 1, ...), specially in case of (maxfd == -1),
-           we call dllselect(0, ...), which is basically equal to sleep. */
-        if (SOCKET_ERROR == dllselect(maxfd + 1, &fdread, &fdwrite, &fdexcep, &t))
-        {
-          CLog::Log(LOGERROR, "%s - curl failed with socket error", __FUNCTION__);
+        if (!WaitForSockets())
           return false;
-        }
       }
       break;
       case CURLM_CALL_MULTI_PERFORM:
@@ -1333,6 +1495,325 @@ bool CFileCurl::CReadState::FillBuffer(unsigned int want)
   return true;
 }
 
+/* wait for the transfers on our multi handle to be ready for more */
+bool CFileCurl::CReadState::WaitForSockets()
+{
+  fd_set fdread;
+  fd_set fdwrite;
+  fd_set fdexcep;
+  int maxfd = -1;
+  FD_ZERO(&fdread);
+  FD_ZERO(&fdwrite);
+  FD_ZERO(&fdexcep);
+
+  // get file descriptors from the transfers
+  g_curlInterface.multi_fdset(m_multiHandle, &fdread, &fdwrite, &fdexcep, &maxfd);
+
+  long timeout = 0;
+  if (CURLM_OK != g_curlInterface.multi_timeout(m_multiHandle, &timeout) || timeout == -1)
+    timeout = 200;
+
+  struct timeval t = { timeout / 1000, (timeout % 1000) * 1000 };
+
+  /* Wait until data is available or a timeout occurs.
+     We call dllselect(maxfd + 1, ...), specially in case of (maxfd == -1),
+     we call dllselect(0, ...), which is basically equal to sleep. */
+  if (SOCKET_ERROR == dllselect(maxfd + 1, &fdread, &fdwrite, &fdexcep, &t))
+  {
+    CLog::Log(LOGERROR, "%s - curl failed with socket error", __FUNCTION__);
+    return false;
+  }
+  return true;
+}
+
+/* switch over to fetching consecutive ranges of the file over several
+ * connections at once, the connection opened so far is dropped but the
+ * data it delivered already is kept */
+void CFileCurl::CReadState::StartRanges(unsigned int connections)
+{
+  if (m_multiHandle && m_easyHandle)
+    g_curlInterface.multi_remove_handle(m_multiHandle, m_easyHandle);
+
+  m_ranged = true;
+  m_rangeUnsupported = false;
+  m_rangePos = m_filePos + m_buffer.getMaxReadSize() + m_overflowSize;
+  m_maxConnections = connections;
+  m_connections = std::min(2u, connections);
+
+  m_rangesBusy = false;
+  m_busyStamp = XbmcThreads::SystemClockMillis();
+  m_busyTime = 0;
+  m_busyBytes = 0;
+  m_lastRate = 0;
+  m_direction = 1;
+}
+
+void CFileCurl::CReadState::StopRanges()
+{
+  while (!m_ranges.empty())
+  {
+    RecycleRange(m_ranges.front());
+    m_ranges.pop_front();
+  }
+
+  for (std::vector<CRangeRequest*>::iterator it = m_idleRanges.begin(); it != m_idleRanges.end(); it++)
+    delete *it;
+  m_idleRanges.clear();
+
+  m_ranged = false;
+}
+
+void CFileCurl::CReadState::RecycleRange(CRangeRequest* range)
+{
+  if (range->m_active)
+  {
+    g_curlInterface.multi_remove_handle(m_multiHandle, range->m_easyHandle);
+    range->m_active = false;
+  }
+  m_idleRanges.push_back(range);
+}
+
+/* keep the ranges from the one holding the new position on, if any */
+void CFileCurl::CReadState::SeekRanges(int64_t pos)
+{
+  m_buffer.Clear();
+  free(m_overflowBuffer);
+  m_overflowBuffer = NULL;
+  m_overflowSize = 0;
+
+  while (!m_ranges.empty() && m_ranges.front()->m_start + m_ranges.front()->m_length <= pos)
+  {
+    RecycleRange(m_ranges.front());
+    m_ranges.pop_front();
+  }
+
+  if (!m_ranges.empty() && m_ranges.front()->m_start <= pos)
+    m_ranges.front()->m_consumed = (unsigned int)(pos - m_ranges.front()->m_start);
+  else
+  {
+    while (!m_ranges.empty())
+    {
+      RecycleRange(m_ranges.front());
+      m_ranges.pop_front();
+    }
+    m_rangePos = pos;
+  }
+
+  m_filePos = pos;
+}
+
+/* start as many ranges as we are allowed connections, the ranges waiting
+ * to be read count towards that too so memory use stays bounded */
+void CFileCurl::CReadState::QueueRanges()
+{
+  while (m_ranges.size() < m_connections && m_rangePos < m_fileSize)
+  {
+    CRangeRequest* range;
+    if (!m_idleRanges.empty())
+    {
+      range = m_idleRanges.back();
+      m_idleRanges.pop_back();
+    }
+    else
+    {
+      // the duplicate gets a session of its own, without the multi handle
+      range = new CRangeRequest(this);
+      g_curlInterface.easy_duplicate(m_easyHandle, NULL, &range->m_easyHandle, NULL);
+      if (!range->m_easyHandle)
+      {
+        CLog::Log(LOGERROR, "%s - failed to duplicate curl handle", __FUNCTION__);
+        delete range;
+        break;
+      }
+    }
+
+    range->m_start    = m_rangePos;
+    range->m_length   = (unsigned int)std::min<int64_t>(RANGE_CHUNK_SIZE, m_fileSize - m_rangePos);
+    range->m_received = 0;
+    range->m_consumed = 0;
+    range->m_retries  = 0;
+    range->Start(m_multiHandle);
+
+    m_ranges.push_back(range);
+    m_rangePos += range->m_length;
+  }
+}
+
+/* move what arrived in order on to the read buffer */
+bool CFileCurl::CReadState::MoveRanges()
+{
+  bool moved = false;
+  while (!m_ranges.empty())
+  {
+    CRangeRequest* range = m_ranges.front();
+    if (range->m_received > range->m_consumed)
+    {
+      unsigned int amount = XMIN((unsigned int)m_buffer.getMaxWriteSize(), range->m_received - range->m_consumed);
+      if (amount == 0)
+        break;
+
+      m_buffer.WriteData(range->m_data + range->m_consumed, amount);
+      range->m_consumed += amount;
+      moved = true;
+    }
+
+    if (range->m_consumed < range->m_length)
+      break;
+
+    RecycleRange(range);
+    m_ranges.pop_front();
+  }
+  return moved;
+}
+
+/* simple hill climbing, keep changing the number of connections in the
+ * same direction as long as throughput improves, turn back when it drops */
+void CFileCurl::CReadState::AdaptConnections()
+{
+  unsigned int rate = (unsigned int)(m_busyBytes * 1000 / m_busyTime);
+  unsigned int connections = m_connections;
+
+  bool step = false;
+  if (m_lastRate == 0 || rate > m_lastRate + m_lastRate / 10)
+    step = true;
+  else if (rate < m_lastRate - m_lastRate / 10)
+  {
+    m_direction = -m_direction;
+    step = true;
+  }
+
+  if (step && m_direction > 0 && m_connections < m_maxConnections)
+    m_connections++;
+  else if (step && m_direction < 0 && m_connections > 1)
+    m_connections--;
+
+  CLog::Log(LOGDEBUG, "%s - %u bytes/s over %u connections, now using %u", __FUNCTION__, rate, connections, m_connections);
+
+  m_lastRate = rate;
+  m_busyTime = 0;
+  m_busyBytes = 0;
+}
+
+bool CFileCurl::CReadState::FillRanges(unsigned int want)
+{
+  while ((unsigned int)m_buffer.getMaxReadSize() < want && m_buffer.getMaxWriteSize() > 0)
+  {
+    if (m_cancelled)
+      return false;
+
+    /* data from before the switch to ranges comes first */
+    if (m_overflowSize)
+    {
+      unsigned amount = XMIN((unsigned int)m_buffer.getMaxWriteSize(), m_overflowSize);
+      m_buffer.WriteData(m_overflowBuffer, amount);
+
+      if (amount < m_overflowSize)
+        memmove(m_overflowBuffer, m_overflowBuffer+amount, m_overflowSize-amount);
+
+      m_overflowSize -= amount;
+      m_overflowBuffer = (char*)realloc_simple(m_overflowBuffer, m_overflowSize);
+      continue;
+    }
+
+    if (MoveRanges())
+      continue;
+
+    QueueRanges();
+    m_stillRunning = m_ranges.empty() ? 0 : 1;
+    if (!m_stillRunning)
+      return m_buffer.getMaxReadSize() > 0;
+
+    // only count the time all connections are transferring, when fewer
+    // are, it is the reader and not the network that holds us up
+    unsigned int now = XbmcThreads::SystemClockMillis();
+    if (m_rangesBusy)
+      m_busyTime += now - m_busyStamp;
+    m_busyStamp = now;
+
+    unsigned int active = 0;
+    for (std::deque<CRangeRequest*>::iterator it = m_ranges.begin(); it != m_ranges.end(); it++)
+    {
+      if ((*it)->m_active)
+        active++;
+    }
+    m_rangesBusy = active >= m_connections;
+
+    if (m_busyTime >= RANGE_ADAPT_TIME)
+      AdaptConnections();
+
+    int running;
+    CURLMcode result = g_curlInterface.multi_perform(m_multiHandle, &running);
+    if (result == CURLM_CALL_MULTI_PERFORM)
+      continue;
+
+    if (result != CURLM_OK)
+    {
+      CLog::Log(LOGERROR, "%s - curl multi perform failed with code %d, aborting", __FUNCTION__, result);
+      return false;
+    }
+
+    int msgs;
+    CURLMsg* msg;
+    while ((msg = g_curlInterface.multi_info_read(m_multiHandle, &msgs)))
+    {
+      if (msg->msg != CURLMSG_DONE)
+        continue;
+
+      CRangeRequest* range = NULL;
+      for (std::deque<CRangeRequest*>::iterator it = m_ranges.begin(); it != m_ranges.end(); it++)
+      {
+        if ((*it)->m_easyHandle == msg->easy_handle)
+          range = *it;
+      }
+      if (!range)
+        continue;
+
+      CURLcode code = msg->data.result;
+      g_curlInterface.multi_remove_handle(m_multiHandle, range->m_easyHandle);
+      range->m_active = false;
+
+      if (code == CURLE_OK && range->m_received == range->m_length)
+        continue;
+
+      if (m_rangeUnsupported)
+        break;
+
+      CLog::Log(LOGWARNING, "%s: curl failed with code %i on range %s", __FUNCTION__, code, range->m_range);
+      if (++range->m_retries > g_advancedSettings.m_curlretries)
+      {
+        CLog::Log(LOGWARNING, "%s: Reconnect failed!", __FUNCTION__);
+        return false;
+      }
+
+      CLog::Log(LOGDEBUG, "%s: Reconnect, (re)try %i", __FUNCTION__, range->m_retries);
+      range->Start(m_multiHandle);
+    }
+
+    if (m_rangeUnsupported)
+    {
+      // go on over a single connection from where the ranges got to
+      int64_t pos = m_rangePos;
+      if (!m_ranges.empty())
+        pos = m_ranges.front()->m_start + m_ranges.front()->m_consumed;
+
+      CLog::Log(LOGWARNING, "%s - server doesn't support range requests, continuing at %"PRId64" over a single connection", __FUNCTION__, pos);
+      StopRanges();
+
+      g_curlInterface.easy_setopt(m_easyHandle, CURLOPT_RESUME_FROM_LARGE, pos);
+      g_curlInterface.multi_add_handle(m_multiHandle, m_easyHandle);
+      m_stillRunning = 1;
+      return FillBuffer(want);
+    }
+
+    if (MoveRanges())
+      continue;
+
+    if (!WaitForSockets())
+      return false;
+  }
+  return true;
+}
+
 void CFileCurl::ClearRequestHeaders()
 {
   m_requestheaders.clear();
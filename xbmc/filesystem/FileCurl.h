@@ -23,6 +23,8 @@
 #include "IFile.h"
 #include "utils/RingBuffer.h"
 #include <map>
+#include <deque>
+#include <vector>
 #include "utils/HttpHeader.h"
 
 namespace XCURL
@@ -84,6 +86,8 @@ namespace XFILE
       static bool GetHttpHeader(const CURL &url, CHttpHeader &headers);
       static bool GetMimeType(const CURL &url, CStdString &content, CStdString useragent="");
 
+      class CRangeRequest;
+
       class CReadState
       {
       public:
@@ -107,6 +111,23 @@ namespace XFILE
           CHttpHeader m_httpheader;
           bool        m_headerdone;
 
+          /* multi connection mode, consecutive ranges of the file are fetched at once */
+          std::deque<CRangeRequest*>  m_ranges;       // ranges in file order, the first one is read from next
+          std::vector<CRangeRequest*> m_idleRanges;   // requests not in use, kept for their handles
+          bool            m_ranged;
+          bool            m_rangeUnsupported;         // server didn't answer with the range asked for
+          int64_t         m_rangePos;                 // file position the next range starts at
+          unsigned int    m_connections;              // number of ranges fetched at once
+          unsigned int    m_maxConnections;
+
+          /* throughput while all connections are busy, to adapt m_connections */
+          bool            m_rangesBusy;
+          unsigned int    m_busyStamp;
+          unsigned int    m_busyTime;
+          int64_t         m_busyBytes;
+          unsigned int    m_lastRate;
+          int             m_direction;
+
           size_t WriteCallback(char *buffer, size_t size, size_t nitems);
           size_t HeaderCallback(void *ptr, size_t size, size_t nmemb);
 
@@ -117,6 +138,40 @@ namespace XFILE
 
           long         Connect(unsigned int size);
           void         Disconnect();
+
+          void         StartRanges(unsigned int connections);
+          void         StopRanges();
+          void         SeekRanges(int64_t pos);
+          bool         FillRanges(unsigned int want);
+          void         QueueRanges();
+          bool         MoveRanges();
+          void         RecycleRange(CRangeRequest* range);
+          void         AdaptConnections();
+          bool         WaitForSockets();
+      };
+
+      class CRangeRequest
+      {
+      public:
+          CRangeRequest(CReadState* state);
+          ~CRangeRequest();
+          CReadState*            m_state;
+          XCURL::CURL_HANDLE*    m_easyHandle;
+
+          char *          m_data;             // the range, as far as it has been received
+          int64_t         m_start;            // file position of the range
+          unsigned int    m_length;
+          unsigned int    m_received;
+          unsigned int    m_consumed;         // amount moved on to the read buffer
+          bool            m_active;           // transfer is added to the multi handle
+          bool            m_checked;          // response code of the transfer was checked
+          int64_t         m_contentStart;     // file position the server says the data starts at, -1 if it didn't
+          int             m_retries;
+          char            m_range[64];
+
+          size_t HeaderCallback(char *buffer, size_t size, size_t nitems);
+          size_t WriteCallback(char *buffer, size_t size, size_t nitems);
+          void   Start(XCURL::CURLM* multiHandle);
       };
 
     protected:
@@ -124,6 +179,7 @@ namespace XFILE
       void SetCommonOptions(CReadState* state);
       void SetRequestHeaders(CReadState* state);
       void SetCorrectHeaders(CReadState* state);
+      bool CanFetchRanges();
       bool Service(const CStdString& strURL, const CStdString& strPostData, CStdString& strHTML);
 
     private:
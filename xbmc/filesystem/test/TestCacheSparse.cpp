@@ -0,0 +1,322 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "filesystem/CacheSparse.h"
+
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+using namespace XFILE;
+
+#define TEST_BLOCK_SIZE (256 * 1024)
+#define TEST_CACHE_SIZE (256 * 1024 * 1024)
+
+/*
+ * Opens up the range index of the cache, which the reader and
+ * the writer both go by.
+ */
+class CTestCacheSparse : public CCacheSparse
+{
+public:
+  CTestCacheSparse(size_t size) : CCacheSparse(size, false) {}
+
+  using CCacheSparse::RangeEnd;
+  using CCacheSparse::AddRange;
+  using CCacheSparse::RemoveRange;
+  using CCacheSparse::m_ranges;
+};
+
+static char Pattern(uint64_t pos)
+{
+  return (char)((pos / TEST_BLOCK_SIZE) * 7 + pos);
+}
+
+/*
+ * Writes [beg, end) at the write position, a block at most at a time.
+ * Returns false as soon as the cache won't take any more.
+ */
+static bool Fill(CCacheSparse &cache, uint64_t beg, uint64_t end)
+{
+  std::vector<char> buffer(TEST_BLOCK_SIZE);
+  cache.SetWritePosition(beg);
+  while (beg < end)
+  {
+    size_t len = (size_t)std::min<uint64_t>(end - beg, buffer.size());
+    for (size_t i = 0; i < len; i++)
+      buffer[i] = Pattern(beg + i);
+
+    int written = cache.WriteToCache(&buffer[0], len);
+    if (written <= 0)
+      return false;
+    beg += written;
+  }
+  return true;
+}
+
+static bool Check(CCacheSparse &cache, uint64_t pos, size_t len)
+{
+  if (cache.Seek(pos) != (int64_t)pos)
+    return false;
+
+  std::vector<char> buffer(len);
+  size_t done = 0;
+  while (done < len)
+  {
+    int read = cache.ReadFromCache(&buffer[done], len - done);
+    if (read <= 0)
+      return false;
+    done += read;
+  }
+
+  for (size_t i = 0; i < len; i++)
+  {
+    if (buffer[i] != Pattern(pos + i))
+      return false;
+  }
+  return true;
+}
+
+BOOST_AUTO_TEST_CASE(TestCacheSparseAddRange)
+{
+  CTestCacheSparse cache(TEST_BLOCK_SIZE);
+
+  cache.AddRange(100, 200);
+  cache.AddRange(300, 400);
+  BOOST_CHECK_EQUAL(cache.m_ranges.size(), 2U);
+  BOOST_CHECK_EQUAL(cache.RangeEnd(100), 200U);
+  BOOST_CHECK_EQUAL(cache.RangeEnd(150), 200U);
+  BOOST_CHECK_EQUAL(cache.RangeEnd(200), 200U);
+  BOOST_CHECK_EQUAL(cache.RangeEnd(250), 250U);
+  BOOST_CHECK_EQUAL(cache.RangeEnd(50), 50U);
+
+  // adjacent to the end of a range
+  cache.AddRange(200, 250);
+  BOOST_CHECK_EQUAL(cache.m_ranges.size(), 2U);
+  BOOST_CHECK_EQUAL(cache.RangeEnd(100), 250U);
+
+  // adjacent to the start of a range
+  cache.AddRange(280, 300);
+  BOOST_CHECK_EQUAL(cache.m_ranges.size(), 2U);
+  BOOST_CHECK_EQUAL(cache.RangeEnd(280), 400U);
+
+  // overlapping both ranges joins them
+  cache.AddRange(240, 290);
+  BOOST_CHECK_EQUAL(cache.m_ranges.size(), 1U);
+  BOOST_CHECK_EQUAL(cache.RangeEnd(100), 400U);
+
+  // within a range changes nothing
+  cache.AddRange(120, 130);
+  BOOST_CHECK_EQUAL(cache.m_ranges.size(), 1U);
+  BOOST_CHECK_EQUAL(cache.m_ranges.begin()->first, 100U);
+  BOOST_CHECK_EQUAL(cache.m_ranges.begin()->second, 400U);
+
+  // swallowing several ranges
+  cache.AddRange(500, 600);
+  cache.AddRange(700, 800);
+  cache.AddRange(900, 1000);
+  BOOST_CHECK_EQUAL(cache.m_ranges.size(), 4U);
+  cache.AddRange(450, 950);
+  BOOST_CHECK_EQUAL(cache.m_ranges.size(), 2U);
+  BOOST_CHECK_EQUAL(cache.RangeEnd(450), 1000U);
+  BOOST_CHECK_EQUAL(cache.RangeEnd(400), 400U);
+
+  // and from before the first one
+  cache.AddRange(0, 2000);
+  BOOST_CHECK_EQUAL(cache.m_ranges.size(), 1U);
+  BOOST_CHECK_EQUAL(cache.RangeEnd(0), 2000U);
+}
+
+BOOST_AUTO_TEST_CASE(TestCacheSparseRemoveRange)
+{
+  CTestCacheSparse cache(TEST_BLOCK_SIZE);
+  cache.AddRange(100, 1000);
+
+  // from the middle splits the range
+  cache.RemoveRange(400, 500);
+  BOOST_CHECK_EQUAL(cache.m_ranges.size(), 2U);
+  BOOST_CHECK_EQUAL(cache.RangeEnd(100), 400U);
+  BOOST_CHECK_EQUAL(cache.RangeEnd(450), 450U);
+  BOOST_CHECK_EQUAL(cache.RangeEnd(500), 1000U);
+
+  // from the start
+  cache.RemoveRange(100, 200);
+  BOOST_CHECK_EQUAL(cache.m_ranges.size(), 2U);
+  BOOST_CHECK_EQUAL(cache.RangeEnd(150), 150U);
+  BOOST_CHECK_EQUAL(cache.RangeEnd(200), 400U);
+
+  // from the end
+  cache.RemoveRange(900, 1000);
+  BOOST_CHECK_EQUAL(cache.m_ranges.size(), 2U);
+  BOOST_CHECK_EQUAL(cache.RangeEnd(500), 900U);
+
+  // all of it
+  cache.RemoveRange(200, 400);
+  BOOST_CHECK_EQUAL(cache.m_ranges.size(), 1U);
+  BOOST_CHECK_EQUAL(cache.RangeEnd(200), 200U);
+
+  // nothing, or what isn't cached
+  cache.RemoveRange(600, 600);
+  cache.RemoveRange(0, 100);
+  cache.RemoveRange(950, 1050);
+  BOOST_CHECK_EQUAL(cache.m_ranges.size(), 1U);
+  BOOST_CHECK_EQUAL(cache.RangeEnd(500), 900U);
+
+  // a removed block can be put back
+  cache.RemoveRange(600, 700);
+  cache.AddRange(600, 700);
+  BOOST_CHECK_EQUAL(cache.m_ranges.size(), 1U);
+  BOOST_CHECK_EQUAL(cache.RangeEnd(500), 900U);
+}
+
+/*
+ * A large budget, as a cache in a temporary file would have. Kept
+ * in memory here, the blocks are recycled the same way either way.
+ */
+BOOST_AUTO_TEST_CASE(TestCacheSparseEviction)
+{
+  const uint64_t blocks = TEST_CACHE_SIZE / TEST_BLOCK_SIZE;
+
+  CTestCacheSparse cache(TEST_CACHE_SIZE);
+  BOOST_REQUIRE_EQUAL(cache.Open(), CACHE_RC_OK);
+
+  // the budget takes exactly that many blocks ahead of the reader
+  BOOST_REQUIRE(Fill(cache, 0, blocks * TEST_BLOCK_SIZE));
+  BOOST_CHECK_EQUAL(cache.CachedDataEndPos(), (int64_t)(blocks * TEST_BLOCK_SIZE));
+  BOOST_CHECK(!Fill(cache, blocks * TEST_BLOCK_SIZE, (blocks + 1) * TEST_BLOCK_SIZE));
+  BOOST_CHECK_EQUAL(cache.m_ranges.size(), 1U);
+
+  // once the reader moves on, the block farthest behind it goes first
+  uint64_t reader = blocks / 2;
+  BOOST_REQUIRE(Check(cache, reader * TEST_BLOCK_SIZE, 1000));
+  BOOST_CHECK(Fill(cache, blocks * TEST_BLOCK_SIZE, (blocks + 1) * TEST_BLOCK_SIZE));
+  BOOST_CHECK_EQUAL(cache.Seek(0), CACHE_RC_ERROR);
+  BOOST_CHECK(Check(cache, TEST_BLOCK_SIZE, 1000));
+  BOOST_CHECK_EQUAL(cache.CachedDataEndPos(), (int64_t)((blocks + 1) * TEST_BLOCK_SIZE));
+
+  // reading on from where it was, writing stops when what is left
+  // behind the reader is closer than what would be written next
+  BOOST_REQUIRE(Check(cache, reader * TEST_BLOCK_SIZE, 1000));
+  uint64_t end = blocks + 1;
+  while (Fill(cache, end * TEST_BLOCK_SIZE, (end + 1) * TEST_BLOCK_SIZE))
+    end++;
+
+  BOOST_CHECK_EQUAL(cache.m_ranges.size(), 1U);
+  uint64_t first = cache.m_ranges.begin()->first / TEST_BLOCK_SIZE;
+  BOOST_CHECK_EQUAL(cache.m_ranges.begin()->second, end * TEST_BLOCK_SIZE);
+  BOOST_CHECK_EQUAL(end - first, blocks);
+
+  // which leaves about a quarter of the budget for the back buffer
+  BOOST_CHECK(reader - first >= blocks / 4 - 1);
+  BOOST_CHECK(reader - first <= blocks / 4 + 1);
+  BOOST_CHECK_EQUAL(cache.Seek((first - 1) * TEST_BLOCK_SIZE), CACHE_RC_ERROR);
+  BOOST_CHECK(Check(cache, first * TEST_BLOCK_SIZE, TEST_BLOCK_SIZE));
+  BOOST_CHECK(Check(cache, (end - 1) * TEST_BLOCK_SIZE, TEST_BLOCK_SIZE));
+
+  // a seek far ahead keeps what is around the new position
+  BOOST_REQUIRE(Check(cache, (end - 1) * TEST_BLOCK_SIZE, 1000));
+  BOOST_CHECK(Fill(cache, (end + 100) * TEST_BLOCK_SIZE, (end + 101) * TEST_BLOCK_SIZE));
+  BOOST_CHECK_EQUAL(cache.m_ranges.size(), 2U);
+  BOOST_CHECK_EQUAL(cache.Seek(first * TEST_BLOCK_SIZE), CACHE_RC_ERROR);
+  BOOST_CHECK(Check(cache, (end + 100) * TEST_BLOCK_SIZE, TEST_BLOCK_SIZE));
+  BOOST_CHECK(Check(cache, (end - 1) * TEST_BLOCK_SIZE, TEST_BLOCK_SIZE));
+
+  cache.Close();
+}
+
+BOOST_AUTO_TEST_CASE(TestCacheSparseSeek)
+{
+  CTestCacheSparse cache(16 * TEST_BLOCK_SIZE);
+  BOOST_REQUIRE_EQUAL(cache.Open(), CACHE_RC_OK);
+
+  BOOST_REQUIRE(Fill(cache, 0, 100000));
+  BOOST_REQUIRE(Fill(cache, 3 * TEST_BLOCK_SIZE, 3 * TEST_BLOCK_SIZE + 100000));
+
+  // anywhere in either run, and to where the input ended
+  BOOST_CHECK(Check(cache, 0, 1000));
+  BOOST_CHECK(Check(cache, 99000, 1000));
+  BOOST_CHECK(Check(cache, 3 * TEST_BLOCK_SIZE + 50000, 1000));
+  cache.EndOfInput(); // or the seek waits for the writer to get there
+  BOOST_CHECK_EQUAL(cache.Seek(3 * TEST_BLOCK_SIZE + 100000), (int64_t)(3 * TEST_BLOCK_SIZE + 100000));
+
+  // not into the gap after the first run, nor past the end
+  BOOST_CHECK_EQUAL(cache.Seek(100000), CACHE_RC_ERROR);
+  BOOST_CHECK_EQUAL(cache.Seek(TEST_BLOCK_SIZE), CACHE_RC_ERROR);
+  BOOST_CHECK_EQUAL(cache.Seek(8 * TEST_BLOCK_SIZE), CACHE_RC_ERROR);
+
+  // the reader stays where it was after a failed seek
+  char c;
+  BOOST_CHECK(cache.IsEndOfInput());
+  BOOST_CHECK_EQUAL(cache.ReadFromCache(&c, 1), 0);
+  BOOST_CHECK(Check(cache, 3 * TEST_BLOCK_SIZE, 1000));
+
+  // a reset drops nothing, the runs are still there to seek back to
+  cache.ClearEndOfInput();
+  cache.Reset(TEST_BLOCK_SIZE);
+  BOOST_CHECK_EQUAL(cache.CachedDataEndPos(), (int64_t)TEST_BLOCK_SIZE);
+  BOOST_CHECK(Check(cache, 50000, 1000));
+  BOOST_CHECK(Check(cache, 3 * TEST_BLOCK_SIZE, 1000));
+
+  cache.Close();
+}
+
+BOOST_AUTO_TEST_CASE(TestCacheSparseEndOfInput)
+{
+  CTestCacheSparse cache(16 * TEST_BLOCK_SIZE);
+  BOOST_REQUIRE_EQUAL(cache.Open(), CACHE_RC_OK);
+
+  // the input only ends for the reader once it gets there
+  BOOST_REQUIRE(Fill(cache, 0, 100000));
+  cache.EndOfInput();
+  BOOST_CHECK(!cache.IsEndOfInput());
+  BOOST_CHECK(Check(cache, 0, 100000));
+  BOOST_CHECK(cache.IsEndOfInput());
+  char c;
+  BOOST_CHECK_EQUAL(cache.ReadFromCache(&c, 1), 0);
+  BOOST_CHECK_EQUAL(cache.Seek(100000), 100000);
+
+  // nor does it where it was any more once cleared and reset elsewhere
+  cache.ClearEndOfInput();
+  cache.Reset(5000000);
+  BOOST_CHECK(!cache.IsEndOfInput());
+  BOOST_CHECK_EQUAL(cache.ReadFromCache(&c, 1), CACHE_RC_WOULD_BLOCK);
+
+  // or once the source is read on from elsewhere
+  BOOST_REQUIRE(Fill(cache, 0, 100000));
+  cache.EndOfInput();
+  cache.SetWritePosition(50000);
+  BOOST_REQUIRE(Check(cache, 0, 100000));
+  BOOST_CHECK(!cache.IsEndOfInput());
+  BOOST_CHECK_EQUAL(cache.ReadFromCache(&c, 1), CACHE_RC_WOULD_BLOCK);
+
+  // or written past
+  BOOST_REQUIRE(Fill(cache, 0, 100000));
+  cache.EndOfInput();
+  c = Pattern(100000);
+  BOOST_CHECK_EQUAL(cache.WriteToCache(&c, 1), 1);
+  BOOST_REQUIRE(Check(cache, 0, 100001));
+  BOOST_CHECK(!cache.IsEndOfInput());
+  BOOST_CHECK_EQUAL(cache.ReadFromCache(&c, 1), CACHE_RC_WOULD_BLOCK);
+
+  cache.Close();
+}
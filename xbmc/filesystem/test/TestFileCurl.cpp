@@ -0,0 +1,358 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "filesystem/FileCurl.h"
+#include "settings/AdvancedSettings.h"
+#include "URL.h"
+#include "utils/test/TestUtils.h"
+
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread/thread.hpp>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+
+using namespace XFILE;
+
+#define TEST_FILE_SIZE (8 * 1024 * 1024 + 12345)
+
+namespace
+{
+/*
+ * Minimal HTTP/1.1 server on the loopback interface serving a single file.
+ * Every request is answered only after an artificial delay, and each
+ * connection is throttled, the way a single TCP stream over a long fat
+ * link would be.
+ */
+class CTestHttpServer
+{
+public:
+  enum RangeMode
+  {
+    RANGE_EXACT,     // answer ranges as asked
+    RANGE_TO_END,    // always send from the start of the range to the end of the file
+    RANGE_SHIFTED,   // answer closed ranges with as much data from a byte earlier
+  };
+
+  CTestHttpServer(const std::string &body, unsigned int latency, unsigned int rate, RangeMode mode = RANGE_EXACT)
+    : m_body(body), m_latency(latency), m_rate(rate), m_mode(mode), m_stop(false), m_requests(0)
+  {
+    m_socket = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(m_socket, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    bind(m_socket, (struct sockaddr*)&addr, sizeof(addr));
+    listen(m_socket, 16);
+
+    socklen_t len = sizeof(addr);
+    getsockname(m_socket, (struct sockaddr*)&addr, &len);
+    m_port = ntohs(addr.sin_port);
+
+    m_threads.create_thread(boost::bind(&CTestHttpServer::Listen, this));
+  }
+
+  ~CTestHttpServer()
+  {
+    m_stop = true;
+    m_threads.join_all();
+    close(m_socket);
+  }
+
+  std::string Url() const
+  {
+    char url[64];
+    sprintf(url, "http://127.0.0.1:%u/test.bin", m_port);
+    return url;
+  }
+
+  unsigned int Requests() const { return m_requests; }
+
+private:
+  void Listen()
+  {
+    while (!m_stop)
+    {
+      struct pollfd pfd = { m_socket, POLLIN, 0 };
+      if (poll(&pfd, 1, 50) <= 0)
+        continue;
+
+      int client = accept(m_socket, NULL, NULL);
+      if (client >= 0)
+        m_threads.create_thread(boost::bind(&CTestHttpServer::Serve, this, client));
+    }
+  }
+
+  bool ReadRequest(int client, std::string &request)
+  {
+    request.clear();
+    while (request.find("\r\n\r\n") == std::string::npos)
+    {
+      struct pollfd pfd = { client, POLLIN, 0 };
+      if (m_stop)
+        return false;
+      if (poll(&pfd, 1, 50) <= 0)
+        continue;
+
+      char buffer[1024];
+      ssize_t len = recv(client, buffer, sizeof(buffer), 0);
+      if (len <= 0)
+        return false;
+      request.append(buffer, len);
+    }
+    return true;
+  }
+
+  bool Send(int client, const char *data, size_t size)
+  {
+    while (size > 0)
+    {
+      ssize_t len = send(client, data, size, MSG_NOSIGNAL);
+      if (len <= 0)
+        return false;
+      data += len;
+      size -= len;
+    }
+    return true;
+  }
+
+  void Serve(int client)
+  {
+    std::string request;
+    while (!m_stop && ReadRequest(client, request))
+    {
+      m_requests++;
+
+      size_t begin = 0;
+      size_t end = m_body.size() - 1;
+      size_t range = request.find("Range: bytes=");
+      bool partial = range != std::string::npos;
+      if (partial)
+      {
+        unsigned long long first = 0, last = 0;
+        int fields = sscanf(request.c_str() + range, "Range: bytes=%llu-%llu", &first, &last);
+        begin = first;
+        if (fields == 2 && m_mode != RANGE_TO_END)
+          end = std::min<size_t>(last, end);
+        if (fields == 2 && m_mode == RANGE_SHIFTED && begin > 0)
+        {
+          begin--;
+          end--;
+        }
+      }
+
+      boost::this_thread::sleep(boost::posix_time::milliseconds(m_latency));
+
+      char header[512];
+      if (partial)
+        sprintf(header, "HTTP/1.1 206 Partial Content\r\nContent-Type: application/octet-stream\r\n"
+                        "Accept-Ranges: bytes\r\nContent-Range: bytes %lu-%lu/%lu\r\nContent-Length: %lu\r\n\r\n",
+                        (unsigned long)begin, (unsigned long)end, (unsigned long)m_body.size(), (unsigned long)(end - begin + 1));
+      else
+        sprintf(header, "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\n"
+                        "Accept-Ranges: bytes\r\nContent-Length: %lu\r\n\r\n", (unsigned long)m_body.size());
+
+      if (!Send(client, header, strlen(header)))
+        break;
+
+      // send in slices, sleeping in between to hold the connection to its rate
+      boost::posix_time::ptime start = BenchmarkStart();
+      size_t sent = 0;
+      bool failed = false;
+      while (begin + sent <= end && !m_stop)
+      {
+        size_t slice = std::min<size_t>(16384, end + 1 - begin - sent);
+        if (!Send(client, m_body.data() + begin + sent, slice))
+        {
+          failed = true;
+          break;
+        }
+        sent += slice;
+
+        if (m_rate)
+        {
+          boost::posix_time::ptime due = start + boost::posix_time::microseconds((int64_t)sent * 1000000 / m_rate);
+          boost::this_thread::sleep(due);
+        }
+      }
+      if (failed)
+        break;
+    }
+    close(client);
+  }
+
+  std::string           m_body;
+  unsigned int          m_latency;
+  unsigned int          m_rate;
+  RangeMode             m_mode;
+  volatile bool         m_stop;
+  volatile unsigned int m_requests;
+  int                   m_socket;
+  unsigned short        m_port;
+  boost::thread_group   m_threads;
+};
+}
+
+static std::string TestBody()
+{
+  std::string body(TEST_FILE_SIZE, 0);
+  unsigned int seed = 12345;
+  for (size_t i = 0; i < body.size(); i++)
+  {
+    seed = seed * 1103515245 + 12345;
+    body[i] = (char)(seed >> 16);
+  }
+  return body;
+}
+
+static bool ReadAll(CFileCurl &file, const std::string &body, int64_t from)
+{
+  std::string data;
+  char buffer[65536];
+  unsigned int read;
+  while ((read = file.Read(buffer, sizeof(buffer))) > 0)
+    data.append(buffer, read);
+
+  return data == body.substr(from);
+}
+
+BOOST_AUTO_TEST_CASE(TestFileCurlSingleConnection)
+{
+  std::string body = TestBody();
+  CTestHttpServer server(body, 20, 0);
+  g_advancedSettings.m_curlconnections = 1;
+
+  CFileCurl file;
+  BOOST_REQUIRE(file.Open(CURL(server.Url())));
+  BOOST_CHECK_EQUAL(file.GetLength(), (int64_t)body.size());
+  BOOST_CHECK(ReadAll(file, body, 0));
+  file.Close();
+}
+
+BOOST_AUTO_TEST_CASE(TestFileCurlRanges)
+{
+  std::string body = TestBody();
+  CTestHttpServer server(body, 20, 0);
+  g_advancedSettings.m_curlconnections = 4;
+
+  CFileCurl file;
+  BOOST_REQUIRE(file.Open(CURL(server.Url())));
+  BOOST_CHECK_EQUAL(file.GetLength(), (int64_t)body.size());
+  BOOST_CHECK(ReadAll(file, body, 0));
+  BOOST_CHECK(server.Requests() > 1);
+
+  // seeks back, within ranges fetched already and past them
+  srand(1);
+  char buffer[100000];
+  for (int i = 0; i < 50; i++)
+  {
+    int64_t pos = (int64_t)rand() % body.size();
+    BOOST_REQUIRE_EQUAL(file.Seek(pos, SEEK_SET), pos);
+
+    unsigned int want = 1 + rand() % sizeof(buffer);
+    unsigned int read = 0;
+    while (read < want && pos + read < (int64_t)body.size())
+    {
+      unsigned int len = file.Read(buffer + read, want - read);
+      if (len == 0)
+        break;
+      read += len;
+    }
+    BOOST_CHECK_EQUAL(read, std::min<int64_t>(want, body.size() - pos));
+    BOOST_CHECK(memcmp(buffer, body.data() + pos, read) == 0);
+  }
+
+  BOOST_REQUIRE_EQUAL(file.Seek(body.size() - 1000, SEEK_SET), (int64_t)body.size() - 1000);
+  BOOST_CHECK(ReadAll(file, body, body.size() - 1000));
+  file.Close();
+
+  g_advancedSettings.m_curlconnections = 1;
+}
+
+BOOST_AUTO_TEST_CASE(TestFileCurlRangesUnsupported)
+{
+  // the server sends more than asked for, reading goes on over one connection
+  std::string body = TestBody();
+  CTestHttpServer server(body, 20, 0, CTestHttpServer::RANGE_TO_END);
+  g_advancedSettings.m_curlconnections = 4;
+
+  CFileCurl file;
+  BOOST_REQUIRE(file.Open(CURL(server.Url())));
+  BOOST_CHECK(ReadAll(file, body, 0));
+  file.Close();
+
+  g_advancedSettings.m_curlconnections = 1;
+}
+
+BOOST_AUTO_TEST_CASE(TestFileCurlRangesShifted)
+{
+  // the server sends as much as asked for, but not what was asked for
+  std::string body = TestBody();
+  CTestHttpServer server(body, 20, 0, CTestHttpServer::RANGE_SHIFTED);
+  g_advancedSettings.m_curlconnections = 4;
+
+  CFileCurl file;
+  BOOST_REQUIRE(file.Open(CURL(server.Url())));
+  BOOST_CHECK(ReadAll(file, body, 0));
+  file.Close();
+
+  g_advancedSettings.m_curlconnections = 1;
+}
+
+BOOST_AUTO_TEST_CASE(BenchmarkFileCurl)
+{
+  // 50ms until each request is answered, 1MB/s for each connection
+  std::string body = TestBody();
+  CTestHttpServer server(body, 50, 1024 * 1024);
+
+  printf("connections   time (ms)   requests   rate (KB/s)\n");
+  int connections[] = { 1, 2, 4, 8 };
+  for (unsigned int i = 0; i < sizeof(connections) / sizeof(connections[0]); i++)
+  {
+    g_advancedSettings.m_curlconnections = connections[i];
+    unsigned int requests = server.Requests();
+
+    boost::posix_time::ptime start = BenchmarkStart();
+    CFileCurl file;
+    BOOST_REQUIRE(file.Open(CURL(server.Url())));
+    BOOST_CHECK(ReadAll(file, body, 0));
+    file.Close();
+    double time = ElapsedMilliseconds(start);
+
+    printf("%11d %11.1f %10u %13.1f\n", connections[i], time, server.Requests() - requests, body.size() / time * 1000.0 / 1024.0);
+  }
+
+  g_advancedSettings.m_curlconnections = 1;
+}
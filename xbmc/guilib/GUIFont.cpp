@@ -243,6 +243,12 @@ float CGUIFont::GetTextWidth( const vecText &text )
   return m_font->GetTextWidthInternal(text.begin(), text.end()) * g_graphicsContext.GetGUIScaleX();
 }
 
+void CGUIFont::Prewarm(const vecText &text)
+{
+  if (m_font)
+    m_font->PrewarmCharacters(text);
+}
+
 float CGUIFont::GetCharWidth( character_t ch )
 {
   if (!m_font) return 0;
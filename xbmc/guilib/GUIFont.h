@@ -135,6 +135,13 @@ public:
   float GetTextHeight(int numLines) const;
   float GetLineHeight() const;
 
+  /*! \brief Render glyphs ahead of their first use
+   May be called from a background thread, as long as the font stays loaded.
+   \param text the characters to render, with their style
+   \sa CGUITextLayout::Prewarm
+   */
+  void Prewarm(const vecText &text);
+
   //! get font scale factor (rendered height / original height)
   float GetScaleFactor() const;
 
@@ -26,7 +26,9 @@
 #include "GraphicContext.h"
 #include "filesystem/SpecialProtocol.h"
 #include "utils/MathUtils.h"
+#include "utils/TimeUtils.h"
 #include "utils/log.h"
+#include "threads/SingleLock.h"
 #include "windowing/WindowingFactory.h"
 
 #include <math.h>
@@ -49,6 +51,18 @@ using namespace std;
 
 #define CHARS_PER_TEXTURE_LINE 20 // number of characters to cache per texture line
 #define CHAR_CHUNK    64      // 64 chars allocated at a time (1024 bytes)
+#define CHAR_FREE     0xffffffff // letterAndStyle of an unused character slot
+#define CHAR_INDEX_MIN_SIZE   256 // initial size of the character hash
+#define MAX_PREWARMED_GLYPHS 4096 // glyphs rendered ahead of use that may wait for their first use
+
+static unsigned int s_glyphHits = 0;
+static unsigned int s_glyphMisses = 0;
+static unsigned int s_glyphEvictions = 0;
+
+static inline unsigned int HashCharacter(character_t letterAndStyle)
+{
+  return letterAndStyle * 2654435761U; // Knuth's multiplicative hash
+}
 
 int CGUIFontTTFBase::justification_word_weight = 6;   // weight of word spacing over letter spacing when justifying.
                                                   // A larger number means more of the "dead space" is placed between
@@ -155,6 +169,7 @@ CGUIFontTTFBase::CGUIFontTTFBase(const CStdString& strFileName)
   m_originX = m_originY = 0.0f;
   m_cellBaseLine = m_cellHeight = 0;
   m_numChars = 0;
+  m_charIndexUsed = 0;
   m_posX = m_posY = 0;
   m_textureHeight = m_textureWidth = 0;
   m_textureScaleX = m_textureScaleY = 0.0;
@@ -190,11 +205,15 @@ void CGUIFontTTFBase::ClearCharacterCache()
   DeleteHardwareTexture();
 
   m_texture = NULL;
+  CSingleLock lock(m_glyphSection);
   delete[] m_char;
   m_char = new Character[CHAR_CHUNK];
   memset(m_charquick, 0, sizeof(m_charquick));
   m_numChars = 0;
   m_maxChars = CHAR_CHUNK;
+  m_freeChars.clear();
+  ResizeCharacterIndex(CHAR_INDEX_MIN_SIZE);
+  m_rowUsed.clear();
   // set the posX and posY so that our texture will be created on first character write.
   m_posX = m_textureWidth;
   m_posY = -(int)m_cellHeight;
@@ -205,11 +224,20 @@ void CGUIFontTTFBase::Clear()
 {
   delete(m_texture);
   m_texture = NULL;
+  CSingleLock lock(m_glyphSection);
   delete[] m_char;
   memset(m_charquick, 0, sizeof(m_charquick));
   m_char = NULL;
   m_maxChars = 0;
   m_numChars = 0;
+  m_freeChars.clear();
+  m_charIndex.clear();
+  m_charIndexUsed = 0;
+  m_rowUsed.clear();
+  for (std::map<character_t, PrewarmedGlyph>::iterator i = m_prewarmed.begin(); i != m_prewarmed.end(); ++i)
+    FT_Done_Glyph(i->second.glyph);
+  m_prewarmed.clear();
+  lock.Leave();
   m_posX = 0;
   m_posY = 0;
   m_nestedBeginCount = 0;
@@ -278,11 +306,16 @@ bool CGUIFontTTFBase::Load(const CStdString& strFilename, float height, float as
 
   delete(m_texture);
   m_texture = NULL;
+  CSingleLock lock(m_glyphSection);
   delete[] m_char;
   m_char = NULL;
 
   m_maxChars = 0;
   m_numChars = 0;
+  m_freeChars.clear();
+  ResizeCharacterIndex(CHAR_INDEX_MIN_SIZE);
+  m_rowUsed.clear();
+  lock.Leave();
 
   m_strFilename = strFilename;
 
@@ -444,6 +477,20 @@ float CGUIFontTTFBase::GetLineHeight(float lineSpacing) const
   return 0.0f;
 }
 
+void CGUIFontTTFBase::GetCacheStats(unsigned int &hits, unsigned int &misses, unsigned int &evictions)
+{
+  hits = s_glyphHits;
+  misses = s_glyphMisses;
+  evictions = s_glyphEvictions;
+}
+
+inline CGUIFontTTFBase::Character* CGUIFontTTFBase::TouchCharacter(Character *ch)
+{
+  m_rowUsed[ch->row] = CTimeUtils::GetFrameTime();
+  s_glyphHits++;
+  return ch;
+}
+
 CGUIFontTTFBase::Character* CGUIFontTTFBase::GetCharacter(character_t chr)
 {
   wchar_t letter = (wchar_t)(chr & 0xffff);
@@ -458,58 +505,33 @@ CGUIFontTTFBase::Character* CGUIFontTTFBase::GetCharacter(character_t chr)
   {
     character_t ch = (style << 8) | letter;
     if (m_charquick[ch])
-      return m_charquick[ch];
+      return TouchCharacter(m_charquick[ch]);
   }
 
   // letters are stored based on style and letter
   character_t ch = (style << 16) | letter;
 
-  int low = 0;
-  int high = m_numChars - 1;
-  int mid;
-  while (low <= high)
-  {
-    mid = (low + high) >> 1;
-    if (ch > m_char[mid].letterAndStyle)
-      low = mid + 1;
-    else if (ch < m_char[mid].letterAndStyle)
-      high = mid - 1;
-    else
-      return &m_char[mid];
-  }
-  // if we get to here, then low is where we should insert the new character
+  int slot = FindCharacter(ch);
+  if (slot >= 0)
+    return TouchCharacter(m_char + slot);
+  s_glyphMisses++;
 
-  // increase the size of the buffer if we need it
-  if (m_numChars >= m_maxChars)
-  { // need to increase the size of the buffer
-    Character *newTable = new Character[m_maxChars + CHAR_CHUNK];
-    if (m_char)
-    {
-      memcpy(newTable, m_char, low * sizeof(Character));
-      memcpy(newTable + low + 1, m_char + low, (m_numChars - low) * sizeof(Character));
-      delete[] m_char;
-    }
-    m_char = newTable;
-    m_maxChars += CHAR_CHUNK;
+  slot = AllocCharacter();
 
-  }
-  else
-  { // just move the data along as necessary
-    memmove(m_char + low + 1, m_char + low, (m_numChars - low) * sizeof(Character));
-  }
   // render the character to our texture
   // must End() as we can't render text to our texture during a Begin(), End() block
   unsigned int nestedBeginCount = m_nestedBeginCount;
   m_nestedBeginCount = 1;
   if (nestedBeginCount) End();
-  if (!CacheCharacter(letter, style, m_char + low))
+  if (!CacheCharacter(letter, style, m_char + slot))
   { // unable to cache character - try clearing them all out and starting over
-    CLog::Log(LOGDEBUG, "GUIFontTTF::GetCharacter: Unable to cache character.  Clearing character cache of %i characters", m_numChars);
+    CLog::Log(LOGDEBUG, "GUIFontTTF::GetCharacter: Unable to cache character.  Clearing character cache of %u characters", m_charIndexUsed);
     ClearCharacterCache();
-    low = 0;
-    if (!CacheCharacter(letter, style, m_char + low))
+    slot = AllocCharacter();
+    if (!CacheCharacter(letter, style, m_char + slot))
     {
       CLog::Log(LOGERROR, "GUIFontTTF::GetCharacter: Unable to cache character (out of memory?)");
+      m_freeChars.push_back(slot);
       if (nestedBeginCount) Begin();
       m_nestedBeginCount = nestedBeginCount;
       return NULL;
@@ -518,25 +540,238 @@ CGUIFontTTFBase::Character* CGUIFontTTFBase::GetCharacter(character_t chr)
   if (nestedBeginCount) Begin();
   m_nestedBeginCount = nestedBeginCount;
 
-  // fixup quick access
+  AddCharacter(slot);
+  return m_char + slot;
+}
+
+int CGUIFontTTFBase::FindCharacter(character_t letterAndStyle) const
+{
+  if (m_charIndex.empty())
+    return -1;
+  unsigned int mask = m_charIndex.size() - 1;
+  for (unsigned int i = HashCharacter(letterAndStyle) & mask; ; i = (i + 1) & mask)
+  {
+    const CharacterIndex &entry = m_charIndex[i];
+    if (entry.slot < 0)
+      return -1;
+    if (entry.letterAndStyle == letterAndStyle)
+      return entry.slot;
+  }
+}
+
+int CGUIFontTTFBase::AllocCharacter()
+{
+  if (!m_freeChars.empty())
+  {
+    int slot = m_freeChars.back();
+    m_freeChars.pop_back();
+    return slot;
+  }
+  if (m_numChars >= m_maxChars)
+  { // need to increase the size of the buffer
+    Character *newTable = new Character[m_maxChars + CHAR_CHUNK];
+    if (m_char)
+    {
+      memcpy(newTable, m_char, m_numChars * sizeof(Character));
+      delete[] m_char;
+    }
+    m_char = newTable;
+    m_maxChars += CHAR_CHUNK;
+    RebuildQuickAccess();
+  }
+  m_char[m_numChars].letterAndStyle = CHAR_FREE;
+  return m_numChars++;
+}
+
+void CGUIFontTTFBase::AddCharacter(int slot)
+{
+  CSingleLock lock(m_glyphSection);
+  if ((m_charIndexUsed + 1) * 2 > m_charIndex.size())
+    ResizeCharacterIndex(std::max<unsigned int>(m_charIndex.size() * 2, CHAR_INDEX_MIN_SIZE));
+
+  character_t letterAndStyle = m_char[slot].letterAndStyle;
+  unsigned int mask = m_charIndex.size() - 1;
+  unsigned int i = HashCharacter(letterAndStyle) & mask;
+  while (m_charIndex[i].slot >= 0)
+    i = (i + 1) & mask;
+  m_charIndex[i].letterAndStyle = letterAndStyle;
+  m_charIndex[i].slot = slot;
+  m_charIndexUsed++;
+
+  if ((letterAndStyle & 0xffff) < 255)
+    m_charquick[((letterAndStyle & 0xffff0000) >> 8) | (letterAndStyle & 0xff)] = m_char + slot;
+}
+
+void CGUIFontTTFBase::RemoveCharacter(int slot)
+{
+  // caller holds m_glyphSection
+  character_t letterAndStyle = m_char[slot].letterAndStyle;
+  unsigned int mask = m_charIndex.size() - 1;
+  unsigned int i = HashCharacter(letterAndStyle) & mask;
+  while (m_charIndex[i].slot != slot)
+    i = (i + 1) & mask;
+
+  // shift back any following entries that would no longer be found past the hole
+  for (unsigned int j = (i + 1) & mask; m_charIndex[j].slot >= 0; j = (j + 1) & mask)
+  {
+    unsigned int home = HashCharacter(m_charIndex[j].letterAndStyle) & mask;
+    if (((j - home) & mask) >= ((j - i) & mask))
+    {
+      m_charIndex[i] = m_charIndex[j];
+      i = j;
+    }
+  }
+  m_charIndex[i].slot = -1;
+  m_charIndexUsed--;
+
+  if ((letterAndStyle & 0xffff) < 255)
+    m_charquick[((letterAndStyle & 0xffff0000) >> 8) | (letterAndStyle & 0xff)] = NULL;
+  m_char[slot].letterAndStyle = CHAR_FREE;
+  m_freeChars.push_back(slot);
+}
+
+void CGUIFontTTFBase::ResizeCharacterIndex(unsigned int size)
+{
+  // caller holds m_glyphSection
+  CharacterIndex empty = { 0, -1 };
+  m_charIndex.assign(size, empty);
+  m_charIndexUsed = 0;
+  unsigned int mask = size - 1;
+  for (int slot = 0; slot < m_numChars; slot++)
+  {
+    character_t letterAndStyle = m_char[slot].letterAndStyle;
+    if (letterAndStyle == CHAR_FREE)
+      continue;
+    unsigned int i = HashCharacter(letterAndStyle) & mask;
+    while (m_charIndex[i].slot >= 0)
+      i = (i + 1) & mask;
+    m_charIndex[i].letterAndStyle = letterAndStyle;
+    m_charIndex[i].slot = slot;
+    m_charIndexUsed++;
+  }
+}
+
+void CGUIFontTTFBase::RebuildQuickAccess()
+{
   memset(m_charquick, 0, sizeof(m_charquick));
-  for(int i=0;i<m_numChars;i++)
+  for (int i = 0; i < m_numChars; i++)
   {
-    if ((m_char[i].letterAndStyle & 0xffff) < 255)
+    if (m_char[i].letterAndStyle != CHAR_FREE && (m_char[i].letterAndStyle & 0xffff) < 255)
     {
       character_t ch = ((m_char[i].letterAndStyle & 0xffff0000) >> 8) | (m_char[i].letterAndStyle & 0xff);
-      m_charquick[ch] = m_char+i;
+      m_charquick[ch] = m_char + i;
+    }
+  }
+}
+
+bool CGUIFontTTFBase::MoveToNextRow()
+{
+  // rows are filled top to bottom until the texture can't grow any further
+  if (m_posY < 0 || m_posY / m_cellHeight + 1 == m_rowUsed.size())
+  {
+    unsigned int posY = m_posY + m_cellHeight;
+    bool fits = true;
+    if (posY + m_cellHeight >= m_textureHeight)
+    {
+      // create the new larger texture
+      unsigned int newHeight = posY + m_cellHeight;
+      // check for max height
+      if (newHeight > g_Windowing.GetMaxTextureSize())
+      {
+        CLog::Log(LOGDEBUG, "GUIFontTTF::CacheCharacter: New cache texture is too large (%u > %u pixels long)", newHeight, g_Windowing.GetMaxTextureSize());
+        fits = false;
+      }
+      else
+      {
+        CBaseTexture* newTexture = ReallocTexture(newHeight);
+        if (newTexture)
+          m_texture = newTexture;
+        else
+        {
+          CLog::Log(LOGDEBUG, "GUIFontTTF::CacheCharacter: Failed to allocate new texture of height %u", newHeight);
+          fits = false;
+        }
+      }
+    }
+    if (fits)
+    {
+      m_posX = 0;
+      m_posY = posY;
+      m_rowUsed.push_back(CTimeUtils::GetFrameTime());
+      return true;
     }
   }
+  // then the least recently used row is emptied and refilled
+  return ReuseRow();
+}
+
+bool CGUIFontTTFBase::ReuseRow()
+{
+  int current = m_posY < 0 ? -1 : m_posY / (int)m_cellHeight;
+  int row = -1;
+  for (unsigned int i = 0; i < m_rowUsed.size(); i++)
+  {
+    if ((int)i != current && (row < 0 || m_rowUsed[i] < m_rowUsed[row]))
+      row = i;
+  }
+  if (row < 0)
+    return false;
 
-  return m_char + low;
+  // new glyphs don't cover all of the old ones, so the row is blanked first
+  unsigned int top = row * m_cellHeight;
+  if (!ClearTextureRows(top, min(m_cellHeight, m_textureHeight - top)))
+    return false;
+
+  // the caller has ended any Begin(), End() block, so no vertices refer to these characters
+  CSingleLock lock(m_glyphSection);
+  for (int slot = 0; slot < m_numChars; slot++)
+  {
+    if (m_char[slot].letterAndStyle != CHAR_FREE && m_char[slot].row == (unsigned int)row)
+    {
+      RemoveCharacter(slot);
+      s_glyphEvictions++;
+    }
+  }
+  m_posX = 0;
+  m_posY = top;
+  m_rowUsed[row] = CTimeUtils::GetFrameTime();
+  return true;
 }
 
-bool CGUIFontTTFBase::CacheCharacter(wchar_t letter, uint32_t style, Character *ch)
+void CGUIFontTTFBase::PrewarmCharacters(const vecText &text)
 {
+  for (vecText::const_iterator pos = text.begin(); pos != text.end(); ++pos)
+  {
+    wchar_t letter = (wchar_t)(*pos & 0xffff);
+    character_t style = (*pos & 0x3000000) >> 24;
+    if (letter == L'\r')
+      continue;
+    character_t ch = (style << 16) | letter;
+    {
+      CSingleLock lock(m_glyphSection);
+      if (m_prewarmed.size() >= MAX_PREWARMED_GLYPHS)
+        return;
+      if (FindCharacter(ch) >= 0 || m_prewarmed.find(ch) != m_prewarmed.end())
+        continue;
+    }
+    PrewarmedGlyph glyph;
+    if (!RenderGlyph(letter, style, glyph.glyph, glyph.advance))
+      continue;
+    CSingleLock lock(m_glyphSection);
+    if (!m_prewarmed.insert(make_pair(ch, glyph)).second)
+      FT_Done_Glyph(glyph.glyph);
+  }
+}
+
+bool CGUIFontTTFBase::RenderGlyph(wchar_t letter, uint32_t style, FT_Glyph &glyph, float &advance)
+{
+  CSingleLock lock(m_faceSection);
+  if (!m_face)
+    return false;
+
   int glyph_index = FT_Get_Char_Index( m_face, letter );
 
-  FT_Glyph glyph = NULL;
+  glyph = NULL;
   if (FT_Load_Glyph( m_face, glyph_index, FT_LOAD_TARGET_LIGHT ))
   {
     CLog::Log(LOGDEBUG, "%s Failed to load glyph %x", __FUNCTION__, letter);
@@ -560,8 +795,30 @@ bool CGUIFontTTFBase::CacheCharacter(wchar_t letter, uint32_t style, Character *
   if (FT_Glyph_To_Bitmap(&glyph, FT_RENDER_MODE_NORMAL, NULL, 1))
   {
     CLog::Log(LOGDEBUG, "%s Failed to render glyph %x to a bitmap", __FUNCTION__, letter);
+    FT_Done_Glyph(glyph);
     return false;
   }
+  advance = (float)MathUtils::round_int( (float)m_face->glyph->advance.x / 64 );
+  return true;
+}
+
+bool CGUIFontTTFBase::CacheCharacter(wchar_t letter, uint32_t style, Character *ch)
+{
+  FT_Glyph glyph = NULL;
+  float advance = 0;
+  { // use the glyph if it has been rendered ahead
+    CSingleLock lock(m_glyphSection);
+    std::map<character_t, PrewarmedGlyph>::iterator i = m_prewarmed.find((style << 16) | letter);
+    if (i != m_prewarmed.end())
+    {
+      glyph = i->second.glyph;
+      advance = i->second.advance;
+      m_prewarmed.erase(i);
+    }
+  }
+  if (!glyph && !RenderGlyph(letter, style, glyph, advance))
+    return false;
+
   FT_BitmapGlyph bitGlyph = (FT_BitmapGlyph)glyph;
   FT_Bitmap bitmap = bitGlyph->bitmap;
   if (bitGlyph->left < 0)
@@ -570,50 +827,32 @@ bool CGUIFontTTFBase::CacheCharacter(wchar_t letter, uint32_t style, Character *
   // check we have enough room for the character
   if (m_posX + bitGlyph->left + bitmap.width > (int)m_textureWidth)
   { // no space - gotta drop to the next line (which means creating a new texture and copying it across)
-    m_posX = 0;
-    m_posY += m_cellHeight;
-    if (bitGlyph->left < 0)
-      m_posX += -bitGlyph->left;
-
-    if(m_posY + m_cellHeight >= m_textureHeight)
+    if (!MoveToNextRow())
     {
-      // create the new larger texture
-      unsigned int newHeight = m_posY + m_cellHeight;
-      // check for max height
-      if (newHeight > g_Windowing.GetMaxTextureSize())
-      {
-        CLog::Log(LOGDEBUG, "GUIFontTTF::CacheCharacter: New cache texture is too large (%u > %u pixels long)", newHeight, g_Windowing.GetMaxTextureSize());
-        FT_Done_Glyph(glyph);
-        return false;
-      }
-
-      CBaseTexture* newTexture = NULL;
-      newTexture = ReallocTexture(newHeight);
-      if(newTexture == NULL)
-      {
-        FT_Done_Glyph(glyph);
-        CLog::Log(LOGDEBUG, "GUIFontTTF::CacheCharacter: Failed to allocate new texture of height %u", newHeight);
-        return false;
-      }
-      m_texture = newTexture;
+      FT_Done_Glyph(glyph);
+      return false;
     }
+    if (bitGlyph->left < 0)
+      m_posX += -bitGlyph->left;
   }
 
   if(m_texture == NULL)
   {
     CLog::Log(LOGDEBUG, "GUIFontTTF::CacheCharacter: no texture to cache character to");
+    FT_Done_Glyph(glyph);
     return false;
   }
 
   // set the character in our table
   ch->letterAndStyle = (style << 16) | letter;
+  ch->row = m_posY / m_cellHeight;
   ch->offsetX = (short)bitGlyph->left;
   ch->offsetY = (short)max((short)m_cellBaseLine - bitGlyph->top, 0);
   ch->left = (float)m_posX + ch->offsetX;
   ch->top = (float)m_posY + ch->offsetY;
   ch->right = ch->left + bitmap.width;
   ch->bottom = ch->top + bitmap.rows;
-  ch->advance = (float)MathUtils::round_int( (float)m_face->glyph->advance.x / 64 );
+  ch->advance = advance;
 
   // we need only render if we actually have some pixels
   if (bitmap.width * bitmap.rows)
@@ -621,7 +860,6 @@ bool CGUIFontTTFBase::CacheCharacter(wchar_t letter, uint32_t style, Character *
     CopyCharToTexture(bitGlyph, ch);
   }
   m_posX += 1 + (unsigned short)max(ch->right - ch->left + ch->offsetX, ch->advance);
-  m_numChars++;
 
   m_textureScaleX = 1.0f / m_textureWidth;
   m_textureScaleY = 1.0f / m_textureHeight;
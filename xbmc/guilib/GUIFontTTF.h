@@ -28,6 +28,11 @@
  *
  */
 
+#include "threads/CriticalSection.h"
+
+#include <map>
+#include <vector>
+
 // forward definition
 class CBaseTexture;
 
@@ -36,12 +41,14 @@ struct FT_LibraryRec_;
 struct FT_GlyphSlotRec_;
 struct FT_BitmapGlyphRec_;
 struct FT_StrokerRec_;
+struct FT_GlyphRec_;
 
 typedef struct FT_FaceRec_ *FT_Face;
 typedef struct FT_LibraryRec_ *FT_Library;
 typedef struct FT_GlyphSlotRec_ *FT_GlyphSlot;
 typedef struct FT_BitmapGlyphRec_ *FT_BitmapGlyph;
 typedef struct FT_StrokerRec_ *FT_Stroker;
+typedef struct FT_GlyphRec_ *FT_Glyph;
 
 typedef uint32_t character_t;
 typedef uint32_t color_t;
@@ -83,6 +90,13 @@ public:
 
   const CStdString& GetFileName() const { return m_strFileName; };
 
+  /*! \brief Glyph cache statistics, summed over all fonts
+   \param hits [out] number of glyph lookups that found the glyph cached
+   \param misses [out] number of glyphs that had to be rendered into a cache texture
+   \param evictions [out] number of cached glyphs evicted to make room for others
+   */
+  static void GetCacheStats(unsigned int &hits, unsigned int &misses, unsigned int &evictions);
+
 protected:
   struct Character
   {
@@ -90,6 +104,21 @@ protected:
     float left, top, right, bottom;
     float advance;
     character_t letterAndStyle;
+    unsigned int row;              // texture row the character is cached in
+  };
+
+  // entry of the open addressed hash from letter and style to a slot in m_char
+  struct CharacterIndex
+  {
+    character_t letterAndStyle;
+    int slot;                      // -1 if the entry is empty
+  };
+
+  // a glyph rendered ahead of its first use, waiting to be copied to the texture
+  struct PrewarmedGlyph
+  {
+    FT_Glyph glyph;
+    float advance;
   };
   void AddReference();
   void RemoveReference();
@@ -109,11 +138,31 @@ protected:
   // Stuff for pre-rendering for speed
   inline Character *GetCharacter(character_t letter);
   bool CacheCharacter(wchar_t letter, uint32_t style, Character *ch);
+  bool RenderGlyph(wchar_t letter, uint32_t style, FT_Glyph &glyph, float &advance);
   void RenderCharacter(float posX, float posY, const Character *ch, color_t color, bool roundX);
   void ClearCharacterCache();
 
+  /*! \brief Render glyphs ahead of their first use
+   The glyphs are rendered with freetype now and copied to the texture when first drawn.
+   May be called from any thread, as long as the font stays loaded.
+   \param text the characters to render, with their style
+   */
+  void PrewarmCharacters(const vecText &text);
+
+  // the character cache: slots in m_char indexed by a hash, and texture rows reused by LRU
+  inline Character *TouchCharacter(Character *ch);
+  int FindCharacter(character_t letterAndStyle) const;
+  int AllocCharacter();
+  void AddCharacter(int slot);
+  void RemoveCharacter(int slot);
+  void ResizeCharacterIndex(unsigned int size);
+  void RebuildQuickAccess();
+  bool MoveToNextRow();
+  bool ReuseRow();
+
   virtual CBaseTexture* ReallocTexture(unsigned int& newHeight) = 0;
   virtual bool CopyCharToTexture(FT_BitmapGlyph bitGlyph, Character *ch) = 0;
+  virtual bool ClearTextureRows(unsigned int top, unsigned int height) = 0;
   virtual void DeleteHardwareTexture() = 0;
 
   // modifying glyphs
@@ -132,7 +181,17 @@ protected:
   Character *m_char;                 // our characters
   Character *m_charquick[256*4];     // ascii chars (4 styles) here
   int m_maxChars;                    // size of character array (can be incremented)
-  int m_numChars;                    // the current number of cached characters
+  int m_numChars;                    // the number of slots in use in the character array, including free ones
+  std::vector<int> m_freeChars;      // slots of evicted characters
+  std::vector<CharacterIndex> m_charIndex; // hash from letter and style to slot, size a power of 2
+  unsigned int m_charIndexUsed;      // the current number of cached characters
+  std::vector<unsigned int> m_rowUsed; // frame time each texture row was last drawn from
+
+  // characters rendered by PrewarmCharacters. The prewarming thread reads m_charIndex
+  // under m_glyphSection, so the render thread changes it only while holding it.
+  std::map<character_t, PrewarmedGlyph> m_prewarmed;
+  CCriticalSection m_glyphSection;
+  CCriticalSection m_faceSection;    // freetype faces may only be used by one thread at a time
 
   float m_ellipsesWidth;               // this is used every character (width of '.')
 
@@ -307,6 +307,45 @@ bool CGUIFontTTFDX::CopyCharToTexture(FT_BitmapGlyph bitGlyph, Character* ch)
   return TRUE;
 }
 
+bool CGUIFontTTFDX::ClearTextureRows(unsigned int top, unsigned int height)
+{
+  LPDIRECT3DSURFACE9 target;
+  if (m_speedupTexture)
+    m_speedupTexture->GetSurfaceLevel(0, &target);
+  else
+    m_texture->GetTextureObject()->GetSurfaceLevel(0, &target);
+
+  RECT rect = { 0, top, m_textureWidth, top + height };
+  D3DLOCKED_RECT lr;
+  if (FAILED(target->LockRect(&lr, &rect, 0)))
+  {
+    CLog::Log(LOGERROR, __FUNCTION__" - failed to lock surface");
+    SAFE_RELEASE(target);
+    return false;
+  }
+
+  unsigned char *dst = (unsigned char *)lr.pBits;
+  for (unsigned int y = 0; y < height; y++)
+  {
+    memset(dst, 0, m_textureWidth);
+    dst += lr.Pitch;
+  }
+  target->UnlockRect();
+  SAFE_RELEASE(target);
+
+  if (m_speedupTexture)
+  {
+    // Upload to GPU - the locked rect is the dirty region.
+    HRESULT hr = g_Windowing.Get3DDevice()->UpdateTexture(m_speedupTexture->Get(), m_texture->GetTextureObject());
+    if (FAILED(hr))
+    {
+      CLog::Log(LOGERROR, __FUNCTION__": Failed to upload from sysmem to vidmem (0x%08X)", hr);
+      return false;
+    }
+  }
+  return true;
+}
+
 
 void CGUIFontTTFDX::DeleteHardwareTexture()
 {
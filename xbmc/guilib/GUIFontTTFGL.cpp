@@ -228,6 +228,22 @@ bool CGUIFontTTFGL::CopyCharToTexture(FT_BitmapGlyph bitGlyph, Character* ch)
   return TRUE;
 }
 
+bool CGUIFontTTFGL::ClearTextureRows(unsigned int top, unsigned int height)
+{
+  memset((unsigned char*) m_texture->GetPixels() + top * m_texture->GetPitch(), 0, height * m_texture->GetPitch());
+
+  // the hardware texture is recreated from m_texture in Begin()
+  if (m_bTextureLoaded)
+  {
+    g_graphicsContext.BeginPaint();  //FIXME
+    DeleteHardwareTexture();
+    g_graphicsContext.EndPaint();
+    m_bTextureLoaded = false;
+  }
+
+  return true;
+}
+
 
 void CGUIFontTTFGL::DeleteHardwareTexture()
 {
@@ -48,6 +48,7 @@ public:
 protected:
   virtual CBaseTexture* ReallocTexture(unsigned int& newHeight);
   virtual bool CopyCharToTexture(FT_BitmapGlyph bitGlyph, Character *ch);
+  virtual bool ClearTextureRows(unsigned int top, unsigned int height);
   virtual void DeleteHardwareTexture();
 
 };
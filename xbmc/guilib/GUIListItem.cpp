@@ -24,6 +24,7 @@
 #include "utils/Archive.h"
 #include "utils/CharsetConverter.h"
 #include "utils/Variant.h"
+#include <algorithm>
 
 CGUIListItem::CGUIListItem(const CGUIListItem& item)
 {
@@ -321,14 +322,51 @@ void CGUIListItem::SetInvalid()
   if (m_focusedLayout) m_focusedLayout->SetInvalid();
 }
 
+bool CGUIListItem::icompare::operator()(const std::pair<CStdString, CVariant> &p1, const CStdString &s2) const
+{
+  return p1.first.CompareNoCase(s2) < 0;
+}
+
+CGUIListItem::PropertyMap::iterator CGUIListItem::FindProperty(const CStdString &strKey)
+{
+  PropertyMap::iterator iter = std::lower_bound(m_mapProperties.begin(), m_mapProperties.end(), strKey, icompare());
+  if (iter != m_mapProperties.end() && iter->first.CompareNoCase(strKey) == 0)
+    return iter;
+
+  return m_mapProperties.end();
+}
+
+CGUIListItem::PropertyMap::const_iterator CGUIListItem::FindProperty(const CStdString &strKey) const
+{
+  PropertyMap::const_iterator iter = std::lower_bound(m_mapProperties.begin(), m_mapProperties.end(), strKey, icompare());
+  if (iter != m_mapProperties.end() && iter->first.CompareNoCase(strKey) == 0)
+    return iter;
+
+  return m_mapProperties.end();
+}
+
 void CGUIListItem::SetProperty(const CStdString &strKey, const CVariant &value)
 {
-  m_mapProperties[strKey] = value;
+  PropertyMap::iterator iter = std::lower_bound(m_mapProperties.begin(), m_mapProperties.end(), strKey, icompare());
+  if (iter != m_mapProperties.end() && iter->first.CompareNoCase(strKey) == 0)
+  {
+    iter->second = value;
+    return;
+  }
+
+  // append and swap down into place, swapping keys and values is cheap where copying isn't
+  size_t index = iter - m_mapProperties.begin();
+  m_mapProperties.push_back(std::make_pair(strKey, value));
+  for (size_t i = m_mapProperties.size() - 1; i > index; i--)
+  {
+    m_mapProperties[i].first.swap(m_mapProperties[i - 1].first);
+    m_mapProperties[i].second.swap(m_mapProperties[i - 1].second);
+  }
 }
 
 CVariant CGUIListItem::GetProperty(const CStdString &strKey) const
 {
-  PropertyMap::const_iterator iter = m_mapProperties.find(strKey);
+  PropertyMap::const_iterator iter = FindProperty(strKey);
   if (iter == m_mapProperties.end())
     return CVariant(CVariant::VariantTypeNull);
 
@@ -337,7 +375,7 @@ CVariant CGUIListItem::GetProperty(const CStdString &strKey) const
 
 bool CGUIListItem::HasProperty(const CStdString &strKey) const
 {
-  PropertyMap::const_iterator iter = m_mapProperties.find(strKey);
+  PropertyMap::const_iterator iter = FindProperty(strKey);
   if (iter == m_mapProperties.end())
     return false;
 
@@ -346,7 +384,7 @@ bool CGUIListItem::HasProperty(const CStdString &strKey) const
 
 void CGUIListItem::ClearProperty(const CStdString &strKey)
 {
-  PropertyMap::iterator iter = m_mapProperties.find(strKey);
+  PropertyMap::iterator iter = FindProperty(strKey);
   if (iter != m_mapProperties.end())
     m_mapProperties.erase(iter);
 }
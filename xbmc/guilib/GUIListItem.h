@@ -30,14 +30,15 @@
  */
 
 #include "utils/StdString.h"
+#include "utils/Variant.h"
 
 #include <map>
+#include <vector>
 #include <string>
 
 //  Forward
 class CGUIListItemLayout;
 class CArchive;
-class CVariant;
 
 /*!
  \ingroup controls
@@ -141,11 +142,16 @@ protected:
     {
       return s1.CompareNoCase(s2) < 0;
     }
+    bool operator()(const std::pair<CStdString, CVariant> &p1, const CStdString &s2) const;
   };
 
-  typedef std::map<CStdString, CVariant, icompare> PropertyMap;
+  // kept sorted by key, case insensitively - items have a handful of properties at most
+  typedef std::vector< std::pair<CStdString, CVariant> > PropertyMap;
   PropertyMap m_mapProperties;
 private:
+  PropertyMap::iterator FindProperty(const CStdString &strKey);
+  PropertyMap::const_iterator FindProperty(const CStdString &strKey) const;
+
   CStdStringW m_sortLabel;    // text for sorting. Need to be UTF16 for proper sorting
   CStdString m_strLabel;      // text of column1
 };
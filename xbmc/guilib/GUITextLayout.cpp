@@ -581,6 +581,15 @@ float CGUITextLayout::GetTextWidth(const CStdStringW &text) const
   return m_font->GetTextWidth(utf32);
 }
 
+void CGUITextLayout::Prewarm(CGUIFont *font, const std::vector<CStdString> &strings)
+{
+  if (!font) return;
+  vecText utf32;
+  for (std::vector<CStdString>::const_iterator i = strings.begin(); i != strings.end(); ++i)
+    AppendToUTF32(*i, (font->GetStyle() & 3) << 24, utf32);
+  font->Prewarm(utf32);
+}
+
 void CGUITextLayout::DrawText(CGUIFont *font, float x, float y, color_t color, color_t shadowColor, const CStdString &text, uint32_t align)
 {
   if (!font) return;
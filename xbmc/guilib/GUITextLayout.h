@@ -100,6 +100,14 @@ public:
   static void DrawText(CGUIFont *font, float x, float y, color_t color, color_t shadowColor, const CStdString &text, uint32_t align);
   static void Filter(CStdString &text);
 
+  /*! \brief Render the glyphs of a set of strings ahead of their first use
+   Saves the rendering when the strings are first drawn, eg. when scrolling through a list.
+   May be called from a background thread, as long as the font stays loaded.
+   \param font the font the strings will be drawn with
+   \param strings the strings, utf8 encoded
+   */
+  static void Prewarm(CGUIFont *font, const std::vector<CStdString> &strings);
+
 protected:
   void ParseText(const CStdStringW &text, vecText &parsedText);
   void LineBreakText(const vecText &text, std::vector<CGUIString> &lines);
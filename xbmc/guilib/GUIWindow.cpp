@@ -28,6 +28,8 @@
 #include "GUIControlGroup.h"
 #include "GUIControlProfiler.h"
 #include "settings/Settings.h"
+#include "settings/AdvancedSettings.h"
+#include "TextureManager.h"
 #ifdef PRE_SKIN_VERSION_9_10_COMPATIBILITY
 #include "GUIEditControl.h"
 #endif
@@ -49,6 +51,22 @@
 
 using namespace std;
 
+// collect the textures referenced by the controls, skipping those only known once the window is shown
+static void GetTextures(const TiXmlElement *element, vector<CStdString> &textures)
+{
+  for (const TiXmlElement *child = element->FirstChildElement(); child; child = child->NextSiblingElement())
+  {
+    if (child->FirstChildElement())
+      GetTextures(child, textures);
+    else if (strstr(child->Value(), "texture") && child->FirstChild())
+    {
+      const char *texture = child->FirstChild()->Value();
+      if (texture[0] && texture[0] != '$')
+        textures.push_back(texture);
+    }
+  }
+}
+
 CGUIWindow::CGUIWindow(int id, const CStdString &xmlFile)
 {
   SetID(id);
@@ -140,6 +158,19 @@ bool CGUIWindow::Load(TiXmlDocument &xmlDoc)
 
   // Resolve any includes that may be present
   g_SkinInfo->ResolveIncludes(pRootElement);
+
+  // have the textures read in while the controls are created
+  if (g_advancedSettings.m_guiPrefetchTextures)
+  {
+    TiXmlElement *pControls = pRootElement->FirstChildElement("controls");
+    if (pControls)
+    {
+      vector<CStdString> textures;
+      GetTextures(pControls, textures);
+      g_TextureManager.PrefetchTextures(textures);
+    }
+  }
+
   // now load in the skin file
   SetDefaults();
 
@@ -156,6 +156,31 @@ void CBaseTexture::ClampToEdge()
   }
 }
 
+unsigned char* CBaseTexture::BeginUpdate(unsigned int width, unsigned int height, unsigned int format, bool hasAlpha)
+{
+  if (format & XB_FMT_DXT_MASK && !g_Windowing.SupportsDXT())
+    return NULL;
+
+  Allocate(width, height, format);
+  if (m_imageWidth != width || m_imageHeight != height)
+    return NULL; // clamped to the max texture size
+
+  m_hasAlpha = hasAlpha;
+  return m_pixels;
+}
+
+void CBaseTexture::EndUpdate()
+{
+  unsigned int srcPitch = GetPitch(m_imageWidth);
+  unsigned int dstPitch = GetPitch(m_textureWidth);
+  if (srcPitch < dstPitch)
+  { // spread the rows out from the bottom up, so none is overwritten before it's moved
+    for (unsigned int y = GetRows(m_imageHeight); y-- > 1; )
+      memmove(m_pixels + y * dstPitch, m_pixels + y * srcPitch, srcPitch);
+  }
+  ClampToEdge();
+}
+
 bool CBaseTexture::LoadFromFile(const CStdString& texturePath, unsigned int maxWidth, unsigned int maxHeight,
                                 bool autoRotate, unsigned int *originalWidth, unsigned int *originalHeight)
 {
@@ -260,7 +285,7 @@ bool CBaseTexture::LoadFromFile(const CStdString& texturePath, unsigned int maxW
   return true;
 }
 
-bool CBaseTexture::LoadFromMemory(unsigned int width, unsigned int height, unsigned int pitch, unsigned int format, bool hasAlpha, unsigned char* pixels)
+bool CBaseTexture::LoadFromMemory(unsigned int width, unsigned int height, unsigned int pitch, unsigned int format, bool hasAlpha, const unsigned char* pixels)
 {
   m_imageWidth = width;
   m_imageHeight = height;
@@ -58,7 +58,7 @@ public:
 
   bool LoadFromFile(const CStdString& texturePath, unsigned int maxHeight = 0, unsigned int maxWidth = 0,
                     bool autoRotate = false, unsigned int *originalWidth = NULL, unsigned int *originalHeight = NULL);
-  bool LoadFromMemory(unsigned int width, unsigned int height, unsigned int pitch, unsigned int format, bool hasAlpha, unsigned char* pixels);
+  bool LoadFromMemory(unsigned int width, unsigned int height, unsigned int pitch, unsigned int format, bool hasAlpha, const unsigned char* pixels);
   bool LoadPaletted(unsigned int width, unsigned int height, unsigned int pitch, unsigned int format, const unsigned char *pixels, const COLOR *palette);
 
   bool HasAlpha() const;
@@ -78,6 +78,8 @@ public:
   unsigned char* GetPixels() const { return m_pixels; }
   unsigned int GetPitch() const { return GetPitch(m_textureWidth); }
   unsigned int GetRows() const { return GetRows(m_textureHeight); }
+  /*! \brief Number of bytes of an image in the texture's format, with tightly packed rows */
+  unsigned int GetImageSize(unsigned int width, unsigned int height) const { return GetPitch(width) * GetRows(height); }
   unsigned int GetTextureWidth() const { return m_textureWidth; }
   unsigned int GetTextureHeight() const { return m_textureHeight; }
   unsigned int GetWidth() const { return m_imageWidth; }
@@ -88,6 +90,17 @@ public:
   void Allocate(unsigned int width, unsigned int height, unsigned int format);
   void ClampToEdge();
 
+  /*! \brief Allocate the texture for the caller to fill in its pixels directly
+   Rows are to be written tightly packed, GetPitch(width) bytes apart. EndUpdate() must be called once done.
+   \return buffer of at least GetPitch(width) * GetRows(height) bytes, NULL if the image can't be stored
+           as is (unsupported format or larger than the max texture size), in which case use LoadFromMemory()
+   */
+  unsigned char* BeginUpdate(unsigned int width, unsigned int height, unsigned int format, bool hasAlpha);
+
+  /*! \brief Finish an update started with BeginUpdate(), laying out rows at the texture pitch
+   */
+  void EndUpdate();
+
   static unsigned int PadPow2(unsigned int x);
   bool SwapBlueRed(unsigned char *pixels, unsigned int height, unsigned int pitch, unsigned int elements = 4, unsigned int offset=0);
 
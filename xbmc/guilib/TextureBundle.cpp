@@ -104,6 +104,14 @@ int CTextureBundle::LoadAnim(const CStdString& Filename, CBaseTexture*** ppTextu
   }
 }
 
+void CTextureBundle::PrefetchTextures(const std::vector<CStdString>& textures)
+{
+  if (m_useXBT)
+  {
+    m_tbXBT.PrefetchTextures(textures);
+  }
+}
+
 void CTextureBundle::Cleanup()
 {
   m_tbXBT.Cleanup();
@@ -193,11 +193,51 @@ int CTextureBundleXBT::LoadAnim(const CStdString& Filename, CBaseTexture*** ppTe
 
 bool CTextureBundleXBT::ConvertFrameToTexture(const CStdString& name, CXBTFFrame& frame, CBaseTexture** ppTexture)
 {
+  // the pixels are copied and unpacked as is, so the frame must hold exactly what its size and format need
+  CBaseTexture *texture = new CTexture(0, 0, frame.GetFormat());
+  uint64_t size = texture->GetImageSize(frame.GetWidth(), frame.GetHeight());
+  if (frame.GetUnpackedSize() != size || (!frame.IsPacked() && frame.GetPackedSize() < size))
+  {
+    CLog::Log(LOGERROR, "Error loading texture: %s: Invalid frame size (%"PRIu64" bytes, need %"PRIu64")", name.c_str(), frame.GetUnpackedSize(), size);
+    delete texture;
+    return false;
+  }
+
+  const unsigned char *mapped = m_XBTFReader.GetData(frame);
+  if (mapped)
+  {
+    if (!frame.IsPacked())
+    { // upload straight from the bundle
+      texture->LoadFromMemory(frame.GetWidth(), frame.GetHeight(), 0, frame.GetFormat(), frame.HasAlpha(), mapped);
+      *ppTexture = texture;
+      return true;
+    }
+
+    // unpack straight into the texture
+    unsigned char *pixels = texture->BeginUpdate(frame.GetWidth(), frame.GetHeight(), frame.GetFormat(), frame.HasAlpha());
+    if (pixels)
+    {
+      lzo_uint s = (lzo_uint)size;
+      if (lzo1x_decompress_safe(mapped, (lzo_uint)frame.GetPackedSize(), pixels, &s, NULL) != LZO_E_OK ||
+          s != size)
+      {
+        CLog::Log(LOGERROR, "Error loading texture: %s: Decompression error", name.c_str());
+        delete texture;
+        return false;
+      }
+      texture->EndUpdate();
+      *ppTexture = texture;
+      return true;
+    }
+    // the texture can't take the frame as is, so unpack it into a buffer first
+  }
+
   // found texture - allocate the necessary buffers
   squish::u8 *buffer = new squish::u8[(size_t)frame.GetPackedSize()];
   if (buffer == NULL)
   {
     CLog::Log(LOGERROR, "Out of memory loading texture: %s (need %"PRIu64" bytes)", name.c_str(), frame.GetPackedSize());
+    delete texture;
     return false;
   }
 
@@ -206,26 +246,29 @@ bool CTextureBundleXBT::ConvertFrameToTexture(const CStdString& name, CXBTFFrame
   {
     CLog::Log(LOGERROR, "Error loading texture: %s", name.c_str());
     delete[] buffer;
+    delete texture;
     return false;
   }
 
   // check if it's packed with lzo
   if (frame.IsPacked())
   { // unpack
-    squish::u8 *unpacked = new squish::u8[(size_t)frame.GetUnpackedSize()];
+    squish::u8 *unpacked = new squish::u8[(size_t)size];
     if (unpacked == NULL)
     {
-      CLog::Log(LOGERROR, "Out of memory unpacking texture: %s (need %"PRIu64" bytes)", name.c_str(), frame.GetUnpackedSize());
+      CLog::Log(LOGERROR, "Out of memory unpacking texture: %s (need %"PRIu64" bytes)", name.c_str(), size);
       delete[] buffer;
+      delete texture;
       return false;
     }
-    lzo_uint s = (lzo_uint)frame.GetUnpackedSize();
-    if (lzo1x_decompress(buffer, (lzo_uint)frame.GetPackedSize(), unpacked, &s, NULL) != LZO_E_OK ||
-        s != frame.GetUnpackedSize())
+    lzo_uint s = (lzo_uint)size;
+    if (lzo1x_decompress_safe(buffer, (lzo_uint)frame.GetPackedSize(), unpacked, &s, NULL) != LZO_E_OK ||
+        s != size)
     {
       CLog::Log(LOGERROR, "Error loading texture: %s: Decompression error", name.c_str());
       delete[] buffer;
       delete[] unpacked;
+      delete texture;
       return false;
     }
     delete[] buffer;
@@ -233,14 +276,31 @@ bool CTextureBundleXBT::ConvertFrameToTexture(const CStdString& name, CXBTFFrame
   }
 
   // create an xbmc texture
-  *ppTexture = new CTexture();
-  (*ppTexture)->LoadFromMemory(frame.GetWidth(), frame.GetHeight(), 0, frame.GetFormat(), frame.HasAlpha(), buffer);
+  texture->LoadFromMemory(frame.GetWidth(), frame.GetHeight(), 0, frame.GetFormat(), frame.HasAlpha(), buffer);
+  *ppTexture = texture;
 
   delete[] buffer;
 
   return true;
 }
 
+void CTextureBundleXBT::PrefetchTextures(const std::vector<CStdString>& textures)
+{
+  if (!m_XBTFReader.IsOpen())
+    return;
+
+  for (std::vector<CStdString>::const_iterator i = textures.begin(); i != textures.end(); ++i)
+  {
+    CXBTFFile* file = m_XBTFReader.Find(Normalize(*i));
+    if (!file)
+      continue;
+
+    std::vector<CXBTFFrame>& frames = file->GetFrames();
+    for (size_t j = 0; j < frames.size(); j++)
+      m_XBTFReader.Prefetch(frames[j]);
+  }
+}
+
 void CTextureBundleXBT::Cleanup()
 {
   if (m_XBTFReader.IsOpen())
@@ -45,6 +45,11 @@ public:
   int LoadAnim(const CStdString& Filename, CBaseTexture*** ppTextures,
                 int &width, int &height, int& nLoops, int** ppDelays);
 
+  /*! \brief Hint that textures will be loaded soon, so their data can be read in ahead of time
+   \param textures the texture names, as passed to LoadTexture()
+   */
+  void PrefetchTextures(const std::vector<CStdString>& textures);
+
 private:
   bool OpenBundle();
   bool ConvertFrameToTexture(const CStdString& name, CXBTFFrame& frame, CBaseTexture** ppTexture);
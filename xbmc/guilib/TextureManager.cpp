@@ -578,3 +578,9 @@ void CGUITextureManager::GetBundledTexturesFromPath(const CStdString& texturePat
   if (items.empty())
     m_TexBundle[1].GetTexturesFromPath(texturePath, items);
 }
+
+void CGUITextureManager::PrefetchTextures(const std::vector<CStdString>& textures)
+{
+  m_TexBundle[0].PrefetchTextures(textures);
+  m_TexBundle[1].PrefetchTextures(textures);
+}
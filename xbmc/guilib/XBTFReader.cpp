@@ -25,6 +25,10 @@
 #include "utils/CharsetConverter.h"
 #ifdef _WIN32
 #include "FileSystem/SpecialProtocol.h"
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
 #endif
 
 #include <string.h>
@@ -47,6 +51,9 @@
 CXBTFReader::CXBTFReader()
 {
   m_file = NULL;
+  m_mapped = NULL;
+  m_mappedSize = 0;
+  m_mapping = NULL;
 }
 
 bool CXBTFReader::IsOpen() const
@@ -136,11 +143,64 @@ bool CXBTFReader::Open(const CStdString& fileName)
     return false;
   }
 
+  // frames are read from the file if the bundle can't be mapped
+  Map();
+
+  return true;
+}
+
+bool CXBTFReader::Map()
+{
+  struct stat fileStat;
+  if (fstat(fileno(m_file), &fileStat) == -1 || fileStat.st_size <= 0)
+    return false;
+
+  // we can't map more than the address space
+  if ((uint64_t)fileStat.st_size != (uint64_t)(size_t)fileStat.st_size)
+    return false;
+
+#ifdef _WIN32
+  HANDLE mapping = CreateFileMapping((HANDLE)_get_osfhandle(_fileno(m_file)), NULL, PAGE_READONLY, 0, 0, NULL);
+  if (mapping == NULL)
+    return false;
+  void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (view == NULL)
+  {
+    CloseHandle(mapping);
+    return false;
+  }
+  m_mapping = mapping;
+#else
+  void *view = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_SHARED, fileno(m_file), 0);
+  if (view == MAP_FAILED)
+    return false;
+#endif
+
+  m_mapped = (unsigned char *)view;
+  m_mappedSize = fileStat.st_size;
   return true;
 }
 
+void CXBTFReader::Unmap()
+{
+  if (!m_mapped)
+    return;
+
+#ifdef _WIN32
+  UnmapViewOfFile(m_mapped);
+  CloseHandle((HANDLE)m_mapping);
+  m_mapping = NULL;
+#else
+  munmap(m_mapped, (size_t)m_mappedSize);
+#endif
+  m_mapped = NULL;
+  m_mappedSize = 0;
+}
+
 void CXBTFReader::Close()
 {
+  Unmap();
+
   if (m_file)
   {
     fclose(m_file);
@@ -189,6 +249,16 @@ bool CXBTFReader::Load(const CXBTFFrame& frame, unsigned char* buffer)
   {
     return false;
   }
+
+  if (m_mapped)
+  {
+    const unsigned char *data = GetData(frame);
+    if (!data)
+      return false;
+    memcpy(buffer, data, (size_t)frame.GetPackedSize());
+    return true;
+  }
+
 #if defined(__APPLE__) || defined(__FreeBSD__)
     if (fseeko(m_file, (off_t)frame.GetOffset(), SEEK_SET) == -1)
 #else
@@ -206,6 +276,32 @@ bool CXBTFReader::Load(const CXBTFFrame& frame, unsigned char* buffer)
   return true;
 }
 
+const unsigned char* CXBTFReader::GetData(const CXBTFFrame& frame) const
+{
+  if (!m_mapped)
+    return NULL;
+
+  // don't trust the header to stay within the file
+  if (frame.GetOffset() > m_mappedSize || frame.GetPackedSize() > m_mappedSize - frame.GetOffset())
+    return NULL;
+
+  return m_mapped + frame.GetOffset();
+}
+
+void CXBTFReader::Prefetch(const CXBTFFrame& frame) const
+{
+#ifndef _WIN32
+  if (!GetData(frame) || frame.GetPackedSize() == 0)
+    return;
+
+  // madvise wants a page aligned start
+  uint64_t pageSize = sysconf(_SC_PAGESIZE);
+  uint64_t start = frame.GetOffset() - frame.GetOffset() % pageSize;
+  uint64_t end = frame.GetOffset() + frame.GetPackedSize();
+  madvise(m_mapped + start, (size_t)(end - start), MADV_WILLNEED);
+#endif
+}
+
 std::vector<CXBTFFile>& CXBTFReader::GetFiles()
 {
   return m_xbtf.GetFiles();
@@ -27,6 +27,13 @@
 #include "utils/StdString.h"
 #include "XBTF.h"
 
+/*!
+ \brief Reader for XBTF texture bundles
+
+ The bundle is mapped into memory after its header has been read, so frames can be
+ handed out as views into the mapping rather than copied.  If the mapping fails the
+ reader falls back to reading frames from the file.
+ */
 class CXBTFReader
 {
 public:
@@ -38,12 +45,30 @@ public:
   bool Exists(const CStdString& name);
   CXBTFFile* Find(const CStdString& name);
   bool Load(const CXBTFFrame& frame, unsigned char* buffer);
+
+  /*! \brief Get a frame's (packed) data straight from the mapped bundle
+   \param frame the frame to get the data of
+   \return pointer to GetPackedSize() bytes, valid until Close(), NULL if the bundle isn't mapped
+   */
+  const unsigned char* GetData(const CXBTFFrame& frame) const;
+
+  /*! \brief Hint that a frame will be needed soon, so the kernel can start reading it in
+   \param frame the frame to prefetch
+   */
+  void Prefetch(const CXBTFFrame& frame) const;
+
   std::vector<CXBTFFile>&  GetFiles();
 
 private:
+  bool Map();
+  void Unmap();
+
   CXBTF      m_xbtf;
   CStdString m_fileName;
   FILE*      m_file;
+  unsigned char* m_mapped;
+  uint64_t   m_mappedSize;
+  void*      m_mapping; // file mapping handle on win32
   std::map<CStdString, CXBTFFile> m_filesMap;
 };
 
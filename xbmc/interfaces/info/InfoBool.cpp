@@ -20,7 +20,6 @@
  */
 
 #include "InfoBool.h"
-#include <stack>
 #include "utils/log.h"
 #include "GUIInfoManager.h"
 
@@ -31,6 +30,7 @@ InfoSingle::InfoSingle(const CStdString &expression, int context)
 : InfoBool(expression, context)
 {
   m_condition = g_infoManager.TranslateSingleString(expression);
+  m_dependencies = g_infoManager.GetDependencies(m_condition);
 }
 
 void InfoSingle::Update(const CGUIListItem *item)
@@ -41,147 +41,39 @@ void InfoSingle::Update(const CGUIListItem *item)
 InfoExpression::InfoExpression(const CStdString &expression, int context)
 : InfoBool(expression, context)
 {
+  m_dependencies = 0;
   Parse(expression);
 }
 
 void InfoExpression::Update(const CGUIListItem *item)
 {
-  Evaluate(item, m_value);
+  m_value = m_program.Run(*this, item);
 }
 
-#define OPERATOR_LB   5
-#define OPERATOR_RB   4
-#define OPERATOR_NOT  3
-#define OPERATOR_AND  2
-#define OPERATOR_OR   1
-
-short InfoExpression::GetOperator(const char ch) const
+bool InfoExpression::GetOperand(unsigned int operand, const CGUIListItem *item)
 {
-  if (ch == '[')
-    return OPERATOR_LB;
-  else if (ch == ']')
-    return OPERATOR_RB;
-  else if (ch == '!')
-    return OPERATOR_NOT;
-  else if (ch == '+')
-    return OPERATOR_AND;
-  else if (ch == '|')
-    return OPERATOR_OR;
-  else
-    return 0;
+  return g_infoManager.GetBoolValue(m_operands[operand], item);
 }
 
 void InfoExpression::Parse(const CStdString &expression)
 {
-  stack<char> operators;
-  CStdString operand;
-  for (unsigned int i = 0; i < expression.size(); i++)
-  {
-    if (GetOperator(expression[i]))
-    {
-      // cleanup any operand, translate and put into our expression list
-      if (!operand.IsEmpty())
-      {
-        unsigned int info = g_infoManager.Register(operand, m_context);
-        if (info)
-        {
-          m_postfix.push_back(m_operands.size());
-          m_operands.push_back(info);
-        }
-        operand.clear();
-      }
-      // handle closing parenthesis
-      if (expression[i] == ']')
-      {
-        while (operators.size())
-        {
-          char oper = operators.top();
-          operators.pop();
-
-          if (oper == '[')
-            break;
-
-          m_postfix.push_back(-GetOperator(oper)); // negative denotes operator
-        }
-      }
-      else
-      {
-        // all other operators we pop off the stack any operator
-        // that has a higher priority than the one we have.
-        while (!operators.empty() && GetOperator(operators.top()) > GetOperator(expression[i]))
-        {
-          // only handle parenthesis once they're closed.
-          if (operators.top() == '[' && expression[i] != ']')
-            break;
+  vector<short> postfix;
+  vector<CStdString> operands;
+  InfoProgram::Parse(expression, postfix, operands);
 
-          m_postfix.push_back(-GetOperator(operators.top()));  // negative denotes operator
-          operators.pop();
-        }
-        operators.push(expression[i]);
-      }
-    }
-    else
-    {
-      operand += expression[i];
-    }
-  }
-
-  if (!operand.empty())
+  // register the operands, those that can never change are folded into the program
+  vector<int> constants;
+  for (unsigned int i = 0; i < operands.size(); i++)
   {
-    unsigned int info = g_infoManager.Register(operand, m_context);
-    if (info)
-    {
-      m_postfix.push_back(m_operands.size());
-      m_operands.push_back(info);
-    }
+    unsigned int info = g_infoManager.Register(operands[i], m_context);
+    unsigned int dependencies = g_infoManager.GetBoolDependencies(info);
+    m_operands.push_back(info);
+    constants.push_back(dependencies ? -1 : (g_infoManager.GetBoolValue(info) ? 1 : 0));
+    m_dependencies |= dependencies;
   }
 
-  // finish up by adding any operators
-  while (!operators.empty())
-  {
-    m_postfix.push_back(-GetOperator(operators.top()));  // negative denotes operator
-    operators.pop();
-  }
-
-  // test evaluate
-  bool test;
-  if (!Evaluate(NULL, test))
+  if (!m_program.Compile(postfix, constants))
     CLog::Log(LOGERROR, "Error evaluating boolean expression %s", expression.c_str());
+  if (m_program.IsConstant())
+    m_dependencies = 0;
 }
-
-bool InfoExpression::Evaluate(const CGUIListItem *item, bool &result)
-{
-  stack<bool> save;
-  for (vector<short>::const_iterator it = m_postfix.begin(); it != m_postfix.end(); ++it)
-  {
-    short expr = *it;
-    if (expr == -OPERATOR_NOT)
-    { // NOT the top item on the stack
-      if (save.size() < 1) return false;
-      bool expr = save.top();
-      save.pop();
-      save.push(!expr);
-    }
-    else if (expr == -OPERATOR_AND)
-    { // AND the top two items on the stack
-      if (save.size() < 2) return false;
-      bool right = save.top(); save.pop();
-      bool left = save.top(); save.pop();
-      save.push(left && right);
-    }
-    else if (expr == -OPERATOR_OR)
-    { // OR the top two items on the stack
-      if (save.size() < 2) return false;
-      bool right = save.top(); save.pop();
-      bool left = save.top(); save.pop();
-      save.push(left || right);
-    }
-    else  // operand
-      save.push(g_infoManager.GetBoolValue(m_operands[expr], item));
-  }
-  if (save.size() != 1)
-    return false;
-  result = save.top();
-  return true;
-}
-
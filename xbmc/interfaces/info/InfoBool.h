@@ -24,6 +24,7 @@
 #include <vector>
 #include <map>
 #include "utils/StdString.h"
+#include "InfoProgram.h"
 
 class CGUIListItem;
 
@@ -39,6 +40,7 @@ public:
   InfoBool(const CStdString &expression, int context)
     : m_value(false),
       m_context(context),
+      m_dependencies(1 << 0), // INFOBOOL_DEPENDS_FRAME
       m_expression(expression),
       m_lastUpdate(0)
   {
@@ -48,14 +50,17 @@ public:
 
   /*! \brief Get the value of this info bool
    This is called to update (if necessary) and fetch the value of the info bool
-   \param time current time (used to test if we need to update yet)
+   \param time time of the last change to anything this bool depends on (used to test if we need to update yet)
    \param item the item used to evaluate the bool
    */
   inline bool Get(unsigned int time, const CGUIListItem *item = NULL)
   {
     if (item)
+    {
       Update(item);
-    else if (time - m_lastUpdate > 0)
+      m_lastUpdate = 0; // the value belongs to the item, so don't hand it out uncached
+    }
+    else if (IsDirty(time))
     {
       Update(NULL);
       m_lastUpdate = time;
@@ -63,12 +68,22 @@ public:
     return m_value;
   }
 
+  /*! \brief Whether Get needs to update the value of this info bool
+   \param time time of the last change to anything this bool depends on
+   */
+  inline bool IsDirty(unsigned int time) const { return time != m_lastUpdate; }
+
   bool operator==(const InfoBool &right) const
   {
     return (m_context == right.m_context && 
             m_expression.CompareNoCase(right.m_expression) == 0);
   }
 
+  /*! \brief Sources of change this info bool depends on
+   \return a mask of (1 << INFOBOOL_DEPENDS_*) bits
+   */
+  unsigned int GetDependencies() const { return m_dependencies; };
+
   /*! \brief Update the value of this info bool
    This is called if and only if the info bool is dirty, allowing it to update it's current value
    */
@@ -78,6 +93,7 @@ protected:
 
   bool m_value;                ///< current value
   int m_context;               ///< contextual information to go with the condition
+  unsigned int m_dependencies; ///< sources of change we depend on, re-evaluated every frame by default
 
 private:
   CStdString m_expression;     ///< original expression
@@ -106,12 +122,14 @@ public:
   virtual ~InfoExpression() {};
 
   virtual void Update(const CGUIListItem *item);
+
+  /*! \brief Value of one of the operands, called back from the program
+   */
+  bool GetOperand(unsigned int operand, const CGUIListItem *item);
 private:
   void Parse(const CStdString &expression);
-  bool Evaluate(const CGUIListItem *item, bool &result);
-  short GetOperator(const char ch) const;
 
-  std::vector<short> m_postfix;         ///< the postfix form of the expression (operators and operand indicies)
+  InfoProgram m_program;                ///< the compiled expression
   std::vector<unsigned int> m_operands; ///< the operands in the expression
 };
 
@@ -0,0 +1,261 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "InfoProgram.h"
+#include <stack>
+
+using namespace std;
+using namespace INFO;
+
+static short GetOperator(const char ch)
+{
+  if (ch == '[')
+    return OPERATOR_LB;
+  else if (ch == ']')
+    return OPERATOR_RB;
+  else if (ch == '!')
+    return OPERATOR_NOT;
+  else if (ch == '+')
+    return OPERATOR_AND;
+  else if (ch == '|')
+    return OPERATOR_OR;
+  else
+    return 0;
+}
+
+static void AddOperand(CStdString &operand, vector<short> &postfix, vector<CStdString> &operands)
+{
+  operand.TrimLeft(" \t\r\n");
+  operand.TrimRight(" \t\r\n");
+  if (!operand.IsEmpty())
+  {
+    postfix.push_back(operands.size());
+    operands.push_back(operand);
+  }
+  operand.clear();
+}
+
+void InfoProgram::Parse(const CStdString &expression, vector<short> &postfix, vector<CStdString> &operands)
+{
+  stack<char> operators;
+  CStdString operand;
+  for (unsigned int i = 0; i < expression.size(); i++)
+  {
+    if (GetOperator(expression[i]))
+    {
+      // cleanup any operand and put into our expression list
+      AddOperand(operand, postfix, operands);
+      // handle closing parenthesis
+      if (expression[i] == ']')
+      {
+        while (operators.size())
+        {
+          char oper = operators.top();
+          operators.pop();
+
+          if (oper == '[')
+            break;
+
+          postfix.push_back(-GetOperator(oper)); // negative denotes operator
+        }
+      }
+      else
+      {
+        // all other operators we pop off the stack any operator
+        // that has a higher priority than the one we have.
+        while (!operators.empty() && GetOperator(operators.top()) > GetOperator(expression[i]))
+        {
+          // only handle parenthesis once they're closed.
+          if (operators.top() == '[' && expression[i] != ']')
+            break;
+
+          postfix.push_back(-GetOperator(operators.top()));  // negative denotes operator
+          operators.pop();
+        }
+        operators.push(expression[i]);
+      }
+    }
+    else
+    {
+      operand += expression[i];
+    }
+  }
+
+  AddOperand(operand, postfix, operands);
+
+  // finish up by adding any operators
+  while (!operators.empty())
+  {
+    postfix.push_back(-GetOperator(operators.top()));  // negative denotes operator
+    operators.pop();
+  }
+}
+
+bool InfoProgram::Compile(const vector<short> &postfix, const vector<int> &constants)
+{
+  m_code.clear();
+
+  // build the expression tree
+  vector<Node> nodes;
+  stack<int> save;
+  for (vector<short>::const_iterator it = postfix.begin(); it != postfix.end(); ++it)
+  {
+    short expr = *it;
+    Node node;
+    node.left = node.right = -1;
+    node.value = 0;
+    if (expr == -OPERATOR_NOT)
+    {
+      if (save.size() < 1) return false;
+      node.type = OP_NOT;
+      node.left = save.top(); save.pop();
+    }
+    else if (expr == -OPERATOR_AND || expr == -OPERATOR_OR)
+    {
+      if (save.size() < 2) return false;
+      node.type = (expr == -OPERATOR_AND) ? OP_JUMP_IF_FALSE : OP_JUMP_IF_TRUE;
+      node.right = save.top(); save.pop();
+      node.left = save.top(); save.pop();
+    }
+    else if (expr >= 0)
+    {
+      if ((unsigned int)expr < constants.size() && constants[expr] >= 0)
+      {
+        node.type = OP_CONST;
+        node.value = constants[expr] ? 1 : 0;
+      }
+      else
+      {
+        node.type = OP_LOAD;
+        node.value = expr;
+      }
+    }
+    else // unbalanced parenthesis
+      return false;
+    nodes.push_back(node);
+    save.push(nodes.size() - 1);
+  }
+  if (save.size() != 1)
+    return false;
+
+  Emit(nodes, Fold(nodes, save.top()));
+  ThreadJumps();
+  return true;
+}
+
+int InfoProgram::Fold(vector<Node> &nodes, int node) const
+{
+  // every node has a single parent, so children may be rewritten in place
+  if (nodes[node].type == OP_NOT)
+  {
+    int child = Fold(nodes, nodes[node].left);
+    Node &c = nodes[child];
+    if (c.type == OP_CONST)
+    {
+      c.value = !c.value;
+      return child;
+    }
+    if (c.type == OP_LOAD || c.type == OP_LOAD_NOT)
+    {
+      c.type = (c.type == OP_LOAD) ? OP_LOAD_NOT : OP_LOAD;
+      return child;
+    }
+    if (c.type == OP_NOT)
+      return c.left;
+    nodes[node].left = child;
+  }
+  else if (nodes[node].type == OP_JUMP_IF_FALSE || nodes[node].type == OP_JUMP_IF_TRUE)
+  {
+    // true is the neutral element of AND, false that of OR
+    bool neutral = nodes[node].type == OP_JUMP_IF_FALSE;
+    int left = Fold(nodes, nodes[node].left);
+    int right = Fold(nodes, nodes[node].right);
+    if (nodes[left].type == OP_CONST)
+      return (nodes[left].value != 0) == neutral ? right : left;
+    if (nodes[right].type == OP_CONST)
+      return (nodes[right].value != 0) == neutral ? left : right;
+    nodes[node].left = left;
+    nodes[node].right = right;
+  }
+  return node;
+}
+
+void InfoProgram::Emit(const vector<Node> &nodes, int node)
+{
+  const Node &n = nodes[node];
+  switch (n.type)
+  {
+  case OP_NOT:
+    Emit(nodes, n.left);
+    m_code.push_back(OP_NOT);
+    break;
+  case OP_JUMP_IF_FALSE:
+  case OP_JUMP_IF_TRUE:
+    {
+      // skip the right hand side once the left hand side decides the result
+      Emit(nodes, n.left);
+      unsigned int jump = m_code.size();
+      m_code.push_back(n.type);
+      Emit(nodes, n.right);
+      m_code[jump] = n.type | (m_code.size() << OP_BITS);
+    }
+    break;
+  default:
+    m_code.push_back(n.type | (n.value << OP_BITS));
+    break;
+  }
+}
+
+void InfoProgram::ThreadJumps()
+{
+  // a jump landing on another jump can go straight to where that one ends up, as the
+  // value is unchanged: a jump of the same kind is taken, one of the other kind is not.
+  // jumps only go forward, so this terminates.
+  for (unsigned int i = 0; i < m_code.size(); i++)
+  {
+    unsigned int op = m_code[i] & OP_MASK;
+    if (op != OP_JUMP_IF_FALSE && op != OP_JUMP_IF_TRUE)
+      continue;
+    unsigned int target = m_code[i] >> OP_BITS;
+    while (target < m_code.size())
+    {
+      unsigned int next = m_code[target] & OP_MASK;
+      if (next == op)
+        target = m_code[target] >> OP_BITS;
+      else if (next == OP_JUMP_IF_FALSE || next == OP_JUMP_IF_TRUE)
+        target++;
+      else
+        break;
+    }
+    m_code[i] = op | (target << OP_BITS);
+  }
+}
+
+bool InfoProgram::IsConstant() const
+{
+  for (vector<unsigned int>::const_iterator it = m_code.begin(); it != m_code.end(); ++it)
+  {
+    unsigned int op = *it & OP_MASK;
+    if (op == OP_LOAD || op == OP_LOAD_NOT)
+      return false;
+  }
+  return true;
+}
@@ -0,0 +1,141 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include "utils/StdString.h"
+
+class CGUIListItem;
+
+// operators in the postfix form of an expression, stored negated
+#define OPERATOR_LB   5
+#define OPERATOR_RB   4
+#define OPERATOR_NOT  3
+#define OPERATOR_AND  2
+#define OPERATOR_OR   1
+
+namespace INFO
+{
+/*!
+ \ingroup info
+ \brief A boolean expression compiled to a flat list of instructions
+
+ The program works on a single accumulator.  Operands are loaded into it, AND and OR
+ become conditional jumps over their right hand side, so evaluation short circuits and
+ needs no stack.  Operands known to be constant at compile time are folded away.
+ */
+class InfoProgram
+{
+public:
+  InfoProgram() {};
+
+  /*! \brief Split an expression into its postfix form
+   \param expression the expression, with operators [ ] ! + |
+   \param postfix the resulting postfix form, operands as indices into operands, operators negated
+   \param operands the resulting operand strings, trimmed and in order of appearance
+   */
+  static void Parse(const CStdString &expression, std::vector<short> &postfix, std::vector<CStdString> &operands);
+
+  /*! \brief Compile the postfix form of an expression
+   \param postfix the postfix form as returned from Parse
+   \param constants per operand, 0 or 1 if the operand has that value for good, -1 otherwise
+   \return false if the expression is malformed, the program then always evaluates to false
+   */
+  bool Compile(const std::vector<short> &postfix, const std::vector<int> &constants);
+
+  /*! \brief Evaluate the program
+   \param operands anything providing bool GetOperand(unsigned int operand, const CGUIListItem *item)
+   \param item the item used to evaluate the operands
+   */
+  template<class T> inline bool Run(T &operands, const CGUIListItem *item) const
+  {
+    bool value = false;
+    unsigned int pc = 0, size = m_code.size();
+    while (pc < size)
+    {
+      unsigned int code = m_code[pc++];
+      switch (code & OP_MASK)
+      {
+      case OP_LOAD:
+        value = operands.GetOperand(code >> OP_BITS, item);
+        break;
+      case OP_LOAD_NOT:
+        value = !operands.GetOperand(code >> OP_BITS, item);
+        break;
+      case OP_NOT:
+        value = !value;
+        break;
+      case OP_CONST:
+        value = (code >> OP_BITS) != 0;
+        break;
+      case OP_JUMP_IF_FALSE:
+        if (!value)
+          pc = code >> OP_BITS;
+        break;
+      case OP_JUMP_IF_TRUE:
+        if (value)
+          pc = code >> OP_BITS;
+        break;
+      }
+    }
+    return value;
+  }
+
+  /*! \brief Whether the program evaluates to the same value without loading any operand
+   */
+  bool IsConstant() const;
+
+  /*! \brief Number of instructions, for diagnostics
+   */
+  unsigned int Size() const { return m_code.size(); };
+
+private:
+  enum OpCode
+  {
+    OP_LOAD = 0,      ///< value = operand
+    OP_LOAD_NOT,      ///< value = !operand
+    OP_NOT,           ///< value = !value
+    OP_CONST,         ///< value = argument
+    OP_JUMP_IF_FALSE, ///< if (!value) continue at argument
+    OP_JUMP_IF_TRUE,  ///< if (value) continue at argument
+    OP_BITS = 3,
+    OP_MASK = (1 << OP_BITS) - 1
+  };
+
+  /*! \brief Node of the expression tree the program is generated from
+   */
+  struct Node
+  {
+    int type;           ///< opcode the node is generated with, OP_JUMP_IF_FALSE for AND and OP_JUMP_IF_TRUE for OR
+    int left;           ///< left hand side or only child, index into the node list
+    int right;          ///< right hand side, index into the node list
+    unsigned int value; ///< operand index or constant
+  };
+
+  int Fold(std::vector<Node> &nodes, int node) const;
+  void Emit(const std::vector<Node> &nodes, int node);
+  void ThreadJumps();
+
+  std::vector<unsigned int> m_code; ///< opcode in the low OP_BITS, argument above
+};
+
+};
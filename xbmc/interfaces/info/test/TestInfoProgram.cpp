@@ -0,0 +1,356 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "interfaces/info/InfoProgram.h"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stack>
+
+using namespace std;
+using namespace INFO;
+
+#define SKIN_PATH "../../../../addons/skin.confluence/720p/"
+
+//=============================================================================
+// Helper classes
+//=============================================================================
+
+// operand values looked up by index, counting the lookups
+class Operands
+{
+public:
+  vector<bool> values;
+  unsigned long loads;
+
+  Operands() : loads(0) {}
+
+  bool GetOperand(unsigned int operand, const CGUIListItem *item)
+  {
+    loads++;
+    return values[operand];
+  }
+};
+
+// the way InfoExpression evaluated the postfix form before it was compiled
+static bool EvaluatePostfix(const vector<short> &postfix, Operands &operands, bool &result)
+{
+  stack<bool> save;
+  for (vector<short>::const_iterator it = postfix.begin(); it != postfix.end(); ++it)
+  {
+    short expr = *it;
+    if (expr == -OPERATOR_NOT)
+    {
+      if (save.size() < 1) return false;
+      bool expr = save.top();
+      save.pop();
+      save.push(!expr);
+    }
+    else if (expr == -OPERATOR_AND)
+    {
+      if (save.size() < 2) return false;
+      bool right = save.top(); save.pop();
+      bool left = save.top(); save.pop();
+      save.push(left && right);
+    }
+    else if (expr == -OPERATOR_OR)
+    {
+      if (save.size() < 2) return false;
+      bool right = save.top(); save.pop();
+      bool left = save.top(); save.pop();
+      save.push(left || right);
+    }
+    else if (expr >= 0)
+      save.push(operands.GetOperand(expr, NULL));
+    else
+      return false;
+  }
+  if (save.size() != 1)
+    return false;
+  result = save.top();
+  return true;
+}
+
+// all visibility conditions and condition attributes of the skin that are expressions
+static void LoadSkinExpressions(vector<CStdString> &expressions)
+{
+  DIR *dir = opendir(SKIN_PATH);
+  if (!dir)
+    return;
+  struct dirent *entry;
+  while ((entry = readdir(dir)))
+  {
+    CStdString name(entry->d_name);
+    if (name.Right(4) != ".xml")
+      continue;
+    FILE *file = fopen((SKIN_PATH + name).c_str(), "r");
+    if (!file)
+      continue;
+    CStdString xml;
+    char buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+      xml.append(buffer, read);
+    fclose(file);
+
+    const char *tags[][2] = { { "<visible>", "<" }, { "condition=\"", "\"" } };
+    for (unsigned int t = 0; t < 2; t++)
+    {
+      size_t pos = 0;
+      while ((pos = xml.find(tags[t][0], pos)) != CStdString::npos)
+      {
+        pos += strlen(tags[t][0]);
+        size_t end = xml.find(tags[t][1], pos);
+        if (end == CStdString::npos)
+          break;
+        CStdString expression = xml.substr(pos, end - pos);
+        // the info manager replaces these before parsing, their brackets aren't operators
+        size_t localize;
+        while ((localize = expression.find("$LOCALIZE[")) != CStdString::npos)
+          expression.erase(localize, expression.find(']', localize) + 1 - localize).insert(localize, "localized");
+        if (expression.find_first_of("|+[]!") != CStdString::npos)
+          expressions.push_back(expression);
+        pos = end;
+      }
+    }
+  }
+  closedir(dir);
+}
+
+// checks the program against the postfix form for every combination of operand values
+static bool CheckEquivalence(const CStdString &expression)
+{
+  vector<short> postfix;
+  vector<CStdString> names;
+  InfoProgram::Parse(expression, postfix, names);
+  InfoProgram program;
+  if (!program.Compile(postfix, vector<int>()))
+    return false;
+
+  Operands operands;
+  operands.values.resize(names.size());
+  unsigned int combinations = names.size() > 12 ? 4096 : 1 << names.size();
+  for (unsigned int c = 0; c < combinations; c++)
+  {
+    for (unsigned int i = 0; i < names.size(); i++)
+      operands.values[i] = names.size() > 12 ? (rand() & 1) : ((c >> i) & 1);
+    bool expected;
+    if (!EvaluatePostfix(postfix, operands, expected) || program.Run(operands, NULL) != expected)
+      return false;
+  }
+  return true;
+}
+
+static double ElapsedMicroseconds(const boost::posix_time::ptime& start)
+{
+  return (double)(boost::posix_time::microsec_clock::universal_time() - start).total_microseconds();
+}
+
+//=============================================================================
+
+BOOST_AUTO_TEST_CASE(TestInfoProgramParse)
+{
+  vector<short> postfix;
+  vector<CStdString> operands;
+  InfoProgram::Parse(" Player.HasVideo + [ Skin.HasSetting(a) | !Window.IsVisible(home) ] ", postfix, operands);
+
+  BOOST_REQUIRE_EQUAL(3u, operands.size());
+  BOOST_CHECK_EQUAL("Player.HasVideo", operands[0]);
+  BOOST_CHECK_EQUAL("Skin.HasSetting(a)", operands[1]);
+  BOOST_CHECK_EQUAL("Window.IsVisible(home)", operands[2]);
+
+  short expected[] = { 0, 1, 2, -OPERATOR_NOT, -OPERATOR_OR, -OPERATOR_AND };
+  BOOST_CHECK_EQUAL_COLLECTIONS(expected, expected + 6, postfix.begin(), postfix.end());
+}
+
+BOOST_AUTO_TEST_CASE(TestInfoProgramEquivalence)
+{
+  const char *expressions[] = {
+    "a + b", "a | b", "!a", "!!a", "![a + b]", "!a + !b | c", "a | b + c", "[a | b] + c",
+    "a + [b | [c + !d]] | !e + f", "[[a]]", "!![a | !b] + c + d | e + [f | g | h]",
+    "a + b + c + d | e + f + g + h | i + j + k + l | m"
+  };
+  for (unsigned int i = 0; i < sizeof(expressions) / sizeof(expressions[0]); i++)
+    BOOST_CHECK_MESSAGE(CheckEquivalence(expressions[i]), expressions[i]);
+
+  vector<CStdString> skin;
+  LoadSkinExpressions(skin);
+  unsigned int failed = 0;
+  for (unsigned int i = 0; i < skin.size(); i++)
+  {
+    if (!CheckEquivalence(skin[i]))
+    {
+      BOOST_TEST_MESSAGE("not equivalent: " << skin[i]);
+      failed++;
+    }
+  }
+  BOOST_CHECK_EQUAL(0u, failed);
+}
+
+BOOST_AUTO_TEST_CASE(TestInfoProgramFolding)
+{
+  vector<short> postfix;
+  vector<CStdString> names;
+  InfoProgram::Parse("System.Platform.Linux + a | !System.Platform.Windows + b", postfix, names);
+  BOOST_REQUIRE_EQUAL(4u, names.size());
+
+  int values[] = { 0, -1, 0, -1 };
+  vector<int> constants(values, values + 4);
+  InfoProgram program;
+  BOOST_REQUIRE(program.Compile(postfix, constants));
+  BOOST_CHECK(!program.IsConstant());
+  BOOST_CHECK_EQUAL(1u, program.Size()); // only b is left
+
+  Operands operands;
+  operands.values.resize(4, true);
+  BOOST_CHECK(program.Run(operands, NULL));
+  BOOST_CHECK_EQUAL(1ul, operands.loads);
+
+  // the whole expression folds away
+  constants[3] = 0;
+  BOOST_REQUIRE(program.Compile(postfix, constants));
+  BOOST_CHECK(program.IsConstant());
+  BOOST_CHECK(!program.Run(operands, NULL));
+  BOOST_CHECK_EQUAL(1ul, operands.loads);
+}
+
+BOOST_AUTO_TEST_CASE(TestInfoProgramShortCircuit)
+{
+  vector<short> postfix;
+  vector<CStdString> names;
+  InfoProgram::Parse("[a + b + c] | [d + e]", postfix, names);
+  InfoProgram program;
+  BOOST_REQUIRE(program.Compile(postfix, vector<int>()));
+
+  Operands operands;
+  operands.values.resize(5, false);
+  BOOST_CHECK(!program.Run(operands, NULL));
+  BOOST_CHECK_EQUAL(2ul, operands.loads); // a and d
+
+  operands.loads = 0;
+  operands.values[0] = operands.values[1] = operands.values[2] = true;
+  BOOST_CHECK(program.Run(operands, NULL));
+  BOOST_CHECK_EQUAL(3ul, operands.loads); // a, b and c
+}
+
+BOOST_AUTO_TEST_CASE(TestInfoProgramMalformed)
+{
+  const char *expressions[] = { "a +", "| a", "[a + b", "!" };
+  for (unsigned int i = 0; i < sizeof(expressions) / sizeof(expressions[0]); i++)
+  {
+    vector<short> postfix;
+    vector<CStdString> names;
+    InfoProgram::Parse(expressions[i], postfix, names);
+    InfoProgram program;
+    BOOST_CHECK_MESSAGE(!program.Compile(postfix, vector<int>()), expressions[i]);
+
+    Operands operands;
+    operands.values.resize(names.size(), true);
+    BOOST_CHECK(!program.Run(operands, NULL));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(BenchmarkSkinExpressions)
+{
+  vector<CStdString> expressions;
+  LoadSkinExpressions(expressions);
+  if (expressions.empty())
+  {
+    BOOST_TEST_MESSAGE("no skin found at " SKIN_PATH ", skipping benchmark");
+    return;
+  }
+
+  // operand values are fixed per expression, platform checks are known at compile time
+  vector< vector<short> > postfixes(expressions.size());
+  vector<InfoProgram> programs(expressions.size());
+  vector<Operands> operands(expressions.size());
+  unsigned long instructions = 0, folded = 0;
+  srand(1);
+  for (unsigned int i = 0; i < expressions.size(); i++)
+  {
+    vector<CStdString> names;
+    InfoProgram::Parse(expressions[i], postfixes[i], names);
+    vector<int> constants;
+    for (unsigned int j = 0; j < names.size(); j++)
+    {
+      operands[i].values.push_back((rand() & 1) != 0);
+      constants.push_back(names[j].Left(16).Equals("system.platform.") ? operands[i].values[j] : -1);
+    }
+    programs[i].Compile(postfixes[i], constants);
+    instructions += programs[i].Size();
+    if (programs[i].IsConstant())
+      folded++;
+  }
+
+  const unsigned int rounds = 2000;
+  unsigned long evaluations = rounds * expressions.size();
+  unsigned long mismatches = 0;
+
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+  for (unsigned int r = 0; r < rounds; r++)
+  {
+    for (unsigned int i = 0; i < expressions.size(); i++)
+    {
+      bool result;
+      EvaluatePostfix(postfixes[i], operands[i], result);
+    }
+  }
+  double postfixTime = ElapsedMicroseconds(start);
+  unsigned long postfixLoads = 0;
+  for (unsigned int i = 0; i < operands.size(); i++)
+  {
+    postfixLoads += operands[i].loads;
+    operands[i].loads = 0;
+  }
+
+  start = boost::posix_time::microsec_clock::universal_time();
+  for (unsigned int r = 0; r < rounds; r++)
+  {
+    for (unsigned int i = 0; i < expressions.size(); i++)
+      programs[i].Run(operands[i], NULL);
+  }
+  double programTime = ElapsedMicroseconds(start);
+  unsigned long programLoads = 0;
+  for (unsigned int i = 0; i < operands.size(); i++)
+    programLoads += operands[i].loads;
+
+  for (unsigned int i = 0; i < operands.size(); i++)
+  {
+    bool expected = false;
+    EvaluatePostfix(postfixes[i], operands[i], expected);
+    if (programs[i].Run(operands[i], NULL) != expected)
+      mismatches++;
+  }
+
+  BOOST_CHECK_EQUAL(0ul, mismatches);
+
+  printf("%u skin expressions, %.1f instructions each, %lu folded to constants\n",
+         (unsigned int)expressions.size(), (double)instructions / expressions.size(), folded);
+  printf("postfix:  %10.0f evaluations/s  %5.2f operands/evaluation\n",
+         evaluations * 1000000.0 / postfixTime, (double)postfixLoads / evaluations);
+  printf("compiled: %10.0f evaluations/s  %5.2f operands/evaluation\n",
+         evaluations * 1000000.0 / programTime, (double)programLoads / evaluations);
+}
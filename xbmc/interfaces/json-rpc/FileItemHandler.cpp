@@ -40,6 +40,40 @@ using namespace MUSIC_INFO;
 using namespace JSONRPC;
 using namespace XFILE;
 
+// serializes the items of a list result one at a time while the response is sent
+class CFileItemHandler::CFileItemListStream : public IStreamedList
+{
+public:
+  CFileItemListStream(const char *ID, bool allowFile, CFileItemList &items, int start, int end, const CVariant &parameterObject)
+    : m_hasID(ID != NULL), m_ID(ID ? ID : ""), m_allowFile(allowFile), m_parameterObject(parameterObject), m_index(0)
+  {
+    for (int i = start; i < end; i++)
+      m_items.push_back(items.Get(i));
+  }
+
+  virtual bool GetNext(CVariant &entry)
+  {
+    if (m_index >= m_items.size())
+      return false;
+
+    // the item is released as soon as it is serialized
+    CFileItemPtr item = m_items[m_index];
+    m_items[m_index++].reset();
+    CVariant result;
+    HandleFileItem(m_hasID ? m_ID.c_str() : NULL, m_allowFile, "entry", item, m_parameterObject, m_parameterObject["properties"], result, false);
+    entry = result["entry"];
+    return true;
+  }
+
+private:
+  bool m_hasID;
+  std::string m_ID;
+  bool m_allowFile;
+  CVariant m_parameterObject;
+  std::vector<CFileItemPtr> m_items;
+  unsigned int m_index;
+};
+
 void CFileItemHandler::FillDetails(ISerializable* info, CFileItemPtr item, const CVariant& fields, CVariant &result)
 {
   if (info == NULL || fields.size() == 0)
@@ -91,7 +125,7 @@ void CFileItemHandler::FillDetails(ISerializable* info, CFileItemPtr item, const
   }
 }
 
-void CFileItemHandler::HandleFileItemList(const char *ID, bool allowFile, const char *resultname, CFileItemList &items, const CVariant &parameterObject, CVariant &result)
+void CFileItemHandler::HandleFileItemList(const char *ID, bool allowFile, const char *resultname, CFileItemList &items, const CVariant &parameterObject, CVariant &result, bool streamed /* = true */)
 {
   int size  = items.Size();
   int start = (int)parameterObject["limits"]["start"].asInteger();
@@ -105,6 +139,15 @@ void CFileItemHandler::HandleFileItemList(const char *ID, bool allowFile, const
   result["limits"]["end"]   = end;
   result["limits"]["total"] = size;
 
+  if (streamed && start < end)
+  {
+    CFileItemListStream *stream = new CFileItemListStream(ID, allowFile, items, start, end, parameterObject);
+    if (CJSONRPC::StreamResult(result, resultname, stream))
+      return;
+
+    delete stream;
+  }
+
   for (int i = start; i < end; i++)
   {
     CVariant object;
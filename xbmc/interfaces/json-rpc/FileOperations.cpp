@@ -154,14 +154,14 @@ JSON_STATUS CFileOperations::GetDirectory(const CStdString &method, ITransportLa
     if (!hasFileField)
       param["properties"].append("file");
 
-    HandleFileItemList("id", true, "files", filteredDirectories, param, result);
+    HandleFileItemList("id", true, "files", filteredDirectories, param, result, false);
     for (unsigned int index = 0; index < result["files"].size(); index++)
     {
       result["files"][index]["filetype"] = "directory";
     }
     int count = (int)result["limits"]["total"].asInteger();
 
-    HandleFileItemList("id", true, "files", filteredFiles, param, result);
+    HandleFileItemList("id", true, "files", filteredFiles, param, result, false);
     for (unsigned int index = count; index < result["files"].size(); index++)
     {
       result["files"][index]["filetype"] = "file";
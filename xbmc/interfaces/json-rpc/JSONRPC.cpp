@@ -25,6 +25,7 @@
 #include "interfaces/AnnouncementUtils.h"
 #include "utils/log.h"
 #include "utils/Variant.h"
+#include "threads/ThreadLocal.h"
 #include <string.h>
 #include "ServiceDescription.h"
 
@@ -34,6 +35,9 @@ using namespace std;
 
 bool CJSONRPC::m_initialized = false;
 
+// the call whose method is being executed on this thread
+static XbmcThreads::ThreadLocal<CJSONRPCResponse::CCall> currentCall;
+
 void CJSONRPC::Initialize()
 {
   if (m_initialized)
@@ -150,11 +154,20 @@ JSON_STATUS CJSONRPC::NotifyAll(const CStdString &method, ITransportLayer *trans
 
 CStdString CJSONRPC::MethodCall(const CStdString &inputString, ITransportLayer *transport, IClient *client)
 {
-  CVariant inputroot, outputroot, result;
-  bool hasResponse = false;
+  CJSONRPCResponse response;
+  MethodCall(inputString, transport, client, response);
+
+  return response.ReadAll();
+}
+
+void CJSONRPC::MethodCall(const CStdString &inputString, ITransportLayer *transport, IClient *client, CJSONRPCResponse &response)
+{
+  // the request only lives as long as this call, the response is copied out of it
+  CVariantArena arena;
+  CVariant inputroot(arena);
 
   CLog::Log(LOGDEBUG, "JSONRPC: Incoming request: %s", inputString.c_str());
-  inputroot = CJSONVariantParser::Parse((unsigned char *)inputString.c_str(), inputString.length());
+  CJSONVariantParser::Parse((unsigned char *)inputString.c_str(), inputString.length(), inputroot);
   if (!inputroot.isNull())
   {
     if (inputroot.isArray())
@@ -162,37 +175,53 @@ CStdString CJSONRPC::MethodCall(const CStdString &inputString, ITransportLayer *
       if (inputroot.size() <= 0)
       {
         CLog::Log(LOGERROR, "JSONRPC: Empty batch call\n");
-        BuildResponse(inputroot, InvalidRequest, CVariant(), outputroot);
-        hasResponse = true;
+        CJSONRPCResponse::CCall *call = new CJSONRPCResponse::CCall();
+        BuildResponse(inputroot, InvalidRequest, CVariant(), call->response);
+        response.m_calls.push_back(call);
       }
       else
       {
+        response.m_batch = true;
         for (CVariant::const_iterator_array itr = inputroot.begin_array(); itr != inputroot.end_array(); itr++)
         {
-          CVariant response;
-          if (HandleMethodCall(*itr, response, transport, client))
-          {
-            outputroot.append(response);
-            hasResponse = true;
-          }
+          CJSONRPCResponse::CCall *call = new CJSONRPCResponse::CCall();
+          if (HandleMethodCall(*itr, *call, transport, client))
+            response.m_calls.push_back(call);
+          else
+            delete call;
         }
       }
     }
     else
-      hasResponse = HandleMethodCall(inputroot, outputroot, transport, client);
+    {
+      CJSONRPCResponse::CCall *call = new CJSONRPCResponse::CCall();
+      if (HandleMethodCall(inputroot, *call, transport, client))
+        response.m_calls.push_back(call);
+      else
+        delete call;
+    }
   }
   else
   {
     CLog::Log(LOGERROR, "JSONRPC: Failed to parse '%s'\n", inputString.c_str());
-    BuildResponse(inputroot, ParseError, CVariant(), outputroot);
-    hasResponse = true;
+    CJSONRPCResponse::CCall *call = new CJSONRPCResponse::CCall();
+    BuildResponse(inputroot, ParseError, CVariant(), call->response);
+    response.m_calls.push_back(call);
   }
+}
+
+bool CJSONRPC::StreamResult(CVariant &result, const std::string &name, IStreamedList *list)
+{
+  CJSONRPCResponse::CCall *call = currentCall.get();
+  if (call == NULL || call->result != &result || call->list != NULL)
+    return false;
 
-  CStdString str = hasResponse ? CJSONVariantWriter::Write(outputroot, g_advancedSettings.m_jsonOutputCompact) : "";
-  return str;
+  call->listName = name;
+  call->list = list;
+  return true;
 }
 
-bool CJSONRPC::HandleMethodCall(const CVariant& request, CVariant& response, ITransportLayer *transport, IClient *client)
+bool CJSONRPC::HandleMethodCall(const CVariant& request, CJSONRPCResponse::CCall& call, ITransportLayer *transport, IClient *client)
 {
   JSON_STATUS errorCode = OK;
   CVariant result;
@@ -210,7 +239,14 @@ bool CJSONRPC::HandleMethodCall(const CVariant& request, CVariant& response, ITr
 
     CLog::Log(LOGDEBUG, "JSONRPC: Calling %s", methodName.c_str());
     if ((errorCode = CJSONServiceDescription::CheckCall(methodName, request["params"], transport, client, isNotification, method, params)) == OK)
+    {
+      CJSONRPCResponse::CCall *previous = currentCall.get();
+      call.result = &result;
+      currentCall.set(&call);
       errorCode = method(methodName, transport, client, params, result);
+      currentCall.set(previous);
+      call.result = NULL;
+    }
     else
       result = params;
   }
@@ -220,7 +256,14 @@ bool CJSONRPC::HandleMethodCall(const CVariant& request, CVariant& response, ITr
     errorCode = InvalidRequest;
   }
 
-  BuildResponse(request, errorCode, result, response);
+  // a streamed list only goes out as part of a successful result
+  if (errorCode != OK || isNotification)
+  {
+    delete call.list;
+    call.list = NULL;
+  }
+
+  BuildResponse(request, errorCode, result, call.response);
 
   return !isNotification;
 }
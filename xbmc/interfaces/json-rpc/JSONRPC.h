@@ -29,6 +29,7 @@
 #include "interfaces/IAnnouncer.h"
 #include "JSONUtils.h"
 #include "JSONServiceDescription.h"
+#include "JSONRPCResponse.h"
 
 namespace JSONRPC
 {
@@ -63,6 +64,32 @@ namespace JSONRPC
      */
     static CStdString MethodCall(const CStdString &inputString, ITransportLayer *transport, IClient *client);
 
+    /*
+     \brief Handles an incoming JSON RPC request
+     \param inputString received JSON RPC request
+     \param transport Transport protocol on which the request arrived
+     \param client Client which sent the request
+     \param response Response to be read and sent back to the client
+
+     Same as above, but the response is only serialized while it is
+     read from the given CJSONRPCResponse.
+     */
+    static void MethodCall(const CStdString &inputString, ITransportLayer *transport, IClient *client, CJSONRPCResponse &response);
+
+    /*
+     \brief Lets a list in the result of the method being called be
+     serialized entry by entry while the response is sent
+     \param result Result object passed to the method
+     \param name Name of the list in the result
+     \param list Entries of the list, owned by the response on success
+     \return False if the list has to be put into the result instead
+
+     Only works for the method's own result object, not for objects
+     nested in it, and only for one list per call. The method must not
+     touch the list's entries in the result after handing them over.
+     */
+    static bool StreamResult(CVariant &result, const std::string &name, IStreamedList *list);
+
     static JSON_STATUS Introspect(const CStdString &method, ITransportLayer *transport, IClient *client, const CVariant& parameterObject, CVariant &result);
     static JSON_STATUS Version(const CStdString &method, ITransportLayer *transport, IClient *client, const CVariant& parameterObject, CVariant &result);
     static JSON_STATUS Permission(const CStdString &method, ITransportLayer *transport, IClient *client, const CVariant& parameterObject, CVariant &result);
@@ -73,7 +100,7 @@ namespace JSONRPC
   
   private:
     static void setup();
-    static bool HandleMethodCall(const CVariant& request, CVariant& response, ITransportLayer *transport, IClient *client);
+    static bool HandleMethodCall(const CVariant& request, CJSONRPCResponse::CCall& call, ITransportLayer *transport, IClient *client);
     static inline bool IsProperJSONRPC(const CVariant& inputroot);
 
     inline static void BuildResponse(const CVariant& request, JSON_STATUS code, const CVariant& result, CVariant& response);
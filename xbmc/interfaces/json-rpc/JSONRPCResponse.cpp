@@ -0,0 +1,139 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "JSONRPCResponse.h"
+#include "settings/AdvancedSettings.h"
+#include "utils/log.h"
+#include <string.h>
+
+#define READ_ALL_CHUNK_SIZE 16384
+
+using namespace JSONRPC;
+using namespace std;
+
+CJSONRPCResponse::CJSONRPCResponse()
+  : m_batch(false), m_writer(g_advancedSettings.m_jsonOutputCompact),
+    m_offset(0), m_started(false), m_done(false), m_call(0), m_inList(false)
+{
+}
+
+CJSONRPCResponse::~CJSONRPCResponse()
+{
+  for (vector<CCall *>::iterator itr = m_calls.begin(); itr != m_calls.end(); itr++)
+    delete *itr;
+}
+
+size_t CJSONRPCResponse::Read(char *buffer, size_t size)
+{
+  size_t length;
+  const char *data = m_writer.GetBuffer(length);
+  while (length - m_offset < size && !m_done)
+  {
+    if (!Produce())
+    {
+      CLog::Log(LOGERROR, "JSONRPC: Failed to serialize the response");
+      m_done = true;
+    }
+    data = m_writer.GetBuffer(length);
+  }
+
+  size_t read = min(size, length - m_offset);
+  memcpy(buffer, data + m_offset, read);
+  m_offset += read;
+
+  if (m_offset == length)
+  {
+    m_writer.Clear();
+    m_offset = 0;
+  }
+
+  return read;
+}
+
+string CJSONRPCResponse::ReadAll()
+{
+  string output;
+  char buffer[READ_ALL_CHUNK_SIZE];
+  size_t read;
+  while ((read = Read(buffer, sizeof(buffer))) > 0)
+    output.append(buffer, read);
+
+  return output;
+}
+
+bool CJSONRPCResponse::Produce()
+{
+  if (!m_started)
+  {
+    m_started = true;
+    if (m_calls.empty())
+    {
+      m_done = true;
+      return true;
+    }
+    if (m_batch)
+      return m_writer.BeginArray();
+  }
+
+  if (m_call >= m_calls.size())
+  {
+    m_done = true;
+    return m_batch ? m_writer.EndArray() : true;
+  }
+
+  CCall *call = m_calls[m_call];
+  if (call->list == NULL)
+  {
+    m_call++;
+    return m_writer.Value(call->response);
+  }
+
+  if (m_inList)
+  {
+    // one entry at a time, the caller decides how much it wants to buffer
+    CVariant entry;
+    if (call->list->GetNext(entry))
+      return m_writer.Value(entry);
+
+    m_inList = false;
+    m_call++;
+    return m_writer.EndArray() && m_writer.EndObject() && m_writer.EndObject();
+  }
+
+  // everything up to the opening bracket of the streamed list
+  bool success = m_writer.BeginObject();
+  for (CVariant::const_iterator_map itr = call->response.begin_map(); itr != call->response.end_map() && success; itr++)
+  {
+    if (itr->first != "result")
+      success = m_writer.Key(itr->first) && m_writer.Value(itr->second);
+  }
+
+  const CVariant &result = call->response["result"];
+  success = success && m_writer.Key("result") && m_writer.BeginObject();
+  for (CVariant::const_iterator_map itr = result.begin_map(); itr != result.end_map() && success; itr++)
+  {
+    if (itr->first != call->listName)
+      success = m_writer.Key(itr->first) && m_writer.Value(itr->second);
+  }
+
+  m_inList = true;
+  return success && m_writer.Key(call->listName) && m_writer.BeginArray();
+}
@@ -0,0 +1,115 @@
+#pragma once
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <string>
+#include <vector>
+#include "utils/Variant.h"
+#include "utils/JSONVariantWriter.h"
+
+namespace JSONRPC
+{
+  /*!
+   \ingroup jsonrpc
+   \brief Entries of a list in a method's result which
+   are only serialized while the response is sent
+   */
+  class IStreamedList
+  {
+  public:
+    virtual ~IStreamedList() { }
+
+    /*!
+     \brief Serializes the next entry of the list
+     \param entry Value to fill with the entry
+     \return False if there are no more entries
+     */
+    virtual bool GetNext(CVariant &entry) = 0;
+  };
+
+  /*!
+   \ingroup jsonrpc
+   \brief Response to a JSON RPC request (or batch of requests)
+
+   The response is serialized as it is read, one entry of a streamed
+   list at a time, so the output only ever holds little more than the
+   amount of data asked for by the transport layer.
+   */
+  class CJSONRPCResponse
+  {
+  public:
+    CJSONRPCResponse();
+    ~CJSONRPCResponse();
+
+    /*!
+     \brief Whether there is nothing to send back,
+     e.g. because all the requests were notifications
+     */
+    bool IsEmpty() const { return m_calls.empty(); }
+
+    /*!
+     \brief Reads the next part of the serialized response
+     \param buffer Buffer to copy the output to
+     \param size Size of the buffer
+     \return Number of bytes copied, 0 once the whole response has been read
+     */
+    size_t Read(char *buffer, size_t size);
+
+    /*!
+     \brief Reads the rest of the serialized response at once
+     */
+    std::string ReadAll();
+
+    /*!
+     \brief Response to a single request in the batch
+     */
+    class CCall
+    {
+    public:
+      CCall() : result(NULL), list(NULL) { }
+      ~CCall() { delete list; }
+
+      CVariant response;     ///< response object, without the streamed list
+      CVariant *result;      ///< the method's result while it is called
+      std::string listName;  ///< name of the streamed list in the result
+      IStreamedList *list;
+    private:
+      CCall(const CCall&);
+      CCall& operator=(const CCall&);
+    };
+
+  protected:
+    friend class CJSONRPC;
+
+    bool Produce();
+
+    std::vector<CCall *> m_calls;
+    bool m_batch;
+
+  private:
+    CJSONStreamWriter m_writer;
+    size_t m_offset;
+    bool m_started;
+    bool m_done;
+    unsigned int m_call;
+    bool m_inList;
+  };
+}
@@ -0,0 +1,176 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "interfaces/json-rpc/JSONRPCResponse.h"
+#include "utils/JSONVariantParser.h"
+
+#include <string>
+
+using namespace JSONRPC;
+
+/*
+ * Lets the test put together the calls the way CJSONRPC does.
+ */
+class CTestJSONRPCResponse : public CJSONRPCResponse
+{
+public:
+  CTestJSONRPCResponse(bool batch = false) { m_batch = batch; }
+
+  CCall *AddCall(int id)
+  {
+    CCall *call = new CCall();
+    call->response["id"] = id;
+    call->response["jsonrpc"] = "2.0";
+    m_calls.push_back(call);
+    return call;
+  }
+};
+
+class CTestList : public IStreamedList
+{
+public:
+  CTestList(int count) : m_next(0), m_count(count) {}
+
+  virtual bool GetNext(CVariant &entry)
+  {
+    if (m_next >= m_count)
+      return false;
+
+    entry["label"] = "entry";
+    entry["index"] = m_next++;
+    return true;
+  }
+
+private:
+  int m_next;
+  int m_count;
+};
+
+/*
+ * Adds a call whose result has "limits" next to a streamed list called "movies".
+ */
+static void AddListCall(CTestJSONRPCResponse &response, int id, int count)
+{
+  CJSONRPCResponse::CCall *call = response.AddCall(id);
+  call->response["result"]["limits"]["total"] = count;
+  call->response["result"]["movies"] = CVariant(CVariant::VariantTypeArray);
+  call->listName = "movies";
+  call->list = new CTestList(count);
+}
+
+static CVariant Parse(const std::string &output)
+{
+  return CJSONVariantParser::Parse((const unsigned char *)output.c_str(), output.size());
+}
+
+static size_t Occurrences(const std::string &output, const std::string &str)
+{
+  size_t count = 0;
+  for (size_t pos = output.find(str); pos != std::string::npos; pos = output.find(str, pos + 1))
+    count++;
+  return count;
+}
+
+static void CheckListCall(const CVariant &call, int id, int count)
+{
+  BOOST_CHECK_EQUAL(call["id"].asInteger(), id);
+  BOOST_CHECK_EQUAL(call["jsonrpc"].asString(), "2.0");
+
+  const CVariant &result = call["result"];
+  BOOST_CHECK_EQUAL(result.size(), 2U);
+  BOOST_CHECK_EQUAL(result["limits"]["total"].asInteger(), count);
+  BOOST_REQUIRE(result["movies"].isArray());
+  BOOST_REQUIRE_EQUAL(result["movies"].size(), (unsigned int)count);
+  for (int i = 0; i < count; i++)
+  {
+    BOOST_CHECK_EQUAL(result["movies"][i]["index"].asInteger(), i);
+    BOOST_CHECK_EQUAL(result["movies"][i]["label"].asString(), "entry");
+  }
+}
+
+BOOST_AUTO_TEST_CASE(TestResponseWithoutList)
+{
+  CTestJSONRPCResponse response;
+  response.AddCall(1)->response["result"] = "OK";
+
+  CVariant output = Parse(response.ReadAll());
+  BOOST_CHECK_EQUAL(output["id"].asInteger(), 1);
+  BOOST_CHECK_EQUAL(output["result"].asString(), "OK");
+  BOOST_CHECK(response.ReadAll().empty());
+}
+
+BOOST_AUTO_TEST_CASE(TestResponseSplicesList)
+{
+  CTestJSONRPCResponse response;
+  AddListCall(response, 7, 3);
+
+  std::string output = response.ReadAll();
+  // the placeholder in the result must not be written as well as the list
+  BOOST_CHECK_EQUAL(Occurrences(output, "\"movies\""), 1U);
+  BOOST_CHECK_EQUAL(Occurrences(output, "\"result\""), 1U);
+  CheckListCall(Parse(output), 7, 3);
+}
+
+BOOST_AUTO_TEST_CASE(TestResponseEmptyList)
+{
+  CTestJSONRPCResponse response;
+  AddListCall(response, 2, 0);
+
+  CheckListCall(Parse(response.ReadAll()), 2, 0);
+}
+
+BOOST_AUTO_TEST_CASE(TestResponseBatch)
+{
+  CTestJSONRPCResponse response(true);
+  AddListCall(response, 1, 2);
+  response.AddCall(2)->response["result"] = "OK";
+  AddListCall(response, 3, 5);
+
+  CVariant output = Parse(response.ReadAll());
+  BOOST_REQUIRE(output.isArray());
+  BOOST_REQUIRE_EQUAL(output.size(), 3U);
+  CheckListCall(output[0], 1, 2);
+  BOOST_CHECK_EQUAL(output[1]["id"].asInteger(), 2);
+  BOOST_CHECK_EQUAL(output[1]["result"].asString(), "OK");
+  CheckListCall(output[2], 3, 5);
+}
+
+BOOST_AUTO_TEST_CASE(TestResponseSmallReads)
+{
+  CTestJSONRPCResponse all, chunked;
+  AddListCall(all, 4, 50);
+  AddListCall(chunked, 4, 50);
+
+  // the transport layer reads a little at a time, which must not change the output
+  std::string output;
+  char buffer[7];
+  size_t read;
+  while ((read = chunked.Read(buffer, sizeof(buffer))) > 0)
+  {
+    BOOST_REQUIRE(read <= sizeof(buffer));
+    output.append(buffer, read);
+  }
+
+  BOOST_CHECK_EQUAL(output, all.ReadAll());
+  CheckListCall(Parse(output), 4, 50);
+}
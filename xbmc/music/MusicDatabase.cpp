@@ -3009,18 +3009,16 @@ bool CMusicDatabase::GetSongsByWhere(const CStdString &baseDir, const CStdString
     // We don't use PrepareSQL here, as the WHERE clause is already formatted.
     CStdString strSQL = "select * from songview " + whereClause;
     CLog::Log(LOGDEBUG, "%s query = %s", __FUNCTION__, strSQL.c_str());
-    // run query
-    if (!m_pDS->query(strSQL.c_str()))
+    // run query, rows are fetched in batches as we go so the whole
+    // result never has to be held in memory next to the items
+    if (!m_pDS->query_streaming(strSQL.c_str()))
       return false;
-    int iRowsFound = m_pDS->num_rows();
-    if (iRowsFound == 0)
+    if (m_pDS->eof())
     {
       m_pDS->close();
       return false;
     }
 
-    // get data from returned rows
-    items.Reserve(items.Size() + iRowsFound);
     // get songs from returned subtable
     int count = 0;
     while (!m_pDS->eof())
@@ -3034,6 +3032,13 @@ bool CMusicDatabase::GetSongsByWhere(const CStdString &baseDir, const CStdString
         items.Add(item);
         m_pDS->next();
       }
+      catch (dbiplus::DbErrors &error)
+      {
+        // next() fetches the following batch of rows, which can fail too
+        m_pDS->close();
+        CLog::Log(LOGERROR, "%s: fetching rows failed for query: %s (%s)", __FUNCTION__, whereClause.c_str(), error.getMsg());
+        return false;
+      }
       catch (...)
       {
         m_pDS->close();
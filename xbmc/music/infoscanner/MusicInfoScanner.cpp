@@ -49,6 +49,8 @@
 #include "utils/log.h"
 #include "utils/URIUtils.h"
 #include "ThumbnailCache.h"
+#include "threads/Atomics.h"
+#include "utils/ChangeJournal.h"
 
 #include <algorithm>
 
@@ -57,13 +59,72 @@ using namespace MUSIC_INFO;
 using namespace XFILE;
 using namespace MUSIC_GRABBER;
 
-CMusicInfoScanner::CMusicInfoScanner() : CThread("CMusicInfoScanner")
+// tags are read over the network on most shares, so a few are read at once -
+// as many as the job manager runs at low priority
+#define TAG_READ_JOBS         3
+// the scan waits for tags to be read once this many are outstanding
+#define MAX_PENDING_TAGS      1000
+// directories are written to the database in transactions of about this many songs
+#define SONGS_PER_TRANSACTION 1000
+
+namespace MUSIC_INFO
+{
+  class CMusicScanDirectory
+  {
+  public:
+    CMusicScanDirectory(const CStdString &path, const CStdString &hash)
+      : m_path(path), m_hash(hash), m_hasThumbnail(false), m_outstanding(0), m_tagsRead(true)
+    {
+    }
+
+    CStdString m_path;
+    CStdString m_hash;
+    bool m_hasThumbnail;
+    std::vector<CFileItemPtr> m_files; ///< files to read tags from, in scan order
+    volatile long m_outstanding;       ///< files whose tag isn't read yet
+    CEvent m_tagsRead;                 ///< set once all tags are read
+  };
+
+  class CMusicTagJob : public CJob
+  {
+  public:
+    CMusicTagJob(const CFileItemPtr &item, const CMusicScanDirectoryPtr &directory)
+      : m_item(item), m_directory(directory)
+    {
+    }
+
+    virtual const char *GetType() const { return "musictag"; };
+
+    virtual bool DoWork()
+    {
+      CMusicInfoTag& tag = *m_item->GetMusicInfoTag();
+      if (!tag.Loaded())
+      { // read the tag from a file
+        auto_ptr<IMusicInfoTagLoader> pLoader (CMusicInfoTagLoaderFactory::CreateLoader(m_item->GetPath()));
+        if (NULL != pLoader.get())
+          pLoader->Load(m_item->GetPath(), tag);
+      }
+      if (AtomicDecrement(&m_directory->m_outstanding) == 0)
+        m_directory->m_tagsRead.Set();
+      return true;
+    }
+
+  private:
+    CFileItemPtr m_item;
+    CMusicScanDirectoryPtr m_directory;
+  };
+}
+
+CMusicInfoScanner::CMusicInfoScanner() : CThread("CMusicInfoScanner"), m_tagReader(false, TAG_READ_JOBS, CJob::PRIORITY_LOW)
 {
   m_bRunning = false;
   m_pObserver = NULL;
   m_bCanInterrupt = false;
   m_currentItem=0;
   m_itemCount=0;
+  m_pendingTags = 0;
+  m_inTransaction = false;
+  m_songsInTransaction = 0;
 }
 
 CMusicInfoScanner::~CMusicInfoScanner()
@@ -97,10 +158,23 @@ void CMusicInfoScanner::Process()
       m_currentItem=0;
       m_itemCount=-1;
 
+      // watch the paths for changes, so the next scan only has to look at what changed.
+      // Counting the files would list everything, so it's left out if all changes are known
+      CChangeJournal &journal = CChangeJournal::GetInstance();
+      bool journalled = true;
+      for (set<CStdString>::iterator it = m_pathsToScan.begin(); it != m_pathsToScan.end(); ++it)
+      {
+        journal.Watch(*it);
+        if (!journal.IsJournalled("music", *it))
+          journalled = false;
+      }
+      int64_t journalPosition = journal.GetPosition();
+      set<CStdString> pathsToJournal = m_pathsToScan;
+
       // Create the thread to count all files to be scanned
       SetPriority( GetMinPriority() );
       CThread fileCountReader(this, "CMusicInfoScanner");
-      if (m_pObserver)
+      if (m_pObserver && !journalled)
         fileCountReader.Create();
 
       // Database operations should not be canceled
@@ -125,8 +199,16 @@ void CMusicInfoScanner::Process()
         commit = !cancelled;
       }
 
+      // write out the directories whose tags are still being read
+      if (commit && !WriteDirectories(true))
+        commit = false;
+      if (!commit)
+        DropDirectories();
+
       if (commit)
       {
+        journal.SetScanned("music", pathsToJournal, journalPosition);
+
         g_infoManager.ResetLibraryBools();
 
         if (m_needsCleanup)
@@ -351,6 +433,25 @@ bool CMusicInfoScanner::DoScan(const CStdString& strDirectory)
   if (CUtil::ExcludeFileOrFolder(strDirectory, regexps))
     return true;
 
+  // the change journal knows the folder hasn't changed, so only its subfolders need a look
+  CStdString dbHash;
+  vector<CStdString> subfolders;
+  CChangeJournal &journal = CChangeJournal::GetInstance();
+  if (journal.IsUnchanged("music", strDirectory, false) && m_musicDatabase.GetPathHash(strDirectory, dbHash) &&
+      journal.GetSubdirectories(strDirectory, subfolders, g_guiSettings.GetBool("filelists.showhidden")))
+  {
+    CLog::Log(LOGDEBUG, "%s Skipping dir '%s' due to no change (journal)", __FUNCTION__, strDirectory.c_str());
+    if (m_pObserver)
+      m_pObserver->OnDirectoryScanned(strDirectory);
+
+    for (unsigned int i = 0; i < subfolders.size() && !m_bStop; ++i)
+    {
+      if (!DoScan(subfolders[i]))
+        m_bStop = true;
+    }
+    return !m_bStop;
+  }
+
   // load subfolder
   CFileItemList items;
   CDirectory::GetDirectory(strDirectory, items, g_settings.m_musicExtensions + "|.jpg|.tbn|.lrc|.cdg");
@@ -366,7 +467,6 @@ bool CMusicInfoScanner::DoScan(const CStdString& strDirectory)
   items.SetMusicThumb(true); // true forces it to get a remote thumb
 
   // check whether we need to rescan or not
-  CStdString dbHash;
   if (!m_musicDatabase.GetPathHash(strDirectory, dbHash) || dbHash != hash)
   { // path has changed - rescan
     if (dbHash.IsEmpty())
@@ -378,15 +478,8 @@ bool CMusicInfoScanner::DoScan(const CStdString& strDirectory)
     items.FilterCueItems();
     items.Sort(SORT_METHOD_LABEL, SORT_ORDER_ASC);
 
-    // and then scan in the new information
-    if (RetrieveMusicInfo(items, strDirectory) > 0)
-    {
-      if (m_pObserver)
-        m_pObserver->OnDirectoryScanned(strDirectory);
-    }
-
-    // save information about this folder
-    m_musicDatabase.SetPathHash(strDirectory, hash);
+    // and then read the new information while the scan carries on
+    ReadTags(items, strDirectory, hash);
   }
   else
   { // path is the same - no need to rescan
@@ -402,6 +495,9 @@ bool CMusicInfoScanner::DoScan(const CStdString& strDirectory)
     }
   }
 
+  if (!WriteDirectories(false))
+    return false;
+
   // now scan the subfolders
   for (int i = 0; i < items.Size(); ++i)
   {
@@ -423,15 +519,10 @@ bool CMusicInfoScanner::DoScan(const CStdString& strDirectory)
   return !m_bStop;
 }
 
-int CMusicInfoScanner::RetrieveMusicInfo(CFileItemList& items, const CStdString& strDirectory)
+void CMusicInfoScanner::ReadTags(CFileItemList& items, const CStdString& strDirectory, const CStdString& hash)
 {
-  CSongMap songsMap;
-
-  // get all information for all files in current directory from database, and remove them
-  if (m_musicDatabase.RemoveSongsFromPath(strDirectory, songsMap))
-    m_needsCleanup = true;
-
-  VECSONGS songsToAdd;
+  CMusicScanDirectoryPtr directory(new CMusicScanDirectory(strDirectory, hash));
+  directory->m_hasThumbnail = items.HasThumbnail();
 
   CStdStringArray regexps = g_advancedSettings.m_audioExcludeFromScanRegExps;
 
@@ -439,11 +530,6 @@ int CMusicInfoScanner::RetrieveMusicInfo(CFileItemList& items, const CStdString&
   for (int i = 0; i < items.Size(); ++i)
   {
     CFileItemPtr pItem = items[i];
-    CStdString strExtension;
-    URIUtils::GetExtension(pItem->GetPath(), strExtension);
-
-    if (m_bStop)
-      return 0;
 
     // Discard all excluded files defined by m_musicExcludeRegExps
     if (CUtil::ExcludeFileOrFolder(pItem->GetPath(), regexps))
@@ -451,87 +537,181 @@ int CMusicInfoScanner::RetrieveMusicInfo(CFileItemList& items, const CStdString&
 
     // dont try reading id3tags for folders, playlists or shoutcast streams
     if (!pItem->m_bIsFolder && !pItem->IsPlayList() && !pItem->IsPicture() && !pItem->IsLyrics() )
+      directory->m_files.push_back(pItem);
+  }
+
+  directory->m_outstanding = directory->m_files.size();
+  if (directory->m_files.empty())
+    directory->m_tagsRead.Set();
+  m_directories.push_back(directory);
+  m_pendingTags += directory->m_files.size();
+
+  for (unsigned int i = 0; i < directory->m_files.size(); ++i)
+    m_tagReader.AddJob(new CMusicTagJob(directory->m_files[i], directory));
+}
+
+bool CMusicInfoScanner::WriteDirectories(bool flush)
+{
+  while (!m_directories.empty())
+  {
+    CMusicScanDirectoryPtr directory = m_directories.front();
+
+    // carry on scanning while the tags are read, unless too many are outstanding
+    if (!flush && m_pendingTags < MAX_PENDING_TAGS && !directory->m_tagsRead.WaitMSec(0))
+      break;
+
+    if (AbortableWait(directory->m_tagsRead) != WAIT_SIGNALED || m_bStop)
     {
-      m_currentItem++;
-//      CLog::Log(LOGDEBUG, "%s - Reading tag for: %s", __FUNCTION__, pItem->GetPath().c_str());
+      DropDirectories();
+      return false;
+    }
 
-      // grab info from the song
-      CSong *dbSong = songsMap.Find(pItem->GetPath());
+    m_directories.pop_front();
+    m_pendingTags -= directory->m_files.size();
 
-      CMusicInfoTag& tag = *pItem->GetMusicInfoTag();
-      if (!tag.Loaded() )
-      { // read the tag from a file
-        auto_ptr<IMusicInfoTagLoader> pLoader (CMusicInfoTagLoaderFactory::CreateLoader(pItem->GetPath()));
-        if (NULL != pLoader.get())
-          pLoader->Load(pItem->GetPath(), tag);
-      }
+    if (WriteDirectory(*directory) < 0)
+    {
+      DropDirectories();
+      return false;
+    }
+  }
 
-      // if we have the itemcount, notify our
-      // observer with the progress we made
-      if (m_pObserver && m_itemCount>0)
-        m_pObserver->OnSetProgress(m_currentItem, m_itemCount);
+  if (flush || m_songsInTransaction >= SONGS_PER_TRANSACTION)
+    CommitSongs();
+
+  return !m_bStop;
+}
+
+int CMusicInfoScanner::WriteDirectory(CMusicScanDirectory& directory)
+{
+  if (!m_inTransaction)
+  {
+    m_musicDatabase.BeginTransaction();
+    m_inTransaction = true;
+  }
+
+  CSongMap songsMap;
+
+  // get all information for all files in current directory from database, and remove them
+  if (m_musicDatabase.RemoveSongsFromPath(directory.m_path, songsMap))
+    m_needsCleanup = true;
+
+  VECSONGS songsToAdd;
+
+  for (unsigned int i = 0; i < directory.m_files.size(); ++i)
+  {
+    CFileItemPtr pItem = directory.m_files[i];
 
-      if (tag.Loaded())
+    m_currentItem++;
+
+    // grab info from the song
+    CSong *dbSong = songsMap.Find(pItem->GetPath());
+
+    CMusicInfoTag& tag = *pItem->GetMusicInfoTag();
+
+    if (tag.Loaded())
+    {
+      CSong song(tag);
+
+      // ensure our song has a valid filename or else it will assert in AddSong()
+      if (song.strFileName.IsEmpty())
       {
-        CSong song(tag);
+        // copy filename from path in case UPnP or other tag loaders didn't specify one (FIXME?)
+        song.strFileName = pItem->GetPath();
 
-        // ensure our song has a valid filename or else it will assert in AddSong()
+        // if we still don't have a valid filename, skip the song
         if (song.strFileName.IsEmpty())
         {
-          // copy filename from path in case UPnP or other tag loaders didn't specify one (FIXME?)
-          song.strFileName = pItem->GetPath();
-
-          // if we still don't have a valid filename, skip the song
-          if (song.strFileName.IsEmpty())
-          {
-            // this shouldn't ideally happen!
-            CLog::Log(LOGERROR, "Skipping song since it doesn't seem to have a filename");
-            continue;
-          }
+          // this shouldn't ideally happen!
+          CLog::Log(LOGERROR, "Skipping song since it doesn't seem to have a filename");
+          continue;
         }
+      }
 
-        song.iStartOffset = pItem->m_lStartOffset;
-        song.iEndOffset = pItem->m_lEndOffset;
-        if (dbSong)
-        { // keep the db-only fields intact on rescan...
-          song.iTimesPlayed = dbSong->iTimesPlayed;
-          song.lastPlayed = dbSong->lastPlayed;
-          song.iKaraokeNumber = dbSong->iKaraokeNumber;
+      song.iStartOffset = pItem->m_lStartOffset;
+      song.iEndOffset = pItem->m_lEndOffset;
+      if (dbSong)
+      { // keep the db-only fields intact on rescan...
+        song.iTimesPlayed = dbSong->iTimesPlayed;
+        song.lastPlayed = dbSong->lastPlayed;
+        song.iKaraokeNumber = dbSong->iKaraokeNumber;
 
-          if (song.rating == '0') song.rating = dbSong->rating;
-        }
-        pItem->SetMusicThumb();
-        song.strThumb = pItem->GetThumbnailImage();
-        songsToAdd.push_back(song);
-//        CLog::Log(LOGDEBUG, "%s - Tag loaded for: %s", __FUNCTION__, pItem->GetPath().c_str());
+        if (song.rating == '0') song.rating = dbSong->rating;
       }
-      else
-        CLog::Log(LOGDEBUG, "%s - No tag found for: %s", __FUNCTION__, pItem->GetPath().c_str());
+      pItem->SetMusicThumb();
+      song.strThumb = pItem->GetThumbnailImage();
+      songsToAdd.push_back(song);
     }
+    else
+      CLog::Log(LOGDEBUG, "%s - No tag found for: %s", __FUNCTION__, pItem->GetPath().c_str());
   }
 
+  // if we have the itemcount, notify our
+  // observer with the progress we made
+  if (m_pObserver && m_itemCount>0)
+    m_pObserver->OnSetProgress(m_currentItem, m_itemCount);
+
   CheckForVariousArtists(songsToAdd);
-  if (!items.HasThumbnail())
-    UpdateFolderThumb(songsToAdd, items.GetPath());
+  if (!directory.m_hasThumbnail)
+    UpdateFolderThumb(songsToAdd, directory.m_path);
 
   // finally, add these to the database
-  set<CStdString> artistsToScan;
-  set< pair<CStdString, CStdString> > albumsToScan;
-  m_musicDatabase.BeginTransaction();
   for (unsigned int i = 0; i < songsToAdd.size(); ++i)
   {
     if (m_bStop)
-    {
-      m_musicDatabase.RollbackTransaction();
-      return i;
-    }
+      return -1;
     CSong &song = songsToAdd[i];
     m_musicDatabase.AddSong(song, false);
 
-    artistsToScan.insert(song.strArtist);
-    albumsToScan.insert(make_pair(song.strAlbum, song.strArtist));
+    m_artistsToDownload.insert(song.strArtist);
+    m_albumsToDownload.insert(make_pair(song.strAlbum, song.strArtist));
   }
+  m_songsInTransaction += songsToAdd.size();
+
+  // save information about this folder
+  m_musicDatabase.SetPathHash(directory.m_path, directory.m_hash);
+
+  if (!songsToAdd.empty() && m_pObserver)
+    m_pObserver->OnDirectoryScanned(directory.m_path);
+
+  return songsToAdd.size();
+}
+
+void CMusicInfoScanner::CommitSongs()
+{
+  if (!m_inTransaction)
+    return;
+
   m_musicDatabase.CommitTransaction();
+  m_inTransaction = false;
+  m_songsInTransaction = 0;
+
+  DownloadInfo();
+}
+
+void CMusicInfoScanner::DropDirectories()
+{
+  // tags still being read are read into items nobody looks at anymore
+  m_tagReader.CancelJobs();
+  m_directories.clear();
+  m_pendingTags = 0;
+
+  if (m_inTransaction)
+  {
+    m_musicDatabase.RollbackTransaction();
+    m_inTransaction = false;
+    m_songsInTransaction = 0;
+  }
+  m_artistsToDownload.clear();
+  m_albumsToDownload.clear();
+}
+
+void CMusicInfoScanner::DownloadInfo()
+{
+  set<CStdString> artistsToScan;
+  set< pair<CStdString, CStdString> > albumsToScan;
+  artistsToScan.swap(m_artistsToDownload);
+  albumsToScan.swap(m_albumsToDownload);
 
   bool bCanceled;
   for (set<CStdString>::iterator i = artistsToScan.begin(); i != artistsToScan.end(); ++i)
@@ -558,7 +738,7 @@ int CMusicInfoScanner::RetrieveMusicInfo(CFileItemList& items, const CStdString&
     for (set< pair<CStdString, CStdString> >::iterator i = albumsToScan.begin(); i != albumsToScan.end(); ++i)
     {
       if (m_bStop)
-        return songsToAdd.size();
+        return;
 
       long iAlbum = m_musicDatabase.GetAlbumByName(i->first, i->second);
       CStdString strPath;
@@ -575,8 +755,6 @@ int CMusicInfoScanner::RetrieveMusicInfo(CFileItemList& items, const CStdString&
   }
   if (m_pObserver)
     m_pObserver->OnStateChanged(READING_MUSIC_INFO);
-
-  return songsToAdd.size();
 }
 
 static bool SortSongsByTrack(CSong *song, CSong *song2)
@@ -21,13 +21,20 @@
  */
 #include "threads/Thread.h"
 #include "music/MusicDatabase.h"
+#include "utils/JobManager.h"
 #include "MusicAlbumInfo.h"
 
+#include <deque>
+#include <boost/shared_ptr.hpp>
+
 class CAlbum;
 class CArtist;
 
 namespace MUSIC_INFO
 {
+class CMusicScanDirectory;
+typedef boost::shared_ptr<CMusicScanDirectory> CMusicScanDirectoryPtr;
+
 enum SCAN_STATE { PREPARING = 0, REMOVING_OLD, CLEANING_UP_DATABASE, READING_MUSIC_INFO, DOWNLOADING_ALBUM_INFO, DOWNLOADING_ARTIST_INFO, COMPRESSING_DATABASE, WRITING_CHANGES };
 
 class IMusicInfoScannerObserver
@@ -61,7 +68,23 @@ public:
   bool DownloadArtistInfo(const CStdString& strPath, const CStdString& strArtist, bool& bCanceled, CGUIDialogProgress* pDialog=NULL);
 protected:
   virtual void Process();
-  int RetrieveMusicInfo(CFileItemList& items, const CStdString& strDirectory);
+
+  /*! \brief Queue the tags of a changed directory to be read by the tag reading jobs
+   The directory is written to the database by WriteDirectories once its tags are read.
+   */
+  void ReadTags(CFileItemList& items, const CStdString& strDirectory, const CStdString& hash);
+
+  /*! \brief Write the directories whose tags are read to the database, in the order they were scanned
+   Waits for the tags of the oldest directory while too many are outstanding.
+   \param flush wait for and write all directories, and commit them
+   \return false if the scan was stopped, in which case the uncommitted directories are dropped
+   */
+  bool WriteDirectories(bool flush);
+  int WriteDirectory(CMusicScanDirectory& directory);
+  void CommitSongs();
+  void DropDirectories();
+  void DownloadInfo();
+
   void UpdateFolderThumb(const VECSONGS &songs, const CStdString &folderPath);
   int GetPathHash(const CFileItemList &items, CStdString &hash);
   void GetAlbumArtwork(long id, const CAlbum &artist);
@@ -89,5 +112,13 @@ protected:
   std::set<CStdString> m_pathsToCount;
   std::vector<long> m_artistsScanned;
   std::vector<long> m_albumsScanned;
+
+  CJobQueue m_tagReader;
+  std::deque<CMusicScanDirectoryPtr> m_directories; ///< changed directories waiting to be written, oldest first
+  unsigned int m_pendingTags;                       ///< files in m_directories
+  bool m_inTransaction;
+  unsigned int m_songsInTransaction;
+  std::set<CStdString> m_artistsToDownload;         ///< artists of the committed songs to download info for
+  std::set< std::pair<CStdString, CStdString> > m_albumsToDownload;
 };
 }
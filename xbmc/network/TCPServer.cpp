@@ -55,6 +55,7 @@ using namespace ANNOUNCEMENT;
 //using namespace std; On VS2010, bind conflicts with std::bind
 
 #define RECEIVEBUFFER 1024
+#define SENDBUFFER    16384
 
 CTCPServer *CTCPServer::ServerInstance = NULL;
 
@@ -191,16 +192,20 @@ void CTCPServer::Announce(EAnnouncementFlag flag, const char *sender, const char
 
   for (unsigned int i = 0; i < m_connections.size(); i++)
   {
+    CSingleLock lock (m_connections[i].m_critSection);
+    if ((m_connections[i].GetAnnouncementFlags() & flag) == 0)
+      continue;
+
+    // don't break into a response, it's sent once the response is done
+    if (m_connections[i].m_responding)
     {
-      CSingleLock lock (m_connections[i].m_critSection);
-      if ((m_connections[i].GetAnnouncementFlags() & flag) == 0)
-        continue;
+      m_connections[i].m_deferred += str;
+      continue;
     }
 
     unsigned int sent = 0;
     do
     {
-      CSingleLock lock (m_connections[i].m_critSection);
       sent += send(m_connections[i].m_socket, str.c_str(), str.size() - sent, sent);
     } while (sent < str.size());
   }
@@ -473,6 +478,7 @@ CTCPServer::CTCPClient::CTCPClient()
   m_endBrackets = 0;
   m_beginChar = 0;
   m_endChar = 0;
+  m_responding = false;
 
   m_addrlen = sizeof(m_cliaddr);
 }
@@ -530,9 +536,30 @@ void CTCPServer::CTCPClient::PushBuffer(CTCPServer *host, const char *buffer, in
         m_endBrackets++;
       if (m_beginBrackets > 0 && m_endBrackets > 0 && m_beginBrackets == m_endBrackets)
       {
-        std::string line = CJSONRPC::MethodCall(m_buffer, host, this);
-        CSingleLock lock (m_critSection);
-        send(m_socket, line.c_str(), line.size(), 0);
+        CJSONRPCResponse response;
+        CJSONRPC::MethodCall(m_buffer, host, this, response);
+
+        // the response is serialized while it's sent, only the sending needs the lock.
+        // announcements are held back until it's done so they don't end up in it
+        {
+          CSingleLock lock (m_critSection);
+          m_responding = true;
+        }
+        char chunk[SENDBUFFER];
+        size_t size;
+        while ((size = response.Read(chunk, sizeof(chunk))) > 0)
+        {
+          CSingleLock lock (m_critSection);
+          if (send(m_socket, chunk, size, 0) < 0)
+            break;
+        }
+        {
+          CSingleLock lock (m_critSection);
+          m_responding = false;
+          if (!m_deferred.empty())
+            send(m_socket, m_deferred.c_str(), m_deferred.size(), 0);
+          m_deferred.clear();
+        }
         m_beginChar = m_beginBrackets = m_endBrackets = 0;
         m_buffer.clear();
       }
@@ -562,5 +589,7 @@ void CTCPServer::CTCPClient::Copy(const CTCPClient& client)
   m_beginChar         = client.m_beginChar;
   m_endChar           = client.m_endChar;
   m_buffer            = client.m_buffer;
+  m_responding        = client.m_responding;
+  m_deferred          = client.m_deferred;
 }
 
@@ -68,6 +68,8 @@ namespace JSONRPC
       sockaddr_storage m_cliaddr;
       socklen_t        m_addrlen;
       CCriticalSection m_critSection;
+      bool             m_responding; ///< a response is being sent, under m_critSection
+      std::string      m_deferred;   ///< announcements held back until it's sent
 
     private:
       void Copy(const CTCPClient& client);
@@ -42,6 +42,11 @@
 #define PAGE_JSONRPC_INFO   "<html><head><title>JSONRPC</title></head><body>JSONRPC active and working</body></html>"
 #define NOT_SUPPORTED       "<html><head><title>Not Supported</title></head><body>The method you are trying to use is not supported by this server</body></html>"
 #define DEFAULT_PAGE        "index.html"
+#define JSONRPC_BLOCK_SIZE  16384
+
+#ifndef MHD_SIZE_UNKNOWN
+#define MHD_SIZE_UNKNOWN    -1
+#endif
 
 using namespace ADDON;
 using namespace XFILE;
@@ -254,14 +259,25 @@ int CWebServer::JSONRPC(CWebServer *server, void **con_cls, struct MHD_Connectio
     CStdString *jsoncall = (CStdString *)(*con_cls);
 
     CHTTPClient client;
-    CStdString jsonresponse = CJSONRPC::MethodCall(*jsoncall, server, &client);
+    CJSONRPCResponse *jsonresponse = new CJSONRPCResponse();
+    CJSONRPC::MethodCall(*jsoncall, server, &client, *jsonresponse);
+    delete jsoncall;
+
+    // the response is serialized as MHD sends it
+    struct MHD_Response *response = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN,
+                                                                      JSONRPC_BLOCK_SIZE,
+                                                                      &CWebServer::JSONRPCReaderCallback, jsonresponse,
+                                                                      &CWebServer::JSONRPCReaderFreeCallback);
+    if (response == NULL)
+    {
+      delete jsonresponse;
+      return MHD_NO;
+    }
 
-    struct MHD_Response *response = MHD_create_response_from_data(jsonresponse.length(), (void *) jsonresponse.c_str(), MHD_NO, MHD_YES);
     int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
     MHD_add_response_header(response, "Content-Type", "application/json");
     MHD_destroy_response(response);
 
-    delete jsoncall;
     return ret;
   }
 #else
@@ -423,6 +439,29 @@ void CWebServer::ContentReaderFreeCallback(void *cls)
   delete file;
 }
 
+#if (MHD_VERSION >= 0x00090200)
+ssize_t CWebServer::JSONRPCReaderCallback(void *cls, uint64_t pos, char *buf, size_t max)
+#elif (MHD_VERSION >= 0x00040001)
+int CWebServer::JSONRPCReaderCallback(void *cls, uint64_t pos, char *buf, int max)
+#else   //libmicrohttpd < 0.4.0
+int CWebServer::JSONRPCReaderCallback(void *cls, size_t pos, char *buf, int max)
+#endif
+{
+  // MHD reads the response front to back, so pos can be ignored
+  CJSONRPCResponse *response = (CJSONRPCResponse *)cls;
+  size_t res = response->Read(buf, max);
+  if (res == 0)
+    return -1;
+  return res;
+}
+
+void CWebServer::JSONRPCReaderFreeCallback(void *cls)
+{
+  CJSONRPCResponse *response = (CJSONRPCResponse *)cls;
+
+  delete response;
+}
+
 struct MHD_Daemon* CWebServer::StartMHD(unsigned int flags, int port)
 {
   // WARNING: when using MHD_USE_THREAD_PER_CONNECTION, set MHD_OPTION_CONNECTION_TIMEOUT to something higher than 1
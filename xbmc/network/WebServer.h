@@ -71,6 +71,15 @@ private:
   static int ContentReaderCallback (void *cls, size_t pos, char *buf, int max);
 #endif
 
+#if (MHD_VERSION >= 0x00090200)
+  static ssize_t JSONRPCReaderCallback (void *cls, uint64_t pos, char *buf, size_t max);
+#elif (MHD_VERSION >= 0x00040001)
+  static int JSONRPCReaderCallback (void *cls, uint64_t pos, char *buf, int max);
+#else
+  static int JSONRPCReaderCallback (void *cls, size_t pos, char *buf, int max);
+#endif
+  static void JSONRPCReaderFreeCallback (void *cls);
+
 #if (MHD_VERSION >= 0x00040001)
   static int JSONRPC(CWebServer *server, void **con_cls, struct MHD_Connection *connection, const char *upload_data, size_t *upload_data_size);
   static int AnswerToConnection (void *cls, struct MHD_Connection *connection,
@@ -36,14 +36,61 @@
 using namespace XFILE;
 using namespace std;
 
+/*! \brief Job handing the pictures of a listing to the texture cache as a batch
+ */
+class CPicturePrefetchJob : public CJob
+{
+public:
+  CPicturePrefetchJob(const vector<CStdString> &urls) : m_urls(urls) {}
+
+  virtual const char* GetType() const { return "prefetchpictures"; };
+  virtual bool DoWork()
+  {
+    CTextureCache::Get().CacheImages(m_urls, this);
+    return true;
+  }
+
+private:
+  vector<CStdString> m_urls;
+};
+
 CPictureThumbLoader::CPictureThumbLoader() : CThumbLoader(1), CJobQueue(true)
 {
   m_regenerateThumbs = false;
+  m_prefetchJob = 0;
 }
 
 CPictureThumbLoader::~CPictureThumbLoader()
 {
   StopThread();
+  CancelPrefetch();
+}
+
+void CPictureThumbLoader::OnLoaderStart()
+{
+  CancelPrefetch();
+  if (m_regenerateThumbs)
+    return;
+
+  // the loader takes the pictures one at a time, the texture cache caches the
+  // rest of them in parallel meanwhile. LoadItem waits for those in flight.
+  vector<CStdString> urls;
+  for (vector<CFileItemPtr>::const_iterator i = m_vecItems.begin(); i != m_vecItems.end(); ++i)
+  {
+    const CFileItemPtr &pItem = *i;
+    if (pItem->IsPicture() && !pItem->HasThumbnail() && !pItem->IsZIP() && !pItem->IsRAR() &&
+        !pItem->IsCBZ() && !pItem->IsCBR() && !pItem->IsPlayList())
+      urls.push_back(CTextureCache::GetWrappedThumbURL(pItem->GetPath()));
+  }
+  if (urls.size() > 1)
+    m_prefetchJob = CJobManager::GetInstance().AddJob(new CPicturePrefetchJob(urls), this);
+}
+
+void CPictureThumbLoader::CancelPrefetch()
+{
+  if (m_prefetchJob)
+    CJobManager::GetInstance().CancelJob(m_prefetchJob);
+  m_prefetchJob = 0;
 }
 
 bool CPictureThumbLoader::LoadItem(CFileItem* pItem)
@@ -111,6 +158,8 @@ bool CPictureThumbLoader::LoadItem(CFileItem* pItem)
 
 void CPictureThumbLoader::OnJobComplete(unsigned int jobID, bool success, CJob* job)
 {
+  if (strcmp(job->GetType(), "prefetchpictures") == 0)
+    return; // not one of our queue
   if (success)
   {
     CThumbExtractor* loader = (CThumbExtractor*)job;
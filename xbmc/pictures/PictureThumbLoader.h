@@ -41,7 +41,11 @@ public:
    */
   virtual void OnJobComplete(unsigned int jobID, bool success, CJob *job);
 protected:
+  virtual void OnLoaderStart();
   virtual void OnLoaderFinish();
 private:
+  void CancelPrefetch();
+
   bool m_regenerateThumbs;
+  unsigned int m_prefetchJob; ///< job caching the pictures of the listing, 0 if none
 };
@@ -94,6 +94,7 @@ void CAdvancedSettings::Initialize()
   m_videoAutoScaleMaxFps = 30.0f;
   m_videoAllowMpeg4VDPAU = false;
   m_videoDisableBackgroundDeinterlace = false;
+  m_videoLockFreeQueues = false;
   m_videoCaptureUseOcclusionQuery = -1; //-1 is auto detect
   m_videoFFmpegInterlacedFlagLingerFrames = 750; //typically around 30 secs
   m_videoVDPAUdeintHD = -1;
@@ -115,6 +116,7 @@ void CAdvancedSettings::Initialize()
   m_musicPercentSeekForwardBig = 10;
   m_musicPercentSeekBackwardBig = -10;
   m_musicResample = 0;
+  m_musicResampleQuality = 1;
 
   m_slideshowPanAmount = 2.5f;
   m_slideshowZoomAmount = 5.0f;
@@ -251,6 +253,7 @@ void CAdvancedSettings::Initialize()
   m_curlconnecttimeout = 10;
   m_curllowspeedtime = 20;
   m_curlretries = 2;
+  m_curlconnections = 1;
   m_curlDisableIPV6 = false;      //Certain hardware/OS combinations have trouble
                                   //with ipv6.
 
@@ -298,6 +301,8 @@ void CAdvancedSettings::Initialize()
   m_measureRefreshrate = false;
 
   m_cacheMemBufferSize = 1024 * 1024 * 20;
+  m_cacheSparse = false;
+  m_directoryCacheSize = 1024 * 1024 * 16;
 
   m_jsonOutputCompact = true;
   m_jsonTcpPort = 9090;
@@ -308,7 +313,9 @@ void CAdvancedSettings::Initialize()
   m_guiVisualizeDirtyRegions = false;
   m_guiAlgorithmDirtyRegions = 0;
   m_guiDirtyRegionNoFlipTimeout = -1;
+  m_guiPrefetchTextures = true;
   m_logEnableAirtunes = false;
+  m_logAsync = false;
   m_airTunesPort = 36666;
   m_airPlayPort = 36667;
 }
@@ -379,6 +386,7 @@ void CAdvancedSettings::ParseSettingsFile(const CStdString &file)
     XMLUtils::GetInt(pElement, "percentseekbackwardbig", m_musicPercentSeekBackwardBig, -100, 0);
 
     XMLUtils::GetInt(pElement, "resample", m_musicResample, 0, 192000);
+    XMLUtils::GetInt(pElement, "resamplequality", m_musicResampleQuality, 0, 2);
 
     TiXmlElement* pAudioExcludes = pElement->FirstChildElement("excludefromlisting");
     if (pAudioExcludes)
@@ -475,6 +483,7 @@ void CAdvancedSettings::ParseSettingsFile(const CStdString &file)
     XMLUtils::GetFloat(pElement,"autoscalemaxfps",m_videoAutoScaleMaxFps, 0.0f, 1000.0f);
     XMLUtils::GetBoolean(pElement,"allowmpeg4vdpau",m_videoAllowMpeg4VDPAU);
     XMLUtils::GetBoolean(pElement, "disablebackgrounddeinterlace", m_videoDisableBackgroundDeinterlace);
+    XMLUtils::GetBoolean(pElement, "lockfreequeues", m_videoLockFreeQueues);
     XMLUtils::GetInt(pElement, "useocclusionquery", m_videoCaptureUseOcclusionQuery, -1, 1);
     XMLUtils::GetInt(pElement,"vdpauHDdeint",m_videoVDPAUdeintHD);
     XMLUtils::GetInt(pElement,"vdpauSDdeint",m_videoVDPAUdeintSD);
@@ -636,8 +645,10 @@ void CAdvancedSettings::ParseSettingsFile(const CStdString &file)
     XMLUtils::GetInt(pElement, "curlclienttimeout", m_curlconnecttimeout, 1, 1000);
     XMLUtils::GetInt(pElement, "curllowspeedtime", m_curllowspeedtime, 1, 1000);
     XMLUtils::GetInt(pElement, "curlretries", m_curlretries, 0, 10);
+    XMLUtils::GetInt(pElement, "curlconnections", m_curlconnections, 1, 16);
     XMLUtils::GetBoolean(pElement,"disableipv6", m_curlDisableIPV6);
     XMLUtils::GetUInt(pElement, "cachemembuffersize", m_cacheMemBufferSize);
+    XMLUtils::GetBoolean(pElement, "cachesparse", m_cacheSparse);
   }
 
   pElement = pRootElement->FirstChildElement("jsonrpc");
@@ -680,6 +691,13 @@ void CAdvancedSettings::ParseSettingsFile(const CStdString &file)
     g_advancedSettings.m_logLevel = std::max(g_advancedSettings.m_logLevel, g_advancedSettings.m_logLevelHint);
     CLog::SetLogLevel(g_advancedSettings.m_logLevel);
   }
+
+  // write the log from a background thread instead of the logging threads
+  XMLUtils::GetBoolean(pRootElement, "asynclog", m_logAsync);
+  CLog::SetAsync(m_logAsync);
+
+  // bytes of directory listings kept in memory
+  XMLUtils::GetUInt(pRootElement, "directorycachesize", m_directoryCacheSize);
      
   XMLUtils::GetString(pRootElement, "cddbaddress", m_cddbAddress);
 
@@ -995,6 +1013,7 @@ void CAdvancedSettings::ParseSettingsFile(const CStdString &file)
     XMLUtils::GetBoolean(pElement, "visualizedirtyregions", m_guiVisualizeDirtyRegions);
     XMLUtils::GetInt(pElement, "algorithmdirtyregions",     m_guiAlgorithmDirtyRegions);
     XMLUtils::GetInt(pElement, "nofliptimeout",             m_guiDirtyRegionNoFlipTimeout);
+    XMLUtils::GetBoolean(pElement, "prefetchtextures",      m_guiPrefetchTextures);
   }
 
   // load in the GUISettings overrides:
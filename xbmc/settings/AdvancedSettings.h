@@ -118,6 +118,7 @@ class CAdvancedSettings
     int m_musicPercentSeekForwardBig;
     int m_musicPercentSeekBackwardBig;
     int m_musicResample;
+    int m_musicResampleQuality;
     int m_videoBlackBarColour;
     int m_videoIgnoreSecondsAtStart;
     float m_videoIgnorePercentAtEnd;
@@ -131,6 +132,7 @@ class CAdvancedSettings
     bool  m_videoAllowMpeg4VDPAU;
     std::vector<RefreshOverride> m_videoAdjustRefreshOverrides;
     bool m_videoDisableBackgroundDeinterlace;
+    bool m_videoLockFreeQueues;
     int  m_videoCaptureUseOcclusionQuery;
     bool m_DXVACheckCompatibility;
     bool m_DXVACheckCompatibilityPresent;
@@ -165,6 +167,7 @@ class CAdvancedSettings
     
     //airtunes + airplay
     bool m_logEnableAirtunes;
+    bool m_logAsync;
     int m_airTunesPort;
     int m_airPlayPort;    
 
@@ -266,6 +269,7 @@ class CAdvancedSettings
     int m_curlconnecttimeout;
     int m_curllowspeedtime;
     int m_curlretries;
+    int m_curlconnections;
     bool m_curlDisableIPV6;
 
     bool m_fullScreen;
@@ -320,8 +324,11 @@ class CAdvancedSettings
     bool m_guiVisualizeDirtyRegions;
     int  m_guiAlgorithmDirtyRegions;
     int  m_guiDirtyRegionNoFlipTimeout;
+    bool m_guiPrefetchTextures;
 
     unsigned int m_cacheMemBufferSize;
+    bool m_cacheSparse;
+    unsigned int m_directoryCacheSize;
 
     bool m_jsonOutputCompact;
     unsigned int m_jsonTcpPort;
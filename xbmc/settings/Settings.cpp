@@ -1397,6 +1397,7 @@ void CSettings::LoadSkinSettings(const TiXmlElement* pRootElement)
       }
       pChild = pChild->NextSiblingElement("setting");
     }
+    g_infoManager.Invalidate(INFOBOOL_DEPENDS_SKIN_SETTINGS);
   }
 }
 
@@ -1475,6 +1476,7 @@ void CSettings::SetSkinString(int setting, const CStdString &label)
   if (it != m_skinStrings.end())
   {
     (*it).second.value = label;
+    g_infoManager.Invalidate(INFOBOOL_DEPENDS_SKIN_SETTINGS);
     return;
   }
   assert(false);
@@ -1491,6 +1493,7 @@ void CSettings::ResetSkinSetting(const CStdString &setting)
     if (settingName.Equals((*it).second.name))
     {
       (*it).second.value = "";
+      g_infoManager.Invalidate(INFOBOOL_DEPENDS_SKIN_SETTINGS);
       return;
     }
   }
@@ -1500,6 +1503,7 @@ void CSettings::ResetSkinSetting(const CStdString &setting)
     if (settingName.Equals((*it).second.name))
     {
       (*it).second.value = false;
+      g_infoManager.Invalidate(INFOBOOL_DEPENDS_SKIN_SETTINGS);
       return;
     }
   }
@@ -1540,6 +1544,7 @@ void CSettings::SetSkinBool(int setting, bool set)
   if (it != m_skinBools.end())
   {
     (*it).second.value = set;
+    g_infoManager.Invalidate(INFOBOOL_DEPENDS_SKIN_SETTINGS);
     return;
   }
   assert(false);
@@ -1568,7 +1573,7 @@ void CSettings::ResetSkinSettings()
 
     it2++;
   }
-  g_infoManager.ResetCache();
+  g_infoManager.Invalidate(INFOBOOL_DEPENDS_SKIN_SETTINGS);
 }
 
 static CStdString ToWatchContent(const CStdString &content)
@@ -0,0 +1,197 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#pragma once
+
+#include "threads/Atomics.h"
+#include "threads/Helpers.h"
+
+namespace XbmcThreads
+{
+  /**
+   * A bounded ring buffer for exactly one producer thread and exactly one
+   *  consumer thread. Push is only ever called by the producer, Front and
+   *  Pop only by the consumer. Neither side takes a lock, the indexes are
+   *  published through the atomics in Atomics.h which act as full barriers.
+   *
+   * The capacity is rounded up to the next power of two.
+   */
+  template <class T> class SPSCRing : public NonCopyable
+  {
+    T* m_slots;
+    unsigned long m_mask;
+    volatile long m_head; // next slot to read, only written by the consumer
+    volatile long m_tail; // next slot to write, only written by the producer
+
+    // a load that is not reordered with the accesses around it
+    inline static unsigned long Load(volatile long* pAddr) { return (unsigned long)cas(pAddr, 0, 0); }
+
+  public:
+    inline SPSCRing(unsigned int capacity) : m_head(0), m_tail(0)
+    {
+      unsigned long size = 1;
+      while (size < capacity)
+        size <<= 1;
+      m_slots = new T[size];
+      m_mask  = size - 1;
+    }
+
+    inline ~SPSCRing() { delete[] m_slots; }
+
+    inline unsigned long Capacity() const { return m_mask + 1; }
+
+    /**
+     * Number of items in the ring. Exact when called from either side
+     *  while the other side is idle, a snapshot otherwise.
+     */
+    inline unsigned long Size() { return Load(&m_tail) - Load(&m_head); }
+
+    inline bool IsEmpty() { return Size() == 0; }
+
+    /**
+     * Producer side. Once this returned false a following Push is
+     *  guaranteed to succeed since only the producer fills the ring.
+     */
+    inline bool IsFull() { return (unsigned long)m_tail - Load(&m_head) > m_mask; }
+
+    /**
+     * Producer side. Returns false if the ring is full.
+     */
+    inline bool Push(const T& item)
+    {
+      if (IsFull())
+        return false;
+      m_slots[(unsigned long)m_tail & m_mask] = item;
+      AtomicIncrement(&m_tail); // publish the slot
+      return true;
+    }
+
+    /**
+     * Consumer side. Returns the oldest item or NULL if the ring is empty.
+     *  The item stays valid until Pop is called.
+     */
+    inline T* Front()
+    {
+      if (Load(&m_tail) == (unsigned long)m_head)
+        return NULL;
+      return &m_slots[(unsigned long)m_head & m_mask];
+    }
+
+    /**
+     * Consumer side. Releases the item returned by Front.
+     */
+    inline void Pop() { AtomicIncrement(&m_head); }
+  };
+
+  /**
+   * A bounded ring buffer for any number of producer threads and exactly
+   *  one consumer thread. Producers Claim a slot, fill it in place and
+   *  Publish it, the consumer sees the slots in the order they were
+   *  claimed. A slot that is claimed but not yet published holds up the
+   *  consumer, so producers should not block between the two calls.
+   *
+   * The capacity is rounded up to the next power of two.
+   */
+  template <class T> class MPSCRing : public NonCopyable
+  {
+    T* m_slots;
+    volatile long* m_sequence; // per slot: the position it is free for, that position + 1 once published
+    unsigned long m_mask;
+    volatile long m_head; // next slot to read, only written by the consumer
+    volatile long m_tail; // next slot to claim, shared by the producers
+
+    inline static long Load(volatile long* pAddr) { return cas(pAddr, 0, 0); }
+
+  public:
+    inline MPSCRing(unsigned int capacity) : m_head(0), m_tail(0)
+    {
+      unsigned long size = 1;
+      while (size < capacity)
+        size <<= 1;
+      m_slots    = new T[size];
+      m_sequence = new long[size];
+      m_mask     = size - 1;
+      for (unsigned long i = 0; i < size; i++)
+        m_sequence[i] = (long)i;
+    }
+
+    inline ~MPSCRing() { delete[] m_slots; delete[] m_sequence; }
+
+    inline unsigned long Capacity() const { return m_mask + 1; }
+
+    /**
+     * Number of claimed slots that have not been popped yet, a snapshot.
+     */
+    inline unsigned long Size() { return (unsigned long)Load(&m_tail) - (unsigned long)Load(&m_head); }
+
+    /**
+     * Producer side. Returns a slot owned by the caller until it is passed
+     *  to Publish, or NULL if the ring is full.
+     */
+    inline T* Claim()
+    {
+      long pos = Load(&m_tail);
+      while (true)
+      {
+        unsigned long index = (unsigned long)pos & m_mask;
+        long diff = Load(&m_sequence[index]) - pos;
+        if (diff == 0)
+        {
+          long prev = cas(&m_tail, pos, pos + 1);
+          if (prev == pos)
+            return &m_slots[index];
+          pos = prev;
+        }
+        else if (diff < 0)
+          return NULL; // the consumer has not released this slot yet
+        else
+          pos = Load(&m_tail); // another producer claimed it first
+      }
+    }
+
+    /**
+     * Producer side. Hands a slot returned by Claim to the consumer.
+     */
+    inline void Publish(T* slot) { AtomicIncrement(&m_sequence[slot - m_slots]); }
+
+    /**
+     * Consumer side. Returns the oldest published item or NULL if there
+     *  is none. The item stays valid until Pop is called.
+     */
+    inline T* Front()
+    {
+      unsigned long index = (unsigned long)m_head & m_mask;
+      if (Load(&m_sequence[index]) != m_head + 1)
+        return NULL;
+      return &m_slots[index];
+    }
+
+    /**
+     * Consumer side. Releases the item returned by Front.
+     */
+    inline void Pop()
+    {
+      long pos = m_head;
+      cas(&m_sequence[(unsigned long)pos & m_mask], pos + 1, pos + (long)m_mask + 1);
+      AtomicIncrement(&m_head);
+    }
+  };
+}
@@ -136,9 +136,14 @@ void CThread::StopThread(bool bWait /*= true*/)
 {
   m_bStop = true;
   m_StopEvent.Set();
+  // the thread clears m_ThreadId and sets m_TermEvent before it's done with
+  // this object, holding m_CriticalSection until it is
+  CSingleLock lock(m_CriticalSection);
   if (m_ThreadId && bWait)
   {
+    lock.Leave();
     WaitForThreadExit(0xFFFFFFFF);
+    lock.Enter();
   }
 }
 
@@ -0,0 +1,252 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "threads/LockFreeRing.h"
+#include "threads/CriticalSection.h"
+#include "threads/SingleLock.h"
+#include "threads/Event.h"
+#include "threads/Atomics.h"
+#include "threads/test/TestHelpers.h"
+
+using namespace XbmcThreads;
+
+#define RINGSIZE   1024
+#define NUMITEMS   1000000l
+
+//=============================================================================
+// Helper classes
+//=============================================================================
+
+// the way CDVDMessageQueue passes packets with the lock free ring
+class RingQueue
+{
+  SPSCRing<long> ring;
+  CEvent event;
+  volatile long waiting;
+public:
+  RingQueue() : ring(RINGSIZE), event(true), waiting(0) {}
+
+  bool Put(long item)
+  {
+    if (!ring.Push(item))
+      return false;
+    if (waiting)
+      event.Set();
+    return true;
+  }
+
+  bool Get(long& item, unsigned int timeout)
+  {
+    long* front;
+    while (!(front = ring.Front()))
+    {
+      event.Reset();
+      AtomicIncrement(&waiting);
+      bool ready = !ring.IsEmpty() || event.WaitMSec(timeout);
+      AtomicDecrement(&waiting);
+      if (!ready)
+        return false;
+    }
+    item = *front;
+    ring.Pop();
+    return true;
+  }
+};
+
+template<class Q> class producer
+{
+  Q& queue;
+public:
+  producer(Q& o) : queue(o) {}
+
+  void operator()()
+  {
+    for (long i = 0; i < NUMITEMS; i++)
+    {
+      while (!queue.Put(i))
+        boost::thread::yield();
+    }
+  }
+};
+
+template<class Q> class consumer
+{
+  Q& queue;
+public:
+  long received;
+  bool inorder;
+
+  consumer(Q& o) : queue(o), received(0), inorder(true) {}
+
+  void operator()()
+  {
+    long item;
+    while (received < NUMITEMS && queue.Get(item, 5000))
+    {
+      if (item != received)
+        inorder = false;
+      received++;
+    }
+  }
+};
+
+// several threads claiming and publishing slots of one MPSCRing
+class multiproducer
+{
+  MPSCRing<long>& ring;
+  long id;
+public:
+  multiproducer(MPSCRing<long>& o, long i) : ring(o), id(i) {}
+
+  void operator()()
+  {
+    for (long i = 0; i < NUMITEMS / 4; i++)
+    {
+      long* slot;
+      while (!(slot = ring.Claim()))
+        boost::thread::yield();
+      *slot = id * NUMITEMS + i;
+      ring.Publish(slot);
+    }
+  }
+};
+
+// one producer thread feeding one consumer thread, true if everything arrived in order
+template<class Q> static bool RunProducerConsumer()
+{
+  Q queue;
+  producer<Q> p(queue);
+  consumer<Q> c(queue);
+
+  boost::thread ct(boost::ref(c));
+  boost::thread pt(boost::ref(p));
+  pt.join();
+  ct.join();
+
+  return c.received == NUMITEMS && c.inorder;
+}
+
+//=============================================================================
+
+BOOST_AUTO_TEST_CASE(TestRingCapacity)
+{
+  SPSCRing<long> ring(5);
+  BOOST_CHECK_EQUAL(8ul, ring.Capacity());
+  BOOST_CHECK(ring.IsEmpty());
+  BOOST_CHECK(ring.Front() == NULL);
+
+  for (long i = 0; i < 8; i++)
+    BOOST_CHECK(ring.Push(i));
+  BOOST_CHECK(ring.IsFull());
+  BOOST_CHECK(!ring.Push(8));
+  BOOST_CHECK_EQUAL(8ul, ring.Size());
+
+  for (long i = 0; i < 8; i++)
+  {
+    BOOST_REQUIRE(ring.Front() != NULL);
+    BOOST_CHECK_EQUAL(i, *ring.Front());
+    ring.Pop();
+  }
+  BOOST_CHECK(ring.IsEmpty());
+}
+
+BOOST_AUTO_TEST_CASE(TestRingWrapAround)
+{
+  SPSCRing<long> ring(4);
+  for (long i = 0; i < 100; i++)
+  {
+    BOOST_CHECK(ring.Push(i));
+    BOOST_CHECK(ring.Push(i + 1000));
+    BOOST_CHECK_EQUAL(i, *ring.Front());
+    ring.Pop();
+    BOOST_CHECK_EQUAL(i + 1000, *ring.Front());
+    ring.Pop();
+  }
+  BOOST_CHECK(ring.IsEmpty());
+}
+
+BOOST_AUTO_TEST_CASE(TestRingProducerConsumer)
+{
+  BOOST_CHECK(RunProducerConsumer<RingQueue>());
+}
+
+BOOST_AUTO_TEST_CASE(TestMultiProducerRing)
+{
+  MPSCRing<long> ring(5);
+  BOOST_CHECK_EQUAL(8ul, ring.Capacity());
+  BOOST_CHECK(ring.Front() == NULL);
+
+  // claimed slots are only seen once published, and in the order they were claimed
+  long* first  = ring.Claim();
+  long* second = ring.Claim();
+  BOOST_REQUIRE(first != NULL && second != NULL);
+  *first = 1; *second = 2;
+  ring.Publish(second);
+  BOOST_CHECK(ring.Front() == NULL);
+  ring.Publish(first);
+  BOOST_REQUIRE(ring.Front() != NULL);
+  BOOST_CHECK_EQUAL(1l, *ring.Front());
+  ring.Pop();
+  BOOST_CHECK_EQUAL(2l, *ring.Front());
+  ring.Pop();
+
+  for (long i = 0; i < 8; i++)
+    ring.Publish(ring.Claim());
+  BOOST_CHECK(ring.Claim() == NULL);
+  BOOST_CHECK_EQUAL(8ul, ring.Size());
+}
+
+BOOST_AUTO_TEST_CASE(TestMultiProducerRingThreads)
+{
+  MPSCRing<long> ring(RINGSIZE);
+  boost::thread* threads[4];
+  for (long i = 0; i < 4; i++)
+    threads[i] = new boost::thread(multiproducer(ring, i));
+
+  // every producer's items arrive complete and in order
+  long next[4] = { 0, 0, 0, 0 };
+  long received = 0;
+  bool inorder = true;
+  while (received < NUMITEMS)
+  {
+    long* item = ring.Front();
+    if (!item)
+    {
+      boost::thread::yield();
+      continue;
+    }
+    long id = *item / NUMITEMS;
+    if (id < 0 || id > 3 || *item % NUMITEMS != next[id]++)
+      inorder = false;
+    ring.Pop();
+    received++;
+  }
+
+  for (int i = 0; i < 4; i++)
+  {
+    threads[i]->join();
+    delete threads[i];
+  }
+  BOOST_CHECK(inorder);
+  BOOST_CHECK(ring.Front() == NULL);
+}
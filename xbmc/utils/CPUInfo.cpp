@@ -230,6 +230,23 @@ CCPUInfo::CCPUInfo(void)
           }
         }
       }
+      else if (strncmp(buffer, "Features", 8) == 0)
+      { // arm
+        char* needle = strchr(buffer, ':');
+        if (needle)
+        {
+          char* tok = NULL,
+              * save;
+          needle++;
+          tok = strtok_r(needle, " \n", &save);
+          while (tok)
+          {
+            if (0 == strcmp(tok, "neon"))
+              m_cpuFeatures |= CPU_FEATURE_NEON;
+            tok = strtok_r(NULL, " \n", &save);
+          }
+        }
+      }
     }
   }
   else
@@ -0,0 +1,504 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "system.h"
+#include "ChangeJournal.h"
+#include "threads/SingleLock.h"
+#include "utils/log.h"
+#include "utils/URIUtils.h"
+
+#ifdef HAVE_INOTIFY
+#include <sys/inotify.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <linux/magic.h>
+#include <dirent.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <string.h>
+
+#define WATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVE_SELF | IN_ONLYDIR)
+
+// not all of these are in linux/magic.h
+#ifndef NFS_SUPER_MAGIC
+#define NFS_SUPER_MAGIC   0x6969
+#endif
+#ifndef SMB_SUPER_MAGIC
+#define SMB_SUPER_MAGIC   0x517B
+#endif
+#ifndef SMB2_MAGIC_NUMBER
+#define SMB2_MAGIC_NUMBER 0xFE534D42
+#endif
+#ifndef CIFS_MAGIC_NUMBER
+#define CIFS_MAGIC_NUMBER 0xFF534D42
+#endif
+#ifndef FUSE_SUPER_MAGIC
+#define FUSE_SUPER_MAGIC  0x65735546
+#endif
+#endif
+
+using namespace std;
+
+// whether path is dir or below it, both with a trailing slash
+static inline bool IsBelow(const CStdString &path, const CStdString &dir)
+{
+  return path.size() >= dir.size() && path.compare(0, dir.size(), dir) == 0;
+}
+
+CChangeJournal::CChangeJournal() : CThread("CChangeJournal")
+{
+  m_fd = -1;
+  m_position = 0;
+}
+
+CChangeJournal::~CChangeJournal()
+{
+  Stop();
+}
+
+CChangeJournal &CChangeJournal::GetInstance()
+{
+  static CChangeJournal journal;
+  return journal;
+}
+
+bool CChangeJournal::Watch(const CStdString &path)
+{
+#ifdef HAVE_INOTIFY
+  // only local directories can be watched
+  if (path.IsEmpty() || path[0] != '/')
+    return false;
+
+  CStdString dir(path);
+  URIUtils::AddSlashAtEnd(dir);
+
+  int fd;
+  {
+    CSingleLock lock(m_section);
+    if (m_directories.find(dir) != m_directories.end())
+      return true;
+    if (m_unwatchable.find(dir) != m_unwatchable.end())
+      return false;
+
+    // changes made by other hosts to network filesystems don't raise events here
+    if (IsNetworkFilesystem(dir))
+    {
+      CLog::Log(LOGDEBUG, "%s - %s is on a network filesystem, not watching it", __FUNCTION__, dir.c_str());
+      m_unwatchable.insert(dir);
+      return false;
+    }
+
+    if (m_fd < 0)
+    {
+      m_fd = inotify_init();
+      if (m_fd < 0)
+      {
+        CLog::Log(LOGERROR, "%s - inotify_init failed (%s)", __FUNCTION__, strerror(errno));
+        return false;
+      }
+      Create();
+    }
+    fd = m_fd;
+  }
+
+  // walking a large tree takes a while, so it's done without holding up events and lookups
+  vector<CWatch> watches;
+  set< pair<uint64_t, uint64_t> > visited;
+  bool result = AddWatches(fd, dir, watches, visited);
+
+  CSingleLock lock(m_section);
+  if (m_fd != fd)
+    return false; // stopped meanwhile
+  if (!result)
+  {
+    // only drop the watches nothing else has published, inotify hands out one per directory
+    for (vector<CWatch>::const_iterator it = watches.begin(); it != watches.end(); ++it)
+    {
+      if (m_watches.find(it->wd) == m_watches.end())
+        inotify_rm_watch(m_fd, it->wd);
+    }
+    m_unwatchable.insert(dir);
+    return false;
+  }
+  if (watches.empty())
+    return false; // not there (yet)
+
+  // changes made during the walk may have been missed, so the tree is only trusted from now on
+  PublishWatches(watches, ++m_position, 0);
+
+  // trees below this one are part of it now
+  for (set<CStdString>::iterator it = m_roots.lower_bound(dir); it != m_roots.end() && IsBelow(*it, dir); )
+    m_roots.erase(it++);
+  m_roots.insert(dir);
+
+  CLog::Log(LOGDEBUG, "%s - watching %s, %"PRIuS" directories watched", __FUNCTION__, dir.c_str(), m_directories.size());
+  return true;
+#else
+  return false;
+#endif
+}
+
+void CChangeJournal::Stop()
+{
+  StopThread();
+
+  CSingleLock lock(m_section);
+#ifdef HAVE_INOTIFY
+  if (m_fd >= 0)
+    close(m_fd); // drops all watches
+#endif
+  m_fd = -1;
+  m_directories.clear();
+  m_watches.clear();
+  m_scanned.clear();
+  m_roots.clear();
+  m_unwatchable.clear();
+}
+
+int64_t CChangeJournal::GetPosition()
+{
+  CSingleLock lock(m_section);
+  return m_position;
+}
+
+void CChangeJournal::SetScanned(const string &consumer, const set<CStdString> &paths, int64_t position)
+{
+  CSingleLock lock(m_section);
+  ScannedMap &scanned = m_scanned[consumer];
+  for (set<CStdString>::const_iterator i = paths.begin(); i != paths.end(); ++i)
+  {
+    CStdString dir(*i);
+    URIUtils::AddSlashAtEnd(dir);
+
+    int64_t current;
+    if (GetScannedPosition(consumer, dir, current) && current >= position)
+      continue;
+
+    // this scan covers all of the tree, so older ones below it are of no use
+    for (ScannedMap::iterator it = scanned.lower_bound(dir); it != scanned.end() && IsBelow(it->first, dir); )
+    {
+      if (it->second <= position)
+        scanned.erase(it++);
+      else
+        ++it;
+    }
+    scanned[dir] = position;
+  }
+}
+
+bool CChangeJournal::GetScannedPosition(const string &consumer, const CStdString &path, int64_t &position) const
+{
+  map<string, ScannedMap>::const_iterator it = m_scanned.find(consumer);
+  if (it == m_scanned.end())
+    return false;
+
+  // the scan of the closest parent is the one that counts
+  CStdString dir(path);
+  while (!dir.IsEmpty())
+  {
+    ScannedMap::const_iterator scanned = it->second.find(dir);
+    if (scanned != it->second.end())
+    {
+      position = scanned->second;
+      return true;
+    }
+    size_t slash = dir.find_last_of('/', dir.size() - 2);
+    if (dir.size() < 2 || slash == CStdString::npos)
+      break;
+    dir = dir.substr(0, slash + 1);
+  }
+  return false;
+}
+
+bool CChangeJournal::IsJournalled(const string &consumer, const CStdString &path)
+{
+  CStdString dir(path);
+  URIUtils::AddSlashAtEnd(dir);
+
+  CSingleLock lock(m_section);
+  DirectoryMap::const_iterator it = m_directories.find(dir);
+  int64_t position;
+  return it != m_directories.end() && GetScannedPosition(consumer, dir, position) && it->second.watched <= position;
+}
+
+bool CChangeJournal::IsUnchanged(const string &consumer, const CStdString &path, bool recursive)
+{
+  CStdString dir(path);
+  URIUtils::AddSlashAtEnd(dir);
+
+  CSingleLock lock(m_section);
+  int64_t position;
+  if (!GetScannedPosition(consumer, dir, position))
+    return false;
+
+  DirectoryMap::const_iterator it = m_directories.find(dir);
+  if (it == m_directories.end())
+    return false;
+
+  // everything below the directory is in the map right after it
+  for (; it != m_directories.end() && IsBelow(it->first, dir); ++it)
+  {
+    if (it->second.watched > position || it->second.changed > position)
+      return false;
+    if (!recursive)
+      break;
+  }
+  return true;
+}
+
+bool CChangeJournal::GetSubdirectories(const CStdString &path, vector<CStdString> &subdirs, bool hidden)
+{
+  CStdString dir(path);
+  URIUtils::AddSlashAtEnd(dir);
+
+  CSingleLock lock(m_section);
+  DirectoryMap::const_iterator it = m_directories.find(dir);
+  if (it == m_directories.end())
+    return false;
+
+  for (++it; it != m_directories.end() && IsBelow(it->first, dir); ++it)
+  {
+    // direct children only have a slash at the end of the rest of the path
+    size_t slash = it->first.find('/', dir.size());
+    if (slash != it->first.size() - 1)
+      continue;
+    if (!hidden && it->first[dir.size()] == '.')
+      continue;
+    subdirs.push_back(it->first);
+  }
+  return true;
+}
+
+bool CChangeJournal::IsNetworkFilesystem(const CStdString &path)
+{
+#ifdef HAVE_INOTIFY
+  struct statfs fs;
+  if (statfs(path.c_str(), &fs) != 0)
+    return false; // not there (yet), the walk finds out
+
+  switch ((uint32_t)fs.f_type)
+  {
+    case NFS_SUPER_MAGIC:
+    case SMB_SUPER_MAGIC:
+    case SMB2_MAGIC_NUMBER:
+    case CIFS_MAGIC_NUMBER:
+    case FUSE_SUPER_MAGIC: // sshfs, curlftpfs and the like
+      return true;
+    default:
+      return false;
+  }
+#else
+  return false;
+#endif
+}
+
+bool CChangeJournal::AddWatch(const CStdString &path, int64_t watched, int64_t changed, set< pair<uint64_t, uint64_t> > &visited)
+{
+  vector<CWatch> watches;
+  bool result = AddWatches(m_fd, path, watches, visited);
+  PublishWatches(watches, watched, changed);
+  return result;
+}
+
+bool CChangeJournal::AddWatches(int fd, const CStdString &path, vector<CWatch> &watches, set< pair<uint64_t, uint64_t> > &visited)
+{
+#ifdef HAVE_INOTIFY
+  // a directory that is gone again is a change of its parent
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+    return true;
+
+  // symlinks may lead back up the tree
+  if (!visited.insert(make_pair((uint64_t)st.st_dev, (uint64_t)st.st_ino)).second)
+    return true;
+
+  int wd = inotify_add_watch(fd, path.c_str(), WATCH_MASK);
+  if (wd < 0)
+  {
+    if (errno == ENOENT || errno == ENOTDIR)
+      return true;
+    if (errno == ENOSPC)
+      CLog::Log(LOGWARNING, "%s - out of inotify watches at %s, raise /proc/sys/fs/inotify/max_user_watches to have it watched", __FUNCTION__, path.c_str());
+    else
+      CLog::Log(LOGWARNING, "%s - unable to watch %s (%s)", __FUNCTION__, path.c_str(), strerror(errno));
+    return false;
+  }
+
+  CWatch watch = { path, wd };
+  watches.push_back(watch);
+
+  DIR *dir = opendir(path.c_str());
+  if (!dir)
+    return true;
+  struct dirent *entry;
+  bool result = true;
+  while (result && (entry = readdir(dir)) != NULL)
+  {
+    if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
+      continue;
+    if (entry->d_type != DT_DIR && entry->d_type != DT_LNK && entry->d_type != DT_UNKNOWN)
+      continue;
+
+    CStdString subdir = path + entry->d_name;
+    struct stat subst;
+    if (stat(subdir.c_str(), &subst) != 0 || !S_ISDIR(subst.st_mode))
+      continue;
+    result = AddWatches(fd, subdir + "/", watches, visited);
+  }
+  closedir(dir);
+  return result;
+#else
+  return false;
+#endif
+}
+
+void CChangeJournal::PublishWatches(const vector<CWatch> &watches, int64_t watched, int64_t changed)
+{
+  for (vector<CWatch>::const_iterator watch = watches.begin(); watch != watches.end(); ++watch)
+  {
+    DirectoryMap::iterator it = m_directories.find(watch->path);
+    if (it == m_directories.end())
+    {
+      CDirectory &directory = m_directories[watch->path];
+      directory.wd = watch->wd;
+      directory.watched = watched;
+      directory.changed = changed;
+    }
+    else
+      it->second.wd = watch->wd; // watched already, as part of a tree below the new one
+    m_watches[watch->wd] = watch->path;
+  }
+}
+
+void CChangeJournal::RemoveWatches(const CStdString &path)
+{
+  for (DirectoryMap::iterator it = m_directories.lower_bound(path); it != m_directories.end() && IsBelow(it->first, path); )
+  {
+#ifdef HAVE_INOTIFY
+    inotify_rm_watch(m_fd, it->second.wd);
+#endif
+    m_watches.erase(it->second.wd);
+    m_directories.erase(it++);
+  }
+}
+
+void CChangeJournal::OnEvent(int wd, uint32_t mask, const char *name)
+{
+#ifdef HAVE_INOTIFY
+  if (mask & IN_Q_OVERFLOW)
+  {
+    OnOverflow();
+    return;
+  }
+
+  map<int, CStdString>::iterator watch = m_watches.find(wd);
+  if (watch == m_watches.end())
+    return;
+  CStdString path = watch->second;
+
+  if (mask & IN_IGNORED)
+  { // the directory is gone, which is a change of its parent
+    DirectoryMap::iterator it = m_directories.find(path);
+    if (it != m_directories.end() && it->second.wd == wd)
+      m_directories.erase(it);
+    m_watches.erase(watch);
+    m_roots.erase(path);
+    return;
+  }
+  if (mask & IN_MOVE_SELF)
+  { // moves within a tree are changes of the parents, a tree moved itself is gone
+    if (m_roots.erase(path))
+      RemoveWatches(path);
+    return;
+  }
+
+  DirectoryMap::iterator it = m_directories.find(path);
+  if (it == m_directories.end())
+    return;
+  it->second.changed = ++m_position;
+
+  if (!(mask & IN_ISDIR) || !*name)
+    return;
+
+  CStdString subdir = path + name + "/";
+  if (mask & (IN_DELETE | IN_MOVED_FROM))
+    RemoveWatches(subdir);
+  else if (mask & (IN_CREATE | IN_MOVED_TO))
+  { // anything in the new directory is a change too
+    set< pair<uint64_t, uint64_t> > visited;
+    if (!AddWatch(subdir, it->second.watched, m_position, visited))
+      OnOverflow();
+  }
+#endif
+}
+
+void CChangeJournal::OnOverflow()
+{
+  CLog::Log(LOGWARNING, "%s - changes were lost, trees have to be scanned again", __FUNCTION__);
+
+  // watch the trees anew, from now on
+  set<CStdString> roots;
+  roots.swap(m_roots);
+  RemoveWatches("/");
+  m_position++;
+  for (set<CStdString>::iterator it = roots.begin(); it != roots.end(); ++it)
+  {
+    set< pair<uint64_t, uint64_t> > visited;
+    if (AddWatch(*it, m_position, m_position, visited))
+      m_roots.insert(*it);
+    else
+    {
+      RemoveWatches(*it);
+      m_unwatchable.insert(*it);
+    }
+  }
+}
+
+void CChangeJournal::Process()
+{
+#ifdef HAVE_INOTIFY
+  // large enough for a few events with names of NAME_MAX
+  char buffer[16384] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+  while (!m_bStop)
+  {
+    struct pollfd fds;
+    fds.fd = m_fd;
+    fds.events = POLLIN;
+    fds.revents = 0;
+    if (poll(&fds, 1, 500) <= 0)
+      continue;
+
+    ssize_t length = read(m_fd, buffer, sizeof(buffer));
+    if (length <= 0)
+      continue;
+
+    CSingleLock lock(m_section);
+    for (char *ptr = buffer; ptr < buffer + length; )
+    {
+      struct inotify_event *event = (struct inotify_event *)ptr;
+      OnEvent(event->wd, event->mask, event->len ? event->name : "");
+      ptr += sizeof(struct inotify_event) + event->len;
+    }
+  }
+#endif
+}
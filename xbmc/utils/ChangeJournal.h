@@ -0,0 +1,134 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#pragma once
+
+#include "threads/Thread.h"
+#include "threads/CriticalSection.h"
+#include "utils/StdString.h"
+
+#include <map>
+#include <set>
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+/*!
+ \ingroup utils
+ \brief Journal of the directories that changed in watched local directory trees
+
+ Watched trees are followed with inotify where it's available. Every change to
+ the entries of a directory moves the journal position on and stamps the directory
+ with it. A consumer such as a library scanner records the position it started at
+ once it has scanned a tree completely, and can then skip the directories that
+ haven't changed since.
+
+ The journal only lives as long as XBMC runs: changes made while it isn't running
+ go unseen, so after a restart every tree has to be scanned once before it's trusted.
+ Trees that can't be watched (network URLs, NFS, SMB and FUSE mounts, whose changes
+ made elsewhere raise no events, no inotify, out of watches) are never reported
+ unchanged, so their consumers fall back to hashing.
+ */
+class CChangeJournal : public CThread
+{
+public:
+  CChangeJournal();
+  virtual ~CChangeJournal();
+
+  static CChangeJournal &GetInstance();
+
+  /*! \brief Start watching a directory tree, unless it is watched already
+   The tree is walked without holding the journal lock, so this may take a while.
+   \param path an absolute local directory path
+   \return true if the tree is watched
+   */
+  bool Watch(const CStdString &path);
+
+  /*! \brief Stop watching all trees and forget what was recorded
+   */
+  void Stop();
+
+  /*! \brief The current journal position, to be handed to SetScanned once a scan started now completes
+   */
+  int64_t GetPosition();
+
+  /*! \brief Record that a consumer has scanned the given directory trees completely
+   \param consumer name of the consumer, e.g. "music"
+   \param paths the top directories of the trees scanned
+   \param position the journal position from before the scan started
+   */
+  void SetScanned(const std::string &consumer, const std::set<CStdString> &paths, int64_t position);
+
+  /*! \brief Whether all changes below a path since the consumer last scanned it are known
+   If not, IsUnchanged returns false for everything below the path until it's scanned again.
+   */
+  bool IsJournalled(const std::string &consumer, const CStdString &path);
+
+  /*! \brief Whether a directory is known not to have changed since the consumer last scanned it
+   \param consumer name of the consumer
+   \param path the directory
+   \param recursive whether all directories below it have to be unchanged too
+   */
+  bool IsUnchanged(const std::string &consumer, const CStdString &path, bool recursive);
+
+  /*! \brief Get the subdirectories of a watched directory, so an unchanged directory needn't be listed
+   \param hidden whether to include directories whose name starts with a dot
+   \return false if the directory isn't watched
+   */
+  bool GetSubdirectories(const CStdString &path, std::vector<CStdString> &subdirs, bool hidden);
+
+protected:
+  virtual void Process();
+
+private:
+  struct CDirectory
+  {
+    int     wd;      ///< inotify watch descriptor
+    int64_t changed; ///< position of the last change to the directory
+    int64_t watched; ///< position the tree the directory is in has been watched since
+  };
+  typedef std::map<CStdString, CDirectory> DirectoryMap;
+  typedef std::map<CStdString, int64_t> ScannedMap;
+
+  struct CWatch
+  {
+    CStdString path;
+    int        wd;
+  };
+
+  static bool IsNetworkFilesystem(const CStdString &path);
+  static bool AddWatches(int fd, const CStdString &path, std::vector<CWatch> &watches, std::set< std::pair<uint64_t, uint64_t> > &visited);
+  void PublishWatches(const std::vector<CWatch> &watches, int64_t watched, int64_t changed);
+  bool AddWatch(const CStdString &path, int64_t watched, int64_t changed, std::set< std::pair<uint64_t, uint64_t> > &visited);
+  void RemoveWatches(const CStdString &path);
+  void OnEvent(int wd, uint32_t mask, const char *name);
+  void OnOverflow();
+  bool GetScannedPosition(const std::string &consumer, const CStdString &path, int64_t &position) const;
+
+  CCriticalSection m_section;
+  int m_fd;
+  int64_t m_position;
+  DirectoryMap m_directories;           ///< watched directories, each with a trailing slash
+  std::map<int, CStdString> m_watches;  ///< watch descriptor -> directory
+  std::map<std::string, ScannedMap> m_scanned; ///< per consumer the trees scanned and the position they were scanned as of
+  std::set<CStdString> m_roots;         ///< top directories of the watched trees
+  std::set<CStdString> m_unwatchable;   ///< trees that failed to be watched, not retried
+};
@@ -24,10 +24,19 @@
 #include <fribidi/fribidi.h>
 #include "LangInfo.h"
 #include "threads/SingleLock.h"
+#include "threads/ThreadLocal.h"
+#include "threads/Atomics.h"
 #include "log.h"
 
 #include <errno.h>
 #include <iconv.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
 
 #ifdef __APPLE__
 #ifdef __POWERPC__
@@ -47,21 +56,41 @@
 #endif
 
 
-static iconv_t m_iconvStringCharsetToFontCharset = (iconv_t)-1;
-static iconv_t m_iconvSubtitleCharsetToW         = (iconv_t)-1;
-static iconv_t m_iconvUtf8ToStringCharset        = (iconv_t)-1;
-static iconv_t m_iconvStringCharsetToUtf8        = (iconv_t)-1;
-static iconv_t m_iconvUcs2CharsetToStringCharset = (iconv_t)-1;
-static iconv_t m_iconvUtf32ToStringCharset       = (iconv_t)-1;
-static iconv_t m_iconvWtoUtf8                    = (iconv_t)-1;
-static iconv_t m_iconvUtf16LEtoW                 = (iconv_t)-1;
-static iconv_t m_iconvUtf16BEtoUtf8              = (iconv_t)-1;
-static iconv_t m_iconvUtf16LEtoUtf8              = (iconv_t)-1;
-static iconv_t m_iconvUtf8toW                    = (iconv_t)-1;
-static iconv_t m_iconvUcs2CharsetToUtf8          = (iconv_t)-1;
+enum IconvConversion
+{
+  IconvSubtitleCharsetToW = 0,
+  IconvUtf8ToStringCharset,
+  IconvStringCharsetToUtf8,
+  IconvUcs2CharsetToStringCharset,
+  IconvUtf32ToStringCharset,
+  IconvWtoUtf8,
+  IconvUtf16LEtoW,
+  IconvUtf16BEtoUtf8,
+  IconvUtf16LEtoUtf8,
+  IconvUtf8toW,
+  IconvUcs2CharsetToUtf8,
+  IconvConversionCount
+};
+
+// iconv handles can't be shared between threads, so every thread converts
+// with a set of its own. Sets are never freed, the set of a thread that has
+// exited is picked up by the next thread that needs one.
+struct SIconvHandles
+{
+  iconv_t        handles[IconvConversionCount];
+  long           generation;
+  volatile long  inUse;
+  SIconvHandles *next;
+};
+
+static SIconvHandles                       *g_iconvHandles = NULL;
+static CCriticalSection                     g_iconvHandlesSection;
+static XbmcThreads::ThreadLocal<SIconvHandles> g_threadIconvHandles;
+static volatile long                        g_iconvGeneration = 0;
 
 static FriBidiCharSet m_stringFribidiCharset     = FRIBIDI_CHAR_SET_NOT_FOUND;
 
+// guards libfribidi and m_stringFribidiCharset
 static CCriticalSection            m_critSection;
 
 static struct SFribidMapping
@@ -116,6 +145,499 @@ static struct SCharsetMapping
 #define ICONV_PREPARE(iconv) iconv=(iconv_t)-1
 #define ICONV_SAFE_CLOSE(iconv) if (iconv!=(iconv_t)-1) { iconv_close(iconv); iconv=(iconv_t)-1; }
 
+// Lends the calling thread its set of iconv handles for the lifetime of the object
+class CIconvHandles
+{
+public:
+  CIconvHandles()
+  {
+    m_handles = g_threadIconvHandles.get();
+    if (m_handles == NULL || cas(&m_handles->inUse, 0, 1) != 0)
+    {
+      // first conversion on this thread, or another thread has taken our set over
+      CSingleLock lock(g_iconvHandlesSection);
+      for (m_handles = g_iconvHandles; m_handles; m_handles = m_handles->next)
+      {
+        if (cas(&m_handles->inUse, 0, 1) == 0)
+          break;
+      }
+
+      if (m_handles == NULL)
+      {
+        m_handles = new SIconvHandles;
+        for (int i = 0; i < IconvConversionCount; i++)
+          ICONV_PREPARE(m_handles->handles[i]);
+        m_handles->generation = g_iconvGeneration;
+        m_handles->inUse = 1;
+        m_handles->next = g_iconvHandles;
+        g_iconvHandles = m_handles;
+      }
+      g_threadIconvHandles.set(m_handles);
+    }
+
+    // the charsets have changed since the handles were opened
+    long generation = g_iconvGeneration;
+    if (m_handles->generation != generation)
+    {
+      for (int i = 0; i < IconvConversionCount; i++)
+        ICONV_SAFE_CLOSE(m_handles->handles[i]);
+      m_handles->generation = generation;
+    }
+  }
+
+  ~CIconvHandles()
+  {
+    cas(&m_handles->inUse, 1, 0);
+  }
+
+  iconv_t &operator[](IconvConversion conversion) { return m_handles->handles[conversion]; }
+
+private:
+  SIconvHandles *m_handles;
+};
+
+//=============================================================================
+// Conversions done without iconv. They only handle input they convert exactly
+// the way iconv would and return false for anything else, e.g. invalid sequences
+// which iconv skips. Like convert_checked() the output ends at the first NUL.
+//=============================================================================
+
+// length of the run of ASCII characters at the start of str
+static size_t AsciiLength(const char *str, size_t length)
+{
+  const unsigned char *src = (const unsigned char *)str;
+  size_t i = 0;
+#if defined(__SSE2__)
+  for (; i + 16 <= length; i += 16)
+  {
+    int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(src + i)));
+    if (mask)
+      return i + __builtin_ctz(mask);
+  }
+#elif defined(__ARM_NEON__)
+  for (; i + 16 <= length; i += 16)
+  {
+    uint64x2_t high = vreinterpretq_u64_u8(vandq_u8(vld1q_u8(src + i), vdupq_n_u8(0x80)));
+    if (vgetq_lane_u64(high, 0) | vgetq_lane_u64(high, 1))
+      break;
+  }
+#else
+  for (; i + 8 <= length; i += 8)
+  {
+    uint64_t block;
+    memcpy(&block, src + i, 8);
+    if (block & 0x8080808080808080ULL)
+      break;
+  }
+#endif
+  while (i < length && src[i] < 0x80)
+    i++;
+  return i;
+}
+
+static bool IsAsciiCompatible(const CStdString &charset)
+{
+  // UTF-8 and the single byte charsets that can be chosen in the settings
+  CStdString upper(charset);
+  upper.ToUpper();
+  return upper == "UTF-8" || upper == "ASCII" || upper == "US-ASCII" || upper == "LATIN1" ||
+         upper.Left(9) == "ISO-8859-" || upper.Left(5) == "CP125" || upper.Left(11) == "WINDOWS-125";
+}
+
+static bool IsLatin1(const CStdString &charset)
+{
+  return charset.Equals("ISO-8859-1") || charset.Equals("LATIN1") || charset.Equals("ISO8859-1");
+}
+
+// where the string ends for iconv, which converts the terminating NUL along with it
+template<class CHAR>
+static size_t TerminatedLength(const CHAR *str, size_t length)
+{
+  for (size_t i = 0; i < length; i++)
+  {
+    if (str[i] == 0)
+      return i;
+  }
+  return length;
+}
+
+static size_t TerminatedLength(const char *str, size_t length)
+{
+  const char *nul = (const char *)memchr(str, 0, length);
+  return nul ? nul - str : length;
+}
+
+static void AsciiToW(const char *str, size_t length, wchar_t *dest)
+{
+  const unsigned char *src = (const unsigned char *)str;
+  size_t i = 0;
+#if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 16 <= length; i += 16)
+  {
+    __m128i bytes = _mm_loadu_si128((const __m128i *)(src + i));
+    __m128i low = _mm_unpacklo_epi8(bytes, zero);
+    __m128i high = _mm_unpackhi_epi8(bytes, zero);
+    if (sizeof(wchar_t) == 2)
+    {
+      _mm_storeu_si128((__m128i *)(dest + i), low);
+      _mm_storeu_si128((__m128i *)(dest + i + 8), high);
+    }
+    else
+    {
+      _mm_storeu_si128((__m128i *)(dest + i), _mm_unpacklo_epi16(low, zero));
+      _mm_storeu_si128((__m128i *)(dest + i + 4), _mm_unpackhi_epi16(low, zero));
+      _mm_storeu_si128((__m128i *)(dest + i + 8), _mm_unpacklo_epi16(high, zero));
+      _mm_storeu_si128((__m128i *)(dest + i + 12), _mm_unpackhi_epi16(high, zero));
+    }
+  }
+#elif defined(__ARM_NEON__)
+  if (sizeof(wchar_t) == 4)
+  {
+    for (; i + 16 <= length; i += 16)
+    {
+      uint8x16_t bytes = vld1q_u8(src + i);
+      uint16x8_t low = vmovl_u8(vget_low_u8(bytes));
+      uint16x8_t high = vmovl_u8(vget_high_u8(bytes));
+      vst1q_u32((uint32_t *)(dest + i), vmovl_u16(vget_low_u16(low)));
+      vst1q_u32((uint32_t *)(dest + i + 4), vmovl_u16(vget_high_u16(low)));
+      vst1q_u32((uint32_t *)(dest + i + 8), vmovl_u16(vget_low_u16(high)));
+      vst1q_u32((uint32_t *)(dest + i + 12), vmovl_u16(vget_high_u16(high)));
+    }
+  }
+#endif
+  for (; i < length; i++)
+    dest[i] = src[i];
+}
+
+// number of ASCII characters at the start of a wide string, and the same narrowed into dest
+static size_t NarrowAscii(const wchar_t *src, size_t length, char *dest)
+{
+  size_t i = 0;
+#if defined(__SSE2__)
+  if (sizeof(wchar_t) == 4)
+  {
+    const __m128i high = _mm_set1_epi32(~0x7f);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= length; i += 16)
+    {
+      __m128i a = _mm_loadu_si128((const __m128i *)(src + i));
+      __m128i b = _mm_loadu_si128((const __m128i *)(src + i + 4));
+      __m128i c = _mm_loadu_si128((const __m128i *)(src + i + 8));
+      __m128i d = _mm_loadu_si128((const __m128i *)(src + i + 12));
+      __m128i any = _mm_and_si128(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)), high);
+      if (_mm_movemask_epi8(_mm_cmpeq_epi32(any, zero)) != 0xffff)
+        break;
+      __m128i words = _mm_packs_epi32(a, b);
+      __m128i words2 = _mm_packs_epi32(c, d);
+      _mm_storeu_si128((__m128i *)(dest + i), _mm_packus_epi16(words, words2));
+    }
+  }
+  else
+  {
+    const __m128i high = _mm_set1_epi16(~0x7f);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= length; i += 16)
+    {
+      __m128i a = _mm_loadu_si128((const __m128i *)(src + i));
+      __m128i b = _mm_loadu_si128((const __m128i *)(src + i + 8));
+      __m128i any = _mm_and_si128(_mm_or_si128(a, b), high);
+      if (_mm_movemask_epi8(_mm_cmpeq_epi16(any, zero)) != 0xffff)
+        break;
+      _mm_storeu_si128((__m128i *)(dest + i), _mm_packus_epi16(a, b));
+    }
+  }
+#endif
+  for (; i < length && (unsigned long)src[i] < 0x80; i++)
+    dest[i] = (char)src[i];
+  return i;
+}
+
+static inline char *EncodeUtf8(unsigned long code, char *dest)
+{
+  if (code < 0x80)
+    *dest++ = (char)code;
+  else if (code < 0x800)
+  {
+    *dest++ = (char)(0xc0 | (code >> 6));
+    *dest++ = (char)(0x80 | (code & 0x3f));
+  }
+  else if (code < 0x10000)
+  {
+    *dest++ = (char)(0xe0 | (code >> 12));
+    *dest++ = (char)(0x80 | ((code >> 6) & 0x3f));
+    *dest++ = (char)(0x80 | (code & 0x3f));
+  }
+  else
+  {
+    *dest++ = (char)(0xf0 | (code >> 18));
+    *dest++ = (char)(0x80 | ((code >> 12) & 0x3f));
+    *dest++ = (char)(0x80 | ((code >> 6) & 0x3f));
+    *dest++ = (char)(0x80 | (code & 0x3f));
+  }
+  return dest;
+}
+
+// decodes a well formed UTF-8 sequence (RFC 3629), returns 0 for anything else
+static inline size_t DecodeUtf8(const unsigned char *src, size_t length, unsigned long &code)
+{
+  unsigned char c = src[0];
+  if (c < 0x80)
+  {
+    code = c;
+    return 1;
+  }
+  if (c < 0xc2 || c > 0xf4)
+    return 0;
+
+  size_t size = c < 0xe0 ? 2 : (c < 0xf0 ? 3 : 4);
+  if (size > length)
+    return 0;
+  code = c & (0x7f >> size);
+  for (size_t i = 1; i < size; i++)
+  {
+    if ((src[i] & 0xc0) != 0x80)
+      return 0;
+    code = (code << 6) | (src[i] & 0x3f);
+  }
+
+  // overlong forms, surrogates and values past the last code point
+  if ((size == 3 && code < 0x800) || (size == 4 && (code < 0x10000 || code > 0x10ffff)) ||
+      (code >= 0xd800 && code <= 0xdfff))
+    return 0;
+  return size;
+}
+
+static bool Utf8ToWFast(const CStdStringA &source, CStdStringW &dest)
+{
+  size_t length = TerminatedLength(source.c_str(), source.length());
+  size_t ascii = AsciiLength(source.c_str(), length);
+#ifdef __APPLE__
+  // UTF-8-MAC composes characters, leave anything but ASCII to iconv
+  if (ascii < length)
+    return false;
+#endif
+
+  // a wide character for each byte is always enough
+  CStdStringW result;
+  wchar_t *out = result.GetBuffer(length + 1);
+  AsciiToW(source.c_str(), ascii, out);
+  wchar_t *end = out + ascii;
+
+  const unsigned char *src = (const unsigned char *)source.c_str();
+  for (size_t i = ascii; i < length; )
+  {
+    if (src[i] < 0x80)
+    {
+      // back to a run of ASCII
+      size_t run = AsciiLength((const char *)src + i, length - i);
+      AsciiToW((const char *)src + i, run, end);
+      end += run;
+      i += run;
+      continue;
+    }
+
+    unsigned long code;
+    size_t size = DecodeUtf8(src + i, length - i, code);
+    if (size == 0)
+    {
+      result.ReleaseBuffer(0);
+      return false;
+    }
+    i += size;
+
+    if (sizeof(wchar_t) == 2 && code >= 0x10000)
+    {
+      code -= 0x10000;
+      *end++ = (wchar_t)(0xd800 | (code >> 10));
+      *end++ = (wchar_t)(0xdc00 | (code & 0x3ff));
+    }
+    else
+      *end++ = (wchar_t)code;
+  }
+
+  result.ReleaseBuffer(end - out);
+  dest.swap(result);
+  return true;
+}
+
+static bool WToUtf8Fast(const CStdStringW &source, CStdStringA &dest)
+{
+  size_t length = TerminatedLength(source.c_str(), source.length());
+  const wchar_t *src = source.c_str();
+
+  // ASCII is the common case, narrow that without reserving for the worst
+  CStdStringA result;
+  char *out = result.GetBuffer(length + 1);
+  size_t ascii = NarrowAscii(src, length, out);
+  if (ascii == length)
+  {
+    result.ReleaseBuffer(length);
+    dest.swap(result);
+    return true;
+  }
+
+  // up to 3 bytes per UTF-16 unit or 4 per UTF-32 one
+  CStdStringA wide;
+  out = wide.GetBuffer(ascii + (length - ascii) * (sizeof(wchar_t) == 2 ? 3 : 4) + 1);
+  memcpy(out, result.c_str(), ascii);
+  char *end = out + ascii;
+  for (size_t i = ascii; i < length; i++)
+  {
+    unsigned long code = (unsigned long)src[i];
+    if (code < 0x80)
+    {
+      *end++ = (char)code;
+      continue;
+    }
+    if (sizeof(wchar_t) == 2 && code >= 0xd800 && code <= 0xdbff && i + 1 < length &&
+        (unsigned long)src[i + 1] >= 0xdc00 && (unsigned long)src[i + 1] <= 0xdfff)
+    {
+      code = 0x10000 + ((code - 0xd800) << 10) + ((unsigned long)src[i + 1] - 0xdc00);
+      i++;
+    }
+    else if ((code >= 0xd800 && code <= 0xdfff) || code > 0x10ffff)
+    {
+      wide.ReleaseBuffer(0);
+      return false;
+    }
+    end = EncodeUtf8(code, end);
+  }
+
+  wide.ReleaseBuffer(end - out);
+  dest.swap(wide);
+  return true;
+}
+
+// UTF-16 (or UCS-2, which has no surrogates) in the given byte order to UTF-8
+static bool Utf16ToUtf8Fast(const CStdString16 &source, bool bigEndian, bool surrogates, CStdStringA &dest)
+{
+  size_t length = source.length();
+  const unsigned char *src = (const unsigned char *)source.c_str();
+  int high = bigEndian ? 0 : 1;
+  int low = bigEndian ? 1 : 0;
+
+  CStdStringA result;
+  char *out = result.GetBuffer(length * 3 + 1);
+  char *end = out;
+  for (size_t i = 0; i < length; i++)
+  {
+    unsigned long code = (src[2 * i + high] << 8) | src[2 * i + low];
+    if (code < 0x80)
+    {
+      if (code == 0)
+        break;
+      *end++ = (char)code;
+      continue;
+    }
+    if (code >= 0xd800 && code <= 0xdfff)
+    {
+      unsigned long next = i + 1 < length ? (unsigned long)((src[2 * i + 2 + high] << 8) | src[2 * i + 2 + low]) : 0;
+      if (!surrogates || code > 0xdbff || next < 0xdc00 || next > 0xdfff)
+      {
+        result.ReleaseBuffer(0);
+        return false;
+      }
+      code = 0x10000 + ((code - 0xd800) << 10) + (next - 0xdc00);
+      i++;
+    }
+    end = EncodeUtf8(code, end);
+  }
+
+  result.ReleaseBuffer(end - out);
+  dest.swap(result);
+  return true;
+}
+
+static bool Utf16LEToWFast(const CStdString16 &source, CStdStringW &dest)
+{
+  if (sizeof(wchar_t) == 2)
+  {
+    // nothing to convert, only check for unpaired surrogates, which iconv skips
+    size_t length = TerminatedLength(source.c_str(), source.length());
+    for (size_t i = 0; i < length; i++)
+    {
+      uint16_t unit = source[i];
+      if (unit >= 0xd800 && unit <= 0xdfff)
+      {
+        if (unit > 0xdbff || i + 1 >= length || source[i + 1] < 0xdc00 || source[i + 1] > 0xdfff)
+          return false;
+        i++;
+      }
+    }
+    dest.assign((const wchar_t *)source.c_str(), length);
+    return true;
+  }
+
+  size_t length = source.length();
+  const unsigned char *src = (const unsigned char *)source.c_str();
+  CStdStringW result;
+  wchar_t *out = result.GetBuffer(length + 1);
+  wchar_t *end = out;
+  for (size_t i = 0; i < length; i++)
+  {
+    unsigned long code = (src[2 * i + 1] << 8) | src[2 * i];
+    if (code == 0)
+      break;
+    if (code >= 0xd800 && code <= 0xdfff)
+    {
+      unsigned long next = i + 1 < length ? (unsigned long)((src[2 * i + 3] << 8) | src[2 * i + 2]) : 0;
+      if (code > 0xdbff || next < 0xdc00 || next > 0xdfff)
+      {
+        result.ReleaseBuffer(0);
+        return false;
+      }
+      code = 0x10000 + ((code - 0xd800) << 10) + (next - 0xdc00);
+      i++;
+    }
+    *end++ = (wchar_t)code;
+  }
+
+  result.ReleaseBuffer(end - out);
+  dest.swap(result);
+  return true;
+}
+
+static void Latin1ToUtf8(const CStdStringA &source, CStdStringA &dest)
+{
+  size_t length = TerminatedLength(source.c_str(), source.length());
+  const unsigned char *src = (const unsigned char *)source.c_str();
+
+  CStdStringA result;
+  char *out = result.GetBuffer(length * 2 + 1);
+  char *end = out;
+  for (size_t i = 0; i < length; )
+  {
+    size_t run = AsciiLength((const char *)src + i, length - i);
+    memcpy(end, src + i, run);
+    end += run;
+    i += run;
+    if (i < length)
+    {
+      *end++ = (char)(0xc0 | (src[i] >> 6));
+      *end++ = (char)(0x80 | (src[i] & 0x3f));
+      i++;
+    }
+  }
+
+  result.ReleaseBuffer(end - out);
+  dest.swap(result);
+}
+
+// ASCII input for an ASCII compatible charset stays the same
+static bool AsciiFast(const CStdStringA &source, const CStdString &charset, CStdStringA &dest)
+{
+  size_t length = TerminatedLength(source.c_str(), source.length());
+  if (AsciiLength(source.c_str(), length) < length || !IsAsciiCompatible(charset))
+    return false;
+
+  if (length == source.length())
+    dest = source;
+  else
+    dest.assign(source.c_str(), length);
+  return true;
+}
+
 size_t iconv_const (void* cd, const char** inbuf, size_t *inbytesleft,
                     char* * outbuf, size_t *outbytesleft)
 {
@@ -364,17 +886,8 @@ void CCharsetConverter::reset(void)
 {
   CSingleLock lock(m_critSection);
 
-  ICONV_SAFE_CLOSE(m_iconvStringCharsetToFontCharset);
-  ICONV_SAFE_CLOSE(m_iconvUtf8ToStringCharset);
-  ICONV_SAFE_CLOSE(m_iconvStringCharsetToUtf8);
-  ICONV_SAFE_CLOSE(m_iconvUcs2CharsetToStringCharset);
-  ICONV_SAFE_CLOSE(m_iconvSubtitleCharsetToW);
-  ICONV_SAFE_CLOSE(m_iconvWtoUtf8);
-  ICONV_SAFE_CLOSE(m_iconvUtf16BEtoUtf8);
-  ICONV_SAFE_CLOSE(m_iconvUtf16LEtoUtf8);
-  ICONV_SAFE_CLOSE(m_iconvUtf32ToStringCharset);
-  ICONV_SAFE_CLOSE(m_iconvUtf8toW);
-  ICONV_SAFE_CLOSE(m_iconvUcs2CharsetToUtf8);
+  // each thread reopens its handles with its next conversion
+  AtomicIncrement(&g_iconvGeneration);
 
 
   m_stringFribidiCharset = FRIBIDI_CHAR_SET_NOT_FOUND;
@@ -391,27 +904,37 @@ void CCharsetConverter::reset(void)
 // of the string is already made or the string is not displayed in the GUI
 void CCharsetConverter::utf8ToW(const CStdStringA& utf8String, CStdStringW &wString, bool bVisualBiDiFlip/*=true*/, bool forceLTRReadingOrder /*=false*/, bool* bWasFlipped/*=NULL*/)
 {
-  // Try to flip hebrew/arabic characters, if any
-  if (bVisualBiDiFlip)
+  // Try to flip hebrew/arabic characters, if any. A single line of ASCII has none
+  // (flipping also joins lines, which is left to fribidi)
+  if (bVisualBiDiFlip && (AsciiLength(utf8String.c_str(), utf8String.length()) < utf8String.length() ||
+                          utf8String.find('\n') != CStdStringA::npos))
   {
     CStdStringA strFlipped;
     FriBidiCharType charset = forceLTRReadingOrder ? FRIBIDI_TYPE_LTR : FRIBIDI_TYPE_PDF;
     logicalToVisualBiDi(utf8String, strFlipped, FRIBIDI_CHAR_SET_UTF8, charset, bWasFlipped);
-    CSingleLock lock(m_critSection);
-    convert(m_iconvUtf8toW,sizeof(wchar_t),UTF8_SOURCE,WCHAR_CHARSET,strFlipped,wString);
+    if (!Utf8ToWFast(strFlipped, wString))
+    {
+      CIconvHandles handles;
+      convert(handles[IconvUtf8toW],sizeof(wchar_t),UTF8_SOURCE,WCHAR_CHARSET,strFlipped,wString);
+    }
   }
   else
   {
-    CSingleLock lock(m_critSection);
-    convert(m_iconvUtf8toW,sizeof(wchar_t),UTF8_SOURCE,WCHAR_CHARSET,utf8String,wString);
+    if (bWasFlipped)
+      *bWasFlipped = false;
+    if (!Utf8ToWFast(utf8String, wString))
+    {
+      CIconvHandles handles;
+      convert(handles[IconvUtf8toW],sizeof(wchar_t),UTF8_SOURCE,WCHAR_CHARSET,utf8String,wString);
+    }
   }
 }
 
 void CCharsetConverter::subtitleCharsetToW(const CStdStringA& strSource, CStdStringW& strDest)
 {
   // No need to flip hebrew/arabic as mplayer does the flipping
-  CSingleLock lock(m_critSection);
-  convert(m_iconvSubtitleCharsetToW,sizeof(wchar_t),g_langInfo.GetSubtitleCharSet(),WCHAR_CHARSET,strSource,strDest);
+  CIconvHandles handles;
+  convert(handles[IconvSubtitleCharsetToW],sizeof(wchar_t),g_langInfo.GetSubtitleCharSet(),WCHAR_CHARSET,strSource,strDest);
 }
 
 void CCharsetConverter::fromW(const CStdStringW& strSource,
@@ -434,8 +957,12 @@ void CCharsetConverter::toW(const CStdStringA& strSource,
 
 void CCharsetConverter::utf8ToStringCharset(const CStdStringA& strSource, CStdStringA& strDest)
 {
-  CSingleLock lock(m_critSection);
-  convert(m_iconvUtf8ToStringCharset,1,UTF8_SOURCE,g_langInfo.GetGuiCharSet(),strSource,strDest);
+  CStdString strCharset = g_langInfo.GetGuiCharSet();
+  if (AsciiFast(strSource, strCharset, strDest))
+    return;
+
+  CIconvHandles handles;
+  convert(handles[IconvUtf8ToStringCharset],1,UTF8_SOURCE,strCharset,strSource,strDest);
 }
 
 void CCharsetConverter::utf8ToStringCharset(CStdStringA& strSourceDest)
@@ -447,6 +974,14 @@ void CCharsetConverter::utf8ToStringCharset(CStdStringA& strSourceDest)
 
 void CCharsetConverter::stringCharsetToUtf8(const CStdStringA& strSourceCharset, const CStdStringA& strSource, CStdStringA& strDest)
 {
+  if (AsciiFast(strSource, strSourceCharset, strDest))
+    return;
+  if (IsLatin1(strSourceCharset))
+  {
+    Latin1ToUtf8(strSource, strDest);
+    return;
+  }
+
   iconv_t iconvString;
   ICONV_PREPARE(iconvString);
   convert(iconvString,UTF8_DEST_MULTIPLIER,strSourceCharset,"UTF-8",strSource,strDest);
@@ -460,6 +995,9 @@ void CCharsetConverter::utf8To(const CStdStringA& strDestCharset, const CStdStri
     strDest = strSource;
     return;
   }
+  if (AsciiFast(strSource, strDestCharset, strDest))
+    return;
+
   iconv_t iconvString;
   ICONV_PREPARE(iconvString);
   convert(iconvString,UTF8_DEST_MULTIPLIER,UTF8_SOURCE,strDestCharset,strSource,strDest);
@@ -497,43 +1035,65 @@ void CCharsetConverter::unknownToUTF8(const CStdStringA &source, CStdStringA &de
     dest = source;
   else
   {
-    CSingleLock lock(m_critSection);
-    convert(m_iconvStringCharsetToUtf8, UTF8_DEST_MULTIPLIER, g_langInfo.GetGuiCharSet(), "UTF-8", source, dest);
+    CStdString strCharset = g_langInfo.GetGuiCharSet();
+    if (IsLatin1(strCharset))
+    {
+      Latin1ToUtf8(source, dest);
+      return;
+    }
+
+    CIconvHandles handles;
+    convert(handles[IconvStringCharsetToUtf8], UTF8_DEST_MULTIPLIER, strCharset, "UTF-8", source, dest);
   }
 }
 
 void CCharsetConverter::wToUTF8(const CStdStringW& strSource, CStdStringA &strDest)
 {
-  CSingleLock lock(m_critSection);
-  convert(m_iconvWtoUtf8,UTF8_DEST_MULTIPLIER,WCHAR_CHARSET,"UTF-8",strSource,strDest);
+  if (WToUtf8Fast(strSource, strDest))
+    return;
+
+  CIconvHandles handles;
+  convert(handles[IconvWtoUtf8],UTF8_DEST_MULTIPLIER,WCHAR_CHARSET,"UTF-8",strSource,strDest);
 }
 
 void CCharsetConverter::utf16BEtoUTF8(const CStdString16& strSource, CStdStringA &strDest)
 {
-  CSingleLock lock(m_critSection);
-  if(!convert_checked(m_iconvUtf16BEtoUtf8,UTF8_DEST_MULTIPLIER,"UTF-16BE","UTF-8",strSource,strDest))
+  if (Utf16ToUtf8Fast(strSource, true, true, strDest))
+    return;
+
+  CIconvHandles handles;
+  if(!convert_checked(handles[IconvUtf16BEtoUtf8],UTF8_DEST_MULTIPLIER,"UTF-16BE","UTF-8",strSource,strDest))
     strDest.empty();
 }
 
 void CCharsetConverter::utf16LEtoUTF8(const CStdString16& strSource,
                                       CStdStringA &strDest)
 {
-  CSingleLock lock(m_critSection);
-  if(!convert_checked(m_iconvUtf16LEtoUtf8,UTF8_DEST_MULTIPLIER,"UTF-16LE","UTF-8",strSource,strDest))
+  if (Utf16ToUtf8Fast(strSource, false, true, strDest))
+    return;
+
+  CIconvHandles handles;
+  if(!convert_checked(handles[IconvUtf16LEtoUtf8],UTF8_DEST_MULTIPLIER,"UTF-16LE","UTF-8",strSource,strDest))
     strDest.empty();
 }
 
 void CCharsetConverter::ucs2ToUTF8(const CStdString16& strSource, CStdStringA& strDest)
 {
-  CSingleLock lock(m_critSection);
-  if(!convert_checked(m_iconvUcs2CharsetToUtf8,UTF8_DEST_MULTIPLIER,"UCS-2LE","UTF-8",strSource,strDest))
+  if (Utf16ToUtf8Fast(strSource, false, false, strDest))
+    return;
+
+  CIconvHandles handles;
+  if(!convert_checked(handles[IconvUcs2CharsetToUtf8],UTF8_DEST_MULTIPLIER,"UCS-2LE","UTF-8",strSource,strDest))
     strDest.empty();
 }
 
 void CCharsetConverter::utf16LEtoW(const CStdString16& strSource, CStdStringW &strDest)
 {
-  CSingleLock lock(m_critSection);
-  if(!convert_checked(m_iconvUtf16LEtoW,sizeof(wchar_t),"UTF-16LE",WCHAR_CHARSET,strSource,strDest))
+  if (Utf16LEToWFast(strSource, strDest))
+    return;
+
+  CIconvHandles handles;
+  if(!convert_checked(handles[IconvUtf16LEtoW],sizeof(wchar_t),"UTF-16LE",WCHAR_CHARSET,strSource,strDest))
     strDest.empty();
 }
 
@@ -554,22 +1114,23 @@ void CCharsetConverter::ucs2CharsetToStringCharset(const CStdStringW& strSource,
       s++;
     }
   }
-  CSingleLock lock(m_critSection);
-  convert(m_iconvUcs2CharsetToStringCharset,4,"UTF-16LE",
+  CIconvHandles handles;
+  convert(handles[IconvUcs2CharsetToStringCharset],4,"UTF-16LE",
           g_langInfo.GetGuiCharSet(),strCopy,strDest);
 }
 
 void CCharsetConverter::utf32ToStringCharset(const unsigned long* strSource, CStdStringA& strDest)
 {
-  CSingleLock lock(m_critSection);
+  CIconvHandles handles;
+  iconv_t &handle = handles[IconvUtf32ToStringCharset];
 
-  if (m_iconvUtf32ToStringCharset == (iconv_t) - 1)
+  if (handle == (iconv_t) - 1)
   {
     CStdString strCharset=g_langInfo.GetGuiCharSet();
-    m_iconvUtf32ToStringCharset = iconv_open(strCharset.c_str(), "UTF-32LE");
+    handle = iconv_open(strCharset.c_str(), "UTF-32LE");
   }
 
-  if (m_iconvUtf32ToStringCharset != (iconv_t) - 1)
+  if (handle != (iconv_t) - 1)
   {
     const unsigned long* ptr=strSource;
     while (*ptr) ptr++;
@@ -579,7 +1140,7 @@ void CCharsetConverter::utf32ToStringCharset(const unsigned long* strSource, CSt
     char *dst = strDest.GetBuffer(inBytes);
     size_t outBytes = inBytes;
 
-    if (iconv_const(m_iconvUtf32ToStringCharset, &src, &inBytes, &dst, &outBytes) == (size_t)-1)
+    if (iconv_const(handle, &src, &inBytes, &dst, &outBytes) == (size_t)-1)
     {
       CLog::Log(LOGERROR, "%s failed", __FUNCTION__);
       strDest.ReleaseBuffer();
@@ -587,7 +1148,7 @@ void CCharsetConverter::utf32ToStringCharset(const unsigned long* strSource, CSt
       return;
     }
 
-    if (iconv(m_iconvUtf32ToStringCharset, NULL, NULL, &dst, &outBytes) == (size_t)-1)
+    if (iconv(handle, NULL, NULL, &dst, &outBytes) == (size_t)-1)
     {
       CLog::Log(LOGERROR, "%s failed cleanup", __FUNCTION__);
       strDest.ReleaseBuffer();
@@ -615,6 +1176,13 @@ bool CCharsetConverter::isValidUtf8(const char *buf, unsigned int len)
 
   while ((unsigned char*)buf != endbuf)
   {
+    if (!trailing)
+    {
+      // skip a run of ASCII in one go
+      buf += AsciiLength(buf, (const char*)endbuf - buf);
+      if ((unsigned char*)buf == endbuf)
+        break;
+    }
     c = *buf++;
     if (trailing)
       if ((c & 0xc0) == 0x80) // does trailing byte follow UTF-8 format ?
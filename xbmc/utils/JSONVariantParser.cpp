@@ -35,9 +35,10 @@ yajl_callbacks CJSONVariantParser::callbacks = {
   CJSONVariantParser::ParseArrayEnd
 };
 
-CJSONVariantParser::CJSONVariantParser(IParseCallback *callback)
+CJSONVariantParser::CJSONVariantParser(IParseCallback *callback, CVariant *root /* = NULL */)
 {
   m_callback = callback;
+  m_root = root;
 
 #if YAJL_MAJOR == 2
   m_handler = yajl_alloc(&callbacks, NULL, this);
@@ -51,21 +52,37 @@ CJSONVariantParser::CJSONVariantParser(IParseCallback *callback)
 #endif
 
   m_status = ParseVariable;
+  m_completed = false;
 }
 
 CJSONVariantParser::~CJSONVariantParser()
 {
+  complete_parse();
+  yajl_free(m_handler);
+}
+
+bool CJSONVariantParser::push_buffer(const unsigned char *buffer, unsigned int length)
+{
+  yajl_status status = yajl_parse(m_handler, buffer, length);
 #if YAJL_MAJOR == 2
-  yajl_complete_parse(m_handler);
+  return status == yajl_status_ok;
 #else
-  yajl_parse_complete(m_handler);
+  // yajl 1 only reports ok once a whole value has been parsed
+  return status == yajl_status_ok || status == yajl_status_insufficient_data;
 #endif
-  yajl_free(m_handler);
 }
 
-void CJSONVariantParser::push_buffer(const unsigned char *buffer, unsigned int length)
+bool CJSONVariantParser::complete_parse()
 {
-  yajl_parse(m_handler, buffer, length);
+  if (m_completed)
+    return true;
+  m_completed = true;
+
+#if YAJL_MAJOR == 2
+  return yajl_complete_parse(m_handler) == yajl_status_ok;
+#else
+  return yajl_parse_complete(m_handler) == yajl_status_ok;
+#endif
 }
 
 CVariant CJSONVariantParser::Parse(const unsigned char *json, unsigned int length)
@@ -78,6 +95,16 @@ CVariant CJSONVariantParser::Parse(const unsigned char *json, unsigned int lengt
   return callback.GetOutput();
 }
 
+void CJSONVariantParser::Parse(const unsigned char *json, unsigned int length, CVariant &output)
+{
+  CJSONVariantParser parser(NULL, &output);
+
+  // the tree is built as the document is parsed, so drop what there is of it if it's no good
+  bool parsed = parser.push_buffer(json, length);
+  if (!parser.complete_parse() || !parsed)
+    output = CVariant::VariantTypeNull;
+}
+
 int CJSONVariantParser::ParseNull(void * ctx)
 {
   CJSONVariantParser *parser = (CJSONVariantParser *)ctx;
@@ -185,12 +212,13 @@ int CJSONVariantParser::ParseArrayEnd(void * ctx)
   return 1;
 }
 
-void CJSONVariantParser::PushObject(CVariant variant)
+void CJSONVariantParser::PushObject(const CVariant &variant)
 {
   if (m_status == ParseObject)
   {
-    (*m_parse[m_parse.size() - 1])[m_key] = variant;
-    m_parse.push_back(&(*m_parse[m_parse.size() - 1])[m_key]);
+    CVariant &member = (*m_parse[m_parse.size() - 1])[m_key];
+    member = variant;
+    m_parse.push_back(&member);
   }
   else if (m_status == ParseArray)
   {
@@ -200,7 +228,13 @@ void CJSONVariantParser::PushObject(CVariant variant)
   }
   else if (m_parse.size() == 0)
   {
-    m_parse.push_back(new CVariant(variant));
+    if (m_root)
+    {
+      *m_root = variant;
+      m_parse.push_back(m_root);
+    }
+    else
+      m_parse.push_back(new CVariant(variant));
   }
 
   if (variant.isObject())
@@ -226,6 +260,13 @@ void CJSONVariantParser::PopObject()
     else
       m_status = ParseVariable;
   }
+  else if (variant == m_root)
+  {
+    if (m_callback)
+      m_callback->onParsed(variant);
+
+    m_status = ParseVariable;
+  }
   else if (m_callback)
   {
     m_callback->onParsed(variant);
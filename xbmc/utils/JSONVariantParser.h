@@ -50,13 +50,22 @@ private:
 class CJSONVariantParser
 {
 public:
-  CJSONVariantParser(IParseCallback *callback);
+  CJSONVariantParser(IParseCallback *callback, CVariant *root = NULL);
   ~CJSONVariantParser();
 
-  void push_buffer(const unsigned char *buffer, unsigned int length);
+  bool push_buffer(const unsigned char *buffer, unsigned int length);
+  bool complete_parse();
 
   static CVariant Parse(const unsigned char *json, unsigned int length);
 
+  /*!
+   \brief Parses a JSON document into the given variant
+   The variant can be one constructed with a CVariantArena, in which case
+   the whole tree is allocated from the arena. It is null if there's
+   nothing to parse or the document is malformed or incomplete.
+   */
+  static void Parse(const unsigned char *json, unsigned int length, CVariant &output);
+
 private:
   static int ParseNull(void * ctx);
   static int ParseBoolean(void * ctx, int boolean);
@@ -81,15 +90,17 @@ private:
   static int ParseArrayStart(void * ctx);
   static int ParseArrayEnd(void * ctx);
 
-  void PushObject(CVariant variant);
+  void PushObject(const CVariant &variant);
   void PopObject();
 
   static yajl_callbacks callbacks;
 
   IParseCallback *m_callback;
   yajl_handle m_handler;
+  bool m_completed;
 
   CVariant m_parsedObject;
+  CVariant *m_root;
   std::vector<CVariant *> m_parse;
   std::string m_key;
 
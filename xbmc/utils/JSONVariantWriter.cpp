@@ -29,39 +29,14 @@ string CJSONVariantWriter::Write(const CVariant &value, bool compact)
 {
   string output;
 
-#if YAJL_MAJOR == 2
-  yajl_gen g = yajl_gen_alloc(NULL);
-  yajl_gen_config(g, yajl_gen_beautify, compact ? 0 : 1);
-  yajl_gen_config(g, yajl_gen_indent_string, "\t");
-#else
-  yajl_gen_config conf = { compact ? 0 : 1, "\t" };
-  yajl_gen g = yajl_gen_alloc(&conf, NULL);
-#endif
-
-  // Set locale to classic ("C") to ensure valid JSON numbers
-  std::string currentLocale = setlocale(LC_NUMERIC, NULL);
-  setlocale(LC_NUMERIC, "C");
-
-  if (InternalWrite(g, value))
+  CJSONStreamWriter writer(compact);
+  if (writer.Value(value))
   {
-    const unsigned char * buffer;
-
-#if YAJL_MAJOR == 2
     size_t length;
-    yajl_gen_get_buf(g, &buffer, &length);
-#else
-    unsigned int length;
-    yajl_gen_get_buf(g, &buffer, &length);
-#endif
-    output = string((const char *)buffer, length);
+    const char *buffer = writer.GetBuffer(length);
+    output = string(buffer, length);
   }
 
-  // Re-set locale to what it was before using yajl
-  setlocale(LC_NUMERIC, currentLocale.c_str());
-
-  yajl_gen_clear(g);
-  yajl_gen_free(g);
-
   return output;
 }
 
@@ -135,3 +110,84 @@ bool CJSONVariantWriter::InternalWrite(yajl_gen g, const CVariant &value)
 
   return success;
 }
+
+CJSONStreamWriter::CJSONStreamWriter(bool compact)
+{
+#if YAJL_MAJOR == 2
+  m_gen = yajl_gen_alloc(NULL);
+  yajl_gen_config(m_gen, yajl_gen_beautify, compact ? 0 : 1);
+  yajl_gen_config(m_gen, yajl_gen_indent_string, "\t");
+#else
+  yajl_gen_config conf = { compact ? 0 : 1, "\t" };
+  m_gen = yajl_gen_alloc(&conf, NULL);
+#endif
+}
+
+CJSONStreamWriter::~CJSONStreamWriter()
+{
+  yajl_gen_clear(m_gen);
+  yajl_gen_free(m_gen);
+}
+
+bool CJSONStreamWriter::BeginObject()
+{
+  return yajl_gen_status_ok == yajl_gen_map_open(m_gen);
+}
+
+bool CJSONStreamWriter::EndObject()
+{
+  return yajl_gen_status_ok == yajl_gen_map_close(m_gen);
+}
+
+bool CJSONStreamWriter::BeginArray()
+{
+  return yajl_gen_status_ok == yajl_gen_array_open(m_gen);
+}
+
+bool CJSONStreamWriter::EndArray()
+{
+  return yajl_gen_status_ok == yajl_gen_array_close(m_gen);
+}
+
+bool CJSONStreamWriter::Key(const string &key)
+{
+#if YAJL_MAJOR == 2
+  return yajl_gen_status_ok == yajl_gen_string(m_gen, (const unsigned char*)key.c_str(), (size_t)key.length());
+#else
+  return yajl_gen_status_ok == yajl_gen_string(m_gen, (const unsigned char*)key.c_str(), key.length());
+#endif
+}
+
+bool CJSONStreamWriter::Value(const CVariant &value)
+{
+  // Set locale to classic ("C") to ensure valid JSON numbers
+  std::string currentLocale = setlocale(LC_NUMERIC, NULL);
+  setlocale(LC_NUMERIC, "C");
+
+  bool success = CJSONVariantWriter::InternalWrite(m_gen, value);
+
+  // Re-set locale to what it was before using yajl
+  setlocale(LC_NUMERIC, currentLocale.c_str());
+
+  return success;
+}
+
+const char *CJSONStreamWriter::GetBuffer(size_t &length)
+{
+  const unsigned char *buffer;
+
+#if YAJL_MAJOR == 2
+  yajl_gen_get_buf(m_gen, &buffer, &length);
+#else
+  unsigned int size;
+  yajl_gen_get_buf(m_gen, &buffer, &size);
+  length = size;
+#endif
+
+  return (const char *)buffer;
+}
+
+void CJSONStreamWriter::Clear()
+{
+  yajl_gen_clear(m_gen);
+}
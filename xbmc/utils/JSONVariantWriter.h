@@ -32,5 +32,35 @@ class CJSONVariantWriter
 public:
   static std::string Write(const CVariant &value, bool compact);
 private:
+  friend class CJSONStreamWriter;
   static bool InternalWrite(yajl_gen g, const CVariant &value);
 };
+
+/*!
+ \brief Writes a JSON document piece by piece
+
+ The output collects in a buffer which the caller takes out and clears
+ whenever it likes, so a large document never has to exist as a whole,
+ neither as a CVariant nor as a string.
+ */
+class CJSONStreamWriter
+{
+public:
+  CJSONStreamWriter(bool compact);
+  ~CJSONStreamWriter();
+
+  bool BeginObject();
+  bool EndObject();
+  bool BeginArray();
+  bool EndArray();
+  bool Key(const std::string &key);
+  bool Value(const CVariant &value);
+
+  /*! \brief Get the output written since the last Clear()
+   The pointer is valid until the next call to any other method.
+   */
+  const char *GetBuffer(size_t &length);
+  void Clear();
+private:
+  yajl_gen m_gen;
+};
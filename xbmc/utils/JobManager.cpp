@@ -21,7 +21,11 @@
 
 #include "JobManager.h"
 #include <algorithm>
+#include <string.h>
 #include "threads/SingleLock.h"
+#include "threads/SystemClock.h"
+#include "threads/Atomics.h"
+#include "utils/log.h"
 
 #include "system.h"
 
@@ -35,9 +39,10 @@ bool CJob::ShouldCancel(unsigned int progress, unsigned int total) const
   return false;
 }
 
-CJobWorker::CJobWorker(CJobManager *manager) : CThread("Jobworker")
+CJobWorker::CJobWorker(CJobManager *manager, unsigned int slot) : CThread("Jobworker")
 {
   m_jobManager = manager;
+  m_slot = slot;
   Create(true); // start work immediately, and kill ourselves when we're done
 }
 
@@ -63,7 +68,7 @@ void CJobWorker::Process()
 
     // we have a job to do
     bool success = job->DoWork();
-    m_jobManager->OnJobComplete(success, job);
+    m_jobManager->OnJobComplete(this, success, job);
   }
 }
 
@@ -139,34 +144,59 @@ CJobManager &CJobManager::GetInstance()
   return sJobManager;
 }
 
+CJobManager::CJobSlot::CJobSlot() : m_processing(NULL, 0, NULL, CJob::PRIORITY_LOW)
+{
+  m_worker = NULL;
+  m_busy = false;
+  memset(m_stats, 0, sizeof(m_stats));
+}
+
 CJobManager::CJobManager()
 {
   m_jobCounter = 0;
+  m_nextSlot = 0;
+  m_queued = 0;
+  m_processing = 0;
+  m_workers = 0;
   m_running = true;
 }
 
 void CJobManager::CancelJobs()
 {
-  CSingleLock lock(m_section);
   m_running = false;
 
-  // clear any pending jobs
-  for (unsigned int priority = CJob::PRIORITY_LOW; priority <= CJob::PRIORITY_HIGH; ++priority)
+  // clear any pending jobs, and cancel any callbacks on jobs still processing
+  for (unsigned int i = 0; i < max_workers; i++)
   {
-    for_each(m_jobQueue[priority].begin(), m_jobQueue[priority].end(), mem_fun_ref(&CWorkItem::FreeJob));
-    m_jobQueue[priority].clear();
+    CSingleLock lock(m_slots[i].m_section);
+    for (unsigned int priority = CJob::PRIORITY_LOW; priority <= CJob::PRIORITY_HIGH; ++priority)
+    {
+      JobQueue &queue = m_slots[i].m_jobQueue[priority];
+      for (JobQueue::iterator it = queue.begin(); it != queue.end(); ++it)
+      {
+        it->FreeJob();
+        AtomicDecrement(&m_queued);
+      }
+      queue.clear();
+    }
+    if (m_slots[i].m_busy)
+      m_slots[i].m_processing.Cancel();
   }
 
-  // cancel any callbacks on jobs still processing
-  for_each(m_processing.begin(), m_processing.end(), mem_fun_ref(&CWorkItem::Cancel));
+  for (unsigned int priority = CJob::PRIORITY_LOW; priority <= CJob::PRIORITY_HIGH; ++priority)
+  {
+    JobStats stats;
+    GetStats((CJob::PRIORITY)priority, stats);
+    if (stats.completed)
+      CLog::Log(LOGDEBUG, "%s - priority %u: %u jobs, %u stolen, average wait %u ms, average run %u ms", __FUNCTION__,
+                priority, stats.completed, stats.stolen, (unsigned int)(stats.waitTime / stats.completed), (unsigned int)(stats.runTime / stats.completed));
+  }
 
   // tell our workers to finish
-  while (m_workers.size())
+  while (m_workers)
   {
-    lock.Leave();
     m_jobEvent.Set();
     Sleep(0); // yield after setting the event to give the workers some time to die
-    lock.Enter();
   }
 }
 
@@ -176,11 +206,23 @@ CJobManager::~CJobManager()
 
 unsigned int CJobManager::AddJob(CJob *job, IJobCallback *callback, CJob::PRIORITY priority)
 {
-  CSingleLock lock(m_section);
-
   // create a work item for this job
-  CWorkItem work(job, m_jobCounter++, callback);
-  m_jobQueue[priority].push_back(work);
+  CWorkItem work(job, AtomicIncrement(&m_jobCounter) - 1, callback, priority);
+  work.m_queued = XbmcThreads::SystemClockMillis();
+
+  // jobs added from within a job stay with the current worker, the others are spread over all slots
+  unsigned int slot;
+  CJobWorker *worker = dynamic_cast<CJobWorker*>(CThread::GetCurrentThread());
+  if (worker)
+    slot = worker->GetSlot();
+  else
+    slot = (unsigned long)AtomicIncrement(&m_nextSlot) % max_workers;
+
+  {
+    CSingleLock lock(m_slots[slot].m_section);
+    m_slots[slot].m_jobQueue[priority].push_back(work);
+  }
+  AtomicIncrement(&m_queued);
 
   StartWorkers(priority);
   return work.m_id;
@@ -188,83 +230,148 @@ unsigned int CJobManager::AddJob(CJob *job, IJobCallback *callback, CJob::PRIORI
 
 void CJobManager::CancelJob(unsigned int jobID)
 {
-  CSingleLock lock(m_section);
-
-  // check whether we have this job in the queue
-  for (unsigned int priority = CJob::PRIORITY_LOW; priority <= CJob::PRIORITY_HIGH; ++priority)
+  for (unsigned int i = 0; i < max_workers; i++)
   {
-    JobQueue::iterator i = find(m_jobQueue[priority].begin(), m_jobQueue[priority].end(), jobID);
-    if (i != m_jobQueue[priority].end())
+    CSingleLock lock(m_slots[i].m_section);
+
+    // check whether we have this job in the queue
+    for (unsigned int priority = CJob::PRIORITY_LOW; priority <= CJob::PRIORITY_HIGH; ++priority)
     {
-      delete i->m_job;
-      m_jobQueue[priority].erase(i);
+      JobQueue &queue = m_slots[i].m_jobQueue[priority];
+      JobQueue::iterator it = find(queue.begin(), queue.end(), jobID);
+      if (it != queue.end())
+      {
+        delete it->m_job;
+        queue.erase(it);
+        AtomicDecrement(&m_queued);
+        return;
+      }
+    }
+    // or if we're processing it
+    if (m_slots[i].m_busy && m_slots[i].m_processing == jobID)
+    {
+      m_slots[i].m_processing.Cancel(); // job is in progress, so only thing to do is to remove callback
       return;
     }
   }
-  // or if we're processing it
-  Processing::iterator it = find(m_processing.begin(), m_processing.end(), jobID);
-  if (it != m_processing.end())
-    it->m_callback = NULL; // job is in progress, so only thing to do is to remove callback
 }
 
 void CJobManager::StartWorkers(CJob::PRIORITY priority)
 {
-  CSingleLock lock(m_section);
-
   // check how many free threads we have
-  if (m_processing.size() >= GetMaxWorkers(priority))
+  if ((unsigned long)m_processing >= GetMaxWorkers(priority))
     return;
 
   // do we have any sleeping threads?
-  if (m_processing.size() < m_workers.size())
+  if (m_processing < m_workers)
   {
     m_jobEvent.Set();
     return;
   }
 
   // everyone is busy - we need more workers
-  m_workers.push_back(new CJobWorker(this));
+  CSingleLock lock(m_section);
+  if (m_processing < m_workers || !m_running)
+  {
+    m_jobEvent.Set();
+    return;
+  }
+  for (unsigned int i = 0; i < max_workers; i++)
+  {
+    if (!m_slots[i].m_worker)
+    {
+      // the worker can't look for jobs before it's bound, GetNextJob needs m_section when it runs dry
+      AtomicIncrement(&m_workers);
+      m_slots[i].m_worker = new CJobWorker(this, i);
+      return;
+    }
+  }
 }
 
-CJob *CJobManager::PopJob()
+bool CJobManager::ReserveWorker(CJob::PRIORITY priority)
+{
+  long max = GetMaxWorkers(priority);
+  while (true)
+  {
+    long processing = m_processing;
+    if (processing >= max)
+      return false;
+    if (cas(&m_processing, processing, processing + 1) == processing)
+      return true;
+  }
+}
+
+bool CJobManager::TakeJob(unsigned int from, unsigned int to, CJob::PRIORITY priority)
+{
+  CWorkItem job(NULL, 0, NULL, priority);
+  {
+    CSingleLock lock(m_slots[from].m_section);
+    JobQueue &queue = m_slots[from].m_jobQueue[priority];
+    if (queue.empty())
+      return false;
+    job = queue.front();
+    queue.pop_front();
+  }
+  AtomicDecrement(&m_queued);
+
+  job.m_started = XbmcThreads::SystemClockMillis();
+  job.m_job->m_callback = this;
+
+  CSingleLock lock(m_slots[to].m_section);
+  m_slots[to].m_processing = job;
+  m_slots[to].m_busy = true;
+  if (from != to)
+    m_slots[to].m_stats[priority].stolen++;
+  return true;
+}
+
+CJob *CJobManager::PopJob(unsigned int slot)
 {
-  CSingleLock lock(m_section);
   for (int priority = CJob::PRIORITY_HIGH; priority >= CJob::PRIORITY_LOW; --priority)
   {
-    if (m_jobQueue[priority].size() && m_processing.size() < GetMaxWorkers(CJob::PRIORITY(priority)))
+    if (!m_queued)
+      return NULL;
+
+    if (!ReserveWorker(CJob::PRIORITY(priority)))
+      continue;
+
+    // our own slot first, then steal from the others
+    for (unsigned int i = 0; i < max_workers; i++)
     {
-      CWorkItem job = m_jobQueue[priority].front();
-      m_jobQueue[priority].pop_front();
-      // add to the processing vector
-      m_processing.push_back(job);
-      job.m_job->m_callback = this;
-      return job.m_job;
+      unsigned int from = (slot + i) % max_workers;
+      if (TakeJob(from, slot, CJob::PRIORITY(priority)))
+        return m_slots[slot].m_processing.m_job;
     }
+    AtomicDecrement(&m_processing);
   }
   return NULL;
 }
 
 CJob *CJobManager::GetNextJob(const CJobWorker *worker)
 {
-  CSingleLock lock(m_section);
+  unsigned int slot = worker->GetSlot();
   while (m_running)
   {
     // grab a job off the queue if we have one
-    CJob *job = PopJob();
+    CJob *job = PopJob(slot);
     if (job)
       return job;
     // no jobs are left - sleep for 30 seconds to allow new jobs to come in
-    lock.Leave();
-    bool newJob = m_jobEvent.WaitMSec(30000);
-    lock.Enter();
-    if (!newJob)
-      break;
+    if (!m_jobEvent.WaitMSec(30000))
+    {
+      // retire, unless a job came in after we stopped looking. either we see it
+      // in m_queued, or AddJob sees us gone and starts a new worker
+      CSingleLock lock(m_section);
+      AtomicDecrement(&m_workers);
+      if (m_running && m_queued)
+      {
+        AtomicIncrement(&m_workers);
+        continue;
+      }
+      m_slots[slot].m_worker = NULL;
+      return NULL;
+    }
   }
-  // ensure no jobs have come in during the period after
-  // timeout and before we held the lock
-  CJob *job = PopJob();
-  if (job)
-    return job;
   // have no jobs
   RemoveWorker(worker);
   return NULL;
@@ -272,39 +379,48 @@ CJob *CJobManager::GetNextJob(const CJobWorker *worker)
 
 bool CJobManager::OnJobProgress(unsigned int progress, unsigned int total, const CJob *job) const
 {
-  CSingleLock lock(m_section);
-  // find the job in the processing queue, and check whether it's cancelled (no callback)
-  Processing::const_iterator i = find(m_processing.begin(), m_processing.end(), job);
-  if (i != m_processing.end())
+  // find the job in the processing slots, and check whether it's cancelled (no callback)
+  for (unsigned int i = 0; i < max_workers; i++)
   {
-    CWorkItem item(*i);
-    lock.Leave(); // leave section prior to call
-    if (item.m_callback)
+    CSingleLock lock(m_slots[i].m_section);
+    if (m_slots[i].m_busy && m_slots[i].m_processing == job)
     {
-      item.m_callback->OnJobProgress(item.m_id, progress, total, job);
-      return false;
+      CWorkItem item(m_slots[i].m_processing);
+      lock.Leave(); // leave section prior to call
+      if (item.m_callback)
+      {
+        item.m_callback->OnJobProgress(item.m_id, progress, total, job);
+        return false;
+      }
+      return true;
     }
   }
   return true; // couldn't find the job, or it's been cancelled
 }
 
-void CJobManager::OnJobComplete(bool success, CJob *job)
+void CJobManager::OnJobComplete(const CJobWorker *worker, bool success, CJob *job)
 {
-  CSingleLock lock(m_section);
-  // remove the job from the processing queue
-  Processing::iterator i = find(m_processing.begin(), m_processing.end(), job);
-  if (i != m_processing.end())
+  CJobSlot &slot = m_slots[worker->GetSlot()];
+
+  CSingleLock lock(slot.m_section);
+  if (slot.m_busy && slot.m_processing == job)
   {
     // tell any listeners we're done with the job, then delete it
-    CWorkItem item(*i);
+    CWorkItem item(slot.m_processing);
     lock.Leave();
     if (item.m_callback)
       item.m_callback->OnJobComplete(item.m_id, success, item.m_job);
     lock.Enter();
-    Processing::iterator j = find(m_processing.begin(), m_processing.end(), job);
-    if (j != m_processing.end())
-      m_processing.erase(j);
+
+    unsigned int now = XbmcThreads::SystemClockMillis();
+    JobStats &stats = slot.m_stats[item.m_priority];
+    stats.completed++;
+    stats.waitTime += item.m_started - item.m_queued;
+    stats.runTime  += now - item.m_started;
+
+    slot.m_busy = false;
     lock.Leave();
+    AtomicDecrement(&m_processing);
     item.FreeJob();
   }
 }
@@ -313,13 +429,32 @@ void CJobManager::RemoveWorker(const CJobWorker *worker)
 {
   CSingleLock lock(m_section);
   // remove our worker
-  Workers::iterator i = find(m_workers.begin(), m_workers.end(), worker);
-  if (i != m_workers.end())
-    m_workers.erase(i); // workers auto-delete
+  unsigned int slot = worker->GetSlot();
+  if (m_slots[slot].m_worker == worker)
+  {
+    m_slots[slot].m_worker = NULL; // workers auto-delete
+    AtomicDecrement(&m_workers);
+  }
+}
+
+void CJobManager::GetStats(CJob::PRIORITY priority, JobStats &stats) const
+{
+  memset(&stats, 0, sizeof(stats));
+  for (unsigned int i = 0; i < max_workers; i++)
+  {
+    CSingleLock lock(m_slots[i].m_section);
+    const JobStats &slot = m_slots[i].m_stats[priority];
+    stats.queued     += m_slots[i].m_jobQueue[priority].size();
+    stats.completed  += slot.completed;
+    stats.stolen     += slot.stolen;
+    stats.waitTime   += slot.waitTime;
+    stats.runTime    += slot.runTime;
+    if (m_slots[i].m_busy && m_slots[i].m_processing.m_priority == priority)
+      stats.processing++;
+  }
 }
 
 unsigned int CJobManager::GetMaxWorkers(CJob::PRIORITY priority) const
 {
-  static const unsigned int max_workers = 5;
   return max_workers - (CJob::PRIORITY_HIGH - priority);
 }
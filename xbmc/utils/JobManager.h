@@ -32,12 +32,18 @@ class CJobManager;
 class CJobWorker : public CThread
 {
 public:
-  CJobWorker(CJobManager *manager);
+  CJobWorker(CJobManager *manager, unsigned int slot);
   virtual ~CJobWorker();
 
   void Process();
+
+  /*!
+   \brief The job slot of the CJobManager this worker takes its jobs from first.
+   */
+  unsigned int GetSlot() const { return m_slot; };
 private:
   CJobManager  *m_jobManager;
+  unsigned int  m_slot;
 };
 
 /*!
@@ -149,6 +155,11 @@ private:
  priority levels.  Lower priority jobs are executed only if there are sufficient
  spare worker threads free to allow for higher priority jobs that may arise.
 
+ Each worker owns a slot holding its own job queues.  New jobs are spread over
+ the slots (jobs added from within a job go to the slot of the current worker),
+ and a worker that runs out of jobs in its own slot steals from the others, so
+ workers never contend on a single lock to fetch their next job.
+
  \sa CJob and IJobCallback
  */
 class CJobManager
@@ -156,11 +167,14 @@ class CJobManager
   class CWorkItem
   {
   public:
-    CWorkItem(CJob *job, unsigned int id, IJobCallback *callback)
+    CWorkItem(CJob *job, unsigned int id, IJobCallback *callback, CJob::PRIORITY priority)
     {
       m_job = job;
       m_id = id;
       m_callback = callback;
+      m_priority = priority;
+      m_queued = 0;
+      m_started = 0;
     }
     bool operator==(unsigned int jobID) const
     {
@@ -182,9 +196,25 @@ class CJobManager
     CJob         *m_job;
     unsigned int  m_id;
     IJobCallback *m_callback;
+    CJob::PRIORITY m_priority;
+    unsigned int  m_queued;  // time the job was added
+    unsigned int  m_started; // time the job was picked up by a worker
   };
 
 public:
+  /*!
+   \brief Scheduling statistics of the jobs of a single priority, times are in milliseconds
+   */
+  struct JobStats
+  {
+    unsigned int queued;     ///< jobs waiting to be processed
+    unsigned int processing; ///< jobs currently being processed
+    unsigned int completed;  ///< jobs processed so far
+    unsigned int stolen;     ///< completed jobs that were taken from the slot of another worker
+    uint64_t     waitTime;   ///< total time completed jobs spent waiting in the queue
+    uint64_t     runTime;    ///< total time spent processing completed jobs
+  };
+
   /*!
    \brief The only way through which the global instance of the CJobManager should be accessed.
    \return the global instance.
@@ -215,6 +245,14 @@ public:
    */
   void CancelJobs();
 
+  /*!
+   \brief Retrieve the scheduling statistics of a priority level.
+   \param priority the priority to retrieve the statistics for.
+   \param stats the statistics, summed over all workers.
+   \sa JobStats
+   */
+  void GetStats(CJob::PRIORITY priority, JobStats &stats) const;
+
 protected:
   friend class CJobWorker;
   friend class CJob;
@@ -229,11 +267,12 @@ protected:
   /*!
    \brief Callback from CJobWorker after a job has completed.
    Calls IJobCallback::OnJobComplete(), and then destroys job.
-   \param job a pointer to the calling subclassed CJob instance.
+   \param worker a pointer to the CJobWorker instance that processed the job.
    \param success the result from the DoWork call
+   \param job a pointer to the calling subclassed CJob instance.
    \sa IJobCallback, CJob
    */
-  void  OnJobComplete(bool success, CJob *job);
+  void  OnJobComplete(const CJobWorker *worker, bool success, CJob *job);
 
   /*!
    \brief Callback from CJob to report progress and check for cancellation.
@@ -253,26 +292,54 @@ private:
   CJobManager const& operator=(CJobManager const&);
   virtual ~CJobManager();
 
-  /*! \brief Pop a job off the job queue and add to the processing queue ready to process
+  /*! \brief Pop a job off the job queues of a worker, or steal one from the other workers,
+   and mark it as being processed by this worker
+   \param slot the slot of the worker requesting a job
    \return the job to process, NULL if no jobs are available
    */
-  CJob *PopJob();
+  CJob *PopJob(unsigned int slot);
+
+  /*! \brief Take the oldest job of the given priority from a slot
+   \param from the slot to take the job from
+   \param to the slot of the worker that will process the job
+   \return true if a job was taken
+   */
+  bool TakeJob(unsigned int from, unsigned int to, CJob::PRIORITY priority);
+
+  /*! \brief Reserve a worker for a job of the given priority
+   \return true if fewer than GetMaxWorkers(priority) jobs are being processed
+   */
+  bool ReserveWorker(CJob::PRIORITY priority);
 
   void StartWorkers(CJob::PRIORITY priority);
   void RemoveWorker(const CJobWorker *worker);
   unsigned int GetMaxWorkers(CJob::PRIORITY priority) const;
 
-  unsigned int m_jobCounter;
+  static const unsigned int max_workers = 5;
 
   typedef std::deque<CWorkItem>    JobQueue;
-  typedef std::vector<CWorkItem>   Processing;
-  typedef std::vector<CJobWorker*> Workers;
 
-  JobQueue   m_jobQueue[CJob::PRIORITY_HIGH+1];
-  Processing m_processing;
-  Workers    m_workers;
+  class CJobSlot
+  {
+  public:
+    CJobSlot();
+    CCriticalSection m_section;
+    CJobWorker      *m_worker;      // worker bound to this slot, NULL if none
+    JobQueue         m_jobQueue[CJob::PRIORITY_HIGH+1];
+    CWorkItem        m_processing;  // job the worker is processing
+    bool             m_busy;        // whether m_processing is valid
+    JobStats         m_stats[CJob::PRIORITY_HIGH+1];
+  };
 
-  CCriticalSection m_section;
+  CJobSlot         m_slots[max_workers];
+
+  volatile long    m_jobCounter;
+  volatile long    m_nextSlot;    // round robin slot for jobs added from outside the workers
+  volatile long    m_queued;      // jobs waiting in any slot
+  volatile long    m_processing;  // reserved or busy workers
+  volatile long    m_workers;     // workers bound to a slot
+
+  CCriticalSection m_section;     // guards starting and stopping of workers
   CEvent           m_jobEvent;
-  bool             m_running;
+  volatile bool    m_running;
 };
@@ -31,6 +31,7 @@
 #include "utils/log.h"
 #include "settings/GUISettings.h"
 #include "settings/AdvancedSettings.h"
+#include "utils/CPUInfo.h"
 #ifdef _WIN32
 #include "../win32/PlatformDefs.h"
 #endif
@@ -169,28 +170,21 @@ CPCMRemap::CPCMRemap() :
   m_outChannels (0),
   m_inSampleSize(0),
   m_ignoreLayout(false),
-  m_buf(NULL),
-  m_bufsize(0),
-  m_attenuation (1.0),
-  m_attenuationInc(0.0),
-  m_attenuationMin(1.0),
-  m_sampleRate  (48000.0), //safe default
-  m_holdCounter (0),
   m_limiterEnabled(false)
 {
-  Dispose();
+  m_limiter.attenuation    = 1.0f;
+  m_limiter.attenuationInc = 0.0f;
+  m_limiter.attenuationMin = 1.0f;
+  m_limiter.holdCounter    = 0;
+  m_limiter.sampleRate     = 48000.0f; //safe default
+  m_limiter.hold           = 0;
+  m_limiter.release        = 1.0f;
+
+  m_dsp.SetEngine(CPCMRemapDSP::GetBestEngine(g_cpuInfo.GetCPUFeatures()));
 }
 
 CPCMRemap::~CPCMRemap()
 {
-  Dispose();
-}
-
-void CPCMRemap::Dispose()
-{
-  free(m_buf);
-  m_buf = NULL;
-  m_bufsize = 0;
 }
 
 /* resolves the channels recursively and returns the new index of tablePtr */
@@ -419,6 +413,18 @@ void CPCMRemap::BuildMap()
     }
     CLog::Log(LOGDEBUG, "CPCMRemap: %s = %s\n", PCMChannelStr(m_outMap[out_ch]).c_str(), s.c_str());
   }
+
+  /* hand the final map to the mixer */
+  m_dsp.SetChannels(m_inChannels, m_outChannels);
+  for(out_ch = 0; out_ch < m_outChannels; ++out_ch)
+  {
+    dst = m_lookupMap[m_outMap[out_ch]];
+    for(struct PCMMapInfo *info = dst; info->channel != PCM_INVALID; ++info)
+      m_dsp.AddMix(out_ch, info->in_offset / m_inSampleSize, info->level);
+    if (dst->channel != PCM_INVALID && dst->copy)
+      m_dsp.SetCopy(out_ch);
+  }
+  CLog::Log(LOGDEBUG, "CPCMRemap: Using %s mixer", CPCMRemapDSP::GetEngineName(m_dsp.GetEngine()));
 }
 
 void CPCMRemap::DumpMap(CStdString info, unsigned int channels, enum PCMChannels *channelMap)
@@ -440,7 +446,6 @@ void CPCMRemap::Reset()
 {
   m_inSet  = false;
   m_outSet = false;
-  Dispose();
 }
 
 /* sets the input format, and returns the requested channel layout */
@@ -448,7 +453,7 @@ enum PCMChannels *CPCMRemap::SetInputFormat(unsigned int channels, enum PCMChann
 {
   m_inChannels   = channels;
   m_inSampleSize = sampleSize;
-  m_sampleRate   = sampleRate;
+  m_limiter.sampleRate = sampleRate;
   m_inSet        = channelMap != NULL;
   if (channelMap)
     memcpy(m_inMap, channelMap, sizeof(enum PCMChannels) * channels);
@@ -489,9 +494,9 @@ enum PCMChannels *CPCMRemap::SetInputFormat(unsigned int channels, enum PCMChann
   } else
     memcpy(m_layoutMap, PCMLayoutMap[m_channelLayout], sizeof(PCMLayoutMap[m_channelLayout]));
 
-  m_attenuation = 1.0;
-  m_attenuationInc = 1.0;
-  m_holdCounter = 0;
+  m_limiter.attenuation = 1.0;
+  m_limiter.attenuationInc = 1.0;
+  m_limiter.holdCounter = 0;
 
   return m_layoutMap;
 }
@@ -508,9 +513,9 @@ void CPCMRemap::SetOutputFormat(unsigned int channels, enum PCMChannels *channel
   DumpMap("O", channels, channelMap);
   BuildMap();
 
-  m_attenuation = 1.0;
-  m_attenuationInc = 1.0;
-  m_holdCounter = 0;
+  m_limiter.attenuation = 1.0;
+  m_limiter.attenuationInc = 1.0;
+  m_limiter.holdCounter = 0;
 }
 
 void CPCMRemap::Remap(void *data, void *out, unsigned int samples, long drc)
@@ -525,79 +530,12 @@ void CPCMRemap::Remap(void *data, void *out, unsigned int samples, long drc)
 /* remap the supplied data into out, which must be pre-allocated */
 void CPCMRemap::Remap(void *data, void *out, unsigned int samples, float gain /*= 1.0f*/)
 {
-  CheckBufferSize(samples * m_outChannels * sizeof(float));
-
-  //set output buffer to 0
-  memset(out, 0, samples * m_outChannels * m_inSampleSize);
-
-  //set intermediate buffer to 0
-  memset(m_buf, 0, m_bufsize);
-
-  ProcessInput(data, out, samples, gain);
-  AddGain(m_buf, samples * m_outChannels, gain);
-  ProcessLimiter(samples, gain);
-  ProcessOutput(out, samples, gain);
+  bool limit = ProcessLimiter(gain);
+  m_dsp.Process((const int16_t*)data, (int16_t*)out, samples, gain, limit ? &m_limiter : NULL);
 }
 
-void CPCMRemap::CheckBufferSize(int size)
-{
-  if (m_bufsize < size)
-  {
-    m_bufsize = size;
-    m_buf = (float*)realloc(m_buf, m_bufsize);
-  }
-}
-
-void CPCMRemap::ProcessInput(void* data, void* out, unsigned int samples, float gain)
-{
-  for (unsigned int ch = 0; ch < m_outChannels; ch++)
-  {
-    struct PCMMapInfo *info = m_lookupMap[m_outMap[ch]];
-    if (info->channel == PCM_INVALID)
-      continue;
-
-    if (info->copy && gain == 1.0f) //do direct copy
-    {
-      uint8_t* src = (uint8_t*)data + info->in_offset;
-      uint8_t* dst = (uint8_t*)out  + ch * m_inSampleSize;
-      uint8_t* dstend = dst + samples * m_outStride;
-      while (dst != dstend)
-      {
-        *(int16_t*)dst = *(int16_t*)src;
-        src += m_inStride;
-        dst += m_outStride;
-      }
-    }
-    else //needs some volume change or mixing, put into intermediate buffer
-    {
-      for(; info->channel != PCM_INVALID; info++)
-      {
-        uint8_t* src = (uint8_t*)data + info->in_offset;
-        float*   dst = m_buf + ch;
-        float*   dstend = dst + samples * m_outChannels;
-        while (dst != dstend)
-        {
-          *dst += (float)(*(int16_t*)src) * info->level;
-          src += m_inStride;
-          dst += m_outChannels;
-        }
-      }
-    }
-  }
-}
-
-void CPCMRemap::AddGain(float* buf, unsigned int samples, float gain)
-{
-  if (gain != 1.0f) //needs a gain change
-  {
-    float* ptr = m_buf;
-    float* end = m_buf + samples;
-    while (ptr != end)
-      *(ptr++) *= gain;
-  }
-}
-
-void CPCMRemap::ProcessLimiter(unsigned int samples, float gain)
+/* checks whether the mix can clip, and if so sets the limiter up for this call */
+bool CPCMRemap::ProcessLimiter(float gain)
 {
   //check total gain for each output channel
   float highestgain = 1.0f;
@@ -615,12 +553,12 @@ void CPCMRemap::ProcessLimiter(unsigned int samples, float gain)
       highestgain = chgain;
   }
 
-  m_attenuationMin = 1.0f;
+  m_limiter.attenuationMin = 1.0f;
 
   //if one of the channels can clip, enable a limiter
   if (highestgain > 1.0001f) 
   {
-    m_attenuationMin = m_attenuation;
+    m_limiter.attenuationMin = m_limiter.attenuation;
 
     if (!m_limiterEnabled)
     {
@@ -628,57 +566,9 @@ void CPCMRemap::ProcessLimiter(unsigned int samples, float gain)
       m_limiterEnabled = true;
     }
 
-    for (unsigned int i = 0; i < samples; i++)
-    {
-      //for each collection of samples, get the highest absolute value
-      float maxAbs = 0.0f;
-      for (unsigned int outch = 0; outch < m_outChannels; outch++)
-      {
-        float absval = fabs(m_buf[i * m_outChannels + outch]) / 32768.0f;
-        if (maxAbs < absval)
-          maxAbs = absval;
-      }
-
-      //if attenuatedAbs is higher than 1.0f, audio is clipping
-      float attenuatedAbs = maxAbs * m_attenuation;
-      if (attenuatedAbs > 1.0f)
-      {
-        //set m_attenuation so that m_attenuation * sample is the maximum output value
-        m_attenuation = 1.0f / maxAbs;
-        if (m_attenuation < m_attenuationMin)
-          m_attenuationMin = m_attenuation;
-        //value to add to m_attenuation to make it 1.0f
-        m_attenuationInc = 1.0f - m_attenuation;
-        //amount of samples to hold m_attenuation
-        m_holdCounter = MathUtils::round_int(m_sampleRate * g_advancedSettings.m_limiterHold);
-      }
-      else if (m_attenuation < 1.0f && attenuatedAbs > 0.95f)
-      {
-        //if we're attenuating and we get within 5% of clipping, hold m_attenuation
-        m_attenuationInc = 1.0f - m_attenuation;
-        m_holdCounter = MathUtils::round_int(m_sampleRate * g_advancedSettings.m_limiterHold);
-      }
-
-      //apply attenuation
-      for (unsigned int outch = 0; outch < m_outChannels; outch++)
-        m_buf[i * m_outChannels + outch] *= m_attenuation;
-
-      if (m_holdCounter)
-      {
-        //hold m_attenuation
-        m_holdCounter--;
-      }
-      else if (m_attenuationInc > 0.0f)
-      {
-        //move m_attenuation to 1.0 in g_advancedSettings.m_limiterRelease seconds
-        m_attenuation += m_attenuationInc / m_sampleRate / g_advancedSettings.m_limiterRelease;
-        if (m_attenuation > 1.0f)
-        {
-          m_attenuation = 1.0f;
-          m_attenuationInc = 0.0f;
-        }
-      }
-    }
+    m_limiter.hold    = MathUtils::round_int(m_limiter.sampleRate * g_advancedSettings.m_limiterHold);
+    m_limiter.release = g_advancedSettings.m_limiterRelease;
+    return true;
   }
   else
   {
@@ -689,34 +579,10 @@ void CPCMRemap::ProcessLimiter(unsigned int samples, float gain)
     }
 
     //reset the limiter
-    m_attenuation = 1.0f;
-    m_attenuationInc = 0.0f;
-    m_holdCounter = 0;
-  }
-}
-
-void CPCMRemap::ProcessOutput(void* out, unsigned int samples, float gain)
-{
-  //copy from intermediate buffer to output
-  for (unsigned int ch = 0; ch < m_outChannels; ch++)
-  {
-    struct PCMMapInfo *info = m_lookupMap[m_outMap[ch]];
-    if (info->channel == PCM_INVALID)
-      continue;
-
-    if (!info->copy || gain != 1.0f)
-    {
-      float* src = m_buf + ch;
-      uint8_t* dst = (uint8_t*)out + ch * m_inSampleSize;
-      uint8_t* dstend = dst + samples * m_outStride;
-
-      while(dst != dstend)
-      {
-        *(int16_t*)dst = MathUtils::round_int(std::min(std::max(*src, (float)INT16_MIN), (float)INT16_MAX));
-        src += m_outChannels;
-        dst += m_outStride;
-      }
-    }
+    m_limiter.attenuation = 1.0f;
+    m_limiter.attenuationInc = 0.0f;
+    m_limiter.holdCounter = 0;
+    return false;
   }
 }
 
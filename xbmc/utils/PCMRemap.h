@@ -25,6 +25,7 @@
 #include <stdint.h>
 #include <vector>
 #include "StdString.h"
+#include "PCMRemapDSP.h"
 
 #define PCM_MAX_CH 18
 enum PCMChannels
@@ -104,28 +105,18 @@ protected:
   struct PCMMapInfo  m_lookupMap[PCM_MAX_CH + 1][PCM_MAX_CH + 1];
   int                m_counts[PCM_MAX_CH];
 
-  float*             m_buf;
-  int                m_bufsize;
-  float              m_attenuation;
-  float              m_attenuationInc;
-  float              m_attenuationMin; //lowest attenuation value during a call of Remap(), used for the codec info
-  float              m_sampleRate;
-  unsigned int       m_holdCounter;
+  CPCMRemapDSP       m_dsp;
+  PCMRemapLimiter    m_limiter; //attenuationMin is the lowest attenuation value during a call of Remap(), used for the codec info
   bool               m_limiterEnabled;
 
   struct PCMMapInfo* ResolveChannel(enum PCMChannels channel, float level, bool ifExists, std::vector<enum PCMChannels> path, struct PCMMapInfo *tablePtr);
   void               ResolveChannels(); //!< Partial BuildMap(), just enough to see which output channels are active
   void               BuildMap();
   void               DumpMap(CStdString info, int unsigned channels, enum PCMChannels *channelMap);
-  void               Dispose();
   CStdString         PCMChannelStr(enum PCMChannels ename);
   CStdString         PCMLayoutStr(enum PCMLayout ename);
 
-  void               CheckBufferSize(int size);
-  void               ProcessInput(void* data, void* out, unsigned int samples, float gain);
-  void               AddGain(float* buf, unsigned int samples, float gain);
-  void               ProcessLimiter(unsigned int samples, float gain);
-  void               ProcessOutput(void* out, unsigned int samples, float gain);
+  bool               ProcessLimiter(float gain);
 
 public:
 
@@ -141,7 +132,7 @@ public:
   int  InBytesToFrames (int bytes );
   int  FramesToOutBytes(int frames);
   int  FramesToInBytes (int frames);
-  float GetCurrentAttenuation() { return m_attenuationMin; }
+  float GetCurrentAttenuation() { return m_limiter.attenuationMin; }
 };
 
 #endif
@@ -0,0 +1,910 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+#include "PCMRemapDSP.h"
+#include "CPUInfo.h"
+#include "MathUtils.h"
+
+#if defined(__SSE2__) || defined(_MSC_VER)
+#define PCM_REMAP_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON__)
+#define PCM_REMAP_NEON
+#include <arm_neon.h>
+#endif
+
+/*
+  All engines do the same float operations in the same order on each sample, so they
+  give the same result. The vector engines never fuse a multiply with an add, and round
+  as MathUtils::round_int does (halfway cases up) using a truncation, which doesn't
+  depend on the rounding mode.
+*/
+
+#ifdef PCM_REMAP_SSE2
+static inline __m128i RoundSSE2(__m128 x)
+{
+  x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-32768.0f)), _mm_set1_ps(32767.0f));
+  __m128i r = _mm_cvttps_epi32(x);
+  __m128  f = _mm_sub_ps(x, _mm_cvtepi32_ps(r)); // exact
+  // comparisons give -1 where true
+  r = _mm_sub_epi32(r, _mm_castps_si128(_mm_cmpge_ps(f, _mm_set1_ps( 0.5f))));
+  r = _mm_add_epi32(r, _mm_castps_si128(_mm_cmplt_ps(f, _mm_set1_ps(-0.5f))));
+  return r;
+}
+
+static unsigned int DeinterleaveStereoSSE2(const int16_t *in, unsigned int frames, float *dst)
+{
+  unsigned int i = 0;
+  for (; i + 4 <= frames; i += 4, in += 8)
+  {
+    __m128i v = _mm_loadu_si128((const __m128i*)in);
+    _mm_store_ps(dst + i,                   _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(v, 16), 16)));
+    _mm_store_ps(dst + PCM_REMAP_BLOCK + i, _mm_cvtepi32_ps(_mm_srai_epi32(v, 16)));
+  }
+  return i;
+}
+
+// loads each frame as 8 samples, reading past it into the next one, and transposes 4 frames at a time
+template<unsigned int channels>
+static unsigned int DeinterleaveSSE2(const int16_t *in, const int16_t *end, unsigned int frames, float *dst)
+{
+  unsigned int i = 0;
+  for (; i + 4 <= frames && in + 3 * channels + 8 <= end; i += 4, in += 4 * channels)
+  {
+    __m128 lo[4], hi[4];
+    for (unsigned int f = 0; f < 4; f++)
+    {
+      __m128i v = _mm_loadu_si128((const __m128i*)(in + f * channels));
+      lo[f] = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+      if (channels > 4)
+        hi[f] = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+    }
+    _MM_TRANSPOSE4_PS(lo[0], lo[1], lo[2], lo[3]);
+    for (unsigned int ch = 0; ch < channels && ch < 4; ch++)
+      _mm_store_ps(dst + ch * PCM_REMAP_BLOCK + i, lo[ch]);
+    if (channels > 4)
+    {
+      _MM_TRANSPOSE4_PS(hi[0], hi[1], hi[2], hi[3]);
+      for (unsigned int ch = 4; ch < channels; ch++)
+        _mm_store_ps(dst + ch * PCM_REMAP_BLOCK + i, hi[ch - 4]);
+    }
+  }
+  return i;
+}
+
+static unsigned int DeinterleaveSSE2(const int16_t *in, const int16_t *end, unsigned int frames, unsigned int channels, float *dst)
+{
+  switch (channels)
+  {
+    case 1: return DeinterleaveSSE2<1>(in, end, frames, dst);
+    case 2: return DeinterleaveStereoSSE2(in, frames, dst);
+    case 3: return DeinterleaveSSE2<3>(in, end, frames, dst);
+    case 4: return DeinterleaveSSE2<4>(in, end, frames, dst);
+    case 5: return DeinterleaveSSE2<5>(in, end, frames, dst);
+    case 6: return DeinterleaveSSE2<6>(in, end, frames, dst);
+    case 7: return DeinterleaveSSE2<7>(in, end, frames, dst);
+    case 8: return DeinterleaveSSE2<8>(in, end, frames, dst);
+    default: return 0;
+  }
+}
+
+static unsigned int InterleaveStereoSSE2(int16_t *out, unsigned int frames, const float * const *src)
+{
+  unsigned int i = 0;
+  for (; i + 4 <= frames; i += 4, out += 8)
+  {
+    __m128i l = RoundSSE2(_mm_load_ps(src[0] + i));
+    __m128i r = RoundSSE2(_mm_load_ps(src[1] + i));
+    _mm_storeu_si128((__m128i*)out, _mm_packs_epi32(_mm_unpacklo_epi32(l, r), _mm_unpackhi_epi32(l, r)));
+  }
+  return i;
+}
+
+// writes 8 samples per frame, the excess is overwritten by the next frame
+template<unsigned int channels>
+static unsigned int InterleaveSSE2(int16_t *out, const int16_t *end, unsigned int frames, const float * const *src)
+{
+  unsigned int i = 0;
+  for (; i + 4 <= frames && out + 3 * channels + 8 <= end; i += 4, out += 4 * channels)
+  {
+    __m128 lo[4], hi[4];
+    for (unsigned int ch = 0; ch < 4; ch++)
+      lo[ch] = ch < channels ? _mm_load_ps(src[ch] + i) : _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(lo[0], lo[1], lo[2], lo[3]);
+    if (channels > 4)
+    {
+      for (unsigned int ch = 0; ch < 4; ch++)
+        hi[ch] = ch + 4 < channels ? _mm_load_ps(src[ch + 4] + i) : _mm_setzero_ps();
+      _MM_TRANSPOSE4_PS(hi[0], hi[1], hi[2], hi[3]);
+    }
+    for (unsigned int f = 0; f < 4; f++)
+    {
+      __m128i v = _mm_packs_epi32(RoundSSE2(lo[f]), channels > 4 ? RoundSSE2(hi[f]) : _mm_setzero_si128());
+      _mm_storeu_si128((__m128i*)(out + f * channels), v);
+    }
+  }
+  return i;
+}
+
+static unsigned int InterleaveSSE2(int16_t *out, const int16_t *end, unsigned int frames, unsigned int channels, const float * const *src)
+{
+  switch (channels)
+  {
+    case 1: return InterleaveSSE2<1>(out, end, frames, src);
+    case 2: return InterleaveStereoSSE2(out, frames, src);
+    case 3: return InterleaveSSE2<3>(out, end, frames, src);
+    case 4: return InterleaveSSE2<4>(out, end, frames, src);
+    case 5: return InterleaveSSE2<5>(out, end, frames, src);
+    case 6: return InterleaveSSE2<6>(out, end, frames, src);
+    case 7: return InterleaveSSE2<7>(out, end, frames, src);
+    case 8: return InterleaveSSE2<8>(out, end, frames, src);
+    default: return 0;
+  }
+}
+#endif
+
+#ifdef PCM_REMAP_NEON
+static inline int32x4_t RoundNEON(float32x4_t x)
+{
+  x = vminq_f32(vmaxq_f32(x, vdupq_n_f32(-32768.0f)), vdupq_n_f32(32767.0f));
+  int32x4_t   r = vcvtq_s32_f32(x);
+  float32x4_t f = vsubq_f32(x, vcvtq_f32_s32(r)); // exact
+  // comparisons give -1 where true
+  r = vsubq_s32(r, vreinterpretq_s32_u32(vcgeq_f32(f, vdupq_n_f32( 0.5f))));
+  r = vaddq_s32(r, vreinterpretq_s32_u32(vcltq_f32(f, vdupq_n_f32(-0.5f))));
+  return r;
+}
+
+static inline void TransposeNEON(float32x4_t *r)
+{
+  float32x4x2_t t01 = vtrnq_f32(r[0], r[1]);
+  float32x4x2_t t23 = vtrnq_f32(r[2], r[3]);
+  r[0] = vcombine_f32(vget_low_f32 (t01.val[0]), vget_low_f32 (t23.val[0]));
+  r[1] = vcombine_f32(vget_low_f32 (t01.val[1]), vget_low_f32 (t23.val[1]));
+  r[2] = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+  r[3] = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+}
+
+static unsigned int DeinterleaveStereoNEON(const int16_t *in, unsigned int frames, float *dst)
+{
+  unsigned int i = 0;
+  for (; i + 4 <= frames; i += 4, in += 8)
+  {
+    int16x4x2_t v = vld2_s16(in);
+    vst1q_f32(dst + i,                   vcvtq_f32_s32(vmovl_s16(v.val[0])));
+    vst1q_f32(dst + PCM_REMAP_BLOCK + i, vcvtq_f32_s32(vmovl_s16(v.val[1])));
+  }
+  return i;
+}
+
+// loads each frame as 8 samples, reading past it into the next one, and transposes 4 frames at a time
+template<unsigned int channels>
+static unsigned int DeinterleaveNEON(const int16_t *in, const int16_t *end, unsigned int frames, float *dst)
+{
+  unsigned int i = 0;
+  for (; i + 4 <= frames && in + 3 * channels + 8 <= end; i += 4, in += 4 * channels)
+  {
+    float32x4_t lo[4], hi[4];
+    for (unsigned int f = 0; f < 4; f++)
+    {
+      int16x8_t v = vld1q_s16(in + f * channels);
+      lo[f] = vcvtq_f32_s32(vmovl_s16(vget_low_s16(v)));
+      if (channels > 4)
+        hi[f] = vcvtq_f32_s32(vmovl_s16(vget_high_s16(v)));
+    }
+    TransposeNEON(lo);
+    for (unsigned int ch = 0; ch < channels && ch < 4; ch++)
+      vst1q_f32(dst + ch * PCM_REMAP_BLOCK + i, lo[ch]);
+    if (channels > 4)
+    {
+      TransposeNEON(hi);
+      for (unsigned int ch = 4; ch < channels; ch++)
+        vst1q_f32(dst + ch * PCM_REMAP_BLOCK + i, hi[ch - 4]);
+    }
+  }
+  return i;
+}
+
+static unsigned int DeinterleaveNEON(const int16_t *in, const int16_t *end, unsigned int frames, unsigned int channels, float *dst)
+{
+  switch (channels)
+  {
+    case 1: return DeinterleaveNEON<1>(in, end, frames, dst);
+    case 2: return DeinterleaveStereoNEON(in, frames, dst);
+    case 3: return DeinterleaveNEON<3>(in, end, frames, dst);
+    case 4: return DeinterleaveNEON<4>(in, end, frames, dst);
+    case 5: return DeinterleaveNEON<5>(in, end, frames, dst);
+    case 6: return DeinterleaveNEON<6>(in, end, frames, dst);
+    case 7: return DeinterleaveNEON<7>(in, end, frames, dst);
+    case 8: return DeinterleaveNEON<8>(in, end, frames, dst);
+    default: return 0;
+  }
+}
+
+static unsigned int InterleaveStereoNEON(int16_t *out, unsigned int frames, const float * const *src)
+{
+  unsigned int i = 0;
+  for (; i + 4 <= frames; i += 4, out += 8)
+  {
+    int16x4x2_t v;
+    v.val[0] = vqmovn_s32(RoundNEON(vld1q_f32(src[0] + i)));
+    v.val[1] = vqmovn_s32(RoundNEON(vld1q_f32(src[1] + i)));
+    vst2_s16(out, v);
+  }
+  return i;
+}
+
+// writes 8 samples per frame, the excess is overwritten by the next frame
+template<unsigned int channels>
+static unsigned int InterleaveNEON(int16_t *out, const int16_t *end, unsigned int frames, const float * const *src)
+{
+  unsigned int i = 0;
+  for (; i + 4 <= frames && out + 3 * channels + 8 <= end; i += 4, out += 4 * channels)
+  {
+    float32x4_t lo[4], hi[4];
+    for (unsigned int ch = 0; ch < 4; ch++)
+      lo[ch] = ch < channels ? vld1q_f32(src[ch] + i) : vdupq_n_f32(0.0f);
+    TransposeNEON(lo);
+    if (channels > 4)
+    {
+      for (unsigned int ch = 0; ch < 4; ch++)
+        hi[ch] = ch + 4 < channels ? vld1q_f32(src[ch + 4] + i) : vdupq_n_f32(0.0f);
+      TransposeNEON(hi);
+    }
+    for (unsigned int f = 0; f < 4; f++)
+    {
+      int16x8_t v = vcombine_s16(vqmovn_s32(RoundNEON(lo[f])), channels > 4 ? vqmovn_s32(RoundNEON(hi[f])) : vdup_n_s16(0));
+      vst1q_s16(out + f * channels, v);
+    }
+  }
+  return i;
+}
+
+static unsigned int InterleaveNEON(int16_t *out, const int16_t *end, unsigned int frames, unsigned int channels, const float * const *src)
+{
+  switch (channels)
+  {
+    case 1: return InterleaveNEON<1>(out, end, frames, src);
+    case 2: return InterleaveStereoNEON(out, frames, src);
+    case 3: return InterleaveNEON<3>(out, end, frames, src);
+    case 4: return InterleaveNEON<4>(out, end, frames, src);
+    case 5: return InterleaveNEON<5>(out, end, frames, src);
+    case 6: return InterleaveNEON<6>(out, end, frames, src);
+    case 7: return InterleaveNEON<7>(out, end, frames, src);
+    case 8: return InterleaveNEON<8>(out, end, frames, src);
+    default: return 0;
+  }
+}
+#endif
+
+CPCMRemapDSP::CPCMRemapDSP() :
+  m_engine     (ENGINE_C),
+  m_inChannels (0),
+  m_outChannels(0),
+  m_copy       (true)
+{
+  // blocks are kept 16 byte aligned for the vector engines
+  size_t floats = (2 * PCM_REMAP_MAX_CH + 3) * PCM_REMAP_BLOCK;
+  m_memory = calloc(floats * sizeof(float) + 15, 1);
+  m_input = (float*)(((uintptr_t)m_memory + 15) & ~(uintptr_t)15);
+  m_output      = m_input  + PCM_REMAP_MAX_CH * PCM_REMAP_BLOCK;
+  m_silence     = m_output + PCM_REMAP_MAX_CH * PCM_REMAP_BLOCK;
+  m_peaks       = m_silence + PCM_REMAP_BLOCK;
+  m_attenuation = m_peaks   + PCM_REMAP_BLOCK;
+
+  SetChannels(0, 0);
+}
+
+CPCMRemapDSP::~CPCMRemapDSP()
+{
+  free(m_memory);
+}
+
+CPCMRemapDSP::Engine CPCMRemapDSP::GetBestEngine(unsigned int cpuFeatures)
+{
+#ifdef PCM_REMAP_NEON
+  if (cpuFeatures & CPU_FEATURE_NEON)
+    return ENGINE_NEON;
+#endif
+#ifdef PCM_REMAP_SSE2
+  if (cpuFeatures & CPU_FEATURE_SSE2)
+    return ENGINE_SSE2;
+#endif
+  return ENGINE_C;
+}
+
+const char *CPCMRemapDSP::GetEngineName(Engine engine)
+{
+  switch (engine)
+  {
+    case ENGINE_SSE2: return "SSE2";
+    case ENGINE_NEON: return "NEON";
+    default:          return "C";
+  }
+}
+
+bool CPCMRemapDSP::SetEngine(Engine engine)
+{
+  m_engine = ENGINE_C;
+#ifdef PCM_REMAP_SSE2
+  if (engine == ENGINE_SSE2)
+    m_engine = engine;
+#endif
+#ifdef PCM_REMAP_NEON
+  if (engine == ENGINE_NEON)
+    m_engine = engine;
+#endif
+  return m_engine == engine;
+}
+
+void CPCMRemapDSP::SetChannels(unsigned int inChannels, unsigned int outChannels)
+{
+  m_inChannels  = std::min(inChannels,  (unsigned int)PCM_REMAP_MAX_CH);
+  m_outChannels = std::min(outChannels, (unsigned int)PCM_REMAP_MAX_CH);
+  for (unsigned int ch = 0; ch < PCM_REMAP_MAX_CH; ch++)
+  {
+    m_channels[ch].mode  = MODE_SILENT;
+    m_channels[ch].count = 0;
+  }
+}
+
+void CPCMRemapDSP::AddMix(unsigned int outChannel, unsigned int inChannel, float level)
+{
+  if (outChannel >= m_outChannels || inChannel >= m_inChannels)
+    return;
+
+  Channel &channel = m_channels[outChannel];
+  if (channel.count == PCM_REMAP_MAX_CH)
+    return;
+
+  channel.in[channel.count]    = inChannel;
+  channel.level[channel.count] = level;
+  channel.count++;
+  if (channel.mode == MODE_SILENT)
+    channel.mode = MODE_MIX;
+}
+
+void CPCMRemapDSP::SetCopy(unsigned int outChannel)
+{
+  if (outChannel < m_outChannels && m_channels[outChannel].count)
+    m_channels[outChannel].mode = MODE_COPY;
+}
+
+void CPCMRemapDSP::Process(const int16_t *in, int16_t *out, unsigned int frames, float gain, PCMRemapLimiter *limiter)
+{
+  const int16_t *inEnd  = in  + frames * m_inChannels;
+  const int16_t *outEnd = out + frames * m_outChannels;
+
+  // a channel is only copied as is if there's no gain to apply
+  m_copy = gain == 1.0f;
+  bool mixing = false;
+  for (unsigned int ch = 0; ch < m_outChannels; ch++)
+  {
+    const Channel &channel = m_channels[ch];
+    if (channel.mode == MODE_SILENT)
+      m_sources[ch] = m_silence;
+    else if (channel.mode == MODE_COPY && m_copy)
+      m_sources[ch] = m_input + channel.in[0] * PCM_REMAP_BLOCK;
+    else
+    {
+      m_sources[ch] = m_output + ch * PCM_REMAP_BLOCK;
+      mixing = true;
+    }
+  }
+
+  if (!mixing)
+  {
+    Copy(in, out, frames);
+    if (limiter)
+    { // nothing to limit, but the attenuation is still released
+      memset(m_peaks, 0, PCM_REMAP_BLOCK * sizeof(float));
+      for (unsigned int done = 0; done < frames; done += PCM_REMAP_BLOCK)
+        Limit(*limiter, std::min(frames - done, (unsigned int)PCM_REMAP_BLOCK));
+    }
+    return;
+  }
+
+  // splitting the channels up only pays off when the mixing is vectorized
+  if (m_engine == ENGINE_C)
+  {
+    MixInterleaved(in, out, frames, gain, limiter);
+    return;
+  }
+
+  while (frames)
+  {
+    unsigned int block = std::min(frames, (unsigned int)PCM_REMAP_BLOCK);
+
+    Deinterleave(in, inEnd, block);
+    Mix(block, gain);
+    if (limiter)
+    {
+      Peaks(block);
+      if (Limit(*limiter, block))
+        Attenuate(block);
+    }
+    Interleave(out, outEnd, block);
+
+    in     += block * m_inChannels;
+    out    += block * m_outChannels;
+    frames -= block;
+  }
+}
+
+void CPCMRemapDSP::Copy(const int16_t *in, int16_t *out, unsigned int frames)
+{
+  bool identity = m_inChannels == m_outChannels;
+  for (unsigned int ch = 0; ch < m_outChannels && identity; ch++)
+    identity = m_channels[ch].mode == MODE_COPY && m_channels[ch].in[0] == ch;
+  if (identity)
+  {
+    memcpy(out, in, frames * m_outChannels * sizeof(int16_t));
+    return;
+  }
+
+  for (unsigned int ch = 0; ch < m_outChannels; ch++)
+  {
+    int16_t *dst    = out + ch;
+    int16_t *dstend = dst + frames * m_outChannels;
+    if (m_channels[ch].mode == MODE_COPY)
+    {
+      const int16_t *src = in + m_channels[ch].in[0];
+      while (dst != dstend)
+      {
+        *dst = *src;
+        src += m_inChannels;
+        dst += m_outChannels;
+      }
+    }
+    else
+    {
+      while (dst != dstend)
+      {
+        *dst = 0;
+        dst += m_outChannels;
+      }
+    }
+  }
+}
+
+void CPCMRemapDSP::MixInterleaved(const int16_t *in, int16_t *out, unsigned int frames, float gain, PCMRemapLimiter *limiter)
+{
+  // m_output holds a block of interleaved output frames here
+  float *buf = m_output;
+
+  while (frames)
+  {
+    unsigned int block   = std::min(frames, (unsigned int)PCM_REMAP_BLOCK);
+    unsigned int samples = block * m_outChannels;
+    memset(buf, 0, samples * sizeof(float));
+
+    for (unsigned int ch = 0; ch < m_outChannels; ch++)
+    {
+      const Channel &channel = m_channels[ch];
+      int16_t       *dst     = out + ch;
+      int16_t       *dstend  = dst + samples;
+      if (channel.mode == MODE_SILENT)
+      {
+        while (dst != dstend)
+        {
+          *dst = 0;
+          dst += m_outChannels;
+        }
+      }
+      else if (channel.mode == MODE_COPY && m_copy)
+      {
+        const int16_t *src = in + channel.in[0];
+        while (dst != dstend)
+        {
+          *dst = *src;
+          src += m_inChannels;
+          dst += m_outChannels;
+        }
+      }
+      else
+      {
+        for (unsigned int j = 0; j < channel.count; j++)
+        {
+          const int16_t *src    = in + channel.in[j];
+          float         *mix    = buf + ch;
+          float         *mixend = mix + samples;
+          float          level  = channel.level[j];
+          while (mix != mixend)
+          {
+            *mix += (float)*src * level;
+            src += m_inChannels;
+            mix += m_outChannels;
+          }
+        }
+      }
+    }
+
+    if (gain != 1.0f)
+    {
+      for (unsigned int i = 0; i < samples; i++)
+        buf[i] *= gain;
+    }
+
+    if (limiter)
+      LimitInterleaved(*limiter, block);
+
+    for (unsigned int ch = 0; ch < m_outChannels; ch++)
+    {
+      const Channel &channel = m_channels[ch];
+      if (channel.mode == MODE_SILENT || (channel.mode == MODE_COPY && m_copy))
+        continue;
+
+      const float *src    = buf + ch;
+      int16_t     *dst    = out + ch;
+      int16_t     *dstend = dst + samples;
+      while (dst != dstend)
+      {
+        *dst = MathUtils::round_int(std::min(std::max(*src, -32768.0f), 32767.0f));
+        src += m_outChannels;
+        dst += m_outChannels;
+      }
+    }
+
+    in     += block * m_inChannels;
+    out    += samples;
+    frames -= block;
+  }
+}
+
+void CPCMRemapDSP::LimitInterleaved(PCMRemapLimiter &limiter, unsigned int frames)
+{
+  // the state is kept in locals, as stores to the buffer could otherwise alias it
+  float        attenuation    = limiter.attenuation;
+  float        attenuationInc = limiter.attenuationInc;
+  float        attenuationMin = limiter.attenuationMin;
+  unsigned int holdCounter    = limiter.holdCounter;
+
+  float *buf = m_output;
+  for (unsigned int i = 0; i < frames; i++, buf += m_outChannels)
+  {
+    //for each frame, get the highest absolute value, copied and silent channels are 0.0 here
+    float maxAbs = 0.0f;
+    for (unsigned int ch = 0; ch < m_outChannels; ch++)
+    {
+      float absval = fabs(buf[ch]) / 32768.0f;
+      if (maxAbs < absval)
+        maxAbs = absval;
+    }
+
+    //if attenuatedAbs is higher than 1.0f, audio is clipping
+    float attenuatedAbs = maxAbs * attenuation;
+    if (attenuatedAbs > 1.0f)
+    {
+      attenuation = 1.0f / maxAbs;
+      if (attenuation < attenuationMin)
+        attenuationMin = attenuation;
+      attenuationInc = 1.0f - attenuation;
+      holdCounter = limiter.hold;
+    }
+    else if (attenuation < 1.0f && attenuatedAbs > 0.95f)
+    {
+      attenuationInc = 1.0f - attenuation;
+      holdCounter = limiter.hold;
+    }
+
+    if (attenuation != 1.0f)
+    {
+      for (unsigned int ch = 0; ch < m_outChannels; ch++)
+        buf[ch] *= attenuation;
+    }
+
+    if (holdCounter)
+      holdCounter--;
+    else if (attenuationInc > 0.0f)
+    {
+      attenuation += attenuationInc / limiter.sampleRate / limiter.release;
+      if (attenuation > 1.0f)
+      {
+        attenuation = 1.0f;
+        attenuationInc = 0.0f;
+      }
+    }
+  }
+
+  limiter.attenuation    = attenuation;
+  limiter.attenuationInc = attenuationInc;
+  limiter.attenuationMin = attenuationMin;
+  limiter.holdCounter    = holdCounter;
+}
+
+void CPCMRemapDSP::Deinterleave(const int16_t *in, const int16_t *end, unsigned int frames)
+{
+  unsigned int done = 0;
+#ifdef PCM_REMAP_SSE2
+  if (m_engine == ENGINE_SSE2)
+    done = DeinterleaveSSE2(in, end, frames, m_inChannels, m_input);
+#endif
+#ifdef PCM_REMAP_NEON
+  if (m_engine == ENGINE_NEON)
+    done = DeinterleaveNEON(in, end, frames, m_inChannels, m_input);
+#endif
+
+  for (unsigned int ch = 0; ch < m_inChannels; ch++)
+  {
+    const int16_t *src = in + ch;
+    float         *dst = m_input + ch * PCM_REMAP_BLOCK;
+    for (unsigned int i = done; i < frames; i++)
+      dst[i] = (float)src[i * m_inChannels];
+  }
+}
+
+void CPCMRemapDSP::Mix(unsigned int frames, float gain)
+{
+  // the vector engines work on whole blocks of 4, the excess is never output
+  unsigned int frames4 = (frames + 3) & ~3;
+
+  for (unsigned int ch = 0; ch < m_outChannels; ch++)
+  {
+    const Channel &channel = m_channels[ch];
+    float         *dst     = m_output + ch * PCM_REMAP_BLOCK;
+    if (m_sources[ch] != dst)
+      continue;
+
+    for (unsigned int j = 0; j < channel.count; j++)
+    {
+      const float *src   = m_input + channel.in[j] * PCM_REMAP_BLOCK;
+      float        level = channel.level[j];
+      bool         first = j == 0;
+      switch (m_engine)
+      {
+#ifdef PCM_REMAP_SSE2
+        case ENGINE_SSE2:
+        {
+          __m128 l = _mm_set1_ps(level);
+          if (first)
+            for (unsigned int i = 0; i < frames4; i += 4)
+              _mm_store_ps(dst + i, _mm_mul_ps(_mm_load_ps(src + i), l));
+          else
+            for (unsigned int i = 0; i < frames4; i += 4)
+              _mm_store_ps(dst + i, _mm_add_ps(_mm_load_ps(dst + i), _mm_mul_ps(_mm_load_ps(src + i), l)));
+          break;
+        }
+#endif
+#ifdef PCM_REMAP_NEON
+        case ENGINE_NEON:
+        {
+          float32x4_t l = vdupq_n_f32(level);
+          if (first)
+            for (unsigned int i = 0; i < frames4; i += 4)
+              vst1q_f32(dst + i, vmulq_f32(vld1q_f32(src + i), l));
+          else
+            for (unsigned int i = 0; i < frames4; i += 4)
+              vst1q_f32(dst + i, vaddq_f32(vld1q_f32(dst + i), vmulq_f32(vld1q_f32(src + i), l)));
+          break;
+        }
+#endif
+        default:
+          if (first)
+            for (unsigned int i = 0; i < frames; i++)
+              dst[i] = src[i] * level;
+          else
+            for (unsigned int i = 0; i < frames; i++)
+              dst[i] += src[i] * level;
+          break;
+      }
+    }
+
+    if (gain == 1.0f)
+      continue;
+
+    switch (m_engine)
+    {
+#ifdef PCM_REMAP_SSE2
+      case ENGINE_SSE2:
+      {
+        __m128 g = _mm_set1_ps(gain);
+        for (unsigned int i = 0; i < frames4; i += 4)
+          _mm_store_ps(dst + i, _mm_mul_ps(_mm_load_ps(dst + i), g));
+        break;
+      }
+#endif
+#ifdef PCM_REMAP_NEON
+      case ENGINE_NEON:
+      {
+        float32x4_t g = vdupq_n_f32(gain);
+        for (unsigned int i = 0; i < frames4; i += 4)
+          vst1q_f32(dst + i, vmulq_f32(vld1q_f32(dst + i), g));
+        break;
+      }
+#endif
+      default:
+        for (unsigned int i = 0; i < frames; i++)
+          dst[i] *= gain;
+        break;
+    }
+  }
+}
+
+void CPCMRemapDSP::Peaks(unsigned int frames)
+{
+  unsigned int frames4 = (frames + 3) & ~3;
+
+  switch (m_engine)
+  {
+#ifdef PCM_REMAP_SSE2
+    case ENGINE_SSE2:
+    {
+      const __m128 sign  = _mm_set1_ps(-0.0f);
+      const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+      for (unsigned int i = 0; i < frames4; i += 4)
+      {
+        __m128 peak = _mm_setzero_ps();
+        for (unsigned int ch = 0; ch < m_outChannels; ch++)
+          if (m_sources[ch] == m_output + ch * PCM_REMAP_BLOCK)
+            peak = _mm_max_ps(peak, _mm_andnot_ps(sign, _mm_load_ps(m_sources[ch] + i)));
+        _mm_store_ps(m_peaks + i, _mm_mul_ps(peak, scale));
+      }
+      break;
+    }
+#endif
+#ifdef PCM_REMAP_NEON
+    case ENGINE_NEON:
+    {
+      const float32x4_t scale = vdupq_n_f32(1.0f / 32768.0f);
+      for (unsigned int i = 0; i < frames4; i += 4)
+      {
+        float32x4_t peak = vdupq_n_f32(0.0f);
+        for (unsigned int ch = 0; ch < m_outChannels; ch++)
+          if (m_sources[ch] == m_output + ch * PCM_REMAP_BLOCK)
+            peak = vmaxq_f32(peak, vabsq_f32(vld1q_f32(m_sources[ch] + i)));
+        vst1q_f32(m_peaks + i, vmulq_f32(peak, scale));
+      }
+      break;
+    }
+#endif
+    default:
+      for (unsigned int i = 0; i < frames; i++)
+      {
+        float peak = 0.0f;
+        for (unsigned int ch = 0; ch < m_outChannels; ch++)
+        {
+          if (m_sources[ch] != m_output + ch * PCM_REMAP_BLOCK)
+            continue;
+          float absval = fabs(m_sources[ch][i]) / 32768.0f;
+          if (peak < absval)
+            peak = absval;
+        }
+        m_peaks[i] = peak;
+      }
+      break;
+  }
+}
+
+bool CPCMRemapDSP::Limit(PCMRemapLimiter &limiter, unsigned int frames)
+{
+  bool attenuate = false;
+  for (unsigned int i = 0; i < frames; i++)
+  {
+    //if attenuatedAbs is higher than 1.0f, audio is clipping
+    float attenuatedAbs = m_peaks[i] * limiter.attenuation;
+    if (attenuatedAbs > 1.0f)
+    {
+      //set attenuation so that attenuation * sample is the maximum output value
+      limiter.attenuation = 1.0f / m_peaks[i];
+      if (limiter.attenuation < limiter.attenuationMin)
+        limiter.attenuationMin = limiter.attenuation;
+      //value to add to attenuation to make it 1.0f
+      limiter.attenuationInc = 1.0f - limiter.attenuation;
+      //amount of samples to hold attenuation
+      limiter.holdCounter = limiter.hold;
+    }
+    else if (limiter.attenuation < 1.0f && attenuatedAbs > 0.95f)
+    {
+      //if we're attenuating and we get within 5% of clipping, hold attenuation
+      limiter.attenuationInc = 1.0f - limiter.attenuation;
+      limiter.holdCounter = limiter.hold;
+    }
+
+    m_attenuation[i] = limiter.attenuation;
+    if (limiter.attenuation != 1.0f)
+      attenuate = true;
+
+    if (limiter.holdCounter)
+    {
+      //hold attenuation
+      limiter.holdCounter--;
+    }
+    else if (limiter.attenuationInc > 0.0f)
+    {
+      //move attenuation to 1.0 in release seconds
+      limiter.attenuation += limiter.attenuationInc / limiter.sampleRate / limiter.release;
+      if (limiter.attenuation > 1.0f)
+      {
+        limiter.attenuation = 1.0f;
+        limiter.attenuationInc = 0.0f;
+      }
+    }
+  }
+  return attenuate;
+}
+
+void CPCMRemapDSP::Attenuate(unsigned int frames)
+{
+  unsigned int frames4 = (frames + 3) & ~3;
+
+  for (unsigned int ch = 0; ch < m_outChannels; ch++)
+  {
+    float *dst = m_output + ch * PCM_REMAP_BLOCK;
+    if (m_sources[ch] != dst)
+      continue;
+
+    switch (m_engine)
+    {
+#ifdef PCM_REMAP_SSE2
+      case ENGINE_SSE2:
+        for (unsigned int i = 0; i < frames4; i += 4)
+          _mm_store_ps(dst + i, _mm_mul_ps(_mm_load_ps(dst + i), _mm_load_ps(m_attenuation + i)));
+        break;
+#endif
+#ifdef PCM_REMAP_NEON
+      case ENGINE_NEON:
+        for (unsigned int i = 0; i < frames4; i += 4)
+          vst1q_f32(dst + i, vmulq_f32(vld1q_f32(dst + i), vld1q_f32(m_attenuation + i)));
+        break;
+#endif
+      default:
+        for (unsigned int i = 0; i < frames; i++)
+          dst[i] *= m_attenuation[i];
+        break;
+    }
+  }
+}
+
+void CPCMRemapDSP::Interleave(int16_t *out, const int16_t *end, unsigned int frames)
+{
+  unsigned int done = 0;
+#ifdef PCM_REMAP_SSE2
+  if (m_engine == ENGINE_SSE2)
+    done = InterleaveSSE2(out, end, frames, m_outChannels, m_sources);
+#endif
+#ifdef PCM_REMAP_NEON
+  if (m_engine == ENGINE_NEON)
+    done = InterleaveNEON(out, end, frames, m_outChannels, m_sources);
+#endif
+
+  for (unsigned int ch = 0; ch < m_outChannels; ch++)
+  {
+    const float *src = m_sources[ch];
+    int16_t     *dst = out + ch;
+    if (src < m_output)
+    { // copied or silent, so already a whole sample
+      for (unsigned int i = done; i < frames; i++)
+        dst[i * m_outChannels] = (int16_t)src[i];
+    }
+    else
+    {
+      for (unsigned int i = done; i < frames; i++)
+        dst[i * m_outChannels] = MathUtils::round_int(std::min(std::max(src[i], -32768.0f), 32767.0f));
+    }
+  }
+}
@@ -0,0 +1,141 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define PCM_REMAP_MAX_CH 18
+#define PCM_REMAP_BLOCK  256 ///< frames processed at a time, a multiple of 4
+
+/*!
+ \ingroup utils
+ \brief State of the limiter that keeps mixed channels from clipping, carried over between calls
+ */
+struct PCMRemapLimiter
+{
+  float        attenuation;    ///< current attenuation
+  float        attenuationInc; ///< amount the attenuation is released by to get back to 1.0
+  float        attenuationMin; ///< lowest attenuation since attenuationMin was last reset
+  unsigned int holdCounter;    ///< frames left to hold the attenuation for
+  float        sampleRate;
+  unsigned int hold;           ///< frames to hold the attenuation for once audio gets close to clipping
+  float        release;        ///< seconds to release the attenuation back to 1.0 in
+};
+
+/*!
+ \ingroup utils
+ \brief Mixes interleaved 16 bit input channels into output channels, applies gain and limits
+
+ Layouts that only copy or drop channels are copied straight through. The C engine mixes
+ into interleaved floats, as CPCMRemap always did. The SSE2 and NEON engines process frames
+ in blocks instead: the input is split into one float array per channel, each output channel
+ is mixed from those arrays four frames at a time, and the result is rounded and interleaved
+ again with the channel shuffles specialized for the channel count. All engines give the
+ same result bit for bit.
+ */
+class CPCMRemapDSP
+{
+public:
+  enum Engine
+  {
+    ENGINE_C = 0,
+    ENGINE_SSE2,
+    ENGINE_NEON
+  };
+
+  CPCMRemapDSP();
+  ~CPCMRemapDSP();
+
+  /*! \brief Get the fastest engine available
+   \param cpuFeatures the CPU_FEATURE_* flags of the cpu, see CCPUInfo::GetCPUFeatures
+   */
+  static Engine GetBestEngine(unsigned int cpuFeatures);
+  static const char *GetEngineName(Engine engine);
+
+  /*! \brief Select the engine to process with
+   \return false if the engine isn't compiled in, the C engine is used then
+   */
+  bool SetEngine(Engine engine);
+  Engine GetEngine() const { return m_engine; };
+
+  /*! \brief Set the channel counts, clearing the mix
+   */
+  void SetChannels(unsigned int inChannels, unsigned int outChannels);
+
+  /*! \brief Mix an input channel into an output channel
+   Input channels are summed in the order they are added.
+   */
+  void AddMix(unsigned int outChannel, unsigned int inChannel, float level);
+
+  /*! \brief Copy the first input channel mixed into an output channel unchanged, as long as no gain is applied
+   */
+  void SetCopy(unsigned int outChannel);
+
+  /*! \brief Remap frames
+   \param in interleaved input frames
+   \param out interleaved output frames, written completely
+   \param frames number of frames
+   \param gain gain applied to the mixed channels
+   \param limiter limiter to run over the mixed channels, NULL to not limit
+   */
+  void Process(const int16_t *in, int16_t *out, unsigned int frames, float gain, PCMRemapLimiter *limiter);
+
+private:
+  enum Mode
+  {
+    MODE_SILENT = 0, ///< nothing mixed in
+    MODE_COPY,       ///< a single channel copied as long as the gain is 1.0
+    MODE_MIX
+  };
+
+  struct Channel
+  {
+    Mode         mode;
+    unsigned int count;
+    unsigned int in[PCM_REMAP_MAX_CH];
+    float        level[PCM_REMAP_MAX_CH];
+  };
+
+  void Copy(const int16_t *in, int16_t *out, unsigned int frames);
+  void MixInterleaved(const int16_t *in, int16_t *out, unsigned int frames, float gain, PCMRemapLimiter *limiter);
+  void LimitInterleaved(PCMRemapLimiter &limiter, unsigned int frames);
+  void Deinterleave(const int16_t *in, const int16_t *end, unsigned int frames);
+  void Mix(unsigned int frames, float gain);
+  void Peaks(unsigned int frames);
+  bool Limit(PCMRemapLimiter &limiter, unsigned int frames);
+  void Attenuate(unsigned int frames);
+  void Interleave(int16_t *out, const int16_t *end, unsigned int frames);
+
+  Engine       m_engine;
+  unsigned int m_inChannels;
+  unsigned int m_outChannels;
+  Channel      m_channels[PCM_REMAP_MAX_CH];
+  bool         m_copy;                         ///< whether copied channels are taken as is in this call
+  const float *m_sources[PCM_REMAP_MAX_CH];    ///< per output channel the block it is interleaved from
+
+  void        *m_memory;
+  float       *m_input;       ///< PCM_REMAP_BLOCK frames per input channel
+  float       *m_output;      ///< PCM_REMAP_BLOCK frames per output channel
+  float       *m_silence;     ///< PCM_REMAP_BLOCK zeroes
+  float       *m_peaks;       ///< per frame the highest absolute value of the mixed channels, 1.0 being full scale
+  float       *m_attenuation; ///< per frame the attenuation applied by the limiter
+};
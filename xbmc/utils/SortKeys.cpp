@@ -0,0 +1,145 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+#include "SortKeys.h"
+#include <algorithm>
+#include <locale>
+#include <map>
+
+using namespace std;
+
+#define MAX_DIGITS 15 // AlphaNumericCompare compares only up to 15 digits at a time
+
+static inline bool IsDigit(wchar_t c)
+{
+  return c >= L'0' && c <= L'9';
+}
+
+static inline wchar_t Fold(wchar_t c)
+{
+  if (c >= L'A' && c <= L'Z')
+    return c + L'a' - L'A';
+  return c;
+}
+
+class CollateLess
+{
+public:
+  CollateLess(const collate<wchar_t> &coll) : m_coll(coll) {}
+  bool operator()(wchar_t left, wchar_t right) const
+  {
+    return m_coll.compare(&left, &left + 1, &right, &right + 1) < 0;
+  }
+private:
+  const collate<wchar_t> &m_coll;
+};
+
+bool CSortKeys::Build(const vector<const wchar_t *> &strings, vector<string> &keys)
+{
+  keys.clear();
+  const collate<wchar_t>& coll = use_facet< collate<wchar_t> >( locale() );
+
+  // collect the characters in use, digits always
+  bool latin[256] = { false };
+  map<wchar_t, unsigned int> others;
+  for (wchar_t c = L'0'; c <= L'9'; c++)
+    latin[c] = true;
+  for (vector<const wchar_t *>::const_iterator i = strings.begin(); i != strings.end(); ++i)
+  {
+    for (const wchar_t *c = *i; c && *c; c++)
+    {
+      wchar_t f = Fold(*c);
+      if ((unsigned int)f < 256)
+        latin[f] = true;
+      else
+        others[f] = 0;
+    }
+  }
+  vector<wchar_t> chars;
+  for (unsigned int c = 0; c < 256; c++)
+    if (latin[c])
+      chars.push_back(c);
+  for (map<wchar_t, unsigned int>::const_iterator i = others.begin(); i != others.end(); ++i)
+    chars.push_back(i->first);
+
+  // rank them by collation, characters that collate equal get the same rank
+  CollateLess less(coll);
+  stable_sort(chars.begin(), chars.end(), less);
+  unsigned int ranks[256] = { 0 };
+  unsigned int rank = 0, minDigit = ~0U, maxDigit = 0;
+  for (unsigned int i = 0; i < chars.size(); i++)
+  {
+    if (i && less(chars[i - 1], chars[i]))
+      rank++;
+    if ((unsigned int)chars[i] < 256)
+      ranks[chars[i]] = rank;
+    else
+      others[chars[i]] = rank;
+    if (IsDigit(chars[i]))
+    {
+      minDigit = min(minDigit, rank);
+      maxDigit = max(maxDigit, rank);
+    }
+  }
+  if (rank > 0xffff)
+    return false;
+
+  // a character compared against a digit compares against the start of a number, so
+  // no character may collate among the digits for all numbers to share their position
+  for (unsigned int i = 0; i < chars.size(); i++)
+  {
+    if (IsDigit(chars[i]))
+      continue;
+    unsigned int r = (unsigned int)chars[i] < 256 ? ranks[chars[i]] : others[chars[i]];
+    if (r >= minDigit && r <= maxDigit)
+      return false;
+  }
+
+  keys.resize(strings.size());
+  for (unsigned int i = 0; i < strings.size(); i++)
+  {
+    string &key = keys[i];
+    const wchar_t *c = strings[i];
+    while (c && *c)
+    {
+      if (IsDigit(*c))
+      {
+        const wchar_t *end = c;
+        while (IsDigit(*end) && end < c + MAX_DIGITS)
+          end++;
+        while (c < end && *c == L'0') // leading zeros don't count
+          c++;
+        key += (char)(minDigit >> 8);
+        key += (char)(minDigit & 0xff);
+        key += (char)(end - c);
+        for (; c < end; c++)
+          key += (char)(*c - L'0');
+        continue;
+      }
+      wchar_t f = Fold(*c);
+      unsigned int r = (unsigned int)f < 256 ? ranks[f] : others[f];
+      key += (char)(r >> 8);
+      key += (char)(r & 0xff);
+      c++;
+    }
+  }
+  return true;
+}
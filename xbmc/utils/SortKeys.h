@@ -0,0 +1,62 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+#pragma once
+
+#include <string.h>
+#include <string>
+#include <vector>
+
+/*!
+ \ingroup utils
+ \brief Binary sort keys that order strings as StringUtils::AlphaNumericCompare does
+
+ AlphaNumericCompare parses numbers and looks up the collation of the current locale
+ on each comparison.  When sorting many strings it is much cheaper to do that work once
+ per string, building a key that is then compared bytewise.
+
+ Each character is replaced by its rank among the characters in use, as ordered by the
+ collation, and each run of up to 15 digits by the digits' rank, the number of
+ significant digits and the digits themselves.
+ */
+class CSortKeys
+{
+public:
+  /*! \brief Build the keys for a set of strings
+   \param strings the strings to build keys for
+   \param keys [out] the keys, one per string in the same order
+   \return false if the collation can't be expressed by keys, in which case the strings
+   must be compared with AlphaNumericCompare
+   */
+  static bool Build(const std::vector<const wchar_t *> &strings, std::vector<std::string> &keys);
+
+  /*! \brief Compare two keys
+   \return negative if left sorts before right, positive if after and 0 if they are equal
+   */
+  static inline int Compare(const std::string &left, const std::string &right)
+  {
+    size_t length = left.size() < right.size() ? left.size() : right.size();
+    int result = memcmp(left.data(), right.data(), length);
+    if (result)
+      return result;
+    return (int)left.size() - (int)right.size();
+  }
+};
@@ -19,107 +19,333 @@
  *
  */
 #include "Variant.h"
+#include <stdlib.h>
 #include <string.h>
+#include <new>
 #include <sstream>
 
 using namespace std;
 
 CVariant CVariant::ConstNullVariant = CVariant::VariantTypeConstNull;
 
-CVariant::CVariant(VariantType type)
+CVariantArena::CVariantArena(size_t blockSize /* = 4096 */)
 {
-  m_type = type;
+  m_current = NULL;
+  m_left = 0;
+  m_blockSize = blockSize;
+}
+
+CVariantArena::~CVariantArena()
+{
+  for (vector<char *>::iterator itr = m_blocks.begin(); itr != m_blocks.end(); itr++)
+    delete[] *itr;
+}
 
-  switch (type)
+void *CVariantArena::Allocate(size_t size)
+{
+  size = (size + 7) & ~(size_t)7;
+  if (size > m_left)
   {
-    case VariantTypeInteger:
-      m_data.integer = 0;
-      break;
-    case VariantTypeUnsignedInteger:
-      m_data.unsignedinteger = 0;
-      break;
-    case VariantTypeBoolean:
-      m_data.boolean = false;
-      break;
-    case VariantTypeDouble:
-      m_data.dvalue = 0.0;
-      break;
-    case VariantTypeString:
-    case VariantTypeArray:
-    case VariantTypeObject:
-    default:
-      memset(&m_data, 0, sizeof(m_data));
-      break;
+    // big allocations get a block of their own, so little is wasted
+    if (size > m_blockSize / 4)
+    {
+      char *block = new char[size];
+      m_blocks.push_back(block);
+      return block;
+    }
+
+    m_current = new char[m_blockSize];
+    m_blocks.push_back(m_current);
+    m_left = m_blockSize;
   }
+
+  void *memory = m_current;
+  m_current += size;
+  m_left -= size;
+  return memory;
+}
+
+void *CVariantArena::Reallocate(void *memory, size_t size, size_t newSize)
+{
+  // the last allocation of the current block can simply grow
+  size = (size + 7) & ~(size_t)7;
+  newSize = (newSize + 7) & ~(size_t)7;
+  if (memory != NULL && (char *)memory + size == m_current && newSize - size <= m_left)
+  {
+    m_current = (char *)memory + newSize;
+    m_left -= newSize - size;
+    return memory;
+  }
+
+  void *data = Allocate(newSize);
+  if (size > 0)
+    memcpy(data, memory, size);
+  return data;
+}
+
+const string *CVariantArena::NewKey(const string &key)
+{
+  return &*m_keys.insert(key).first;
+}
+
+CVariant::CVariant(VariantType type)
+{
+  Initialize(type, NULL);
 }
 
 CVariant::CVariant(int integer)
 {
-  m_type = VariantTypeInteger;
+  Initialize(VariantTypeInteger, NULL);
   m_data.integer = integer;
 }
 
 CVariant::CVariant(int64_t integer)
 {
-  m_type = VariantTypeInteger;
+  Initialize(VariantTypeInteger, NULL);
   m_data.integer = integer;
 }
 
 CVariant::CVariant(unsigned int unsignedinteger)
 {
-  m_type = VariantTypeUnsignedInteger;
+  Initialize(VariantTypeUnsignedInteger, NULL);
   m_data.unsignedinteger = unsignedinteger;
 }
 
 CVariant::CVariant(uint64_t unsignedinteger)
 {
-  m_type = VariantTypeUnsignedInteger;
+  Initialize(VariantTypeUnsignedInteger, NULL);
   m_data.unsignedinteger = unsignedinteger;
 }
 
 CVariant::CVariant(double value)
 {
-  m_type = VariantTypeDouble;
+  Initialize(VariantTypeDouble, NULL);
   m_data.dvalue = value;
 }
 
 CVariant::CVariant(float value)
 {
-  m_type = VariantTypeDouble;
+  Initialize(VariantTypeDouble, NULL);
   m_data.dvalue = (double)value;
 }
 
 CVariant::CVariant(bool boolean)
 {
-  m_type = VariantTypeBoolean;
+  Initialize(VariantTypeBoolean, NULL);
   m_data.boolean = boolean;
 }
 
 CVariant::CVariant(const char *str)
 {
-  m_type = VariantTypeString;
-  m_string = str;
+  Initialize(VariantTypeNull, NULL);
+  SetString(str, strlen(str));
 }
 
 CVariant::CVariant(const char *str, unsigned int length)
 {
-  m_type = VariantTypeString;
-  m_string = string(str, length);
+  Initialize(VariantTypeNull, NULL);
+  SetString(str, length);
 }
 
 CVariant::CVariant(const string &str)
 {
-  m_type = VariantTypeString;
-  m_string = str;
+  Initialize(VariantTypeNull, NULL);
+  SetString(str.c_str(), str.size());
 }
 
 CVariant::CVariant(const CVariant &variant)
 {
-  m_type = variant.m_type;
-  *this = variant;
+  Initialize(VariantTypeNull, NULL);
+  CopyFrom(variant);
+}
+
+CVariant::CVariant(CVariantArena &arena, VariantType type /* = VariantTypeNull */)
+{
+  Initialize(type, &arena);
+}
+
+CVariant::~CVariant()
+{
+  Release();
+}
+
+void CVariant::Initialize(VariantType type, CVariantArena *arena)
+{
+  // all zero is 0, 0u, false, 0.0 and an empty string, array or object
+  m_type = type;
+  m_size = 0;
+  memset(&m_data, 0, sizeof(m_data));
+  m_arena = arena;
+}
+
+void CVariant::Release()
+{
+  // whatever a variant in an arena holds is in the arena too
+  if (m_arena == NULL)
+  {
+    if (m_type == VariantTypeString && m_size > SmallStringLength)
+      Free(m_data.heap.data);
+    else if (m_type == VariantTypeArray)
+    {
+      CVariant *elements = Elements();
+      for (unsigned int i = 0; i < m_size; i++)
+        elements[i].~CVariant();
+      Free(m_data.heap.data);
+    }
+    else if (m_type == VariantTypeObject)
+    {
+      Member *members = Members();
+      for (unsigned int i = 0; i < m_size; i++)
+      {
+        if (members[i].ownsKey)
+          delete members[i].key;
+        members[i].~Member();
+      }
+      Free(m_data.heap.data);
+    }
+  }
+
+  m_size = 0;
+  memset(&m_data, 0, sizeof(m_data));
+}
+
+void CVariant::CopyFrom(const CVariant &rhs)
+{
+  // expects to be empty, keeps its own arena
+  switch (rhs.m_type)
+  {
+  case VariantTypeString:
+    SetString(rhs.c_str(), rhs.m_size);
+    break;
+  case VariantTypeArray:
+  {
+    m_type = VariantTypeArray;
+    Reserve(rhs.m_size);
+    CVariant *elements = Elements();
+    const CVariant *source = rhs.Elements();
+    for (; m_size < rhs.m_size; m_size++)
+    {
+      new (&elements[m_size]) CVariant();
+      elements[m_size].m_arena = m_arena;
+      elements[m_size].CopyFrom(source[m_size]);
+    }
+    break;
+  }
+  case VariantTypeObject:
+  {
+    m_type = VariantTypeObject;
+    Reserve(rhs.m_size);
+    Member *members = Members();
+    const Member *source = rhs.Members();
+    for (; m_size < rhs.m_size; m_size++)
+    {
+      Member *member = new (&members[m_size]) Member();
+      // keys interned in the same arena are shared, that's what they are for
+      if (source[m_size].ownsKey || m_arena != rhs.m_arena)
+        member->key = NewKey(*source[m_size].key, member->ownsKey);
+      else
+      {
+        member->key = source[m_size].key;
+        member->ownsKey = false;
+      }
+      member->value.m_arena = m_arena;
+      member->value.CopyFrom(source[m_size].value);
+    }
+    break;
+  }
+  default:
+    m_type = rhs.m_type;
+    m_data = rhs.m_data;
+    break;
+  }
+}
+
+void CVariant::SetString(const char *str, unsigned int length)
+{
+  m_type = VariantTypeString;
+  m_size = length;
+
+  char *data = m_data.smallstring;
+  if (length > SmallStringLength)
+  {
+    data = (char *)Allocate(length + 1);
+    m_data.heap.data = data;
+  }
+
+  memcpy(data, str, length);
+  data[length] = '\0';
+}
+
+void CVariant::Reserve(unsigned int capacity)
+{
+  if (capacity <= m_data.heap.capacity)
+    return;
+
+  size_t elementSize = m_type == VariantTypeArray ? sizeof(CVariant) : sizeof(Member);
+  unsigned int newCapacity = m_data.heap.capacity * 2;
+  if (newCapacity < capacity)
+    newCapacity = capacity;
+  if (newCapacity < 4)
+    newCapacity = 4;
+
+  // neither elements nor members point to themselves, so they can be moved as they are.
+  // their heap data and keys stay where they are and are owned by whichever copy is live.
+  if (m_arena == NULL)
+    m_data.heap.data = realloc(m_data.heap.data, newCapacity * elementSize);
+  else
+    m_data.heap.data = m_arena->Reallocate(m_data.heap.data, m_data.heap.capacity * elementSize, newCapacity * elementSize);
+
+  m_data.heap.capacity = newCapacity;
+}
+
+bool CVariant::Find(const string &key, unsigned int &index) const
+{
+  const Member *members = Members();
+  unsigned int low = 0, high = m_size;
+  while (low < high)
+  {
+    unsigned int middle = (low + high) / 2;
+    int result = members[middle].key->compare(key);
+    if (result < 0)
+      low = middle + 1;
+    else if (result > 0)
+      high = middle;
+    else
+    {
+      index = middle;
+      return true;
+    }
+  }
+
+  index = low;
+  return false;
+}
+
+const string *CVariant::NewKey(const string &key, bool &owned) const
+{
+  owned = m_arena == NULL;
+  if (m_arena)
+    return m_arena->NewKey(key);
+
+  return new string(key);
+}
+
+void *CVariant::Allocate(size_t size) const
+{
+  if (m_arena)
+    return m_arena->Allocate(size);
+
+  return malloc(size);
+}
+
+void CVariant::Free(void *memory) const
+{
+  if (m_arena == NULL)
+    free(memory);
 }
 
 bool CVariant::isInteger() const
+
 {
   return m_type == VariantTypeInteger;
 }
@@ -245,7 +471,7 @@ bool CVariant::asBoolean(bool fallback) const
     case VariantTypeDouble:
       return (bool)m_data.dvalue;
     case VariantTypeString:
-      if (m_string.empty() || m_string.compare("0") == 0 || m_string.compare("false") == 0)
+      if (m_size == 0 || (m_size == 1 && c_str()[0] == '0') || (m_size == 5 && memcmp(c_str(), "false", 5) == 0))
         return false;
       return true;
     default:
@@ -260,7 +486,7 @@ std::string CVariant::asString(const std::string &fallback /* = "" */) const
   switch (m_type)
   {
     case VariantTypeString:
-      return m_string;
+      return string(c_str(), m_size);
     case VariantTypeBoolean:
       return m_data.boolean ? "true" : "false";
     case VariantTypeInteger:
@@ -288,28 +514,44 @@ CVariant &CVariant::operator[](const std::string &key)
   if (m_type == VariantTypeNull)
   {
     m_type = VariantTypeObject;
-    m_map.clear();
+    Release();
   }
 
-  if (m_type == VariantTypeObject)
-    return m_map[key];
-  else
+  if (m_type != VariantTypeObject)
     return ConstNullVariant;
+
+  unsigned int index;
+  if (Find(key, index))
+    return Members()[index].value;
+
+  Reserve(m_size + 1);
+  Member *members = Members();
+  // members are relocated bitwise like in Reserve(), nothing points into them
+  memmove((void *)&members[index + 1], (const void *)&members[index], (m_size - index) * sizeof(Member));
+  m_size++;
+
+  Member *member = new (&members[index]) Member();
+  member->key = NewKey(key, member->ownsKey);
+  member->value.m_arena = m_arena;
+  return member->value;
 }
 
 const CVariant &CVariant::operator[](const std::string &key) const
 {
-  VariantMap::const_iterator it;
-  if (m_type == VariantTypeObject && (it = m_map.find(key)) != m_map.end())
-    return it->second;
-  else
-    return ConstNullVariant;
+  if (m_type == VariantTypeObject)
+  {
+    unsigned int index;
+    if (Find(key, index))
+      return Members()[index].value;
+  }
+
+  return ConstNullVariant;
 }
 
 CVariant &CVariant::operator[](unsigned int position)
 {
   if (m_type == VariantTypeArray && size() > position)
-    return m_array[position];
+    return Elements()[position];
   else
     return ConstNullVariant;
 }
@@ -317,45 +559,29 @@ CVariant &CVariant::operator[](unsigned int position)
 const CVariant &CVariant::operator[](unsigned int position) const
 {
   if (m_type == VariantTypeArray && size() > position)
-    return m_array.at(position);
+    return Elements()[position];
   else
     return ConstNullVariant;
 }
 
 CVariant &CVariant::operator=(const CVariant &rhs)
 {
-  if (m_type == VariantTypeConstNull)
+  if (m_type == VariantTypeConstNull || this == &rhs)
     return *this;
 
-  m_type = rhs.m_type;
+  // rhs may well be part of this variant, so copy before releasing
+  CVariant copy;
+  copy.m_arena = m_arena;
+  copy.CopyFrom(rhs);
 
-  switch (m_type)
-  {
-  case VariantTypeInteger:
-    m_data.integer = rhs.m_data.integer;
-    break;
-  case VariantTypeUnsignedInteger:
-    m_data.integer = rhs.m_data.unsignedinteger;
-    break;
-  case VariantTypeBoolean:
-    m_data.boolean = rhs.m_data.boolean;
-    break;
-  case VariantTypeDouble:
-    m_data.dvalue = rhs.m_data.dvalue;
-    break;
-  case VariantTypeString:
-    m_string = rhs.m_string;
-    break;
-  case VariantTypeArray:
-    m_array.assign(rhs.m_array.begin(), rhs.m_array.end());
-    break;
-  case VariantTypeObject:
-    m_map.clear();
-    m_map.insert(rhs.m_map.begin(), rhs.m_map.end());
-    break;
-  default:
-    break;
-  }
+  Release();
+  m_type = copy.m_type;
+  m_size = copy.m_size;
+  m_data = copy.m_data;
+
+  copy.m_type = VariantTypeNull;
+  copy.m_size = 0;
+  memset(&copy.m_data, 0, sizeof(copy.m_data));
 
   return *this;
 }
@@ -375,11 +601,27 @@ bool CVariant::operator==(const CVariant &rhs) const
     case VariantTypeDouble:
       return m_data.dvalue == rhs.m_data.dvalue;
     case VariantTypeString:
-      return m_string == rhs.m_string;
+      return m_size == rhs.m_size && memcmp(c_str(), rhs.c_str(), m_size) == 0;
     case VariantTypeArray:
-      return m_array == rhs.m_array;
+      if (m_size != rhs.m_size)
+        return false;
+      for (unsigned int i = 0; i < m_size; i++)
+      {
+        if (!(Elements()[i] == rhs.Elements()[i]))
+          return false;
+      }
+      return true;
     case VariantTypeObject:
-      return m_map == rhs.m_map;
+      if (m_size != rhs.m_size)
+        return false;
+      for (unsigned int i = 0; i < m_size; i++)
+      {
+        const Member &member = Members()[i];
+        const Member &rhsMember = rhs.Members()[i];
+        if ((member.key != rhsMember.key && *member.key != *rhsMember.key) || !(member.value == rhsMember.value))
+          return false;
+      }
+      return true;
     default:
       break;
     }
@@ -393,11 +635,28 @@ void CVariant::push_back(const CVariant &variant)
   if (m_type == VariantTypeNull)
   {
     m_type = VariantTypeArray;
-    m_array.clear();
+    Release();
   }
 
   if (m_type == VariantTypeArray)
-    m_array.push_back(variant);
+  {
+    // variant may be one of our elements, which growing would move
+    CVariant copy;
+    copy.m_arena = m_arena;
+    copy.CopyFrom(variant);
+
+    Reserve(m_size + 1);
+    CVariant *element = new (&Elements()[m_size]) CVariant();
+    element->m_type = copy.m_type;
+    element->m_size = copy.m_size;
+    element->m_data = copy.m_data;
+    element->m_arena = m_arena;
+    m_size++;
+
+    copy.m_type = VariantTypeNull;
+    copy.m_size = 0;
+    memset(&copy.m_data, 0, sizeof(copy.m_data));
+  }
 }
 
 void CVariant::append(const CVariant &variant)
@@ -408,36 +667,39 @@ void CVariant::append(const CVariant &variant)
 const char *CVariant::c_str() const
 {
   if (m_type == VariantTypeString)
-    return m_string.c_str();
+    return m_size > SmallStringLength ? (const char *)m_data.heap.data : m_data.smallstring;
   else
     return NULL;
 }
 
 void CVariant::swap(CVariant &rhs)
 {
+  if (m_arena != rhs.m_arena)
+  {
+    // the contents have to move into the other allocator
+    CVariant temp(*this);
+    *this = rhs;
+    rhs = temp;
+    return;
+  }
+
   VariantType  temp_type = m_type;
+  unsigned int temp_size = m_size;
   VariantUnion temp_data = m_data;
-  string       temp_string = m_string;
-  VariantArray temp_array = m_array;
-  VariantMap   temp_map = m_map;
 
   m_type = rhs.m_type;
+  m_size = rhs.m_size;
   m_data = rhs.m_data;
-  m_string = rhs.m_string;
-  m_array = rhs.m_array;
-  m_map = rhs.m_map;
 
   rhs.m_type = temp_type;
+  rhs.m_size = temp_size;
   rhs.m_data = temp_data;
-  rhs.m_string = temp_string;
-  rhs.m_array = temp_array;
-  rhs.m_map = temp_map;
 }
 
 CVariant::iterator_array CVariant::begin_array()
 {
   if (m_type == VariantTypeArray)
-    return m_array.begin();
+    return Elements();
   else
     return iterator_array();
 }
@@ -445,7 +707,7 @@ CVariant::iterator_array CVariant::begin_array()
 CVariant::const_iterator_array CVariant::begin_array() const
 {
   if (m_type == VariantTypeArray)
-    return m_array.begin();
+    return Elements();
   else
     return const_iterator_array();
 }
@@ -453,7 +715,7 @@ CVariant::const_iterator_array CVariant::begin_array() const
 CVariant::iterator_array CVariant::end_array()
 {
   if (m_type == VariantTypeArray)
-    return m_array.end();
+    return Elements() + m_size;
   else
     return iterator_array();
 }
@@ -461,7 +723,7 @@ CVariant::iterator_array CVariant::end_array()
 CVariant::const_iterator_array CVariant::end_array() const
 {
   if (m_type == VariantTypeArray)
-    return m_array.end();
+    return Elements() + m_size;
   else
     return const_iterator_array();
 }
@@ -469,7 +731,7 @@ CVariant::const_iterator_array CVariant::end_array() const
 CVariant::iterator_map CVariant::begin_map()
 {
   if (m_type == VariantTypeObject)
-    return m_map.begin();
+    return iterator_map(Members());
   else
     return iterator_map();
 }
@@ -477,7 +739,7 @@ CVariant::iterator_map CVariant::begin_map()
 CVariant::const_iterator_map CVariant::begin_map() const
 {
   if (m_type == VariantTypeObject)
-    return m_map.begin();
+    return const_iterator_map(Members());
   else
     return const_iterator_map();
 }
@@ -485,7 +747,7 @@ CVariant::const_iterator_map CVariant::begin_map() const
 CVariant::iterator_map CVariant::end_map()
 {
   if (m_type == VariantTypeObject)
-    return m_map.end();
+    return iterator_map(Members() + m_size);
   else
     return iterator_map();
 }
@@ -493,43 +755,31 @@ CVariant::iterator_map CVariant::end_map()
 CVariant::const_iterator_map CVariant::end_map() const
 {
   if (m_type == VariantTypeObject)
-    return m_map.end();
+    return const_iterator_map(Members() + m_size);
   else
     return const_iterator_map();
 }
 
 unsigned int CVariant::size() const
 {
-  if (m_type == VariantTypeObject)
-    return m_map.size();
-  else if (m_type == VariantTypeArray)
-    return m_array.size();
-  else if (m_type == VariantTypeString)
-    return m_string.size();
+  if (m_type == VariantTypeObject || m_type == VariantTypeArray || m_type == VariantTypeString)
+    return m_size;
   else
     return 0;
 }
 
 bool CVariant::empty() const
 {
-  if (m_type == VariantTypeObject)
-    return m_map.empty();
-  else if (m_type == VariantTypeArray)
-    return m_array.empty();
-  else if (m_type == VariantTypeString)
-    return m_string.empty();
+  if (m_type == VariantTypeObject || m_type == VariantTypeArray || m_type == VariantTypeString)
+    return m_size == 0;
   else
     return true;
 }
 
 void CVariant::clear()
 {
-  if (m_type == VariantTypeObject)
-    m_map.clear();
-  else if (m_type == VariantTypeArray)
-    m_array.clear();
-  else if (m_type == VariantTypeString)
-    m_string.clear();
+  if (m_type == VariantTypeObject || m_type == VariantTypeArray || m_type == VariantTypeString)
+    Release();
 }
 
 void CVariant::erase(const std::string &key)
@@ -537,10 +787,21 @@ void CVariant::erase(const std::string &key)
   if (m_type == VariantTypeNull)
   {
     m_type = VariantTypeObject;
-    m_map.clear();
+    Release();
   }
   else if (m_type == VariantTypeObject)
-    m_map.erase(key);
+  {
+    unsigned int index;
+    if (Find(key, index))
+    {
+      Member *members = Members();
+      if (members[index].ownsKey)
+        delete members[index].key;
+      members[index].~Member();
+      memmove((void *)&members[index], (const void *)&members[index + 1], (m_size - index - 1) * sizeof(Member));
+      m_size--;
+    }
+  }
 }
 
 void CVariant::erase(unsigned int position)
@@ -548,17 +809,25 @@ void CVariant::erase(unsigned int position)
   if (m_type == VariantTypeNull)
   {
     m_type = VariantTypeArray;
-    m_array.clear();
+    Release();
   }
 
   if (m_type == VariantTypeArray && position < size())
-    m_array.erase(m_array.begin() + position);
+  {
+    CVariant *elements = Elements();
+    elements[position].~CVariant();
+    memmove((void *)&elements[position], (const void *)&elements[position + 1], (m_size - position - 1) * sizeof(CVariant));
+    m_size--;
+  }
 }
 
 bool CVariant::isMember(const std::string &key) const
 {
   if (m_type == VariantTypeObject)
-    return m_map.find(key) != m_map.end();
+  {
+    unsigned int index;
+    return Find(key, index);
+  }
 
   return false;
 }
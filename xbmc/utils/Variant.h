@@ -20,10 +20,43 @@
  *
  */
 #include <map>
+#include <set>
 #include <vector>
 #include <string>
+#include <stddef.h>
 #include <stdint.h>
 
+/*!
+ \brief Allocator for the variants of a short-lived tree, e.g. a parsed request
+
+ Storage taken from the arena is only given back when the arena is destroyed,
+ which makes building a tree cheap. A variant constructed with an arena allocates
+ all its children from it, so the arena has to outlive the whole tree. Copying
+ a variant out of the tree with the copy constructor gives a normal one.
+ The keys of the objects in the tree are interned in the arena, so objects with
+ the same layout share them. An arena must only be used by one thread at a time.
+ */
+class CVariantArena
+{
+public:
+  CVariantArena(size_t blockSize = 4096);
+  ~CVariantArena();
+
+  void *Allocate(size_t size);
+  void *Reallocate(void *memory, size_t size, size_t newSize);
+  const std::string *NewKey(const std::string &key);
+
+private:
+  CVariantArena(const CVariantArena&);
+  CVariantArena& operator=(const CVariantArena&);
+
+  std::vector<char *> m_blocks;
+  std::set<std::string> m_keys;
+  char *m_current;
+  size_t m_left;
+  size_t m_blockSize;
+};
+
 class CVariant
 {
 public:
@@ -52,6 +85,8 @@ public:
   CVariant(const char *str, unsigned int length);
   CVariant(const std::string &str);
   CVariant(const CVariant &variant);
+  CVariant(CVariantArena &arena, VariantType type = VariantTypeNull);
+  ~CVariant();
 
   bool isInteger() const;
   bool isUnsignedInteger() const;
@@ -71,6 +106,11 @@ public:
   double asDouble(double fallback = 0.0) const;
   float asFloat(float fallback = 0.0f) const;
 
+  /*!
+   \brief Get the member with the given key, adding it if it doesn't exist yet.
+   Members are stored in one sorted array, so adding or erasing a member moves its
+   siblings: references and iterators to the members of the object are invalidated.
+   */
   CVariant &operator[](const std::string &key);
   const CVariant &operator[](const std::string &key) const;
   CVariant &operator[](unsigned int position);
@@ -87,15 +127,48 @@ public:
   void swap(CVariant &rhs);
 
 private:
-  typedef std::vector<CVariant> VariantArray;
-  typedef std::map<std::string, CVariant> VariantMap;
+  struct Member;
+
+  /*!
+   \brief What an iterator over an object's members points to, so members
+   can be used like the std::pair of a std::map
+   */
+  template<class V> struct MemberReference
+  {
+    MemberReference(const std::string &key, V &value) : first(key), second(value) { }
+    const MemberReference *operator->() const { return this; }
+
+    const std::string &first;
+    V &second;
+  };
+
+  template<class M, class V> class MemberIterator
+  {
+  public:
+    MemberIterator(M *member = NULL) : m_member(member) { }
+    template<class M2, class V2> MemberIterator(const MemberIterator<M2, V2> &other) : m_member(other.m_member) { }
+
+    MemberReference<V> operator*() const { return MemberReference<V>(*m_member->key, m_member->value); }
+    MemberReference<V> operator->() const { return **this; }
+    MemberIterator &operator++() { m_member++; return *this; }
+    MemberIterator operator++(int) { MemberIterator temp(*this); m_member++; return temp; }
+    MemberIterator &operator--() { m_member--; return *this; }
+    MemberIterator operator--(int) { MemberIterator temp(*this); m_member--; return temp; }
+    bool operator==(const MemberIterator &rhs) const { return m_member == rhs.m_member; }
+    bool operator!=(const MemberIterator &rhs) const { return m_member != rhs.m_member; }
+
+  private:
+    template<class M2, class V2> friend class MemberIterator;
+    friend class CVariant;
+    M *m_member;
+  };
 
 public:
-  typedef VariantArray::iterator        iterator_array;
-  typedef VariantArray::const_iterator  const_iterator_array;
+  typedef CVariant*                                      iterator_array;
+  typedef const CVariant*                                const_iterator_array;
 
-  typedef VariantMap::iterator          iterator_map;
-  typedef VariantMap::const_iterator    const_iterator_map;
+  typedef MemberIterator<Member, CVariant>               iterator_map;
+  typedef MemberIterator<const Member, const CVariant>   const_iterator_map;
 
   iterator_array begin_array();
   const_iterator_array begin_array() const;
@@ -116,19 +189,54 @@ public:
   bool isMember(const std::string &key) const;
 
 private:
+  // strings up to this length are stored in the variant itself
+  static const unsigned int SmallStringLength = 15;
+
+  // longer strings, the elements of an array or the members of an object
+  struct HeapStorage
+  {
+    void *data;
+    unsigned int capacity;
+  };
+
   union VariantUnion
   {
     int64_t integer;
     uint64_t unsignedinteger;
     bool boolean;
     double dvalue;
+    char smallstring[SmallStringLength + 1];
+    HeapStorage heap;
   };
 
+  CVariant *Elements() const { return (CVariant *)m_data.heap.data; }
+  Member *Members() const { return (Member *)m_data.heap.data; }
+
+  void Initialize(VariantType type, CVariantArena *arena);
+  void Release();
+  void CopyFrom(const CVariant &rhs);
+  void SetString(const char *str, unsigned int length);
+  void Reserve(unsigned int capacity);
+  bool Find(const std::string &key, unsigned int &index) const;
+  const std::string *NewKey(const std::string &key, bool &owned) const;
+  void *Allocate(size_t size) const;
+  void Free(void *memory) const;
+
   VariantType m_type;
+  unsigned int m_size;     ///< length of a string or number of elements/members
   VariantUnion m_data;
-  std::string m_string;
-  VariantArray m_array;
-  VariantMap m_map;
+  CVariantArena *m_arena;
 
   static CVariant ConstNullVariant;
 };
+
+/*!
+ \brief A member of an object. Members are kept sorted by key. A variant in an
+ arena shares the keys interned there, any other owns the keys of its members.
+ */
+struct CVariant::Member
+{
+  const std::string *key;
+  CVariant value;
+  bool ownsKey;
+};
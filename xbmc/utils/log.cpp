@@ -26,7 +26,13 @@
 #include "threads/CriticalSection.h"
 #include "threads/SingleLock.h"
 #include "threads/Thread.h"
+#include "threads/Atomics.h"
+#include "threads/LockFreeRing.h"
+#include "threads/SystemClock.h"
 #include "utils/StdString.h"
+#ifndef _LINUX
+#include <io.h>
+#endif
 
 #define critSec XBMC_GLOBAL_USE(CLog::CLogGlobals).critSec
 #define m_file XBMC_GLOBAL_USE(CLog::CLogGlobals).m_file
@@ -34,10 +40,163 @@
 #define m_repeatLogLevel XBMC_GLOBAL_USE(CLog::CLogGlobals).m_repeatLogLevel
 #define m_repeatLine XBMC_GLOBAL_USE(CLog::CLogGlobals).m_repeatLine
 #define m_logLevel XBMC_GLOBAL_USE(CLog::CLogGlobals).m_logLevel
+#define m_writer XBMC_GLOBAL_USE(CLog::CLogGlobals).m_writer
+#define m_async XBMC_GLOBAL_USE(CLog::CLogGlobals).m_async
+#define m_dropped XBMC_GLOBAL_USE(CLog::CLogGlobals).m_dropped
+
+#define LOG_RING_SIZE      2048 // lines the asynchronous writer may fall behind
+#define LOG_LINE_SIZE       512 // longer lines are formatted onto the heap
+#define LOG_WAKE_INTERVAL   100 // ms between two batches of the writer
+#define LOG_SYNC_INTERVAL  1000 // ms between two syncs of the log file to disk
 
 static char levelNames[][8] =
 {"DEBUG", "INFO", "NOTICE", "WARNING", "ERROR", "SEVERE", "FATAL", "NONE"};
 
+static const char* prefixFormat = "%02.2d:%02.2d:%02.2d T:%"PRIu64" %7s: ";
+
+/*!
+ \brief Writes the lines of CLog to the log file, either directly from CLog::Log or,
+ in asynchronous mode, from its own thread which drains the lines queued up by CLog::Log.
+ */
+class CLogWriter : public CThread
+{
+public:
+  struct Line
+  {
+    int         level;
+    uint64_t    threadId;
+    SYSTEMTIME  time;
+    char*       longText; // heap copy of lines that don't fit into text, NULL otherwise
+    char        text[LOG_LINE_SIZE];
+  };
+
+  CLogWriter() : CThread("LogWriter"), m_lines(LOG_RING_SIZE), m_reported(0), m_lastSync(0)
+  {
+  }
+
+  /*! \brief Write a line and fold repeats, critSec must be held.
+   \return true if anything was written.
+   */
+  static bool WriteLine(int loglevel, uint64_t threadId, const SYSTEMTIME& time, CStdString& strData);
+
+  /*! \brief Write out all queued lines.
+   */
+  void Flush();
+
+  XbmcThreads::MPSCRing<Line> m_lines;
+  CEvent                      m_wake;
+protected:
+  virtual void Process();
+private:
+  long         m_reported; // dropped lines already reported in the log
+  unsigned int m_lastSync;
+};
+
+bool CLogWriter::WriteLine(int loglevel, uint64_t threadId, const SYSTEMTIME& time, CStdString& strData)
+{
+  CStdString strPrefix;
+
+  if (m_repeatLogLevel == loglevel && m_repeatLine == strData)
+  {
+    m_repeatCount++;
+    return false;
+  }
+  else if (m_repeatCount)
+  {
+    CStdString strData2;
+    strPrefix.Format(prefixFormat, time.wHour, time.wMinute, time.wSecond, threadId, levelNames[m_repeatLogLevel]);
+
+    strData2.Format("Previous line repeats %d times." LINE_ENDING, m_repeatCount);
+    fputs(strPrefix.c_str(), m_file);
+    fputs(strData2.c_str(), m_file);
+    CLog::OutputDebugString(strData2);
+    m_repeatCount = 0;
+  }
+
+  m_repeatLine      = strData;
+  m_repeatLogLevel  = loglevel;
+
+  unsigned int length = 0;
+  while ( length != strData.length() )
+  {
+    length = strData.length();
+    strData.TrimRight(" ");
+    strData.TrimRight('\n');
+    strData.TrimRight("\r");
+  }
+
+  if (!length)
+    return false;
+
+  CLog::OutputDebugString(strData);
+
+  /* fixup newline alignment, number of spaces should equal prefix length */
+  strData.Replace("\n", LINE_ENDING"                                            ");
+  strData += LINE_ENDING;
+
+  strPrefix.Format(prefixFormat, time.wHour, time.wMinute, time.wSecond, threadId, levelNames[loglevel]);
+
+  fputs(strPrefix.c_str(), m_file);
+  fputs(strData.c_str(), m_file);
+  return true;
+}
+
+void CLogWriter::Flush()
+{
+  bool sync = false;
+  CStdString strData;
+
+  CSingleLock waitLock(critSec);
+  Line* line;
+  while ((line = m_lines.Front()))
+  {
+    if (m_file)
+    {
+      strData = line->longText ? line->longText : line->text;
+      WriteLine(line->level, line->threadId, line->time, strData);
+      if (line->level >= LOGERROR)
+        sync = true;
+    }
+    free(line->longText);
+    m_lines.Pop();
+  }
+
+  long dropped = cas(&m_dropped, 0, 0);
+  if (dropped != m_reported && m_file)
+  {
+    SYSTEMTIME time;
+    GetLocalTime(&time);
+    strData.Format("%ld log lines dropped, the log writer fell behind", dropped - m_reported);
+    WriteLine(LOGWARNING, (uint64_t)CThread::GetCurrentThreadId(), time, strData);
+    m_reported = dropped;
+  }
+
+  if (!m_file)
+    return;
+
+  fflush(m_file);
+  unsigned int now = XbmcThreads::SystemClockMillis();
+  if (sync || now - m_lastSync >= LOG_SYNC_INTERVAL)
+  {
+#ifdef _LINUX
+    fsync(fileno(m_file));
+#else
+    _commit(_fileno(m_file));
+#endif
+    m_lastSync = now;
+  }
+}
+
+void CLogWriter::Process()
+{
+  while (!m_bStop)
+  {
+    AbortableWait(m_wake, LOG_WAKE_INTERVAL);
+    Flush();
+  }
+  Flush();
+}
+
 CLog::CLog()
 {}
 
@@ -46,8 +205,11 @@ CLog::~CLog()
 
 void CLog::Close()
 {
-  
+  SetAsync(false);
+
   CSingleLock waitLock(critSec);
+  if (m_writer)
+    m_writer->Flush(); // lines that raced with switching off the asynchronous mode
   if (m_file)
   {
     fclose(m_file);
@@ -58,20 +220,62 @@ void CLog::Close()
 
 void CLog::Log(int loglevel, const char *format, ... )
 {
-  static const char* prefixFormat = "%02.2d:%02.2d:%02.2d T:%"PRIu64" %7s: ";
-  CSingleLock waitLock(critSec);
 #if !(defined(_DEBUG) || defined(PROFILE))
   if (m_logLevel > LOG_LEVEL_NORMAL ||
      (m_logLevel > LOG_LEVEL_NONE && loglevel >= LOGNOTICE))
 #endif
   {
+    CLogWriter* writer = m_async ? m_writer : NULL;
+    if (writer)
+    {
+      if (!m_file)
+        return;
+
+      // format straight into a slot of the ring, the writer does the rest
+      CLogWriter::Line* line = writer->m_lines.Claim();
+      if (!line)
+      {
+        AtomicIncrement(&m_dropped);
+        writer->m_wake.Set();
+        return;
+      }
+
+      line->level    = loglevel;
+      line->threadId = (uint64_t)CThread::GetCurrentThreadId();
+      line->longText = NULL;
+      GetLocalTime(&line->time);
+
+      va_list va;
+      va_start(va, format);
+#ifndef _LINUX
+      int length = _vsnprintf(line->text, LOG_LINE_SIZE, format, va);
+#else
+      int length = vsnprintf(line->text, LOG_LINE_SIZE, format, va);
+#endif
+      va_end(va);
+      if (length < 0 || length >= LOG_LINE_SIZE)
+      {
+        CStdString strData;
+        va_start(va, format);
+        strData.FormatV(format, va);
+        va_end(va);
+        line->longText = strdup(strData.c_str());
+      }
+      writer->m_lines.Publish(line);
+
+      if (loglevel >= LOGERROR || writer->m_lines.Size() > LOG_RING_SIZE / 2)
+        writer->m_wake.Set();
+      return;
+    }
+
+    CSingleLock waitLock(critSec);
     if (!m_file)
       return;
 
     SYSTEMTIME time;
     GetLocalTime(&time);
 
-    CStdString strPrefix, strData;
+    CStdString strData;
 
     strData.reserve(16384);
     va_list va;
@@ -79,49 +283,8 @@ void CLog::Log(int loglevel, const char *format, ... )
     strData.FormatV(format,va);
     va_end(va);
 
-    if (m_repeatLogLevel == loglevel && m_repeatLine == strData)
-    {
-      m_repeatCount++;
-      return;
-    }
-    else if (m_repeatCount)
-    {
-      CStdString strData2;
-      strPrefix.Format(prefixFormat, time.wHour, time.wMinute, time.wSecond, (uint64_t)CThread::GetCurrentThreadId(), levelNames[m_repeatLogLevel]);
-
-      strData2.Format("Previous line repeats %d times." LINE_ENDING, m_repeatCount);
-      fputs(strPrefix.c_str(), m_file);
-      fputs(strData2.c_str(), m_file);
-      OutputDebugString(strData2);
-      m_repeatCount = 0;
-    }
-    
-    m_repeatLine      = strData;
-    m_repeatLogLevel  = loglevel;
-
-    unsigned int length = 0;
-    while ( length != strData.length() )
-    {
-      length = strData.length();
-      strData.TrimRight(" ");
-      strData.TrimRight('\n');
-      strData.TrimRight("\r");
-    }
-
-    if (!length)
-      return;
-    
-    OutputDebugString(strData);
-
-    /* fixup newline alignment, number of spaces should equal prefix length */
-    strData.Replace("\n", LINE_ENDING"                                            ");
-    strData += LINE_ENDING;
-
-    strPrefix.Format(prefixFormat, time.wHour, time.wMinute, time.wSecond, (uint64_t)CThread::GetCurrentThreadId(), levelNames[loglevel]);
-
-    fputs(strPrefix.c_str(), m_file);
-    fputs(strData.c_str(), m_file);
-    fflush(m_file);
+    if (CLogWriter::WriteLine(loglevel, (uint64_t)CThread::GetCurrentThreadId(), time, strData))
+      fflush(m_file);
   }
 }
 
@@ -202,6 +365,35 @@ int CLog::GetLogLevel()
   return m_logLevel;
 }
 
+void CLog::SetAsync(bool async)
+{
+  CSingleLock waitLock(critSec);
+  if (async == m_async)
+    return;
+
+  if (async)
+  {
+    if (!m_writer)
+      m_writer = new CLogWriter;
+    m_writer->Create();
+    m_async = true;
+  }
+  else
+  {
+    // the writer drains the ring before it stops. the ring stays around for
+    // callers that already picked the asynchronous path, Close flushes those
+    m_async = false;
+    CLogWriter* writer = m_writer;
+    waitLock.Leave();
+    writer->StopThread();
+  }
+}
+
+unsigned int CLog::GetDroppedLines()
+{
+  return (unsigned int)cas(&m_dropped, 0, 0);
+}
+
 void CLog::OutputDebugString(const std::string& line)
 {
 #if defined(_DEBUG) || defined(PROFILE)
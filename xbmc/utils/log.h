@@ -50,6 +50,8 @@
 #define ATTRIB_LOG_FORMAT
 #endif
 
+class CLogWriter;
+
 class CLog
 {
 public:
@@ -57,12 +59,15 @@ public:
   class CLogGlobals
   {
   public:
-    CLogGlobals() : m_file(NULL), m_repeatCount(0), m_repeatLogLevel(-1), m_logLevel(LOG_LEVEL_DEBUG) {}
+    CLogGlobals() : m_file(NULL), m_repeatCount(0), m_repeatLogLevel(-1), m_logLevel(LOG_LEVEL_DEBUG), m_writer(NULL), m_async(false), m_dropped(0) {}
     FILE*       m_file;
     int         m_repeatCount;
     int         m_repeatLogLevel;
     std::string m_repeatLine;
     int         m_logLevel;
+    CLogWriter*   m_writer;  // background writer of the asynchronous mode, kept once created
+    volatile bool m_async;
+    volatile long m_dropped; // lines lost because the writer fell behind
     CCriticalSection critSec;
   };
 
@@ -74,7 +79,21 @@ public:
   static bool Init(const char* path);
   static void SetLogLevel(int level);
   static int  GetLogLevel();
+
+  /*! \brief Switch between writing lines on the calling thread and handing them to a background writer.
+   In asynchronous mode callers format the line straight into a slot of a lock free ring and return,
+   the writer thread batches the lines into the log file and syncs it to disk on a timer or as soon
+   as an error is logged. If the ring is full the line is dropped and counted.
+   \param async true to enable the asynchronous mode.
+   \sa GetDroppedLines
+   */
+  static void SetAsync(bool async);
+
+  /*! \brief Number of lines dropped in asynchronous mode because the ring was full.
+   */
+  static unsigned int GetDroppedLines();
 private:
+  friend class CLogWriter;
   static void OutputDebugString(const std::string& line);
 };
 
@@ -30,8 +30,179 @@
 #include "ssrc.h" 
 #include "system.h"
 #include "utils/MathUtils.h"
+#include "utils/CPUInfo.h"
+#include "threads/Thread.h"
 //#include "SRand.h"
 
+//--------------------------------------------------------------------------------------
+// Vector butterflies. Only built for float REALs, as a vector then holds two complex
+// values. They do exactly the float operations the scalar code does on each value, so
+// the output is the same bit for bit.
+//--------------------------------------------------------------------------------------
+#if !defined(HIGH_PREC) && (defined(__SSE2__) || defined(_MSC_VER))
+#define SSRC_SSE2
+#define SSRC_VECTOR
+#include <emmintrin.h>
+
+typedef __m128 VREAL;
+
+static inline VREAL VLoad(const REAL *p)         { return _mm_loadu_ps(p); }
+static inline void  VStore(REAL *p, VREAL x)     { _mm_storeu_ps(p, x); }
+static inline VREAL VAdd(VREAL x, VREAL y)       { return _mm_add_ps(x, y); }
+static inline VREAL VSub(VREAL x, VREAL y)       { return _mm_sub_ps(x, y); }
+static inline VREAL VMul(VREAL x, VREAL y)       { return _mm_mul_ps(x, y); }
+// (r0, i0, r1, i1) -> (i0, r0, i1, r1)
+static inline VREAL VSwap(VREAL x)               { return _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1)); }
+// negates the real/imaginary parts
+static inline VREAL VNegRe(VREAL x)              { return _mm_xor_ps(x, _mm_castsi128_ps(_mm_setr_epi32(0x80000000, 0, 0x80000000, 0))); }
+static inline VREAL VNegIm(VREAL x)              { return _mm_xor_ps(x, _mm_castsi128_ps(_mm_setr_epi32(0, 0x80000000, 0, 0x80000000))); }
+// (x0, x0, x1, x1)
+static inline VREAL VPair(REAL x0, REAL x1)      { return _mm_setr_ps(x0, x0, x1, x1); }
+static inline VREAL VEvens(VREAL x)              { return _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 2, 0, 0)); }
+static inline VREAL VOdds(VREAL x)               { return _mm_shuffle_ps(x, x, _MM_SHUFFLE(3, 3, 1, 1)); }
+
+#elif !defined(HIGH_PREC) && defined(__ARM_NEON__)
+#define SSRC_NEON
+#define SSRC_VECTOR
+#include <arm_neon.h>
+
+typedef float32x4_t VREAL;
+
+static inline VREAL VLoad(const REAL *p)         { return vld1q_f32(p); }
+static inline void  VStore(REAL *p, VREAL x)     { vst1q_f32(p, x); }
+static inline VREAL VAdd(VREAL x, VREAL y)       { return vaddq_f32(x, y); }
+static inline VREAL VSub(VREAL x, VREAL y)       { return vsubq_f32(x, y); }
+static inline VREAL VMul(VREAL x, VREAL y)       { return vmulq_f32(x, y); }
+static inline VREAL VSwap(VREAL x)               { return vrev64q_f32(x); }
+static inline VREAL VNegRe(VREAL x)
+{
+  static const uint32_t mask[4] = { 0x80000000, 0, 0x80000000, 0 };
+  return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(x), vld1q_u32(mask)));
+}
+static inline VREAL VNegIm(VREAL x)
+{
+  static const uint32_t mask[4] = { 0, 0x80000000, 0, 0x80000000 };
+  return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(x), vld1q_u32(mask)));
+}
+static inline VREAL VPair(REAL x0, REAL x1)      { return vcombine_f32(vdup_n_f32(x0), vdup_n_f32(x1)); }
+static inline VREAL VEvens(VREAL x)              { return vtrnq_f32(x, x).val[0]; }
+static inline VREAL VOdds(VREAL x)               { return vtrnq_f32(x, x).val[1]; }
+#endif
+
+#ifdef SSRC_VECTOR
+// (r * xr - i * xi, r * xi + i * xr)
+static inline VREAL VMulA(VREAL x, VREAL r, VREAL i)
+{
+  return VAdd(VMul(r, x), VNegRe(VMul(i, VSwap(x))));
+}
+
+// (r * xr + i * xi, r * xi - i * xr)
+static inline VREAL VMulB(VREAL x, VREAL r, VREAL i)
+{
+  return VAdd(VMul(r, x), VNegIm(VMul(i, VSwap(x))));
+}
+
+// the radix 4 butterfly of cftf1st() and cftmdl1() on two complex values
+static inline void VButterflyF(REAL *a0, REAL *a1, REAL *a2, REAL *a3,
+                               VREAL w1r, VREAL w1i, VREAL w3r, VREAL w3i)
+{
+  VREAL x0 = VAdd(VLoad(a0), VLoad(a2));
+  VREAL x1 = VSub(VLoad(a0), VLoad(a2));
+  VREAL x2 = VAdd(VLoad(a1), VLoad(a3));
+  VREAL x3 = VSub(VLoad(a1), VLoad(a3));
+  VStore(a0, VAdd(x0, x2));
+  VStore(a1, VSub(x0, x2));
+  x3 = VSwap(x3);
+  VStore(a2, VMulA(VAdd(x1, VNegRe(x3)), w1r, w1i));
+  VStore(a3, VMulB(VAdd(x1, VNegIm(x3)), w3r, w3i));
+}
+
+// the radix 4 butterfly of cftb1st() on two complex values
+static inline void VButterflyB(REAL *a0, REAL *a1, REAL *a2, REAL *a3,
+                               VREAL w1r, VREAL w1i, VREAL w3r, VREAL w3i)
+{
+  VREAL y0 = VNegIm(VLoad(a0));
+  VREAL y2 = VNegIm(VLoad(a2));
+  VREAL x0 = VAdd(y0, y2);
+  VREAL x1 = VSub(y0, y2);
+  VREAL x2 = VNegIm(VAdd(VLoad(a1), VLoad(a3)));
+  VREAL x3 = VSwap(VSub(VLoad(a1), VLoad(a3)));
+  VStore(a0, VAdd(x0, x2));
+  VStore(a1, VSub(x0, x2));
+  VStore(a2, VMulA(VAdd(x1, x3), w1r, w1i));
+  VStore(a3, VMulB(VSub(x1, x3), w3r, w3i));
+}
+
+// the radix 4 butterfly of cftmdl2() on two complex values
+static inline void VButterflyM2(REAL *a0, REAL *a1, REAL *a2, REAL *a3,
+                                VREAL w0r, VREAL w0i, VREAL w1r, VREAL w1i,
+                                VREAL w2r, VREAL w2i, VREAL w3r, VREAL w3i)
+{
+  VREAL s2 = VNegRe(VSwap(VLoad(a2)));
+  VREAL s3 = VNegRe(VSwap(VLoad(a3)));
+  VREAL x0 = VAdd(VLoad(a0), s2);
+  VREAL x1 = VSub(VLoad(a0), s2);
+  VREAL x2 = VAdd(VLoad(a1), s3);
+  VREAL x3 = VSub(VLoad(a1), s3);
+  VREAL y0 = VMulA(x0, w0r, w0i);
+  VREAL y2 = VMulA(x2, w1r, w1i);
+  VStore(a0, VAdd(y0, y2));
+  VStore(a1, VSub(y0, y2));
+  y0 = VMulB(x1, w2r, w2i);
+  y2 = VMulB(x3, w3r, w3i);
+  VStore(a2, VAdd(y0, y2));
+  VStore(a3, VSub(y0, y2));
+}
+#endif
+
+//--------------------------------------------------------------------------------------
+// Filters a share of the channels of a Cssrc each time it's started
+//--------------------------------------------------------------------------------------
+class CssrcWorker : public CThread
+{
+public:
+  CssrcWorker(Cssrc *owner, int first, int step) : CThread("Cssrc worker")
+  {
+    m_owner = owner;
+    m_first = first;
+    m_step = step;
+    Create();
+  }
+
+  void Start() { m_start.Set(); }
+  void Wait() { m_done.Wait(); }
+
+  void Stop()
+  {
+    m_bStop = true;
+    m_start.Set();
+    StopThread();
+  }
+
+protected:
+  // an AbortableWait can wake up a second time for a single Set, when the
+  // event is set while the worker is between two waits, so only m_start
+  // is waited on
+  virtual void Process()
+  {
+    while (true)
+    {
+      m_start.Wait();
+      if (m_bStop)
+        break;
+      m_owner->FilterChannels(m_first, m_step);
+      m_done.Set();
+    }
+  }
+
+private:
+  Cssrc *m_owner;
+  int m_first;
+  int m_step;
+  CEvent m_start;
+  CEvent m_done;
+};
+
 //--------------------------------------------------------------------------------------
 void Cssrc::cdft(int n, int isgn, REAL *a, int *ip, REAL *w)
 {
@@ -1083,6 +1254,24 @@ void Cssrc::cftf1st(int n, REAL *a, REAL *w)
     wd1i = w[k + 1];
     wd3r = w[k + 2];
     wd3i = -w[k + 3];
+#ifdef SSRC_VECTOR
+    if (m_vector)
+    {
+      j1 = j + m;
+      j2 = j1 + m;
+      j3 = j2 + m;
+      VButterflyF(&a[j], &a[j1], &a[j2], &a[j3],
+                  VPair(wk1r, wd1r), VPair(wk1i, wd1i), VPair(wk3r, wd3r), VPair(wk3i, wd3i));
+      // the lanes of j + 2 come first here
+      j0 = m - j;
+      j1 = j0 + m;
+      j2 = j1 + m;
+      j3 = j2 + m;
+      VButterflyF(&a[j0 - 2], &a[j1 - 2], &a[j2 - 2], &a[j3 - 2],
+                  VPair(wd1i, wk1i), VPair(wd1r, wk1r), VPair(wd3i, wk3i), VPair(wd3r, wk3r));
+      continue;
+    }
+#endif
     j1 = j + m;
     j2 = j1 + m;
     j3 = j2 + m;
@@ -1291,6 +1480,24 @@ void Cssrc::cftb1st(int n, REAL *a, REAL *w)
     wd1i = w[k + 1];
     wd3r = w[k + 2];
     wd3i = -w[k + 3];
+#ifdef SSRC_VECTOR
+    if (m_vector)
+    {
+      j1 = j + m;
+      j2 = j1 + m;
+      j3 = j2 + m;
+      VButterflyB(&a[j], &a[j1], &a[j2], &a[j3],
+                  VPair(wk1r, wd1r), VPair(wk1i, wd1i), VPair(wk3r, wd3r), VPair(wk3i, wd3i));
+      // the lanes of j + 2 come first here
+      j0 = m - j;
+      j1 = j0 + m;
+      j2 = j1 + m;
+      j3 = j2 + m;
+      VButterflyB(&a[j0 - 2], &a[j1 - 2], &a[j2 - 2], &a[j3 - 2],
+                  VPair(wd1i, wk1i), VPair(wd1r, wk1r), VPair(wd3i, wk3i), VPair(wd3r, wk3r));
+      continue;
+    }
+#endif
     j1 = j + m;
     j2 = j1 + m;
     j3 = j2 + m;
@@ -1603,7 +1810,37 @@ void Cssrc::cftmdl1(int n, REAL *a, REAL *w)
   a[j3 + 1] = x1i - x3r;
   wn4r = w[1];
   k = 0;
-  for (j = 2; j < mh; j += 2)
+  j = 2;
+#ifdef SSRC_VECTOR
+  if (m_vector)
+  {
+    // two iterations at a time
+    for (; j < mh - 2; j += 4)
+    {
+      REAL k1r[2], k1i[2], k3r[2], k3i[2];
+      for (int t = 0; t < 2; t++)
+      {
+        k += 4;
+        k1r[t] = w[k];
+        k1i[t] = w[k + 1];
+        k3r[t] = w[k + 2];
+        k3i[t] = -w[k + 3];
+      }
+      j1 = j + m;
+      j2 = j1 + m;
+      j3 = j2 + m;
+      VButterflyF(&a[j], &a[j1], &a[j2], &a[j3],
+                  VPair(k1r[0], k1r[1]), VPair(k1i[0], k1i[1]), VPair(k3r[0], k3r[1]), VPair(k3i[0], k3i[1]));
+      j0 = m - j;
+      j1 = j0 + m;
+      j2 = j1 + m;
+      j3 = j2 + m;
+      VButterflyF(&a[j0 - 2], &a[j1 - 2], &a[j2 - 2], &a[j3 - 2],
+                  VPair(k1i[1], k1i[0]), VPair(k1r[1], k1r[0]), VPair(k3i[1], k3i[0]), VPair(k3r[1], k3r[0]));
+    }
+  }
+#endif
+  for (; j < mh; j += 2)
   {
     k += 4;
     wk1r = w[k];
@@ -1720,7 +1957,44 @@ void Cssrc::cftmdl2(int n, REAL *a, REAL *w)
   a[j3 + 1] = x1i - y0r;
   k = 0;
   kr = 2 * m;
-  for (j = 2; j < mh; j += 2)
+  j = 2;
+#ifdef SSRC_VECTOR
+  if (m_vector)
+  {
+    // two iterations at a time
+    for (; j < mh - 2; j += 4)
+    {
+      REAL k1r[2], k1i[2], k3r[2], k3i[2], d1r[2], d1i[2], d3r[2], d3i[2];
+      for (int t = 0; t < 2; t++)
+      {
+        k += 4;
+        k1r[t] = w[k];
+        k1i[t] = w[k + 1];
+        k3r[t] = w[k + 2];
+        k3i[t] = -w[k + 3];
+        kr -= 4;
+        d1i[t] = w[kr];
+        d1r[t] = w[kr + 1];
+        d3i[t] = w[kr + 2];
+        d3r[t] = -w[kr + 3];
+      }
+      j1 = j + m;
+      j2 = j1 + m;
+      j3 = j2 + m;
+      VButterflyM2(&a[j], &a[j1], &a[j2], &a[j3],
+                   VPair(k1r[0], k1r[1]), VPair(k1i[0], k1i[1]), VPair(d1r[0], d1r[1]), VPair(d1i[0], d1i[1]),
+                   VPair(k3r[0], k3r[1]), VPair(k3i[0], k3i[1]), VPair(d3r[0], d3r[1]), VPair(d3i[0], d3i[1]));
+      j0 = m - j;
+      j1 = j0 + m;
+      j2 = j1 + m;
+      j3 = j2 + m;
+      VButterflyM2(&a[j0 - 2], &a[j1 - 2], &a[j2 - 2], &a[j3 - 2],
+                   VPair(d1i[1], d1i[0]), VPair(d1r[1], d1r[0]), VPair(k1i[1], k1i[0]), VPair(k1r[1], k1r[0]),
+                   VPair(d3i[1], d3i[0]), VPair(d3r[1], d3r[0]), VPair(k3i[1], k3i[0]), VPair(k3r[1], k3r[0]));
+    }
+  }
+#endif
+  for (; j < mh; j += 2)
   {
     k += 4;
     wk1r = w[k];
@@ -2529,6 +2803,14 @@ Cssrc::Cssrc(void)
   stage2DS = NULL;
   UpSampling = false;
   DownSampling = false;
+  m_vector = false;
+  m_threads = 1;
+  m_workers = NULL;
+  m_workerCount = 0;
+  m_results = NULL;
+  m_fftIp = NULL;
+  m_fftIpSize = 0;
+  SetQuality(QUALITY_MEDIUM);
 }
 
 //--------------------------------------------------------------------------------------
@@ -2542,6 +2824,14 @@ Cssrc::~Cssrc()
 //--------------------------------------------------------------------------------------
 void Cssrc::DeInitialize()
 {
+  StopWorkers();
+  if (m_results) delete [] m_results; m_results = NULL;
+  if (m_fftIp)
+  {
+    for (int i = 0;i < nch;i++)
+      delete [] m_fftIp[i];
+    delete [] m_fftIp; m_fftIp = NULL;
+  }
   if (f1order) delete [] f1order; f1order = NULL;
   if (f1inc) delete [] f1inc; f1inc = NULL;
   if (stage1US)
@@ -2845,7 +3135,7 @@ bool Cssrc::InitFilters(void)
   //-----create FILTER 1----------
   if (UpSampling)
   {
-    double aa = AA; // stop band attenuation(dB)
+    double aa = m_aa; // stop band attenuation(dB)
     double lpf, d, df, alp, iza;
     double guard = 2;
 
@@ -2903,7 +3193,7 @@ bool Cssrc::InitFilters(void)
   }
   else
   {
-    double aa = AA; // stop band attenuation(dB)
+    double aa = m_aa; // stop band attenuation(dB)
     double lpf, d, df, alp, iza;
     int ipsize, wsize;
 
@@ -2926,7 +3216,7 @@ bool Cssrc::InitFilters(void)
       if (n1 % 2 == 0) n1--;
       df = (fs1 * d) / (n1 - 1);
       lpf = (dfrq - df) / 2;
-      if (df < DF) break;
+      if (df < m_df) break;
     }
 
     alp = alpha(aa);
@@ -2946,6 +3236,7 @@ bool Cssrc::InitFilters(void)
     }
 
     ipsize = (int)(2 + sqrt((double)n1b));
+    m_fftIpSize = ipsize;
     fft_ip = new int [ipsize];
     fft_ip[0] = 0;
     wsize = n1b / 2;
@@ -2958,7 +3249,7 @@ bool Cssrc::InitFilters(void)
   // Make stage 2 filter
   if (UpSampling)
   {
-    double aa = AA; // stop band attenuation(dB)
+    double aa = m_aa; // stop band attenuation(dB)
     double lpf, d, df, alp, iza;
     int ipsize, wsize;
 
@@ -2972,7 +3263,7 @@ bool Cssrc::InitFilters(void)
       if (n2 % 2 == 0) n2--;
       df = (fs2 * d) / (n2 - 1);
       lpf = sfrq / 2;
-      if (df < DF) break;
+      if (df < m_df) break;
     }
 
     alp = alpha(aa);
@@ -2992,6 +3283,7 @@ bool Cssrc::InitFilters(void)
     }
 
     ipsize = (int)(2 + sqrt((double)n2b));
+    m_fftIpSize = ipsize;
     fft_ip = new int[ipsize];
     fft_ip[0] = 0;
     wsize = n2b / 2;
@@ -3016,7 +3308,7 @@ bool Cssrc::InitFilters(void)
     }
     else
     {
-      double aa = AA; // stop band attenuation(dB)
+      double aa = m_aa; // stop band attenuation(dB)
       double lpf, d, df, alp, iza;
       double guard = 2;
 
@@ -3209,9 +3501,131 @@ bool Cssrc::InitConverter(int OldFreq, int OldBPS, int Channels, int NewFreq, in
   if (!InitFilters())
     return (false);
 
+  // bitrv2() uses the ip table as work area, so every channel needs its own
+  m_results = new ChannelResult[nch];
+  m_fftIp = new int*[nch];
+  for (int i = 0; i < nch; i++)
+  {
+    m_fftIp[i] = new int[m_fftIpSize];
+    memcpy(m_fftIp[i], fft_ip, m_fftIpSize * sizeof(int));
+  }
+  StartWorkers();
+
   return (true);
 }
 
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+void Cssrc::SetQuality(Quality quality)
+{
+  m_quality = quality;
+  switch (quality)
+  {
+  case QUALITY_LOW:
+    m_aa = AA - 16;
+    m_df = DF * 2;
+    break;
+  case QUALITY_HIGH:
+    m_aa = AA + 24;
+    m_df = DF / 2;
+    break;
+  default:
+    m_aa = AA;
+    m_df = DF;
+    break;
+  }
+}
+
+bool Cssrc::SetVectorized(bool vectorized, unsigned int cpuFeatures)
+{
+  m_vector = false;
+#if defined(SSRC_SSE2)
+  m_vector = vectorized && (cpuFeatures & CPU_FEATURE_SSE2);
+#elif defined(SSRC_NEON)
+  m_vector = vectorized && (cpuFeatures & CPU_FEATURE_NEON);
+#endif
+  return m_vector == vectorized;
+}
+
+void Cssrc::SetThreads(int threads)
+{
+  m_threads = std::max(threads, 1);
+}
+
+void Cssrc::StartWorkers()
+{
+  // the calling thread filters a share of the channels too
+  m_workerCount = std::min(m_threads, nch) - 1;
+  if (m_workerCount <= 0)
+  {
+    m_workerCount = 0;
+    return;
+  }
+  m_workers = new CssrcWorker*[m_workerCount];
+  for (int i = 0; i < m_workerCount; i++)
+    m_workers[i] = new CssrcWorker(this, i + 1, m_workerCount + 1);
+}
+
+void Cssrc::StopWorkers()
+{
+  for (int i = 0; i < m_workerCount; i++)
+  {
+    m_workers[i]->Stop();
+    delete m_workers[i];
+  }
+  delete [] m_workers;
+  m_workers = NULL;
+  m_workerCount = 0;
+}
+
+void Cssrc::FilterChannels()
+{
+  for (int i = 0; i < m_workerCount; i++)
+    m_workers[i]->Start();
+  FilterChannels(0, m_workerCount + 1);
+  for (int i = 0; i < m_workerCount; i++)
+    m_workers[i]->Wait();
+}
+
+void Cssrc::FilterChannels(int first, int step)
+{
+  for (int c = first; c < nch; c += step)
+  {
+    if (UpSampling)
+      UpSampleChannel(c, m_results[c]);
+    else
+      DownSampleChannel(c, m_results[c]);
+  }
+}
+
+void Cssrc::ApplySpectrum(int n, REAL *a, const REAL *filter)
+{
+  a[0] = filter[0] * a[0];
+  a[1] = filter[1] * a[1];
+
+  int i = 2;
+#ifdef SSRC_VECTOR
+  if (m_vector)
+  {
+    for (; i + 4 <= n; i += 4)
+    {
+      VREAL f = VLoad(&filter[i]);
+      VStore(&a[i], VMulA(VLoad(&a[i]), VEvens(f), VOdds(f)));
+    }
+  }
+#endif
+  for (; i < n; i += 2)
+  {
+    REAL re, im;
+
+    re = filter[i] * a[i] - filter[i + 1] * a[i + 1];
+    im = filter[i + 1] * a[i] + filter[i] * a[i + 1];
+
+    a[i] = re;
+    a[i + 1] = im;
+  }
+}
+
 //---------------------------------------------------------------------------
 // Upsamples a buffer full of rawindata
 // returns the datalength
@@ -3265,118 +3679,118 @@ int Cssrc::UpSampleFloatIn(unsigned char * *pRetDataPtr, bool IsEof, int toberea
   return UpSampleCommon(pRetDataPtr, IsEof, toberead, toberead2, nsmplread);
 }
 
-int Cssrc::UpSampleCommon(unsigned char * *pRetDataPtr, bool IsEof, int toberead, int toberead2, int nsmplread)
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+void Cssrc::UpSampleChannel(int ch, ChannelResult &result)
 {
-  int i, j;
-  double att = 0;
-  double gain = pow(10.0, -att / 20);
+  int i, j, p;
 
-  int ToRet = 0;
+  REAL *op = &outbuf[ch];
+  int no = n1y * osf;
 
-  bool BreakOut = false;
+  int s1p = s1p_backup;
+  REAL *ip = ip_backup + ch;
 
-  inbuflen += toberead2;
-  sumread += nsmplread;
-  ending = IsEof;
+  switch (n1x)
+  {
+  case 7:
+    for (p = 0;p < nsmplwrt1;p++)
+    {
+      int s1o = f1order[s1p];
 
-  nsmplwrt1 = n2b2;
+      buf2[ch][p] = stage1US[s1o][0] * *(ip + 0 * nch) + stage1US[s1o][1] * *(ip + 1 * nch) + stage1US[s1o][2] * *(ip + 2 * nch) + stage1US[s1o][3] * *(ip + 3 * nch) + stage1US[s1o][4] * *(ip + 4 * nch) + stage1US[s1o][5] * *(ip + 5 * nch) + stage1US[s1o][6] * *(ip + 6 * nch);
+      ip += f1inc[s1p];
+      s1p++;
+      if (s1p == no)
+        s1p = 0;
+    }
+    break;
 
+  case 9:
+    for (p = 0;p < nsmplwrt1;p++)
+    {
+      int s1o = f1order[s1p];
 
-  // apply stage 1 filter
-  ip = &inbuf[((sfrq * (rp - 1) + fs1) / fs1) * nch];
-  s1p_backup = s1p;
-  ip_backup = ip;
-  osc_backup = osc;
+      buf2[ch][p] = stage1US[s1o][0] * *(ip + 0 * nch) + stage1US[s1o][1] * *(ip + 1 * nch) + stage1US[s1o][2] * *(ip + 2 * nch) + stage1US[s1o][3] * *(ip + 3 * nch) + stage1US[s1o][4] * *(ip + 4 * nch) + stage1US[s1o][5] * *(ip + 5 * nch) + stage1US[s1o][6] * *(ip + 6 * nch) + stage1US[s1o][7] * *(ip + 7 * nch) + stage1US[s1o][8] * *(ip + 8 * nch);
+      ip += f1inc[s1p];
+      s1p++;
+      if (s1p == no)
+        s1p = 0;
+    }
+    break;
 
-  for (ch = 0;ch < nch;ch++)
-  {
-    REAL *op = &outbuf[ch];
-    int no = n1y * osf;
+  default:
+    for (p = 0;p < nsmplwrt1;p++)
+    {
+      REAL tmp = 0;
+      REAL *ip2 = ip;
 
-    s1p = s1p_backup; ip = ip_backup + ch;
+      int s1o = f1order[s1p];
 
-    switch (n1x)
-    {
-    case 7:
-      for (p = 0;p < nsmplwrt1;p++)
+      for (i = 0;i < n1x;i++)
       {
-        int s1o = f1order[s1p];
-
-        buf2[ch][p] = stage1US[s1o][0] * *(ip + 0 * nch) + stage1US[s1o][1] * *(ip + 1 * nch) + stage1US[s1o][2] * *(ip + 2 * nch) + stage1US[s1o][3] * *(ip + 3 * nch) + stage1US[s1o][4] * *(ip + 4 * nch) + stage1US[s1o][5] * *(ip + 5 * nch) + stage1US[s1o][6] * *(ip + 6 * nch);
-        ip += f1inc[s1p];
-        s1p++;
-        if (s1p == no)
-          s1p = 0;
+        tmp += stage1US[s1o][i] * *ip2;
+        ip2 += nch;
       }
-      break;
+      buf2[ch][p] = tmp;
+      ip += f1inc[s1p];
+      s1p++;
+      if (s1p == no)
+        s1p = 0;
+    }
+    break;
+  }
+  int osc = osc_backup;
 
-    case 9:
-      for (p = 0;p < nsmplwrt1;p++)
-      {
-        int s1o = f1order[s1p];
+  // apply stage 2 filter
+  for (p = nsmplwrt1;p < n2b;p++)
+    buf2[ch][p] = 0;
 
-        buf2[ch][p] = stage1US[s1o][0] * *(ip + 0 * nch) + stage1US[s1o][1] * *(ip + 1 * nch) + stage1US[s1o][2] * *(ip + 2 * nch) + stage1US[s1o][3] * *(ip + 3 * nch) + stage1US[s1o][4] * *(ip + 4 * nch) + stage1US[s1o][5] * *(ip + 5 * nch) + stage1US[s1o][6] * *(ip + 6 * nch) + stage1US[s1o][7] * *(ip + 7 * nch) + stage1US[s1o][8] * *(ip + 8 * nch);
-        ip += f1inc[s1p];
-        s1p++;
-        if (s1p == no)
-          s1p = 0;
-      }
-      break;
+  rdft(n2b, 1, buf2[ch], m_fftIp[ch], fft_w);
 
-    default:
-      for (p = 0;p < nsmplwrt1;p++)
-      {
-        REAL tmp = 0;
-        REAL *ip2 = ip;
+  ApplySpectrum(n2b, buf2[ch], stage2US);
+  rdft(n2b, -1, buf2[ch], m_fftIp[ch], fft_w);
 
-        int s1o = f1order[s1p];
+  for (i = osc, j = 0;i < n2b2;i += osf, j++)
+  {
+    REAL f = (buf1[ch][j] + buf2[ch][i]);
+    op[j*nch] = f;
+  }
+  result.written = j;
+  result.osc = i - n2b2;
+  result.s1p = s1p;
+  for (j = 0;i < n2b;i += osf, j++)
+    buf1[ch][j] = buf2[ch][i];
+}
 
-        for (i = 0;i < n1x;i++)
-        {
-          tmp += stage1US[s1o][i] * *ip2;
-          ip2 += nch;
-        }
-        buf2[ch][p] = tmp;
-        ip += f1inc[s1p];
-        s1p++;
-        if (s1p == no)
-          s1p = 0;
-      }
-      break;
-    }
-    osc = osc_backup;
+int Cssrc::UpSampleCommon(unsigned char * *pRetDataPtr, bool IsEof, int toberead, int toberead2, int nsmplread)
+{
+  int i, j;
+  double att = 0;
+  double gain = pow(10.0, -att / 20);
+
+  int ToRet = 0;
 
-    // apply stage 2 filter
-    for (p = nsmplwrt1;p < n2b;p++)
-      buf2[ch][p] = 0;
+  bool BreakOut = false;
+
+  inbuflen += toberead2;
+  sumread += nsmplread;
+  ending = IsEof;
 
-    rdft(n2b, 1, buf2[ch], fft_ip, fft_w);
+  nsmplwrt1 = n2b2;
 
-    buf2[ch][0] = stage2US[0] * buf2[ch][0];
-    buf2[ch][1] = stage2US[1] * buf2[ch][1];
 
-    for (i = 1;i < n2b / 2;i++)
-    {
-      REAL re, im;
+  // apply stage 1 filter
+  ip_backup = &inbuf[((sfrq * (rp - 1) + fs1) / fs1) * nch];
+  s1p_backup = s1p;
+  osc_backup = osc;
 
-      re = stage2US[i * 2 ] * buf2[ch][i * 2] - stage2US[i * 2 + 1] * buf2[ch][i * 2 + 1];
-      im = stage2US[i * 2 + 1] * buf2[ch][i * 2] + stage2US[i * 2 ] * buf2[ch][i * 2 + 1];
+  FilterChannels();
 
-      buf2[ch][i*2 ] = re;
-      buf2[ch][i*2 + 1] = im;
-    }
-    rdft(n2b, -1, buf2[ch], fft_ip, fft_w);
+  s1p = m_results[0].s1p;
+  osc = m_results[0].osc;
+  nsmplwrt2 = m_results[0].written;
 
-    for (i = osc, j = 0;i < n2b2;i += osf, j++)
-    {
-      REAL f = (buf1[ch][j] + buf2[ch][i]);
-      op[j*nch] = f;
-    }
-    nsmplwrt2 = j;
-    osc = i - n2b2;
-    for (j = 0;i < n2b;i += osf, j++)
-      buf1[ch][j] = buf2[ch][i];
-  }
   rp += nsmplwrt1 * (sfrq / frqgcd) / osf;
 
   switch (dbps)
@@ -3618,93 +4032,94 @@ int Cssrc::DownSampleFloatIn(unsigned char * *pRetDataPtr, bool IsEof, int tober
   return DownSampleCommon(pRetDataPtr, IsEof, toberead, nsmplread);
 }
 
-int Cssrc::DownSampleCommon(unsigned char * *pRetDataPtr, bool IsEof, int toberead, int nsmplread)
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+void Cssrc::DownSampleChannel(int ch, ChannelResult &result)
 {
-  int i, j;
-  double att = 0;
-  double gain = pow(10.0, -att / 20);
-
-  int ToRet = 0;
-
-  bool BreakOut = false;
+  int i, j, k, p;
+  REAL *bp;
 
-  sumread += nsmplread;
-  ending = IsEof;
-  rps_backup = rps;
-  s2p_backup = s2p;
+  int rps = rps_backup;
+  for (k = 0;k < rps;k++)
+    buf1[ch][k] = 0;
 
-  for (ch = 0;ch < nch;ch++)
+  for (i = rps, j = 0;i < n1b2;i += osf, j++)
   {
-    rps = rps_backup;
-    for (k = 0;k < rps;k++)
+    buf1[ch][i] = inbuf[j * nch + ch];
+
+    for (k = i + 1;k < i + osf;k++)
       buf1[ch][k] = 0;
+  }
 
-    for (i = rps, j = 0;i < n1b2;i += osf, j++)
-    {
-      buf1[ch][i] = inbuf[j * nch + ch];
+  for (k = n1b2;k < n1b;k++)
+    buf1[ch][k] = 0;
 
-      for (k = i + 1;k < i + osf;k++)
-        buf1[ch][k] = 0;
-    }
+  result.rps = i - n1b2;
+  result.read = j;
 
-    for (k = n1b2;k < n1b;k++)
-      buf1[ch][k] = 0;
+  rdft(n1b, 1, buf1[ch], m_fftIp[ch], fft_w);
 
-    rps = i - n1b2;
-    rp += j;
+  ApplySpectrum(n1b, buf1[ch], stage1DS);
 
-    rdft(n1b, 1, buf1[ch], fft_ip, fft_w);
+  rdft(n1b, -1, buf1[ch], m_fftIp[ch], fft_w);
 
-    buf1[ch][0] = stage1DS[0] * buf1[ch][0];
-    buf1[ch][1] = stage1DS[1] * buf1[ch][1];
+  for (i = 0;i < n1b2;i++)
+    buf2[ch][n2x + 1 + i] += buf1[ch][i];
 
-    for (i = 1;i < n1b2;i++)
-    {
-      REAL re, im;
+  {
+    int t1 = rp2 / (fs2 / fs1);
+    if (rp2 % (fs2 / fs1) != 0)
+      t1++;
+    bp = &(buf2[ch][t1]);
+  }
 
-      re = stage1DS[i * 2 ] * buf1[ch][i * 2] - stage1DS[i * 2 + 1] * buf1[ch][i * 2 + 1];
-      im = stage1DS[i * 2 + 1] * buf1[ch][i * 2] + stage1DS[i * 2 ] * buf1[ch][i * 2 + 1];
+  int s2p = s2p_backup;
 
-      buf1[ch][i*2 ] = re;
-      buf1[ch][i*2 + 1] = im;
-    }
+  for (p = 0;bp - buf2[ch] < n1b2 + 1;p++)
+  {
+    REAL tmp = 0;
+    REAL *bp2;
+    int s2o;
 
-    rdft(n1b, -1, buf1[ch], fft_ip, fft_w);
+    bp2 = bp;
+    s2o = f2order[s2p];
+    bp += f2inc[s2p];
+    s2p++;
 
-    for (i = 0;i < n1b2;i++)
-      buf2[ch][n2x + 1 + i] += buf1[ch][i];
+    if (s2p == n2y)
+      s2p = 0;
 
-    {
-      int t1 = rp2 / (fs2 / fs1);
-      if (rp2 % (fs2 / fs1) != 0)
-        t1++;
-      bp = &(buf2[ch][t1]);
-    }
+    for (i = 0;i < n2x;i++)
+      tmp += stage2DS[s2o][i] * *bp2++;
 
-    s2p = s2p_backup;
+    op[p*nch + ch] = tmp;
+  }
 
-    for (p = 0;bp - buf2[ch] < n1b2 + 1;p++)
-    {
-      REAL tmp = 0;
-      REAL *bp2;
-      int s2o;
+  result.written = p;
+  result.s2p = s2p;
+}
 
-      bp2 = bp;
-      s2o = f2order[s2p];
-      bp += f2inc[s2p];
-      s2p++;
+int Cssrc::DownSampleCommon(unsigned char * *pRetDataPtr, bool IsEof, int toberead, int nsmplread)
+{
+  int i, j;
+  double att = 0;
+  double gain = pow(10.0, -att / 20);
 
-      if (s2p == n2y)
-        s2p = 0;
+  int ToRet = 0;
 
-      for (i = 0;i < n2x;i++)
-        tmp += stage2DS[s2o][i] * *bp2++;
+  bool BreakOut = false;
 
-      op[p*nch + ch] = tmp;
-    }
+  sumread += nsmplread;
+  ending = IsEof;
+  rps_backup = rps;
+  s2p_backup = s2p;
 
-    nsmplwrt2 = p;
-  }
+  FilterChannels();
+
+  rps = m_results[0].rps;
+  s2p = m_results[0].s2p;
+  rp += m_results[0].read * nch;
+  nsmplwrt2 = m_results[0].written;
 
   rp2 += nsmplwrt2 * (fs2 / dfrq);
 
@@ -52,6 +52,8 @@ typedef double REAL;
 #endif
 
 
+class CssrcWorker;
+
 const int scoeffreq[] = {0, 48000, 44100, 37800, 32000, 22050, 48000, 44100};
 const int scoeflen[] = {1, 16, 20, 16, 16, 15, 16, 15};
 const int samp[] = {8, 18, 27, 8, 8, 8, 10, 9};
@@ -107,9 +109,33 @@ const double shapercoefs[8][21] =
 class Cssrc
 {
 public:
+  enum Quality
+  {
+    QUALITY_LOW = 0, // shorter filters, less stop band attenuation
+    QUALITY_MEDIUM,  // the original SSRC filters
+    QUALITY_HIGH     // longer filters, more stop band attenuation
+  };
+
   Cssrc(void);
   ~Cssrc();
 
+  //---------------------------------------------------------------------------
+  // Sets the quality of the filters, used from the next InitConverter()
+  //---------------------------------------------------------------------------
+  void SetQuality(Quality quality);
+
+  //---------------------------------------------------------------------------
+  // Runs the FFT butterflies and filtering on SSE2/NEON
+  // returns false if they aren't compiled in or the cpu lacks them
+  //---------------------------------------------------------------------------
+  bool SetVectorized(bool vectorized, unsigned int cpuFeatures);
+
+  //---------------------------------------------------------------------------
+  // Sets the number of threads the channels are filtered on, used from the
+  // next InitConverter(). More threads than channels are never started.
+  //---------------------------------------------------------------------------
+  void SetThreads(int threads);
+
   //---------------------------------------------------------------------------
   // Inits Freq Converter, returns false if cannot do
   //---------------------------------------------------------------------------
@@ -168,6 +194,25 @@ public:
   // char *ConvertSomeData(char *InData, int &DataSize, bool IsEOF);
 
 private:
+  friend class CssrcWorker;
+
+  // what filtering a channel leaves behind, the same for every channel
+  struct ChannelResult
+  {
+    int s1p, osc, rps, s2p, read, written;
+  };
+
+  Quality m_quality;
+  double m_aa;   // stop band attenuation (dB)
+  double m_df;   // widest transition band allowed for the FFT filters
+  bool m_vector;
+  int m_threads;
+  CssrcWorker **m_workers;
+  int m_workerCount;
+  ChannelResult *m_results;
+  int **m_fftIp;   // a copy of fft_ip per channel
+  int m_fftIpSize;
+
   // clsDataStream DataStream;
 
   int m_iMaxInputSize;    // Total amount of data we take in at once
@@ -208,18 +253,16 @@ private:
   int init, ending;
   unsigned int sumread, sumwrite;
   int osc;
-  REAL *ip, *ip_backup;
+  REAL *ip_backup;
   int s1p_backup, osc_backup;
-  int ch, p;
+  int ch;
   int inbuflen;
 
   int n1b2;
   int rps;
   int rp2;
   int s2p;
-  REAL *bp;
   int rps_backup, s2p_backup;
-  int k;
   REAL *op;
 
 
@@ -246,6 +289,31 @@ private:
   //---------------------------------------------------------------------------
   int UpSampleCommon(unsigned char * *pRetDataPtr, bool IsEof, int toberead, int toberead2, int nsmplread);
 
+  //---------------------------------------------------------------------------
+  // Filters every channel, spread over the worker threads
+  //---------------------------------------------------------------------------
+  void FilterChannels();
+
+  //---------------------------------------------------------------------------
+  // Filters the channels first, first + step, ... on the calling thread
+  //---------------------------------------------------------------------------
+  void FilterChannels(int first, int step);
+
+  //---------------------------------------------------------------------------
+  // Filters a single channel of the upsampler/downsampler. Only touches the
+  // buffers of that channel, so channels can be filtered concurrently
+  //---------------------------------------------------------------------------
+  void UpSampleChannel(int ch, ChannelResult &result);
+  void DownSampleChannel(int ch, ChannelResult &result);
+
+  //---------------------------------------------------------------------------
+  // Multiplies the spectrum in a by the filter spectrum, both as given by rdft()
+  //---------------------------------------------------------------------------
+  void ApplySpectrum(int n, REAL *a, const REAL *filter);
+
+  void StartWorkers();
+  void StopWorkers();
+
   //---------------------------------------------------------------------------
   // Downsamples a buffer full of rawindata
   // returns the datalength
@@ -0,0 +1,445 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "utils/CharsetConverter.h"
+#include "threads/Thread.h"
+#include "threads/SingleLock.h"
+#include "utils/test/TestUtils.h"
+
+#include <errno.h>
+#include <iconv.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#if defined(TARGET_WINDOWS)
+#define WCHAR_CHARSET "UTF-16LE"
+#else
+#define WCHAR_CHARSET "WCHAR_T"
+#endif
+
+#define BENCHMARK_TAGS     20000
+#define BENCHMARK_THREADS  4
+#define BENCHMARK_LABELS   400
+#define BENCHMARK_FRAMES   100
+
+//=============================================================================
+// Helper functions
+//=============================================================================
+
+// the conversion as CCharsetConverter did it before, through iconv under a global lock
+static CCriticalSection s_referenceSection;
+static map<string, iconv_t> s_referenceHandles;
+
+template<class INPUT, class OUTPUT>
+static void ReferenceConvert(const char *from, const char *to, const INPUT &source, OUTPUT &dest)
+{
+  CSingleLock lock(s_referenceSection);
+  iconv_t &handle = s_referenceHandles[string(from) + ">" + to];
+  if (handle == (iconv_t)0)
+    handle = iconv_open(to, from);
+  dest.clear();
+  if (handle == (iconv_t)-1)
+    return;
+
+  size_t inBytes = (source.length() + 1) * sizeof(source[0]);
+  const char *in = (const char *)source.c_str();
+  vector<char> output((source.length() + 1) * 8);
+  size_t outBytes = output.size();
+  char *out = &output[0];
+  while (inBytes > 0)
+  {
+    if (iconv_const(handle, &in, &inBytes, &out, &outBytes) == (size_t)-1)
+    {
+      if (errno != EILSEQ)
+        break;
+      // skip the invalid byte, as the converter does
+      in++;
+      inBytes--;
+    }
+  }
+  iconv(handle, NULL, NULL, &out, &outBytes);
+
+  // the output ends at the terminating NUL
+  const typename OUTPUT::value_type *result = (const typename OUTPUT::value_type *)&output[0];
+  size_t length = 0;
+  while (result[length])
+    length++;
+  dest.assign(result, length);
+}
+
+static CTestRandom Random;
+
+// UTF-8 text from a mix of scripts, with the odd broken sequence if asked for
+static CStdStringA RandomUtf8(unsigned int length, bool invalid, bool ascii = false)
+{
+  static const unsigned long ranges[][2] = { { 0x20, 0x7e }, { 0xa0, 0xff }, { 0x391, 0x3c9 },
+                                             { 0x5d0, 0x5ea }, { 0x4e00, 0x4f00 }, { 0x1f600, 0x1f64f } };
+  CStdStringA text;
+  for (unsigned int i = 0; i < length; i++)
+  {
+    if (invalid && Random(20) == 0)
+    {
+      static const char *broken[] = { "\xc3", "\xe2\x82", "\xc0\xaf", "\xed\xa0\x80", "\xff", "\xf8\x88\x80\x80\x80" };
+      text += broken[Random(sizeof(broken) / sizeof(broken[0]))];
+      continue;
+    }
+    // mostly ASCII, like most tags and labels
+    unsigned int range = ascii || Random(3) ? 0 : Random(sizeof(ranges) / sizeof(ranges[0]));
+    unsigned long code = ranges[range][0] + Random(ranges[range][1] - ranges[range][0] + 1);
+    CStdStringW wide;
+    wide += (wchar_t)code;
+    CStdStringA utf8;
+    ReferenceConvert(WCHAR_CHARSET, "UTF-8", wide, utf8);
+    text += utf8;
+  }
+  return text;
+}
+
+static CStdString16 ToUtf16(const CStdStringA &utf8, bool bigEndian)
+{
+  CStdString16 utf16;
+  ReferenceConvert("UTF-8", bigEndian ? "UTF-16BE" : "UTF-16LE", utf8, utf16);
+  return utf16;
+}
+
+// the validation CCharsetConverter::isValidUtf8 did before (RFC2640)
+static bool ReferenceIsValidUtf8(const char *buf, unsigned int len)
+{
+  const unsigned char *endbuf = (unsigned char*)buf + len;
+  unsigned char byte2mask = 0x00, c;
+  int trailing = 0;
+  while ((unsigned char*)buf != endbuf)
+  {
+    c = *buf++;
+    if (trailing)
+    {
+      if ((c & 0xc0) != 0x80)
+        return false;
+      if (byte2mask)
+      {
+        if (!(c & byte2mask))
+          return false;
+        byte2mask = 0x00;
+      }
+      trailing--;
+    }
+    else if ((c & 0x80) == 0x00)
+      continue;
+    else if ((c & 0xe0) == 0xc0)
+    {
+      if (!(c & 0x1e))
+        return false;
+      trailing = 1;
+    }
+    else if ((c & 0xf0) == 0xe0)
+    {
+      if (!(c & 0x0f))
+        byte2mask = 0x20;
+      trailing = 2;
+    }
+    else if ((c & 0xf8) == 0xf0)
+    {
+      if (!(c & 0x07))
+        byte2mask = 0x30;
+      trailing = 3;
+    }
+    else if ((c & 0xfc) == 0xf8)
+    {
+      if (!(c & 0x03))
+        byte2mask = 0x38;
+      trailing = 4;
+    }
+    else if ((c & 0xfe) == 0xfc)
+    {
+      if (!(c & 0x01))
+        byte2mask = 0x3c;
+      trailing = 5;
+    }
+    else
+      return false;
+  }
+  return trailing == 0;
+}
+
+namespace
+{
+// the strings a music scan converts for each song
+struct STag
+{
+  CStdStringA utf8;   // ID3v2.4 / vorbis comments
+  CStdStringA latin1; // ID3v1 and ID3v2 frames with encoding 0
+  CStdString16 utf16; // ID3v2.3 frames with encoding 1
+};
+}
+
+static vector<STag> MakeTags(unsigned int count)
+{
+  vector<STag> tags(count);
+  for (unsigned int i = 0; i < count; i++)
+  {
+    tags[i].utf8 = RandomUtf8(5 + Random(30), false, Random(2) != 0);
+    tags[i].latin1 = RandomUtf8(5 + Random(30), false);
+    for (unsigned int j = 0; j < tags[i].latin1.size(); j++)
+    {
+      if ((unsigned char)tags[i].latin1[j] >= 0x80)
+        tags[i].latin1[j] = (char)(0xa0 + Random(0x60));
+    }
+    tags[i].utf16 = ToUtf16(RandomUtf8(5 + Random(30), false), false);
+  }
+  return tags;
+}
+
+namespace
+{
+class CTagScanner : public CThread
+{
+public:
+  // scans the tags the given number of times, or until stopped for 0
+  CTagScanner(const vector<STag> &tags, bool reference, unsigned int passes = 0)
+    : CThread("TagScanner"), m_tags(tags), m_reference(reference), m_passes(passes) { }
+
+  virtual void Process()
+  {
+    for (unsigned int pass = 0; (m_passes == 0 || pass < m_passes) && !m_bStop; pass++)
+    {
+      for (unsigned int i = 0; i < m_tags.size() && !m_bStop; i++)
+        Scan(m_tags[i]);
+    }
+  }
+
+  void Scan(const STag &tag)
+  {
+    CStdStringA utf8;
+    if (m_reference)
+    {
+      if (!ReferenceIsValidUtf8(tag.utf8.c_str(), tag.utf8.size()))
+        ReferenceConvert("CP1252", "UTF-8", tag.utf8, utf8);
+      ReferenceConvert("ISO-8859-1", "UTF-8", tag.latin1, utf8);
+      ReferenceConvert("UTF-16LE", "UTF-8", tag.utf16, utf8);
+    }
+    else
+    {
+      g_charsetConverter.unknownToUTF8(tag.utf8, utf8);
+      g_charsetConverter.stringCharsetToUtf8("ISO-8859-1", tag.latin1, utf8);
+      g_charsetConverter.utf16LEtoUTF8(tag.utf16, utf8);
+    }
+  }
+
+private:
+  const vector<STag> &m_tags;
+  bool m_reference;
+  unsigned int m_passes;
+};
+}
+
+//=============================================================================
+// Tests
+//=============================================================================
+
+BOOST_AUTO_TEST_CASE(TestCharsetConverterUtf8)
+{
+  Random.Seed(1);
+  for (unsigned int i = 0; i < 2000; i++)
+  {
+    CStdStringA utf8 = RandomUtf8(Random(40), i % 4 == 0);
+    if (i % 50 == 0)
+      utf8 += CStdStringA("\0tail", 5);
+
+    CStdStringW wide, expectedWide;
+    g_charsetConverter.utf8ToW(utf8, wide, false);
+    ReferenceConvert("UTF-8", WCHAR_CHARSET, utf8, expectedWide);
+    BOOST_CHECK(wide == expectedWide);
+
+    CStdStringA back, expectedBack;
+    g_charsetConverter.wToUTF8(expectedWide, back);
+    ReferenceConvert(WCHAR_CHARSET, "UTF-8", expectedWide, expectedBack);
+    BOOST_CHECK(back == expectedBack);
+
+    BOOST_CHECK_EQUAL(ReferenceIsValidUtf8(utf8.c_str(), utf8.size()), g_charsetConverter.isValidUtf8(utf8.c_str(), utf8.size()));
+  }
+
+  // sequences the fast path leaves to iconv
+  const char *invalid[] = { "abc\xc3", "\xed\xa0\x80x", "\xf4\x90\x80\x80", "\xe0\x80\x80", "a\xc1\xbf" };
+  for (unsigned int i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+  {
+    CStdStringW wide, expectedWide;
+    g_charsetConverter.utf8ToW(invalid[i], wide, false);
+    ReferenceConvert("UTF-8", WCHAR_CHARSET, CStdStringA(invalid[i]), expectedWide);
+    BOOST_CHECK(wide == expectedWide);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(TestCharsetConverterUtf16)
+{
+  Random.Seed(2);
+  for (unsigned int i = 0; i < 1000; i++)
+  {
+    CStdStringA utf8 = RandomUtf8(Random(40), false);
+    CStdString16 le = ToUtf16(utf8, false);
+    CStdString16 be = ToUtf16(utf8, true);
+    if (i % 10 == 0)
+      le += 0xdc00; // unpaired surrogate
+
+    CStdStringA output, expected;
+    g_charsetConverter.utf16LEtoUTF8(le, output);
+    ReferenceConvert("UTF-16LE", "UTF-8", le, expected);
+    BOOST_CHECK(output == expected);
+
+    g_charsetConverter.utf16BEtoUTF8(be, output);
+    ReferenceConvert("UTF-16BE", "UTF-8", be, expected);
+    BOOST_CHECK(output == expected);
+
+    g_charsetConverter.ucs2ToUTF8(le, output);
+    ReferenceConvert("UCS-2LE", "UTF-8", le, expected);
+    BOOST_CHECK(output == expected);
+
+    CStdStringW wide, expectedWide;
+    g_charsetConverter.utf16LEtoW(le, wide);
+    ReferenceConvert("UTF-16LE", WCHAR_CHARSET, le, expectedWide);
+    BOOST_CHECK(wide == expectedWide);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(TestCharsetConverterLatin1)
+{
+  CStdStringA latin1;
+  for (unsigned int c = 1; c < 256; c++)
+    latin1 += (char)c;
+
+  CStdStringA output, expected;
+  g_charsetConverter.stringCharsetToUtf8("ISO-8859-1", latin1, output);
+  ReferenceConvert("ISO-8859-1", "UTF-8", latin1, expected);
+  BOOST_CHECK(output == expected);
+
+  // ASCII stays as it is in the charsets that extend it
+  g_charsetConverter.stringCharsetToUtf8("CP1252", "plain", output);
+  BOOST_CHECK(output == "plain");
+  g_charsetConverter.utf8To("ISO-8859-15", "plain", output);
+  BOOST_CHECK(output == "plain");
+}
+
+BOOST_AUTO_TEST_CASE(TestCharsetConverterThreads)
+{
+  Random.Seed(3);
+  vector<STag> tags = MakeTags(500);
+  vector<CTagScanner *> scanners;
+  for (unsigned int i = 0; i < BENCHMARK_THREADS; i++)
+  {
+    scanners.push_back(new CTagScanner(tags, false));
+    scanners.back()->Create();
+  }
+
+  // the converter keeps its results while the other threads convert
+  for (unsigned int i = 0; i < tags.size(); i++)
+  {
+    CStdStringA output, expected;
+    g_charsetConverter.utf16LEtoUTF8(tags[i].utf16, output);
+    ReferenceConvert("UTF-16LE", "UTF-8", tags[i].utf16, expected);
+    BOOST_CHECK(output == expected);
+
+    g_charsetConverter.stringCharsetToUtf8("CP1251", tags[i].latin1, output);
+    ReferenceConvert("CP1251", "UTF-8", tags[i].latin1, expected);
+    BOOST_CHECK(output == expected);
+  }
+
+  for (unsigned int i = 0; i < scanners.size(); i++)
+  {
+    scanners[i]->StopThread();
+    delete scanners[i];
+  }
+}
+
+BOOST_AUTO_TEST_CASE(BenchmarkCharsetConverter)
+{
+  Random.Seed(4);
+  vector<STag> tags = MakeTags(BENCHMARK_TAGS / BENCHMARK_THREADS);
+  vector<CStdStringA> labels;
+  for (unsigned int i = 0; i < BENCHMARK_LABELS; i++)
+    labels.push_back(RandomUtf8(10 + Random(50), false, Random(4) != 0));
+
+  printf("                                    reference (ms)  converter (ms)\n");
+  for (int threads = 1; threads <= BENCHMARK_THREADS; threads *= BENCHMARK_THREADS)
+  {
+    // every thread reads the same number of songs
+    double times[2];
+    for (int reference = 1; reference >= 0; reference--)
+    {
+      vector<CTagScanner *> scanners;
+      for (int i = 0; i < threads; i++)
+        scanners.push_back(new CTagScanner(tags, reference != 0, 1));
+
+      boost::posix_time::ptime start = BenchmarkStart();
+      for (int i = 0; i < threads; i++)
+        scanners[i]->Create();
+      for (int i = 0; i < threads; i++)
+      {
+        scanners[i]->WaitForThreadExit(60000);
+        scanners[i]->StopThread();
+      }
+      times[reference] = ElapsedMilliseconds(start);
+      for (int i = 0; i < threads; i++)
+        delete scanners[i];
+    }
+    printf("tag scan, %5u songs, %d thread(s) %14.1f %15.1f\n", (unsigned int)tags.size() * threads, threads, times[1], times[0]);
+  }
+
+  // the render thread lays out every label of a window each frame, while
+  // the library scan converts tags in the background
+  double times[2];
+  for (int reference = 1; reference >= 0; reference--)
+  {
+    vector<CTagScanner *> scanners;
+    for (int i = 0; i < BENCHMARK_THREADS - 1; i++)
+    {
+      scanners.push_back(new CTagScanner(tags, reference != 0));
+      scanners.back()->Create();
+    }
+
+    boost::posix_time::ptime start = BenchmarkStart();
+    for (unsigned int frame = 0; frame < BENCHMARK_FRAMES; frame++)
+    {
+      for (unsigned int i = 0; i < labels.size(); i++)
+      {
+        CStdStringW wide;
+        if (reference)
+          ReferenceConvert("UTF-8", WCHAR_CHARSET, labels[i], wide);
+        else
+          g_charsetConverter.utf8ToW(labels[i], wide, false);
+      }
+    }
+    times[reference] = ElapsedMilliseconds(start);
+
+    for (unsigned int i = 0; i < scanners.size(); i++)
+    {
+      scanners[i]->StopThread();
+      delete scanners[i];
+    }
+  }
+  printf("render %u labels x %u frames  %14.1f %15.1f\n", BENCHMARK_LABELS, BENCHMARK_FRAMES, times[1], times[0]);
+}
@@ -0,0 +1,376 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "utils/PCMRemapDSP.h"
+#include "utils/MathUtils.h"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <algorithm>
+#include <vector>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+using namespace std;
+
+#define BENCHMARK_FRAMES  (48000 * 60)
+#define BENCHMARK_PERIOD  1024
+
+//=============================================================================
+// Helper functions
+//=============================================================================
+
+struct Mix
+{
+  unsigned int out;
+  unsigned int in;
+  float        level;
+};
+
+struct Layout
+{
+  const char  *name;
+  unsigned int inChannels;
+  unsigned int outChannels;
+  const Mix   *mix;
+  unsigned int mixCount;
+  const bool  *copy;
+};
+
+// the mixing CPCMRemap did before CPCMRemapDSP, copied from ProcessInput, AddGain,
+// ProcessLimiter and ProcessOutput with the map reduced to per channel lists
+class CReferenceRemap
+{
+public:
+  CReferenceRemap(const Layout &layout) : m_layout(layout) {}
+
+  void Remap(const int16_t *data, int16_t *out, unsigned int samples, float gain, PCMRemapLimiter *limiter)
+  {
+    unsigned int outChannels = m_layout.outChannels;
+    m_buf.assign(samples * outChannels, 0.0f);
+    memset(out, 0, samples * outChannels * sizeof(int16_t));
+
+    // ProcessInput
+    for (unsigned int ch = 0; ch < outChannels; ch++)
+    {
+      vector<const Mix*> info = GetMix(ch);
+      if (info.empty())
+        continue;
+
+      if (m_layout.copy[ch] && gain == 1.0f)
+      {
+        for (unsigned int i = 0; i < samples; i++)
+          out[i * outChannels + ch] = data[i * m_layout.inChannels + info[0]->in];
+      }
+      else
+      {
+        for (unsigned int j = 0; j < info.size(); j++)
+          for (unsigned int i = 0; i < samples; i++)
+            m_buf[i * outChannels + ch] += (float)data[i * m_layout.inChannels + info[j]->in] * info[j]->level;
+      }
+    }
+
+    // AddGain
+    if (gain != 1.0f)
+      for (unsigned int i = 0; i < samples * outChannels; i++)
+        m_buf[i] *= gain;
+
+    // ProcessLimiter
+    if (limiter)
+    {
+      PCMRemapLimiter &l = *limiter;
+      for (unsigned int i = 0; i < samples; i++)
+      {
+        float maxAbs = 0.0f;
+        for (unsigned int outch = 0; outch < outChannels; outch++)
+        {
+          float absval = fabs(m_buf[i * outChannels + outch]) / 32768.0f;
+          if (maxAbs < absval)
+            maxAbs = absval;
+        }
+
+        float attenuatedAbs = maxAbs * l.attenuation;
+        if (attenuatedAbs > 1.0f)
+        {
+          l.attenuation = 1.0f / maxAbs;
+          if (l.attenuation < l.attenuationMin)
+            l.attenuationMin = l.attenuation;
+          l.attenuationInc = 1.0f - l.attenuation;
+          l.holdCounter = l.hold;
+        }
+        else if (l.attenuation < 1.0f && attenuatedAbs > 0.95f)
+        {
+          l.attenuationInc = 1.0f - l.attenuation;
+          l.holdCounter = l.hold;
+        }
+
+        for (unsigned int outch = 0; outch < outChannels; outch++)
+          m_buf[i * outChannels + outch] *= l.attenuation;
+
+        if (l.holdCounter)
+          l.holdCounter--;
+        else if (l.attenuationInc > 0.0f)
+        {
+          l.attenuation += l.attenuationInc / l.sampleRate / l.release;
+          if (l.attenuation > 1.0f)
+          {
+            l.attenuation = 1.0f;
+            l.attenuationInc = 0.0f;
+          }
+        }
+      }
+    }
+
+    // ProcessOutput
+    for (unsigned int ch = 0; ch < outChannels; ch++)
+    {
+      if (GetMix(ch).empty())
+        continue;
+
+      if (!m_layout.copy[ch] || gain != 1.0f)
+        for (unsigned int i = 0; i < samples; i++)
+          out[i * outChannels + ch] = MathUtils::round_int(std::min(std::max(m_buf[i * outChannels + ch], -32768.0f), 32767.0f));
+    }
+  }
+
+private:
+  vector<const Mix*> GetMix(unsigned int ch) const
+  {
+    vector<const Mix*> info;
+    for (unsigned int i = 0; i < m_layout.mixCount; i++)
+      if (m_layout.mix[i].out == ch)
+        info.push_back(&m_layout.mix[i]);
+    return info;
+  }
+
+  const Layout &m_layout;
+  vector<float> m_buf;
+};
+
+// levels as BuildMap() comes up with them, normalized and not
+static const Mix s_stereo[] = { {0, 0, 1.0f}, {1, 1, 1.0f} };
+static const bool s_stereoCopy[] = { true, true };
+
+static const Mix s_mono[] = { {0, 0, 0.70710677f}, {1, 0, 0.70710677f} };
+static const bool s_monoCopy[] = { false, false };
+
+// FL FR FC BL BR LFE -> FL FR, normalized
+static const Mix s_51to20[] = { {0, 0, 0.33333334f}, {0, 2, 0.23570226f}, {0, 3, 0.33333334f}, {0, 5, 0.09763107f},
+                                {1, 1, 0.33333334f}, {1, 2, 0.23570226f}, {1, 4, 0.33333334f}, {1, 5, 0.09763107f} };
+static const bool s_51to20Copy[] = { false, false };
+
+// FL FR FC BL BR LFE -> FL FR, not normalized, so the limiter kicks in
+static const Mix s_51to20Loud[] = { {0, 0, 1.0f}, {0, 2, 0.70710677f}, {0, 3, 1.0f}, {0, 5, 0.70710677f},
+                                    {1, 1, 1.0f}, {1, 2, 0.70710677f}, {1, 4, 1.0f}, {1, 5, 0.70710677f} };
+
+// FL FR FC SL SR BL BR LFE -> FL FR FC BL BR LFE, normalized
+static const Mix s_71to51[] = { {0, 0, 1.0f}, {1, 1, 1.0f}, {2, 2, 1.0f},
+                                {3, 3, 0.5f}, {3, 5, 0.5f}, {4, 4, 0.5f}, {4, 6, 0.5f}, {5, 7, 1.0f} };
+static const bool s_71to51Copy[] = { true, true, true, false, false, true };
+
+// FL FR FC BL BR LFE -> FL FR FC SL SR BL BR LFE, side channels left empty
+static const Mix s_51to71[] = { {0, 0, 1.0f}, {1, 1, 1.0f}, {2, 2, 1.0f}, {5, 3, 1.0f}, {6, 4, 1.0f}, {7, 5, 1.0f} };
+static const bool s_51to71Copy[] = { true, true, true, false, false, true, true, true };
+
+// FL FR FC -> FL FR, nearly a copy, but not quite
+static const Mix s_30to20[] = { {0, 0, 0.995f}, {0, 2, 0.70710677f}, {1, 1, 0.995f}, {1, 2, 0.70710677f} };
+static const bool s_30to20Copy[] = { false, false };
+
+#define MIXES(mix) mix, sizeof(mix) / sizeof(mix[0])
+
+static const Layout s_layouts[] =
+{
+  { "2.0 -> 2.0", 2, 2, MIXES(s_stereo),     s_stereoCopy },
+  { "1.0 -> 2.0", 1, 2, MIXES(s_mono),       s_monoCopy   },
+  { "5.1 -> 2.0", 6, 2, MIXES(s_51to20),     s_51to20Copy },
+  { "5.1 -> 2.0 (loud)", 6, 2, MIXES(s_51to20Loud), s_51to20Copy },
+  { "7.1 -> 5.1", 8, 6, MIXES(s_71to51),     s_71to51Copy },
+  { "5.1 -> 7.1", 6, 8, MIXES(s_51to71),     s_51to71Copy },
+  { "3.0 -> 2.0", 3, 2, MIXES(s_30to20),     s_30to20Copy },
+};
+
+static void SetLayout(CPCMRemapDSP &dsp, const Layout &layout)
+{
+  dsp.SetChannels(layout.inChannels, layout.outChannels);
+  for (unsigned int i = 0; i < layout.mixCount; i++)
+    dsp.AddMix(layout.mix[i].out, layout.mix[i].in, layout.mix[i].level);
+  for (unsigned int ch = 0; ch < layout.outChannels; ch++)
+    if (layout.copy[ch])
+      dsp.SetCopy(ch);
+}
+
+static void InitLimiter(PCMRemapLimiter &limiter)
+{
+  limiter.attenuation    = 1.0f;
+  limiter.attenuationInc = 0.0f;
+  limiter.attenuationMin = 1.0f;
+  limiter.holdCounter    = 0;
+  limiter.sampleRate     = 48000.0f;
+  limiter.hold           = MathUtils::round_int(48000.0f * 0.025f);
+  limiter.release        = 0.1f;
+}
+
+// noise, with loud bursts and full scale samples thrown in
+static void FillInput(vector<int16_t> &input, unsigned int seed)
+{
+  for (unsigned int i = 0; i < input.size(); i++)
+  {
+    seed = seed * 1103515245 + 12345;
+    int16_t sample = (int16_t)(seed >> 16);
+    if ((i / 4096) % 3 == 0)
+      sample /= 64;
+    if (seed % 997 == 0)
+      sample = (seed & 0x100) ? 32767 : -32768;
+    input[i] = sample;
+  }
+}
+
+static vector<CPCMRemapDSP::Engine> GetEngines()
+{
+  vector<CPCMRemapDSP::Engine> engines;
+  CPCMRemapDSP dsp;
+  for (int engine = CPCMRemapDSP::ENGINE_C; engine <= CPCMRemapDSP::ENGINE_NEON; engine++)
+    if (dsp.SetEngine((CPCMRemapDSP::Engine)engine))
+      engines.push_back((CPCMRemapDSP::Engine)engine);
+  return engines;
+}
+
+//=============================================================================
+// Tests
+//=============================================================================
+
+BOOST_AUTO_TEST_CASE(TestPCMRemapDSPBitExact)
+{
+  // odd periods to get partial vectors, and periods over a block
+  const unsigned int periods[] = { 1, 3, 4, 257, 1000, 4099 };
+  const float gains[] = { 1.0f, 0.5f, 1.7f };
+  vector<CPCMRemapDSP::Engine> engines = GetEngines();
+
+  for (unsigned int l = 0; l < sizeof(s_layouts) / sizeof(s_layouts[0]); l++)
+  {
+    const Layout &layout = s_layouts[l];
+    for (unsigned int g = 0; g < sizeof(gains) / sizeof(gains[0]); g++)
+    {
+      for (unsigned int e = 0; e < engines.size(); e++)
+      {
+        BOOST_TEST_MESSAGE(layout.name << " gain " << gains[g] << " " << CPCMRemapDSP::GetEngineName(engines[e]));
+
+        CReferenceRemap reference(layout);
+        CPCMRemapDSP dsp;
+        BOOST_REQUIRE(dsp.SetEngine(engines[e]));
+        SetLayout(dsp, layout);
+
+        PCMRemapLimiter referenceLimiter, limiter;
+        InitLimiter(referenceLimiter);
+        InitLimiter(limiter);
+
+        for (unsigned int p = 0; p < sizeof(periods) / sizeof(periods[0]); p++)
+        {
+          unsigned int frames = periods[p];
+          vector<int16_t> input(frames * layout.inChannels);
+          FillInput(input, l * 1000 + p);
+
+          // poison the output, everything has to be written
+          vector<int16_t> expected(frames * layout.outChannels, 0x5555);
+          vector<int16_t> output(frames * layout.outChannels, 0x5555);
+          bool limit = gains[g] != 0.5f || &layout.mix[0] == s_51to20Loud;
+          reference.Remap(&input[0], &expected[0], frames, gains[g], limit ? &referenceLimiter : NULL);
+          dsp.Process(&input[0], &output[0], frames, gains[g], limit ? &limiter : NULL);
+
+          BOOST_CHECK(expected == output);
+          BOOST_CHECK_EQUAL(referenceLimiter.attenuation,    limiter.attenuation);
+          BOOST_CHECK_EQUAL(referenceLimiter.attenuationInc, limiter.attenuationInc);
+          BOOST_CHECK_EQUAL(referenceLimiter.attenuationMin, limiter.attenuationMin);
+          BOOST_CHECK_EQUAL(referenceLimiter.holdCounter,    limiter.holdCounter);
+        }
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(TestPCMRemapDSPRounding)
+{
+  // halfway cases round up, as MathUtils::round_int does
+  static const Mix half[] = { {0, 0, 0.5f}, {1, 1, 0.5f} };
+  static const bool noCopy[] = { false, false };
+  Layout layout = { "half", 2, 2, MIXES(half), noCopy };
+
+  int16_t input[16]  = { 1, -1, 3, -3, 5, -5, 32767, -32768, 0, 2, -2, 7, -7, 9, 1, 1 };
+  int16_t result[16] = { 1,  0, 2, -1, 3, -2, 16384, -16384, 0, 1, -1, 4, -3, 5, 1, 1 };
+
+  vector<CPCMRemapDSP::Engine> engines = GetEngines();
+  for (unsigned int e = 0; e < engines.size(); e++)
+  {
+    CPCMRemapDSP dsp;
+    dsp.SetEngine(engines[e]);
+    SetLayout(dsp, layout);
+
+    int16_t output[16];
+    dsp.Process(input, output, 8, 1.0f, NULL);
+    BOOST_CHECK(memcmp(output, result, sizeof(output)) == 0);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(BenchmarkPCMRemapDSP)
+{
+  vector<CPCMRemapDSP::Engine> engines = GetEngines();
+
+  printf("remapping %u frames     reference (ms)", BENCHMARK_FRAMES);
+  for (unsigned int e = 0; e < engines.size(); e++)
+    printf(" %8s (ms)", CPCMRemapDSP::GetEngineName(engines[e]));
+  printf("\n");
+
+  for (unsigned int l = 0; l < sizeof(s_layouts) / sizeof(s_layouts[0]); l++)
+  {
+    const Layout &layout = s_layouts[l];
+    vector<int16_t> input(BENCHMARK_PERIOD * layout.inChannels);
+    vector<int16_t> output(BENCHMARK_PERIOD * layout.outChannels);
+    FillInput(input, l);
+
+    PCMRemapLimiter limiter;
+    InitLimiter(limiter);
+    bool limit = &layout.mix[0] == s_51to20Loud;
+
+    CReferenceRemap reference(layout);
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+    for (unsigned int i = 0; i < BENCHMARK_FRAMES; i += BENCHMARK_PERIOD)
+      reference.Remap(&input[0], &output[0], BENCHMARK_PERIOD, 1.0f, limit ? &limiter : NULL);
+    double referenceTime = (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() / 1000.0;
+    printf("%-24s %14.1f", layout.name, referenceTime);
+
+    for (unsigned int e = 0; e < engines.size(); e++)
+    {
+      CPCMRemapDSP dsp;
+      dsp.SetEngine(engines[e]);
+      SetLayout(dsp, layout);
+      InitLimiter(limiter);
+
+      start = boost::posix_time::microsec_clock::universal_time();
+      for (unsigned int i = 0; i < BENCHMARK_FRAMES; i += BENCHMARK_PERIOD)
+        dsp.Process(&input[0], &output[0], BENCHMARK_PERIOD, 1.0f, limit ? &limiter : NULL);
+      double time = (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() / 1000.0;
+      printf(" %13.1f", time);
+    }
+    printf("\n");
+  }
+}
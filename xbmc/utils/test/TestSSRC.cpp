@@ -0,0 +1,182 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "utils/ssrc.h"
+#include "utils/CPUInfo.h"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <vector>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+using namespace std;
+
+#define OUTPUT_SIZE       4096
+#define BENCHMARK_SECONDS 10
+#define BENCHMARK_THREADS 4
+
+//=============================================================================
+// Helper functions
+//=============================================================================
+
+static const char *s_qualityNames[] = { "low", "medium", "high" };
+
+struct Config
+{
+  bool vectorized;
+  int  threads;
+};
+
+// a few tones and some noise in each channel
+static void FillInput(vector<float> &input, int rate, int channels, int seconds)
+{
+  input.resize(rate * channels * seconds);
+  unsigned int seed = 12345;
+  for (int i = 0; i < rate * seconds; i++)
+  {
+    for (int ch = 0; ch < channels; ch++)
+    {
+      seed = seed * 1103515245 + 12345;
+      float noise = (float)((seed >> 16) & 0x7fff) / 0x7fff - 0.5f;
+      float tone  = 0.3f * sinf(2.0f * (float)M_PI * (440.0f + 1000.0f * ch) * i / rate)
+                  + 0.2f * sinf(2.0f * (float)M_PI * (rate * 0.45f) * i / rate);
+      input[i * channels + ch] = tone + 0.1f * noise;
+    }
+  }
+}
+
+// resamples to 16 bit the way PAPlayer does, returning the number of input samples used
+static unsigned int Resample(Cssrc &resampler, const vector<float> &input, vector<unsigned char> *output)
+{
+  unsigned char packet[OUTPUT_SIZE];
+  unsigned int pos = 0;
+  while (true)
+  {
+    int amount = resampler.GetInputSamples();
+    if (amount > 0)
+    {
+      if (pos + amount > input.size())
+        break;
+      resampler.PutFloatData((float *)&input[pos], amount);
+      pos += amount;
+    }
+    else if (resampler.GetData(packet))
+    {
+      if (output)
+        output->insert(output->end(), packet, packet + OUTPUT_SIZE);
+    }
+    else
+      break;
+  }
+  return pos;
+}
+
+static bool Init(Cssrc &resampler, Cssrc::Quality quality, const Config &config, int from, int to, int channels)
+{
+  resampler.SetQuality(quality);
+  resampler.SetThreads(config.threads);
+  if (!resampler.SetVectorized(config.vectorized, CPU_FEATURE_SSE2 | CPU_FEATURE_NEON))
+    return false;
+  return resampler.InitConverter(from, 32, channels, to, 16, OUTPUT_SIZE);
+}
+
+//=============================================================================
+// Test cases
+//=============================================================================
+
+// vectorized and threaded filtering does the same float operations as the C code does
+BOOST_AUTO_TEST_CASE(BitExactSSRC)
+{
+  static const int rates[][2] = { { 44100, 48000 }, { 44100, 96000 }, { 48000, 192000 }, { 96000, 48000 }, { 48000, 44100 } };
+  static const int channels[] = { 1, 2, 6 };
+  static const Config configs[] = { { false, 4 }, { true, 1 }, { true, 4 } };
+
+  for (unsigned int r = 0; r < sizeof(rates) / sizeof(rates[0]); r++)
+  {
+    for (unsigned int c = 0; c < sizeof(channels) / sizeof(channels[0]); c++)
+    {
+      vector<float> input;
+      FillInput(input, rates[r][0], channels[c], 1);
+
+      for (int q = Cssrc::QUALITY_LOW; q <= Cssrc::QUALITY_HIGH; q++)
+      {
+        Config scalar = { false, 1 };
+        Cssrc reference;
+        BOOST_REQUIRE(Init(reference, (Cssrc::Quality)q, scalar, rates[r][0], rates[r][1], channels[c]));
+        vector<unsigned char> expected;
+        Resample(reference, input, &expected);
+        BOOST_REQUIRE(!expected.empty());
+
+        for (unsigned int i = 0; i < sizeof(configs) / sizeof(configs[0]); i++)
+        {
+          Cssrc resampler;
+          if (!Init(resampler, (Cssrc::Quality)q, configs[i], rates[r][0], rates[r][1], channels[c]))
+            continue; // not compiled in
+          vector<unsigned char> output;
+          Resample(resampler, input, &output);
+          BOOST_CHECK_MESSAGE(output == expected, rates[r][0] << " -> " << rates[r][1] << " Hz, " << channels[c]
+                              << " channels, " << s_qualityNames[q] << " quality, vectorized " << configs[i].vectorized
+                              << ", " << configs[i].threads << " threads");
+        }
+      }
+    }
+  }
+}
+
+// prints how many times faster than realtime upsampling runs
+BOOST_AUTO_TEST_CASE(BenchmarkSSRC)
+{
+  static const int targets[] = { 96000, 192000 };
+  static const int channels[] = { 1, 2, 6 };
+  static const Config configs[] = { { false, 1 }, { true, 1 }, { true, BENCHMARK_THREADS } };
+
+  printf("realtime factor from 44100 Hz   C x1  vector x1  vector x%d\n", BENCHMARK_THREADS);
+  for (unsigned int t = 0; t < sizeof(targets) / sizeof(targets[0]); t++)
+  {
+    for (unsigned int c = 0; c < sizeof(channels) / sizeof(channels[0]); c++)
+    {
+      vector<float> input;
+      FillInput(input, 44100, channels[c], BENCHMARK_SECONDS);
+
+      for (int q = Cssrc::QUALITY_LOW; q <= Cssrc::QUALITY_HIGH; q++)
+      {
+        printf("%6d Hz %d ch %-6s     ", targets[t], channels[c], s_qualityNames[q]);
+        for (unsigned int i = 0; i < sizeof(configs) / sizeof(configs[0]); i++)
+        {
+          Cssrc resampler;
+          if (!Init(resampler, (Cssrc::Quality)q, configs[i], 44100, targets[t], channels[c]))
+          {
+            printf("          -");
+            continue;
+          }
+          boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+          unsigned int used = Resample(resampler, input, NULL);
+          double seconds = (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() / 1000000.0;
+          printf(" %10.1f", (double)used / channels[c] / 44100 / seconds);
+        }
+        printf("\n");
+      }
+    }
+  }
+}
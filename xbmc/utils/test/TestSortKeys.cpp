@@ -0,0 +1,227 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "utils/SortKeys.h"
+#include "utils/StdString.h"
+#include "utils/StringUtils.h"
+#include "utils/test/TestUtils.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdint.h>
+
+using namespace std;
+
+#define BENCHMARK_ITEMS 100000
+
+//=============================================================================
+// Helper functions
+//=============================================================================
+
+static int Sign(int64_t value)
+{
+  return value < 0 ? -1 : (value > 0 ? 1 : 0);
+}
+
+// compare two strings by their keys
+static int KeyCompare(const wchar_t *left, const wchar_t *right)
+{
+  vector<const wchar_t *> strings;
+  strings.push_back(left);
+  strings.push_back(right);
+  vector<string> keys;
+  BOOST_REQUIRE(CSortKeys::Build(strings, keys));
+  return Sign(CSortKeys::Compare(keys[0], keys[1]));
+}
+
+static CTestRandom Random;
+
+static const char *s_words[] = { "the", "a", "an", "love", "night", "Blue", "Song", "of", "Live", "Remix",
+                                 "Part", "Disc", "(Acoustic)", "Zebra", "yellow", "Über", "café", "Ärger", "02", "Vol." };
+
+static CStdStringW Words(unsigned int count)
+{
+  CStdStringW label;
+  for (unsigned int i = 0; i < count; i++)
+  {
+    if (i)
+      label += L" ";
+    const char *word = s_words[Random(sizeof(s_words) / sizeof(s_words[0]))];
+    for (const char *c = word; *c; c++)
+      label += (wchar_t)(unsigned char)*c;
+    if (Random(4) == 0)
+      label.AppendFormat(L" %u", Random(200));
+  }
+  return label;
+}
+
+// labels shaped like those SSortFileItem fills in for each sort method
+static CStdStringW SortLabel(int method)
+{
+  CStdStringW label;
+  switch (method)
+  {
+  case 0: // SORT_METHOD_LABEL
+    label = Words(1 + Random(5));
+    break;
+  case 1: // SORT_METHOD_LABEL_IGNORE_THE, articles already removed
+    label = Words(1 + Random(5));
+    if (label.Left(4) == L"the ")
+      label = label.Mid(4);
+    break;
+  case 2: // SORT_METHOD_FILE
+    label.Format(L"%ls%u.mkv %u", Words(2).c_str(), Random(100), Random(3) ? 0 : Random(100000));
+    break;
+  case 3: // SORT_METHOD_DATE
+    label.Format(L"%04u-%02u-%02u %02u:%02u:%02u %ls", 1990 + Random(22), 1 + Random(12), 1 + Random(28),
+                 Random(24), Random(60), Random(60), Words(2).c_str());
+    break;
+  case 4: // SORT_METHOD_SIZE
+    label.Format(L"%u%05u", Random(100000), Random(100000));
+    break;
+  case 5: // SORT_METHOD_TRACKNUM
+    label.Format(L"%u", (1 + Random(4)) * 65536 + Random(30));
+    break;
+  case 6: // SORT_METHOD_VIDEO_RATING
+    label.Format(L"%f %ls", Random(100) / 10.0f, Words(3).c_str());
+    break;
+  default: // SORT_METHOD_YEAR
+    label.Format(L"%u %ls", 1950 + Random(62), Words(3).c_str());
+    break;
+  }
+  return label;
+}
+
+static const char *s_methods[] = { "label", "label ignore the", "file", "date", "size", "tracknum", "video rating", "year" };
+
+namespace
+{
+// the order CFileItemList::Sort gave when it compared the sort labels themselves
+struct ReferenceLess
+{
+  const vector<CStdStringW> &labels;
+  ReferenceLess(const vector<CStdStringW> &l) : labels(l) {}
+  bool operator()(unsigned int left, unsigned int right) const
+  {
+    return StringUtils::AlphaNumericCompare(labels[left].c_str(), labels[right].c_str()) < 0;
+  }
+};
+
+struct KeyLess
+{
+  const vector<string> &keys;
+  KeyLess(const vector<string> &k) : keys(k) {}
+  bool operator()(unsigned int left, unsigned int right) const
+  {
+    return CSortKeys::Compare(keys[left], keys[right]) < 0;
+  }
+};
+}
+
+//=============================================================================
+// Tests
+//=============================================================================
+
+BOOST_AUTO_TEST_CASE(TestSortKeysOrder)
+{
+  BOOST_CHECK_EQUAL(-1, KeyCompare(L"a2", L"a10"));
+  BOOST_CHECK_EQUAL(0, KeyCompare(L"ABC", L"abc"));
+  BOOST_CHECK_EQUAL(0, KeyCompare(L"track 01", L"track 1"));
+  BOOST_CHECK_EQUAL(0, KeyCompare(L"0", L"000"));
+  BOOST_CHECK_EQUAL(-1, KeyCompare(L"abc", L"abcd"));
+  BOOST_CHECK_EQUAL(-1, KeyCompare(L"a", L"a1"));
+  BOOST_CHECK_EQUAL(1, KeyCompare(L"a1b", L"a1"));
+  BOOST_CHECK_EQUAL(-1, KeyCompare(L"(live)", L"1 live"));
+  BOOST_CHECK_EQUAL(1, KeyCompare(L"live", L"1 live"));
+  // numbers are compared 15 digits at a time
+  BOOST_CHECK_EQUAL(-1, KeyCompare(L"1234567890123452", L"1234567890123451000"));
+  BOOST_CHECK_EQUAL(-1, KeyCompare(L"99", L"123456789012345"));
+}
+
+BOOST_AUTO_TEST_CASE(TestSortKeysEquivalence)
+{
+  // random strings from a small alphabet, so that equal prefixes and numbers are common
+  static const wchar_t alphabet[] = L"aAbB0019 .-(_)éÉЖ";
+  Random.Seed(1);
+  vector<CStdStringW> strings;
+  for (unsigned int i = 0; i < 2000; i++)
+  {
+    CStdStringW s;
+    unsigned int length = Random(20);
+    for (unsigned int j = 0; j < length; j++)
+      s += alphabet[Random(sizeof(alphabet) / sizeof(alphabet[0]) - 1)];
+    strings.push_back(s);
+  }
+  vector<const wchar_t *> labels;
+  for (unsigned int i = 0; i < strings.size(); i++)
+    labels.push_back(strings[i].c_str());
+  vector<string> keys;
+  BOOST_REQUIRE(CSortKeys::Build(labels, keys));
+  BOOST_REQUIRE_EQUAL(strings.size(), keys.size());
+
+  unsigned int mismatches = 0;
+  for (unsigned int i = 0; i < strings.size(); i++)
+  {
+    for (unsigned int j = 0; j < strings.size(); j += 7)
+    {
+      if (Sign(StringUtils::AlphaNumericCompare(labels[i], labels[j])) != Sign(CSortKeys::Compare(keys[i], keys[j])))
+        mismatches++;
+    }
+  }
+  BOOST_CHECK_EQUAL(0u, mismatches);
+}
+
+BOOST_AUTO_TEST_CASE(BenchmarkSortKeys)
+{
+  printf("sorting %u labels      compare (ms)  keys (ms)\n", BENCHMARK_ITEMS);
+  for (unsigned int method = 0; method < sizeof(s_methods) / sizeof(s_methods[0]); method++)
+  {
+    Random.Seed(method + 1);
+    vector<CStdStringW> labels;
+    labels.reserve(BENCHMARK_ITEMS);
+    for (unsigned int i = 0; i < BENCHMARK_ITEMS; i++)
+      labels.push_back(SortLabel(method));
+
+    vector<unsigned int> reference(labels.size());
+    for (unsigned int i = 0; i < reference.size(); i++)
+      reference[i] = i;
+    vector<unsigned int> sorted(reference);
+
+    boost::posix_time::ptime start = BenchmarkStart();
+    stable_sort(reference.begin(), reference.end(), ReferenceLess(labels));
+    double compareTime = ElapsedMilliseconds(start);
+
+    start = BenchmarkStart();
+    vector<const wchar_t *> strings;
+    strings.reserve(labels.size());
+    for (unsigned int i = 0; i < labels.size(); i++)
+      strings.push_back(labels[i].c_str());
+    vector<string> keys;
+    BOOST_REQUIRE(CSortKeys::Build(strings, keys));
+    stable_sort(sorted.begin(), sorted.end(), KeyLess(keys));
+    double keyTime = ElapsedMilliseconds(start);
+
+    BOOST_CHECK_MESSAGE(reference == sorted, s_methods[method]);
+    printf("%-24s %12.1f %10.1f\n", s_methods[method], compareTime, keyTime);
+  }
+}
@@ -0,0 +1,55 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#pragma once
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+/* Pseudo random numbers for test data. The sequence only depends on the seed,
+   so the data (and a failure) is the same on every run and platform */
+class CTestRandom
+{
+public:
+  CTestRandom(unsigned int seed = 1) : m_seed(seed) {}
+
+  void Seed(unsigned int seed) { m_seed = seed; }
+
+  /* a number in [0, range) */
+  unsigned int operator()(unsigned int range)
+  {
+    m_seed = m_seed * 1103515245 + 12345;
+    return (m_seed >> 8) % range;
+  }
+
+private:
+  unsigned int m_seed;
+};
+
+/* the start of a timed section of a benchmark */
+inline static boost::posix_time::ptime BenchmarkStart()
+{
+  return boost::posix_time::microsec_clock::universal_time();
+}
+
+inline static double ElapsedMilliseconds(const boost::posix_time::ptime &start)
+{
+  return (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() / 1000.0;
+}
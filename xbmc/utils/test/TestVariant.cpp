@@ -0,0 +1,627 @@
+/*
+ *      Copyright (C) 2005-2011 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "utils/Variant.h"
+#include "utils/JSONVariantParser.h"
+#include "utils/JSONVariantWriter.h"
+#include "utils/test/TestUtils.h"
+
+#include <map>
+#include <vector>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+
+#define BENCHMARK_MOVIES    2000
+#define BENCHMARK_PASSES    5
+#define BENCHMARK_LOOKUPS   1000000
+
+//=============================================================================
+// Helper functions
+//=============================================================================
+
+namespace
+{
+// CVariant as it was before: every value carries a string, a vector and a map
+class CLegacyVariant
+{
+public:
+  enum Type { Null, Integer, Double, Boolean, String, Array, Object };
+
+  CLegacyVariant() : m_type(Null), m_integer(0) { }
+  CLegacyVariant(int64_t integer) : m_type(Integer), m_integer(integer) { }
+  CLegacyVariant(double value) : m_type(Double), m_double(value) { }
+  CLegacyVariant(bool boolean) : m_type(Boolean), m_integer(boolean) { }
+  CLegacyVariant(const string &str) : m_type(String), m_integer(0), m_string(str) { }
+
+  CLegacyVariant &operator[](const string &key)
+  {
+    m_type = Object;
+    return m_map[key];
+  }
+  const CLegacyVariant &operator[](const string &key) const
+  {
+    static const CLegacyVariant null;
+    map<string, CLegacyVariant>::const_iterator it = m_map.find(key);
+    return it != m_map.end() ? it->second : null;
+  }
+  void push_back(const CLegacyVariant &value)
+  {
+    m_type = Array;
+    m_array.push_back(value);
+  }
+
+  Type m_type;
+  union
+  {
+    int64_t m_integer;
+    double m_double;
+  };
+  string m_string;
+  vector<CLegacyVariant> m_array;
+  map<string, CLegacyVariant> m_map;
+};
+}
+
+static CLegacyVariant &Append(CLegacyVariant &array)
+{
+  array.push_back(CLegacyVariant());
+  return array.m_array.back();
+}
+
+static CVariant &Append(CVariant &array)
+{
+  array.push_back(CVariant::VariantTypeNull);
+  return array[array.size() - 1];
+}
+
+static void MakeObject(CLegacyVariant &object)
+{
+  object = CLegacyVariant();
+  object.m_type = CLegacyVariant::Object;
+}
+
+static void MakeObject(CVariant &object)
+{
+  object = CVariant::VariantTypeObject;
+}
+
+static void SkipWhitespace(const char *&json)
+{
+  while (*json == ' ' || *json == '\n' || *json == '\t' || *json == '\r')
+    json++;
+}
+
+// tiny parser for the documents below (no escapes), it builds the same
+// way CJSONVariantParser does so that only the variants are compared
+static string ParseString(const char *&json)
+{
+  const char *start = ++json;
+  while (*json != '"')
+    json++;
+  return string(start, json++ - start);
+}
+
+template<class T>
+static void ParseValue(const char *&json, T &value)
+{
+  SkipWhitespace(json);
+  if (*json == '{')
+  {
+    json++;
+    MakeObject(value);
+    SkipWhitespace(json);
+    while (*json != '}')
+    {
+      string key = ParseString(json);
+      SkipWhitespace(json);
+      json++; // ':'
+      ParseValue(json, value[key]);
+      SkipWhitespace(json);
+      if (*json == ',')
+        json++;
+      SkipWhitespace(json);
+    }
+    json++;
+  }
+  else if (*json == '[')
+  {
+    json++;
+    SkipWhitespace(json);
+    while (*json != ']')
+    {
+      ParseValue(json, Append(value));
+      SkipWhitespace(json);
+      if (*json == ',')
+        json++;
+      SkipWhitespace(json);
+    }
+    json++;
+  }
+  else if (*json == '"')
+    value = T(ParseString(json));
+  else if (*json == 't' || *json == 'f')
+  {
+    value = T(*json == 't');
+    json += *json == 't' ? 4 : 5;
+  }
+  else
+  {
+    char *end;
+    double number = strtod(json, &end);
+    if (memchr(json, '.', end - json))
+      value = T(number);
+    else
+      value = T((int64_t)number);
+    json = end;
+  }
+}
+
+static void WriteValue(const CLegacyVariant &value, string &output)
+{
+  char number[32];
+  switch (value.m_type)
+  {
+  case CLegacyVariant::Integer:
+    sprintf(number, "%lld", (long long)value.m_integer);
+    output += number;
+    break;
+  case CLegacyVariant::Double:
+    sprintf(number, "%g", value.m_double);
+    output += number;
+    break;
+  case CLegacyVariant::Boolean:
+    output += value.m_integer ? "true" : "false";
+    break;
+  case CLegacyVariant::String:
+    output += "\"" + value.m_string + "\"";
+    break;
+  case CLegacyVariant::Array:
+    output += "[";
+    for (vector<CLegacyVariant>::const_iterator it = value.m_array.begin(); it != value.m_array.end(); it++)
+    {
+      if (it != value.m_array.begin())
+        output += ",";
+      WriteValue(*it, output);
+    }
+    output += "]";
+    break;
+  case CLegacyVariant::Object:
+    output += "{";
+    for (map<string, CLegacyVariant>::const_iterator it = value.m_map.begin(); it != value.m_map.end(); it++)
+    {
+      if (it != value.m_map.begin())
+        output += ",";
+      output += "\"" + it->first + "\":";
+      WriteValue(it->second, output);
+    }
+    output += "}";
+    break;
+  default:
+    output += "null";
+    break;
+  }
+}
+
+static void WriteValue(const CVariant &value, string &output)
+{
+  char number[32];
+  switch (value.type())
+  {
+  case CVariant::VariantTypeInteger:
+    sprintf(number, "%lld", (long long)value.asInteger());
+    output += number;
+    break;
+  case CVariant::VariantTypeDouble:
+    sprintf(number, "%g", value.asDouble());
+    output += number;
+    break;
+  case CVariant::VariantTypeBoolean:
+    output += value.asBoolean() ? "true" : "false";
+    break;
+  case CVariant::VariantTypeString:
+    output += "\"";
+    output += value.c_str();
+    output += "\"";
+    break;
+  case CVariant::VariantTypeArray:
+    output += "[";
+    for (CVariant::const_iterator_array it = value.begin_array(); it != value.end_array(); it++)
+    {
+      if (it != value.begin_array())
+        output += ",";
+      WriteValue(*it, output);
+    }
+    output += "]";
+    break;
+  case CVariant::VariantTypeObject:
+    output += "{";
+    for (CVariant::const_iterator_map it = value.begin_map(); it != value.end_map(); it++)
+    {
+      if (it != value.begin_map())
+        output += ",";
+      output += "\"" + it->first + "\":";
+      WriteValue(it->second, output);
+    }
+    output += "}";
+    break;
+  default:
+    output += "null";
+    break;
+  }
+}
+
+namespace
+{
+// CJSONVariantParser as it was before, building a CLegacyVariant from the yajl callbacks
+class CLegacyParser
+{
+public:
+  static void Parse(const string &json, CLegacyVariant &root)
+  {
+    static yajl_callbacks callbacks = { OnNull, OnBoolean, OnInteger, OnDouble, NULL, OnString,
+                                        OnMapStart, OnMapKey, OnEnd, OnArrayStart, OnEnd };
+    CLegacyParser parser(root);
+#if YAJL_MAJOR == 2
+    yajl_handle handle = yajl_alloc(&callbacks, NULL, &parser);
+    yajl_parse(handle, (const unsigned char *)json.c_str(), json.size());
+    yajl_complete_parse(handle);
+#else
+    yajl_parser_config cfg = { 1, 1 };
+    yajl_handle handle = yajl_alloc(&callbacks, &cfg, NULL, &parser);
+    yajl_parse(handle, (const unsigned char *)json.c_str(), json.size());
+    yajl_parse_complete(handle);
+#endif
+    yajl_free(handle);
+  }
+
+private:
+  CLegacyParser(CLegacyVariant &root) : m_root(root) { }
+
+  void Push(const CLegacyVariant &value, bool container)
+  {
+    CLegacyVariant *target;
+    if (m_parse.empty())
+    {
+      m_root = value;
+      target = &m_root;
+    }
+    else if (m_parse.back()->m_type == CLegacyVariant::Object)
+    {
+      target = &(*m_parse.back())[m_key];
+      *target = value;
+    }
+    else
+    {
+      m_parse.back()->push_back(value);
+      target = &m_parse.back()->m_array.back();
+    }
+
+    if (container)
+      m_parse.push_back(target);
+  }
+
+  static int OnNull(void *ctx) { ((CLegacyParser *)ctx)->Push(CLegacyVariant(), false); return 1; }
+  static int OnBoolean(void *ctx, int boolean) { ((CLegacyParser *)ctx)->Push(CLegacyVariant(boolean != 0), false); return 1; }
+#if YAJL_MAJOR == 2
+  static int OnInteger(void *ctx, long long integer) { ((CLegacyParser *)ctx)->Push(CLegacyVariant((int64_t)integer), false); return 1; }
+  static int OnString(void *ctx, const unsigned char *str, size_t length) { ((CLegacyParser *)ctx)->Push(CLegacyVariant(string((const char *)str, length)), false); return 1; }
+  static int OnMapKey(void *ctx, const unsigned char *str, size_t length) { ((CLegacyParser *)ctx)->m_key.assign((const char *)str, length); return 1; }
+#else
+  static int OnInteger(void *ctx, long integer) { ((CLegacyParser *)ctx)->Push(CLegacyVariant((int64_t)integer), false); return 1; }
+  static int OnString(void *ctx, const unsigned char *str, unsigned int length) { ((CLegacyParser *)ctx)->Push(CLegacyVariant(string((const char *)str, length)), false); return 1; }
+  static int OnMapKey(void *ctx, const unsigned char *str, unsigned int length) { ((CLegacyParser *)ctx)->m_key.assign((const char *)str, length); return 1; }
+#endif
+  static int OnDouble(void *ctx, double value) { ((CLegacyParser *)ctx)->Push(CLegacyVariant(value), false); return 1; }
+  static int OnMapStart(void *ctx)
+  {
+    CLegacyVariant object;
+    object.m_type = CLegacyVariant::Object;
+    ((CLegacyParser *)ctx)->Push(object, true);
+    return 1;
+  }
+  static int OnArrayStart(void *ctx)
+  {
+    CLegacyVariant array;
+    array.m_type = CLegacyVariant::Array;
+    ((CLegacyParser *)ctx)->Push(array, true);
+    return 1;
+  }
+  static int OnEnd(void *ctx) { ((CLegacyParser *)ctx)->m_parse.pop_back(); return 1; }
+
+  CLegacyVariant &m_root;
+  vector<CLegacyVariant *> m_parse;
+  string m_key;
+};
+}
+
+static const char *s_fields[] = { "title", "genre", "year", "rating", "director", "trailer", "tagline", "plot",
+                                   "plotoutline", "originaltitle", "lastplayed", "playcount", "writer", "studio",
+                                   "mpaa", "country", "imdbnumber", "runtime", "set", "showlink", "streamdetails",
+                                   "top250", "votes", "fanart", "thumbnail", "file", "sorttitle", "resume",
+                                   "setid", "dateadded" };
+
+#define FIELD_COUNT (sizeof(s_fields) / sizeof(s_fields[0]))
+
+// a VideoLibrary.GetMovies response with most of the fields requested
+static string MoviesResponse(unsigned int count)
+{
+  string json = "{\"id\":1,\"jsonrpc\":\"2.0\",\"result\":{\"limits\":{\"start\":0,\"end\":1,\"total\":1},\"movies\":[";
+  char buffer[256];
+  for (unsigned int i = 0; i < count; i++)
+  {
+    if (i)
+      json += ",";
+    sprintf(buffer, "{\"movieid\":%u,\"label\":\"Movie %u\"", i, i);
+    json += buffer;
+    for (unsigned int f = 0; f < FIELD_COUNT; f++)
+    {
+      if (f % 5 == 2)
+        sprintf(buffer, ",\"%s\":%u", s_fields[f], i * 31 + f);
+      else if (f % 5 == 3)
+        sprintf(buffer, ",\"%s\":%u.5", s_fields[f], f);
+      else if (f % 5 == 4)
+        sprintf(buffer, ",\"%s\":\"image://special%%3a%%2f%%2fmovies%%2f%u%%2f%s.jpg/\"", s_fields[f], i, s_fields[f]);
+      else
+        sprintf(buffer, ",\"%s\":\"%s %u\"", s_fields[f], s_fields[f], i % 97);
+      json += buffer;
+    }
+    sprintf(buffer, ",\"cast\":[{\"name\":\"Actor %u\",\"role\":\"Role\"},{\"name\":\"Actor %u\",\"role\":\"\"}]}", i % 50, i % 70);
+    json += buffer;
+  }
+  json += "]}}";
+  return json;
+}
+
+//=============================================================================
+// Tests
+//=============================================================================
+
+BOOST_AUTO_TEST_CASE(TestVariantStrings)
+{
+  CVariant small("0123456789abcde");
+  CVariant large("0123456789abcdef");
+  BOOST_CHECK_EQUAL(string("0123456789abcde"), small.asString());
+  BOOST_CHECK_EQUAL(string("0123456789abcdef"), large.asString());
+  BOOST_CHECK_EQUAL(16u, large.size());
+
+  CVariant copy(large);
+  large = small;
+  BOOST_CHECK_EQUAL(string("0123456789abcdef"), copy.asString());
+  BOOST_CHECK(large == small);
+
+  CVariant binary(string("a\0b", 3));
+  BOOST_CHECK_EQUAL(3u, binary.asString().size());
+}
+
+BOOST_AUTO_TEST_CASE(TestVariantObjects)
+{
+  CVariant object(CVariant::VariantTypeObject);
+  object["zeta"] = 1;
+  object["alpha"] = "two";
+  object["mid"]["nested"] = true;
+  object[string(100, 'k')] = 4.0;
+
+  BOOST_CHECK_EQUAL(4u, object.size());
+  BOOST_CHECK(object.isMember("mid"));
+  BOOST_CHECK(!object.isMember("beta"));
+  const CVariant &constObject = object;
+  BOOST_CHECK(constObject["beta"].isNull());
+  BOOST_CHECK_EQUAL(4u, object.size()); // const lookups don't add members
+  BOOST_CHECK(constObject["mid"]["nested"].asBoolean());
+
+  // members are kept sorted by key
+  CVariant::const_iterator_map it = object.begin_map();
+  BOOST_CHECK_EQUAL(string("alpha"), it->first);
+  it++;
+  BOOST_CHECK_EQUAL(string(100, 'k'), it->first);
+
+  object.erase("alpha");
+  BOOST_CHECK_EQUAL(3u, object.size());
+  BOOST_CHECK_EQUAL(string(100, 'k'), object.begin_map()->first);
+
+  // assigning a member of the object to the object itself
+  CVariant self(object);
+  self = self["mid"];
+  BOOST_CHECK(self["nested"].asBoolean());
+}
+
+BOOST_AUTO_TEST_CASE(TestVariantArena)
+{
+  CVariant copy;
+  {
+    CVariantArena arena(256);
+    CVariant root(arena);
+    string json = MoviesResponse(10);
+    CJSONVariantParser::Parse((const unsigned char *)json.c_str(), json.size(), root);
+    BOOST_REQUIRE(root["result"]["movies"].isArray());
+    BOOST_CHECK_EQUAL(10u, root["result"]["movies"].size());
+
+    // mixing arena and heap values both ways
+    root["result"]["extra"] = CVariant(string(200, 'x'));
+    CVariant heap(CVariant::VariantTypeArray);
+    heap.push_back(root["result"]["movies"][3]);
+    heap[0].swap(root["result"]["movies"][4]);
+    copy = root;
+    BOOST_CHECK_EQUAL(string("Movie 4"), heap[0]["label"].asString());
+  }
+  // the arena is gone, the copy has to stand on its own
+  BOOST_CHECK_EQUAL(string("Movie 3"), copy["result"]["movies"][4]["label"].asString());
+  BOOST_CHECK_EQUAL(200u, copy["result"]["extra"].size());
+}
+
+BOOST_AUTO_TEST_CASE(TestVariantTruncated)
+{
+  // a request cut off in its parameters must not come out as a request
+  CVariantArena arena;
+  CVariant root(arena);
+  string json = "{\"jsonrpc\":\"2.0\",\"method\":\"Player.Stop\",\"params\":{";
+  CJSONVariantParser::Parse((const unsigned char *)json.c_str(), json.size(), root);
+  BOOST_CHECK(root.isNull());
+
+  CVariant heap;
+  CJSONVariantParser::Parse((const unsigned char *)json.c_str(), json.size(), heap);
+  BOOST_CHECK(heap.isNull());
+
+  json += "}}";
+  CJSONVariantParser::Parse((const unsigned char *)json.c_str(), json.size(), root);
+  BOOST_REQUIRE(root.isObject());
+  BOOST_CHECK_EQUAL(string("Player.Stop"), root["method"].asString());
+}
+
+BOOST_AUTO_TEST_CASE(TestVariantRoundTrip)
+{
+  string json = MoviesResponse(20);
+  CVariant parsed = CJSONVariantParser::Parse((const unsigned char *)json.c_str(), json.size());
+
+  CLegacyVariant legacy;
+  const char *input = json.c_str();
+  ParseValue(input, legacy);
+
+  CLegacyVariant legacyParsed;
+  CLegacyParser::Parse(json, legacyParsed);
+
+  string expected, output, legacyOutput;
+  WriteValue(legacy, expected);
+  WriteValue(parsed, output);
+  WriteValue(legacyParsed, legacyOutput);
+  BOOST_CHECK(expected == output);
+  BOOST_CHECK(expected == legacyOutput);
+}
+
+BOOST_AUTO_TEST_CASE(BenchmarkVariant)
+{
+  string json = MoviesResponse(BENCHMARK_MOVIES);
+  printf("%u movies, %u kB of JSON, best of %u runs\n", BENCHMARK_MOVIES, (unsigned int)json.size() / 1024, BENCHMARK_PASSES);
+
+  double legacyParse = 1e9, heapParse = 1e9, arenaParse = 1e9, parserLegacy = 1e9, parserHeap = 1e9, parserArena = 1e9;
+  double legacyWrite = 1e9, variantWrite = 1e9, writer = 1e9;
+  double legacyCopy = 1e9, variantCopy = 1e9;
+  for (unsigned int pass = 0; pass < BENCHMARK_PASSES; pass++)
+  {
+    boost::posix_time::ptime start = BenchmarkStart();
+    {
+      CLegacyVariant legacy;
+      const char *input = json.c_str();
+      ParseValue(input, legacy);
+      legacyParse = min(legacyParse, ElapsedMilliseconds(start));
+
+      string output;
+      start = BenchmarkStart();
+      WriteValue(legacy, output);
+      legacyWrite = min(legacyWrite, ElapsedMilliseconds(start));
+
+      start = BenchmarkStart();
+      CLegacyVariant copy(legacy);
+      legacyCopy = min(legacyCopy, ElapsedMilliseconds(start));
+    }
+
+    start = BenchmarkStart();
+    {
+      CVariant variant;
+      const char *input = json.c_str();
+      ParseValue(input, variant);
+      heapParse = min(heapParse, ElapsedMilliseconds(start));
+
+      string output;
+      start = BenchmarkStart();
+      WriteValue(variant, output);
+      variantWrite = min(variantWrite, ElapsedMilliseconds(start));
+
+      start = BenchmarkStart();
+      CVariant copy(variant);
+      variantCopy = min(variantCopy, ElapsedMilliseconds(start));
+    }
+
+    start = BenchmarkStart();
+    {
+      CVariantArena arena;
+      CVariant variant(arena);
+      const char *input = json.c_str();
+      ParseValue(input, variant);
+    }
+    arenaParse = min(arenaParse, ElapsedMilliseconds(start));
+
+    start = BenchmarkStart();
+    {
+      CLegacyVariant legacy;
+      CLegacyParser::Parse(json, legacy);
+    }
+    parserLegacy = min(parserLegacy, ElapsedMilliseconds(start));
+
+    start = BenchmarkStart();
+    {
+      CVariant variant = CJSONVariantParser::Parse((const unsigned char *)json.c_str(), json.size());
+      parserHeap = min(parserHeap, ElapsedMilliseconds(start));
+
+      start = BenchmarkStart();
+      string output = CJSONVariantWriter::Write(variant, true);
+      writer = min(writer, ElapsedMilliseconds(start));
+    }
+
+    start = BenchmarkStart();
+    {
+      CVariantArena arena;
+      CVariant variant(arena);
+      CJSONVariantParser::Parse((const unsigned char *)json.c_str(), json.size(), variant);
+    }
+    parserArena = min(parserArena, ElapsedMilliseconds(start));
+  }
+
+  printf("                           legacy (ms)  heap (ms)  arena (ms)\n");
+  printf("build tree (incl. free)    %11.1f %10.1f %11.1f\n", legacyParse, heapParse, arenaParse);
+  printf("CJSONVariantParser         %11.1f %10.1f %11.1f\n", parserLegacy, parserHeap, parserArena);
+  printf("write tree                 %11.1f %10.1f\n", legacyWrite, variantWrite);
+  printf("CJSONVariantWriter         %11s %10.1f\n", "", writer);
+  printf("copy tree                  %11.1f %10.1f\n", legacyCopy, variantCopy);
+
+  // property style lookups on a single item
+  CLegacyVariant legacyItem;
+  CVariant item(CVariant::VariantTypeObject);
+  for (unsigned int f = 0; f < FIELD_COUNT; f++)
+  {
+    legacyItem[s_fields[f]] = CLegacyVariant((int64_t)f);
+    item[s_fields[f]] = f;
+  }
+  vector<string> keys(s_fields, s_fields + FIELD_COUNT);
+
+  int64_t legacySum = 0, sum = 0;
+  const CLegacyVariant &constLegacy = legacyItem;
+  boost::posix_time::ptime start = BenchmarkStart();
+  for (unsigned int i = 0; i < BENCHMARK_LOOKUPS; i++)
+    legacySum += constLegacy[keys[i % FIELD_COUNT]].m_integer;
+  double legacyLookup = ElapsedMilliseconds(start);
+
+  const CVariant &constItem = item;
+  start = BenchmarkStart();
+  for (unsigned int i = 0; i < BENCHMARK_LOOKUPS; i++)
+    sum += constItem[keys[i % FIELD_COUNT]].asInteger();
+  double lookup = ElapsedMilliseconds(start);
+
+  BOOST_CHECK_EQUAL(legacySum, sum);
+  printf("%u lookups, %u keys %11.1f %10.1f\n", BENCHMARK_LOOKUPS, (unsigned int)FIELD_COUNT, legacyLookup, lookup);
+  printf("sizeof                     %11u %10u\n", (unsigned int)sizeof(CLegacyVariant), (unsigned int)sizeof(CVariant));
+}
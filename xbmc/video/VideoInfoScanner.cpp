@@ -41,6 +41,7 @@
 #include "settings/GUISettings.h"
 #include "settings/Settings.h"
 #include "utils/StringUtils.h"
+#include "utils/ChangeJournal.h"
 #include "guilib/LocalizeStrings.h"
 #include "utils/TimeUtils.h"
 #include "utils/log.h"
@@ -95,6 +96,13 @@ namespace VIDEO
       // result in unexpected behaviour.
       m_bCanInterrupt = false;
 
+      // watch the paths for changes, so the next scan only has to look at what changed
+      CChangeJournal &journal = CChangeJournal::GetInstance();
+      for (set<CStdString>::iterator it = m_pathsToScan.begin(); it != m_pathsToScan.end(); ++it)
+        journal.Watch(*it);
+      int64_t journalPosition = journal.GetPosition();
+      set<CStdString> pathsToJournal = m_pathsToScan;
+
       bool bCancelled = false;
       while (!bCancelled && m_pathsToScan.size())
       {
@@ -111,6 +119,8 @@ namespace VIDEO
 
       if (!bCancelled)
       {
+        journal.SetScanned("video", pathsToJournal, journalPosition);
+
         if (m_bClean)
           m_database.CleanDatabase(m_pObserver,&m_pathsToClean);
         else
@@ -222,8 +232,33 @@ namespace VIDEO
       if (m_pObserver)
         m_pObserver->OnStateChanged(content == CONTENT_MOVIES ? FETCHING_MOVIE_INFO : FETCHING_MUSICVIDEO_INFO);
 
-      CStdString fastHash = GetFastHash(strDirectory);
-      if (m_database.GetPathHash(strDirectory, dbHash) && !fastHash.IsEmpty() && fastHash == dbHash)
+      CChangeJournal &journal = CChangeJournal::GetInstance();
+      vector<CStdString> subfolders;
+      CStdString fastHash;
+      if (m_database.GetPathHash(strDirectory, dbHash) && !dbHash.IsEmpty() && journal.IsUnchanged("video", strDirectory, false) &&
+          journal.GetSubdirectories(strDirectory, subfolders, g_guiSettings.GetBool("filelists.showhidden")))
+      { // the change journal knows the folder hasn't changed - only the subfolders need a look
+        CLog::Log(LOGDEBUG, "VideoInfoScanner: Skipping dir '%s' due to no change (journal)", strDirectory.c_str());
+        hash = dbHash;
+        bSkip = true;
+        for (unsigned int i = 0; i < subfolders.size(); i++)
+        {
+          if (CUtil::ExcludeFileOrFolder(subfolders[i], regexps))
+            continue;
+          CStdString name(subfolders[i]);
+          URIUtils::RemoveSlashAtEnd(name);
+          CFileItemPtr item(new CFileItem(URIUtils::GetFileName(name)));
+          item->SetPath(subfolders[i]);
+          item->m_bIsFolder = true;
+          items.Add(item);
+        }
+        // stacked as the listing would be, so dvd and cd# folders aren't recursed into
+        items.SetPath(strDirectory);
+        items.Stack();
+      }
+      else
+        fastHash = GetFastHash(strDirectory);
+      if (!bSkip && !fastHash.IsEmpty() && fastHash == dbHash)
       { // fast hashes match - no need to process anything
         CLog::Log(LOGDEBUG, "VideoInfoScanner: Skipping dir '%s' due to no change (fasthash)", strDirectory.c_str());
         hash = fastHash;
@@ -631,8 +666,16 @@ namespace VIDEO
 
     if (item->m_bIsFolder)
     {
-      CUtil::GetRecursiveListing(item->GetPath(), items, g_settings.m_videoExtensions, true);
       CStdString hash, dbHash;
+      if (CChangeJournal::GetInstance().IsUnchanged("video", item->GetPath(), true) && m_database.GetPathHash(item->GetPath(), dbHash))
+      { // the change journal knows nothing below the show's folder has changed
+        CLog::Log(LOGDEBUG, "VideoInfoScanner: Skipping show folder '%s' due to no change (journal)", item->GetPath().c_str());
+        if (m_pObserver)
+          m_pObserver->OnDirectoryScanned(item->GetPath());
+        return;
+      }
+
+      CUtil::GetRecursiveListing(item->GetPath(), items, g_settings.m_videoExtensions, true);
       int numFilesInFolder = GetPathHash(items, hash);
 
       if (m_database.GetPathHash(item->GetPath(), dbHash) && dbHash == hash)
@@ -29,6 +29,7 @@
 #include "input/ButtonTranslator.h"
 #include "guilib/GUIControlFactory.h"
 #include "guilib/GUIFontManager.h"
+#include "guilib/GUIFontTTF.h"
 #include "guilib/GUITextLayout.h"
 #include "guilib/GUIWindowManager.h"
 #include "guilib/GUIControlProfiler.h"
@@ -103,13 +104,22 @@ void CGUIWindowDebugInfo::Process(unsigned int currentTime, CDirtyRegionList &di
     CStdString profiling = CGUIControlProfiler::IsRunning() ? " (profiling)" : "";
     CStdString strCores = g_cpuInfo.GetCoresUsageString();
 #if !defined(_LINUX)
-    info.Format("LOG: %sxbmc.log\nMEM: %"PRIu64"/%"PRIu64" KB - FPS: %2.1f fps\nCPU: %s%s", g_settings.m_logFolder.c_str(),
-                stat.ullAvailPhys/1024, stat.ullTotalPhys/1024, g_infoManager.GetFPS(), strCores.c_str(), profiling.c_str());
+    info.Format("LOG: %sxbmc.log\nMEM: %"PRIu64"/%"PRIu64" KB - FPS: %2.1f fps - BOOL: %2.1f/frame\nCPU: %s%s", g_settings.m_logFolder.c_str(),
+                stat.ullAvailPhys/1024, stat.ullTotalPhys/1024, g_infoManager.GetFPS(), g_infoManager.GetBoolEvaluationsPerFrame(), strCores.c_str(), profiling.c_str());
 #else
     double dCPU = m_resourceCounter.GetCPUUsage();
-    info.Format("LOG: %sxbmc.log\nMEM: %"PRIu64"/%"PRIu64" KB - FPS: %2.1f fps\nCPU: %s (CPU-XBMC %4.2f%%%s)", g_settings.m_logFolder.c_str(),
-                stat.ullAvailPhys/1024, stat.ullTotalPhys/1024, g_infoManager.GetFPS(), strCores.c_str(), dCPU, profiling.c_str());
+    info.Format("LOG: %sxbmc.log\nMEM: %"PRIu64"/%"PRIu64" KB - FPS: %2.1f fps - BOOL: %2.1f/frame\nCPU: %s (CPU-XBMC %4.2f%%%s)", g_settings.m_logFolder.c_str(),
+                stat.ullAvailPhys/1024, stat.ullTotalPhys/1024, g_infoManager.GetFPS(), g_infoManager.GetBoolEvaluationsPerFrame(), strCores.c_str(), dCPU, profiling.c_str());
 #endif
+    // glyph cache hit rate over the last frame, counts since startup
+    static unsigned int lastHits = 0, lastMisses = 0;
+    unsigned int hits, misses, evictions;
+    CGUIFontTTFBase::GetCacheStats(hits, misses, evictions);
+    unsigned int frameHits = hits - lastHits, frameMisses = misses - lastMisses;
+    lastHits = hits;
+    lastMisses = misses;
+    info.AppendFormat("\nGLYPHS: %5.1f%% hits - %u misses - %u evicted",
+                      frameHits + frameMisses ? 100.0f * frameHits / (frameHits + frameMisses) : 100.0f, misses, evictions);
   }
 
   // render the skin debug info